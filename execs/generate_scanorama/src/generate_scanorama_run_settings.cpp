@@ -3,6 +3,7 @@
 #include <util/cmd_args.h>
 #include <util/tictoc.h>
 #include <util/error_codes.h>
+#include <geometry/raytrace/BVHCache.h>
 #include <iostream>
 #include <string>
 #include <vector>
@@ -35,6 +36,9 @@ using namespace std;
 #define BEGIN_IDX_FLAG    "-b"
 #define END_IDX_FLAG      "-e"
 #define META_OUTFILE_FLAG "--meta"
+#define CACHEDIR_FLAG     "--cache_dir"
+#define NO_CACHE_FLAG     "--no_cache"
+#define REBUILD_FLAG      "--rebuild_cache"
 
 /* the xml parameters to look for */
 
@@ -43,6 +47,7 @@ using namespace std;
 #define XML_BLENDWIDTH         "scanorama_blendwidth"
 #define XML_MIN_SPACING_DIST   "scanorama_min_spacing_dist"
 #define XML_MAX_SPACING_DIST   "scanorama_max_spacing_dist"
+#define XML_NUM_THREADS        "scanorama_num_threads"
 #define XML_EXPORT_PTX         "scanorama_export_ptx"
 #define XML_EXPORT_PTG         "scanorama_export_ptg"
 #define XML_EXPORT_E57         "scanorama_export_e57"
@@ -60,6 +65,8 @@ generate_scanorama_run_settings_t::generate_scanorama_run_settings_t()
 	this->xml_config        = "";
 	this->pathfile          = "";
 	this->modelfile         = "";
+	this->cachedir          = "";
+	this->rebuild_cache     = false;
 	this->fisheye_cam_metafiles.clear();
 	this->fisheye_cam_calibfiles.clear();
 	this->fisheye_cam_imgdirs.clear();
@@ -80,6 +87,7 @@ generate_scanorama_run_settings_t::generate_scanorama_run_settings_t()
 	this->export_png        = false;
 	this->export_normal_png = false;
 	this->export_depth_png  = false;
+	this->num_threads       = 0; /* by default, use all cores */
 }
 
 int generate_scanorama_run_settings_t::parse(int argc, char** argv)
@@ -159,6 +167,19 @@ int generate_scanorama_run_settings_t::parse(int argc, char** argv)
 			"all indices until the end of the dataset will be "
 			"exported.  The index specified is in the output "
 			"indexing, NOT the input pose indices.", true, 1);
+	args.add(CACHEDIR_FLAG, "The directory where the index of the "
+			"model's raytracing hierarchy is cached.  The "
+			"index is named by a hash of the model file, and "
+			"is mapped into memory on later runs instead of "
+			"being rebuilt.  If not specified, the directory "
+			"of the model file is used.", true, 1);
+	args.add(NO_CACHE_FLAG, "If seen, the raytracing hierarchy is "
+			"built from the model on every run, and is not "
+			"read from or saved to the cache.", true, 0);
+	args.add(REBUILD_FLAG, "If seen, the raytracing hierarchy is "
+			"rebuilt from the model, and its cached index is "
+			"replaced.  Use this if the cached index is "
+			"suspect.", true, 0);
 
 	/* parse the command-line arguments */
 	ret = args.parse(argc, argv);
@@ -213,6 +234,13 @@ int generate_scanorama_run_settings_t::parse(int argc, char** argv)
 		this->meta_outfile = args.get_val(META_OUTFILE_FLAG);
 	else
 		this->meta_outfile = "";
+	if(args.tag_seen(NO_CACHE_FLAG))
+		this->cachedir = "";
+	else if(args.tag_seen(CACHEDIR_FLAG))
+		this->cachedir = args.get_val(CACHEDIR_FLAG);
+	else
+		this->cachedir = BVHCache::default_dir(this->modelfile);
+	this->rebuild_cache = args.tag_seen(REBUILD_FLAG);
 
 	/* import settings from xml settings file */
 	if(!settings.read(args.get_val(SETTINGS_FILE)))
@@ -238,6 +266,8 @@ int generate_scanorama_run_settings_t::parse(int argc, char** argv)
 	if(settings.is_prop(XML_MAX_SPACING_DIST))
 		this->max_spacing_dist 
 			= settings.getAsDouble(XML_MAX_SPACING_DIST);
+	if(settings.is_prop(XML_NUM_THREADS))
+		this->num_threads  = settings.getAsUint(XML_NUM_THREADS);
 	if(settings.is_prop(XML_EXPORT_PTX))
 		this->export_ptx = (settings.getAsUint(XML_EXPORT_PTX)!=0);
 	if(settings.is_prop(XML_EXPORT_PTG))
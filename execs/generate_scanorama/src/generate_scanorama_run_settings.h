@@ -46,6 +46,23 @@ class generate_scanorama_run_settings_t
 		 */
 		std::string modelfile;
 
+		/**
+		 * The directory where the index of the model's
+		 * raytracing hierarchy is cached.
+		 *
+		 * By default, this is the directory of the model
+		 * file.  If empty, the cache is not used, and the
+		 * hierarchy is built on every run.
+		 */
+		std::string cachedir;
+
+		/**
+		 * If true, the hierarchy is rebuilt from the model
+		 * and its cached index is replaced, even if a valid
+		 * index already exists.
+		 */
+		bool rebuild_cache;
+
 		/**
 		 * This vector lists all the metadata files
 		 * given for input fisheye cameras used to
@@ -155,6 +172,15 @@ class generate_scanorama_run_settings_t
 		 */
 		double max_spacing_dist;
 
+		/**
+		 * The number of threads to use when generating
+		 * scanoramas.
+		 *
+		 * If zero, one thread is used per core.  The exported
+		 * scanoramas are the same for any number of threads.
+		 */
+		unsigned int num_threads;
+
 		/**
 		 * Specifies the start index of the exported scanoramas
 		 *
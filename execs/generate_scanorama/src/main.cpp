@@ -45,7 +45,8 @@ int main(int argc, char** argv)
 
 	/* initialize the maker object */
 	tic(clk);
-	ret = maker.init(args.pathfile, args.xml_config, args.modelfile);
+	ret = maker.init(args.pathfile, args.xml_config, args.modelfile,
+			args.cachedir, args.rebuild_cache);
 	if(ret)
 	{
 		cerr << "[main]\tError " << ret << ": "
@@ -111,7 +112,7 @@ int main(int argc, char** argv)
 			args.meta_outfile,
 			args.min_spacing_dist, args.max_spacing_dist,
 			args.num_rows, args.num_cols, args.blendwidth,
-			args.begin_idx, args.end_idx);
+			args.begin_idx, args.end_idx, args.num_threads);
 	if(ret)
 	{
 		cerr << "[main]\tError " << ret << ": "
@@ -0,0 +1,47 @@
+#include "test_image_cache.h"
+#include "test_scanorama.h"
+#include <iostream>
+
+/**
+ * @file main.cpp
+ * @author Eric Turner <elturner@eecs.berkeley.edu>
+ *
+ * @section DESCRIPTION
+ *
+ * This is the main file for the unit tests of the generate_scanorama
+ * program.  Run it with 'make test' from the generate_scanorama
+ * directory.  The tests use the OpenCV stand-in in test/opencv_double,
+ * so they build without OpenCV.
+ */
+
+using namespace std;
+
+/**
+ * The main function for the unit tests
+ */
+int main()
+{
+	int ret;
+
+	/* run each test suite */
+	ret = test_image_cache();
+	if(ret)
+	{
+		cerr << "[main]\ttest_image_cache FAILED: Error "
+		     << ret << endl;
+		return 1;
+	}
+	cout << "[main]\ttest_image_cache passed" << endl;
+
+	ret = test_scanorama();
+	if(ret)
+	{
+		cerr << "[main]\ttest_scanorama FAILED: Error "
+		     << ret << endl;
+		return 2;
+	}
+	cout << "[main]\ttest_scanorama passed" << endl;
+
+	/* success */
+	return 0;
+}
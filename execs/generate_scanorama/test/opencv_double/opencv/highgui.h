@@ -0,0 +1,7 @@
+#ifndef OPENCV_DOUBLE_OPENCV_HIGHGUI_H
+#define OPENCV_DOUBLE_OPENCV_HIGHGUI_H
+
+/* see opencv_double.h, which stands in for OpenCV in the unit tests */
+#include "../opencv_double.h"
+
+#endif
@@ -0,0 +1,7 @@
+#ifndef OPENCV_DOUBLE_OPENCV2_OPENCV_HPP
+#define OPENCV_DOUBLE_OPENCV2_OPENCV_HPP
+
+/* see opencv_double.h, which stands in for OpenCV in the unit tests */
+#include "../opencv_double.h"
+
+#endif
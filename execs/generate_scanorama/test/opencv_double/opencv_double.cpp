@@ -0,0 +1,109 @@
+#include "opencv_double.h"
+#include <string>
+#include <map>
+#include <algorithm>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/locks.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+
+/**
+ * @file opencv_double.cpp
+ * @author Eric Turner <elturner@eecs.berkeley.edu>
+ *
+ * @section DESCRIPTION
+ *
+ * Implements the stand-in for OpenCV's imread() that is used by the
+ * unit tests of generate_scanorama.
+ */
+
+using namespace std;
+
+/* the size of the images that are made up */
+#define DOUBLE_IMAGE_ROWS     8
+#define DOUBLE_IMAGE_COLS     8
+#define DOUBLE_IMAGE_CHANNELS 3
+
+/* the state of the reads, which is shared by all threads */
+static boost::mutex read_mtx;
+static map<string, size_t> read_counts;
+static size_t reads_in_progress = 0;
+static size_t max_reads_in_progress = 0;
+static unsigned int read_delay_ms = 0;
+
+cv::Mat cv::imread(const std::string& path, int flags)
+{
+	size_t i, channels, n;
+	unsigned int delay;
+
+	/* count this read */
+	{
+		boost::unique_lock<boost::mutex> lock(read_mtx);
+		read_counts[path]++;
+		reads_in_progress++;
+		max_reads_in_progress = std::max(max_reads_in_progress,
+						reads_in_progress);
+		delay = read_delay_ms;
+	}
+
+	/* take as long as the test wants a read to take */
+	if(delay > 0)
+		boost::this_thread::sleep(
+			boost::posix_time::milliseconds(delay));
+	{
+		boost::unique_lock<boost::mutex> lock(read_mtx);
+		reads_in_progress--;
+	}
+
+	/* paths that are missing fail to load */
+	if(path.find("missing") != string::npos)
+		return Mat();
+
+	/* make up the pixels of this image */
+	channels = (flags == IMREAD_GRAYSCALE) ? 1 : DOUBLE_IMAGE_CHANNELS;
+	Mat m(DOUBLE_IMAGE_ROWS, DOUBLE_IMAGE_COLS, channels);
+	n = DOUBLE_IMAGE_ROWS * DOUBLE_IMAGE_COLS * channels;
+	for(i = 0; i < n; i++)
+		m.data[i] = opencv_double::pixel(path, i);
+	return m;
+}
+
+unsigned char opencv_double::pixel(const std::string& path, size_t i)
+{
+	size_t h, k;
+
+	/* hash the path, so each image is different */
+	h = 5381;
+	for(k = 0; k < path.size(); k++)
+		h = 33*h + (unsigned char) path[k];
+	return (unsigned char) ((h + 7*i) % 256);
+}
+
+void opencv_double::set_read_delay(unsigned int ms)
+{
+	boost::unique_lock<boost::mutex> lock(read_mtx);
+	read_delay_ms = ms;
+}
+
+size_t opencv_double::num_reads(const std::string& path)
+{
+	map<string, size_t>::const_iterator it;
+
+	boost::unique_lock<boost::mutex> lock(read_mtx);
+	it = read_counts.find(path);
+	return (it == read_counts.end()) ? 0 : it->second;
+}
+
+size_t opencv_double::max_concurrent_reads()
+{
+	boost::unique_lock<boost::mutex> lock(read_mtx);
+	return max_reads_in_progress;
+}
+
+void opencv_double::reset()
+{
+	boost::unique_lock<boost::mutex> lock(read_mtx);
+	read_counts.clear();
+	reads_in_progress = 0;
+	max_reads_in_progress = 0;
+}
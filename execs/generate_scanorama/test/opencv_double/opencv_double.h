@@ -0,0 +1,112 @@
+#ifndef OPENCV_DOUBLE_H
+#define OPENCV_DOUBLE_H
+
+/**
+ * @file opencv_double.h
+ * @author Eric Turner <elturner@eecs.berkeley.edu>
+ *
+ * @section DESCRIPTION
+ *
+ * A minimal stand-in for the parts of OpenCV that the image cache and
+ * the cameras use, so that the unit tests of generate_scanorama can
+ * build without OpenCV.  The test directory is searched before the
+ * system headers, so <opencv2/opencv.hpp> and friends resolve to the
+ * files next to this one, which all include this header.
+ *
+ * Images are never read from disk.  imread() makes up a small image
+ * whose pixels depend on the path, counts how many times each path
+ * was read, and fails for any path that contains "missing".
+ */
+
+#include <string>
+#include <vector>
+#include <memory>
+
+/* the load flags used by this code base */
+#define CV_LOAD_IMAGE_COLOR 1
+
+/* the legacy matrix type appears in some prototypes */
+typedef struct CvMat CvMat;
+
+namespace cv
+{
+	/* the load flags of the newer interface */
+	enum { IMREAD_GRAYSCALE = 0, IMREAD_COLOR = 1 };
+
+	/**
+	 * A matrix whose copies share the same pixels, like cv::Mat
+	 */
+	class Mat
+	{
+		/* parameters */
+		private:
+
+			/* the shared pixels, or null if empty */
+			std::shared_ptr<std::vector<unsigned char> > buf;
+
+		public:
+
+			/* the size of the image, and a pointer to its
+			 * pixels, which is NULL if empty */
+			int rows, cols;
+			unsigned char* data;
+
+		/* functions */
+		public:
+
+			Mat() : rows(0), cols(0), data(NULL) {};
+			Mat(int r, int c, int channels)
+				: buf(new std::vector<unsigned char>(
+					r*c*channels, 0)),
+				  rows(r), cols(c),
+				  data(&((*buf)[0])) {};
+
+			inline bool empty() const
+				{ return (this->data == NULL); };
+	};
+
+	/**
+	 * Makes up an image for the given path
+	 *
+	 * @param path   The path of the image
+	 * @param flags  Either IMREAD_GRAYSCALE or IMREAD_COLOR
+	 *
+	 * @return   Returns the image, or an empty Mat on failure.
+	 */
+	Mat imread(const std::string& path, int flags = IMREAD_COLOR);
+}
+
+namespace opencv_double
+{
+	/**
+	 * The value of a pixel of the image made up for a path
+	 *
+	 * @param path   The path of the image
+	 * @param i      The index of the byte in the image
+	 *
+	 * @return   Returns the value of that byte.
+	 */
+	unsigned char pixel(const std::string& path, size_t i);
+
+	/**
+	 * Sets how long each call to imread() takes, in milliseconds
+	 */
+	void set_read_delay(unsigned int ms);
+
+	/**
+	 * Gets the number of times the given path was read
+	 */
+	size_t num_reads(const std::string& path);
+
+	/**
+	 * Gets the most reads that were ever in progress at once
+	 */
+	size_t max_concurrent_reads();
+
+	/**
+	 * Forgets all read counts
+	 */
+	void reset();
+}
+
+#endif
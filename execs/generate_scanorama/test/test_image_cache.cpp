@@ -0,0 +1,205 @@
+#include "test_image_cache.h"
+#include "opencv_double/opencv_double.h"
+#include <image/image_cache.h>
+#include <util/error_codes.h>
+#include <boost/threadpool.hpp>
+#include <boost/bind.hpp>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/**
+ * @file test_image_cache.cpp
+ * @author Eric Turner <elturner@eecs.berkeley.edu>
+ *
+ * @section DESCRIPTION
+ *
+ * Runs unit tests for the image_cache_t class, which check that many
+ * threads sharing one cache read each image once, that they can read
+ * different images at the same time, and that a failed read is
+ * reported without blocking the other threads.
+ *
+ * The images come from the OpenCV stand-in in test/opencv_double,
+ * which counts the reads of each path.
+ */
+
+using namespace std;
+
+/* the parameters of the tests */
+#define TEST_NUM_THREADS     8
+#define TEST_NUM_IMAGES      4
+#define TEST_GETS_PER_THREAD 200
+#define TEST_READ_DELAY_MS   20
+
+/* helper functions */
+string image_path(size_t i);
+bool image_matches(const string& path, const cv::Mat& m);
+void get_images(image_cache_t* cache, const vector<string>* paths,
+                size_t offset, int* ret);
+
+/* the testing suite */
+int test_image_cache()
+{
+	vector<string> paths, missing;
+	vector<int> rets;
+	cv::Mat m;
+	size_t i;
+	int ret;
+
+	/* every thread gets the same few images, in a different order,
+	 * while each read is slow enough for the threads to collide */
+	opencv_double::reset();
+	opencv_double::set_read_delay(TEST_READ_DELAY_MS);
+	for(i = 0; i < TEST_NUM_IMAGES; i++)
+		paths.push_back(image_path(i));
+	{
+		image_cache_t cache;
+		cache.set_capacity(TEST_NUM_IMAGES);
+		rets.assign(TEST_NUM_THREADS, 0);
+		{
+			boost::threadpool::pool tp(TEST_NUM_THREADS);
+			for(i = 0; i < TEST_NUM_THREADS; i++)
+				tp.schedule(boost::bind(get_images, &cache,
+						&paths, i, &(rets[i])));
+		}
+		for(i = 0; i < TEST_NUM_THREADS; i++)
+			if(rets[i])
+			{
+				cerr << "[test_image_cache]\tThread " << i
+				     << " got the wrong image: "
+				     << rets[i] << endl;
+				return -1;
+			}
+		for(i = 0; i < TEST_NUM_IMAGES; i++)
+			if(opencv_double::num_reads(paths[i]) != 1)
+			{
+				cerr << "[test_image_cache]\t" << paths[i]
+				     << " was read "
+				     << opencv_double::num_reads(paths[i])
+				     << " times by " << TEST_NUM_THREADS
+				     << " threads, instead of once" << endl;
+				return -2;
+			}
+	}
+
+	/* each thread misses on a different image, and these misses
+	 * should be read at the same time, not one after another */
+	opencv_double::reset();
+	paths.clear();
+	for(i = 0; i < TEST_NUM_THREADS; i++)
+		paths.push_back(image_path(TEST_NUM_IMAGES + i));
+	{
+		image_cache_t cache;
+		cache.set_capacity(TEST_NUM_THREADS);
+		rets.assign(TEST_NUM_THREADS, 0);
+		{
+			boost::threadpool::pool tp(TEST_NUM_THREADS);
+			for(i = 0; i < TEST_NUM_THREADS; i++)
+				tp.schedule(boost::bind(get_images, &cache,
+					&paths, i, &(rets[i])));
+		}
+		for(i = 0; i < TEST_NUM_THREADS; i++)
+			if(rets[i] || opencv_double::num_reads(paths[i]) != 1)
+			{
+				cerr << "[test_image_cache]\tUnable to read "
+				     << paths[i] << " once in parallel: "
+				     << rets[i] << endl;
+				return -3;
+			}
+		if(opencv_double::max_concurrent_reads() < 2)
+		{
+			cerr << "[test_image_cache]\tThe misses of "
+			     << TEST_NUM_THREADS << " threads were read "
+			     << "one at a time" << endl;
+			return -4;
+		}
+	}
+
+	/* a missing image fails for every thread that waits on it,
+	 * and the cache can still be used afterwards */
+	opencv_double::reset();
+	missing.push_back("missing.jpg");
+	{
+		image_cache_t cache;
+		rets.assign(TEST_NUM_THREADS, 0);
+		{
+			boost::threadpool::pool tp(TEST_NUM_THREADS);
+			for(i = 0; i < TEST_NUM_THREADS; i++)
+				tp.schedule(boost::bind(get_images, &cache,
+					&missing, i, &(rets[i])));
+		}
+		for(i = 0; i < TEST_NUM_THREADS; i++)
+			if(rets[i] == 0)
+			{
+				cerr << "[test_image_cache]\tThread " << i
+				     << " did not report the failed read"
+				     << endl;
+				return -5;
+			}
+		ret = cache.get(paths[0], m);
+		if(ret || !image_matches(paths[0], m))
+		{
+			cerr << "[test_image_cache]\tUnable to use the "
+			     << "cache after a failed read: " << ret
+			     << endl;
+			return -6;
+		}
+	}
+
+	/* success */
+	opencv_double::set_read_delay(0);
+	return 0;
+}
+
+/* helper functions */
+
+string image_path(size_t i)
+{
+	stringstream ss;
+
+	/* the images do not exist, so their names only need to differ */
+	ss << "image_" << i << ".jpg";
+	return ss.str();
+}
+
+bool image_matches(const string& path, const cv::Mat& m)
+{
+	size_t i, n;
+
+	/* compare to the pixels that were made up for this path */
+	if(m.empty())
+		return false;
+	n = m.rows * m.cols * 3;
+	for(i = 0; i < n; i++)
+		if(m.data[i] != opencv_double::pixel(path, i))
+			return false;
+	return true;
+}
+
+void get_images(image_cache_t* cache, const vector<string>* paths,
+                size_t offset, int* ret)
+{
+	cv::Mat m;
+	size_t i, j;
+	int r;
+
+	/* get the images over and over, starting at a different one
+	 * in each thread */
+	*ret = 0;
+	for(i = 0; i < TEST_GETS_PER_THREAD; i++)
+	{
+		j = (offset + i) % paths->size();
+		r = cache->get((*paths)[j], m);
+		if(r)
+		{
+			*ret = PROPEGATE_ERROR(-1, r);
+			return;
+		}
+		if(!image_matches((*paths)[j], m))
+		{
+			*ret = -2;
+			return;
+		}
+	}
+}
@@ -0,0 +1,23 @@
+#ifndef TEST_IMAGE_CACHE_H
+#define TEST_IMAGE_CACHE_H
+
+/**
+ * @file test_image_cache.h
+ * @author Eric Turner <elturner@eecs.berkeley.edu>
+ *
+ * @section DESCRIPTION
+ *
+ * Runs unit tests for the image_cache_t class, which check that many
+ * threads sharing one cache read each image once, that they can read
+ * different images at the same time, and that a failed read is
+ * reported without blocking the other threads.
+ */
+
+/**
+ * Runs the tests.
+ *
+ * @return   Returns zero if all pass, non-zero if failure occurs.
+ */
+int test_image_cache();
+
+#endif
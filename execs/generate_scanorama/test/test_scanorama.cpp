@@ -0,0 +1,231 @@
+#include "test_scanorama.h"
+#include "opencv_double/opencv_double.h"
+#include <image/scanorama/scanorama.h>
+#include <image/camera.h>
+#include <geometry/system_path.h>
+#include <geometry/raytrace/BVH.h>
+#include <geometry/raytrace/Triangle3.h>
+#include <util/error_codes.h>
+#include <Eigen/Dense>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <cmath>
+
+/**
+ * @file test_scanorama.cpp
+ * @author Eric Turner <elturner@eecs.berkeley.edu>
+ *
+ * @section DESCRIPTION
+ *
+ * Runs unit tests for the scanorama_t class, which check that tracing
+ * the geometry of a scanorama and coloring it with several cameras
+ * give the same points with one thread as with many.
+ *
+ * The model is a furnished room, and the cameras color each point
+ * from the images of the OpenCV stand-in in test/opencv_double, so
+ * that the threads share the image cache of each camera.
+ */
+
+using namespace std;
+using namespace Eigen;
+
+/* the parameters of the scanorama, which are large enough that both
+ * the geometry and the coloring are split into several tasks */
+#define TEST_ROWS        256
+#define TEST_COLS        512
+#define TEST_BLENDWIDTH  0.2
+#define TEST_NUM_CAMERAS 2
+#define TEST_NUM_THREADS 4
+
+/**
+ * A camera that colors points from made-up images
+ *
+ * The images are read through the camera's image cache, and the color
+ * and quality of each point only depend on its position.
+ */
+class test_camera_t : public camera_t
+{
+	/* parameters */
+	private:
+
+		/* which of the test cameras this is */
+		int index;
+
+	/* functions */
+	public:
+
+		test_camera_t(int i) : index(i)
+		{
+			stringstream ss;
+			ss << "test_camera_" << i;
+			this->cameraName = ss.str();
+		};
+
+		int init(const std::string& calibfile,
+		         const std::string& metafile,
+		         const std::string& imgdir,
+		         const system_path_t& path)
+		{
+			(void) calibfile; (void) metafile;
+			(void) imgdir; (void) path;
+			return 0;
+		};
+
+		void clear()
+			{ this->images.clear(); };
+
+		int color_point(double px, double py, double pz, double t,
+		                int& r, int& g, int& b, double& q)
+		{
+			stringstream ss;
+			cv::Mat img;
+			size_t i;
+			int ret;
+
+			/* each octant of the room is seen in its own image */
+			(void) t;
+			ss << this->cameraName << "_" << (px > 0)
+			   << (py > 0) << (pz > 0) << ".jpg";
+			ret = this->images.get(ss.str(), img);
+			if(ret)
+				return PROPEGATE_ERROR(-1, ret);
+
+			/* pick a pixel based on the position */
+			i = 3 * (((size_t) (fabs(px+py+pz) * 100))
+					% (img.rows * img.cols));
+			r = img.data[i];
+			g = img.data[i+1];
+			b = img.data[i+2];
+
+			/* the quality is sometimes negative, and the
+			 * cameras are often close enough to be blended */
+			q = sin(3*px + 2*py + pz + this->index);
+			return 0;
+		};
+};
+
+/* helper functions */
+void add_solid_box(vector<Triangle3<float> >& tris,
+                   const float* bmin, const float* bmax);
+void room_mesh(vector<Triangle3<float> >& tris);
+string scanorama_points(const scanorama_t& scan);
+
+/* the testing suite */
+int test_scanorama()
+{
+	vector<Triangle3<float> > tris;
+	vector<camera_t*> cams;
+	scanorama_t serial, parallel;
+	string serial_points, parallel_points;
+	Vector3d cen(0.3, 0.2, 0.1);
+	size_t i;
+	int ret;
+
+	/* make the model */
+	room_mesh(tris);
+	BVH<float> bvh(tris);
+
+	/* trace the geometry with one thread and with many */
+	ret = serial.init_geometry(bvh, 1.0, cen, TEST_ROWS, TEST_COLS,
+				TEST_BLENDWIDTH, 1);
+	if(ret)
+		return PROPEGATE_ERROR(-1, ret);
+	ret = parallel.init_geometry(bvh, 1.0, cen, TEST_ROWS, TEST_COLS,
+				TEST_BLENDWIDTH, TEST_NUM_THREADS);
+	if(ret)
+		return PROPEGATE_ERROR(-2, ret);
+	serial_points = scanorama_points(serial);
+	parallel_points = scanorama_points(parallel);
+	if(serial_points != parallel_points)
+	{
+		cerr << "[test_scanorama]\tThe geometry traced with "
+		     << TEST_NUM_THREADS << " threads differs from the "
+		     << "geometry traced with one thread" << endl;
+		return -3;
+	}
+
+	/* color the points with one thread and with many, clearing
+	 * the cameras in between so that each run starts with empty
+	 * image caches */
+	for(i = 0; i < TEST_NUM_CAMERAS; i++)
+		cams.push_back(new test_camera_t(i));
+	ret = serial.apply(cams, 1);
+	for(i = 0; i < TEST_NUM_CAMERAS; i++)
+		cams[i]->clear();
+	if(ret == 0)
+		ret = parallel.apply(cams, TEST_NUM_THREADS);
+	for(i = 0; i < TEST_NUM_CAMERAS; i++)
+		delete cams[i];
+	if(ret)
+		return PROPEGATE_ERROR(-4, ret);
+	serial_points = scanorama_points(serial);
+	parallel_points = scanorama_points(parallel);
+	if(serial_points != parallel_points)
+	{
+		cerr << "[test_scanorama]\tThe colors applied with "
+		     << TEST_NUM_THREADS << " threads differ from the "
+		     << "colors applied with one thread" << endl;
+		return -5;
+	}
+
+	/* success */
+	return 0;
+}
+
+/* helper functions */
+
+void add_solid_box(vector<Triangle3<float> >& tris,
+                   const float* bmin, const float* bmax)
+{
+	float v[8][3];
+	size_t k, a;
+
+	/* the faces of the box, as indices into its corners, where bit
+	 * a of a corner's index is set if it is at the max along a */
+	const size_t faces[6][4] = { {0,2,6,4}, {1,5,7,3}, {0,4,5,1},
+	                             {2,3,7,6}, {0,1,3,2}, {4,6,7,5} };
+
+	/* make the corners */
+	for(k = 0; k < 8; k++)
+		for(a = 0; a < 3; a++)
+			v[k][a] = ((k >> a) & 1) ? bmax[a] : bmin[a];
+
+	/* split each face into two triangles */
+	for(k = 0; k < 6; k++)
+	{
+		tris.push_back(Triangle3<float>(v[faces[k][0]],
+			v[faces[k][1]], v[faces[k][2]], tris.size()));
+		tris.push_back(Triangle3<float>(v[faces[k][0]],
+			v[faces[k][2]], v[faces[k][3]], tris.size()));
+	}
+}
+
+void room_mesh(vector<Triangle3<float> >& tris)
+{
+	const float room_min[3]  = { -5.0f, -4.0f, -1.5f };
+	const float room_max[3]  = {  5.0f,  4.0f,  1.5f };
+	const float table_min[3] = {  1.0f,  1.0f, -1.5f };
+	const float table_max[3] = {  2.5f,  2.0f, -0.7f };
+	const float shelf_min[3] = { -4.8f, -3.0f, -1.5f };
+	const float shelf_max[3] = { -4.2f,  1.0f,  1.0f };
+	const float beam_min[3]  = { -5.0f, -0.2f,  1.1f };
+	const float beam_max[3]  = {  5.0f,  0.2f,  1.5f };
+
+	/* the walls of the room, and its furniture */
+	add_solid_box(tris, room_min, room_max);
+	add_solid_box(tris, table_min, table_max);
+	add_solid_box(tris, shelf_min, shelf_max);
+	add_solid_box(tris, beam_min, beam_max);
+}
+
+string scanorama_points(const scanorama_t& scan)
+{
+	stringstream ss;
+
+	/* export every point, with enough digits to tell them apart */
+	ss.precision(17);
+	scan.writeobj(ss);
+	return ss.str();
+}
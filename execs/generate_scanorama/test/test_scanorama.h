@@ -0,0 +1,22 @@
+#ifndef TEST_SCANORAMA_H
+#define TEST_SCANORAMA_H
+
+/**
+ * @file test_scanorama.h
+ * @author Eric Turner <elturner@eecs.berkeley.edu>
+ *
+ * @section DESCRIPTION
+ *
+ * Runs unit tests for the scanorama_t class, which check that tracing
+ * the geometry of a scanorama and coloring it with several cameras
+ * give the same points with one thread as with many.
+ */
+
+/**
+ * Runs the tests.
+ *
+ * @return   Returns zero if all pass, non-zero if failure occurs.
+ */
+int test_scanorama();
+
+#endif
@@ -253,7 +253,7 @@ int import_fp(const std::string& fpfile, octree_t& tree,
 
 		/* simplify tree, since inserting this room may
 		 * have carved additional nodes */
-		tree.get_root()->simplify_recur();
+		tree.simplify();
 	}
 
 	/* update number of rooms in building */
@@ -23,8 +23,9 @@
 #include <io/data/mcd/McdFile.h>
 #include <util/tictoc.h>
 #include <util/progress_bar.h>
-#include "accel_struct/Triangle3.h"
-#include "accel_struct/OctTree.h"
+#include <geometry/raytrace/Triangle3.h>
+#include <geometry/raytrace/BVH.h>
+#include <geometry/raytrace/BVHCache.h>
 
 /* namspaces */
 using namespace std;
@@ -72,12 +73,28 @@ namespace boost
 namespace DepthMaps
 {
 
+	/*
+	* The width of the square tiles of pixels that are traced
+	* together, so that each tile is one packet of rays
+	*/
+	const size_t TILE_SIZE = 4;
+
 	/*
 	* Copies the mesh into a Triangle3<float> vector
 	*/
-	bool copy_into_triangles(const mesh_io::mesh_t& mesh,
+	bool copy_into_triangles(const mesh_io::trimesh_t& mesh,
 		vector<Triangle3<float> >& triangle);
 
+	/*
+	* Reads the model and builds its BVH, or maps the BVH from the
+	* cache if the model has not changed since it was cached
+	*/
+	bool build_tree(const std::string& modelFile,
+		size_t leafSize,
+		const std::string& cacheDir,
+		bool rebuildCache,
+		BVH<float>& tree);
+
 	/*
 	* Handles the tracing for a set of input pairs
 	*/
@@ -86,7 +103,7 @@ namespace DepthMaps
 		const std::string& posefile,
 		const std::string& output,
 		const std::string& camTags,
-		const OctTree<float>& tree,
+		const BVH<float>& tree,
 		size_t numThreads,
 		double dsFactor);
 
@@ -132,7 +149,7 @@ namespace DepthMaps
 		double yaw);
 
 	/*
-		bool process_image(const OctTree<float>& tree,
+		bool process_image(const BVH<float>& tree,
 			Size2i imageSize,
 			const Matrix3f& invK,
 			Matrix3f Rcam2world,
@@ -142,7 +159,7 @@ namespace DepthMaps
 
 		Processes the image 
 	*/
-	void process_image(const OctTree<float>& tree,
+	void process_image(const BVH<float>& tree,
 		Size2i imageSize,
 		double dsFactor,
 		const Matrix3f& invK,
@@ -158,7 +175,9 @@ namespace DepthMaps
 /*
 	bool generate_depth_maps(const std::string& datasetDir,
 		const std::string& modelFile,
-		size_t octreeDepth,
+		size_t leafSize,
+		const std::string& cacheDir,
+		bool rebuildCache,
 		const std::vector<std::string> >& mcdFiles,
 		const std::vector<std::string> >& poseFiles,
 		const std::vector<std::string> >& outDirs,
@@ -168,21 +187,87 @@ namespace DepthMaps
 */
 bool DepthMaps::generate_depth_maps(const std::string& datasetDir,
 	const std::string& modelFile,
-	size_t octreeDepth,
+	size_t leafSize,
+	const std::string& cacheDir,
+	bool rebuildCache,
 	const std::vector<std::string>& mcdFiles,
 	const std::vector<std::string>& poseFiles,
 	const std::vector<std::string>& outDirs,
 	const std::vector<std::string>& cameraTags,
 	size_t numThreads,
 	double dsFactor)
+{
+	BVH<float> tree(leafSize);
+
+	/* the first thing we need to do is to get the BVH of the mesh */
+	if(!build_tree(modelFile, leafSize, cacheDir, rebuildCache, tree))
+		return false;
+
+	/* Then call the function that will do the algorithm for each of the */
+	/* input pairs */
+	for(size_t i = 0; i < mcdFiles.size(); i++)
+		if(!run_for_pair(datasetDir,
+			mcdFiles[i],
+			poseFiles[i],
+			outDirs[i],
+			cameraTags[i],
+			tree,
+			numThreads,
+			dsFactor))
+		{
+			cerr << "Error running generation for input pair #" << i << endl;
+			return false;
+		}
+
+	/* return success */
+	return true;
+}
+
+/*
+* Reads the model and builds its BVH, or maps the BVH from the
+* cache if the model has not changed since it was cached
+*/
+bool DepthMaps::build_tree(const std::string& modelFile,
+	size_t leafSize,
+	const std::string& cacheDir,
+	bool rebuildCache,
+	BVH<float>& tree)
 {
 	tictoc_t timer;
 	double elapedTime;
+	uint64_t hash, key;
 
-	/* the first thing we need to do is to import the mesh */
+	/* look for a cached index of this model, which is named by a
+	 * hash of the contents of the model file */
+	key = 0;
+	if(!cacheDir.empty())
+	{
+		cout << "====== Loading BVH ======" << endl;
+		tic(timer);
+		if(!BVHCache::hash_file(modelFile, hash))
+		{
+			cerr << "Unable to read mesh file : " << modelFile << endl;
+			return false;
+		}
+		key = BVHCache::make_key(hash, leafSize);
+		if(!rebuildCache && BVHCache::load(tree, cacheDir, key))
+		{
+			elapedTime = toc(timer, NULL);
+			cout << " Index      : "
+			     << BVHCache::index_file(cacheDir, key) << '\n'
+			     << " Tris       : " << tree.num_triangles() << '\n'
+			     << " Nodes      : " << tree.num_nodes() << '\n'
+			     << " Load Time  : " << elapedTime << " seconds"
+			     << endl << endl;
+			return true;
+		}
+		cout << " No valid index cached, building" << endl << endl;
+	}
+
+	/* import the mesh */
 	cout << "====== Reading Model ======" << endl;
 	tic(timer);
-	mesh_io::mesh_t mesh;
+	mesh_io::trimesh_t mesh;
 	if(mesh.read(modelFile))
 	{
 		cerr << "Unable to read mesh file : " << modelFile << endl;
@@ -192,14 +277,14 @@ bool DepthMaps::generate_depth_maps(const std::string& datasetDir,
 	{
 		elapedTime = toc(timer, NULL);
 		cout << " Verts      : " << mesh.num_verts() << '\n'
-			 << " Tris       : " << mesh.num_polys() << '\n'
+			 << " Tris       : " << mesh.num_tris() << '\n'
 			 << " Color      : " << (mesh.has_color() ? "true" : "false") << '\n'
 			 << " Texture    : " << "false" << '\n'
 			 << " Read Time  : " << elapedTime << " seconds" << endl << endl;
 	}
 
-	/* Then we need to build the OctTree */
-	cout << "====== Creating OctTree ======" << endl;
+	/* Then we need to build the BVH */
+	cout << "====== Creating BVH ======" << endl;
 	tic(timer);
 	vector<Triangle3<float> > triangles;
 	copy_into_triangles(mesh, triangles);
@@ -209,27 +294,17 @@ bool DepthMaps::generate_depth_maps(const std::string& datasetDir,
 		return false;
 	}
 
-	/* Then build the OctTree */
-	OctTree<float> tree(triangles, octreeDepth);
+	/* Then build the BVH */
+	tree.rebuild(triangles);
 	elapedTime = toc(timer, NULL);
-	cout << " Depth      : " << octreeDepth << '\n'
+	cout << " Leaf Size  : " << leafSize << '\n'
+	     << " Nodes      : " << tree.num_nodes() << '\n'
 	     << " Build Time : "  << elapedTime << " seconds " << endl << endl;
 
-	/* Then call the function that will do the algorithm for each of the */
-	/* input pairs */
-	for(size_t i = 0; i < mcdFiles.size(); i++)
-		if(!run_for_pair(datasetDir,
-			mcdFiles[i],
-			poseFiles[i],
-			outDirs[i],
-			cameraTags[i],
-			tree,
-			numThreads,
-			dsFactor))
-		{
-			cerr << "Error running generation for input pair #" << i << endl;
-			return false;
-		}
+	/* save the index for later runs, which is not fatal if it fails */
+	if(!cacheDir.empty() && !BVHCache::save(tree, cacheDir, key))
+		cerr << "Unable to cache BVH in : "
+		     << BVHCache::index_file(cacheDir, key) << endl;
 
 	/* return success */
 	return true;
@@ -238,26 +313,16 @@ bool DepthMaps::generate_depth_maps(const std::string& datasetDir,
 /*
 * Copies the mesh into a Triangle3<float> vector
 */
-bool DepthMaps::copy_into_triangles(const mesh_io::mesh_t& mesh,
+bool DepthMaps::copy_into_triangles(const mesh_io::trimesh_t& mesh,
 	vector<Triangle3<float> >& triangles)
 {
-	float v1[3];
-	float v2[3];
-	float v3[3];
-
 	/* loop over the triangles creating triangle */
-	for(size_t i = 0; i < mesh.num_polys(); i++)
+	triangles.reserve(triangles.size() + mesh.num_tris());
+	for(size_t i = 0; i < mesh.num_tris(); i++)
 	{
-		v1[0] = (float)(mesh.get_vert(mesh.get_poly(i).vertices[0]).x);
-		v1[1] = (float)(mesh.get_vert(mesh.get_poly(i).vertices[0]).y);
-		v1[2] = (float)(mesh.get_vert(mesh.get_poly(i).vertices[0]).z);
-		v2[0] = (float)(mesh.get_vert(mesh.get_poly(i).vertices[1]).x);
-		v2[1] = (float)(mesh.get_vert(mesh.get_poly(i).vertices[1]).y);
-		v2[2] = (float)(mesh.get_vert(mesh.get_poly(i).vertices[1]).z);
-		v3[0] = (float)(mesh.get_vert(mesh.get_poly(i).vertices[2]).x);
-		v3[1] = (float)(mesh.get_vert(mesh.get_poly(i).vertices[2]).y);
-		v3[2] = (float)(mesh.get_vert(mesh.get_poly(i).vertices[2]).z);
-		triangles.push_back(Triangle3<float>(v1, v2, v3, i));
+		const unsigned int* t = mesh.get_tri(i);
+		triangles.push_back(Triangle3<float>(mesh.get_vert(t[0]),
+			mesh.get_vert(t[1]), mesh.get_vert(t[2]), i));
 	}
 	return true;
 }
@@ -270,7 +335,7 @@ bool DepthMaps::run_for_pair(const std::string& datasetDir,
 	const std::string& posefile,
 	const std::string& outputDir,
 	const std::string& camTag,
-	const OctTree<float>& tree,
+	const BVH<float>& tree,
 	size_t numThreads,
 	double dsFactor)
 {
@@ -559,7 +624,7 @@ Matrix3f DepthMaps::rpy2rot(double roll,
 }
 
 /*
-	bool process_image(const OctTree<float>& tree,
+	bool process_image(const BVH<float>& tree,
 		Size2i imageSize,
 		const Matrix3f& invK,
 		Matrix3f Rcam2world,
@@ -569,7 +634,7 @@ Matrix3f DepthMaps::rpy2rot(double roll,
 
 	Processes the image 
 */
-void DepthMaps::process_image(const OctTree<float>& tree,
+void DepthMaps::process_image(const BVH<float>& tree,
 	Size2i imageSize,
 	double dsFactor,
 	const Matrix3f& invK,
@@ -583,59 +648,91 @@ void DepthMaps::process_image(const OctTree<float>& tree,
 	Mat depthMap(imageSize, CV_16UC1);
 	Mat normalMap(imageSize, CV_16UC3);
 
-	/* Then simply loop over the pixels creating the vectors and tracing */
-	/* the depth */
+	/* Then loop over the tiles of pixels, creating the vectors of */
+	/* each tile and tracing them together as a packet */
 	float o[3] = {Tcam2world(0), Tcam2world(1), Tcam2world(2)};
-	float d[3], inter[3];
+	float d[3];
 	float n[3];
+	float origins[3*TILE_SIZE*TILE_SIZE];
+	float directions[3*TILE_SIZE*TILE_SIZE];
+	float inters[3*TILE_SIZE*TILE_SIZE];
+	size_t triangleIds[TILE_SIZE*TILE_SIZE];
+	bool hits[TILE_SIZE*TILE_SIZE];
 	float depthVal;
-	size_t triangleId;
+	size_t ti, tj, i, j, k, numRays;
 	Map<Matrix<float,3,1> > direction(d);
 	Map<Matrix<float,3,1> > origin(o);
-	Map<Matrix<float,3,1> > intersection(inter);
 	Map<Matrix<float,3,1> > normal(n);
 	unsigned short maxNum = ((1<<16) - 1);
-	for(size_t i = 0; i < (size_t) imageSize.height; i++)
+	for(ti = 0; ti < (size_t) imageSize.height; ti += TILE_SIZE)
 	{
-		for(size_t j = 0; j < (size_t) imageSize.width; j++)
+		for(tj = 0; tj < (size_t) imageSize.width; tj += TILE_SIZE)
 		{
-			/* create the uv of the pixel */
-			direction << dsFactor*j, dsFactor*i, 1;
-			direction = invK*direction;
-			direction /= direction.norm();
-
-			/* convert direction to world coordinates */
-			direction = Rcam2world*direction;
+			/* create the directions of the pixels of this tile */
+			numRays = 0;
+			for(i = ti; i < min(ti + TILE_SIZE,
+					(size_t) imageSize.height); i++)
+				for(j = tj; j < min(tj + TILE_SIZE,
+						(size_t) imageSize.width); j++)
+				{
+					/* create the uv of the pixel */
+					direction << dsFactor*j, dsFactor*i, 1;
+					direction = invK*direction;
+					direction /= direction.norm();
+
+					/* convert direction to world coordinates */
+					direction = Rcam2world*direction;
+
+					for(k = 0; k < 3; k++)
+					{
+						origins[3*numRays+k] = o[k];
+						directions[3*numRays+k] = d[k];
+					}
+					numRays++;
+				}
 
 			/* do the ray trace */
-			if(!tree.ray_trace(o,d,inter,&triangleId))
-			{
-				depthVal = 0;
-				normal(0) = 0;
-				normal(1) = 0;
-				normal(2) = 0;
-			}
-			else
-			{
-				depthVal = (intersection-origin).norm();
-				normal(0) = tree.triangle(triangleId).normal(0);
-				normal(1) = tree.triangle(triangleId).normal(1);
-				normal(2) = tree.triangle(triangleId).normal(2);
-			}
-
-			/* store the depth val */
-			depthMap.at<unsigned short>(i,j) = (unsigned short)(depthVal*100.0);			
-
-			/* put it in camera coordinates */
-			normal = Rcam2world.transpose()*normal;
-
-			normalMap.at<Vec<unsigned short, 3> >(i,j)[0]
-				= (unsigned short)(((normal(0) + 1)/2.0)*maxNum);
-			normalMap.at<Vec<unsigned short, 3> >(i,j)[1]
-				= (unsigned short)(((normal(1) + 1)/2.0)*maxNum);
-			normalMap.at<Vec<unsigned short, 3> >(i,j)[2]
-				= (unsigned short)(((normal(2) + 1)/2.0)*maxNum);
-
+			tree.ray_trace_packet(numRays, origins, directions,
+				inters, triangleIds, hits);
+
+			/* store the results, in the same order */
+			numRays = 0;
+			for(i = ti; i < min(ti + TILE_SIZE,
+					(size_t) imageSize.height); i++)
+				for(j = tj; j < min(tj + TILE_SIZE,
+						(size_t) imageSize.width); j++)
+				{
+					Map<Matrix<float,3,1> > intersection(
+						inters + 3*numRays);
+					if(!hits[numRays])
+					{
+						depthVal = 0;
+						normal(0) = 0;
+						normal(1) = 0;
+						normal(2) = 0;
+					}
+					else
+					{
+						depthVal = (intersection-origin).norm();
+						normal(0) = tree.triangle(triangleIds[numRays]).normal(0);
+						normal(1) = tree.triangle(triangleIds[numRays]).normal(1);
+						normal(2) = tree.triangle(triangleIds[numRays]).normal(2);
+					}
+					numRays++;
+
+					/* store the depth val */
+					depthMap.at<unsigned short>(i,j) = (unsigned short)(depthVal*100.0);
+
+					/* put it in camera coordinates */
+					normal = Rcam2world.transpose()*normal;
+
+					normalMap.at<Vec<unsigned short, 3> >(i,j)[0]
+						= (unsigned short)(((normal(0) + 1)/2.0)*maxNum);
+					normalMap.at<Vec<unsigned short, 3> >(i,j)[1]
+						= (unsigned short)(((normal(1) + 1)/2.0)*maxNum);
+					normalMap.at<Vec<unsigned short, 3> >(i,j)[2]
+						= (unsigned short)(((normal(2) + 1)/2.0)*maxNum);
+				}
 		}
 	}
 
@@ -16,7 +16,9 @@ namespace DepthMaps
 	/*
 		bool generate_depth_maps(const std::string& datasetDir,
 			const std::string& modelFile,
-			size_t depth,
+			size_t leafSize,
+			const std::string& cacheDir,
+			bool rebuildCache,
 			const std::vector<std::string> >& mcdFiles,
 			const std::vector<std::string> >& poseFiles,
 			const std::vector<std::string> >& outDirs,
@@ -25,10 +27,18 @@ namespace DepthMaps
 			double dsFactor);
 
 		Main function for depth map generation.
+
+		The hierarchy of the model is cached in cacheDir, and is
+		mapped from the cache instead of being built when the
+		model has not changed.  If cacheDir is empty, the cache is
+		not used.  If rebuildCache is true, the cached index is
+		rebuilt and replaced.
 	*/
 	bool generate_depth_maps(const std::string& datasetDir,
 		const std::string& modelFile,
-		size_t depth,
+		size_t leafSize,
+		const std::string& cacheDir,
+		bool rebuildCache,
 		const std::vector<std::string>& mcdFiles,
 		const std::vector<std::string>& poseFiles,
 		const std::vector<std::string>& outDirs,
@@ -10,6 +10,7 @@
 #include <iostream>
 #include <string>
 #include <util/cmd_args.h>
+#include <geometry/raytrace/BVHCache.h>
 
 #include <boost/threadpool.hpp>
 
@@ -22,15 +23,20 @@ using namespace std;
 #define FLAG_DATASETDIR "-dir"
 #define FLAG_MODEL "-model"
 #define FLAG_SPEC "-i"
-#define FLAG_DEPTH "-depth"
+#define FLAG_LEAFSIZE "-leafsize"
 #define FLAG_NUMTHREADS "-threads"
 #define FLAG_DOWNSAMPLE "-ds"
+#define FLAG_CACHEDIR "-cachedir"
+#define FLAG_NOCACHE "-nocache"
+#define FLAG_REBUILDCACHE "-rebuildcache"
 
 /* main function */
 int main(int argc, char* argv[])
 {	
 	double dsFactor;
-	size_t octreeDepth;
+	string cacheDir;
+	bool rebuildCache;
+	size_t leafSize;
 	size_t numThreads;	
 	int ret;
 
@@ -53,10 +59,11 @@ int main(int argc, char* argv[])
 		"will be created.  The fourth is a camera name tag for the rectified "
 		"images.",
 		true, 4);
-	parser.add(FLAG_DEPTH,
-		"Specifies the depth of the OctTree used in ray tracing.  "
-		"If not specified, will set to value of 10.  This is a "
-		"trade-off between memory and processing time.",
+	parser.add(FLAG_LEAFSIZE,
+		"Specifies the maximum number of triangles in each leaf of the "
+		"bounding volume hierarchy used in ray tracing.  If not "
+		"specified, will set to value of 4.  This is a trade-off "
+		"between memory and processing time.",
 		true, 1);
 	parser.add(FLAG_NUMTHREADS,
 		"Specifies the number of threads used.",
@@ -65,6 +72,21 @@ int main(int argc, char* argv[])
 		"Specifies the downsampling factor that will be applied to the output "
 		"images.",
 		true, 1);
+	parser.add(FLAG_CACHEDIR,
+		"Specifies the directory where the index of the bounding volume "
+		"hierarchy is cached.  The index is named by a hash of the model "
+		"file, and is mapped into memory on later runs instead of being "
+		"rebuilt.  If not specified, the directory of the model file is "
+		"used.",
+		true, 1);
+	parser.add(FLAG_NOCACHE,
+		"If seen, the bounding volume hierarchy is built on every run, and "
+		"is not read from or saved to the cache.",
+		true, 0);
+	parser.add(FLAG_REBUILDCACHE,
+		"If seen, the bounding volume hierarchy is rebuilt from the model, "
+		"and its cached index is replaced.",
+		true, 0);
 
 	/* parse the arguments */
 	ret = parser.parse(argc, argv);
@@ -78,10 +100,10 @@ int main(int argc, char* argv[])
 	parser.tag_seen(FLAG_SPEC, inPairs);
 
 	/* look for optional flags */
-	if(parser.tag_seen(FLAG_DEPTH))
-		octreeDepth = parser.get_val_as<size_t>(FLAG_DEPTH);
+	if(parser.tag_seen(FLAG_LEAFSIZE))
+		leafSize = parser.get_val_as<size_t>(FLAG_LEAFSIZE);
 	else
-		octreeDepth = 10;
+		leafSize = 4;
 	if(parser.tag_seen(FLAG_NUMTHREADS))
 		numThreads = parser.get_val_as<size_t>(FLAG_NUMTHREADS);
 	else
@@ -90,6 +112,13 @@ int main(int argc, char* argv[])
 		dsFactor = parser.get_val_as<double>(FLAG_DOWNSAMPLE);
 	else
 		dsFactor = 1;
+	if(parser.tag_seen(FLAG_NOCACHE))
+		cacheDir = "";
+	else if(parser.tag_seen(FLAG_CACHEDIR))
+		cacheDir = parser.get_val(FLAG_CACHEDIR);
+	else
+		cacheDir = BVHCache::default_dir(modelFile);
+	rebuildCache = parser.tag_seen(FLAG_REBUILDCACHE);
 
 	/* check if any inputs are given */
 	if(inPairs.empty())
@@ -114,7 +143,9 @@ int main(int argc, char* argv[])
 	 /* run the depth map generation code */
 	if(!DepthMaps::generate_depth_maps(datasetDir,
 		modelFile,
-		octreeDepth,
+		leafSize,
+		cacheDir,
+		rebuildCache,
 		mcdFiles,
 		poseFiles,
 		outDirs,
@@ -0,0 +1,55 @@
+#include "test_bvh.h"
+#include "test_bvh_packets.h"
+#include "test_bvh_file.h"
+#include <iostream>
+
+/**
+ * @file main.cpp
+ * @author Eric Turner <elturner@eecs.berkeley.edu>
+ *
+ * @section DESCRIPTION
+ *
+ * This is the main file for the unit tests of the mesh2image program.
+ * Run it with 'make test' from the mesh2image directory.
+ */
+
+using namespace std;
+
+/**
+ * The main function for the unit tests
+ */
+int main()
+{
+	int ret;
+
+	/* run each test suite */
+	ret = test_bvh();
+	if(ret)
+	{
+		cerr << "[main]\ttest_bvh FAILED: Error "
+		     << ret << endl;
+		return 1;
+	}
+	cout << "[main]\ttest_bvh passed" << endl;
+
+	ret = test_bvh_packets();
+	if(ret)
+	{
+		cerr << "[main]\ttest_bvh_packets FAILED: Error "
+		     << ret << endl;
+		return 2;
+	}
+	cout << "[main]\ttest_bvh_packets passed" << endl;
+
+	ret = test_bvh_file();
+	if(ret)
+	{
+		cerr << "[main]\ttest_bvh_file FAILED: Error "
+		     << ret << endl;
+		return 3;
+	}
+	cout << "[main]\ttest_bvh_file passed" << endl;
+
+	/* success */
+	return 0;
+}
@@ -0,0 +1,247 @@
+#include "test_bvh.h"
+#include <geometry/raytrace/OctTree.h>
+#include <geometry/raytrace/BVH.h>
+#include <util/error_codes.h>
+#include <util/tictoc.h>
+#include <iostream>
+#include <stdlib.h>
+#include <cmath>
+#include <vector>
+
+/**
+ * @file test_bvh.cpp
+ * @author Eric Turner <elturner@eecs.berkeley.edu>
+ *
+ * @section DESCRIPTION
+ *
+ * Runs unit tests for the BVH<T> ray tracer, which check that it finds
+ * the same intersections as OctTree<T> on a building-like mesh, and
+ * report how many rays per second each structure can trace.
+ */
+
+using namespace std;
+
+/* the parameters of the test building, which is a grid of rooms
+ * with furniture, meshed as fine grids of triangles */
+#define TEST_ROOMS_PER_SIDE   5
+#define TEST_ROOM_WIDTH       4.0f
+#define TEST_ROOM_HEIGHT      3.0f
+#define TEST_CELL_SIZE        0.1f
+#define TEST_BOXES_PER_ROOM   4
+#define TEST_OCTREE_DEPTH     10
+
+/* the parameters of the traced rays */
+#define NUM_TEST_RAYS         100000
+#define TEST_DIST_TOLERANCE   1e-3f
+
+/* The old ray-triangle test is not watertight, so a few rays that
+ * pass through shared edges slip through the old mesh, and the
+ * structures may disagree on about one ray in ten thousand */
+#define MAX_MISMATCH_FRACTION 1e-3
+
+/* helper functions, which are shared with other tests */
+void add_box(vector<Triangle3<float> >& tris,
+             const float* bmin, const float* bmax);
+void building_mesh(vector<Triangle3<float> >& tris,
+                   vector<float>& origins);
+float rand_unit();
+
+/* the testing suite */
+int test_bvh()
+{
+	vector<Triangle3<float> > tris;
+	vector<float> origins, dirs;
+	float inter_a[3], inter_b[3];
+	size_t id_a, id_b;
+	bool hit_a, hit_b;
+	size_t i, k, num_hits, num_mismatched;
+	tictoc_t clk;
+	double t_build_oct, t_build_bvh, t_oct, t_bvh, norm;
+	float dist_a, dist_b;
+
+	/* seed for repeatable results */
+	srand(97531);
+
+	/* make the mesh and the rays, some of which start inside
+	 * the rooms, and some outside the building */
+	building_mesh(tris, origins);
+	dirs.resize(origins.size());
+	for(i = 0; i < NUM_TEST_RAYS; i++)
+	{
+		do
+		{
+			for(k = 0; k < 3; k++)
+				dirs[3*i+k] = 2*rand_unit() - 1;
+			norm = sqrt(dirs[3*i]*dirs[3*i]
+				+ dirs[3*i+1]*dirs[3*i+1]
+				+ dirs[3*i+2]*dirs[3*i+2]);
+		}
+		while(norm < 1e-3 || norm > 1);
+		for(k = 0; k < 3; k++)
+			dirs[3*i+k] /= norm;
+	}
+
+	/* build both structures */
+	tic(clk);
+	OctTree<float> octree(tris, TEST_OCTREE_DEPTH);
+	t_build_oct = toc(clk, NULL);
+	tic(clk);
+	BVH<float> bvh(tris);
+	t_build_bvh = toc(clk, NULL);
+
+	/* time tracing all rays with each structure */
+	num_hits = 0;
+	tic(clk);
+	for(i = 0; i < NUM_TEST_RAYS; i++)
+		num_hits += octree.ray_trace(&(origins[3*i]), &(dirs[3*i]),
+				inter_a, &id_a);
+	t_oct = toc(clk, NULL);
+	tic(clk);
+	for(i = 0; i < NUM_TEST_RAYS; i++)
+		num_hits += bvh.ray_trace(&(origins[3*i]), &(dirs[3*i]),
+				inter_b, &id_b);
+	t_bvh = toc(clk, NULL);
+
+	/* the structures should find the same intersections */
+	num_mismatched = 0;
+	for(i = 0; i < NUM_TEST_RAYS; i++)
+	{
+		hit_a = octree.ray_trace(&(origins[3*i]), &(dirs[3*i]),
+				inter_a, &id_a);
+		hit_b = bvh.ray_trace(&(origins[3*i]), &(dirs[3*i]),
+				inter_b, &id_b);
+		if(hit_a != hit_b)
+		{
+			num_mismatched++;
+			continue;
+		}
+		if(!hit_a)
+			continue;
+		dist_a = dist_b = 0;
+		for(k = 0; k < 3; k++)
+		{
+			dist_a += (inter_a[k] - origins[3*i+k])
+				* (inter_a[k] - origins[3*i+k]);
+			dist_b += (inter_b[k] - origins[3*i+k])
+				* (inter_b[k] - origins[3*i+k]);
+		}
+		if(fabs(sqrt(dist_a) - sqrt(dist_b)) > TEST_DIST_TOLERANCE
+				|| id_b >= tris.size())
+			num_mismatched++;
+	}
+	if(num_mismatched > MAX_MISMATCH_FRACTION * NUM_TEST_RAYS)
+	{
+		cerr << "[test_bvh]\t" << num_mismatched << " of "
+		     << NUM_TEST_RAYS << " rays had different intersections"
+		     << endl;
+		return -1;
+	}
+
+	/* report timing, which is not pass/fail */
+	cout << "[test_bvh]\t" << tris.size() << " triangles, "
+	     << NUM_TEST_RAYS << " rays, " << (num_hits/2) << " hits, "
+	     << num_mismatched << " mismatched:" << endl
+	     << "\tOctTree: " << (NUM_TEST_RAYS / t_oct) << " rays/sec, "
+	     << t_build_oct << " sec to build" << endl
+	     << "\tBVH:     " << (NUM_TEST_RAYS / t_bvh) << " rays/sec, "
+	     << t_build_bvh << " sec to build ("
+	     << (t_oct / t_bvh) << "x)" << endl;
+
+	/* success */
+	return 0;
+}
+
+/* helper functions */
+
+void add_box(vector<Triangle3<float> >& tris,
+             const float* bmin, const float* bmax)
+{
+	float v[4][3];
+	size_t a, u, w, i, j, nu, nw, side, k;
+	float du, dw;
+
+	/* each face of the box is a grid of quads, split into
+	 * two triangles each */
+	for(a = 0; a < 3; a++)
+		for(side = 0; side < 2; side++)
+		{
+			u = (a + 1) % 3;
+			w = (a + 2) % 3;
+			nu = (size_t) ceil((bmax[u] - bmin[u]) / TEST_CELL_SIZE);
+			nw = (size_t) ceil((bmax[w] - bmin[w]) / TEST_CELL_SIZE);
+			du = (bmax[u] - bmin[u]) / nu;
+			dw = (bmax[w] - bmin[w]) / nw;
+			for(i = 0; i < nu; i++)
+				for(j = 0; j < nw; j++)
+				{
+					for(k = 0; k < 4; k++)
+					{
+						v[k][a] = side ? bmax[a] : bmin[a];
+						v[k][u] = bmin[u] + du*(i + (k==1||k==2));
+						v[k][w] = bmin[w] + dw*(j + (k>=2));
+					}
+					tris.push_back(Triangle3<float>(v[0], v[1],
+						v[2], tris.size()));
+					tris.push_back(Triangle3<float>(v[0], v[2],
+						v[3], tris.size()));
+				}
+		}
+}
+
+void building_mesh(vector<Triangle3<float> >& tris,
+                   vector<float>& origins)
+{
+	float bmin[3], bmax[3], c[3], s[3];
+	size_t r, i, j, k, b;
+
+	/* make the rooms and their furniture */
+	for(i = 0; i < TEST_ROOMS_PER_SIDE; i++)
+		for(j = 0; j < TEST_ROOMS_PER_SIDE; j++)
+		{
+			bmin[0] = i * TEST_ROOM_WIDTH;
+			bmin[1] = j * TEST_ROOM_WIDTH;
+			bmin[2] = 0;
+			bmax[0] = bmin[0] + TEST_ROOM_WIDTH;
+			bmax[1] = bmin[1] + TEST_ROOM_WIDTH;
+			bmax[2] = TEST_ROOM_HEIGHT;
+			add_box(tris, bmin, bmax);
+			for(b = 0; b < TEST_BOXES_PER_ROOM; b++)
+			{
+				for(k = 0; k < 3; k++)
+				{
+					s[k] = 0.2f + rand_unit();
+					c[k] = (k < 2) ? bmin[k] + 0.5f
+						+ rand_unit()*(TEST_ROOM_WIDTH - 1)
+						: s[k] / 2;
+				}
+				for(k = 0; k < 3; k++)
+				{
+					s[k] = std::min(s[k], 1.0f);
+					bmin[k] = c[k] - s[k]/2;
+					bmax[k] = c[k] + s[k]/2;
+				}
+				add_box(tris, bmin, bmax);
+				bmin[0] = i * TEST_ROOM_WIDTH;
+				bmin[1] = j * TEST_ROOM_WIDTH;
+				bmin[2] = 0;
+			}
+		}
+
+	/* most rays start inside the rooms, the rest start outside
+	 * the building, so that some rays miss */
+	origins.resize(3*NUM_TEST_RAYS);
+	for(r = 0; r < NUM_TEST_RAYS; r++)
+	{
+		for(k = 0; k < 3; k++)
+			origins[3*r+k] = rand_unit() * ((k < 2)
+				? TEST_ROOMS_PER_SIDE*TEST_ROOM_WIDTH
+				: TEST_ROOM_HEIGHT);
+		if(r % 10 == 0)
+			origins[3*r+2] += 2*TEST_ROOM_HEIGHT;
+	}
+}
+
+float rand_unit()
+{
+	return rand() / (RAND_MAX + 1.0f);
+}
@@ -0,0 +1,22 @@
+#ifndef TEST_BVH_H
+#define TEST_BVH_H
+
+/**
+ * @file test_bvh.h
+ * @author Eric Turner <elturner@eecs.berkeley.edu>
+ *
+ * @section DESCRIPTION
+ *
+ * Runs unit tests for the BVH<T> ray tracer, which check that it finds
+ * the same intersections as OctTree<T> on a building-like mesh, and
+ * report how many rays per second each structure can trace.
+ */
+
+/**
+ * Runs the tests.
+ *
+ * @return   Returns zero if all pass, non-zero if failure occurs.
+ */
+int test_bvh();
+
+#endif
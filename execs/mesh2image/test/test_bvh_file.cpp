@@ -0,0 +1,312 @@
+#include "test_bvh_file.h"
+#include <geometry/raytrace/BVH.h>
+#include <geometry/raytrace/BVHCache.h>
+#include <util/error_codes.h>
+#include <iostream>
+#include <fstream>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include <set>
+
+/**
+ * @file test_bvh_file.cpp
+ * @author Eric Turner <elturner@eecs.berkeley.edu>
+ *
+ * @section DESCRIPTION
+ *
+ * Runs unit tests for the index files of BVH<float>, which check that
+ * a hierarchy loaded from a file traces rays exactly as the hierarchy
+ * it was saved from, and that damaged files are rejected.  Also checks
+ * that the cache of index files only returns an index for its key, and
+ * that files with small differences hash to different keys.
+ */
+
+using namespace std;
+
+/* test parameters */
+#define TEST_INDEX_FILE    "build/test_bvh_file.bvh"
+#define TEST_DAMAGED_FILE  "build/test_bvh_file_damaged.bvh"
+#define TEST_KEY           0x0123456789abcdefULL
+#define TEST_CACHE_DIR     "build"
+#define TEST_HASH_FILE     "build/test_bvh_file_hash.bin"
+#define NUM_HASH_WORDS     8
+#define MAX_HASH_SIZE      17
+#define NUM_TEST_BOXES     20
+#define NUM_TEST_RAYS      20000
+
+/* helper functions from test_bvh.cpp */
+void add_box(vector<Triangle3<float> >& tris,
+             const float* bmin, const float* bmax);
+float rand_unit();
+
+/* the individual tests */
+int test_hash_file();
+
+/* helper functions */
+bool same_traces(const BVH<float>& a, const BVH<float>& b,
+                 const vector<float>& origins, const vector<float>& dirs);
+bool damage_file(size_t offset, size_t size, bool truncate);
+bool hash_bytes(const vector<char>& buf, uint64_t& hash);
+
+/* the testing suite */
+int test_bvh_file()
+{
+	vector<Triangle3<float> > tris;
+	vector<float> origins, dirs;
+	float bmin[3], bmax[3];
+	uint64_t hash, damaged_hash, key;
+	size_t i, k, num_nodes;
+	int ret;
+
+	/* seed for repeatable results */
+	srand(13579);
+
+	/* make a mesh of random boxes, and random rays */
+	for(i = 0; i < NUM_TEST_BOXES; i++)
+	{
+		for(k = 0; k < 3; k++)
+		{
+			bmin[k] = 10*rand_unit();
+			bmax[k] = bmin[k] + 0.2f + rand_unit();
+		}
+		add_box(tris, bmin, bmax);
+	}
+	for(i = 0; i < 3*NUM_TEST_RAYS; i++)
+	{
+		origins.push_back(12*rand_unit() - 1);
+		dirs.push_back(2*rand_unit() - 1);
+	}
+
+	/* save a built hierarchy, and load it into another */
+	BVH<float> built(tris);
+	if(!built.save(TEST_INDEX_FILE, TEST_KEY))
+	{
+		cerr << "[test_bvh_file]\tUnable to save index" << endl;
+		return -1;
+	}
+	BVH<float>* loaded = new BVH<float>();
+	if(!loaded->load(TEST_INDEX_FILE) || loaded->key() != TEST_KEY
+			|| loaded->num_nodes() != built.num_nodes()
+			|| loaded->num_triangles() != built.num_triangles())
+	{
+		cerr << "[test_bvh_file]\tUnable to load index" << endl;
+		delete loaded;
+		return -2;
+	}
+
+	/* the loaded hierarchy, and a copy of it that outlives it,
+	 * should trace exactly as the built one */
+	BVH<float> copy(*loaded);
+	delete loaded;
+	if(!same_traces(built, copy, origins, dirs))
+	{
+		cerr << "[test_bvh_file]\tLoaded index traces differently"
+		     << endl;
+		return -3;
+	}
+
+	/* truncated files, and files whose root points outside
+	 * the tree, should be rejected without changing the tree */
+	num_nodes = copy.num_nodes();
+	if(!damage_file(0, 100, true) || copy.load(TEST_DAMAGED_FILE))
+	{
+		cerr << "[test_bvh_file]\tLoaded truncated index" << endl;
+		return -4;
+	}
+	if(!damage_file(64 + 6*sizeof(float), sizeof(unsigned int), false)
+			|| copy.load(TEST_DAMAGED_FILE))
+	{
+		cerr << "[test_bvh_file]\tLoaded damaged index" << endl;
+		return -5;
+	}
+	if(copy.num_nodes() != num_nodes
+			|| !same_traces(built, copy, origins, dirs))
+	{
+		cerr << "[test_bvh_file]\tFailed load changed the tree"
+		     << endl;
+		return -6;
+	}
+
+	/* a file's hash should depend on its contents, and the key
+	 * on the hash and the leaf size */
+	if(!BVHCache::hash_file(TEST_INDEX_FILE, hash)
+			|| !BVHCache::hash_file(TEST_DAMAGED_FILE, damaged_hash)
+			|| hash == damaged_hash
+			|| BVHCache::make_key(hash, 4)
+				== BVHCache::make_key(hash, 8))
+	{
+		cerr << "[test_bvh_file]\tCache keys collide" << endl;
+		return -7;
+	}
+
+	/* the cache should return the index saved under a key, and
+	 * no index for other keys, even if a file has its name */
+	key = BVHCache::make_key(hash, BVH<float>::DEFAULT_LEAF_SIZE);
+	if(!BVHCache::save(built, TEST_CACHE_DIR, key)
+			|| !BVHCache::load(copy, TEST_CACHE_DIR, key)
+			|| !same_traces(built, copy, origins, dirs)
+			|| BVHCache::load(copy, TEST_CACHE_DIR, key + 1)
+			|| rename(BVHCache::index_file(TEST_CACHE_DIR,
+				key).c_str(), BVHCache::index_file(
+				TEST_CACHE_DIR, key + 1).c_str())
+			|| BVHCache::load(copy, TEST_CACHE_DIR, key + 1)
+			|| copy.key() != key)
+	{
+		cerr << "[test_bvh_file]\tCache returned wrong index"
+		     << endl;
+		return -8;
+	}
+	remove(BVHCache::index_file(TEST_CACHE_DIR, key + 1).c_str());
+	remove(TEST_INDEX_FILE);
+	remove(TEST_DAMAGED_FILE);
+
+	/* files that are nearly the same should not collide */
+	ret = test_hash_file();
+	if(ret)
+		return PROPEGATE_ERROR(-9, ret);
+
+	/* success */
+	return 0;
+}
+
+/* the individual tests */
+
+int test_hash_file()
+{
+	vector<char> buf, changed;
+	set<uint64_t> hashes;
+	uint64_t hash;
+	size_t i, j, num_files;
+
+	/* the original file is random words */
+	buf.resize(NUM_HASH_WORDS * sizeof(uint64_t));
+	for(i = 0; i < buf.size(); i++)
+		buf[i] = (char) (rand() % 256);
+	if(!hash_bytes(buf, hash))
+		return -1;
+	hashes.insert(hash);
+	num_files = 1;
+
+	/* change each bit of the file on its own */
+	for(i = 0; i < 8*buf.size(); i++)
+	{
+		changed = buf;
+		changed[i / 8] ^= (char) (1 << (i % 8));
+		if(!hash_bytes(changed, hash))
+			return -2;
+		hashes.insert(hash);
+		num_files++;
+	}
+
+	/* change the top bit of two words at once.  If words are
+	 * mixed into the hash with a single multiply, the change only
+	 * reaches the top bit of the hash, and the two changes cancel */
+	for(i = 0; i < NUM_HASH_WORDS; i++)
+		for(j = i + 1; j < NUM_HASH_WORDS; j++)
+		{
+			changed = buf;
+			changed[8*i + 7] ^= (char) 0x80;
+			changed[8*j + 7] ^= (char) 0x80;
+			if(!hash_bytes(changed, hash))
+				return -3;
+			hashes.insert(hash);
+			num_files++;
+		}
+
+	/* files of zeros should differ by their size */
+	for(i = 1; i <= MAX_HASH_SIZE; i++)
+	{
+		changed.assign(i, 0);
+		if(!hash_bytes(changed, hash))
+			return -4;
+		hashes.insert(hash);
+		num_files++;
+	}
+
+	/* every file should have its own hash */
+	remove(TEST_HASH_FILE);
+	if(hashes.size() != num_files)
+	{
+		cerr << "[test_hash_file]\t" << (num_files - hashes.size())
+		     << " of " << num_files << " files have the same hash "
+		     << "as another file" << endl;
+		return -5;
+	}
+
+	/* success */
+	return 0;
+}
+
+/* helper functions */
+
+bool same_traces(const BVH<float>& a, const BVH<float>& b,
+                 const vector<float>& origins, const vector<float>& dirs)
+{
+	float inter_a[3], inter_b[3];
+	size_t i, id_a, id_b;
+	bool hit_a, hit_b;
+
+	/* every ray should hit the same triangle at the same point */
+	for(i = 0; i < origins.size()/3; i++)
+	{
+		hit_a = a.ray_trace(&(origins[3*i]), &(dirs[3*i]),
+				inter_a, &id_a);
+		hit_b = b.ray_trace(&(origins[3*i]), &(dirs[3*i]),
+				inter_b, &id_b);
+		if(hit_a != hit_b)
+			return false;
+		if(hit_a && (id_a != id_b
+				|| memcmp(inter_a, inter_b, sizeof(inter_a))
+				|| a.triangle(id_a).normal(0)
+					!= b.triangle(id_b).normal(0)))
+			return false;
+	}
+	return true;
+}
+
+bool damage_file(size_t offset, size_t size, bool truncate)
+{
+	ifstream infile;
+	ofstream outfile;
+	vector<char> buf;
+
+	/* read the saved index */
+	infile.open(TEST_INDEX_FILE, ios::in | ios::binary);
+	if(!(infile.is_open()))
+		return false;
+	buf.assign(istreambuf_iterator<char>(infile),
+	           istreambuf_iterator<char>());
+	infile.close();
+
+	/* either remove size bytes from the end of the file, or fill
+	 * the size bytes at the offset with ones */
+	if(offset + size > buf.size())
+		return false;
+	if(truncate)
+		buf.resize(buf.size() - size);
+	else
+		memset(&(buf[offset]), 0xff, size);
+
+	/* write the damaged copy */
+	outfile.open(TEST_DAMAGED_FILE, ios::out | ios::binary);
+	if(!(outfile.is_open()))
+		return false;
+	outfile.write(&(buf[0]), buf.size());
+	outfile.close();
+	return true;
+}
+
+bool hash_bytes(const vector<char>& buf, uint64_t& hash)
+{
+	ofstream outfile;
+
+	/* write the bytes to a file and hash it */
+	outfile.open(TEST_HASH_FILE, ios::out | ios::binary);
+	if(!(outfile.is_open()))
+		return false;
+	outfile.write(&(buf[0]), buf.size());
+	outfile.close();
+	return BVHCache::hash_file(TEST_HASH_FILE, hash);
+}
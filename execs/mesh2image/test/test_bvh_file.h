@@ -0,0 +1,23 @@
+#ifndef TEST_BVH_FILE_H
+#define TEST_BVH_FILE_H
+
+/**
+ * @file test_bvh_file.h
+ * @author Eric Turner <elturner@eecs.berkeley.edu>
+ *
+ * @section DESCRIPTION
+ *
+ * Runs unit tests for the index files of BVH<float>, which check that
+ * a hierarchy loaded from a file traces rays exactly as the hierarchy
+ * it was saved from, and that damaged files are rejected.  Also checks
+ * that the cache of index files only returns an index for its key.
+ */
+
+/**
+ * Runs the tests.
+ *
+ * @return   Returns zero if all pass, non-zero if failure occurs.
+ */
+int test_bvh_file();
+
+#endif
@@ -0,0 +1,203 @@
+#include "test_bvh_packets.h"
+#include <geometry/raytrace/BVH.h>
+#include <util/tictoc.h>
+#include <iostream>
+#include <stdlib.h>
+#include <string.h>
+#include <cmath>
+#include <vector>
+
+/**
+ * @file test_bvh_packets.cpp
+ * @author Eric Turner <elturner@eecs.berkeley.edu>
+ *
+ * @section DESCRIPTION
+ *
+ * Runs unit tests for the packet traversal of BVH<float>, which check
+ * that tracing the tiles of camera images in packets gives exactly the
+ * same results as tracing each pixel by itself, and report how many
+ * rays per second each method can trace.
+ */
+
+using namespace std;
+
+/* the rendered images, traced in square tiles of pixels */
+#define NUM_TEST_IMAGES     20
+#define TEST_IMAGE_WIDTH    160
+#define TEST_IMAGE_HEIGHT   120
+#define TEST_FOCAL_LENGTH   100.0f
+#define TEST_TILE_SIZE      4
+
+/* the number of rays in random directions, which make incoherent
+ * packets that are traced one ray at a time */
+#define NUM_RANDOM_RAYS     10000
+
+/* helper functions from test_bvh.cpp */
+void building_mesh(vector<Triangle3<float> >& tris,
+                   vector<float>& origins);
+float rand_unit();
+
+/* helper functions */
+void camera_rays(const float* cen, float yaw, float pitch,
+                 vector<float>& origins, vector<float>& dirs);
+bool same_results(size_t n, const bool* hits_a, const bool* hits_b,
+                  const size_t* ids_a, const size_t* ids_b,
+                  const float* inter_a, const float* inter_b);
+
+/* the testing suite */
+int test_bvh_packets()
+{
+	vector<Triangle3<float> > tris;
+	vector<float> cens, origins, dirs, inter_a, inter_b;
+	vector<size_t> ids_a, ids_b;
+	bool *hits_a, *hits_b;
+	size_t i, k, n, num_hits;
+	tictoc_t clk;
+	double t_scalar, t_packet, norm;
+
+	/* seed for repeatable results */
+	srand(24680);
+
+	/* make the mesh, and the rays of a set of camera images
+	 * placed at some of the test origins */
+	building_mesh(tris, cens);
+	BVH<float> bvh(tris);
+	for(i = 0; i < NUM_TEST_IMAGES; i++)
+		camera_rays(&(cens[3*i]), 2*M_PI*rand_unit(),
+				M_PI*(rand_unit() - 0.5f), origins, dirs);
+
+	/* add rays in random directions from random origins */
+	for(i = 0; i < NUM_RANDOM_RAYS; i++)
+	{
+		for(k = 0; k < 3; k++)
+			origins.push_back(cens[3*(NUM_TEST_IMAGES+i)+k]);
+		do
+		{
+			norm = 0;
+			for(k = 0; k < 3; k++)
+			{
+				dirs.push_back(2*rand_unit() - 1);
+				norm += dirs.back()*dirs.back();
+			}
+			if(norm < 1e-6 || norm > 1)
+				dirs.resize(dirs.size() - 3);
+		}
+		while(dirs.size() < origins.size());
+	}
+
+	/* trace all rays by each method */
+	n = origins.size() / 3;
+	inter_a.resize(3*n); inter_b.resize(3*n);
+	ids_a.resize(n); ids_b.resize(n);
+	hits_a = new bool[n];
+	hits_b = new bool[n];
+	num_hits = 0;
+	tic(clk);
+	for(i = 0; i < n; i++)
+		num_hits += hits_a[i] = bvh.ray_trace(&(origins[3*i]),
+				&(dirs[3*i]), &(inter_a[3*i]), &(ids_a[i]));
+	t_scalar = toc(clk, NULL);
+	tic(clk);
+	bvh.ray_trace_packet(n, &(origins[0]), &(dirs[0]),
+			&(inter_b[0]), &(ids_b[0]), hits_b);
+	t_packet = toc(clk, NULL);
+
+	/* the results should be identical */
+	if(!same_results(n, hits_a, hits_b, &(ids_a[0]), &(ids_b[0]),
+			&(inter_a[0]), &(inter_b[0])))
+	{
+		cerr << "[test_bvh_packets]\tPacket results differ from "
+		     << "single ray results" << endl;
+		delete[] hits_a; delete[] hits_b;
+		return -1;
+	}
+
+	/* a packet of fewer rays should give the same results */
+	for(i = 0; i < 2*BVHHelper::PACKET_SIZE; i += 3)
+	{
+		bvh.ray_trace_packet(i, &(origins[0]), &(dirs[0]),
+				&(inter_b[0]), &(ids_b[0]), hits_b);
+		if(!same_results(i, hits_a, hits_b, &(ids_a[0]),
+				&(ids_b[0]), &(inter_a[0]), &(inter_b[0])))
+		{
+			cerr << "[test_bvh_packets]\tPacket of " << i
+			     << " rays differs from single ray results"
+			     << endl;
+			delete[] hits_a; delete[] hits_b;
+			return -2;
+		}
+	}
+
+	/* report timing, which is not pass/fail */
+	cout << "[test_bvh_packets]\t" << tris.size() << " triangles, "
+	     << n << " rays, " << num_hits << " hits:" << endl
+	     << "\tSingle rays: " << (n / t_scalar) << " rays/sec" << endl
+	     << "\tPackets:     " << (n / t_packet) << " rays/sec ("
+	     << (t_scalar / t_packet) << "x)" << endl;
+
+	/* success */
+	delete[] hits_a;
+	delete[] hits_b;
+	return 0;
+}
+
+/* helper functions */
+
+void camera_rays(const float* cen, float yaw, float pitch,
+                 vector<float>& origins, vector<float>& dirs)
+{
+	float R[3][3], c[3], d[3], norm;
+	size_t ti, tj, i, j, k;
+
+	/* the rotation from camera to world coordinates, where the
+	 * camera looks along its z-axis */
+	R[0][0] = -sin(yaw); R[0][1] = -cos(yaw)*sin(pitch);
+	R[0][2] = cos(yaw)*cos(pitch);
+	R[1][0] = cos(yaw);  R[1][1] = -sin(yaw)*sin(pitch);
+	R[1][2] = sin(yaw)*cos(pitch);
+	R[2][0] = 0;         R[2][1] = cos(pitch);
+	R[2][2] = sin(pitch);
+
+	/* trace the image in tiles, as a renderer would */
+	for(ti = 0; ti < TEST_IMAGE_HEIGHT; ti += TEST_TILE_SIZE)
+		for(tj = 0; tj < TEST_IMAGE_WIDTH; tj += TEST_TILE_SIZE)
+			for(i = ti; i < ti + TEST_TILE_SIZE; i++)
+				for(j = tj; j < tj + TEST_TILE_SIZE; j++)
+				{
+					c[0] = (j - TEST_IMAGE_WIDTH/2.0f)
+						/ TEST_FOCAL_LENGTH;
+					c[1] = (i - TEST_IMAGE_HEIGHT/2.0f)
+						/ TEST_FOCAL_LENGTH;
+					c[2] = 1;
+					norm = sqrt(c[0]*c[0] + c[1]*c[1] + 1);
+					for(k = 0; k < 3; k++)
+						d[k] = (R[k][0]*c[0] + R[k][1]*c[1]
+							+ R[k][2]*c[2]) / norm;
+					for(k = 0; k < 3; k++)
+					{
+						origins.push_back(cen[k]);
+						dirs.push_back(d[k]);
+					}
+				}
+}
+
+bool same_results(size_t n, const bool* hits_a, const bool* hits_b,
+                  const size_t* ids_a, const size_t* ids_b,
+                  const float* inter_a, const float* inter_b)
+{
+	size_t i;
+
+	/* the intersections of rays that hit should match bit for bit */
+	for(i = 0; i < n; i++)
+	{
+		if(hits_a[i] != hits_b[i])
+			return false;
+		if(!hits_a[i])
+			continue;
+		if(ids_a[i] != ids_b[i]
+				|| memcmp(inter_a + 3*i, inter_b + 3*i,
+					3*sizeof(float)) != 0)
+			return false;
+	}
+	return true;
+}
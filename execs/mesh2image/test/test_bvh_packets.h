@@ -0,0 +1,23 @@
+#ifndef TEST_BVH_PACKETS_H
+#define TEST_BVH_PACKETS_H
+
+/**
+ * @file test_bvh_packets.h
+ * @author Eric Turner <elturner@eecs.berkeley.edu>
+ *
+ * @section DESCRIPTION
+ *
+ * Runs unit tests for the packet traversal of BVH<float>, which check
+ * that tracing the tiles of camera images in packets gives exactly the
+ * same results as tracing each pixel by itself, and report how many
+ * rays per second each method can trace.
+ */
+
+/**
+ * Runs the tests.
+ *
+ * @return   Returns zero if all pass, non-zero if failure occurs.
+ */
+int test_bvh_packets();
+
+#endif
@@ -0,0 +1,147 @@
+#include <iostream>
+#include <string>
+#include <geometry/octree/octree.h>
+#include <util/cmd_args.h>
+#include <util/tictoc.h>
+#include <Eigen/Dense>
+#include <chrono>
+#include <sys/stat.h>
+
+/**
+ * @file main.cpp
+ * @author Eric Turner <elturner@eecs.berkeley.edu>
+ * @brief  This program converts .oct files to the current file format
+ *
+ * @section DESCRIPTION
+ *
+ * Given an .oct file of any version, will write the same tree in the
+ * current version of the octfile format, which is split into blocks
+ * that can be parsed independently.  Optionally, only the part of the
+ * tree within a bounding box will be written, and the blocks can be
+ * compressed.  The rates at which the files are read and written are
+ * reported.
+ */
+
+using namespace std;
+using namespace Eigen;
+
+/* command-line flags */
+
+#define INPUT_OCTFILE_FLAG  "-i"
+#define OUTPUT_OCTFILE_FLAG "-o"
+#define BOUNDING_BOX_FLAG   "-b"
+#define COMPRESS_FLAG       "-c"
+
+/* function declarations */
+
+void report_rate(const string& fn, const string& label,
+                 const chrono::steady_clock::time_point& start);
+
+/* function implementations */
+
+int main(int argc, char** argv)
+{
+	cmd_args_t args;
+	octree_t tree;
+	Vector3d bmin, bmax;
+	chrono::steady_clock::time_point start;
+	tictoc_t clk;
+	unsigned int i;
+	int ret;
+
+	/* initialize the arguments for this program */
+	args.set_program_description("This program converts an octree "
+			"(.oct) file of any version to the current "
+			"version of the file format.");
+	args.add(INPUT_OCTFILE_FLAG, "The input octree (.oct) file to "
+			"convert.", false, 1);
+	args.add(OUTPUT_OCTFILE_FLAG, "Where to write the converted "
+			"octree (.oct) file.", false, 1);
+	args.add(BOUNDING_BOX_FLAG, "If specified, only the part of the "
+			"tree that intersects this box will be written.  "
+			"The box is given as:\n\n\t"
+			"<xmin> <ymin> <zmin> <xmax> <ymax> <zmax>\n\n"
+			"Nodes near the box may also be written, since the "
+			"tree is read in blocks.", true, 6);
+	args.add(COMPRESS_FLAG, "If specified, the blocks of the output "
+			"file will be compressed.  This makes the file "
+			"smaller, but slower to read and write.", true, 0);
+
+	/* retrieve arguments */
+	ret = args.parse(argc, argv);
+	if(ret)
+	{
+		/* error occurred */
+		cerr << "[main]\tCould not initialize from arguments: "
+		     << ret << endl;
+		return 1;
+	}
+
+	/* import the tree, or the part of it within the box */
+	tic(clk);
+	start = chrono::steady_clock::now();
+	if(args.tag_seen(BOUNDING_BOX_FLAG))
+	{
+		for(i = 0; i < 3; i++)
+		{
+			bmin(i) = args.get_val_as<double>(
+					BOUNDING_BOX_FLAG, i);
+			bmax(i) = args.get_val_as<double>(
+					BOUNDING_BOX_FLAG, i+3);
+		}
+		ret = tree.parse(args.get_val(INPUT_OCTFILE_FLAG),
+		                 bmin, bmax);
+	}
+	else
+		ret = tree.parse(args.get_val(INPUT_OCTFILE_FLAG));
+	if(ret)
+	{
+		cerr << "[main]\tError " << ret << ": "
+		     << "Unable to parse input tree: "
+		     << args.get_val(INPUT_OCTFILE_FLAG) << endl;
+		return 2;
+	}
+	toc(clk, "Importing octree");
+	report_rate(args.get_val(INPUT_OCTFILE_FLAG), "Read", start);
+
+	/* export the tree in the current format */
+	tic(clk);
+	start = chrono::steady_clock::now();
+	ret = tree.serialize(args.get_val(OUTPUT_OCTFILE_FLAG),
+	                     args.tag_seen(COMPRESS_FLAG));
+	if(ret)
+	{
+		cerr << "[main]\tError " << ret << ": "
+		     << "Unable to export tree to: "
+		     << args.get_val(OUTPUT_OCTFILE_FLAG) << endl;
+		return 3;
+	}
+	toc(clk, "Exporting octree");
+	report_rate(args.get_val(OUTPUT_OCTFILE_FLAG), "Wrote", start);
+
+	/* success */
+	return 0;
+}
+
+/**
+ * Prints the rate at which a file was read or written
+ *
+ * @param fn      The file that was read or written
+ * @param label   How to describe the operation
+ * @param start   When the operation started
+ */
+void report_rate(const string& fn, const string& label,
+                 const chrono::steady_clock::time_point& start)
+{
+	struct stat st;
+	double elapsed, mb;
+
+	/* get the elapsed wall-clock time and the size of the file */
+	elapsed = chrono::duration<double>(chrono::steady_clock::now()
+				- start).count();
+	mb = (stat(fn.c_str(), &st) == 0)
+			? (st.st_size / (1024.0 * 1024.0)) : 0;
+	cout << "[main]\t" << label << " " << mb << " MB in "
+	     << elapsed << " seconds ("
+	     << (mb / (elapsed > 0 ? elapsed : 1e-9)) << " MB/s)" << endl;
+}
@@ -143,7 +143,8 @@ int main(int argc, char** argv)
 						args.xml_settings);
 			else if(args.export_dense)
 				ret = tree_exporter::export_dense_mesh(
-						args.outfile, tree, scheme);
+						args.outfile, tree, scheme,
+						args.xml_settings);
 			else if(args.export_node_faces)
 				ret = tree_exporter::export_node_faces(
 					args.outfile, tree, scheme);
@@ -166,7 +167,8 @@ int main(int argc, char** argv)
 						args.xml_settings);
 			else if(args.export_dense)
 				ret = tree_exporter::export_dense_mesh(
-						args.outfile, tree, scheme);
+						args.outfile, tree, scheme,
+						args.xml_settings);
 			else if(args.export_node_faces)
 				ret = tree_exporter::export_node_faces(
 					args.outfile, tree, scheme);
@@ -0,0 +1,115 @@
+#include "test_octtopo.h"
+#include "test_planar_region_graph.h"
+#include "test_node_boundary.h"
+#include "test_boundary_keys.h"
+#include "test_region_mesher.h"
+#include "test_tiled_face_mesher.h"
+#include "test_mesh_io.h"
+#include "test_node_partitioner.h"
+#include "test_tree_passes.h"
+#include <iostream>
+
+/**
+ * @file main.cpp
+ * @author Eric Turner <elturner@eecs.berkeley.edu>
+ *
+ * @section DESCRIPTION
+ *
+ * This is the main file for the unit tests of the octsurf program.
+ * Run it with 'make test' from the octsurf directory.
+ */
+
+using namespace std;
+
+/**
+ * The main function for the unit tests
+ */
+int main()
+{
+	int ret;
+
+	/* run each test suite */
+	ret = test_octtopo();
+	if(ret)
+	{
+		cerr << "[main]\ttest_octtopo FAILED: Error "
+		     << ret << endl;
+		return 1;
+	}
+	cout << "[main]\ttest_octtopo passed" << endl;
+
+	ret = test_planar_region_graph();
+	if(ret)
+	{
+		cerr << "[main]\ttest_planar_region_graph FAILED: Error "
+		     << ret << endl;
+		return 2;
+	}
+	cout << "[main]\ttest_planar_region_graph passed" << endl;
+
+	ret = test_node_boundary();
+	if(ret)
+	{
+		cerr << "[main]\ttest_node_boundary FAILED: Error "
+		     << ret << endl;
+		return 3;
+	}
+	cout << "[main]\ttest_node_boundary passed" << endl;
+
+	ret = test_boundary_keys();
+	if(ret)
+	{
+		cerr << "[main]\ttest_boundary_keys FAILED: Error "
+		     << ret << endl;
+		return 4;
+	}
+	cout << "[main]\ttest_boundary_keys passed" << endl;
+
+	ret = test_region_mesher();
+	if(ret)
+	{
+		cerr << "[main]\ttest_region_mesher FAILED: Error "
+		     << ret << endl;
+		return 5;
+	}
+	cout << "[main]\ttest_region_mesher passed" << endl;
+
+	ret = test_tiled_face_mesher();
+	if(ret)
+	{
+		cerr << "[main]\ttest_tiled_face_mesher FAILED: Error "
+		     << ret << endl;
+		return 6;
+	}
+	cout << "[main]\ttest_tiled_face_mesher passed" << endl;
+
+	ret = test_mesh_io();
+	if(ret)
+	{
+		cerr << "[main]\ttest_mesh_io FAILED: Error "
+		     << ret << endl;
+		return 7;
+	}
+	cout << "[main]\ttest_mesh_io passed" << endl;
+
+	ret = test_node_partitioner();
+	if(ret)
+	{
+		cerr << "[main]\ttest_node_partitioner FAILED: Error "
+		     << ret << endl;
+		return 8;
+	}
+	cout << "[main]\ttest_node_partitioner passed" << endl;
+
+	ret = test_tree_passes();
+	if(ret)
+	{
+		cerr << "[main]\ttest_tree_passes FAILED: Error "
+		     << ret << endl;
+		return 9;
+	}
+	cout << "[main]\ttest_tree_passes passed" << endl;
+
+	/* success */
+	return 0;
+}
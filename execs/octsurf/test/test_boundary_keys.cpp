@@ -0,0 +1,257 @@
+#include "test_boundary_keys.h"
+#include <mesh/surface/node_boundary.h>
+#include <mesh/surface/node_corner.h>
+#include <mesh/surface/node_corner_map.h>
+#include <geometry/octree/octtopo.h>
+#include <geometry/octree/octree.h>
+#include <util/error_codes.h>
+#include <util/tictoc.h>
+#include <algorithm>
+#include <iostream>
+#include <iterator>
+#include <stdlib.h>
+#include <vector>
+#include <map>
+
+/**
+ * @file test_boundary_keys.cpp
+ * @author Eric Turner <elturner@eecs.berkeley.edu>
+ *
+ * @section DESCRIPTION
+ *
+ * Runs unit tests for the hashed face and corner look-ups of the
+ * node_boundary_t and node_corner::corner_map_t classes, which check
+ * that they agree with look-ups in ordered maps, and report how many
+ * look-ups per second each structure can perform.  Trees too large to
+ * index their corners should be rejected.
+ */
+
+using namespace std;
+using namespace node_corner;
+
+/* the parameters of the test */
+#define TEST_TREE_DEPTH    7
+#define NUM_LOOKUP_PASSES  20
+
+/* the individual tests */
+int test_face_lookups(const node_boundary_t& boundary);
+int test_corner_lookups(const corner_map_t& corner_map);
+int test_index_range();
+
+/* helper functions, which are shared with other tests */
+void random_tree(octree_t& tree, unsigned int depth);
+
+/* the testing suite */
+int test_boundary_keys()
+{
+	octree_t tree;
+	octtopo::octtopo_t topo;
+	node_boundary_t boundary;
+	corner_map_t corner_map;
+	int ret;
+
+	/* seed for repeatable results */
+	srand(1357);
+
+	/* compute the boundary and its corners */
+	random_tree(tree, TEST_TREE_DEPTH);
+	ret = topo.init(tree);
+	if(ret)
+		return PROPEGATE_ERROR(-1, ret);
+	ret = boundary.populate(topo);
+	if(ret)
+		return PROPEGATE_ERROR(-2, ret);
+	corner_map.add(tree, boundary);
+
+	/* compare look-ups against ordered maps */
+	ret = test_face_lookups(boundary);
+	if(ret)
+		return PROPEGATE_ERROR(-3, ret);
+	ret = test_corner_lookups(corner_map);
+	if(ret)
+		return PROPEGATE_ERROR(-4, ret);
+	ret = test_index_range();
+	if(ret)
+		return PROPEGATE_ERROR(-5, ret);
+
+	/* success */
+	return 0;
+}
+
+/* the individual tests */
+
+int test_face_lookups(const node_boundary_t& boundary)
+{
+	map<node_face_t, node_face_info_t> ordered;
+	map<node_face_t, node_face_info_t>::const_iterator oit;
+	facemap_t::const_iterator fit;
+	vector<node_face_t> faces;
+	tictoc_t clk;
+	double t_ordered, t_hashed;
+	size_t i, p, n, sum_ordered, sum_hashed;
+
+	/* store the faces in an ordered map, as a baseline */
+	for(fit = boundary.begin(); fit != boundary.end(); fit++)
+	{
+		ordered.insert(*fit);
+		faces.push_back(fit->first);
+	}
+	random_shuffle(faces.begin(), faces.end());
+	n = faces.size();
+
+	/* time look-ups in the ordered map */
+	sum_ordered = 0;
+	tic(clk);
+	for(p = 0; p < NUM_LOOKUP_PASSES; p++)
+		for(i = 0; i < n; i++)
+		{
+			oit = ordered.find(faces[i]);
+			sum_ordered += distance(oit->second.begin(),
+						oit->second.end());
+		}
+	t_ordered = toc(clk, NULL);
+
+	/* time look-ups in the boundary */
+	sum_hashed = 0;
+	tic(clk);
+	for(p = 0; p < NUM_LOOKUP_PASSES; p++)
+		for(i = 0; i < n; i++)
+		{
+			fit = boundary.find(faces[i]);
+			sum_hashed += distance(fit->second.begin(),
+						fit->second.end());
+		}
+	t_hashed = toc(clk, NULL);
+
+	/* every face should be found, with the same neighbors */
+	for(i = 0; i < n; i++)
+	{
+		fit = boundary.find(faces[i]);
+		if(fit == boundary.end() || fit->first != faces[i])
+		{
+			cerr << "[test_boundary_keys]\tUnable to find face #"
+			     << i << endl;
+			return -1;
+		}
+	}
+	if(sum_ordered != sum_hashed)
+	{
+		cerr << "[test_boundary_keys]\tMismatched neighbors" << endl;
+		return -2;
+	}
+	if(boundary.find(node_face_t()) != boundary.end())
+	{
+		cerr << "[test_boundary_keys]\tFound an invalid face" << endl;
+		return -3;
+	}
+
+	/* report timing, which is not pass/fail */
+	cout << "[test_boundary_keys]\t" << n << " faces:" << endl
+	     << "\tordered map: "
+	     << (NUM_LOOKUP_PASSES * n / t_ordered) << " look-ups/sec" << endl
+	     << "\thashed:      "
+	     << (NUM_LOOKUP_PASSES * n / t_hashed) << " look-ups/sec" << endl;
+
+	/* success */
+	return 0;
+}
+
+int test_corner_lookups(const corner_map_t& corner_map)
+{
+	ccmap_t ordered(corner_map.begin(), corner_map.end());
+	ccmap_t::const_iterator cit;
+	pair<faceset_t::const_iterator, faceset_t::const_iterator> range;
+	vector<corner_t> corners;
+	corner_t c;
+	tictoc_t clk;
+	double t_ordered, t_hashed;
+	size_t i, p, n, sum_ordered, sum_hashed;
+
+	/* the keys should sort the same way as the corners */
+	for(cit = ordered.begin(); cit != ordered.end(); cit++)
+	{
+		c.set_indices(cit->first.x_ind(), cit->first.y_ind(),
+				cit->first.z_ind());
+		if(c != cit->first || (!corners.empty()
+				&& !(corners.back().get_key() < c.get_key())))
+		{
+			cerr << "[test_boundary_keys]\tMismatched corner key"
+			     << endl;
+			return -1;
+		}
+		corners.push_back(c);
+	}
+	random_shuffle(corners.begin(), corners.end());
+	n = corners.size();
+
+	/* time look-ups in the ordered map */
+	sum_ordered = 0;
+	tic(clk);
+	for(p = 0; p < NUM_LOOKUP_PASSES; p++)
+		for(i = 0; i < n; i++)
+		{
+			cit = ordered.find(corners[i]);
+			sum_ordered += cit->second.num_faces();
+		}
+	t_ordered = toc(clk, NULL);
+
+	/* time look-ups in the corner map */
+	sum_hashed = 0;
+	tic(clk);
+	for(p = 0; p < NUM_LOOKUP_PASSES; p++)
+		for(i = 0; i < n; i++)
+		{
+			range = corner_map.get_faces_for(corners[i]);
+			sum_hashed += distance(range.first, range.second);
+		}
+	t_hashed = toc(clk, NULL);
+
+	/* every corner should have been found with the same faces */
+	if(sum_ordered != sum_hashed)
+	{
+		cerr << "[test_boundary_keys]\tMismatched corner faces"
+		     << endl;
+		return -2;
+	}
+
+	/* report timing, which is not pass/fail */
+	cout << "[test_boundary_keys]\t" << n << " corners:" << endl
+	     << "\tordered map: "
+	     << (NUM_LOOKUP_PASSES * n / t_ordered) << " look-ups/sec" << endl
+	     << "\thashed:      "
+	     << (NUM_LOOKUP_PASSES * n / t_hashed) << " look-ups/sec" << endl;
+
+	/* success */
+	return 0;
+}
+
+int test_index_range()
+{
+	octree_t tree;
+	corner_map_t corner_map;
+	double hw;
+
+	/* the root of this tree is half of CORNER_INDEX_BIAS
+	 * half-resolutions from its center to its faces */
+	hw = 0.25 * corner_t::CORNER_INDEX_BIAS;
+	tree.set(Eigen::Vector3d::Zero(), hw, 1.0);
+	if(!(corner_t::fits(tree)))
+	{
+		cerr << "[test_boundary_keys]\tRejected a tree whose "
+		     << "corners can be indexed" << endl;
+		return -1;
+	}
+
+	/* doubling its size reaches CORNER_INDEX_BIAS, so its
+	 * largest corners could not be stored */
+	tree.set(Eigen::Vector3d::Zero(), 2*hw, 1.0);
+	if(corner_t::fits(tree) || !(corner_map.populate_edges(tree)))
+	{
+		cerr << "[test_boundary_keys]\tAccepted a tree whose "
+		     << "corners cannot be indexed" << endl;
+		return -2;
+	}
+
+	/* success */
+	return 0;
+}
@@ -0,0 +1,23 @@
+#ifndef TEST_BOUNDARY_KEYS_H
+#define TEST_BOUNDARY_KEYS_H
+
+/**
+ * @file test_boundary_keys.h
+ * @author Eric Turner <elturner@eecs.berkeley.edu>
+ *
+ * @section DESCRIPTION
+ *
+ * Runs unit tests for the hashed face and corner look-ups of the
+ * node_boundary_t and node_corner::corner_map_t classes, which check
+ * that they agree with look-ups in ordered maps, and report how many
+ * look-ups per second each structure can perform.
+ */
+
+/**
+ * Runs the tests.
+ *
+ * @return   Returns zero if all pass, non-zero if failure occurs.
+ */
+int test_boundary_keys();
+
+#endif
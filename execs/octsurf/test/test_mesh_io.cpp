@@ -0,0 +1,187 @@
+#include "test_mesh_io.h"
+#include <io/mesh/mesh_io.h>
+#include <util/error_codes.h>
+#include <util/tictoc.h>
+#include <iostream>
+#include <string>
+#include <stdlib.h>
+#include <stdio.h>
+
+/**
+ * @file test_mesh_io.cpp
+ * @author Eric Turner <elturner@eecs.berkeley.edu>
+ *
+ * @section DESCRIPTION
+ *
+ * Runs unit tests for the mesh_io::trimesh_t class, which check that
+ * it reads and writes the same PLY and OBJ files as mesh_io::mesh_t,
+ * and report how long each class takes to load and save a large mesh.
+ */
+
+using namespace std;
+using namespace mesh_io;
+
+/* the parameters of the test */
+#define TEST_GRID_WIDTH    708 /* about one million triangles */
+#define TEST_MESH_FILE     "build/test_mesh_io"
+
+/* the individual tests */
+int test_format(const trimesh_t& trimesh, const string& suffix,
+                bool exact);
+
+/* helper functions */
+void random_trimesh(trimesh_t& trimesh, size_t width);
+bool same_mesh(const trimesh_t& trimesh, const mesh_t& mesh);
+
+/* helper functions, which are shared with other tests */
+bool same_file(const string& a, const string& b);
+
+/* the testing suite */
+int test_mesh_io()
+{
+	trimesh_t trimesh;
+	int ret;
+
+	/* seed for repeatable results */
+	srand(2468);
+	random_trimesh(trimesh, TEST_GRID_WIDTH);
+
+	/* test each of the fast formats */
+	ret = test_format(trimesh, ".ply", true);
+	if(ret)
+		return PROPEGATE_ERROR(-1, ret);
+	ret = test_format(trimesh, ".obj", false);
+	if(ret)
+		return PROPEGATE_ERROR(-2, ret);
+
+	/* success */
+	return 0;
+}
+
+/* the individual tests */
+
+/* binary files store the mesh exactly, but text files
+ * round the positions, so only binary files are checked
+ * against the original mesh */
+int test_format(const trimesh_t& trimesh, const string& suffix,
+                bool exact)
+{
+	trimesh_t fast;
+	mesh_t mesh, generic;
+	string fast_file, generic_file;
+	tictoc_t clk;
+	double t_fast_write, t_generic_write, t_fast_read, t_generic_read;
+	int ret;
+
+	/* write the mesh both ways */
+	fast_file = TEST_MESH_FILE "_fast" + suffix;
+	generic_file = TEST_MESH_FILE "_generic" + suffix;
+	trimesh.get(mesh);
+	tic(clk);
+	ret = trimesh.write(fast_file);
+	t_fast_write = toc(clk, NULL);
+	if(ret)
+		return PROPEGATE_ERROR(-1, ret);
+	tic(clk);
+	ret = mesh.write(generic_file);
+	t_generic_write = toc(clk, NULL);
+	if(ret)
+		return PROPEGATE_ERROR(-2, ret);
+	if(!same_file(fast_file, generic_file))
+	{
+		cerr << "[test_mesh_io]\tMismatched " << suffix << " files"
+		     << endl;
+		return -3;
+	}
+
+	/* read the mesh both ways */
+	tic(clk);
+	ret = fast.read(fast_file);
+	t_fast_read = toc(clk, NULL);
+	if(ret)
+		return PROPEGATE_ERROR(-4, ret);
+	tic(clk);
+	ret = generic.read(generic_file);
+	t_generic_read = toc(clk, NULL);
+	if(ret)
+		return PROPEGATE_ERROR(-5, ret);
+	if(!same_mesh(fast, generic) || !fast.has_color()
+			|| (exact && !same_mesh(trimesh, generic)))
+	{
+		cerr << "[test_mesh_io]\tMismatched " << suffix << " meshes"
+		     << endl;
+		return -6;
+	}
+
+	/* report timing, which is not pass/fail */
+	cout << "[test_mesh_io]\t" << suffix << " file with "
+	     << trimesh.num_tris() << " triangles:" << endl
+	     << "\tmesh_t:    read " << t_generic_read << " sec, write "
+	     << t_generic_write << " sec" << endl
+	     << "\ttrimesh_t: read " << t_fast_read << " sec, write "
+	     << t_fast_write << " sec" << endl;
+
+	/* success */
+	remove(fast_file.c_str());
+	remove(generic_file.c_str());
+	return 0;
+}
+
+/* helper functions */
+
+void random_trimesh(trimesh_t& trimesh, size_t width)
+{
+	size_t i, j, v;
+
+	/* make a height field over a grid, with random colors */
+	trimesh.clear();
+	trimesh.reserve(width*width, 2*(width-1)*(width-1));
+	for(i = 0; i < width; i++)
+		for(j = 0; j < width; j++)
+			trimesh.add_vert(0.01f*i, 0.01f*j,
+					0.001f*(rand() % 1000),
+					rand() % 256, rand() % 256,
+					rand() % 256);
+
+	/* split each cell of the grid into two triangles */
+	for(i = 0; i + 1 < width; i++)
+		for(j = 0; j + 1 < width; j++)
+		{
+			v = i*width + j;
+			trimesh.add_tri(v, v + width, v + 1);
+			trimesh.add_tri(v + 1, v + width, v + width + 1);
+		}
+	trimesh.set_color(true);
+}
+
+bool same_mesh(const trimesh_t& trimesh, const mesh_t& mesh)
+{
+	size_t i, j;
+
+	/* check sizes */
+	if(trimesh.num_verts() != mesh.num_verts()
+			|| trimesh.num_tris() != mesh.num_polys())
+		return false;
+
+	/* check vertices, which are stored in single precision */
+	for(i = 0; i < trimesh.num_verts(); i++)
+		if(trimesh.get_vert(i)[0] != (float) mesh.get_vert(i).x
+			|| trimesh.get_vert(i)[1] != (float) mesh.get_vert(i).y
+			|| trimesh.get_vert(i)[2] != (float) mesh.get_vert(i).z
+			|| trimesh.get_color(i)[0] != mesh.get_vert(i).red
+			|| trimesh.get_color(i)[1] != mesh.get_vert(i).green
+			|| trimesh.get_color(i)[2] != mesh.get_vert(i).blue)
+			return false;
+
+	/* check triangles */
+	for(i = 0; i < trimesh.num_tris(); i++)
+	{
+		if(mesh.get_poly(i).vertices.size() != 3)
+			return false;
+		for(j = 0; j < 3; j++)
+			if(trimesh.get_tri(i)[j] 
+					!= mesh.get_poly(i).vertices[j])
+				return false;
+	}
+	return true;
+}
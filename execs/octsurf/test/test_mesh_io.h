@@ -0,0 +1,22 @@
+#ifndef TEST_MESH_IO_H
+#define TEST_MESH_IO_H
+
+/**
+ * @file test_mesh_io.h
+ * @author Eric Turner <elturner@eecs.berkeley.edu>
+ *
+ * @section DESCRIPTION
+ *
+ * Runs unit tests for the mesh_io::trimesh_t class, which check that
+ * it reads and writes the same PLY and OBJ files as mesh_io::mesh_t,
+ * and report how long each class takes to load and save a large mesh.
+ */
+
+/**
+ * Runs the tests.
+ *
+ * @return   Returns zero if all pass, non-zero if failure occurs.
+ */
+int test_mesh_io();
+
+#endif
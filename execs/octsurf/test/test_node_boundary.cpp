@@ -0,0 +1,358 @@
+#include "test_node_boundary.h"
+#include <mesh/surface/node_boundary.h>
+#include <mesh/surface/node_boundary_stream.h>
+#include <mesh/surface/planar_region_graph.h>
+#include <mesh/surface/node_corner_map.h>
+#include <geometry/octree/octtopo.h>
+#include <geometry/octree/octree.h>
+#include <util/error_codes.h>
+#include <util/tictoc.h>
+#include <algorithm>
+#include <iostream>
+#include <fstream>
+#include <iterator>
+#include <stdlib.h>
+#include <vector>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+
+/**
+ * @file test_node_boundary.cpp
+ * @author Eric Turner <elturner@eecs.berkeley.edu>
+ *
+ * @section DESCRIPTION
+ *
+ * Runs unit tests for the node_boundary_stream_t class, which check
+ * that streaming boundary faces through a spill file gives the same
+ * faces, linkages, and planar regions as the in-memory boundary.  The
+ * peak memory of forming corners and regions both ways is reported.
+ */
+
+using namespace std;
+using namespace octtopo;
+
+/* the parameters of the test */
+#define TEST_TREE_DEPTH    7
+#define TEST_BUFFER_SIZE   16384 /* bytes, so that there are many tiles */
+#define NUM_TEST_THREADS   4
+#define TEST_SPILL_FILE    "build/test_node_boundary.faces"
+
+/* the memory test uses a larger tree, so that the boundary is
+ * large compared to the rest of the process */
+#define MEMORY_TREE_DEPTH  8
+#define MEMORY_BUFFER_SIZE 1048576 /* bytes */
+#define MEMORY_SPILL_FILE  "build/test_node_boundary_memory.faces"
+
+/* the individual tests */
+int test_faces(const node_boundary_t& boundary,
+               const node_boundary_stream_t& stream);
+int test_regions(const node_boundary_t& boundary,
+                 const node_boundary_stream_t& stream);
+int test_memory();
+
+/* helper functions, which are shared with other tests */
+void random_tree(octree_t& tree, unsigned int depth);
+
+/* helper functions */
+int form_regions(const octree_t& tree, const octtopo_t& topo,
+                 bool streamed);
+int current_memory(long& kb);
+int peak_memory(const octree_t& tree, const octtopo_t& topo,
+                bool streamed, long& kb);
+
+/* the testing suite */
+int test_node_boundary()
+{
+	octree_t tree;
+	octtopo_t topo;
+	node_boundary_t boundary;
+	node_boundary_stream_t stream;
+	tictoc_t clk;
+	double t_memory, t_stream;
+	int ret;
+
+	/* seed for repeatable results */
+	srand(1234);
+
+	/* compute the boundary both ways */
+	random_tree(tree, TEST_TREE_DEPTH);
+	ret = topo.init(tree);
+	if(ret)
+		return PROPEGATE_ERROR(-1, ret);
+	tic(clk);
+	ret = boundary.populate(topo);
+	t_memory = toc(clk, NULL);
+	if(ret)
+		return PROPEGATE_ERROR(-2, ret);
+	tic(clk);
+	ret = stream.populate(topo, TEST_SPILL_FILE, TEST_BUFFER_SIZE,
+			node_boundary_t::SEG_ALL, NUM_TEST_THREADS);
+	t_stream = toc(clk, NULL);
+	if(ret)
+		return PROPEGATE_ERROR(-3, ret);
+
+	/* compare the results */
+	ret = test_faces(boundary, stream);
+	if(ret)
+		return PROPEGATE_ERROR(-4, ret);
+	ret = test_regions(boundary, stream);
+	if(ret)
+		return PROPEGATE_ERROR(-5, ret);
+
+	/* report timing, which is not pass/fail */
+	cout << "[test_node_boundary]\t" << stream.size() << " faces:"
+	     << endl
+	     << "\tin memory: " << t_memory << " sec" << endl
+	     << "\tstreamed:  " << t_stream << " sec" << endl;
+
+	/* compare memory on a larger tree */
+	stream.clear();
+	boundary.clear();
+	ret = test_memory();
+	if(ret)
+		return PROPEGATE_ERROR(-6, ret);
+
+	/* success */
+	return 0;
+}
+
+/* the individual tests */
+
+int test_faces(const node_boundary_t& boundary,
+               const node_boundary_stream_t& stream)
+{
+	node_boundary_reader_t reader;
+	facemap_t::const_iterator fit;
+	pair<facelist_t::const_iterator, facelist_t::const_iterator> range;
+	faceset_t faces;
+	node_face_info_t info;
+	node_face_t face;
+	vector<size_t> neighs;
+	size_t id, found_id;
+	int ret;
+
+	/* the streamed faces should be the same set of faces */
+	for(fit = boundary.begin(); fit != boundary.end(); fit++)
+		faces.insert(fit->first);
+	if(faces.size() != stream.size())
+	{
+		cerr << "[test_node_boundary]\tBoundary has " << faces.size()
+		     << " faces, stream has " << stream.size() << endl;
+		return -1;
+	}
+
+	/* each face should have the same neighbors */
+	ret = reader.open(stream);
+	if(ret)
+		return PROPEGATE_ERROR(-2, ret);
+	while(!(reader.eof()))
+	{
+		ret = reader.next(id, face, neighs);
+		if(ret)
+			return PROPEGATE_ERROR(-3, ret);
+		if(!(faces.count(face)))
+		{
+			cerr << "[test_node_boundary]\tStreamed face #" << id
+			     << " is not a boundary face" << endl;
+			return -4;
+		}
+		ret = stream.find_face(face, found_id);
+		if(ret || found_id != id)
+		{
+			cerr << "[test_node_boundary]\tUnable to find face #"
+			     << id << endl;
+			return -5;
+		}
+
+		/* compare the neighbors */
+		ret = stream.get_info(neighs, info);
+		if(ret)
+			return PROPEGATE_ERROR(-6, ret);
+		range = boundary.get_neighbors(face);
+		if(neighs.size() != (size_t) distance(range.first,
+						range.second)
+				|| !equal(range.first, range.second,
+						info.begin()))
+		{
+			cerr << "[test_node_boundary]\tMismatched neighbors "
+			     << "for face #" << id << endl;
+			return -7;
+		}
+	}
+
+	/* success */
+	reader.close();
+	return 0;
+}
+
+int test_regions(const node_boundary_t& boundary,
+                 const node_boundary_stream_t& stream)
+{
+	planar_region_graph_t memory_graph, stream_graph;
+	regionmap_t::const_iterator rit, sit;
+	int ret;
+
+	/* form regions both ways */
+	memory_graph.init(0.0, 2.0, false);
+	stream_graph.init(0.0, 2.0, false);
+	ret = memory_graph.populate(boundary);
+	if(ret)
+		return PROPEGATE_ERROR(-1, ret);
+	ret = stream_graph.populate(stream);
+	if(ret)
+		return PROPEGATE_ERROR(-2, ret);
+
+	/* the regions should have the same seeds and faces */
+	if(memory_graph.size() != stream_graph.size())
+	{
+		cerr << "[test_node_boundary]\tIn-memory boundary has "
+		     << memory_graph.size() << " regions, stream has "
+		     << stream_graph.size() << endl;
+		return -3;
+	}
+	for(rit = memory_graph.begin(), sit = stream_graph.begin();
+			rit != memory_graph.end(); rit++, sit++)
+		if(rit->first != sit->first
+				|| rit->second.get_region().num_faces()
+				!= sit->second.get_region().num_faces()
+				|| !equal(rit->second.get_region().begin(),
+					rit->second.get_region().end(),
+					sit->second.get_region().begin())
+				|| distance(rit->second.begin_neighs(),
+					rit->second.end_neighs())
+				!= distance(sit->second.begin_neighs(),
+					sit->second.end_neighs()))
+		{
+			cerr << "[test_node_boundary]\tMismatched regions"
+			     << endl;
+			return -4;
+		}
+
+	/* success */
+	cout << "[test_node_boundary]\t" << stream_graph.size()
+	     << " regions" << endl;
+	return 0;
+}
+
+int test_memory()
+{
+	octree_t tree;
+	octtopo_t topo;
+	long start_kb, memory_kb, stream_kb;
+	int ret;
+
+	/* build a tree whose boundary takes up much of the memory */
+	random_tree(tree, MEMORY_TREE_DEPTH);
+	ret = topo.init(tree);
+	if(ret)
+		return PROPEGATE_ERROR(-1, ret);
+
+	/* form corners and regions both ways, measuring how far the
+	 * memory of each grows from what this process uses now */
+	ret = current_memory(start_kb);
+	if(ret)
+		return PROPEGATE_ERROR(-2, ret);
+	ret = peak_memory(tree, topo, false, memory_kb);
+	if(ret)
+		return PROPEGATE_ERROR(-3, ret);
+	ret = peak_memory(tree, topo, true, stream_kb);
+	if(ret)
+		return PROPEGATE_ERROR(-4, ret);
+
+	/* report the peaks, which are not pass/fail, since they
+	 * depend on the allocator as much as on the boundary */
+	cout << "[test_node_boundary]\tpeak RSS growth forming regions:"
+	     << endl
+	     << "\tin memory: " << ((memory_kb - start_kb) / 1024.0)
+	     << " MB" << endl
+	     << "\tstreamed:  " << ((stream_kb - start_kb) / 1024.0)
+	     << " MB" << endl;
+
+	/* success */
+	return 0;
+}
+
+/* helper functions */
+
+int form_regions(const octree_t& tree, const octtopo_t& topo,
+                 bool streamed)
+{
+	node_boundary_t boundary;
+	node_boundary_stream_t stream;
+	node_corner::corner_map_t corner_map;
+	planar_region_graph_t region_graph;
+	int ret;
+
+	/* this follows tree_exporter::export_planar_mesh(), which
+	 * keeps the boundary until the regions are meshed */
+	if(streamed)
+	{
+		ret = stream.populate(topo, MEMORY_SPILL_FILE,
+				MEMORY_BUFFER_SIZE, node_boundary_t::SEG_ALL);
+		if(ret)
+			return PROPEGATE_ERROR(-1, ret);
+		ret = corner_map.add(tree, stream);
+		if(ret)
+			return PROPEGATE_ERROR(-2, ret);
+		ret = region_graph.populate(stream);
+		if(ret)
+			return PROPEGATE_ERROR(-3, ret);
+		stream.clear();
+	}
+	else
+	{
+		ret = boundary.populate(topo);
+		if(ret)
+			return PROPEGATE_ERROR(-4, ret);
+		corner_map.add(tree, boundary);
+		ret = region_graph.populate(boundary);
+		if(ret)
+			return PROPEGATE_ERROR(-5, ret);
+	}
+	ret = corner_map.populate_edges(tree);
+	if(ret)
+		return PROPEGATE_ERROR(-6, ret);
+
+	/* success */
+	return 0;
+}
+
+int current_memory(long& kb)
+{
+	ifstream statm;
+	long size, resident;
+
+	/* the second field is the resident set, in pages */
+	statm.open("/proc/self/statm");
+	if(!(statm >> size >> resident))
+		return -1;
+	kb = resident * (sysconf(_SC_PAGESIZE) / 1024);
+	return 0;
+}
+
+int peak_memory(const octree_t& tree, const octtopo_t& topo,
+                bool streamed, long& kb)
+{
+	struct rusage usage;
+	pid_t pid;
+	int status;
+
+	/* The peak memory of a process can only grow, so form the
+	 * regions in a child process and measure its peak.  Both
+	 * children start with the memory of this process. */
+	pid = fork();
+	if(pid < 0)
+		return -1;
+	if(pid == 0)
+		_exit(form_regions(tree, topo, streamed) ? 1 : 0);
+	if(wait4(pid, &status, 0, &usage) != pid)
+		return -2;
+	if(!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+		return -3;
+
+	/* success */
+	kb = usage.ru_maxrss;
+	return 0;
+}
@@ -0,0 +1,23 @@
+#ifndef TEST_NODE_BOUNDARY_H
+#define TEST_NODE_BOUNDARY_H
+
+/**
+ * @file test_node_boundary.h
+ * @author Eric Turner <elturner@eecs.berkeley.edu>
+ *
+ * @section DESCRIPTION
+ *
+ * Runs unit tests for the node_boundary_stream_t class, which check
+ * that streaming boundary faces through a spill file gives the same
+ * faces, linkages, and planar regions as the in-memory boundary, and
+ * that it lowers the peak memory of forming corners and regions.
+ */
+
+/**
+ * Runs the tests.
+ *
+ * @return   Returns zero if all pass, non-zero if failure occurs.
+ */
+int test_node_boundary();
+
+#endif
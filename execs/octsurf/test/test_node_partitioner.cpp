@@ -0,0 +1,200 @@
+#include "test_node_partitioner.h"
+#include <mesh/partition/node_partitioner.h>
+#include <mesh/partition/node_set.h>
+#include <geometry/octree/octtopo.h>
+#include <geometry/octree/octree.h>
+#include <util/union_find.h>
+#include <util/error_codes.h>
+#include <util/tictoc.h>
+#include <algorithm>
+#include <iostream>
+#include <stdlib.h>
+#include <vector>
+#include <set>
+#include <map>
+
+/**
+ * @file test_node_partitioner.cpp
+ * @author Eric Turner <elturner@eecs.berkeley.edu>
+ *
+ * @section DESCRIPTION
+ *
+ * Runs unit tests for the node_partitioner_t class, which check that
+ * partitioning nodes with a concurrent union-find on multiple threads
+ * gives the same partitions, in the same order, as the serial
+ * union-find that it replaced.
+ */
+
+using namespace std;
+using namespace octtopo;
+
+/* the parameters of the test */
+#define TEST_TREE_DEPTH    7
+#define TEST_NUM_ROOMS     3
+#define NUM_TEST_THREADS   4
+
+/* the individual tests */
+int test_partitions(const octtopo_t& topo,
+                    const vector<vector<size_t> >& reference,
+                    unsigned int num_threads, double& t);
+
+/* helper functions */
+void serial_partition(const octtopo_t& topo,
+                      vector<vector<size_t> >& unions);
+
+/* helper functions, which are shared with other tests */
+void random_tree(octree_t& tree, unsigned int depth);
+
+/* the testing suite */
+int test_node_partitioner()
+{
+	octree_t tree;
+	octtopo_t topo;
+	vector<vector<size_t> > reference;
+	tictoc_t clk;
+	double t_serial, t_one, t_many;
+	size_t i;
+	int ret;
+
+	/* seed for repeatable results */
+	srand(97531);
+
+	/* label the leaves with random rooms, so that
+	 * there are many partitions */
+	random_tree(tree, TEST_TREE_DEPTH);
+	ret = topo.init(tree);
+	if(ret)
+		return PROPEGATE_ERROR(-1, ret);
+	for(i = 0; i < topo.size(); i++)
+		topo.get_node(i)->data->set_fp_room(
+				(rand() % (TEST_NUM_ROOMS + 1)) - 1);
+
+	/* compare against the serial union-find */
+	tic(clk);
+	serial_partition(topo, reference);
+	t_serial = toc(clk, NULL);
+	ret = test_partitions(topo, reference, 1, t_one);
+	if(ret)
+		return PROPEGATE_ERROR(-2, ret);
+	ret = test_partitions(topo, reference, NUM_TEST_THREADS, t_many);
+	if(ret)
+		return PROPEGATE_ERROR(-3, ret);
+
+	/* report timing, which is not pass/fail */
+	cout << "[test_node_partitioner]\t" << topo.size() << " nodes, "
+	     << reference.size() << " partitions:" << endl
+	     << "\tserial union-find: " << t_serial << " sec" << endl
+	     << "\t1 thread:          " << t_one << " sec" << endl
+	     << "\t" << NUM_TEST_THREADS << " threads:         "
+	     << t_many << " sec" << endl;
+
+	/* success */
+	return 0;
+}
+
+/* the individual tests */
+
+int test_partitions(const octtopo_t& topo,
+                    const vector<vector<size_t> >& reference,
+                    unsigned int num_threads, double& t)
+{
+	node_partitioner_t partitioner;
+	set<octnode_t*> expected;
+	tictoc_t clk;
+	size_t i, j;
+	int ret;
+
+	/* partition the nodes */
+	tic(clk);
+	ret = partitioner.partition(topo, num_threads);
+	t = toc(clk, NULL);
+	if(ret)
+		return PROPEGATE_ERROR(-1, ret);
+
+	/* each partition should have the same nodes as the
+	 * reference union with the same index */
+	if(partitioner.size() != reference.size())
+	{
+		cerr << "[test_node_partitioner]\tFound "
+		     << partitioner.size() << " partitions, expected "
+		     << reference.size() << endl;
+		return -2;
+	}
+	for(i = 0; i < reference.size(); i++)
+	{
+		expected.clear();
+		for(j = 0; j < reference[i].size(); j++)
+			expected.insert(topo.get_node(reference[i][j]));
+		if(expected.size() != partitioner.get_partition(i).size()
+				|| !equal(expected.begin(), expected.end(),
+				partitioner.get_partition(i).begin()))
+		{
+			cerr << "[test_node_partitioner]\tMismatched "
+			     << "partition #" << i << " with "
+			     << num_threads << " threads" << endl;
+			return -3;
+		}
+	}
+
+	/* success */
+	return 0;
+}
+
+/* helper functions */
+
+void serial_partition(const octtopo_t& topo,
+                      vector<vector<size_t> >& unions)
+{
+	octtopo_t::const_iterator it;
+	map<octnode_t*, octneighbors_t> sorted;
+	map<octnode_t*, octneighbors_t>::iterator sit;
+	map<octnode_t*, size_t> indices;
+	vector<octnode_t*> rev_indices;
+	union_find_t us;
+	vector<octnode_t*> neighs, face_neighs;
+	vector<vector<size_t> > found;
+	size_t fi, i, j, myind;
+
+	/* this is the serial algorithm that the partitioner used
+	 * before it was parallelized, which kept the topology in
+	 * a map, and the neighbors of each face in a set */
+	for(it = topo.begin(); it != topo.end(); it++)
+		sorted.insert(*it);
+	for(sit = sorted.begin(); sit != sorted.end(); sit++)
+		if((indices.insert(pair<octnode_t*, size_t>(sit->first,
+						indices.size()))).second)
+			rev_indices.push_back(sit->first);
+	us.init(indices.size());
+	for(sit = sorted.begin(); sit != sorted.end(); sit++)
+	{
+		neighs.clear();
+		for(fi = 0; fi < NUM_FACES_PER_CUBE; fi++)
+		{
+			face_neighs.assign(
+				sit->second.begin(all_cube_faces[fi]),
+				sit->second.end(all_cube_faces[fi]));
+			sort(face_neighs.begin(), face_neighs.end());
+			neighs.insert(neighs.end(), face_neighs.begin(),
+					face_neighs.end());
+		}
+		myind = indices[sit->first];
+		for(i = 0; i < neighs.size(); i++)
+			if(sit->first->data->is_interior()
+					== neighs[i]->data->is_interior()
+					&& sit->first->data->get_fp_room()
+					== neighs[i]->data->get_fp_room())
+				us.add_edge(myind, indices[neighs[i]]);
+	}
+
+	/* the unions are listed in the order the serial union-find
+	 * gives them, as topology indices */
+	us.get_unions(found);
+	unions.resize(found.size());
+	for(i = 0; i < found.size(); i++)
+	{
+		unions[i].clear();
+		for(j = 0; j < found[i].size(); j++)
+			unions[i].push_back(topo.find(
+					rev_indices[found[i][j]]));
+	}
+}
@@ -0,0 +1,23 @@
+#ifndef TEST_NODE_PARTITIONER_H
+#define TEST_NODE_PARTITIONER_H
+
+/**
+ * @file test_node_partitioner.h
+ * @author Eric Turner <elturner@eecs.berkeley.edu>
+ *
+ * @section DESCRIPTION
+ *
+ * Runs unit tests for the node_partitioner_t class, which check that
+ * partitioning nodes with a concurrent union-find on multiple threads
+ * gives the same partitions, in the same order, as the serial
+ * union-find that it replaced.
+ */
+
+/**
+ * Runs the tests.
+ *
+ * @return   Returns zero if all pass, non-zero if failure occurs.
+ */
+int test_node_partitioner();
+
+#endif
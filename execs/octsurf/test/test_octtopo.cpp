@@ -0,0 +1,414 @@
+#include "test_octtopo.h"
+#include <geometry/octree/octtopo.h>
+#include <geometry/octree/octree.h>
+#include <geometry/octree/octnode.h>
+#include <geometry/octree/octdata.h>
+#include <util/error_codes.h>
+#include <util/tictoc.h>
+#include <Eigen/Dense>
+#include <iostream>
+#include <stdlib.h>
+#include <cmath>
+#include <algorithm>
+#include <vector>
+#include <set>
+#include <map>
+#include <queue>
+
+/**
+ * @file test_octtopo.cpp
+ * @author Eric Turner <elturner@eecs.berkeley.edu>
+ *
+ * @section DESCRIPTION
+ *
+ * Runs unit tests for the octtopo_t class, which check that its
+ * neighbor linkages match the geometry of the tree, that building it
+ * with multiple threads gives the same topology as building it with
+ * one, and that removing outliers flips the same nodes as the
+ * original map-based topology.
+ */
+
+using namespace std;
+using namespace Eigen;
+using namespace octtopo;
+
+/* the depths of the test trees */
+#define SMALL_TREE_DEPTH   5
+#define LARGE_TREE_DEPTH   8
+#define NUM_TEST_THREADS   4
+
+/* tolerance for comparing node geometry */
+#define GEOM_TOLERANCE     1e-9
+
+/* the outlier test flips one in this many leaves, and then
+ * removes outliers with the given threshold */
+#define OUTLIER_NOISE      5
+#define OUTLIER_THRESHOLD  0.55
+
+/* the neighbors of each node, stored the way the original
+ * topology did, as a sorted set of nodes per face */
+typedef map<octnode_t*, vector<set<octnode_t*> > > neighmap_t;
+
+/* the individual tests */
+int test_geometry(const octree_t& tree);
+int test_threads(const octree_t& tree);
+int test_outliers(const octree_t& tree);
+
+/* helper functions, which are shared with other tests */
+void random_tree(octree_t& tree, unsigned int depth);
+void random_subtree(octnode_t* node, unsigned int depth);
+bool touching(const octnode_t* a, const octnode_t* b);
+void remove_outliers_map(neighmap_t& neighs, double neigh_thresh);
+
+/* the testing suite */
+int test_octtopo()
+{
+	octree_t small_tree, large_tree;
+	int ret;
+
+	/* seed for repeatable results */
+	srand(2468);
+
+	/* check linkages against brute force on a small tree */
+	random_tree(small_tree, SMALL_TREE_DEPTH);
+	ret = test_geometry(small_tree);
+	if(ret)
+		return PROPEGATE_ERROR(-1, ret);
+
+	/* compare thread counts on both trees */
+	ret = test_threads(small_tree);
+	if(ret)
+		return PROPEGATE_ERROR(-2, ret);
+	random_tree(large_tree, LARGE_TREE_DEPTH);
+	ret = test_threads(large_tree);
+	if(ret)
+		return PROPEGATE_ERROR(-3, ret);
+
+	/* check outlier removal against the original algorithm */
+	ret = test_outliers(small_tree);
+	if(ret)
+		return PROPEGATE_ERROR(-4, ret);
+
+	/* success */
+	return 0;
+}
+
+/* the individual tests */
+
+int test_geometry(const octree_t& tree)
+{
+	octtopo_t topo;
+	size_t i, j, n;
+	int ret;
+
+	/* build the topology */
+	ret = topo.init(tree, 1);
+	if(ret)
+		return PROPEGATE_ERROR(-1, ret);
+	ret = topo.verify();
+	if(ret)
+		return PROPEGATE_ERROR(-2, ret);
+
+	/* every pair of touching leaves should be neighbors */
+	n = topo.size();
+	for(i = 0; i < n; i++)
+		for(j = i+1; j < n; j++)
+			if(topo.are_neighbors(topo.get_node(i),
+					topo.get_node(j))
+					!= touching(topo.get_node(i),
+					topo.get_node(j)))
+			{
+				cerr << "[test_octtopo]\tMismatched "
+				     << "neighbors for leaves #" << i
+				     << " and #" << j << endl;
+				return -3;
+			}
+
+	/* success */
+	cout << "[test_octtopo]\tChecked " << n << " leaves" << endl;
+	return 0;
+}
+
+int test_threads(const octree_t& tree)
+{
+	octtopo_t serial, parallel;
+	octtopo_t::const_iterator sit, pit;
+	octnode_t* const* a;
+	octnode_t* const* b;
+	tictoc_t clk;
+	double t_serial, t_parallel;
+	size_t fi;
+	int ret;
+
+	/* build the topology both ways */
+	tic(clk);
+	ret = serial.init(tree, 1);
+	t_serial = toc(clk, NULL);
+	if(ret)
+		return PROPEGATE_ERROR(-1, ret);
+	tic(clk);
+	ret = parallel.init(tree, NUM_TEST_THREADS);
+	t_parallel = toc(clk, NULL);
+	if(ret)
+		return PROPEGATE_ERROR(-2, ret);
+	ret = parallel.verify();
+	if(ret)
+		return PROPEGATE_ERROR(-3, ret);
+
+	/* the results should be identical, in the same order */
+	if(serial.size() != parallel.size())
+	{
+		cerr << "[test_octtopo]\tSerial topology has "
+		     << serial.size() << " nodes, parallel has "
+		     << parallel.size() << endl;
+		return -4;
+	}
+	for(sit = serial.begin(), pit = parallel.begin();
+			sit != serial.end(); sit++, pit++)
+	{
+		if(sit->first != pit->first)
+		{
+			cerr << "[test_octtopo]\tMismatched node order"
+			     << endl;
+			return -5;
+		}
+		for(fi = 0; fi < NUM_FACES_PER_CUBE; fi++)
+		{
+			a = sit->second.begin(all_cube_faces[fi]);
+			b = pit->second.begin(all_cube_faces[fi]);
+			if(sit->second.size(all_cube_faces[fi])
+					!= pit->second.size(
+					all_cube_faces[fi]))
+			{
+				cerr << "[test_octtopo]\tMismatched "
+				     << "number of neighbors" << endl;
+				return -6;
+			}
+			for( ; a != sit->second.end(all_cube_faces[fi]);
+					a++, b++)
+				if(*a != *b)
+				{
+					cerr << "[test_octtopo]\tMismatched "
+					     << "neighbors" << endl;
+					return -7;
+				}
+		}
+		if(parallel.find(pit->first) != serial.find(sit->first))
+		{
+			cerr << "[test_octtopo]\tMismatched node index"
+			     << endl;
+			return -8;
+		}
+	}
+
+	/* report timing, which is not pass/fail */
+	cout << "[test_octtopo]\t" << serial.size() << " leaves:" << endl
+	     << "\t1 thread:  " << t_serial << " sec" << endl
+	     << "\t" << NUM_TEST_THREADS << " threads: " << t_parallel
+	     << " sec" << endl;
+
+	/* success */
+	return 0;
+}
+
+int test_outliers(const octree_t& tree)
+{
+	octtopo_t topo;
+	octtopo_t::const_iterator it;
+	neighmap_t neighs;
+	vector<octdata_t> saved;
+	vector<bool> expected;
+	octnode_t* const* nit;
+	octnode_t* node;
+	size_t i, fi, n, num_flipped;
+	int ret;
+
+	/* build the topology */
+	ret = topo.init(tree, 1);
+	if(ret)
+		return PROPEGATE_ERROR(-1, ret);
+	n = topo.size();
+
+	/* add noise, so that there are outliers to remove */
+	for(i = 0; i < n; i++)
+		if(rand() % OUTLIER_NOISE == 0)
+			topo.get_node(i)->data->flip();
+
+	/* copy the neighbors into the original layout */
+	for(it = topo.begin(); it != topo.end(); it++)
+	{
+		neighs[it->first].resize(NUM_FACES_PER_CUBE);
+		for(fi = 0; fi < NUM_FACES_PER_CUBE; fi++)
+			for(nit = it->second.begin(all_cube_faces[fi]);
+				nit != it->second.end(all_cube_faces[fi]);
+								nit++)
+				neighs[it->first][fi].insert(*nit);
+	}
+
+	/* remove outliers the original way, keeping the original
+	 * values so the same tree can be used again */
+	for(i = 0; i < n; i++)
+		saved.push_back(*(topo.get_node(i)->data));
+	remove_outliers_map(neighs, OUTLIER_THRESHOLD);
+	num_flipped = 0;
+	for(i = 0; i < n; i++)
+	{
+		node = topo.get_node(i);
+		expected.push_back(node->data->is_interior());
+		if(expected.back() != saved[i].is_interior())
+			num_flipped++;
+		*(node->data) = saved[i];
+	}
+	if(num_flipped == 0)
+	{
+		cerr << "[test_octtopo]\tNo outliers to remove" << endl;
+		return -2;
+	}
+
+	/* the array-based topology should flip the same nodes */
+	ret = topo.remove_outliers(OUTLIER_THRESHOLD);
+	if(ret)
+		return PROPEGATE_ERROR(-3, ret);
+	for(i = 0; i < n; i++)
+		if(topo.get_node(i)->data->is_interior() != expected[i])
+		{
+			cerr << "[test_octtopo]\tOutlier removal differs "
+			     << "at leaf #" << i << endl;
+			return -4;
+		}
+
+	/* success */
+	cout << "[test_octtopo]\tFlipped " << num_flipped << " of "
+	     << n << " leaves as outliers" << endl;
+	return 0;
+}
+
+/* helper functions */
+
+void random_tree(octree_t& tree, unsigned int depth)
+{
+	/* start with a fresh tree that can hold the given depth */
+	tree.set(Vector3d::Zero(), 1.0, 2.0 / (1 << depth));
+	random_subtree(tree.get_root(), depth);
+}
+
+void random_subtree(octnode_t* node, unsigned int depth)
+{
+	double r;
+	size_t i;
+
+	/* refine near a sphere, and randomly elsewhere, so that
+	 * neighboring leaves differ in size */
+	r = node->center.norm();
+	if(depth == 0 || (fabs(r - 0.6) > 2*node->halfwidth
+				&& rand() % 3 != 0))
+	{
+		node->data = new octdata_t();
+		node->data->add_sample(1.0, (r < 0.6) ? 0.9 : 0.1);
+		return;
+	}
+
+	/* leave some children out, to make null space */
+	for(i = 0; i < CHILDREN_PER_NODE; i++)
+	{
+		if(rand() % 10 == 0)
+			continue;
+		node->children[i] = new octnode_t(relative_child_pos(i)
+				* (node->halfwidth/2) + node->center,
+				node->halfwidth/2);
+		random_subtree(node->children[i], depth-1);
+	}
+}
+
+bool touching(const octnode_t* a, const octnode_t* b)
+{
+	double w, d;
+	size_t i, num_flush;
+
+	/* two cubes share a face if they are flush along one axis
+	 * and overlap along the other two */
+	w = a->halfwidth + b->halfwidth;
+	num_flush = 0;
+	for(i = 0; i < 3; i++)
+	{
+		d = fabs(a->center(i) - b->center(i));
+		if(fabs(d - w) < GEOM_TOLERANCE)
+			num_flush++;
+		else if(d > w)
+			return false;
+	}
+	return (num_flush == 1);
+}
+
+void remove_outliers_map(neighmap_t& neighs, double neigh_thresh)
+{
+	queue<neighmap_t::iterator> in_to_check, out_to_check;
+	neighmap_t::iterator it, nt;
+	vector<octnode_t*> ns;
+	size_t fi, ni, num_neighs;
+	double count, myarea, neigharea;
+	bool current_in;
+
+	/* this is octtopo_t::remove_outliers() as it was written
+	 * for the std::map topology, so nodes are visited in order
+	 * of their addresses */
+	for(it = neighs.begin(); it != neighs.end(); it++)
+	{
+		if(octtopo_t::node_is_interior(it->first))
+			in_to_check.push(it);
+		else
+			out_to_check.push(it);
+	}
+	while(!(in_to_check.empty() && out_to_check.empty()))
+	{
+		/* get next value */
+		if(in_to_check.empty())
+		{
+			it = out_to_check.front();
+			out_to_check.pop();
+			current_in = false;
+		}
+		else
+		{
+			it = in_to_check.front();
+			in_to_check.pop();
+			current_in = true;
+		}
+
+		/* check if we've already flipped this node */
+		if(it->first->data == NULL)
+			continue;
+		if(octtopo_t::node_is_interior(it->first) != current_in)
+			continue;
+
+		/* add up the area of the disagreeing neighbors */
+		myarea = it->first->surface_area();
+		ns.clear();
+		for(fi = 0; fi < NUM_FACES_PER_CUBE; fi++)
+			ns.insert(ns.end(), it->second[fi].begin(),
+			          it->second[fi].end());
+		num_neighs = ns.size();
+		count = 0;
+		for(ni = 0; ni < num_neighs; ni++)
+			if(octtopo_t::node_is_interior(ns[ni]) != current_in)
+			{
+				neigharea = min(ns[ni]->halfwidth,
+						it->first->halfwidth);
+				neigharea = 4*neigharea*neigharea;
+				count += neigharea;
+			}
+		count /= myarea;
+		if(count < neigh_thresh)
+			continue;
+
+		/* flip this node, and recheck its neighbors */
+		it->first->data->flip();
+		for(ni = 0; ni < num_neighs; ni++)
+			if(octtopo_t::node_is_interior(ns[ni]) == current_in)
+			{
+				nt = neighs.find(ns[ni]);
+				if(nt != neighs.end())
+					in_to_check.push(nt);
+			}
+	}
+}
@@ -0,0 +1,22 @@
+#ifndef TEST_OCTTOPO_H
+#define TEST_OCTTOPO_H
+
+/**
+ * @file test_octtopo.h
+ * @author Eric Turner <elturner@eecs.berkeley.edu>
+ *
+ * @section DESCRIPTION
+ *
+ * Runs unit tests for the octtopo_t class, which check that its
+ * neighbor linkages match the geometry of the tree, and that removing
+ * outliers flips the same nodes as the original map-based topology.
+ */
+
+/**
+ * Runs the tests.
+ *
+ * @return   Returns zero if all pass, non-zero if failure occurs.
+ */
+int test_octtopo();
+
+#endif
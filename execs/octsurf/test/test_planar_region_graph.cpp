@@ -0,0 +1,241 @@
+#include "test_planar_region_graph.h"
+#include <geometry/octree/octree.h>
+#include <geometry/octree/octtopo.h>
+#include <mesh/surface/node_boundary.h>
+#include <mesh/surface/planar_region.h>
+#include <mesh/surface/planar_region_graph.h>
+#include <util/error_codes.h>
+#include <iostream>
+#include <stdlib.h>
+#include <cmath>
+
+/**
+ * @file test_planar_region_graph.cpp
+ * @author Eric Turner <elturner@eecs.berkeley.edu>
+ *
+ * @section DESCRIPTION
+ *
+ * Runs unit tests for the planar_region_graph_t class, which check
+ * that coalescing regions gives the same result for any number of
+ * threads, and that coalescing in shards covers the same faces
+ * with a similar number of regions as coalescing without them.
+ */
+
+using namespace std;
+
+/* the size of the test tree */
+#define TEST_TREE_DEPTH     6
+#define NUM_TEST_THREADS    4
+
+/* the coalescing parameters, which match octsurf's defaults */
+#define TEST_PLANE_THRESH   0.0
+#define TEST_DIST_THRESH    2.0
+#define TEST_SHARD_SIZE     64
+
+/* how many more or fewer regions sharding may produce */
+#define SHARD_REGION_TOLERANCE  0.1
+
+/* the individual tests */
+int test_coalesce_threads(const node_boundary_t& boundary, size_t shardsize);
+int test_shards(const node_boundary_t& boundary);
+
+/* helper functions, which are shared with other tests */
+void random_tree(octree_t& tree, unsigned int depth);
+
+/* helper functions */
+int coalesce(planar_region_graph_t& graph,
+             const node_boundary_t& boundary, size_t shardsize,
+             unsigned int numthreads);
+bool same_regions(const planar_region_graph_t& a,
+                  const planar_region_graph_t& b);
+int check_faces(const planar_region_graph_t& graph,
+                const node_boundary_t& boundary);
+
+/* the testing suite */
+int test_planar_region_graph()
+{
+	octree_t tree;
+	octtopo::octtopo_t topo;
+	node_boundary_t boundary;
+	int ret;
+
+	/* seed for repeatable results */
+	srand(1357);
+
+	/* make the boundary faces of a random tree */
+	random_tree(tree, TEST_TREE_DEPTH);
+	ret = topo.init(tree);
+	if(ret)
+		return PROPEGATE_ERROR(-1, ret);
+	ret = boundary.populate(topo);
+	if(ret)
+		return PROPEGATE_ERROR(-2, ret);
+
+	/* run tests */
+	ret = test_coalesce_threads(boundary, 0);
+	if(ret)
+		return PROPEGATE_ERROR(-3, ret);
+	ret = test_coalesce_threads(boundary, TEST_SHARD_SIZE);
+	if(ret)
+		return PROPEGATE_ERROR(-4, ret);
+	ret = test_shards(boundary);
+	if(ret)
+		return PROPEGATE_ERROR(-5, ret);
+
+	/* success */
+	return 0;
+}
+
+/* the individual tests */
+
+int test_coalesce_threads(const node_boundary_t& boundary, size_t shardsize)
+{
+	planar_region_graph_t serial, parallel;
+	int ret;
+
+	/* coalesce with one thread and with several */
+	ret = coalesce(serial, boundary, shardsize, 1);
+	if(ret)
+		return PROPEGATE_ERROR(-1, ret);
+	ret = coalesce(parallel, boundary, shardsize, NUM_TEST_THREADS);
+	if(ret)
+		return PROPEGATE_ERROR(-2, ret);
+
+	/* the regions should be identical */
+	if(!same_regions(serial, parallel))
+	{
+		cerr << "[test_planar_region_graph]\tShard size "
+		     << shardsize << " gives different regions with "
+		     << NUM_TEST_THREADS << " threads" << endl;
+		return -3;
+	}
+
+	/* success */
+	return 0;
+}
+
+int test_shards(const node_boundary_t& boundary)
+{
+	planar_region_graph_t unsharded, sharded;
+	double diff;
+	int ret;
+
+	/* coalesce with and without shards */
+	ret = coalesce(unsharded, boundary, 0, NUM_TEST_THREADS);
+	if(ret)
+		return PROPEGATE_ERROR(-1, ret);
+	ret = coalesce(sharded, boundary, TEST_SHARD_SIZE,
+	               NUM_TEST_THREADS);
+	if(ret)
+		return PROPEGATE_ERROR(-2, ret);
+
+	/* both should put every face in exactly one region */
+	ret = check_faces(unsharded, boundary);
+	if(ret)
+		return PROPEGATE_ERROR(-3, ret);
+	ret = check_faces(sharded, boundary);
+	if(ret)
+		return PROPEGATE_ERROR(-4, ret);
+
+	/* merges are made in a different order across shards, so
+	 * the regions differ, but there should be about as many */
+	diff = fabs((double) sharded.size() - (double) unsharded.size());
+	if(diff > SHARD_REGION_TOLERANCE * unsharded.size())
+	{
+		cerr << "[test_planar_region_graph]\tSharding gives "
+		     << sharded.size() << " regions, expected about "
+		     << unsharded.size() << endl;
+		return -5;
+	}
+
+	/* success */
+	cout << "[test_planar_region_graph]\t" << boundary.size()
+	     << " faces:" << endl
+	     << "\tunsharded: " << unsharded.size() << " regions"
+	     << endl
+	     << "\tsharded:   " << sharded.size() << " regions" << endl;
+	return 0;
+}
+
+/* helper functions */
+
+int coalesce(planar_region_graph_t& graph,
+             const node_boundary_t& boundary, size_t shardsize,
+             unsigned int numthreads)
+{
+	int ret;
+
+	/* use the same settings as octsurf does */
+	graph.init(TEST_PLANE_THRESH, TEST_DIST_THRESH, false,
+	           planar_region_graph_t::COALESCE_WITH_L2_NORM);
+	graph.init_sharding(shardsize, numthreads);
+	ret = graph.populate(boundary);
+	if(ret)
+		return PROPEGATE_ERROR(-1, ret);
+	ret = graph.coalesce_regions();
+	if(ret)
+		return PROPEGATE_ERROR(-2, ret);
+
+	/* success */
+	return 0;
+}
+
+bool same_regions(const planar_region_graph_t& a,
+                  const planar_region_graph_t& b)
+{
+	regionmap_t::const_iterator ait, bit;
+	faceset_t::const_iterator afit, bfit;
+
+	/* the regions should have the same seeds, faces and planes */
+	if(a.size() != b.size())
+		return false;
+	for(ait = a.begin(), bit = b.begin(); ait != a.end();
+							ait++, bit++)
+	{
+		if(ait->first != bit->first)
+			return false;
+		if(ait->second.get_region().num_faces()
+				!= bit->second.get_region().num_faces())
+			return false;
+		for(afit = ait->second.get_region().begin(),
+				bfit = bit->second.get_region().begin();
+				afit != ait->second.get_region().end();
+				afit++, bfit++)
+			if(*afit != *bfit)
+				return false;
+		if(ait->second.get_region().get_plane().normal
+				!= bit->second.get_region().get_plane().normal
+				|| ait->second.get_region().get_plane().point
+				!= bit->second.get_region().get_plane().point)
+			return false;
+	}
+	return true;
+}
+
+int check_faces(const planar_region_graph_t& graph,
+                const node_boundary_t& boundary)
+{
+	facemap_t::const_iterator it;
+	regionmap_t::const_iterator rit;
+	size_t num_faces;
+
+	/* each face should be found in the region it maps to */
+	for(it = boundary.begin(); it != boundary.end(); it++)
+	{
+		rit = graph.lookup_face(it->first);
+		if(rit == graph.end())
+			return -1;
+		if(!(rit->second.get_region().contains(it->first)))
+			return -2;
+	}
+
+	/* and no face should be in two regions */
+	num_faces = 0;
+	for(rit = graph.begin(); rit != graph.end(); rit++)
+		num_faces += rit->second.get_region().num_faces();
+	if(num_faces != boundary.size())
+		return -3;
+
+	/* success */
+	return 0;
+}
@@ -0,0 +1,23 @@
+#ifndef TEST_PLANAR_REGION_GRAPH_H
+#define TEST_PLANAR_REGION_GRAPH_H
+
+/**
+ * @file test_planar_region_graph.h
+ * @author Eric Turner <elturner@eecs.berkeley.edu>
+ *
+ * @section DESCRIPTION
+ *
+ * Runs unit tests for the planar_region_graph_t class, which check
+ * that coalescing regions gives the same result for any number of
+ * threads, and that coalescing in shards covers the same faces
+ * with a similar number of regions as coalescing without them.
+ */
+
+/**
+ * Runs the tests.
+ *
+ * @return   Returns zero if all pass, non-zero if failure occurs.
+ */
+int test_planar_region_graph();
+
+#endif
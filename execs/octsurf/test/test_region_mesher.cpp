@@ -0,0 +1,201 @@
+#include "test_region_mesher.h"
+#include <geometry/octree/octree.h>
+#include <geometry/octree/octtopo.h>
+#include <mesh/surface/node_boundary.h>
+#include <mesh/surface/node_corner_map.h>
+#include <mesh/surface/planar_region_graph.h>
+#include <mesh/surface/region_mesher.h>
+#include <io/mesh/mesh_io.h>
+#include <util/error_codes.h>
+#include <iostream>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <stdlib.h>
+#include <stdio.h>
+
+/**
+ * @file test_region_mesher.cpp
+ * @author Eric Turner <elturner@eecs.berkeley.edu>
+ *
+ * @section DESCRIPTION
+ *
+ * Runs unit tests for the region_mesher::mesher_t class, which check
+ * that meshing regions with one thread and with several gives the
+ * same mesh file, with and without isosurface positions.
+ */
+
+using namespace std;
+
+/* the parameters of the test */
+#define TEST_TREE_DEPTH     6
+#define NUM_TEST_THREADS    4
+#define TEST_COLOR_SEED     2468
+#define TEST_SETTINGS_FILE  "build/test_region_mesher.xml"
+#define TEST_SERIAL_FILE    "build/test_region_mesher_serial.ply"
+#define TEST_PARALLEL_FILE  "build/test_region_mesher_parallel.ply"
+
+/* the coalescing parameters, which match octsurf's defaults */
+#define TEST_PLANE_THRESH   0.0
+#define TEST_DIST_THRESH    2.0
+
+/* the individual tests */
+int test_threads(const octree_t& tree, const node_boundary_t& boundary,
+                 const node_corner::corner_map_t& corner_map,
+                 bool isosurface);
+
+/* helper functions, which are shared with other tests */
+void random_tree(octree_t& tree, unsigned int depth);
+
+/* helper functions */
+int mesh_regions(const string& filename, const octree_t& tree,
+                 const planar_region_graph_t& region_graph,
+                 const node_corner::corner_map_t& corner_map,
+                 bool isosurface, unsigned int numthreads);
+bool same_file(const string& a, const string& b);
+
+/* the testing suite */
+int test_region_mesher()
+{
+	octree_t tree;
+	octtopo::octtopo_t topo;
+	node_boundary_t boundary;
+	node_corner::corner_map_t corner_map;
+	int ret;
+
+	/* seed for repeatable results */
+	srand(8642);
+
+	/* make the boundary faces and corners of a random tree */
+	random_tree(tree, TEST_TREE_DEPTH);
+	ret = topo.init(tree);
+	if(ret)
+		return PROPEGATE_ERROR(-1, ret);
+	ret = boundary.populate(topo);
+	if(ret)
+		return PROPEGATE_ERROR(-2, ret);
+	corner_map.add(tree, boundary);
+	ret = corner_map.populate_edges(tree);
+	if(ret)
+		return PROPEGATE_ERROR(-3, ret);
+
+	/* run tests */
+	ret = test_threads(tree, boundary, corner_map, false);
+	if(ret)
+		return PROPEGATE_ERROR(-4, ret);
+	ret = test_threads(tree, boundary, corner_map, true);
+	if(ret)
+		return PROPEGATE_ERROR(-5, ret);
+
+	/* clean up */
+	remove(TEST_SETTINGS_FILE);
+	remove(TEST_SERIAL_FILE);
+	remove(TEST_PARALLEL_FILE);
+	return 0;
+}
+
+/* the individual tests */
+
+int test_threads(const octree_t& tree, const node_boundary_t& boundary,
+                 const node_corner::corner_map_t& corner_map,
+                 bool isosurface)
+{
+	planar_region_graph_t region_graph;
+	int ret;
+
+	/* form regions the same way as octsurf does */
+	region_graph.init(TEST_PLANE_THRESH, TEST_DIST_THRESH, isosurface,
+	                  planar_region_graph_t::COALESCE_WITH_L2_NORM);
+	ret = region_graph.populate(boundary);
+	if(ret)
+		return PROPEGATE_ERROR(-1, ret);
+	ret = region_graph.coalesce_regions();
+	if(ret)
+		return PROPEGATE_ERROR(-2, ret);
+
+	/* mesh the regions with one thread and with several */
+	ret = mesh_regions(TEST_SERIAL_FILE, tree, region_graph,
+	                   corner_map, isosurface, 1);
+	if(ret)
+		return PROPEGATE_ERROR(-3, ret);
+	ret = mesh_regions(TEST_PARALLEL_FILE, tree, region_graph,
+	                   corner_map, isosurface, NUM_TEST_THREADS);
+	if(ret)
+		return PROPEGATE_ERROR(-4, ret);
+
+	/* the files should be identical */
+	if(!same_file(TEST_SERIAL_FILE, TEST_PARALLEL_FILE))
+	{
+		cerr << "[test_region_mesher]\tMeshing "
+		     << (isosurface ? "with" : "without")
+		     << " isosurface positions gives a different mesh "
+		     << "with " << NUM_TEST_THREADS << " threads" << endl;
+		return -5;
+	}
+
+	/* success */
+	return 0;
+}
+
+/* helper functions */
+
+int mesh_regions(const string& filename, const octree_t& tree,
+                 const planar_region_graph_t& region_graph,
+                 const node_corner::corner_map_t& corner_map,
+                 bool isosurface, unsigned int numthreads)
+{
+	region_mesher::mesher_t mesher;
+	mesh_io::mesh_t mesh;
+	ofstream settings;
+	int ret;
+
+	/* the mesher reads its thread count from a settings file */
+	settings.open(TEST_SETTINGS_FILE);
+	if(!(settings.is_open()))
+		return -1;
+	settings << "<settings>" << endl
+	         << "\t<octsurf_use_isosurface_pos>" << (isosurface ? 1 : 0)
+	         << "</octsurf_use_isosurface_pos>" << endl
+	         << "\t<octsurf_num_threads>" << numthreads
+	         << "</octsurf_num_threads>" << endl
+	         << "</settings>" << endl;
+	settings.close();
+	ret = mesher.import(TEST_SETTINGS_FILE);
+	if(ret)
+		return PROPEGATE_ERROR(-2, ret);
+
+	/* mesh the regions, drawing the same region colors each time */
+	ret = mesher.init(tree, region_graph, corner_map);
+	if(ret)
+		return PROPEGATE_ERROR(-3, ret);
+	srand(TEST_COLOR_SEED);
+	ret = mesher.compute_mesh(mesh, tree);
+	if(ret)
+		return PROPEGATE_ERROR(-4, ret);
+	if(mesh.num_polys() == 0)
+	{
+		cerr << "[test_region_mesher]\tNo triangles were made"
+		     << endl;
+		return -5;
+	}
+
+	/* export it */
+	ret = mesh.write(filename);
+	if(ret)
+		return PROPEGATE_ERROR(-6, ret);
+
+	/* success */
+	return 0;
+}
+
+bool same_file(const string& a, const string& b)
+{
+	ifstream fa(a.c_str(), ios::binary), fb(b.c_str(), ios::binary);
+	
+	/* compare the full contents */
+	return (fa.is_open() && fb.is_open()
+		&& string(istreambuf_iterator<char>(fa),
+		          istreambuf_iterator<char>())
+		== string(istreambuf_iterator<char>(fb),
+		          istreambuf_iterator<char>()));
+}
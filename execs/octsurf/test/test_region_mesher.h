@@ -0,0 +1,22 @@
+#ifndef TEST_REGION_MESHER_H
+#define TEST_REGION_MESHER_H
+
+/**
+ * @file test_region_mesher.h
+ * @author Eric Turner <elturner@eecs.berkeley.edu>
+ *
+ * @section DESCRIPTION
+ *
+ * Runs unit tests for the region_mesher::mesher_t class, which check
+ * that meshing regions with one thread and with several gives the
+ * same mesh file, with and without isosurface positions.
+ */
+
+/**
+ * Runs the tests.
+ *
+ * @return   Returns zero if all pass, non-zero if failure occurs.
+ */
+int test_region_mesher();
+
+#endif
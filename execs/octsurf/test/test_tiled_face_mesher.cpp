@@ -0,0 +1,381 @@
+#include "test_tiled_face_mesher.h"
+#include <geometry/octree/octree.h>
+#include <geometry/octree/octtopo.h>
+#include <mesh/surface/node_boundary.h>
+#include <mesh/surface/face_mesher.h>
+#include <mesh/surface/tiled_face_mesher.h>
+#include <io/mesh/mesh_io.h>
+#include <util/error_codes.h>
+#include <algorithm>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <stdlib.h>
+#include <stdio.h>
+
+/**
+ * @file test_tiled_face_mesher.cpp
+ * @author Eric Turner <elturner@eecs.berkeley.edu>
+ *
+ * @section DESCRIPTION
+ *
+ * Runs unit tests for the tiled_face_mesher_t class, which check that
+ * it makes the same triangles as face_mesher_t for several tile sizes
+ * and thread counts, and that the tile files and their index describe
+ * the same mesh as the merged file.
+ */
+
+using namespace std;
+
+/* the parameters of the test */
+#define TEST_TREE_DEPTH     6 /* resolution of 3.125 cm */
+#define NUM_TEST_THREADS    4
+#define TEST_SETTINGS_FILE  "build/test_tiled_face_mesher.xml"
+#define TEST_REFERENCE_FILE "build/test_tiled_face_mesher_ref.ply"
+#define TEST_SERIAL_FILE    "build/test_tiled_face_mesher_serial.ply"
+#define TEST_PARALLEL_FILE  "build/test_tiled_face_mesher_parallel.ply"
+#define TEST_TILES_FILE     "build/test_tiled_face_mesher_tiles.ply"
+#define TEST_INDEX_FILE     "build/test_tiled_face_mesher_tiles.tiles"
+
+/* the tile sizes to test, from many small tiles to a single tile
+ * that covers the whole tree */
+#define NUM_TEST_TILE_SIZES 3
+static const double TEST_TILE_SIZES[NUM_TEST_TILE_SIZES] = {0.1, 0.5, 4.0};
+
+/* the format the meshers write */
+#define TEST_MESH_FORMAT    mesh_io::FORMAT_PLY_LE_COLOR
+
+/* each triangle is stored as the positions of its vertices */
+typedef vector<double> triangle_t;
+
+/* the individual tests */
+int test_merged(const octree_t& tree, const octtopo::octtopo_t& topo,
+                const vector<triangle_t>& reference, double tilesize);
+int test_index(const octree_t& tree, const octtopo::octtopo_t& topo,
+               double tilesize);
+
+/* helper functions, which are shared with other tests */
+void random_tree(octree_t& tree, unsigned int depth);
+bool same_file(const string& a, const string& b);
+
+/* helper functions */
+int tiled_mesh(const string& filename, const octree_t& tree,
+               const octtopo::octtopo_t& topo, double tilesize,
+               bool tilefiles, unsigned int numthreads);
+void get_triangles(const mesh_io::mesh_t& mesh, vector<triangle_t>& tris);
+void get_indices(const mesh_io::mesh_t& mesh,
+                 const vector<size_t>& ids, vector<triangle_t>& tris);
+
+/* the testing suite */
+int test_tiled_face_mesher()
+{
+	octree_t tree;
+	octtopo::octtopo_t topo;
+	node_boundary_t boundary;
+	face_mesher_t face_mesher;
+	mesh_io::mesh_t mesh;
+	vector<triangle_t> reference;
+	size_t i;
+	int ret;
+
+	/* seed for repeatable results */
+	srand(9753);
+
+	/* mesh a random tree without tiles */
+	random_tree(tree, TEST_TREE_DEPTH);
+	ret = topo.init(tree);
+	if(ret)
+		return PROPEGATE_ERROR(-1, ret);
+	ret = boundary.populate(topo);
+	if(ret)
+		return PROPEGATE_ERROR(-2, ret);
+	ret = face_mesher.add(tree, boundary);
+	if(ret)
+		return PROPEGATE_ERROR(-3, ret);
+
+	/* write it in the same format as the tiled mesher, so the
+	 * positions are rounded the same way */
+	ret = face_mesher.get_mesh().write(TEST_REFERENCE_FILE,
+	                                   TEST_MESH_FORMAT);
+	if(ret)
+		return PROPEGATE_ERROR(-4, ret);
+	ret = mesh.read(TEST_REFERENCE_FILE);
+	if(ret)
+		return PROPEGATE_ERROR(-5, ret);
+	get_triangles(mesh, reference);
+
+	/* run tests for each tile size */
+	for(i = 0; i < NUM_TEST_TILE_SIZES; i++)
+	{
+		ret = test_merged(tree, topo, reference,
+		                  TEST_TILE_SIZES[i]);
+		if(ret)
+			return PROPEGATE_ERROR(-6, ret);
+		ret = test_index(tree, topo, TEST_TILE_SIZES[i]);
+		if(ret)
+			return PROPEGATE_ERROR(-7, ret);
+	}
+
+	/* clean up */
+	remove(TEST_SETTINGS_FILE);
+	remove(TEST_REFERENCE_FILE);
+	remove(TEST_SERIAL_FILE);
+	remove(TEST_PARALLEL_FILE);
+	return 0;
+}
+
+/* the individual tests */
+
+int test_merged(const octree_t& tree, const octtopo::octtopo_t& topo,
+                const vector<triangle_t>& reference, double tilesize)
+{
+	mesh_io::mesh_t mesh;
+	vector<triangle_t> tris;
+	int ret;
+
+	/* mesh with one thread and with several */
+	ret = tiled_mesh(TEST_SERIAL_FILE, tree, topo, tilesize, false, 1);
+	if(ret)
+		return PROPEGATE_ERROR(-1, ret);
+	ret = tiled_mesh(TEST_PARALLEL_FILE, tree, topo, tilesize, false,
+	                 NUM_TEST_THREADS);
+	if(ret)
+		return PROPEGATE_ERROR(-2, ret);
+
+	/* the thread count should not change the file */
+	if(!same_file(TEST_SERIAL_FILE, TEST_PARALLEL_FILE))
+	{
+		cerr << "[test_tiled_face_mesher]\tTile size " << tilesize
+		     << " gives a different mesh with " << NUM_TEST_THREADS
+		     << " threads" << endl;
+		return -3;
+	}
+
+	/* the tiles are meshed in a different order than the untiled
+	 * mesh, but they should make the same triangles */
+	ret = mesh.read(TEST_SERIAL_FILE);
+	if(ret)
+		return PROPEGATE_ERROR(-4, ret);
+	get_triangles(mesh, tris);
+	if(tris != reference)
+	{
+		cerr << "[test_tiled_face_mesher]\tTile size " << tilesize
+		     << " gives " << tris.size() << " triangles that "
+		     << "differ from the " << reference.size()
+		     << " triangles of the untiled mesh" << endl;
+		return -5;
+	}
+
+	/* success */
+	return 0;
+}
+
+int test_index(const octree_t& tree, const octtopo::octtopo_t& topo,
+               double tilesize)
+{
+	mesh_io::mesh_t merged, tile;
+	vector<triangle_t> merged_tris, tile_tris;
+	vector<size_t> ids;
+	vector<string> tilefiles;
+	ifstream indexfile;
+	stringstream line;
+	string label, tilefile, text;
+	double bounds[6];
+	size_t num_verts, num_tiles, num_tile_verts, num_tile_polys, i, j;
+	int ret;
+
+	/* write the tiles to their own files */
+	ret = tiled_mesh(TEST_TILES_FILE, tree, topo, tilesize, true,
+	                 NUM_TEST_THREADS);
+	if(ret)
+		return PROPEGATE_ERROR(-1, ret);
+
+	/* the merged mesh indexes vertices in the same way */
+	ret = merged.read(TEST_SERIAL_FILE);
+	if(ret)
+		return PROPEGATE_ERROR(-2, ret);
+
+	/* read the header of the index */
+	indexfile.open(TEST_INDEX_FILE);
+	if(!(indexfile.is_open()))
+		return -3;
+	indexfile >> label >> num_verts;
+	if(label != "num_vertices" || num_verts != merged.num_verts())
+	{
+		cerr << "[test_tiled_face_mesher]\tIndex lists "
+		     << num_verts << " vertices, expected "
+		     << merged.num_verts() << endl;
+		return -4;
+	}
+	indexfile >> label >> num_tiles;
+	if(label != "num_tiles" || indexfile.fail())
+		return -5;
+	getline(indexfile, text);
+
+	/* read each tile, and convert its triangles back to the
+	 * indices of the merged mesh */
+	for(i = 0; i < num_tiles; i++)
+	{
+		/* the first line describes the tile */
+		getline(indexfile, text);
+		line.clear();
+		line.str(text);
+		line >> tilefile >> num_tile_verts >> num_tile_polys;
+		for(j = 0; j < 6; j++)
+			line >> bounds[j];
+		if(line.fail())
+			return -6;
+		tilefiles.push_back(tilefile);
+
+		/* the second line lists the global vertex indices */
+		getline(indexfile, text);
+		line.clear();
+		line.str(text);
+		ids.resize(num_tile_verts);
+		for(j = 0; j < num_tile_verts; j++)
+			line >> ids[j];
+		if(line.fail())
+			return -7;
+
+		/* the tile should match its entry in the index */
+		tile.clear();
+		ret = tile.read(tilefile);
+		if(ret)
+			return PROPEGATE_ERROR(-8, ret);
+		if(tile.num_verts() != num_tile_verts
+				|| tile.num_polys() != num_tile_polys)
+		{
+			cerr << "[test_tiled_face_mesher]\tTile " << tilefile
+			     << " does not match the index" << endl;
+			return -9;
+		}
+		for(j = 0; j < num_tile_verts; j++)
+			if(ids[j] >= num_verts
+					|| tile.get_vert(j).x
+					!= merged.get_vert(ids[j]).x
+					|| tile.get_vert(j).y
+					!= merged.get_vert(ids[j]).y
+					|| tile.get_vert(j).z
+					!= merged.get_vert(ids[j]).z)
+			{
+				cerr << "[test_tiled_face_mesher]\tVertex "
+				     << j << " of tile " << tilefile
+				     << " is not at its global index" << endl;
+				return -10;
+			}
+		get_indices(tile, ids, tile_tris);
+	}
+
+	/* together, the tiles should make the merged mesh */
+	ids.clear();
+	for(i = 0; i < merged.num_verts(); i++)
+		ids.push_back(i);
+	get_indices(merged, ids, merged_tris);
+	sort(tile_tris.begin(), tile_tris.end());
+	if(tile_tris != merged_tris)
+	{
+		cerr << "[test_tiled_face_mesher]\tTile size " << tilesize
+		     << " gives tile files that differ from the merged "
+		     << "mesh" << endl;
+		return -11;
+	}
+
+	/* clean up */
+	indexfile.close();
+	for(i = 0; i < tilefiles.size(); i++)
+		remove(tilefiles[i].c_str());
+	remove(TEST_INDEX_FILE);
+	return 0;
+}
+
+/* helper functions */
+
+int tiled_mesh(const string& filename, const octree_t& tree,
+               const octtopo::octtopo_t& topo, double tilesize,
+               bool tilefiles, unsigned int numthreads)
+{
+	tiled_face_mesher_t mesher;
+	ofstream settings;
+	int ret;
+
+	/* the mesher reads its parameters from a settings file */
+	settings.open(TEST_SETTINGS_FILE);
+	if(!(settings.is_open()))
+		return -1;
+	settings << "<settings>" << endl
+	         << "\t<octsurf_dense_tile_size>" << tilesize
+	         << "</octsurf_dense_tile_size>" << endl
+	         << "\t<octsurf_dense_tile_files>" << (tilefiles ? 1 : 0)
+	         << "</octsurf_dense_tile_files>" << endl
+	         << "\t<octsurf_num_threads>" << numthreads
+	         << "</octsurf_num_threads>" << endl
+	         << "</settings>" << endl;
+	settings.close();
+	ret = mesher.import(TEST_SETTINGS_FILE);
+	if(ret)
+		return PROPEGATE_ERROR(-2, ret);
+
+	/* mesh the tree */
+	ret = mesher.write(filename, tree, topo, node_boundary_t::SEG_ALL);
+	if(ret)
+		return PROPEGATE_ERROR(-3, ret);
+
+	/* success */
+	return 0;
+}
+
+void get_triangles(const mesh_io::mesh_t& mesh, vector<triangle_t>& tris)
+{
+	vector<triangle_t> verts(3);
+	size_t i, j, first;
+
+	/* store each triangle by the positions of its vertices,
+	 * starting from the least one so that the orientation
+	 * is kept */
+	tris.clear();
+	for(i = 0; i < mesh.num_polys(); i++)
+	{
+		for(j = 0; j < 3; j++)
+		{
+			verts[j].resize(3);
+			verts[j][0] = mesh.get_vert(
+				mesh.get_poly(i).vertices[j]).x;
+			verts[j][1] = mesh.get_vert(
+				mesh.get_poly(i).vertices[j]).y;
+			verts[j][2] = mesh.get_vert(
+				mesh.get_poly(i).vertices[j]).z;
+		}
+		first = min_element(verts.begin(), verts.end())
+					- verts.begin();
+		tris.push_back(triangle_t());
+		for(j = 0; j < 3; j++)
+			tris.back().insert(tris.back().end(),
+					verts[(first + j) % 3].begin(),
+					verts[(first + j) % 3].end());
+	}
+	sort(tris.begin(), tris.end());
+}
+
+void get_indices(const mesh_io::mesh_t& mesh,
+                 const vector<size_t>& ids, vector<triangle_t>& tris)
+{
+	triangle_t inds(3);
+	size_t i, j, first;
+
+	/* store each triangle by the global indices of its vertices,
+	 * starting from the least one so that the orientation
+	 * is kept */
+	for(i = 0; i < mesh.num_polys(); i++)
+	{
+		for(j = 0; j < 3; j++)
+			inds[j] = ids[mesh.get_poly(i).vertices[j]];
+		first = min_element(inds.begin(), inds.end())
+					- inds.begin();
+		tris.push_back(triangle_t());
+		for(j = 0; j < 3; j++)
+			tris.back().push_back(inds[(first + j) % 3]);
+	}
+	sort(tris.begin(), tris.end());
+}
@@ -0,0 +1,23 @@
+#ifndef TEST_TILED_FACE_MESHER_H
+#define TEST_TILED_FACE_MESHER_H
+
+/**
+ * @file test_tiled_face_mesher.h
+ * @author Eric Turner <elturner@eecs.berkeley.edu>
+ *
+ * @section DESCRIPTION
+ *
+ * Runs unit tests for the tiled_face_mesher_t class, which check that
+ * it makes the same triangles as face_mesher_t for several tile sizes
+ * and thread counts, and that the tile files and their index describe
+ * the same mesh as the merged file.
+ */
+
+/**
+ * Runs the tests.
+ *
+ * @return   Returns zero if all pass, non-zero if failure occurs.
+ */
+int test_tiled_face_mesher();
+
+#endif
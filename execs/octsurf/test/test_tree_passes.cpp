@@ -0,0 +1,153 @@
+#include "test_tree_passes.h"
+#include <geometry/octree/octree.h>
+#include <geometry/octree/octnode.h>
+#include <geometry/octree/octdata.h>
+#include <mesh/refine/octree_padder.h>
+#include <util/error_codes.h>
+#include <util/tictoc.h>
+#include <iostream>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string>
+
+/**
+ * @file test_tree_passes.cpp
+ * @author Eric Turner <elturner@eecs.berkeley.edu>
+ *
+ * @section DESCRIPTION
+ *
+ * Runs unit tests for the parallel passes over whole octrees, which
+ * check that padding and simplifying a tree on multiple threads gives
+ * the same tree as doing so on one thread.
+ */
+
+using namespace std;
+
+/* the parameters of the test */
+#define TEST_TREE_DEPTH    8
+#define NUM_TEST_THREADS   4
+
+/* the files to write during the test */
+#define TEST_SERIAL_FILE   "build/test_tree_passes_serial.oct"
+#define TEST_PARALLEL_FILE "build/test_tree_passes_parallel.oct"
+
+/* helper functions */
+void exact_samples(octnode_t* node);
+int compare_passes(const octree_t& serial, const octree_t& parallel);
+
+/* helper functions, which are shared with other tests */
+void random_tree(octree_t& tree, unsigned int depth);
+bool same_file(const string& a, const string& b);
+
+/* the testing suite */
+int test_tree_passes()
+{
+	octree_t serial, parallel;
+	tictoc_t clk;
+	double t_pad_serial, t_pad_parallel, t_simp_serial, t_simp_parallel;
+	unsigned int n_before, n_padded;
+	int ret;
+
+	/* seed for repeatable results */
+	srand(8642);
+
+	/* make two copies of the same tree */
+	random_tree(serial, TEST_TREE_DEPTH);
+	exact_samples(serial.get_root());
+	parallel.clone_from(serial);
+	n_before = serial.get_root()->get_num_nodes();
+
+	/* pad both trees */
+	tic(clk);
+	octree_padder::pad(serial, 1);
+	t_pad_serial = toc(clk, NULL);
+	tic(clk);
+	octree_padder::pad(parallel, NUM_TEST_THREADS);
+	t_pad_parallel = toc(clk, NULL);
+	ret = compare_passes(serial, parallel);
+	if(ret)
+		return PROPEGATE_ERROR(-1, ret);
+	n_padded = serial.get_root()->get_num_nodes();
+
+	/* simplify both trees */
+	tic(clk);
+	serial.get_root()->simplify_recur();
+	t_simp_serial = toc(clk, NULL);
+	tic(clk);
+	parallel.simplify(NUM_TEST_THREADS);
+	t_simp_parallel = toc(clk, NULL);
+	ret = compare_passes(serial, parallel);
+	if(ret)
+		return PROPEGATE_ERROR(-2, ret);
+
+	/* report timing, which is not pass/fail */
+	cout << "[test_tree_passes]\t" << n_before << " nodes, "
+	     << n_padded << " padded, "
+	     << serial.get_root()->get_num_nodes() << " simplified:"
+	     << endl
+	     << "\tpad, 1 thread:          " << t_pad_serial
+	     << " sec" << endl
+	     << "\tpad, " << NUM_TEST_THREADS << " threads:         "
+	     << t_pad_parallel << " sec" << endl
+	     << "\tsimplify, 1 thread:     " << t_simp_serial
+	     << " sec" << endl
+	     << "\tsimplify, " << NUM_TEST_THREADS << " threads:    "
+	     << t_simp_parallel << " sec" << endl;
+
+	/* clean up */
+	remove(TEST_SERIAL_FILE);
+	remove(TEST_PARALLEL_FILE);
+	return 0;
+}
+
+/* helper functions */
+
+void exact_samples(octnode_t* node)
+{
+	bool interior;
+	size_t i;
+
+	/* replace the samples of each leaf with ones that are exact
+	 * in binary, so that the variances of merged nodes are not
+	 * made negative by round-off, which verify() would reject */
+	if(node->data != NULL)
+	{
+		interior = node->data->is_interior();
+		delete (node->data);
+		node->data = new octdata_t();
+		node->data->add_sample(1.0, interior ? 0.75 : 0.25);
+	}
+	for(i = 0; i < CHILDREN_PER_NODE; i++)
+		if(node->children[i] != NULL)
+			exact_samples(node->children[i]);
+}
+
+int compare_passes(const octree_t& serial, const octree_t& parallel)
+{
+	int ret;
+
+	/* both trees should be well-formed */
+	ret = serial.verify();
+	if(ret)
+		return PROPEGATE_ERROR(-1, ret);
+	ret = parallel.verify();
+	if(ret)
+		return PROPEGATE_ERROR(-2, ret);
+
+	/* and they should be identical */
+	ret = serial.serialize(TEST_SERIAL_FILE);
+	if(ret)
+		return PROPEGATE_ERROR(-3, ret);
+	ret = parallel.serialize(TEST_PARALLEL_FILE);
+	if(ret)
+		return PROPEGATE_ERROR(-4, ret);
+	if(!same_file(TEST_SERIAL_FILE, TEST_PARALLEL_FILE))
+	{
+		cerr << "[test_tree_passes]\tParallel tree differs from "
+		     << "serial tree" << endl;
+		return -5;
+	}
+
+	/* success */
+	return 0;
+}
@@ -0,0 +1,22 @@
+#ifndef TEST_TREE_PASSES_H
+#define TEST_TREE_PASSES_H
+
+/**
+ * @file test_tree_passes.h
+ * @author Eric Turner <elturner@eecs.berkeley.edu>
+ *
+ * @section DESCRIPTION
+ *
+ * Runs unit tests for the parallel passes over whole octrees, which
+ * check that padding and simplifying a tree on multiple threads gives
+ * the same tree as doing so on one thread.
+ */
+
+/**
+ * Runs the tests.
+ *
+ * @return   Returns zero if all pass, non-zero if failure occurs.
+ */
+int test_tree_passes();
+
+#endif
@@ -38,7 +38,8 @@ int main(int argc, char** argv)
 
 	/* initialize */
 	carver.init(settings.resolution, settings.num_threads, 
-				settings.interpolate);
+				settings.interpolate, settings.accuracy,
+				settings.coherent_order);
 
 	/* process */
 	ret = carver.carve_all_chunks(settings.carvemapfile,
@@ -52,7 +53,8 @@ int main(int argc, char** argv)
 	}
 
 	/* export */
-	ret = carver.serialize(settings.octfile);
+	ret = carver.serialize(settings.octfile,
+	                       settings.compress_octfile);
 	if(ret)
 	{
 		cerr << "[main]\tError " << ret << ": "
@@ -41,6 +41,9 @@ using namespace std;
 #define XML_CHUNKDIR_TAG              "procarve_chunkdir"
 #define XML_NUM_THREADS_TAG           "procarve_num_threads"
 #define XML_INTERPOLATE_TAG           "procarve_interpolate"
+#define XML_ACCURACY_TAG              "procarve_simd_accuracy"
+#define XML_COMPRESS_OCTFILE_TAG      "procarve_compress_octfile"
+#define XML_COHERENT_ORDER_TAG        "procarve_coherent_order"
 
 /* function implementations */
 		
@@ -59,6 +62,9 @@ procarve_run_settings_t::procarve_run_settings_t()
 	this->resolution  = 0.01; /* units: meters */
 	this->num_threads = 1; /* by default, don't use threading */
 	this->interpolate = true;
+	this->accuracy    = carve_map_batch_t::ACCURACY_HIGH;
+	this->compress_octfile = false;
+	this->coherent_order = false;
 }
 
 int procarve_run_settings_t::parse(int argc, char** argv)
@@ -139,6 +145,15 @@ int procarve_run_settings_t::parse(int argc, char** argv)
 	if(settings.is_prop(XML_INTERPOLATE_TAG))
 		this->interpolate 
 			= (settings.getAsUint(XML_INTERPOLATE_TAG) != 0);
+	if(settings.is_prop(XML_ACCURACY_TAG))
+		this->accuracy = (carve_map_batch_t::ACCURACY)
+			settings.getAsUint(XML_ACCURACY_TAG);
+	if(settings.is_prop(XML_COMPRESS_OCTFILE_TAG))
+		this->compress_octfile
+			= (settings.getAsUint(XML_COMPRESS_OCTFILE_TAG) != 0);
+	if(settings.is_prop(XML_COHERENT_ORDER_TAG))
+		this->coherent_order
+			= (settings.getAsUint(XML_COHERENT_ORDER_TAG) != 0);
 
 	/* we successfully populated this structure, so return */
 	toc(clk, "Importing settings");
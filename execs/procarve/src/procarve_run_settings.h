@@ -15,6 +15,7 @@
  * arguments.
  */
 
+#include <geometry/carve/gaussian/carve_map_batch.h>
 #include <string>
 #include <vector>
 
@@ -83,6 +84,27 @@ class procarve_run_settings_t
 		 */
 		bool interpolate;
 
+		/**
+		 * The accuracy level to use when evaluating carve
+		 * maps with vectorized instructions.  Lower accuracy
+		 * uses cheaper approximations of erf() and exp().
+		 */
+		carve_map_batch_t::ACCURACY accuracy;
+
+		/**
+		 * This flag indicates whether the blocks of the output
+		 * octfile should be compressed.  Compressed files are
+		 * much smaller, but much slower to write and read.
+		 */
+		bool compress_octfile;
+
+		/**
+		 * This flag indicates whether the wedges of each chunk
+		 * should be carved in a spatially coherent order, rather
+		 * than in order of their indices.
+		 */
+		bool coherent_order;
+
 	/* functions */
 	public:
 
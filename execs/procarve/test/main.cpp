@@ -0,0 +1,115 @@
+#include "test_carve_map_batch.h"
+#include "test_carve_map_io.h"
+#include "test_chunk_archive.h"
+#include "test_carve_split.h"
+#include "test_slab_allocator.h"
+#include "test_linear_octree.h"
+#include "test_octfile.h"
+#include "test_wedge_intersects.h"
+#include "test_carve_order.h"
+#include <iostream>
+
+/**
+ * @file main.cpp
+ * @author Eric Turner <elturner@eecs.berkeley.edu>
+ *
+ * @section DESCRIPTION
+ *
+ * This is the main file for the unit tests of the procarve program.
+ * Run it with 'make test' from the procarve directory.
+ */
+
+using namespace std;
+
+/**
+ * The main function for the unit tests
+ */
+int main()
+{
+	int ret;
+
+	/* run each test suite */
+	ret = test_carve_map_batch();
+	if(ret)
+	{
+		cerr << "[main]\ttest_carve_map_batch FAILED: Error "
+		     << ret << endl;
+		return 1;
+	}
+	cout << "[main]\ttest_carve_map_batch passed" << endl;
+
+	ret = test_carve_map_io();
+	if(ret)
+	{
+		cerr << "[main]\ttest_carve_map_io FAILED: Error "
+		     << ret << endl;
+		return 2;
+	}
+	cout << "[main]\ttest_carve_map_io passed" << endl;
+
+	ret = test_chunk_archive();
+	if(ret)
+	{
+		cerr << "[main]\ttest_chunk_archive FAILED: Error "
+		     << ret << endl;
+		return 3;
+	}
+	cout << "[main]\ttest_chunk_archive passed" << endl;
+
+	ret = test_carve_split();
+	if(ret)
+	{
+		cerr << "[main]\ttest_carve_split FAILED: Error "
+		     << ret << endl;
+		return 4;
+	}
+	cout << "[main]\ttest_carve_split passed" << endl;
+
+	ret = test_slab_allocator();
+	if(ret)
+	{
+		cerr << "[main]\ttest_slab_allocator FAILED: Error "
+		     << ret << endl;
+		return 5;
+	}
+	cout << "[main]\ttest_slab_allocator passed" << endl;
+
+	ret = test_linear_octree();
+	if(ret)
+	{
+		cerr << "[main]\ttest_linear_octree FAILED: Error "
+		     << ret << endl;
+		return 6;
+	}
+	cout << "[main]\ttest_linear_octree passed" << endl;
+
+	ret = test_octfile();
+	if(ret)
+	{
+		cerr << "[main]\ttest_octfile FAILED: Error "
+		     << ret << endl;
+		return 7;
+	}
+	cout << "[main]\ttest_octfile passed" << endl;
+
+	ret = test_wedge_intersects();
+	if(ret)
+	{
+		cerr << "[main]\ttest_wedge_intersects FAILED: Error "
+		     << ret << endl;
+		return 8;
+	}
+	cout << "[main]\ttest_wedge_intersects passed" << endl;
+
+	ret = test_carve_order();
+	if(ret)
+	{
+		cerr << "[main]\ttest_carve_order FAILED: Error "
+		     << ret << endl;
+		return 9;
+	}
+	cout << "[main]\ttest_carve_order passed" << endl;
+
+	/* success */
+	return 0;
+}
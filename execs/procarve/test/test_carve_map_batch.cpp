@@ -0,0 +1,373 @@
+#include "test_carve_map_batch.h"
+#include <geometry/carve/gaussian/carve_map.h>
+#include <geometry/carve/gaussian/carve_map_batch.h>
+#include <util/error_codes.h>
+#include <util/tictoc.h>
+#include <Eigen/Dense>
+#include <iostream>
+#include <stdlib.h>
+#include <cmath>
+#include <vector>
+
+/**
+ * @file test_carve_map_batch.cpp
+ * @author Eric Turner <elturner@eecs.berkeley.edu>
+ *
+ * @section DESCRIPTION
+ *
+ * Runs unit tests for the carve_map_batch_t class, which compare
+ * the vectorized evaluation of carve maps against the scalar
+ * carve_map_t functions at each accuracy level.
+ */
+
+using namespace std;
+using namespace Eigen;
+
+/* the number of random wedges and samples per wedge to test */
+#define NUM_TEST_WEDGES      200
+#define NUM_SAMPLES_PER_TEST 200
+#define NUM_BENCH_SAMPLES    2000000
+#define NUM_BENCH_LOCATIONS  4096
+#define NUM_BENCH_BLOCK      8 /* the children of a node, which
+                                     * divides NUM_BENCH_LOCATIONS */
+
+/* the relative tolerance of each accuracy level */
+#define TOLERANCE_EXACT  1e-9
+#define TOLERANCE_HIGH   1e-6
+#define TOLERANCE_FAST   2e-5
+
+/* weights below this are considered to have underflowed */
+#define NEGLIGIBLE_WEIGHT 1e-300
+
+/* the individual tests */
+int test_accuracy(carve_map_batch_t::ACCURACY acc, double tol);
+int test_block();
+void bench_batch();
+
+/* helper functions */
+double uniform(double a, double b);
+void random_maps(vector<carve_map_t>& maps);
+void random_sample(Vector3d& x, double& xsize,
+                   const vector<carve_map_t>& maps);
+void scalar_compute(const vector<carve_map_t>& maps, const Vector3d& x,
+                    double xsize, double& val, double& weight,
+                    double& surf, double& corner, double& planar);
+bool is_close(double a, double b, double tol);
+
+/* the testing suite */
+int test_carve_map_batch()
+{
+	int ret;
+
+	/* seed for repeatable results */
+	srand(1234);
+
+	/* run tests */
+	ret = test_accuracy(carve_map_batch_t::ACCURACY_EXACT,
+	                    TOLERANCE_EXACT);
+	if(ret)
+		return PROPEGATE_ERROR(-1, ret);
+
+	ret = test_accuracy(carve_map_batch_t::ACCURACY_HIGH,
+	                    TOLERANCE_HIGH);
+	if(ret)
+		return PROPEGATE_ERROR(-2, ret);
+
+	ret = test_accuracy(carve_map_batch_t::ACCURACY_FAST,
+	                    TOLERANCE_FAST);
+	if(ret)
+		return PROPEGATE_ERROR(-3, ret);
+
+	ret = test_block();
+	if(ret)
+		return PROPEGATE_ERROR(-4, ret);
+
+	/* report throughput, which is not pass/fail */
+	bench_batch();
+
+	/* success */
+	return 0;
+}
+
+int test_accuracy(carve_map_batch_t::ACCURACY acc, double tol)
+{
+	vector<carve_map_t> maps(NUM_MAPS_PER_BATCH);
+	carve_map_t* ptrs[NUM_MAPS_PER_BATCH];
+	carve_map_batch_t batch;
+	Vector3d x;
+	double xsize, v0, w0, s0, c0, p0, v1, w1, s1, c1, p1;
+	unsigned int i, j;
+
+	/* iterate over random wedges */
+	for(i = 0; i < NUM_TEST_WEDGES; i++)
+	{
+		/* pack a random set of maps */
+		random_maps(maps);
+		for(j = 0; j < NUM_MAPS_PER_BATCH; j++)
+			ptrs[j] = &(maps[j]);
+		batch.init(ptrs, acc);
+
+		/* compare at random locations around the wedge */
+		for(j = 0; j < NUM_SAMPLES_PER_TEST; j++)
+		{
+			random_sample(x, xsize, maps);
+			scalar_compute(maps, x, xsize, v0, w0, s0, c0, p0);
+			batch.compute(x, xsize, v1, w1, s1, c1, p1);
+
+			/* the approximations flush weights that are near
+			 * underflow to zero, so skip those locations */
+			if(acc != carve_map_batch_t::ACCURACY_EXACT
+					&& w0 < NEGLIGIBLE_WEIGHT)
+				continue;
+
+			/* check each output value */
+			if(!is_close(v1, v0, tol) || !is_close(w1, w0, tol)
+					|| !is_close(s1, s0, tol)
+					|| !is_close(c1, c0, tol)
+					|| !is_close(p1, p0, tol))
+			{
+				cerr << "[test_accuracy]\tMismatch at "
+				     << "accuracy " << acc << ":" << endl
+				     << "\tval:    " << v0 << " vs " << v1
+				     << endl
+				     << "\tweight: " << w0 << " vs " << w1
+				     << endl
+				     << "\tsurf:   " << s0 << " vs " << s1
+				     << endl
+				     << "\tcorner: " << c0 << " vs " << c1
+				     << endl
+				     << "\tplanar: " << p0 << " vs " << p1
+				     << endl;
+				return -1;
+			}
+		}
+	}
+
+	/* success */
+	return 0;
+}
+
+int test_block()
+{
+	vector<carve_map_t> maps(NUM_MAPS_PER_BATCH);
+	carve_map_t* ptrs[NUM_MAPS_PER_BATCH];
+	carve_map_batch_t batch;
+	Vector3d xs[NUM_SAMPLES_PER_TEST];
+	double vs[NUM_SAMPLES_PER_TEST], ws[NUM_SAMPLES_PER_TEST];
+	double ss[NUM_SAMPLES_PER_TEST], cs[NUM_SAMPLES_PER_TEST];
+	double ps[NUM_SAMPLES_PER_TEST];
+	double xsize, v, w, s, c, p;
+	unsigned int i, n, acc;
+
+	/* pack a random set of maps */
+	random_maps(maps);
+	for(i = 0; i < NUM_MAPS_PER_BATCH; i++)
+		ptrs[i] = &(maps[i]);
+	for(i = 0; i < NUM_SAMPLES_PER_TEST; i++)
+		random_sample(xs[i], xsize, maps);
+	xsize = 0.125;
+
+	/* the block is evaluated one location per lane, so leave
+	 * a partial set of lanes at its end */
+	n = NUM_SAMPLES_PER_TEST - 1;
+	for(acc = carve_map_batch_t::ACCURACY_EXACT;
+			acc <= carve_map_batch_t::ACCURACY_FAST; acc++)
+	{
+		/* evaluate a block of locations */
+		batch.init(ptrs, (carve_map_batch_t::ACCURACY) acc);
+		batch.compute_block(n, xs, xsize, vs, ws, ss, cs, ps);
+
+		/* block results should be exactly the per-location
+		 * results */
+		for(i = 0; i < n; i++)
+		{
+			batch.compute(xs[i], xsize, v, w, s, c, p);
+			if(!is_close(v, vs[i], 0) || !is_close(w, ws[i], 0)
+					|| !is_close(s, ss[i], 0)
+					|| !is_close(c, cs[i], 0)
+					|| !is_close(p, ps[i], 0))
+			{
+				cerr << "[test_block]\tBlock result #" << i
+				     << " differs from single result at "
+				     << "accuracy " << acc << endl;
+				return -1;
+			}
+		}
+	}
+
+	/* success */
+	return 0;
+}
+
+void bench_batch()
+{
+	vector<carve_map_t> maps(NUM_MAPS_PER_BATCH);
+	carve_map_t* ptrs[NUM_MAPS_PER_BATCH];
+	carve_map_batch_t batch;
+	vector<Vector3d> xs(NUM_BENCH_LOCATIONS);
+	Vector3d c0;
+	double vs[NUM_BENCH_BLOCK], ws[NUM_BENCH_BLOCK], ss[NUM_BENCH_BLOCK];
+	double cs[NUM_BENCH_BLOCK], ps[NUM_BENCH_BLOCK];
+	double xsize, v, w, s, c, p, sum, t_scalar, t_batch, t_block;
+	unsigned int i, j;
+	tictoc_t clk;
+
+	/* pack a random set of maps, and pick representative
+	 * locations around them */
+	random_maps(maps);
+	for(i = 0; i < NUM_MAPS_PER_BATCH; i++)
+		ptrs[i] = &(maps[i]);
+	batch.init(ptrs, carve_map_batch_t::ACCURACY_HIGH);
+	xsize = 0.125;
+	for(i = 0; i < NUM_BENCH_LOCATIONS; i += NUM_BENCH_BLOCK)
+	{
+		/* carving applies a wedge to the children of a node
+		 * together, so the locations are the leaves of nodes */
+		random_sample(c0, p, maps);
+		for(j = 0; j < NUM_BENCH_BLOCK; j++)
+			xs[i+j] = c0 + 0.5*xsize*Vector3d(
+					(j & 1) ? 1 : -1, (j & 2) ? 1 : -1,
+					(j & 4) ? 1 : -1);
+	}
+
+	/* time the scalar path */
+	sum = 0;
+	tic(clk);
+	for(i = 0; i < NUM_BENCH_SAMPLES; i++)
+	{
+		scalar_compute(maps, xs[i % NUM_BENCH_LOCATIONS], xsize,
+		               v, w, s, c, p);
+		sum += w;
+	}
+	t_scalar = toc(clk, NULL);
+
+	/* time the vectorized path */
+	tic(clk);
+	for(i = 0; i < NUM_BENCH_SAMPLES; i++)
+	{
+		batch.compute(xs[i % NUM_BENCH_LOCATIONS], xsize,
+		              v, w, s, c, p);
+		sum += w;
+	}
+	t_batch = toc(clk, NULL);
+
+	/* time blocks of sibling leaves, as carve_wedge_t does */
+	tic(clk);
+	for(i = 0; i < NUM_BENCH_SAMPLES; i += NUM_BENCH_BLOCK)
+	{
+		batch.compute_block(NUM_BENCH_BLOCK,
+		                    &(xs[i % NUM_BENCH_LOCATIONS]), xsize,
+		                    vs, ws, ss, cs, ps);
+		for(j = 0; j < NUM_BENCH_BLOCK; j++)
+			sum += ws[j];
+	}
+	t_block = toc(clk, NULL);
+
+	/* report */
+	cout << "[bench_batch]\tleaf updates per second:" << endl
+	     << "\tscalar:  " << (NUM_BENCH_SAMPLES / t_scalar) << endl
+	     << "\tbatched: " << (NUM_BENCH_SAMPLES / t_batch) << endl
+	     << "\tblocks:  " << (NUM_BENCH_SAMPLES / t_block) << endl
+	     << "\tspeedup: " << (t_scalar / t_batch) << "x batched, "
+	     << (t_scalar / t_block) << "x blocks"
+	     << " (checksum " << sum << ")" << endl;
+}
+
+/* helper functions */
+
+double uniform(double a, double b)
+{
+	return a + (b-a) * (((double) rand()) / RAND_MAX);
+}
+
+void random_maps(vector<carve_map_t>& maps)
+{
+	Vector3d s, p, dir;
+	Matrix3d A, sc, pc;
+	unsigned int i, j, k;
+
+	/* the maps of a wedge share a sensor position, in pairs */
+	for(i = 0; i < maps.size(); i++)
+	{
+		/* pick the sensor position for each frame */
+		if(i % 2 == 0)
+			s << uniform(-5,5), uniform(-5,5), uniform(-5,5);
+
+		/* pick a scan direction and range */
+		dir << uniform(-1,1), uniform(-1,1), uniform(-1,1);
+		dir.normalize();
+		p = s + uniform(0.5, 10.0)*dir;
+
+		/* make random positive-definite covariances */
+		for(j = 0; j < 3; j++)
+			for(k = 0; k < 3; k++)
+				A(j,k) = uniform(-0.05, 0.05);
+		sc = A*A.transpose() + 1e-4*Matrix3d::Identity();
+		for(j = 0; j < 3; j++)
+			for(k = 0; k < 3; k++)
+				A(j,k) = uniform(-0.1, 0.1);
+		pc = A*A.transpose() + 1e-4*Matrix3d::Identity();
+
+		/* initialize the map */
+		maps[i].init(s, sc, p, pc);
+		maps[i].set_planar_prob(uniform(0,1));
+		maps[i].set_corner_prob(uniform(0,1));
+	}
+}
+
+void random_sample(Vector3d& x, double& xsize,
+                   const vector<carve_map_t>& maps)
+{
+	Vector3d s, p, n;
+	double t;
+
+	/* pick a location along the ray of a random map, beyond
+	 * the ends of the ray, and offset laterally from it */
+	maps[rand() % maps.size()].get_sensor_mean(s);
+	maps[rand() % maps.size()].get_scanpoint_mean(p);
+	t = uniform(-0.2, 1.2);
+	n << uniform(-0.3,0.3), uniform(-0.3,0.3), uniform(-0.3,0.3);
+	x = s + t*(p-s) + n;
+
+	/* pick a size that matches typical carving resolutions */
+	xsize = 0.0625 * (1 << (rand() % 4));
+}
+
+void scalar_compute(const vector<carve_map_t>& maps, const Vector3d& x,
+                    double xsize, double& val, double& weight,
+                    double& surf, double& corner, double& planar)
+{
+	double vi, wi;
+	unsigned int i;
+
+	/* this is the original loop of carve_wedge_t::apply_to_leaf() */
+	val = 0;
+	surf = 1;
+	corner = 0;
+	planar = 0;
+	weight = wi = 0;
+	for(i = 0; i < maps.size(); i++)
+	{
+		vi      = maps[i].compute(x, xsize, wi);
+		val    += wi*vi;
+		weight += wi;
+		surf   *= (1-maps[i].get_surface_prob(x, xsize));
+		corner += wi*maps[i].get_corner_prob();
+		planar += wi*maps[i].get_planar_prob();
+	}
+	val    /= weight;
+	surf    = 1 - surf;
+	corner /= weight;
+	planar /= weight;
+}
+
+bool is_close(double a, double b, double tol)
+{
+	/* locations with zero total weight are undefined in both
+	 * implementations, so they should agree on that */
+	if(std::isnan(a) || std::isnan(b))
+		return (std::isnan(a) && std::isnan(b));
+
+	/* relative error for large values, absolute for small ones */
+	return (fabs(a - b) <= tol * max(1.0, fabs(b)));
+}
@@ -0,0 +1,22 @@
+#ifndef TEST_CARVE_MAP_BATCH_H
+#define TEST_CARVE_MAP_BATCH_H
+
+/**
+ * @file test_carve_map_batch.h
+ * @author Eric Turner <elturner@eecs.berkeley.edu>
+ *
+ * @section DESCRIPTION
+ *
+ * Runs unit tests for the carve_map_batch_t class, which compare
+ * the vectorized evaluation of carve maps against the scalar
+ * carve_map_t functions at each accuracy level.
+ */
+
+/**
+ * Runs the tests.
+ *
+ * @return   Returns zero if all pass, non-zero if failure occurs.
+ */
+int test_carve_map_batch();
+
+#endif
@@ -0,0 +1,223 @@
+#include "test_carve_map_io.h"
+#include <io/carve/carve_map_io.h>
+#include <geometry/carve/gaussian/carve_map.h>
+#include <util/error_codes.h>
+#include <Eigen/Dense>
+#include <iostream>
+#include <fstream>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <thread>
+
+/**
+ * @file test_carve_map_io.cpp
+ * @author Eric Turner <elturner@eecs.berkeley.edu>
+ *
+ * @section DESCRIPTION
+ *
+ * Runs unit tests for the cm_io::reader_t class, which write a small
+ * .carvemap file and verify that it reads back correctly, including
+ * from several threads at once, and that a corrupt header is rejected.
+ */
+
+using namespace std;
+using namespace Eigen;
+
+/* the size of the test file */
+#define NUM_TEST_FRAMES      20
+#define NUM_POINTS_PER_FRAME 50
+#define NUM_TEST_THREADS     4
+
+/* the file to write during the test */
+#define TEST_FILE "build/test_carve_map_io.carvemap"
+
+/* helper functions */
+void make_frame(vector<carve_map_t>& frame);
+bool same_map(const carve_map_t& a, const carve_map_t& b);
+void read_all(const cm_io::reader_t* reader,
+              const vector<vector<carve_map_t> >* frames, int* ret);
+
+/* the testing suite */
+int test_carve_map_io()
+{
+	vector<vector<carve_map_t> > frames(NUM_TEST_FRAMES);
+	vector<bool> valid;
+	cm_io::writer_t outfile;
+	cm_io::reader_t infile;
+	vector<thread> threads;
+	int rets[NUM_TEST_THREADS];
+	carve_map_t cm;
+	fstream corrupt;
+	size_t num_frames;
+	unsigned int i;
+	int ret;
+
+	/* write a file of random frames */
+	ret = outfile.open(TEST_FILE);
+	if(ret)
+		return PROPEGATE_ERROR(-1, ret);
+	for(i = 0; i < NUM_TEST_FRAMES; i++)
+	{
+		make_frame(frames[i]);
+		ret = outfile.write_frame(&(frames[i][0]),
+		                          frames[i].size(), valid);
+		if(ret)
+			return PROPEGATE_ERROR(-2, ret);
+	}
+	outfile.close();
+
+	/* read it back */
+	ret = infile.open(TEST_FILE);
+	if(ret)
+		return PROPEGATE_ERROR(-3, ret);
+	if(infile.num_frames() != NUM_TEST_FRAMES
+		|| infile.num_points_in_frame(0) != NUM_POINTS_PER_FRAME)
+	{
+		cerr << "[test_carve_map_io]\tWrong file size" << endl;
+		return -4;
+	}
+
+	/* out-of-range indices should fail */
+	if(!infile.read(cm, NUM_TEST_FRAMES, 0)
+			|| !infile.read(cm, 0, NUM_POINTS_PER_FRAME))
+	{
+		cerr << "[test_carve_map_io]\tRead out of range" << endl;
+		return -5;
+	}
+
+	/* read every map from several threads at once */
+	for(i = 0; i < NUM_TEST_THREADS; i++)
+		threads.push_back(thread(read_all, &infile, &frames,
+		                         &(rets[i])));
+	for(i = 0; i < NUM_TEST_THREADS; i++)
+		threads[i].join();
+	for(i = 0; i < NUM_TEST_THREADS; i++)
+		if(rets[i])
+			return PROPEGATE_ERROR(-6, rets[i]);
+
+	infile.close();
+
+	/* a header that claims more frames than the file can hold
+	 * should be rejected before anything is allocated */
+	num_frames = ((size_t) -1) / 2;
+	corrupt.open(TEST_FILE, ios::in | ios::out | ios::binary);
+	corrupt.seekp(cm_io::MAGIC_NUMBER_SIZE);
+	corrupt.write((const char*) &num_frames, sizeof(num_frames));
+	corrupt.close();
+	if(!infile.open(TEST_FILE))
+	{
+		cerr << "[test_carve_map_io]\tAccepted corrupt header"
+		     << endl;
+		return -7;
+	}
+
+	/* clean up */
+	remove(TEST_FILE);
+	return 0;
+}
+
+/* helper functions */
+
+void make_frame(vector<carve_map_t>& frame)
+{
+	Vector3d s, p;
+	Matrix3d A, sc, pc;
+	unsigned int i;
+
+	/* all points in a frame share a sensor distribution */
+	s = 5*Vector3d::Random();
+	A = 0.05*Matrix3d::Random();
+	sc = A*A.transpose() + 1e-4*Matrix3d::Identity();
+	sc = 0.5*(sc + sc.transpose()).eval(); /* file stores upper half */
+
+	/* make random scan points */
+	frame.resize(NUM_POINTS_PER_FRAME);
+	for(i = 0; i < NUM_POINTS_PER_FRAME; i++)
+	{
+		p = s + 10*Vector3d::Random();
+		A = 0.1*Matrix3d::Random();
+		pc = A*A.transpose() + 1e-4*Matrix3d::Identity();
+		pc = 0.5*(pc + pc.transpose()).eval();
+		frame[i].init(s, sc, p, pc);
+		frame[i].set_planar_prob(((double) rand()) / RAND_MAX);
+		frame[i].set_corner_prob(((double) rand()) / RAND_MAX);
+	}
+}
+
+bool same_map(const carve_map_t& a, const carve_map_t& b)
+{
+	Vector3d am, bm, x;
+	Matrix3d ac, bc;
+	unsigned int i;
+
+	/* compare the stored distributions */
+	a.get_sensor_mean(am); b.get_sensor_mean(bm);
+	a.get_sensor_cov(ac);  b.get_sensor_cov(bc);
+	if(am != bm || ac != bc)
+		return false;
+	a.get_scanpoint_mean(am); b.get_scanpoint_mean(bm);
+	a.get_scanpoint_cov(ac);  b.get_scanpoint_cov(bc);
+	if(am != bm || ac != bc)
+		return false;
+	if(a.get_planar_prob() != b.get_planar_prob()
+			|| a.get_corner_prob() != b.get_corner_prob())
+		return false;
+
+	/* the cached parameters should also match, so compare
+	 * their outputs along the ray */
+	for(i = 0; i <= 10; i++)
+	{
+		x = (1 - 0.1*i)*(*(a.get_sensor_mean_ptr()))
+			+ 0.1*i*(*(a.get_scanpoint_mean_ptr()));
+		x(0) += 0.01;
+		if(a.compute(x, 0.1) != b.compute(x, 0.1))
+			return false;
+	}
+	return true;
+}
+
+void read_all(const cm_io::reader_t* reader,
+              const vector<vector<carve_map_t> >* frames, int* ret)
+{
+	Vector3d s, p, s0, p0;
+	carve_map_t cm;
+	size_t f, i;
+	double var;
+
+	/* read every map and compare to the original */
+	*ret = 0;
+	for(f = 0; f < frames->size(); f++)
+		for(i = 0; i < (*frames)[f].size(); i++)
+		{
+			if(reader->read(cm, f, i))
+			{
+				*ret = -1;
+				return;
+			}
+			if(!same_map(cm, (*frames)[f][i]))
+			{
+				cerr << "[test_carve_map_io]\tMap (" << f
+				     << ", " << i << ") differs" << endl;
+				*ret = -2;
+				return;
+			}
+
+			/* the partial read should give the same shape */
+			if(reader->read_extent(s, p, var, f, i))
+			{
+				*ret = -3;
+				return;
+			}
+			cm.get_sensor_mean(s0);
+			cm.get_scanpoint_mean(p0);
+			if(s != s0 || p != p0 || var != cm.get_scanpoint_var())
+			{
+				cerr << "[test_carve_map_io]\tExtent of map ("
+				     << f << ", " << i << ") differs" << endl;
+				*ret = -4;
+				return;
+			}
+		}
+}
@@ -0,0 +1,22 @@
+#ifndef TEST_CARVE_MAP_IO_H
+#define TEST_CARVE_MAP_IO_H
+
+/**
+ * @file test_carve_map_io.h
+ * @author Eric Turner <elturner@eecs.berkeley.edu>
+ *
+ * @section DESCRIPTION
+ *
+ * Runs unit tests for the cm_io::reader_t class, which write a small
+ * .carvemap file and verify that it reads back correctly, including
+ * from several threads at once.
+ */
+
+/**
+ * Runs the tests.
+ *
+ * @return   Returns zero if all pass, non-zero if failure occurs.
+ */
+int test_carve_map_io();
+
+#endif
@@ -0,0 +1,248 @@
+#include "test_carve_order.h"
+#include <geometry/carve/random_carver.h>
+#include <geometry/carve/gaussian/carve_map.h>
+#include <geometry/shapes/carve_wedge.h>
+#include <geometry/octree/octree.h>
+#include <geometry/octree/octdata.h>
+#include <geometry/octree/linear_octree.h>
+#include <io/carve/carve_map_io.h>
+#include <io/carve/wedge_io.h>
+#include <io/carve/chunk_io.h>
+#include <util/error_codes.h>
+#include <util/tictoc.h>
+#include <Eigen/Dense>
+#include <iostream>
+#include <stdio.h>
+#include <cmath>
+#include <string>
+#include <set>
+
+/**
+ * @file test_carve_order.cpp
+ * @author Eric Turner <elturner@eecs.berkeley.edu>
+ *
+ * @section DESCRIPTION
+ *
+ * Runs unit tests for the order in which the wedges of a chunk are
+ * carved, which check that starting each wedge below the chunk's
+ * node gives the same tree as inserting it from the chunk's node,
+ * and that carving in a spatially coherent order gives the same
+ * tree up to rounding.
+ */
+
+using namespace std;
+using namespace Eigen;
+
+/* the geometry of the test tree, which matches test_carve_split */
+#define TREE_HALFWIDTH  1.6
+#define TREE_RESOLUTION 0.1
+
+/* the files written by write_scan() in test_carve_split */
+#define TEST_CARVEMAP_FILE "build/test_carve_split.carvemap"
+#define TEST_WEDGE_FILE    "build/test_carve_split.wedge"
+
+/* the files to write during the test */
+#define TEST_ROOTED_FILE   "build/test_carve_order_rooted.oct"
+#define TEST_INDEX_FILE    "build/test_carve_order_index.oct"
+
+/* how closely the coherent tree must match, relative to the
+ * magnitude of each value */
+#define ROUNDING_TOLERANCE 1e-9
+
+/* helper functions, which are shared with test_carve_split */
+int write_scan(set<chunk::point_index_t>& inds);
+bool same_file(const string& a, const string& b);
+
+/* helper functions */
+int carve_rooted(octnode_t* node, unsigned int depth,
+                 const set<chunk::point_index_t>& inds,
+                 cm_io::reader_t& carvemaps, wedge::reader_t& wedges);
+int compare_trees(const octree_t& a, const octree_t& b);
+bool nearly_equal(double a, double b);
+
+/* the testing suite */
+int test_carve_order()
+{
+	set<chunk::point_index_t> inds;
+	cm_io::reader_t carvemaps;
+	wedge::reader_t wedges;
+	octree_t rooted, index, coherent;
+	chunk_stats_t index_stats, coherent_stats;
+	double rooted_time, index_time, coherent_time;
+	octnode_t* node;
+	unsigned int depth;
+	tictoc_t clk;
+	int ret;
+
+	/* make the input files */
+	ret = write_scan(inds);
+	if(ret)
+		return PROPEGATE_ERROR(-1, ret);
+	ret = carvemaps.open(TEST_CARVEMAP_FILE);
+	if(ret)
+		return PROPEGATE_ERROR(-2, ret);
+	ret = wedges.open(TEST_WEDGE_FILE);
+	if(ret)
+		return PROPEGATE_ERROR(-3, ret);
+
+	/* insert every wedge from the chunk's node */
+	rooted.set(Vector3d::Zero(), TREE_HALFWIDTH, TREE_RESOLUTION);
+	node = rooted.expand(Vector3d::Zero(), TREE_HALFWIDTH, depth);
+	tic(clk);
+	ret = carve_rooted(node, depth, inds, carvemaps, wedges);
+	rooted_time = toc(clk, NULL);
+	if(ret)
+		return PROPEGATE_ERROR(-4, ret);
+
+	/* carve in index order, which should give the same tree */
+	index.set(Vector3d::Zero(), TREE_HALFWIDTH, TREE_RESOLUTION);
+	node = index.expand(Vector3d::Zero(), TREE_HALFWIDTH, depth);
+	tic(clk);
+	ret = random_carver_t::carve_node(node, inds, carvemaps, wedges,
+			depth, true, false, carve_map_batch_t::ACCURACY_HIGH,
+			false, &index_stats);
+	index_time = toc(clk, NULL);
+	if(ret)
+		return PROPEGATE_ERROR(-5, ret);
+	ret = rooted.serialize(TEST_ROOTED_FILE);
+	if(ret)
+		return PROPEGATE_ERROR(-6, ret);
+	ret = index.serialize(TEST_INDEX_FILE);
+	if(ret)
+		return PROPEGATE_ERROR(-7, ret);
+	if(!same_file(TEST_ROOTED_FILE, TEST_INDEX_FILE))
+	{
+		cerr << "[test_carve_order]\tCarving from start nodes "
+		     << "differs from carving from the chunk" << endl;
+		return -8;
+	}
+
+	/* carve in coherent order, which changes the order that
+	 * values are summed, so can only match up to rounding */
+	coherent.set(Vector3d::Zero(), TREE_HALFWIDTH, TREE_RESOLUTION);
+	node = coherent.expand(Vector3d::Zero(), TREE_HALFWIDTH, depth);
+	tic(clk);
+	ret = random_carver_t::carve_node(node, inds, carvemaps, wedges,
+			depth, true, false, carve_map_batch_t::ACCURACY_HIGH,
+			true, &coherent_stats);
+	coherent_time = toc(clk, NULL);
+	if(ret)
+		return PROPEGATE_ERROR(-9, ret);
+	ret = compare_trees(index, coherent);
+	if(ret)
+	{
+		cerr << "[test_carve_order]\tCarving in coherent order "
+		     << "differs from carving in index order" << endl;
+		return PROPEGATE_ERROR(-10, ret);
+	}
+
+	/* both orders should read fewer carve maps than they use */
+	if(index_stats.num_map_reads >= index_stats.num_map_gets
+			|| coherent_stats.num_map_reads
+				>= coherent_stats.num_map_gets)
+	{
+		cerr << "[test_carve_order]\tCarve map cache was "
+		     << "never used" << endl;
+		return -11;
+	}
+
+	/* report, which is not pass/fail */
+	cout << "[test_carve_order]\t" << inds.size() << " wedges:" << endl
+	     << "\tfrom chunk:     " << rooted_time << " sec, "
+	     << NUM_MAPS_PER_WEDGE << " carve maps read per wedge" << endl
+	     << "\tindex order:    " << index_time << " sec, "
+	     << ((NUM_MAPS_PER_WEDGE * (double) index_stats.num_map_reads)
+			/ index_stats.num_map_gets)
+	     << " carve maps read per wedge" << endl
+	     << "\tcoherent order: " << coherent_time << " sec, "
+	     << ((NUM_MAPS_PER_WEDGE
+	          * (double) coherent_stats.num_map_reads)
+			/ coherent_stats.num_map_gets)
+	     << " carve maps read per wedge" << endl;
+
+	/* clean up */
+	carvemaps.close();
+	wedges.close();
+	remove(TEST_CARVEMAP_FILE);
+	remove(TEST_WEDGE_FILE);
+	remove(TEST_ROOTED_FILE);
+	remove(TEST_INDEX_FILE);
+	return 0;
+}
+
+/* helper functions */
+
+int carve_rooted(octnode_t* node, unsigned int depth,
+                 const set<chunk::point_index_t>& inds,
+                 cm_io::reader_t& carvemaps, wedge::reader_t& wedges)
+{
+	set<chunk::point_index_t>::const_iterator it;
+	unsigned int ia, ia1, ia2, ib, ib1, ib2;
+	carve_map_t a1, a2, b1, b2;
+	carve_wedge_t w;
+	int ret;
+
+	/* carve each wedge in the same way as carve_node() did
+	 * before it found start nodes */
+	for(it = inds.begin(); it != inds.end(); it++)
+	{
+		ret = wedges.get(ia, ia1, ia2, ib, ib1, ib2,
+				it->wedge_index);
+		if(ret)
+			return PROPEGATE_ERROR(-1, ret);
+		if(carvemaps.read(a1, ia, ia1) || carvemaps.read(a2, ia, ia2)
+				|| carvemaps.read(b1, ib, ib1)
+				|| carvemaps.read(b2, ib, ib2))
+			return -2;
+		w.init(&a1, &a2, &b1, &b2, wedges.carving_buf(), true);
+		node->insert(w, depth);
+	}
+	node->simplify_recur();
+	return 0;
+}
+
+int compare_trees(const octree_t& a, const octree_t& b)
+{
+	linear_octree_t la, lb;
+	octdata_t da, db;
+	size_t i;
+	int ret;
+
+	/* the linear trees list the nodes with data in order */
+	ret = la.init(a);
+	if(ret)
+		return PROPEGATE_ERROR(-1, ret);
+	ret = lb.init(b);
+	if(ret)
+		return PROPEGATE_ERROR(-2, ret);
+	if(la.size() != lb.size())
+		return -3;
+	for(i = 0; i < la.size(); i++)
+	{
+		/* the nodes should be the same */
+		if(la.get_depth(i) != lb.get_depth(i)
+				|| la.get_center(i) != lb.get_center(i))
+			return -4;
+
+		/* their data should match up to rounding */
+		la.get_data(i, da);
+		lb.get_data(i, db);
+		if(da.get_count() != db.get_count()
+				|| !nearly_equal(da.get_total_weight(),
+				          db.get_total_weight())
+				|| !nearly_equal(da.get_probability(),
+				          db.get_probability())
+				|| !nearly_equal(da.get_surface_prob(),
+				          db.get_surface_prob()))
+			return -5;
+	}
+
+	/* success */
+	return 0;
+}
+
+bool nearly_equal(double a, double b)
+{
+	return (fabs(a - b) <= ROUNDING_TOLERANCE
+			* max(1.0, max(fabs(a), fabs(b))));
+}
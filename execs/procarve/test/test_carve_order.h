@@ -0,0 +1,24 @@
+#ifndef TEST_CARVE_ORDER_H
+#define TEST_CARVE_ORDER_H
+
+/**
+ * @file test_carve_order.h
+ * @author Eric Turner <elturner@eecs.berkeley.edu>
+ *
+ * @section DESCRIPTION
+ *
+ * Runs unit tests for the order in which the wedges of a chunk are
+ * carved, which check that starting each wedge below the chunk's
+ * node gives the same tree as inserting it from the chunk's node,
+ * and that carving in a spatially coherent order gives the same
+ * tree up to rounding.
+ */
+
+/**
+ * Runs the tests.
+ *
+ * @return   Returns zero if all pass, non-zero if failure occurs.
+ */
+int test_carve_order();
+
+#endif
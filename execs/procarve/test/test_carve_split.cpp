@@ -0,0 +1,222 @@
+#include "test_carve_split.h"
+#include <geometry/carve/random_carver.h>
+#include <geometry/carve/gaussian/carve_map.h>
+#include <geometry/octree/octree.h>
+#include <io/carve/carve_map_io.h>
+#include <io/carve/wedge_io.h>
+#include <io/carve/chunk_io.h>
+#include <util/error_codes.h>
+#include <boost/threadpool.hpp>
+#include <Eigen/Dense>
+#include <iostream>
+#include <fstream>
+#include <iterator>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <set>
+
+/**
+ * @file test_carve_split.cpp
+ * @author Eric Turner <elturner@eecs.berkeley.edu>
+ *
+ * @section DESCRIPTION
+ *
+ * Runs unit tests for splitting the carving of a chunk into
+ * sub-octant tasks, which verify that the carved tree is the same
+ * as when the chunk is carved by a single call.
+ */
+
+using namespace std;
+using namespace Eigen;
+
+/* the size of the test scan, which should have enough wedges
+ * for the chunk to be split several times */
+#define NUM_TEST_FRAMES      20
+#define NUM_POINTS_PER_FRAME 40
+#define NUM_TEST_THREADS     4
+
+/* the geometry of the test tree */
+#define TREE_HALFWIDTH  1.6
+#define TREE_RESOLUTION 0.1
+#define CARVE_BUF       2.0
+
+/* the files to write during the test */
+#define TEST_CARVEMAP_FILE "build/test_carve_split.carvemap"
+#define TEST_WEDGE_FILE    "build/test_carve_split.wedge"
+#define TEST_SERIAL_FILE   "build/test_carve_split_serial.oct"
+#define TEST_SPLIT_FILE    "build/test_carve_split_split.oct"
+
+/* helper functions */
+int compare_carvings(const set<chunk::point_index_t>& inds);
+int write_scan(set<chunk::point_index_t>& inds);
+bool same_file(const string& a, const string& b);
+void remove_test_files();
+
+/* the testing suite */
+int test_carve_split()
+{
+	set<chunk::point_index_t> inds;
+	int ret;
+
+	/* make the input files, and carve them both ways.  The test
+	 * files are removed whether or not the carvings match */
+	ret = write_scan(inds);
+	if(ret)
+	{
+		remove_test_files();
+		return PROPEGATE_ERROR(-1, ret);
+	}
+	ret = compare_carvings(inds);
+	remove_test_files();
+	if(ret)
+		return PROPEGATE_ERROR(-2, ret);
+
+	/* success */
+	return 0;
+}
+
+/* helper functions */
+
+int compare_carvings(const set<chunk::point_index_t>& inds)
+{
+	cm_io::reader_t carvemaps;
+	wedge::reader_t wedges;
+	octree_t serial, split;
+	octnode_t* node;
+	carve_job_t* job;
+	chunk_stats_t stats;
+	unsigned int depth;
+	int ret;
+
+	/* open the input files */
+	ret = carvemaps.open(TEST_CARVEMAP_FILE);
+	if(ret)
+		return PROPEGATE_ERROR(-2, ret);
+	ret = wedges.open(TEST_WEDGE_FILE);
+	if(ret)
+		return PROPEGATE_ERROR(-3, ret);
+
+	/* carve the whole chunk in one call */
+	serial.set(Vector3d::Zero(), TREE_HALFWIDTH, TREE_RESOLUTION);
+	node = serial.expand(Vector3d::Zero(), TREE_HALFWIDTH, depth);
+	ret = random_carver_t::carve_node(node, inds, carvemaps,
+			wedges, depth, true, false);
+	if(ret)
+		return PROPEGATE_ERROR(-4, ret);
+
+	/* carve it again, split across threads */
+	split.set(Vector3d::Zero(), TREE_HALFWIDTH, TREE_RESOLUTION);
+	node = split.expand(Vector3d::Zero(), TREE_HALFWIDTH, depth);
+	{
+		boost::threadpool::prio_pool tp(NUM_TEST_THREADS);
+		job = new carve_job_t(node, NULL, &stats);
+		ret = random_carver_t::carve_subtree(&tp, job, inds,
+				carvemaps, wedges, depth, true,
+				carve_map_batch_t::ACCURACY_HIGH);
+		tp.wait();
+	}
+	if(ret)
+		return PROPEGATE_ERROR(-5, ret);
+	if(stats.num_tasks <= 1)
+	{
+		cerr << "[test_carve_split]\tChunk was not split" << endl;
+		return -6;
+	}
+
+	/* the trees should be identical */
+	ret = serial.serialize(TEST_SERIAL_FILE);
+	if(ret)
+		return PROPEGATE_ERROR(-7, ret);
+	ret = split.serialize(TEST_SPLIT_FILE);
+	if(ret)
+		return PROPEGATE_ERROR(-8, ret);
+	if(!same_file(TEST_SERIAL_FILE, TEST_SPLIT_FILE))
+	{
+		cerr << "[test_carve_split]\tSplit carving differs from "
+		     << "serial carving" << endl;
+		return -9;
+	}
+
+	/* clean up */
+	carvemaps.close();
+	wedges.close();
+	return 0;
+}
+
+int write_scan(set<chunk::point_index_t>& inds)
+{
+	vector<carve_map_t> frame(NUM_POINTS_PER_FRAME);
+	cm_io::writer_t cmfile;
+	wedge::writer_t wedgefile;
+	vector<bool> valid;
+	Vector3d s, p;
+	Matrix3d sc, pc;
+	unsigned int f, i;
+	double theta;
+	int ret;
+
+	/* open the files */
+	ret = cmfile.open(TEST_CARVEMAP_FILE);
+	if(ret)
+		return PROPEGATE_ERROR(-1, ret);
+	ret = wedgefile.open(TEST_WEDGE_FILE, CARVE_BUF);
+	if(ret)
+		return PROPEGATE_ERROR(-2, ret);
+
+	/* the sensor walks across the middle of the tree, and
+	 * sweeps a fan of points onto the walls */
+	sc = 1e-4*Matrix3d::Identity();
+	pc = 4e-4*Matrix3d::Identity();
+	for(f = 0; f < NUM_TEST_FRAMES; f++)
+	{
+		s << -1.0 + (2.0*f)/NUM_TEST_FRAMES, 0.1, 0.05;
+		for(i = 0; i < NUM_POINTS_PER_FRAME; i++)
+		{
+			theta = (2*M_PI*i) / NUM_POINTS_PER_FRAME;
+			p << s(0), 1.4*cos(theta), 1.4*sin(theta);
+			frame[i].init(s, sc, p, pc);
+			frame[i].set_planar_prob(0.5);
+			frame[i].set_corner_prob(0.1);
+		}
+		ret = cmfile.write_frame(&(frame[0]), frame.size(), valid);
+		if(ret)
+			return PROPEGATE_ERROR(-3, ret);
+	}
+
+	/* connect adjacent points of adjacent frames */
+	inds.clear();
+	for(f = 0; f+1 < NUM_TEST_FRAMES; f++)
+		for(i = 0; i+1 < NUM_POINTS_PER_FRAME; i++)
+		{
+			inds.insert(chunk::point_index_t(
+				wedgefile.num_wedges_written()));
+			wedgefile.write(f, i, i+1, f+1, i, i+1);
+		}
+
+	/* clean up */
+	cmfile.close();
+	wedgefile.close();
+	return 0;
+}
+
+bool same_file(const string& a, const string& b)
+{
+	ifstream fa(a.c_str(), ios::binary), fb(b.c_str(), ios::binary);
+	
+	/* compare the full contents */
+	return (fa.is_open() && fb.is_open()
+		&& string(istreambuf_iterator<char>(fa),
+		          istreambuf_iterator<char>())
+		== string(istreambuf_iterator<char>(fb),
+		          istreambuf_iterator<char>()));
+}
+
+void remove_test_files()
+{
+	remove(TEST_CARVEMAP_FILE);
+	remove(TEST_WEDGE_FILE);
+	remove(TEST_SERIAL_FILE);
+	remove(TEST_SPLIT_FILE);
+}
@@ -0,0 +1,22 @@
+#ifndef TEST_CARVE_SPLIT_H
+#define TEST_CARVE_SPLIT_H
+
+/**
+ * @file test_carve_split.h
+ * @author Eric Turner <elturner@eecs.berkeley.edu>
+ *
+ * @section DESCRIPTION
+ *
+ * Runs unit tests for splitting the carving of a chunk into
+ * sub-octant tasks, which verify that the carved tree is the same
+ * as when the chunk is carved by a single call.
+ */
+
+/**
+ * Runs the tests.
+ *
+ * @return   Returns zero if all pass, non-zero if failure occurs.
+ */
+int test_carve_split();
+
+#endif
@@ -0,0 +1,146 @@
+#include "test_chunk_archive.h"
+#include <io/carve/chunk_io.h>
+#include <util/error_codes.h>
+#include <iostream>
+#include <sstream>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+/**
+ * @file test_chunk_archive.cpp
+ * @author Eric Turner <elturner@eecs.berkeley.edu>
+ *
+ * @section DESCRIPTION
+ *
+ * Runs unit tests for the .chunkarchive reader and writer classes,
+ * which pack many chunks into a single file and verify that each
+ * chunk reads back with its indices in the order written.
+ */
+
+using namespace std;
+
+/* the size of the test archive.  The number of points is chosen
+ * so that chunks span several blocks, which are interleaved */
+#define NUM_TEST_CHUNKS      37
+#define MAX_POINTS_PER_CHUNK (3*chunk::ARCHIVE_BLOCK_SIZE)
+
+/* the file to write during the test */
+#define TEST_FILE "build/test_chunk_archive.chunkarchive"
+
+/* the testing suite */
+int test_chunk_archive()
+{
+	vector<vector<size_t> > chunks(NUM_TEST_CHUNKS);
+	vector<unsigned long long> uuids(NUM_TEST_CHUNKS);
+	chunk::chunk_archive_writer_t outfile;
+	chunk::chunk_archive_reader_t infile;
+	chunk::chunk_archive_entry_t entry;
+	chunk::chunk_reader_t chunkfile;
+	vector<chunk::point_index_t> pts;
+	chunk::point_index_t p;
+	stringstream ss;
+	size_t i, j, c, n, total;
+	int ret;
+
+	/* pick the contents of each chunk, using uuids that are
+	 * not written in sorted order */
+	srand(4321);
+	total = 0;
+	for(i = 0; i < NUM_TEST_CHUNKS; i++)
+	{
+		uuids[i] = 0x7f0000001000ULL + 0x40 * ((i * 17) % 64);
+		n = rand() % MAX_POINTS_PER_CHUNK;
+		for(j = 0; j < n; j++)
+			chunks[i].push_back(rand());
+		total += n;
+	}
+
+	/* write the archive, interleaving points across chunks */
+	ret = outfile.open(TEST_FILE);
+	if(ret)
+		return PROPEGATE_ERROR(-1, ret);
+	for(i = 0; i < NUM_TEST_CHUNKS; i++)
+	{
+		c = outfile.add_chunk(uuids[i], i, 2.0*i, -1.0*i, 0.5);
+		if(c != i)
+			return -2;
+	}
+	for(j = 0; total > 0; j++)
+		for(i = 0; i < NUM_TEST_CHUNKS; i++)
+			if(j < chunks[i].size())
+			{
+				outfile.write(i,
+					chunk::point_index_t(chunks[i][j]));
+				total--;
+			}
+	ret = outfile.close();
+	if(ret)
+		return PROPEGATE_ERROR(-3, ret);
+
+	/* read it back */
+	ret = infile.open(TEST_FILE);
+	if(ret)
+		return PROPEGATE_ERROR(-4, ret);
+	if(infile.num_chunks() != NUM_TEST_CHUNKS)
+	{
+		cerr << "[test_chunk_archive]\tWrong number of chunks"
+		     << endl;
+		return -5;
+	}
+	for(i = 0; i < NUM_TEST_CHUNKS; i++)
+	{
+		/* look up the chunk by its uuid */
+		ret = infile.find(uuids[i], c);
+		if(ret)
+			return PROPEGATE_ERROR(-6, ret);
+		ret = infile.read(c, entry, pts);
+		if(ret)
+			return PROPEGATE_ERROR(-7, ret);
+
+		/* check its contents */
+		if(entry.uuid != uuids[i] || entry.center_y != 2.0*i
+				|| entry.halfwidth != 0.5
+				|| pts.size() != chunks[i].size())
+		{
+			cerr << "[test_chunk_archive]\tWrong header for "
+			     << "chunk #" << i << endl;
+			return -8;
+		}
+		for(j = 0; j < pts.size(); j++)
+			if(pts[j].wedge_index != chunks[i][j])
+			{
+				cerr << "[test_chunk_archive]\tWrong index "
+				     << "#" << j << " of chunk #" << i
+				     << endl;
+				return -9;
+			}
+	}
+
+	/* uuids that were never added should not be found */
+	if(!infile.find(0x10, c))
+		return -10;
+
+	/* chunks should also be readable by reference, as listed
+	 * in a chunklist file */
+	for(i = 0; i < NUM_TEST_CHUNKS; i += 5)
+	{
+		ss.str("");
+		ss << TEST_FILE << chunk::ARCHIVE_UUID_SEPERATOR
+		   << hex << showbase << uuids[i];
+		ret = chunkfile.open(ss.str(), &infile);
+		if(ret)
+			return PROPEGATE_ERROR(-11, ret);
+		for(j = 0; chunkfile.next(p) == 0; j++)
+			if(j >= chunks[i].size()
+					|| p.wedge_index != chunks[i][j])
+				return -12;
+		if(j != chunks[i].size())
+			return -13;
+		chunkfile.close();
+	}
+
+	/* success */
+	infile.close();
+	return 0;
+}
@@ -0,0 +1,22 @@
+#ifndef TEST_CHUNK_ARCHIVE_H
+#define TEST_CHUNK_ARCHIVE_H
+
+/**
+ * @file test_chunk_archive.h
+ * @author Eric Turner <elturner@eecs.berkeley.edu>
+ *
+ * @section DESCRIPTION
+ *
+ * Runs unit tests for the .chunkarchive reader and writer classes,
+ * which pack many chunks into a single file and verify that each
+ * chunk reads back with its indices in the order written.
+ */
+
+/**
+ * Runs the tests.
+ *
+ * @return   Returns zero if all pass, non-zero if failure occurs.
+ */
+int test_chunk_archive();
+
+#endif
@@ -0,0 +1,232 @@
+#include "test_linear_octree.h"
+#include <geometry/octree/linear_octree.h>
+#include <geometry/octree/octree.h>
+#include <geometry/octree/octnode.h>
+#include <geometry/octree/octdata.h>
+#include <geometry/octree/shape.h>
+#include <util/error_codes.h>
+#include <util/tictoc.h>
+#include <Eigen/Dense>
+#include <iostream>
+#include <stdlib.h>
+#include <stdio.h>
+#include <cmath>
+#include <vector>
+
+/**
+ * @file test_linear_octree.cpp
+ * @author Eric Turner <elturner@eecs.berkeley.edu>
+ *
+ * @section DESCRIPTION
+ *
+ * Runs unit tests for the linear_octree_t class, which check that
+ * it finds the same nodes as the octree_t it was built from, both
+ * directly and through an octfile, and compare their memory use.
+ */
+
+using namespace std;
+using namespace Eigen;
+
+/* the geometry of the test tree */
+#define TREE_HALFWIDTH  3.2
+#define TREE_RESOLUTION 0.025
+#define NUM_TEST_BALLS  40
+#define NUM_TEST_QUERIES 20
+
+/* the file to write during the test */
+#define TEST_OCT_FILE "build/test_linear_octree.oct"
+
+/**
+ * A ball that either carves the tree, or records the nodes it finds
+ */
+class test_ball_t : public shape_t
+{
+	public:
+
+		/* the geometry of the ball */
+		Vector3d center;
+		double radius;
+
+		/* the probability to carve with */
+		double prob;
+
+		/* the nodes found, as center, halfwidth, probability,
+		 * and count for each */
+		vector<double> found;
+
+		/* the shape interface */
+		unsigned int num_verts() const
+		{ return 2; };
+		Vector3d get_vertex(unsigned int i) const
+		{ return this->center + Vector3d::Constant(
+				(i == 0) ? -this->radius : this->radius); };
+		bool intersects(const Vector3d& c, double hw) const
+		{
+			Vector3d d = ((this->center - c).cwiseAbs()
+				- Vector3d::Constant(hw)).cwiseMax(0.0);
+			return (d.norm() <= this->radius);
+		};
+		octdata_t* apply_to_leaf(const Vector3d& c, double hw,
+		                         octdata_t* d)
+		{
+			/* carve if the ball has a probability */
+			if(this->prob >= 0)
+			{
+				if(d == NULL)
+					return new octdata_t(1.0, this->prob);
+				d->add_sample(1.0, this->prob);
+				return d;
+			}
+
+			/* otherwise record the node */
+			this->found.push_back(c(0));
+			this->found.push_back(c(1));
+			this->found.push_back(c(2));
+			this->found.push_back(hw);
+			this->found.push_back(d->get_probability());
+			this->found.push_back(d->get_count());
+			return d;
+		};
+};
+
+/* helper functions */
+double random_coord(double a, double b);
+void random_ball(test_ball_t& b, double prob);
+int compare_found(const test_ball_t& a, const test_ball_t& b);
+
+/* the testing suite */
+int test_linear_octree()
+{
+	octree_t tree;
+	linear_octree_t direct, parsed;
+	test_ball_t ball, a, b, c;
+	unsigned int i;
+	size_t tree_bytes;
+	double t_tree, t_linear;
+	tictoc_t clk;
+	int ret;
+
+	/* seed for repeatable results */
+	srand(4321);
+
+	/* carve a tree with overlapping balls, and simplify it so
+	 * that it has leaves at many depths */
+	tree.set(Vector3d::Zero(), TREE_HALFWIDTH, TREE_RESOLUTION);
+	for(i = 0; i < NUM_TEST_BALLS; i++)
+	{
+		random_ball(ball, (i % 2 == 0) ? 0.9 : 0.1);
+		ret = tree.insert(ball);
+		if(ret)
+			return PROPEGATE_ERROR(-1, ret);
+	}
+	tree.get_root()->simplify_recur();
+
+	/* make a linear tree both from memory and from file */
+	ret = direct.init(tree);
+	if(ret)
+		return PROPEGATE_ERROR(-2, ret);
+	ret = tree.serialize(TEST_OCT_FILE);
+	if(ret)
+		return PROPEGATE_ERROR(-3, ret);
+	ret = parsed.parse(TEST_OCT_FILE);
+	if(ret)
+		return PROPEGATE_ERROR(-4, ret);
+	if(direct.size() == 0 || direct.size() != parsed.size())
+	{
+		cerr << "[test_linear_octree]\tWrong number of nodes: "
+		     << direct.size() << " vs " << parsed.size() << endl;
+		return -5;
+	}
+
+	/* every query should find the same nodes in the same order */
+	for(i = 0; i < NUM_TEST_QUERIES; i++)
+	{
+		random_ball(a, -1);
+		b = c = a;
+		tree.find(a);
+		direct.find(b);
+		parsed.find(c);
+		ret = compare_found(a, b);
+		if(ret)
+			return PROPEGATE_ERROR(-6, ret);
+		ret = compare_found(a, c);
+		if(ret)
+			return PROPEGATE_ERROR(-7, ret);
+	}
+
+	/* a full traversal should find every node */
+	a.center = Vector3d::Zero();
+	a.radius = 10*TREE_HALFWIDTH;
+	a.found.clear();
+	b = a;
+	tic(clk);
+	tree.find(a);
+	t_tree = toc(clk, NULL);
+	tic(clk);
+	direct.find(b);
+	t_linear = toc(clk, NULL);
+	ret = compare_found(a, b);
+	if(ret)
+		return PROPEGATE_ERROR(-8, ret);
+	if(b.found.size() != 6*direct.size())
+	{
+		cerr << "[test_linear_octree]\tFull traversal found "
+		     << (b.found.size() / 6) << " of " << direct.size()
+		     << " nodes" << endl;
+		return -9;
+	}
+
+	/* report memory use, which is not pass/fail */
+	tree_bytes = tree.get_root()->get_num_nodes() * sizeof(octnode_t)
+			+ direct.size() * sizeof(octdata_t);
+	cout << "[test_linear_octree]\t" << direct.size()
+	     << " nodes with data:" << endl
+	     << "\toctree_t:        " << tree_bytes << " bytes, "
+	     << t_tree << " sec to traverse" << endl
+	     << "\tlinear_octree_t: " << direct.num_bytes() << " bytes, "
+	     << t_linear << " sec to traverse" << endl;
+
+	/* clean up */
+	remove(TEST_OCT_FILE);
+	return 0;
+}
+
+/* helper functions */
+
+double random_coord(double a, double b)
+{
+	return a + (b-a) * (((double) rand()) / RAND_MAX);
+}
+
+void random_ball(test_ball_t& b, double prob)
+{
+	b.center << random_coord(-2,2), random_coord(-2,2),
+	            random_coord(-2,2);
+	b.radius = random_coord(0.1, 1.0);
+	b.prob = prob;
+	b.found.clear();
+}
+
+int compare_found(const test_ball_t& a, const test_ball_t& b)
+{
+	size_t i;
+
+	/* centers are computed differently, so allow for rounding */
+	if(a.found.size() != b.found.size())
+	{
+		cerr << "[compare_found]\tFound " << (a.found.size()/6)
+		     << " vs " << (b.found.size()/6) << " nodes" << endl;
+		return -1;
+	}
+	for(i = 0; i < a.found.size(); i++)
+		if(fabs(a.found[i] - b.found[i]) > 1e-9)
+		{
+			cerr << "[compare_found]\tNode #" << (i/6)
+			     << " differs in field " << (i%6) << ": "
+			     << a.found[i] << " vs " << b.found[i] << endl;
+			return -2;
+		}
+
+	/* success */
+	return 0;
+}
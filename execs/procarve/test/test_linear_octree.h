@@ -0,0 +1,22 @@
+#ifndef TEST_LINEAR_OCTREE_H
+#define TEST_LINEAR_OCTREE_H
+
+/**
+ * @file test_linear_octree.h
+ * @author Eric Turner <elturner@eecs.berkeley.edu>
+ *
+ * @section DESCRIPTION
+ *
+ * Runs unit tests for the linear_octree_t class, which check that
+ * it finds the same nodes as the octree_t it was built from, both
+ * directly and through an octfile, and compare their memory use.
+ */
+
+/**
+ * Runs the tests.
+ *
+ * @return   Returns zero if all pass, non-zero if failure occurs.
+ */
+int test_linear_octree();
+
+#endif
@@ -0,0 +1,347 @@
+#include "test_octfile.h"
+#include <geometry/octree/octree.h>
+#include <geometry/octree/octnode.h>
+#include <geometry/octree/octdata.h>
+#include <geometry/octree/octfile.h>
+#include <geometry/octree/shape.h>
+#include <util/error_codes.h>
+#include <util/tictoc.h>
+#include <Eigen/Dense>
+#include <chrono>
+#include <iostream>
+#include <fstream>
+#include <iterator>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <sys/stat.h>
+
+/**
+ * @file test_octfile.cpp
+ * @author Eric Turner <elturner@eecs.berkeley.edu>
+ *
+ * @section DESCRIPTION
+ *
+ * Runs unit tests for the block layout of .oct files, which check
+ * that trees are preserved when written and parsed, that files of the
+ * previous version are converted exactly, that compressed files hold
+ * the same tree, and that parsing a region of a file finds the same
+ * nodes as parsing the whole file.
+ */
+
+using namespace std;
+using namespace Eigen;
+
+/* the geometry of the test tree */
+#define TREE_HALFWIDTH  6.4
+#define TREE_RESOLUTION 0.05
+#define NUM_TEST_BOXES  60
+#define NUM_TEST_QUERIES 10
+
+/* the files to write during the test */
+#define TEST_OLD_FILE      "build/test_octfile_v2.oct"
+#define TEST_FILE          "build/test_octfile.oct"
+#define TEST_CONVERTED     "build/test_octfile_converted.oct"
+#define TEST_REWRITTEN     "build/test_octfile_rewritten.oct"
+#define TEST_COMPRESSED    "build/test_octfile_compressed.oct"
+#define TEST_DECOMPRESSED  "build/test_octfile_decompressed.oct"
+#define TEST_STORED        "build/test_octfile_stored.oct"
+
+/**
+ * A box that either carves the tree, or records the nodes it finds
+ */
+class test_box_t : public shape_t
+{
+	public:
+
+		/* the bounds of the box */
+		Vector3d bmin, bmax;
+
+		/* the probability to carve with, negative to record */
+		double prob;
+
+		/* the centers and halfwidths of the nodes found */
+		vector<double> found;
+
+		/* the shape interface */
+		unsigned int num_verts() const
+		{ return 2; };
+		Vector3d get_vertex(unsigned int i) const
+		{ return (i == 0) ? this->bmin : this->bmax; };
+		bool intersects(const Vector3d& c, double hw) const
+		{
+			return ((c.array() + hw >= this->bmin.array()).all()
+				&& (c.array() - hw
+					<= this->bmax.array()).all());
+		};
+		octdata_t* apply_to_leaf(const Vector3d& c, double hw,
+		                         octdata_t* d)
+		{
+			/* carve if the box has a probability */
+			if(this->prob >= 0)
+			{
+				if(d == NULL)
+					return new octdata_t(1.0, this->prob);
+				d->add_sample(1.0, this->prob);
+				return d;
+			}
+
+			/* otherwise record the node */
+			this->found.push_back(c(0));
+			this->found.push_back(c(1));
+			this->found.push_back(c(2));
+			this->found.push_back(hw);
+			this->found.push_back(d->get_probability());
+			return d;
+		};
+};
+
+/* helper functions */
+void random_box(test_box_t& b, double size, double prob);
+int write_old_version(const octree_t& tree, const string& fn);
+bool same_contents(const string& a, const string& b);
+double seconds_since(const chrono::steady_clock::time_point& start);
+double megabytes(const string& fn);
+
+/* the testing suite */
+int test_octfile()
+{
+	octree_t tree, converted, rewritten, region, decompressed;
+	octree_t leaf, stored;
+	test_box_t box, a, b;
+	octfile::reader_t reader, leafreader;
+	chrono::steady_clock::time_point start;
+	double t_full, t_region, t_write, t_cwrite, t_cread;
+	unsigned int i;
+	tictoc_t clk;
+	int ret;
+
+	/* seed for repeatable results */
+	srand(2468);
+
+	/* carve a tree with overlapping boxes */
+	tree.set(Vector3d::Zero(), TREE_HALFWIDTH, TREE_RESOLUTION);
+	for(i = 0; i < NUM_TEST_BOXES; i++)
+	{
+		random_box(box, 1.5, (i % 3 == 0) ? 0.2 : 0.8);
+		ret = tree.insert(box);
+		if(ret)
+			return PROPEGATE_ERROR(-1, ret);
+	}
+	tree.get_root()->simplify_recur();
+
+	/* write the tree in the current and previous versions */
+	start = chrono::steady_clock::now();
+	ret = tree.serialize(TEST_FILE);
+	t_write = seconds_since(start);
+	if(ret)
+		return PROPEGATE_ERROR(-2, ret);
+	ret = write_old_version(tree, TEST_OLD_FILE);
+	if(ret)
+		return PROPEGATE_ERROR(-3, ret);
+	ret = reader.open(TEST_FILE);
+	if(ret)
+		return PROPEGATE_ERROR(-4, ret);
+	if(reader.num_blocks() < 2)
+	{
+		cerr << "[test_octfile]\tTree was not split into blocks"
+		     << endl;
+		return -5;
+	}
+
+	/* converting the old file, or re-writing the new one, should
+	 * give exactly the same file, whatever the number of threads */
+	ret = converted.parse(TEST_OLD_FILE, 1);
+	if(ret)
+		return PROPEGATE_ERROR(-6, ret);
+	ret = converted.serialize(TEST_CONVERTED);
+	if(ret)
+		return PROPEGATE_ERROR(-7, ret);
+	start = chrono::steady_clock::now();
+	ret = rewritten.parse(TEST_FILE);
+	t_full = seconds_since(start);
+	if(ret)
+		return PROPEGATE_ERROR(-8, ret);
+	ret = rewritten.serialize(TEST_REWRITTEN, false, 1);
+	if(ret)
+		return PROPEGATE_ERROR(-9, ret);
+	if(!same_contents(TEST_FILE, TEST_CONVERTED)
+			|| !same_contents(TEST_FILE, TEST_REWRITTEN))
+	{
+		cerr << "[test_octfile]\tTree changed when written and "
+		     << "parsed" << endl;
+		return -10;
+	}
+
+	/* a compressed file should hold the same tree */
+	start = chrono::steady_clock::now();
+	ret = tree.serialize(TEST_COMPRESSED, true);
+	t_cwrite = seconds_since(start);
+	if(ret)
+		return PROPEGATE_ERROR(-11, ret);
+	start = chrono::steady_clock::now();
+	ret = decompressed.parse(TEST_COMPRESSED);
+	t_cread = seconds_since(start);
+	if(ret)
+		return PROPEGATE_ERROR(-12, ret);
+	ret = decompressed.serialize(TEST_DECOMPRESSED);
+	if(ret)
+		return PROPEGATE_ERROR(-13, ret);
+	if(!same_contents(TEST_FILE, TEST_DECOMPRESSED)
+			|| megabytes(TEST_COMPRESSED) >= megabytes(TEST_FILE))
+	{
+		cerr << "[test_octfile]\tTree changed when compressed"
+		     << endl;
+		return -14;
+	}
+
+	/* a block too small to shrink is stored as-is, even in a
+	 * compressed file.  An empty root at a random position is
+	 * such a block, since it is mostly the bytes of its geometry */
+	leaf.set(Vector3d::Random(), TREE_RESOLUTION, TREE_RESOLUTION);
+	ret = leaf.serialize(TEST_STORED, true);
+	if(ret)
+		return PROPEGATE_ERROR(-15, ret);
+	ret = leafreader.open(TEST_STORED);
+	if(ret)
+		return PROPEGATE_ERROR(-16, ret);
+	ret = stored.parse(TEST_STORED);
+	if(ret)
+		return PROPEGATE_ERROR(-17, ret);
+	if(leafreader.num_blocks() != 1
+			|| leafreader.get_block(0).size
+				!= leafreader.get_block(0).raw_size
+			|| stored.get_root() == NULL
+			|| stored.get_root()->center
+				!= leaf.get_root()->center)
+	{
+		cerr << "[test_octfile]\tSmall block was not stored "
+		     << "as-is" << endl;
+		return -18;
+	}
+	leafreader.close();
+
+	/* parsing a region should find the same nodes within it */
+	t_region = 0;
+	for(i = 0; i < NUM_TEST_QUERIES; i++)
+	{
+		random_box(a, 0.5, -1);
+		b = a;
+		tic(clk);
+		ret = region.parse((i % 2 == 0) ? TEST_FILE
+				: TEST_COMPRESSED, a.bmin, a.bmax);
+		t_region += toc(clk, NULL);
+		if(ret)
+			return PROPEGATE_ERROR(-19, ret);
+		tree.find(a);
+		region.find(b);
+		if(a.found != b.found)
+		{
+			cerr << "[test_octfile]\tRegion found "
+			     << (b.found.size()/5) << " of "
+			     << (a.found.size()/5) << " nodes" << endl;
+			return -20;
+		}
+	}
+
+	/* report timing, which is not pass/fail */
+	cout << "[test_octfile]\t" << tree.get_root()->get_num_nodes()
+	     << " nodes in " << reader.num_blocks() << " blocks:" << endl
+	     << "\tfull parse:   " << t_full << " sec" << endl
+	     << "\tregion parse: " << (t_region / NUM_TEST_QUERIES)
+	     << " sec" << endl
+	     << "\twrite:   " << megabytes(TEST_FILE) << " MB at "
+	     << (megabytes(TEST_FILE) / t_write) << " MB/s" << endl
+	     << "\tread:    " << megabytes(TEST_FILE) << " MB at "
+	     << (megabytes(TEST_FILE) / t_full) << " MB/s" << endl
+	     << "\tcompressed write: " << megabytes(TEST_COMPRESSED)
+	     << " MB at " << (megabytes(TEST_FILE) / t_cwrite)
+	     << " MB/s uncompressed" << endl
+	     << "\tcompressed read:  " << megabytes(TEST_COMPRESSED)
+	     << " MB at " << (megabytes(TEST_FILE) / t_cread)
+	     << " MB/s uncompressed" << endl;
+
+	/* clean up */
+	reader.close();
+	remove(TEST_OLD_FILE);
+	remove(TEST_FILE);
+	remove(TEST_CONVERTED);
+	remove(TEST_REWRITTEN);
+	remove(TEST_COMPRESSED);
+	remove(TEST_DECOMPRESSED);
+	remove(TEST_STORED);
+	return 0;
+}
+
+/* helper functions */
+
+void random_box(test_box_t& b, double size, double prob)
+{
+	Vector3d c, s;
+	unsigned int i;
+
+	/* pick a random box within the tree */
+	for(i = 0; i < 3; i++)
+	{
+		c(i) = (TREE_HALFWIDTH - size)
+			* (2.0*rand() / RAND_MAX - 1);
+		s(i) = size * (0.2 + 0.8*rand() / RAND_MAX);
+	}
+	b.bmin = c - s;
+	b.bmax = c + s;
+	b.prob = prob;
+	b.found.clear();
+}
+
+int write_old_version(const octree_t& tree, const string& fn)
+{
+	ofstream outfile;
+	unsigned int v, c;
+	int d;
+
+	/* write the header of version 2, followed by the nodes */
+	outfile.open(fn.c_str(), ios_base::out | ios_base::binary);
+	if(!(outfile.is_open()))
+		return -1;
+	v = 2;
+	d = tree.get_max_depth();
+	c = tree.get_root()->get_num_nodes();
+	outfile.write(OCTFILE_MAGIC_NUMBER, OCTFILE_MAGIC_LENGTH);
+	outfile.write((char*) &v, sizeof(v));
+	outfile.write((char*) &d, sizeof(d));
+	outfile.write((char*) &c, sizeof(c));
+	tree.get_root()->serialize(outfile);
+	outfile.close();
+	return 0;
+}
+
+bool same_contents(const string& a, const string& b)
+{
+	ifstream fa(a.c_str(), ios_base::binary);
+	ifstream fb(b.c_str(), ios_base::binary);
+
+	/* compare every byte of the files */
+	return (fa.is_open() && fb.is_open()
+		&& string(istreambuf_iterator<char>(fa),
+		          istreambuf_iterator<char>())
+		== string(istreambuf_iterator<char>(fb),
+		          istreambuf_iterator<char>()));
+}
+
+double seconds_since(const chrono::steady_clock::time_point& start)
+{
+	/* use wall-clock time, since the i/o is multithreaded */
+	return chrono::duration<double>(chrono::steady_clock::now()
+				- start).count();
+}
+
+double megabytes(const string& fn)
+{
+	struct stat st;
+
+	/* get the size of the file */
+	if(stat(fn.c_str(), &st) != 0)
+		return 0;
+	return st.st_size / (1024.0 * 1024.0);
+}
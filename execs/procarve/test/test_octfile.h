@@ -0,0 +1,23 @@
+#ifndef TEST_OCTFILE_H
+#define TEST_OCTFILE_H
+
+/**
+ * @file test_octfile.h
+ * @author Eric Turner <elturner@eecs.berkeley.edu>
+ *
+ * @section DESCRIPTION
+ *
+ * Runs unit tests for the block layout of .oct files, which check
+ * that trees are preserved when written and parsed, that files of the
+ * previous version are converted exactly, and that parsing a region
+ * of a file finds the same nodes as parsing the whole file.
+ */
+
+/**
+ * Runs the tests.
+ *
+ * @return   Returns zero if all pass, non-zero if failure occurs.
+ */
+int test_octfile();
+
+#endif
@@ -0,0 +1,330 @@
+#include "test_slab_allocator.h"
+#include <util/slab_allocator.h>
+#include <util/error_codes.h>
+#include <util/tictoc.h>
+#include <geometry/octree/octree.h>
+#include <geometry/octree/octnode.h>
+#include <geometry/octree/octdata.h>
+#include <Eigen/Dense>
+#include <sys/resource.h>
+#include <iostream>
+#include <stdlib.h>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+
+/**
+ * @file test_slab_allocator.cpp
+ * @author Eric Turner <elturner@eecs.berkeley.edu>
+ *
+ * @section DESCRIPTION
+ *
+ * Runs unit tests for the slab_allocator_t class, which allocate
+ * and free objects across several threads, check that objects freed
+ * by a consumer thread are reused by a producer thread, and benchmark
+ * building and clearing an octree against the system allocator.
+ */
+
+using namespace std;
+
+/* the sizes of the tests */
+#define NUM_TEST_THREADS  4
+#define NUM_TEST_OBJECTS  100000
+#define NUM_TEST_ROUNDS   20
+#define BENCH_TREE_DEPTH  7
+
+/* the type allocated by the tests */
+class test_obj_t
+{
+	public:
+		size_t id;
+		double vals[5];
+
+		static void* operator new(size_t n)
+		{ return slab_allocator_t<test_obj_t>::allocate(n); };
+		static void operator delete(void* p, size_t n)
+		{ slab_allocator_t<test_obj_t>::deallocate(p, n); };
+};
+
+/* the batches passed from producer to consumer */
+class handoff_t
+{
+	public:
+		mutex mtx;
+		condition_variable cv;
+		deque<vector<test_obj_t*> > batches;
+		bool done;
+
+		handoff_t() : done(false) {};
+};
+
+/* the individual tests */
+int test_threads();
+int test_cross_threads();
+void bench_tree();
+
+/* helper functions */
+void alloc_objs(vector<test_obj_t*>* objs, size_t start);
+void free_objs(vector<test_obj_t*>* objs);
+void produce(handoff_t* h);
+void consume(handoff_t* h);
+void fill_tree(octnode_t* node, unsigned int depth);
+
+/* the testing suite */
+int test_slab_allocator()
+{
+	int ret;
+
+	/* run tests */
+	ret = test_threads();
+	if(ret)
+		return PROPEGATE_ERROR(-1, ret);
+	ret = test_cross_threads();
+	if(ret)
+		return PROPEGATE_ERROR(-2, ret);
+
+	/* report throughput, which is not pass/fail */
+	bench_tree();
+
+	/* success */
+	return 0;
+}
+
+int test_threads()
+{
+	vector<vector<test_obj_t*> > objs(NUM_TEST_THREADS);
+	vector<thread> threads;
+	size_t i, j;
+
+	/* allocate objects on several threads at once */
+	for(i = 0; i < NUM_TEST_THREADS; i++)
+		threads.push_back(thread(alloc_objs, &(objs[i]),
+		                         i*NUM_TEST_OBJECTS));
+	for(i = 0; i < NUM_TEST_THREADS; i++)
+		threads[i].join();
+	threads.clear();
+
+	/* every object should be distinct and intact */
+	for(i = 0; i < NUM_TEST_THREADS; i++)
+		for(j = 0; j < objs[i].size(); j++)
+			if(objs[i][j]->id != i*NUM_TEST_OBJECTS + j
+					|| objs[i][j]->vals[4] != (double) j)
+			{
+				cerr << "[test_threads]\tObject " << j
+				     << " of thread " << i << " was "
+				     << "overwritten" << endl;
+				return -1;
+			}
+
+	/* the memory can't be released while objects are alive */
+	if(slab_allocator_t<test_obj_t>::release_if_unused())
+		return -2;
+
+	/* free each thread's objects from a different thread, which
+	 * exits afterwards and leaves its free list behind */
+	for(i = 0; i < NUM_TEST_THREADS; i++)
+		threads.push_back(thread(free_objs,
+		                  &(objs[(i+1) % NUM_TEST_THREADS])));
+	for(i = 0; i < NUM_TEST_THREADS; i++)
+		threads[i].join();
+
+	/* objects allocated after a release should still work */
+	alloc_objs(&(objs[0]), 0);
+	if(slab_allocator_t<test_obj_t>::release_if_unused())
+		return -3;
+	free_objs(&(objs[0]));
+
+	/* now everything is free, so the memory should be released */
+	if(!slab_allocator_t<test_obj_t>::release_if_unused()
+			|| slab_allocator_t<test_obj_t>::num_bytes() != 0)
+		return -4;
+
+	/* the pool should be usable after being released */
+	alloc_objs(&(objs[0]), 0);
+	if(objs[0].back()->id != NUM_TEST_OBJECTS-1)
+		return -5;
+	free_objs(&(objs[0]));
+	if(!slab_allocator_t<test_obj_t>::release_if_unused())
+		return -6;
+
+	/* success */
+	return 0;
+}
+
+int test_cross_threads()
+{
+	typedef slab_allocator_t<test_obj_t> alloc_t;
+	handoff_t h;
+	size_t limit;
+
+	/* start from an empty pool */
+	if(!alloc_t::release_if_unused())
+		return -1;
+
+	/* one thread allocates batches that another thread frees.
+	 * At most three batches are alive at once (being made, queued
+	 * and being freed), so the pool should stay near that size no
+	 * matter how many rounds are run */
+	thread producer(produce, &h);
+	thread consumer(consume, &h);
+	producer.join();
+	consumer.join();
+
+	/* allow three batches, plus the free objects each thread
+	 * may hold and its partially-used slab */
+	limit = (3*NUM_TEST_OBJECTS*alloc_t::SLOT_SIZE
+			+ 2*alloc_t::MAX_FREE_PER_THREAD*alloc_t::SLOT_SIZE
+			+ 2*alloc_t::SLAB_SIZE);
+	if(alloc_t::num_bytes() > limit)
+	{
+		cerr << "[test_cross_threads]\tPool grew to "
+		     << alloc_t::num_bytes() << " bytes, expected at most "
+		     << limit << endl;
+		return -2;
+	}
+
+	/* everything was freed */
+	if(!alloc_t::release_if_unused())
+		return -3;
+
+	/* success */
+	return 0;
+}
+
+void bench_tree()
+{
+	vector<void*> ptrs;
+	octree_t tree;
+	struct rusage usage;
+	double t_build, t_clear, t_malloc;
+	size_t i, n;
+	tictoc_t clk;
+
+	/* build a full tree, which allocates nodes the same
+	 * way as carving does */
+	tic(clk);
+	tree.set(Eigen::Vector3d::Zero(), 1.0, 1.0 / (1 << BENCH_TREE_DEPTH));
+	fill_tree(tree.get_root(), BENCH_TREE_DEPTH);
+	t_build = toc(clk, NULL);
+	getrusage(RUSAGE_SELF, &usage);
+	n = (slab_allocator_t<octnode_t>::num_bytes()
+		+ slab_allocator_t<octdata_t>::num_bytes());
+
+	/* clearing the tree should free it all */
+	tic(clk);
+	tree.clear();
+	t_clear = toc(clk, NULL);
+
+	/* compare against the system allocator for the same
+	 * number of nodes and data objects */
+	tic(clk);
+	for(i = 0; i < ((1 << (3*(BENCH_TREE_DEPTH+1))) - 1) / 7; i++)
+		ptrs.push_back(malloc(sizeof(octnode_t)));
+	for(i = 0; i < (1 << (3*BENCH_TREE_DEPTH)); i++)
+		ptrs.push_back(malloc(sizeof(octdata_t)));
+	for(i = 0; i < ptrs.size(); i++)
+		free(ptrs[i]);
+	t_malloc = toc(clk, NULL);
+
+	/* report */
+	cout << "[bench_tree]\toctree of depth " << BENCH_TREE_DEPTH
+	     << ":" << endl
+	     << "\tbuild:      " << t_build << " sec" << endl
+	     << "\tclear:      " << t_clear << " sec" << endl
+	     << "\tmalloc:     " << t_malloc << " sec (allocation only)"
+	     << endl
+	     << "\tslabs:      " << (n / 1048576.0) << " MB" << endl
+	     << "\tpeak RSS:   " << (usage.ru_maxrss / 1024.0) << " MB"
+	     << endl;
+}
+
+/* helper functions */
+
+void alloc_objs(vector<test_obj_t*>* objs, size_t start)
+{
+	size_t i;
+
+	/* make objects with recognizable contents */
+	objs->resize(NUM_TEST_OBJECTS);
+	for(i = 0; i < objs->size(); i++)
+	{
+		(*objs)[i] = new test_obj_t();
+		(*objs)[i]->id = start + i;
+		(*objs)[i]->vals[4] = (double) i;
+	}
+}
+
+void free_objs(vector<test_obj_t*>* objs)
+{
+	size_t i;
+
+	/* free everything in the list */
+	for(i = 0; i < objs->size(); i++)
+		delete ((*objs)[i]);
+	objs->clear();
+}
+
+void produce(handoff_t* h)
+{
+	vector<test_obj_t*> objs;
+	size_t i;
+
+	/* make each batch, waiting until the consumer is at most
+	 * one batch behind */
+	for(i = 0; i < NUM_TEST_ROUNDS; i++)
+	{
+		alloc_objs(&objs, i*NUM_TEST_OBJECTS);
+		unique_lock<mutex> lock(h->mtx);
+		h->cv.wait(lock, [h]{ return h->batches.empty(); });
+		h->batches.push_back(vector<test_obj_t*>());
+		h->batches.back().swap(objs);
+		h->cv.notify_all();
+	}
+
+	/* tell the consumer there are no more */
+	unique_lock<mutex> lock(h->mtx);
+	h->done = true;
+	h->cv.notify_all();
+}
+
+void consume(handoff_t* h)
+{
+	vector<test_obj_t*> objs;
+
+	/* free each batch as it arrives */
+	while(true)
+	{
+		{
+			unique_lock<mutex> lock(h->mtx);
+			h->cv.wait(lock, [h]{ return h->done
+					|| !(h->batches.empty()); });
+			if(h->batches.empty())
+				return;
+			objs.swap(h->batches.front());
+			h->batches.pop_front();
+			h->cv.notify_all();
+		}
+		free_objs(&objs);
+	}
+}
+
+void fill_tree(octnode_t* node, unsigned int depth)
+{
+	unsigned int i;
+
+	/* leaves get data */
+	if(depth == 0)
+	{
+		node->data = new octdata_t();
+		return;
+	}
+
+	/* recurse */
+	for(i = 0; i < CHILDREN_PER_NODE; i++)
+	{
+		node->init_child(i);
+		fill_tree(node->children[i], depth-1);
+	}
+}
@@ -0,0 +1,22 @@
+#ifndef TEST_SLAB_ALLOCATOR_H
+#define TEST_SLAB_ALLOCATOR_H
+
+/**
+ * @file test_slab_allocator.h
+ * @author Eric Turner <elturner@eecs.berkeley.edu>
+ *
+ * @section DESCRIPTION
+ *
+ * Runs unit tests for the slab_allocator_t class, which allocate
+ * and free objects across several threads, and benchmark building
+ * and clearing an octree against the system allocator.
+ */
+
+/**
+ * Runs the tests.
+ *
+ * @return   Returns zero if all pass, non-zero if failure occurs.
+ */
+int test_slab_allocator();
+
+#endif
@@ -0,0 +1,216 @@
+#include "test_wedge_intersects.h"
+#include <geometry/shapes/carve_wedge.h>
+#include <geometry/carve/gaussian/carve_map.h>
+#include <geometry/octree/octnode.h>
+#include <util/error_codes.h>
+#include <util/tictoc.h>
+#include <Eigen/Dense>
+#include <iostream>
+#include <stdlib.h>
+#include <cmath>
+#include <vector>
+
+/**
+ * @file test_wedge_intersects.cpp
+ * @author Eric Turner <elturner@eecs.berkeley.edu>
+ *
+ * @section DESCRIPTION
+ *
+ * Runs unit tests for the vectorized intersection test of carve
+ * wedges, which check that testing all children of a node at once
+ * gives the same results as the pcube-based test of each child.
+ */
+
+using namespace std;
+using namespace Eigen;
+
+/* the number of random wedges and nodes per wedge to test */
+#define NUM_TEST_WEDGES     2000
+#define NUM_NODES_PER_TEST  50
+#define NUM_BENCH_NODES     200000
+
+/* the range of node sizes to test, as powers of two */
+#define MIN_LOG_HALFWIDTH   -7.0
+#define MAX_LOG_HALFWIDTH   2.0
+
+/* the individual tests */
+int test_block(bool interp, unsigned int& num_hits,
+               unsigned int& num_tests);
+void bench_block();
+
+/* helper functions, which are shared with test_carve_map_batch */
+double uniform(double a, double b);
+void random_maps(vector<carve_map_t>& maps);
+void random_node(const carve_wedge_t& w, Vector3d& c, double& hw);
+
+/* the testing suite */
+int test_wedge_intersects()
+{
+	unsigned int num_hits, num_tests;
+	int ret;
+
+	/* seed for repeatable results */
+	srand(1357);
+
+	/* compare against the scalar test for both kinds of wedges */
+	ret = test_block(true, num_hits, num_tests);
+	if(ret)
+		return PROPEGATE_ERROR(-1, ret);
+	cout << "[test_wedge_intersects]\t" << num_tests << " children, "
+	     << "of which " << num_hits << " intersect" << endl;
+	if(num_hits == 0 || num_hits == num_tests)
+	{
+		cerr << "[test_wedge_intersects]\tTest cases do not cover "
+		     << "both outcomes" << endl;
+		return -2;
+	}
+	ret = test_block(false, num_hits, num_tests);
+	if(ret)
+		return PROPEGATE_ERROR(-3, ret);
+
+	/* report throughput, which is not pass/fail */
+	bench_block();
+
+	/* success */
+	return 0;
+}
+
+/* the individual tests */
+
+int test_block(bool interp, unsigned int& num_hits,
+               unsigned int& num_tests)
+{
+	vector<carve_map_t> maps(NUM_MAPS_PER_WEDGE);
+	carve_wedge_t wedge;
+	Vector3d c, cs[CHILDREN_PER_NODE];
+	bool hits[CHILDREN_PER_NODE];
+	unsigned int i, j, k, n;
+	double hw;
+
+	/* test many random wedges */
+	num_hits = num_tests = 0;
+	for(i = 0; i < NUM_TEST_WEDGES; i++)
+	{
+		random_maps(maps);
+		wedge.init(&(maps[0]), &(maps[1]), &(maps[2]),
+		           &(maps[3]), 2.0, interp);
+
+		/* test the children of random nodes near the wedge */
+		for(j = 0; j < NUM_NODES_PER_TEST; j++)
+		{
+			random_node(wedge, c, hw);
+			for(k = 0; k < CHILDREN_PER_NODE; k++)
+				cs[k] = relative_child_pos(k)*(hw/2) + c;
+
+			/* sometimes test partial blocks */
+			n = (j % 5 == 0) ? (1 + j % CHILDREN_PER_NODE)
+					: CHILDREN_PER_NODE;
+			wedge.intersects_block(n, cs, hw/2, hits);
+			for(k = 0; k < n; k++)
+			{
+				if(hits[k] != wedge.intersects(cs[k], hw/2))
+				{
+					cerr << "[test_wedge_intersects]\t"
+					     << "Mismatch on wedge #" << i
+					     << ", node #" << j << ", child #"
+					     << k << endl;
+					wedge.print_params(cerr);
+					return -1;
+				}
+				num_hits += hits[k] ? 1 : 0;
+				num_tests++;
+			}
+		}
+	}
+
+	/* success */
+	return 0;
+}
+
+void bench_block()
+{
+	vector<carve_map_t> maps(NUM_MAPS_PER_WEDGE);
+	carve_wedge_t wedge;
+	vector<Vector3d> centers;
+	vector<double> hws;
+	Vector3d cs[CHILDREN_PER_NODE];
+	bool hits[CHILDREN_PER_NODE];
+	unsigned int i, k, count_scalar, count_block;
+	double t_scalar, t_block;
+	tictoc_t clk;
+
+	/* prepare one wedge and many nodes near it */
+	random_maps(maps);
+	wedge.init(&(maps[0]), &(maps[1]), &(maps[2]), &(maps[3]),
+	           2.0, true);
+	centers.resize(NUM_BENCH_NODES);
+	hws.resize(NUM_BENCH_NODES);
+	for(i = 0; i < NUM_BENCH_NODES; i++)
+		random_node(wedge, centers[i], hws[i]);
+
+	/* time the scalar test of each child */
+	count_scalar = 0;
+	tic(clk);
+	for(i = 0; i < NUM_BENCH_NODES; i++)
+		for(k = 0; k < CHILDREN_PER_NODE; k++)
+			if(wedge.intersects(relative_child_pos(k)
+					* (hws[i]/2) + centers[i],
+					hws[i]/2))
+				count_scalar++;
+	t_scalar = toc(clk, NULL);
+
+	/* time the block test of all children */
+	count_block = 0;
+	tic(clk);
+	for(i = 0; i < NUM_BENCH_NODES; i++)
+	{
+		for(k = 0; k < CHILDREN_PER_NODE; k++)
+			cs[k] = relative_child_pos(k)*(hws[i]/2)
+					+ centers[i];
+		wedge.intersects_block(CHILDREN_PER_NODE, cs,
+		                       hws[i]/2, hits);
+		for(k = 0; k < CHILDREN_PER_NODE; k++)
+			if(hits[k])
+				count_block++;
+	}
+	t_block = toc(clk, NULL);
+
+	/* report */
+	cout << "[test_wedge_intersects]\t" << NUM_BENCH_NODES
+	     << " nodes (" << count_scalar << "/" << count_block
+	     << " children hit):" << endl
+	     << "\tscalar: " << t_scalar << " sec" << endl
+	     << "\tblock:  " << t_block << " sec";
+	if(t_block > 0)
+		cout << " (" << (t_scalar / t_block) << "x)";
+	cout << endl;
+}
+
+/* helper functions */
+
+void random_node(const carve_wedge_t& w, Vector3d& c, double& hw)
+{
+	double weights[NUM_VERTICES_PER_WEDGE];
+	double total;
+	unsigned int i;
+
+	/* pick the size of the node */
+	hw = pow(2.0, uniform(MIN_LOG_HALFWIDTH, MAX_LOG_HALFWIDTH));
+
+	/* pick a random point within the hull of the wedge */
+	total = 0;
+	for(i = 0; i < NUM_VERTICES_PER_WEDGE; i++)
+	{
+		weights[i] = uniform(0, 1);
+		weights[i] *= weights[i]*weights[i]; /* favor vertices */
+		total += weights[i];
+	}
+	c = Vector3d::Zero();
+	for(i = 0; i < NUM_VERTICES_PER_WEDGE; i++)
+		c += (weights[i] / total) * w.get_vertex(i);
+
+	/* move the node so it may straddle the wedge surface */
+	c(0) += uniform(-2*hw, 2*hw);
+	c(1) += uniform(-2*hw, 2*hw);
+	c(2) += uniform(-2*hw, 2*hw);
+}
@@ -0,0 +1,22 @@
+#ifndef TEST_WEDGE_INTERSECTS_H
+#define TEST_WEDGE_INTERSECTS_H
+
+/**
+ * @file test_wedge_intersects.h
+ * @author Eric Turner <elturner@eecs.berkeley.edu>
+ *
+ * @section DESCRIPTION
+ *
+ * Runs unit tests for the vectorized intersection test of carve
+ * wedges, which check that testing all children of a node at once
+ * gives the same results as the pcube-based test of each child.
+ */
+
+/**
+ * Runs the tests.
+ *
+ * @return   Returns zero if all pass, non-zero if failure occurs.
+ */
+int test_wedge_intersects();
+
+#endif
@@ -100,6 +100,19 @@ void carve_map_t::init(const Vector3d& s_mean,
                        const Matrix3d& s_cov,
                        const Vector3d& p_mean,
                        const Matrix3d& p_cov)
+{
+	Matrix3d s_axes;
+
+	/* decompose the sensor covariance, then initialize */
+	carve_map_t::get_principal_axes(s_axes, s_cov);
+	this->init(s_mean, s_cov, s_axes, p_mean, p_cov);
+}
+
+void carve_map_t::init(const Vector3d& s_mean,
+                       const Matrix3d& s_cov,
+                       const Matrix3d& s_axes,
+                       const Vector3d& p_mean,
+                       const Matrix3d& p_cov)
 {
 	Matrix<double, 1, 3> rt;
 
@@ -119,9 +132,8 @@ void carve_map_t::init(const Vector3d& s_mean,
 	/* in order to compute the plane modeled for each endpoint
 	 * of the ray, we need to find the principal components
 	 * of each distribution that are aligned with the ray */
-	this->sensor_dot = carve_map_t::find_aligned_eig(
-	                   this->sensor_norm, this->ray,
-	                   this->sensor_cov);
+	this->sensor_dot = carve_map_t::find_aligned_axis(
+	                   this->sensor_norm, this->ray, s_axes);
 	this->scanpoint_dot = carve_map_t::find_aligned_eig(
 	                      this->scanpoint_norm, this->ray,
 	                      this->scanpoint_cov);
@@ -402,18 +414,33 @@ void carve_map_t::writexyz(ostream& out) const
 
 /* helper functions */
 
+void carve_map_t::get_principal_axes(Eigen::Matrix3d& U,
+                                     const Eigen::Matrix3d& M)
+{
+	/* perform the singular value decomposition on the input matrix */
+	JacobiSVD<Matrix3d> solver(M, Eigen::ComputeFullU);
+	U = solver.matrixU();
+}
+
 double carve_map_t::find_aligned_eig(Eigen::Vector3d& eig,
                                      const Eigen::Vector3d& in,
                                      const Eigen::Matrix3d& M)
+{
+	Matrix3d U;
+
+	/* decompose the matrix, then search its axes */
+	carve_map_t::get_principal_axes(U, M);
+	return carve_map_t::find_aligned_axis(eig, in, U);
+}
+
+double carve_map_t::find_aligned_axis(Eigen::Vector3d& eig,
+                                      const Eigen::Vector3d& in,
+                                      const Eigen::Matrix3d& U)
 {
 	Matrix<double, 1, 3> ds;
 	int i, i_max;
 	double d, d_max;
 
-	/* perform the singular value decomposition on the input matrix */
-	JacobiSVD<Matrix3d> solver(M, Eigen::ComputeFullU);
-	Matrix3d U = solver.matrixU();
-
 	/* find all dot products */
 	ds = in.transpose() * U;
 
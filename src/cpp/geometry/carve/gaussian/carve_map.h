@@ -28,6 +28,9 @@
  */
 class carve_map_t
 {
+	/* the batched evaluator packs the cached parameters below */
+	friend class carve_map_batch_t;
+
 	/* parameters */
 	private:
 
@@ -121,6 +124,37 @@ class carve_map_t
 		          const Eigen::Vector3d& p_mean,
 		          const Eigen::Matrix3d& p_cov);
 
+		/**
+		 * Initializes this carve map with a known sensor basis
+		 *
+		 * Performs the same operation as init() above, but
+		 * uses the given principal axes of the sensor covariance
+		 * rather than recomputing them.  Since all scan points
+		 * of a frame share the same sensor distribution, readers
+		 * can compute this basis once per frame with 
+		 * get_principal_axes().
+		 *
+		 * @param s_mean  Mean of sensor position
+		 * @param s_cov   Covariance of sensor position
+		 * @param s_axes  Principal axes (as columns) of s_cov
+		 * @param p_mean  Mean of scanpoint position
+		 * @param p_cov   Covariance of scanpoint position
+		 */
+		void init(const Eigen::Vector3d& s_mean,
+		          const Eigen::Matrix3d& s_cov,
+		          const Eigen::Matrix3d& s_axes,
+		          const Eigen::Vector3d& p_mean,
+		          const Eigen::Matrix3d& p_cov);
+
+		/**
+		 * Computes the principal axes of a covariance matrix
+		 *
+		 * @param U   Where to store the axes, as columns
+		 * @param M   The covariance matrix to analyze
+		 */
+		static void get_principal_axes(Eigen::Matrix3d& U,
+		                               const Eigen::Matrix3d& M);
+
 		/*-----------*/
 		/* accessors */
 		/*-----------*/
@@ -366,6 +400,22 @@ class carve_map_t
 		static double find_aligned_eig(Eigen::Vector3d& eig,
 		                               const Eigen::Vector3d& in,
 		                               const Eigen::Matrix3d& M);
+
+		/**
+		 * Finds the column of U that best aligns with input
+		 *
+		 * Same as find_aligned_eig(), but the principal axes
+		 * of the matrix have already been computed.
+		 *
+		 * @param eig   Where to store the output vector
+		 * @param in    The input vector to analyze
+		 * @param U     The principal axes to choose from
+		 *
+		 * @return      Returns dot(eig, in)
+		 */
+		static double find_aligned_axis(Eigen::Vector3d& eig,
+		                                const Eigen::Vector3d& in,
+		                                const Eigen::Matrix3d& U);
 };
 
 #endif
@@ -0,0 +1,617 @@
+#include "carve_map_batch.h"
+#include "carve_map.h"
+#include <util/simd.h>
+#include <iostream>
+#include <Eigen/Dense>
+#include <cmath>
+#include <limits>
+
+/**
+ * @file carve_map_batch.cpp
+ * @author Eric Turner <elturner@eecs.berkeley.edu>
+ *
+ * @section DESCRIPTION
+ *
+ * The carve_map_batch_t class is implemented here.  This class packs
+ * the cached parameters of the four carve maps that make up a
+ * carve wedge into a structure-of-arrays layout, so that all four
+ * maps can be evaluated at a location with one pass of SIMD
+ * instructions (one map per lane).  A block of locations is evaluated
+ * with one location per lane instead, looping over the maps.
+ *
+ * The math here follows carve_map_t::compute() and
+ * carve_map_t::get_surface_prob() term by term, but is rearranged
+ * so that no square roots or divisions are needed per map beyond
+ * those of the lateral variance.
+ *
+ * This class requires the Eigen framework.
+ */
+
+using namespace std;
+using namespace Eigen;
+using simd::vec4d;
+
+/* definition of PI, which should be in cmath already */
+#ifndef M_PI
+#define M_PI 3.14159265358979323846264
+#endif
+
+/* The following are probability values to average, based
+ * on different locations relative to a ray.  These must match
+ * the values used in carve_map.cpp */
+#define PROBABILITY_INTERIOR 1.0 /* a voxel that is interior */
+#define PROBABILITY_TOOFAR   0.0 /* a voxel past the scan (exterior) */
+#define PROBABILITY_A_PRIORI 0.5 /* a voxel with no information */
+
+/* the following constants are used by the exp() approximation, which
+ * reduces its argument to x = k*ln(2) + r, with |r| <= ln(2)/2, and
+ * then evaluates a truncated taylor series of exp(r) */
+#define EXP_LOG2E     1.4426950408889634074
+#define EXP_LN2_HI    6.93145751953125e-1   /* exact in 24 bits */
+#define EXP_LN2_LO    1.42860682030941723212e-6
+#define EXP_MAX_ARG   709.0
+#define EXP_MIN_ARG  -708.0
+#define EXP_DEGREE_HIGH 11 /* relative error < 1e-14 */
+#define EXP_DEGREE_FAST 5  /* relative error < 3e-6 */
+
+/* exp() is zero below this argument, for libm and for the polynomial
+ * approximations, which flush to zero below EXP_MIN_ARG */
+#define EXP_ZERO_ARG -746.0
+
+/* the mask of all lanes, as returned by simd::movemask() */
+#define ALL_LANES ((1 << SIMD_VEC4D_WIDTH) - 1)
+
+/* taylor coefficients 1/n! of exp(r) */
+static const double exp_coefs[EXP_DEGREE_HIGH+1] = {
+		1.0, 1.0, 1.0/2, 1.0/6, 1.0/24, 1.0/120, 1.0/720,
+		1.0/5040, 1.0/40320, 1.0/362880, 1.0/3628800,
+		1.0/39916800 };
+
+/*------------------*/
+/* helper functions */
+/*------------------*/
+
+/**
+ * Computes exp(x) on each lane using a polynomial of the given degree
+ *
+ * @param x     The input values
+ * @param deg   The degree of the polynomial, at most EXP_DEGREE_HIGH
+ *
+ * @return      Returns approximately exp(x)
+ */
+static inline vec4d exp_approx(const vec4d& x, int deg)
+{
+	vec4d xc, k, r, p;
+	int i;
+
+	/* clamp to the range where the result is a normal double */
+	xc = simd::max(simd::min(x, vec4d(EXP_MAX_ARG)),
+	               vec4d(EXP_MIN_ARG));
+
+	/* reduce the argument:  x = k*ln(2) + r */
+	k = simd::round(xc * vec4d(EXP_LOG2E));
+	r = (xc - k*vec4d(EXP_LN2_HI)) - k*vec4d(EXP_LN2_LO);
+
+	/* evaluate the polynomial using horner's method */
+	p = vec4d(exp_coefs[deg]);
+	for(i = deg-1; i >= 0; i--)
+		p = p*r + vec4d(exp_coefs[i]);
+
+	/* scale by 2^k.  Arguments past the clamp are flushed to zero
+	 * rather than producing subnormals, which are very slow on most
+	 * hardware and are negligible as carving weights */
+	p = p * simd::pow2(k);
+	return simd::select(simd::lt(x, vec4d(EXP_MIN_ARG)), vec4d(0.0), p);
+}
+
+/**
+ * Computes exp(x) on each lane using the libm implementation
+ *
+ * @param x   The input values
+ *
+ * @return    Returns exp(x)
+ */
+static inline vec4d exp_exact(const vec4d& x)
+{
+	double v[SIMD_VEC4D_WIDTH];
+	int i;
+
+	x.store(v);
+	for(i = 0; i < SIMD_VEC4D_WIDTH; i++)
+		v[i] = exp(v[i]);
+	return vec4d::load(v);
+}
+
+/**
+ * Computes erf(x) on each lane using the libm implementation
+ *
+ * @param x   The input values
+ *
+ * @return    Returns erf(x)
+ */
+static inline vec4d erf_exact(const vec4d& x)
+{
+	double v[SIMD_VEC4D_WIDTH];
+	int i;
+
+	x.store(v);
+	for(i = 0; i < SIMD_VEC4D_WIDTH; i++)
+		v[i] = erf(v[i]);
+	return vec4d::load(v);
+}
+
+/**
+ * Computes erf(x) on each lane using Abramowitz & Stegun 7.1.26
+ *
+ * The absolute error of this approximation is at most 1.5e-7.
+ *
+ * @param x   The input values
+ *
+ * @return    Returns approximately erf(x)
+ */
+static inline vec4d erf_fast(const vec4d& x)
+{
+	vec4d a, t, p, y;
+
+	/* the approximation is for non-negative inputs, and erf()
+	 * is an odd function */
+	a = simd::abs(x);
+	t = vec4d(1.0) / (vec4d(1.0) + vec4d(0.3275911)*a);
+	p =          vec4d( 1.061405429);
+	p = p*t + vec4d(-1.453152027);
+	p = p*t + vec4d( 1.421413741);
+	p = p*t + vec4d(-0.284496736);
+	p = p*t + vec4d( 0.254829592);
+	y = vec4d(1.0) - p*t*exp_approx(vec4d(0.0) - a*a, EXP_DEGREE_FAST);
+	return simd::select(simd::lt(x, vec4d(0.0)), vec4d(0.0) - y, y);
+}
+
+/**
+ * Computes erf(x) on each lane using a Chebyshev fit of erfc()
+ *
+ * This is the approximation from Numerical Recipes (section 6.2),
+ * whose fractional error in erfc() is at most 1.2e-7, which is more
+ * accurate than erf_fast() in the tails of the distribution.
+ *
+ * @param x   The input values
+ *
+ * @return    Returns approximately erf(x)
+ */
+static inline vec4d erf_high(const vec4d& x)
+{
+	vec4d a, t, p, y;
+
+	/* the approximation is for non-negative inputs, and erf()
+	 * is an odd function */
+	a = simd::abs(x);
+	t = vec4d(1.0) / (vec4d(1.0) + vec4d(0.5)*a);
+	p =          vec4d( 0.17087277);
+	p = p*t + vec4d(-0.82215223);
+	p = p*t + vec4d( 1.48851587);
+	p = p*t + vec4d(-1.13520398);
+	p = p*t + vec4d( 0.27886807);
+	p = p*t + vec4d(-0.18628806);
+	p = p*t + vec4d( 0.09678418);
+	p = p*t + vec4d( 0.37409196);
+	p = p*t + vec4d( 1.00002368);
+	p = p*t + vec4d(-1.26551223);
+	y = vec4d(1.0) - t*exp_approx(p - a*a, EXP_DEGREE_HIGH);
+	return simd::select(simd::lt(x, vec4d(0.0)), vec4d(0.0) - y, y);
+}
+
+/**
+ * Reads the parameters of a different map on each lane
+ */
+class map_lanes_t
+{
+	public:
+
+		inline vec4d operator()(const double* p) const
+		{ return vec4d::load(p); };
+};
+
+/**
+ * Reads the parameters of the same map on every lane
+ */
+class one_map_t
+{
+	public:
+
+		/* the index of the map to read */
+		unsigned int i;
+
+		one_map_t(unsigned int ii) : i(ii) {};
+
+		inline vec4d operator()(const double* p) const
+		{ return vec4d(p[this->i]); };
+};
+
+/*--------------------------*/
+/* function implementations */
+/*--------------------------*/
+
+carve_map_batch_t::carve_map_batch_t()
+{
+	unsigned int i;
+
+	/* initialize default values */
+	this->accuracy = ACCURACY_HIGH;
+	for(i = 0; i < NUM_MAPS_PER_BATCH; i++)
+		this->maps[i] = NULL;
+}
+
+void carve_map_batch_t::init(carve_map_t* const* ms, ACCURACY acc)
+{
+	const carve_map_t* m;
+	double a, b;
+	unsigned int i, j;
+
+	/* save the accuracy level to use */
+	this->accuracy = acc;
+
+	/* copy the cached parameters of each map into the lanes */
+	for(i = 0; i < NUM_MAPS_PER_BATCH; i++)
+	{
+		m = ms[i];
+		this->maps[i] = m;
+
+		/* the erf() argument of the sensor-side plane is:
+		 *
+		 * 	ms_dist*neg_inv_sqrt_2v
+		 *	  = dot(norm, mean-x) * neg_inv_sqrt_2v / dot
+		 */
+		a = m->sensor_neg_inv_sqrt_2v / m->sensor_dot;
+		b = m->sensor_norm.dot(m->sensor_mean);
+		for(j = 0; j < 3; j++)
+			this->s_norm[j][i] = a * m->sensor_norm(j);
+		this->s_off[i]   = a * b;
+		this->s_scale[i] = 1.0 / m->sensor_neg_inv_sqrt_2v;
+
+		/* same for the scanpoint-side plane */
+		a = m->scanpoint_neg_inv_sqrt_2v / m->scanpoint_dot;
+		b = m->scanpoint_norm.dot(m->scanpoint_mean);
+		for(j = 0; j < 3; j++)
+			this->p_norm[j][i] = a * m->scanpoint_norm(j);
+		this->p_off[i]   = a * b;
+		this->p_scale[i] = 1.0 / m->scanpoint_neg_inv_sqrt_2v;
+
+		/* endpoint means */
+		for(j = 0; j < 3; j++)
+		{
+			this->s_mean[j][i] = m->sensor_mean(j);
+			this->p_mean[j][i] = m->scanpoint_mean(j);
+		}
+
+		/* upper triangles of covariances */
+		this->s_cov[0][i] = m->sensor_cov(0,0);
+		this->s_cov[1][i] = m->sensor_cov(0,1);
+		this->s_cov[2][i] = m->sensor_cov(0,2);
+		this->s_cov[3][i] = m->sensor_cov(1,1);
+		this->s_cov[4][i] = m->sensor_cov(1,2);
+		this->s_cov[5][i] = m->sensor_cov(2,2);
+		this->p_cov[0][i] = m->scanpoint_cov(0,0);
+		this->p_cov[1][i] = m->scanpoint_cov(0,1);
+		this->p_cov[2][i] = m->scanpoint_cov(0,2);
+		this->p_cov[3][i] = m->scanpoint_cov(1,1);
+		this->p_cov[4][i] = m->scanpoint_cov(1,2);
+		this->p_cov[5][i] = m->scanpoint_cov(2,2);
+
+		/* scanpoint pdf parameters */
+		this->mh_inv_cov[0][i] =   m->mh_scanpoint_inv_cov(0,0);
+		this->mh_inv_cov[1][i] = 2*m->mh_scanpoint_inv_cov(0,1);
+		this->mh_inv_cov[2][i] = 2*m->mh_scanpoint_inv_cov(0,2);
+		this->mh_inv_cov[3][i] =   m->mh_scanpoint_inv_cov(1,1);
+		this->mh_inv_cov[4][i] = 2*m->mh_scanpoint_inv_cov(1,2);
+		this->mh_inv_cov[5][i] =   m->mh_scanpoint_inv_cov(2,2);
+		this->pdf_coef[i] = m->scanpoint_pdf_coef;
+
+		/* curvature */
+		this->corner_prob[i] = m->corner_prob;
+		this->planar_prob[i] = m->planar_prob;
+	}
+}
+
+void carve_map_batch_t::compute(const Eigen::Vector3d& x, double xsize,
+                                double& val, double& weight, double& surf,
+                                double& corner, double& planar) const
+{
+	double vs[NUM_MAPS_PER_BATCH];
+	double ws[NUM_MAPS_PER_BATCH];
+	double ss[NUM_MAPS_PER_BATCH];
+	unsigned int i;
+
+	/* evaluate all the maps at once */
+	this->compute_lanes(x, xsize, vs, ws, ss);
+
+	/* fuse the per-map values in the same order as the
+	 * scalar loop of carve_wedge_t::apply_to_leaf() */
+	val = 0;
+	surf = 1;
+	corner = 0;
+	planar = 0;
+	weight = 0;
+	for(i = 0; i < NUM_MAPS_PER_BATCH; i++)
+	{
+		val    += ws[i]*vs[i];
+		weight += ws[i];
+		surf   *= (1-ss[i]);
+		corner += ws[i]*this->corner_prob[i];
+		planar += ws[i]*this->planar_prob[i];
+	}
+	val    /= weight;
+	surf    = 1 - surf;
+	corner /= weight;
+	planar /= weight;
+}
+
+void carve_map_batch_t::compute_block(size_t n, const Eigen::Vector3d* xs,
+                                      double xsize, double* vals,
+                                      double* weights, double* surfs,
+                                      double* corners,
+                                      double* planars) const
+{
+	double c[3][SIMD_VEC4D_WIDTH], out[5][SIMD_VEC4D_WIDTH];
+	double vs[SIMD_VEC4D_WIDTH];
+	vec4d x0, x1, x2, v, w, s, val, weight, surf, corner, planar;
+	vec4d one(1.0);
+	size_t i, j, k;
+	unsigned int m;
+
+	/* each lane holds a different location, and the maps are
+	 * applied to all of them in turn */
+	for(i = 0; i < n; i += k)
+	{
+		/* gather the next locations, repeating the last one
+		 * to fill the lanes past the end of the block */
+		k = std::min(n - i, (size_t) SIMD_VEC4D_WIDTH);
+		for(j = 0; j < SIMD_VEC4D_WIDTH; j++)
+		{
+			c[0][j] = xs[i + std::min(j, k-1)](0);
+			c[1][j] = xs[i + std::min(j, k-1)](1);
+			c[2][j] = xs[i + std::min(j, k-1)](2);
+		}
+		x0 = vec4d::load(c[0]);
+		x1 = vec4d::load(c[1]);
+		x2 = vec4d::load(c[2]);
+
+		/* fuse the maps in the same order as compute() */
+		val    = vec4d(0.0);
+		surf   = vec4d(1.0);
+		corner = vec4d(0.0);
+		planar = vec4d(0.0);
+		weight = vec4d(0.0);
+		for(m = 0; m < NUM_MAPS_PER_BATCH; m++)
+		{
+			this->compute_vectors(one_map_t(m), x0, x1, x2,
+			                      xsize, v, w, s);
+			val    = val + w*v;
+			weight = weight + w;
+			surf   = surf * (one - s);
+			corner = corner + w*vec4d(this->corner_prob[m]);
+			planar = planar + w*vec4d(this->planar_prob[m]);
+
+			/* the scalar path reports the details of any
+			 * non-finite value, so defer to it */
+			v.store(vs);
+			for(j = 0; j < k; j++)
+				if(!std::isfinite(vs[j])
+						&& this->maps[m] != NULL)
+					this->maps[m]->compute(xs[i+j],
+					                       xsize);
+		}
+		(val / weight).store(out[0]);
+		weight.store(out[1]);
+		(one - surf).store(out[2]);
+		(corner / weight).store(out[3]);
+		(planar / weight).store(out[4]);
+
+		/* export the results of the locations in the block */
+		for(j = 0; j < k; j++)
+		{
+			vals[i+j]    = out[0][j];
+			weights[i+j] = out[1][j];
+			surfs[i+j]   = out[2][j];
+			corners[i+j] = out[3][j];
+			planars[i+j] = out[4][j];
+		}
+	}
+}
+
+void carve_map_batch_t::compute_lanes(const Eigen::Vector3d& x,
+                                      double xsize, double* vs,
+                                      double* ws, double* ss) const
+{
+	vec4d v, w, s;
+	unsigned int i;
+
+	/* evaluate each map on its own lane at the query location */
+	this->compute_vectors(map_lanes_t(), vec4d(x(0)), vec4d(x(1)),
+	                      vec4d(x(2)), xsize, v, w, s);
+
+	/* export the results */
+	v.store(vs);
+	w.store(ws);
+	s.store(ss);
+
+	/* error check the output values.  The scalar path reports
+	 * the details of any non-finite value, so defer to it */
+	for(i = 0; i < NUM_MAPS_PER_BATCH; i++)
+		if(!std::isfinite(vs[i]) && this->maps[i] != NULL)
+			this->maps[i]->compute(x, xsize);
+}
+
+/*--------------------------*/
+/* private helper functions */
+/*--------------------------*/
+
+template<class LANES>
+void carve_map_batch_t::compute_vectors(const LANES& lanes,
+                                        const vec4d& x0, const vec4d& x1,
+                                        const vec4d& x2, double xsize,
+                                        vec4d& vs, vec4d& ws,
+                                        vec4d& ss) const
+{
+	vec4d s_arg, p_arg, ms_dist, mp_dist;
+	vec4d p_forward, p_inrange, f, omf, l0, l1, l2, d2, q;
+	vec4d p_lat, p_fl, p_total, m0, m1, m2, e, p;
+	vec4d zero(0.0), one(1.0), half(0.5);
+	vec4d inf(std::numeric_limits<double>::infinity());
+	vec4d min_arg(EXP_ZERO_ARG);
+
+	/* the erf() arguments for the distances of x from each
+	 * endpoint plane, as well as the distances themselves */
+	s_arg = lanes(this->s_off)
+		- lanes(this->s_norm[0])*x0
+		- lanes(this->s_norm[1])*x1
+		- lanes(this->s_norm[2])*x2;
+	p_arg = lanes(this->p_off)
+		- lanes(this->p_norm[0])*x0
+		- lanes(this->p_norm[1])*x1
+		- lanes(this->p_norm[2])*x2;
+	ms_dist = s_arg * lanes(this->s_scale);
+	mp_dist = p_arg * lanes(this->p_scale);
+
+	/* fractional position of x between sensor and scanpoint,
+	 * restricted to be between 0 and 1 */
+	f = (zero - ms_dist) / (mp_dist - ms_dist);
+	f = simd::max(simd::min(f, one), zero);
+	omf = one - f;
+
+	/* lateral offset of x from the blended mean */
+	l0 = x0 - (omf*lanes(this->s_mean[0])
+			+ f*lanes(this->p_mean[0]));
+	l1 = x1 - (omf*lanes(this->s_mean[1])
+			+ f*lanes(this->p_mean[1]));
+	l2 = x2 - (omf*lanes(this->s_mean[2])
+			+ f*lanes(this->p_mean[2]));
+	d2 = l0*l0 + l1*l1 + l2*l2;
+
+	/* the quadratic form of the blended covariance along the
+	 * (unnormalized) lateral direction */
+	q =       (omf*lanes(this->s_cov[0])
+			+ f*lanes(this->p_cov[0])) * l0*l0
+	  + vec4d(2.0)*(omf*lanes(this->s_cov[1])
+			+ f*lanes(this->p_cov[1])) * l0*l1
+	  + vec4d(2.0)*(omf*lanes(this->s_cov[2])
+			+ f*lanes(this->p_cov[2])) * l0*l2
+	  +       (omf*lanes(this->s_cov[3])
+			+ f*lanes(this->p_cov[3])) * l1*l1
+	  + vec4d(2.0)*(omf*lanes(this->s_cov[4])
+			+ f*lanes(this->p_cov[4])) * l1*l2
+	  +       (omf*lanes(this->s_cov[5])
+			+ f*lanes(this->p_cov[5])) * l2*l2;
+
+	/* the lateral variance is varlat = q / d2, so the gaussian
+	 * pdf at distance sqrt(d2) is:
+	 *
+	 * 	exp(-d2 / (2*varlat)) / sqrt(2*pi*varlat)
+	 */
+	e = zero - (d2*d2) / (vec4d(2.0)*q);
+	p = simd::sqrt(vec4d(2*M_PI) * q / d2);
+
+	/* Nearby locations are often all too far from the ray of a
+	 * map to be affected by it, which is common when each lane
+	 * is a different leaf of the same node.  If the pdf underflows
+	 * to zero on every lane, and every value is finite, then the
+	 * sample is exactly the a priori value, without evaluating
+	 * any of the exp() and erf() calls. */
+	if(simd::movemask(simd::lt(e, min_arg)) == ALL_LANES
+			&& simd::movemask(simd::lt(zero, p)) == ALL_LANES
+			&& simd::movemask(simd::lt(p, inf)) == ALL_LANES
+			&& simd::movemask(simd::lt(simd::abs(s_arg), inf))
+				== ALL_LANES
+			&& simd::movemask(simd::lt(simd::abs(p_arg), inf))
+				== ALL_LANES
+			&& std::isfinite(xsize))
+	{
+		p_lat = zero;
+		p_total = vec4d(PROBABILITY_A_PRIORI);
+	}
+	else
+	{
+		switch(this->accuracy)
+		{
+			case ACCURACY_EXACT:
+				p_lat = exp_exact(e) / p;
+				break;
+			case ACCURACY_FAST:
+				p_lat = exp_approx(e, EXP_DEGREE_FAST) / p;
+				break;
+			case ACCURACY_HIGH:
+			default:
+				p_lat = exp_approx(e, EXP_DEGREE_HIGH) / p;
+				break;
+		}
+		p_lat = p_lat * vec4d(xsize);
+
+		/* probability x is after the sensor, and before the
+		 * scanpoint */
+		switch(this->accuracy)
+		{
+			case ACCURACY_EXACT:
+				p_forward = half*(one + erf_exact(s_arg));
+				p_inrange = half*(one - erf_exact(p_arg));
+				break;
+			case ACCURACY_FAST:
+				p_forward = half*(one + erf_fast(s_arg));
+				p_inrange = half*(one - erf_fast(p_arg));
+				break;
+			case ACCURACY_HIGH:
+			default:
+				p_forward = half*(one + erf_high(s_arg));
+				p_inrange = half*(one - erf_high(p_arg));
+				break;
+		}
+		p_fl = p_forward * p_lat;
+
+		/* bournoulli expected value over the possible states */
+		p_total =   (p_fl * p_inrange)
+				* vec4d(PROBABILITY_INTERIOR)
+			  + (p_fl * (one - p_inrange))
+				* vec4d(PROBABILITY_TOOFAR)
+			  + (one - p_fl) * vec4d(PROBABILITY_A_PRIORI);
+	}
+
+	/* the surface probability is the scanpoint pdf at x,
+	 * integrated over a cube of width xsize */
+	m0 = x0 - lanes(this->p_mean[0]);
+	m1 = x1 - lanes(this->p_mean[1]);
+	m2 = x2 - lanes(this->p_mean[2]);
+	e =   lanes(this->mh_inv_cov[0])*m0*m0
+	    + lanes(this->mh_inv_cov[1])*m0*m1
+	    + lanes(this->mh_inv_cov[2])*m0*m2
+	    + lanes(this->mh_inv_cov[3])*m1*m1
+	    + lanes(this->mh_inv_cov[4])*m1*m2
+	    + lanes(this->mh_inv_cov[5])*m2*m2;
+	if(simd::movemask(simd::lt(e, min_arg)) == ALL_LANES
+			&& simd::movemask(simd::lt(simd::abs(
+				lanes(this->pdf_coef)), inf)) == ALL_LANES
+			&& std::isfinite(xsize))
+	{
+		/* the pdf underflows to zero on every lane */
+		p = zero;
+	}
+	else
+	{
+		switch(this->accuracy)
+		{
+			case ACCURACY_EXACT:
+				p = exp_exact(e);
+				break;
+			case ACCURACY_FAST:
+				p = exp_approx(e, EXP_DEGREE_FAST);
+				break;
+			case ACCURACY_HIGH:
+			default:
+				p = exp_approx(e, EXP_DEGREE_HIGH);
+				break;
+		}
+		p = p * lanes(this->pdf_coef)
+			* vec4d(xsize*xsize*xsize);
+	}
+
+	/* export the results */
+	vs = p_total;
+	ws = p_lat;
+	ss = p;
+}
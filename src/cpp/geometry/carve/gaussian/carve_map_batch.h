@@ -0,0 +1,231 @@
+#ifndef CARVE_MAP_BATCH_H
+#define CARVE_MAP_BATCH_H
+
+/**
+ * @file carve_map_batch.h
+ * @author Eric Turner <elturner@eecs.berkeley.edu>
+ *
+ * @section DESCRIPTION
+ *
+ * The carve_map_batch_t class is defined here.  This class packs
+ * the cached parameters of the four carve maps that make up a
+ * carve wedge into a structure-of-arrays layout, so that all four
+ * maps can be evaluated at a location with one pass of SIMD
+ * instructions (one map per lane).  A block of locations is evaluated
+ * with one location per lane instead, looping over the maps.
+ *
+ * The results are the same quantities that carve_wedge_t computes
+ * by calling carve_map_t::compute() and carve_map_t::get_surface_prob()
+ * on each map in turn, fused into a single weighted sample.  The erf()
+ * and exp() calls of the scalar path are replaced by vectorized
+ * polynomial approximations, whose precision is selected by the
+ * accuracy level of this object.
+ *
+ * This class requires the Eigen framework.
+ */
+
+#include <geometry/carve/gaussian/carve_map.h>
+#include <util/simd.h>
+#include <Eigen/Dense>
+#include <stddef.h>
+
+/* the number of maps evaluated together by this class.  This is
+ * the same as the number of maps in a carve wedge, and the same as
+ * the number of lanes in a simd::vec4d */
+#define NUM_MAPS_PER_BATCH 4
+
+/**
+ * This class evaluates four carve maps together at each location
+ */
+class carve_map_batch_t
+{
+	/* public types */
+	public:
+
+		/**
+		 * The accuracy levels of the vectorized evaluation
+		 *
+		 * The listed bounds are the differences of the fused
+		 * values with respect to the scalar carve_map_t path
+		 * that test_carve_map_batch allows.  They are absolute
+		 * for values up to one, and relative above that.
+		 */
+		enum ACCURACY
+		{
+			/* calls libm erf() and exp() on each lane, so the
+			 * results match the scalar path up to rounding
+			 * (within 1e-9) */
+			ACCURACY_EXACT = 0,
+
+			/* polynomial erf() with 1.2e-7 relative error in
+			 * its complement and a degree-11 exp(), for at
+			 * most 1e-6 difference in the output */
+			ACCURACY_HIGH  = 1,
+
+			/* polynomial erf() with 1.5e-7 absolute error and
+			 * a degree-5 exp(), for at most 2e-5 difference
+			 * in the output */
+			ACCURACY_FAST  = 2
+		};
+
+	/* parameters */
+	private:
+
+		/* the accuracy level of this object */
+		ACCURACY accuracy;
+
+		/* the following values are the distances of a location
+		 * from each endpoint plane of a map, pre-scaled so that:
+		 *
+		 * 	ms_dist * neg_inv_sqrt_2v
+		 * 		= s_off - dot(s_norm, x)
+		 *
+		 * Each array holds one value per map. */
+		double s_norm[3][NUM_MAPS_PER_BATCH];
+		double s_off[NUM_MAPS_PER_BATCH];
+		double s_scale[NUM_MAPS_PER_BATCH]; /* 1/neg_inv_sqrt_2v */
+		double p_norm[3][NUM_MAPS_PER_BATCH];
+		double p_off[NUM_MAPS_PER_BATCH];
+		double p_scale[NUM_MAPS_PER_BATCH]; /* 1/neg_inv_sqrt_2v */
+
+		/* the endpoint means of each map */
+		double s_mean[3][NUM_MAPS_PER_BATCH];
+		double p_mean[3][NUM_MAPS_PER_BATCH];
+
+		/* the upper triangles of the endpoint covariances of
+		 * each map, stored as xx, xy, xz, yy, yz, zz */
+		double s_cov[6][NUM_MAPS_PER_BATCH];
+		double p_cov[6][NUM_MAPS_PER_BATCH];
+
+		/* upper triangle of -0.5*inv(scanpoint_cov), with the
+		 * off-diagonal terms doubled, and the pdf coefficient */
+		double mh_inv_cov[6][NUM_MAPS_PER_BATCH];
+		double pdf_coef[NUM_MAPS_PER_BATCH];
+
+		/* the curvature estimates of each map */
+		double corner_prob[NUM_MAPS_PER_BATCH];
+		double planar_prob[NUM_MAPS_PER_BATCH];
+
+		/* the original maps, used to report non-finite results */
+		const carve_map_t* maps[NUM_MAPS_PER_BATCH];
+
+	/* functions */
+	public:
+
+		/*--------------*/
+		/* constructors */
+		/*--------------*/
+
+		/**
+		 * Constructs an empty batch
+		 */
+		carve_map_batch_t();
+
+		/**
+		 * Packs the given carve maps into this batch
+		 *
+		 * The maps are referenced only during this call and
+		 * when reporting errors, so they must persist as long
+		 * as this batch is used.
+		 *
+		 * @param ms    The maps to pack, NUM_MAPS_PER_BATCH of them
+		 * @param acc   The accuracy level to use
+		 */
+		void init(carve_map_t* const* ms, ACCURACY acc);
+
+		/*-------------*/
+		/* computation */
+		/*-------------*/
+
+		/**
+		 * Computes the fused sample of all maps at a location
+		 *
+		 * Evaluates every map in this batch at the given
+		 * location and size, and fuses the results in the same
+		 * manner as carve_wedge_t::apply_to_leaf():  the
+		 * interior probability, corner and planar estimates are
+		 * averaged using the confidence weight of each map, and
+		 * the surface probability is the probability that at
+		 * least one map's scanpoint is in the volume.
+		 *
+		 * @param x       The volume center in 3D space to analyze
+		 * @param xsize   The feature length of volume at x
+		 * @param val     Where to store the fused probability
+		 * @param weight  Where to store the total weight
+		 * @param surf    Where to store the surface probability
+		 * @param corner  Where to store the corner estimate
+		 * @param planar  Where to store the planar estimate
+		 */
+		void compute(const Eigen::Vector3d& x, double xsize,
+		             double& val, double& weight, double& surf,
+		             double& corner, double& planar) const;
+
+		/**
+		 * Computes the fused samples for a block of locations
+		 *
+		 * Evaluates the n locations given, one per lane, and
+		 * stores the results in the i'th element of each
+		 * output array.  The results are the same as calling
+		 * compute() on each location.
+		 *
+		 * @param n       The number of locations
+		 * @param xs      The volume centers to analyze
+		 * @param xsize   The feature length of the volumes
+		 * @param vals    Output array of fused probabilities
+		 * @param weights Output array of total weights
+		 * @param surfs   Output array of surface probabilities
+		 * @param corners Output array of corner estimates
+		 * @param planars Output array of planar estimates
+		 */
+		void compute_block(size_t n, const Eigen::Vector3d* xs,
+		                   double xsize, double* vals,
+		                   double* weights, double* surfs,
+		                   double* corners, double* planars) const;
+
+		/**
+		 * Computes the per-map values at a location
+		 *
+		 * This exposes the unfused per-lane results, which are
+		 * the vectorized equivalents of carve_map_t::compute()
+		 * and carve_map_t::get_surface_prob() for each map.
+		 *
+		 * @param x      The volume center in 3D space to analyze
+		 * @param xsize  The feature length of volume at x
+		 * @param vs     Output per-map interior probabilities
+		 * @param ws     Output per-map confidence weights
+		 * @param ss     Output per-map surface probabilities
+		 */
+		void compute_lanes(const Eigen::Vector3d& x, double xsize,
+		                   double* vs, double* ws, double* ss) const;
+
+	/* helper functions */
+	private:
+
+		/**
+		 * Evaluates maps at locations, one pair per lane
+		 *
+		 * The lanes of each location coordinate may be the same
+		 * location or different ones, and the given reader
+		 * gets the parameters of the map of each lane from the
+		 * arrays of this batch, which may also be the same map
+		 * or different ones.
+		 *
+		 * @param lanes   Reads the parameters of each lane
+		 * @param x0      The x-coordinates of the locations
+		 * @param x1      The y-coordinates of the locations
+		 * @param x2      The z-coordinates of the locations
+		 * @param xsize   The feature length of the volumes
+		 * @param vs      Output interior probabilities
+		 * @param ws      Output confidence weights
+		 * @param ss      Output surface probabilities
+		 */
+		template<class LANES>
+		void compute_vectors(const LANES& lanes,
+		                     const simd::vec4d& x0,
+		                     const simd::vec4d& x1,
+		                     const simd::vec4d& x2, double xsize,
+		                     simd::vec4d& vs, simd::vec4d& ws,
+		                     simd::vec4d& ss) const;
+};
+
+#endif
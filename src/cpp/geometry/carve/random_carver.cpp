@@ -10,14 +10,24 @@
 #include <util/progress_bar.h>
 #include <util/error_codes.h>
 #include <util/tictoc.h>
+#include <util/slab_allocator.h>
 #include <boost/threadpool.hpp>
 #include <boost/thread.hpp>
 #include <Eigen/Dense>
 #include <limits.h>
+#include <stdint.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <stdio.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <iostream>
 #include <string>
+#include <vector>
 #include <map>
 #include <set>
+#include <utility>
 
 /**
  * @file random_carver.cpp
@@ -34,6 +44,37 @@
 
 using namespace std;
 
+/* nodes that reference more wedges than this are split into
+ * sub-octants, which are carved as separate tasks */
+#define SPLIT_MIN_WEDGES 512
+
+/* nodes are only split if they are at least this many levels
+ * above the carving resolution */
+#define SPLIT_MIN_DEPTH  3
+
+/* the number of bits per dimension of the space-filling curve that
+ * wedges are sorted along */
+#define WEDGE_ORDER_BITS 10
+
+/* a wedge is only carved from below its chunk's node if it is at
+ * least this fraction of the start node's halfwidth away from the
+ * faces of that node, so that no rounding in the intersection tests
+ * could have made it touch a sibling of the start node */
+#define START_NODE_MARGIN 1e-6
+
+/* helper functions */
+int sort_wedges(vector<chunk::point_index_t>& order,
+                const octnode_t* node,
+                const set<chunk::point_index_t>& inds,
+                const cm_io::reader_t& carvemaps,
+                wedge::reader_t& wedges);
+octnode_t* find_start_node(vector<octnode_t*>& path,
+                           const carve_wedge_t& w, unsigned int maxdepth);
+bool contains_box(const Eigen::Vector3d& c, double hw,
+                  const Eigen::Vector3d& lo, const Eigen::Vector3d& hi);
+void print_chunk_stats(const vector<chunk_stats_t>& stats);
+void print_memory_usage();
+
 /* function implementations */
 		
 random_carver_t::random_carver_t()
@@ -41,14 +82,19 @@ random_carver_t::random_carver_t()
 	/* default parameter values */
 	this->num_threads = 1;
 	this->interpolate = true;
+	this->accuracy = carve_map_batch_t::ACCURACY_HIGH;
+	this->coherent = false;
 }
 
-void random_carver_t::init(double res, unsigned int nt, bool interp)
+void random_carver_t::init(double res, unsigned int nt, bool interp,
+                           carve_map_batch_t::ACCURACY acc, bool coh)
 {
 	/* initialize octree and algorithm parameters */
 	this->tree.set_resolution(res);
 	this->num_threads = nt;
 	this->interpolate = interp;
+	this->accuracy = acc;
+	this->coherent = coh;
 }
 		
 int random_carver_t::export_chunks(const string& cmfile,
@@ -70,7 +116,16 @@ int random_carver_t::export_chunks(const string& cmfile,
 	int ret;
 
 	/* open chunk exporter */
-	chunker.open(chunklist, chunk_dir);
+	ret = chunker.open(chunklist, chunk_dir);
+	if(ret)
+	{
+		/* an error occurred */
+		ret = PROPEGATE_ERROR(-9, ret);
+		cerr << "[random_carver_t::export_chunks]\tError "
+		     << ret << ": Unable to open chunk archive for: "
+		     << chunklist << endl << endl;
+		return ret;
+	}
 
 	/* open carve map file */
 	ret = cm_infile.open(cmfile);
@@ -189,7 +244,7 @@ int random_carver_t::export_chunks(const string& cmfile,
 		/* prepare wedge information */
 		w.init(&a1, &a2, &b1, &b2, 
 				wedge_infile.carving_buf(),
-				this->interpolate); 
+				this->interpolate, this->accuracy);
 
 		/* prepare the chunker with the info for this wedge */
 		vals.resize(1);
@@ -221,7 +276,15 @@ int random_carver_t::export_chunks(const string& cmfile,
 
 	/* close this chunker, which will finish exporting all files */
 	tic(clk);
-	chunker.close(this->tree);
+	ret = chunker.close(this->tree);
+	if(ret)
+	{
+		ret = PROPEGATE_ERROR(-10, ret);
+		cerr << "[random_carver_t::export_chunks]\tError "
+		     << ret << ": Unable to finish exporting chunks"
+		     << endl << endl;
+		return ret;
+	}
 	toc(clk, "Exporting chunk list");
 
 	/* success */
@@ -234,16 +297,20 @@ int random_carver_t::carve_all_chunks(const string& cmfile,
 {
 	Eigen::Vector3d treecenter;
 	chunk::chunklist_reader_t chunk_infile;
+	chunk::chunk_archive_reader_t archive;
 	cm_io::reader_t cm_infile;
 	wedge::reader_t wedge_infile;
+	vector<chunk_stats_t> stats;
 	progress_bar_t progbar;
 	size_t i, num_chunks;
 	string chunkfile;
 	tictoc_t clk;
 	int ret;
 
-	/* initialize threadpool */
-	boost::threadpool::pool tp(this->num_threads);
+	/* initialize threadpool.  Tasks are prioritized so that
+	 * the pieces of split chunks are carved before new chunks
+	 * are started. */
+	boost::threadpool::prio_pool tp(this->num_threads);
 
 	/* attempt to parse the chunklist file */
 	tic(clk);
@@ -266,6 +333,23 @@ int random_carver_t::carve_all_chunks(const string& cmfile,
 	this->tree.set(treecenter, chunk_infile.halfwidth(),
 	               this->tree.get_resolution());
 
+	/* if the chunks are packed in an archive, open it once
+	 * here rather than once per chunk */
+	if(!(chunk_infile.archive_file().empty()))
+	{
+		ret = archive.open(chunk_infile.archive_file());
+		if(ret)
+		{
+			chunk_infile.close();
+			ret = PROPEGATE_ERROR(-6, ret);
+			cerr << "[random_carver_t::carve_all_chunks]\t"
+			     << "Error " << ret << ": Unable to read "
+			     << "chunk archive: "
+			     << chunk_infile.archive_file() << endl;
+			return ret;
+		}
+	}
+
 	/* open the carve map file for reading */
 	ret = cm_infile.open(cmfile);
 	if(ret)
@@ -298,6 +382,7 @@ int random_carver_t::carve_all_chunks(const string& cmfile,
 	tic(clk);
 	progbar.set_name("Processing chunks");
 	num_chunks = chunk_infile.num_chunks();
+	vector<chunk_stats_t>(num_chunks).swap(stats);
 	for(i = 0; i < num_chunks; i++)
 	{
 		/* update user */
@@ -321,7 +406,7 @@ int random_carver_t::carve_all_chunks(const string& cmfile,
 
 		/* process this chunk */
 		ret = this->carve_chunk(cm_infile, wedge_infile,
-					chunkfile, tp); 
+					chunkfile, &archive, tp, &(stats[i]));
 		if(ret)
 		{
 			/* report error and continue */
@@ -348,27 +433,36 @@ int random_carver_t::carve_all_chunks(const string& cmfile,
 	tp.wait();
 
 	/* attempt to fully simplify the entire tree */
-	this->tree.get_root()->simplify_recur();
+	this->tree.simplify(this->num_threads);
 	
 	/* clean up */
 	chunk_infile.close();
+	archive.close();
 	cm_infile.close();
 	wedge_infile.close();
 	progbar.clear();
 	toc(clk, "Processing all chunks");
+	print_chunk_stats(stats);
+	print_memory_usage();
 
 	/* success */
 	return 0;
 }
 
-int random_carver_t::serialize(const string& octfile) const
+int random_carver_t::serialize(const string& octfile,
+                               bool compress) const
 {
+	chrono::steady_clock::time_point start;
+	struct stat st;
+	double elapsed, mb;
 	tictoc_t clk;
 	int ret;
 
 	/* serialize the octree */
 	tic(clk);
-	ret = this->tree.serialize(octfile);
+	start = chrono::steady_clock::now();
+	ret = this->tree.serialize(octfile, compress,
+	                           this->num_threads);
 	if(ret)
 	{
 		/* unable to write to file, inform user */
@@ -380,6 +474,16 @@ int random_carver_t::serialize(const string& octfile) const
 	}
 	toc(clk, "Exporting octfile");
 
+	/* report the rate at which the file was written */
+	elapsed = chrono::duration<double>(chrono::steady_clock::now()
+				- start).count();
+	mb = (stat(octfile.c_str(), &st) == 0)
+			? (st.st_size / (1024.0 * 1024.0)) : 0;
+	cout << "[random_carver_t::serialize]\tWrote " << mb << " MB"
+	     << (compress ? " (compressed)" : "") << " in " << elapsed
+	     << " seconds (" << (mb / max(elapsed, 1e-9)) << " MB/s)"
+	     << endl;
+
 	/* success */
 	return 0;
 }
@@ -387,17 +491,20 @@ int random_carver_t::serialize(const string& octfile) const
 int random_carver_t::carve_chunk(cm_io::reader_t& carvemaps,
 			wedge::reader_t& wedges,
 			const string& chunkfile,
-			boost::threadpool::pool& tp)
+			const chunk::chunk_archive_reader_t* archive,
+			boost::threadpool::prio_pool& tp,
+			chunk_stats_t* stats)
 {
 	Eigen::Vector3d chunkcenter;
 	set<chunk::point_index_t> inds;
 	chunk::chunk_reader_t infile;
 	octnode_t* chunknode;
 	unsigned int chunkdepth;
+	carve_job_t* job;
 	int ret;
 
 	/* open this chunk file for reading */
-	ret = infile.open(chunkfile);
+	ret = infile.open(chunkfile, archive);
 	if(ret)
 		return PROPEGATE_ERROR(-1, ret);
 
@@ -430,26 +537,38 @@ int random_carver_t::carve_chunk(cm_io::reader_t& carvemaps,
 	                              chunkdepth);
 	if(chunknode == NULL)
 		return PROPEGATE_ERROR(-3, ret); /* tree not initialized */
+	stats->chunkfile  = chunkfile;
+	stats->num_wedges = inds.size();
 
 	/* process this node based on the input chunk data */
 	if(this->num_threads > 1)
 	{
 		/* the input settings say to multithread this
 		 * processing, so schedule the carving of this node
-		 * into the threadpool */
-		tp.schedule(boost::bind(random_carver_t::carve_node,
-			chunknode, inds, boost::ref(carvemaps),
-			boost::ref(wedges),
-			chunkdepth, this->interpolate, false));
+		 * into the threadpool.  If the chunk is large, it
+		 * will be split further once the task starts. */
+		job = new carve_job_t(chunknode, NULL, stats);
+		tp.schedule(boost::threadpool::prio_task_func(job->level,
+			boost::bind(random_carver_t::carve_subtree,
+			&tp, job, inds, boost::ref(carvemaps),
+			boost::ref(wedges), chunkdepth,
+			this->interpolate, this->accuracy,
+			this->coherent)));
 	}
 	else
 	{
 		/* since we're not going to use multiple threads, don't
 		 * bother using the threadpool at all, and instead just
 		 * process the chunk using a direct function call */
+		stats->num_tasks = 1;
+		stats->start = chrono::steady_clock::now();
 		ret = random_carver_t::carve_node(chunknode, inds,
 				carvemaps, wedges, chunkdepth, 
-				this->interpolate, true);
+				this->interpolate, true, this->accuracy,
+				this->coherent, stats);
+		stats->elapsed = chrono::duration<double>(
+				chrono::steady_clock::now()
+				- stats->start).count();
 		if(ret)
 		{
 			/* error occurred */
@@ -469,20 +588,24 @@ int random_carver_t::carve_node(octnode_t* chunknode,
 			set<chunk::point_index_t> inds,
 			cm_io::reader_t& carvemaps,
 			wedge::reader_t& wedges,
-			unsigned int maxdepth, 
-			bool interp, bool verbose)
+			unsigned int maxdepth,
+			bool interp, bool verbose,
+			carve_map_batch_t::ACCURACY acc,
+			bool coherent, chunk_stats_t* stats)
 {
-	set<chunk::point_index_t>::iterator it;
+	vector<chunk::point_index_t> order;
+	vector<octnode_t*> path;
 	unsigned int ia, ib; /* frame indices */
 	unsigned int ia1, ia2, ib1, ib2; /* indices of imported carvemaps */
-	carve_map_t a1, a2, b1, b2; /* imported carve maps */
+	carve_map_t *a1, *a2, *b1, *b2; /* cached carve maps */
+	cm_io::cache_t cache;
+	octnode_t* start;
 	carve_wedge_t w;
 	unsigned int i, n;
 	progress_bar_t progbar;
 	int ret;
 
 	/* prepare a progress bar if running in verbose mode */
-	i = 0;
 	n = inds.size();
 	if(verbose)
 	{
@@ -493,86 +616,555 @@ int random_carver_t::carve_node(octnode_t* chunknode,
 		progbar.set_color(progress_bar_t::PURPLE);
 	}
 
+	/* determine the order to carve the wedges in */
+	if(coherent)
+	{
+		/* sort along a space-filling curve */
+		ret = sort_wedges(order, chunknode, inds, carvemaps, wedges);
+		if(ret)
+		{
+			/* invalid index */
+			ret = PROPEGATE_ERROR(-1, ret);
+			cerr << "[random_carver_t::carve_node]\tError "
+			     << ret << ": Unable to sort wedges"
+			     << endl << endl;
+			return ret;
+		}
+	}
+	else
+		order.assign(inds.begin(), inds.end());
+
 	/* iterate over the indices referenced in this chunk */
-	for(it = inds.begin(); it != inds.end(); it++)
+	path.push_back(chunknode);
+	for(i = 0; i < n; i++)
 	{
 		/* optionally show progress to user */
 		if(verbose)
-			progbar.update(i++, n);
+			progbar.update(i, n);
 
 		/* parse current wedge */
 		ret = wedges.get(ia, ia1, ia2, ib, ib1, ib2,
-				it->wedge_index);
+				order[i].wedge_index);
 		if(ret)
 		{
 			/* invalid index */
-			ret = PROPEGATE_ERROR(-1, ret);
+			ret = PROPEGATE_ERROR(-2, ret);
 			cerr << "[random_carver_t::carve_node]\tError "
 			     << ret << ": Unable to get wedge #"
-			     << it->wedge_index << " from wedge file"
+			     << order[i].wedge_index << " from wedge file"
 			     << endl << endl;
 			return ret;
 		}
 
 		/* prepare the carve maps to be used for this wedge */
-		ret = carvemaps.read(a1, ia, ia1);
+		ret = cache.get(a1, carvemaps, ia, ia1);
 		if(ret)
 		{
 			/* error occurred */
-			ret = PROPEGATE_ERROR(-2, ret);
+			ret = PROPEGATE_ERROR(-3, ret);
 			cerr << "[random_carver_t::carve_node]\tError "
 			     << ret << ": Could not parse carvemap for "
-			     << "wedge #" << it->wedge_index 
+			     << "wedge #" << order[i].wedge_index
 			     << endl << endl;
 			return ret;
 		}
-		ret = carvemaps.read(a2, ia, ia2);
+		ret = cache.get(a2, carvemaps, ia, ia2);
 		if(ret)
 		{
 			/* error occurred */
-			ret = PROPEGATE_ERROR(-3, ret);
+			ret = PROPEGATE_ERROR(-4, ret);
 			cerr << "[random_carver_t::carve_node]\tError "
 			     << ret << ": Could not parse carvemap for "
-			     << "wedge #" << it->wedge_index 
+			     << "wedge #" << order[i].wedge_index
 			     << endl << endl;
 			return ret;
 		}
-		ret = carvemaps.read(b1, ib, ib1);
+		ret = cache.get(b1, carvemaps, ib, ib1);
 		if(ret)
 		{
 			/* error occurred */
-			ret = PROPEGATE_ERROR(-4, ret);
+			ret = PROPEGATE_ERROR(-5, ret);
 			cerr << "[random_carver_t::carve_node]\tError "
 			     << ret << ": Could not parse carvemap for "
-			     << "wedge #" << it->wedge_index 
+			     << "wedge #" << order[i].wedge_index
 			     << endl << endl;
 			return ret;
 		}
-		ret = carvemaps.read(b2, ib, ib2);
+		ret = cache.get(b2, carvemaps, ib, ib2);
 		if(ret)
 		{
 			/* error occurred */
-			ret = PROPEGATE_ERROR(-5, ret);
+			ret = PROPEGATE_ERROR(-6, ret);
 			cerr << "[random_carver_t::carve_node]\tError "
 			     << ret << ": Could not parse carvemap for "
-			     << "wedge #" << it->wedge_index 
+			     << "wedge #" << order[i].wedge_index
 			     << endl << endl;
 			return ret;
 		}
-		
+
 		/* prepare wedge information */
-		w.init(&a1, &a2, &b1, &b2, 
+		w.init(a1, a2, b1, b2,
 				wedges.carving_buf(),
-				interp);
+				interp, acc);
 
 		/* carve the referenced wedge only in the domain of the
-		 * given node */
-		chunknode->insert(w, maxdepth);
+		 * given node, starting from the deepest node that
+		 * contains it */
+		start = find_start_node(path, w, maxdepth);
+		if(start != NULL)
+			start->insert(w, maxdepth - (path.size() - 1));
 	}
 
 	/* simplify this chunk now that it is fully carved */
 	chunknode->simplify_recur();
 
+	/* record how many carve maps were read */
+	if(stats != NULL)
+	{
+		stats->num_map_gets  += cache.get_num_gets();
+		stats->num_map_reads += cache.get_num_reads();
+	}
+
+	/* success */
+	return 0;
+}
+
+int random_carver_t::carve_subtree(boost::threadpool::prio_pool* tp,
+			carve_job_t* job,
+			set<chunk::point_index_t> inds,
+			cm_io::reader_t& carvemaps,
+			wedge::reader_t& wedges,
+			unsigned int maxdepth, bool interp,
+			carve_map_batch_t::ACCURACY acc,
+			bool coherent)
+{
+	vector<set<chunk::point_index_t> > subinds;
+	carve_job_t* subjob;
+	unsigned int i;
+	int ret;
+
+	/* the first task of a chunk starts its clock */
+	if(job->parent == NULL)
+		job->stats->start = chrono::steady_clock::now();
+	job->stats->num_tasks++;
+
+	/* check if this subtree is large enough to be worth
+	 * splitting.  A node with data would be carved at this
+	 * level by insert(), so it can't be split. */
+	if(inds.size() <= SPLIT_MIN_WEDGES || maxdepth < SPLIT_MIN_DEPTH
+			|| job->node->data != NULL)
+	{
+		/* carve the whole subtree in this task */
+		ret = random_carver_t::carve_node(job->node, inds,
+				carvemaps, wedges, maxdepth, interp,
+				false, acc, coherent, job->stats);
+		carve_job_t::finish(job);
+		if(ret)
+		{
+			/* error occurred */
+			ret = PROPEGATE_ERROR(-1, ret);
+			cerr << "[random_carver_t::carve_subtree]\tError "
+			     << ret << ": Unable to carve node"
+			     << endl << endl;
+			return ret;
+		}
+		return 0;
+	}
+
+	/* sort the wedges by which sub-octants they carve */
+	ret = random_carver_t::split_node(job->node, inds, subinds,
+				carvemaps, wedges, interp);
+	if(ret)
+	{
+		/* error occurred */
+		carve_job_t::finish(job);
+		ret = PROPEGATE_ERROR(-2, ret);
+		cerr << "[random_carver_t::carve_subtree]\tError "
+		     << ret << ": Unable to split node"
+		     << endl << endl;
+		return ret;
+	}
+
+	/* schedule each sub-octant as its own task.  These are
+	 * disjoint subtrees, so they can be carved without locks. */
+	job->split = true;
+	for(i = 0; i < CHILDREN_PER_NODE; i++)
+	{
+		/* check if any wedges carve this sub-octant */
+		if(subinds[i].empty())
+			continue;
+
+		/* make a job for it */
+		subjob = new carve_job_t(job->node->children[i],
+		                         job, job->stats);
+		job->remaining++;
+		tp->schedule(boost::threadpool::prio_task_func(
+			subjob->level,
+			boost::bind(random_carver_t::carve_subtree,
+			tp, subjob, subinds[i], boost::ref(carvemaps),
+			boost::ref(wedges), maxdepth-1, interp, acc,
+			coherent)));
+	}
+
+	/* this task is done, but the job will not finish until
+	 * all its sub-octants are carved */
+	carve_job_t::finish(job);
+	return 0;
+}
+
+int random_carver_t::split_node(octnode_t* node,
+			const set<chunk::point_index_t>& inds,
+			vector<set<chunk::point_index_t> >& subinds,
+			cm_io::reader_t& carvemaps,
+			wedge::reader_t& wedges, bool interp)
+{
+	set<chunk::point_index_t>::const_iterator it;
+	unsigned int ia, ib; /* frame indices */
+	unsigned int ia1, ia2, ib1, ib2; /* indices of imported carvemaps */
+	Eigen::Vector3d s_means[NUM_MAPS_PER_WEDGE];
+	Eigen::Vector3d p_means[NUM_MAPS_PER_WEDGE];
+	double p_vars[NUM_MAPS_PER_WEDGE];
+	Eigen::Vector3d child_center;
+	carve_wedge_t w;
+	unsigned int i;
+	double chw;
+	int ret;
+
+	/* prepare output */
+	subinds.clear();
+	subinds.resize(CHILDREN_PER_NODE);
+	chw = node->halfwidth / 2; /* children are half the width */
+
+	/* iterate over the indices referenced in this node */
+	for(it = inds.begin(); it != inds.end(); it++)
+	{
+		/* parse current wedge.  Only its shape is needed to
+		 * classify it, so read just the means and variances
+		 * of its carve maps, like sort_wedges() does, and
+		 * leave reading the full maps to the sub-tasks. */
+		ret = wedges.get(ia, ia1, ia2, ib, ib1, ib2,
+				it->wedge_index);
+		if(ret)
+			return PROPEGATE_ERROR(-1, ret);
+		ret = carvemaps.read_extent(s_means[0], p_means[0],
+				p_vars[0], ia, ia1);
+		if(ret)
+			return PROPEGATE_ERROR(-2, ret);
+		ret = carvemaps.read_extent(s_means[1], p_means[1],
+				p_vars[1], ia, ia2);
+		if(ret)
+			return PROPEGATE_ERROR(-3, ret);
+		ret = carvemaps.read_extent(s_means[2], p_means[2],
+				p_vars[2], ib, ib1);
+		if(ret)
+			return PROPEGATE_ERROR(-4, ret);
+		ret = carvemaps.read_extent(s_means[3], p_means[3],
+				p_vars[3], ib, ib2);
+		if(ret)
+			return PROPEGATE_ERROR(-5, ret);
+		w.init_shape(s_means, p_means, p_vars,
+				wedges.carving_buf(), interp);
+
+		/* check which children this wedge intersects, in
+		 * the same way as octnode_t::insert() */
+		for(i = 0; i < CHILDREN_PER_NODE; i++)
+		{
+			/* check for intersection */
+			if(node->children[i] != NULL)
+			{
+				if(!w.intersects(node->children[i]->center,
+				                 node->children[i]->halfwidth))
+					continue;
+			}
+			else
+			{
+				child_center = relative_child_pos(i)*chw
+						+ node->center;
+				if(!w.intersects(child_center, chw))
+					continue;
+
+				/* make the subnode */
+				node->children[i] = new octnode_t(
+						child_center, chw);
+			}
+
+			/* this wedge carves this child */
+			subinds[i].insert(subinds[i].end(), *it);
+		}
+	}
+
+	/* success */
+	return 0;
+}
+
+int sort_wedges(vector<chunk::point_index_t>& order,
+                const octnode_t* node,
+                const set<chunk::point_index_t>& inds,
+                const cm_io::reader_t& carvemaps,
+                wedge::reader_t& wedges)
+{
+	vector<pair<uint32_t, chunk::point_index_t> > keys;
+	set<chunk::point_index_t>::const_iterator it;
+	unsigned int ia, ib; /* frame indices */
+	unsigned int ia1, ia2, ib1, ib2; /* indices of carvemaps */
+	Eigen::Vector3d s, p, c;
+	unsigned int j, k;
+	uint32_t code, q;
+	double scale, x;
+	int ret;
+
+	/* the curve covers the node, split into a grid of
+	 * 2^WEDGE_ORDER_BITS cells along each dimension */
+	scale = (1 << WEDGE_ORDER_BITS) / (2*node->halfwidth);
+	keys.reserve(inds.size());
+	for(it = inds.begin(); it != inds.end(); it++)
+	{
+		/* get the centroid of the wedge's vertices, which
+		 * are at the means of its sensors and scan points */
+		ret = wedges.get(ia, ia1, ia2, ib, ib1, ib2,
+				it->wedge_index);
+		if(ret)
+			return PROPEGATE_ERROR(-1, ret);
+		ret = carvemaps.read_means(s, p, ia, ia1);
+		if(ret)
+			return PROPEGATE_ERROR(-2, ret);
+		c = s + p;
+		ret = carvemaps.read_means(s, p, ia, ia2);
+		if(ret)
+			return PROPEGATE_ERROR(-3, ret);
+		c += p;
+		ret = carvemaps.read_means(s, p, ib, ib1);
+		if(ret)
+			return PROPEGATE_ERROR(-4, ret);
+		c += s + p;
+		ret = carvemaps.read_means(s, p, ib, ib2);
+		if(ret)
+			return PROPEGATE_ERROR(-5, ret);
+		c += p;
+		c /= NUM_VERTICES_PER_WEDGE;
+
+		/* find the Morton code of the grid cell that contains
+		 * the centroid, clamped to the node */
+		code = 0;
+		for(k = 0; k < 3; k++)
+		{
+			x = (c(k) - node->center(k) + node->halfwidth)
+					* scale;
+			x = min(max(x, 0.0), 
+				(double) ((1 << WEDGE_ORDER_BITS) - 1));
+			q = (uint32_t) x;
+			for(j = 0; j < WEDGE_ORDER_BITS; j++)
+				code |= ((q >> j) & 1) << (3*j + k);
+		}
+		keys.push_back(make_pair(code, *it));
+	}
+
+	/* sort by code, keeping index order within each cell */
+	sort(keys.begin(), keys.end());
+	order.resize(keys.size());
+	for(j = 0; j < keys.size(); j++)
+		order[j] = keys[j].second;
+
 	/* success */
 	return 0;
 }
+
+octnode_t* find_start_node(vector<octnode_t*>& path,
+                           const carve_wedge_t& w, unsigned int maxdepth)
+{
+	Eigen::Vector3d lo, hi, c;
+	octnode_t* node;
+	unsigned int i;
+	bool tested;
+	double chw;
+	int j;
+
+	/* get the bounds of the part of the wedge that is within
+	 * the chunk's node, which is the first node of the path */
+	lo = hi = w.get_vertex(0);
+	for(i = 1; i < NUM_VERTICES_PER_WEDGE; i++)
+	{
+		lo = lo.cwiseMin(w.get_vertex(i));
+		hi = hi.cwiseMax(w.get_vertex(i));
+	}
+	node = path[0];
+	c << node->halfwidth, node->halfwidth, node->halfwidth;
+	lo = lo.cwiseMax(node->center - c);
+	hi = hi.cwiseMin(node->center + c);
+	if((lo.array() > hi.array()).any())
+	{
+		/* the wedge doesn't overlap the node, so leave it
+		 * to insert() to reject it */
+		path.resize(1);
+		return path[0];
+	}
+
+	/* walk up from the start node of the previous wedge until
+	 * the node contains these bounds */
+	while(path.size() > 1 && !contains_box(path.back()->center,
+				path.back()->halfwidth, lo, hi))
+		path.pop_back();
+
+	/* walk down while a child contains the bounds.  Children are
+	 * only made if the wedge intersects them, as insert() would
+	 * do.  Stop one level above the max depth, so that leaves
+	 * are still carved together by insert(). */
+	node = path.back();
+	tested = false;
+	while(path.size() < maxdepth)
+	{
+		/* get the child that contains the center of the bounds */
+		j = node->contains(0.5*(lo + hi));
+		if(j < 0)
+			break;
+		chw = node->halfwidth / 2;
+		c = (node->children[j] != NULL)
+			? node->children[j]->center
+			: (Eigen::Vector3d) (relative_child_pos(j)*chw
+					+ node->center);
+		if(!contains_box(c, chw, lo, hi))
+			break;
+
+		/* make sure the child exists, and doesn't already
+		 * have data, which insert() would carve directly */
+		if(node->children[j] == NULL)
+		{
+			if(!w.intersects(c, chw))
+				return NULL; /* wedge doesn't touch chunk */
+			node->children[j] = new octnode_t(c, chw);
+			tested = true;
+		}
+		else if(node->children[j]->data != NULL)
+			break;
+		else
+			tested = false;
+
+		/* move down */
+		node = node->children[j];
+		path.push_back(node);
+	}
+
+	/* since the part of the wedge within the chunk is inside
+	 * this node, if the wedge intersects this node then it
+	 * intersects every node above it, and no others */
+	if(path.size() > 1 && !tested
+			&& !w.intersects(node->center, node->halfwidth))
+		return NULL;
+	return node;
+}
+
+bool contains_box(const Eigen::Vector3d& c, double hw,
+                  const Eigen::Vector3d& lo, const Eigen::Vector3d& hi)
+{
+	double m;
+
+	/* check the bounds against the shrunk node */
+	m = hw * (1 - START_NODE_MARGIN);
+	return ((lo - c).minCoeff() > -m && (hi - c).maxCoeff() < m);
+}
+
+void print_chunk_stats(const vector<chunk_stats_t>& stats)
+{
+	vector<double> times;
+	double total;
+	size_t i, slowest, gets, reads;
+
+	/* check arguments */
+	if(stats.empty())
+		return;
+
+	/* gather the times of each chunk */
+	times.resize(stats.size());
+	total = 0;
+	slowest = 0;
+	for(i = 0; i < stats.size(); i++)
+	{
+		times[i] = stats[i].elapsed;
+		total += times[i];
+		if(times[i] > times[slowest])
+			slowest = i;
+	}
+	sort(times.begin(), times.end());
+
+	/* report the distribution, so that any long tail
+	 * of slow chunks can be seen */
+	printf("%32s %.3f sec\n", "Mean chunk time", 
+	       total / times.size());
+	printf("%32s %.3f sec\n", "Median chunk time",
+	       times[times.size() / 2]);
+	printf("%32s %.3f sec\n", "99th percentile chunk time",
+	       times[(99 * (times.size()-1)) / 100]);
+	printf("%32s %.3f sec (%u wedges, %u tasks)\n",
+	       "Slowest chunk time", stats[slowest].elapsed,
+	       (unsigned int) stats[slowest].num_wedges,
+	       (unsigned int) stats[slowest].num_tasks);
+
+	/* report how often carve maps were found in the caches */
+	gets = reads = 0;
+	for(i = 0; i < stats.size(); i++)
+	{
+		gets  += stats[i].num_map_gets;
+		reads += stats[i].num_map_reads;
+	}
+	if(gets > 0)
+		printf("%32s %.2f (%.1f%% cached)\n",
+		       "Carve maps read per wedge",
+		       (NUM_MAPS_PER_WEDGE * (double) reads) / gets,
+		       (100.0 * (gets - reads)) / gets);
+}
+
+void print_memory_usage()
+{
+	struct rusage usage;
+
+	/* the slabs hold all nodes of the tree, and the peak
+	 * size of the process includes all input buffers */
+	printf("%32s %.1f MB\n", "Octree memory",
+	       (slab_allocator_t<octnode_t>::num_bytes()
+	        + slab_allocator_t<octdata_t>::num_bytes()) / 1048576.0);
+	if(getrusage(RUSAGE_SELF, &usage) == 0)
+		printf("%32s %.1f MB\n", "Peak memory usage",
+		       usage.ru_maxrss / 1024.0);
+}
+
+/*-----------------------*/
+/* carve_job_t functions */
+/*-----------------------*/
+
+void carve_job_t::finish(carve_job_t* job)
+{
+	carve_job_t* p;
+	unsigned int i;
+	bool simp;
+
+	/* iterate up the job tree while the jobs are
+	 * complete */
+	while(job != NULL && --(job->remaining) == 0)
+	{
+		/* the children of a split job were already
+		 * simplified by their own jobs */
+		if(job->split && !(job->node->isleaf()))
+		{
+			simp = true;
+			for(i = 0; i < CHILDREN_PER_NODE; i++)
+				if(job->node->children[i] == NULL
+					|| !(job->node->children[i]
+					->isleaf()))
+					simp = false;
+			if(simp)
+				job->node->simplify();
+		}
+
+		/* the whole chunk is done */
+		if(job->parent == NULL)
+			job->stats->elapsed =
+				chrono::duration<double>(
+				chrono::steady_clock::now()
+				- job->stats->start).count();
+
+		/* move on to parent */
+		p = job->parent;
+		delete job;
+		job = p;
+	}
+}
@@ -18,12 +18,20 @@
 #include <io/carve/chunk_io.h>
 #include <io/carve/wedge_io.h>
 #include <io/carve/carve_map_io.h>
+#include <geometry/carve/gaussian/carve_map_batch.h>
 #include <geometry/octree/octree.h>
 #include <boost/threadpool.hpp>
+#include <atomic>
+#include <chrono>
 #include <string>
 #include <vector>
 #include <set>
 
+/* the following classes are defined in this file */
+class random_carver_t;
+class chunk_stats_t;
+class carve_job_t;
+
 /**
  * The random_carver_t class builds an octree using carve wedges.
  *
@@ -58,6 +66,15 @@ class random_carver_t
 		 */
 		bool interpolate;
 
+		/* the accuracy level used when evaluating the carve
+		 * maps of each wedge with vectorized instructions */
+		carve_map_batch_t::ACCURACY accuracy;
+
+		/* indicates whether the wedges of each chunk should
+		 * be carved in a spatially coherent order, rather than
+		 * in order of their indices */
+		bool coherent;
+
 	/* functions */
 	public:
 
@@ -77,8 +94,15 @@ class random_carver_t
 		 * @param nt        The number of threads to use
 		 * @param interp    Indicates whether scans should be
 		 *                  interpolated
+		 * @param acc       The accuracy of the vectorized carve
+		 *                  map evaluation
+		 * @param coh       Whether to carve the wedges of each
+		 *                  chunk in a spatially coherent order
 		 */
-		void init(double res, unsigned int nt, bool interp);
+		void init(double res, unsigned int nt, bool interp,
+		          carve_map_batch_t::ACCURACY acc
+				= carve_map_batch_t::ACCURACY_HIGH,
+		          bool coh = false);
 
 		/**
 		 * Finds and exports all chunks to disk
@@ -86,20 +110,21 @@ class random_carver_t
 		 * Given a wedge file with a list of wedges to process,
 		 * will iterate through all carve wedges, find which ones
 		 * intersects which chunks of the world volume, and export
-		 * corresponding chunk files to the specified location on 
-		 * disk.
+		 * the corresponding chunks to the specified location on 
+		 * disk, packed into a single chunk archive.
 		 *
 		 * The size of the chunks is determined by the resolution
 		 * passed to the init() funciton, which should be called
 		 * before calling this function.
 		 *
 		 * NOTE: the chunk dir should be relative to the
-		 * directory that contains chunklist.
+		 * directory that contains chunklist.  The archive will
+		 * be named <chunk_dir>.chunkarchive
 		 *
 		 * @param cmfile      The carvemap file to parse for input
 		 * @param wedgefile   The wedge file to parse for input
 		 * @param chunklist   File location to export chunklist
-		 * @param chunk_dir   The directory to export chunks
+		 * @param chunk_dir   The name to export chunks to
 		 *
 		 * @return   Returns zero on success, non-zero on failure.
 		 */
@@ -116,6 +141,10 @@ class random_carver_t
 		 * wedges will be carved into the tree, and that chunk
 		 * will be simplified before the next chunk is imported.
 		 *
+		 * Once done, the distribution of the wall-clock times
+		 * to carve each chunk is printed, so that any slow
+		 * chunks that hold up the carving can be seen.
+		 *
 		 * @param cmfile       The input carve map file for carving
 		 * @param wedgefile    The reference wedge file for carving
 		 * @param chunklist    File location to import chunks
@@ -131,13 +160,18 @@ class random_carver_t
 		 *
 		 * Will serialize this object's octree to the specified
 		 * .oct file.  This file will contain the computed
-		 * volumetric information.
+		 * volumetric information.  The blocks of the file are
+		 * encoded with the same number of threads as carving.
+		 * The rate at which the file was written is reported.
 		 *
-		 * @param octfile   The path to the .oct file to export
+		 * @param octfile    The path to the .oct file to export
+		 * @param compress   Whether to compress the blocks of
+		 *                   the file
 		 *
 		 * @return    Returns zero on success, non-zero on failure.
 		 */
-		int serialize(const std::string& octfile) const;
+		int serialize(const std::string& octfile,
+		              bool compress=false) const;
 
 	/* helper functions */
 	public:
@@ -153,14 +187,19 @@ class random_carver_t
 		 * @param carvemaps   The stream of carvemaps to use
 		 * @param wedges      The stream of wedges to use
 		 * @param chunkfile   The chunkfile to parse
+		 * @param archive     The open chunk archive that contains
+		 *                    the chunk, or NULL
 		 * @param tp          The threadpool to use to carve fast
+		 * @param stats       Where to store the timing of this chunk
 		 *
 		 * @return   Returns zero on success, non-zero on failure.
 		 */
 		int carve_chunk(cm_io::reader_t& carvemaps,
 		                wedge::reader_t& wedges,
 		                const std::string& chunkfile,
-		                boost::threadpool::pool& tp);
+		                const chunk::chunk_archive_reader_t* archive,
+		                boost::threadpool::prio_pool& tp,
+		                chunk_stats_t* stats);
 
 		/**
 		 * Will carve the given data into the given octnode
@@ -173,6 +212,16 @@ class random_carver_t
 		 * the only structure that is not likely to be persistant
 		 * between node calls.
 		 *
+		 * Carve maps are read through a cache, since neighboring
+		 * wedges share carve maps.  Each wedge is inserted
+		 * starting from the deepest node that contains the part
+		 * of it within chunknode, which is found by walking up
+		 * and down from the start node of the previous wedge.
+		 * If coherent is true, the wedges are sorted along a
+		 * space-filling curve so that consecutive wedges touch
+		 * the same nodes.  This may change the order in which
+		 * values are summed in the carved data.
+		 *
 		 * @param chunknode   The node to carve into
 		 * @param inds        The scan indices to use
 		 * @param carvemaps   The referenced input carve maps
@@ -181,6 +230,12 @@ class random_carver_t
 		 * @param interp      Whether to interpolate the wedge
 		 *                    geometry.
 		 * @param verbose     If true, will print a progress bar
+		 * @param acc         The accuracy of the vectorized
+		 *                    carve map evaluation
+		 * @param coherent    Whether to sort the wedges along
+		 *                    a space-filling curve
+		 * @param stats       If not NULL, where to count the
+		 *                    carve maps that were read
 		 *
 		 * @return     Returns zero on success, non-zero on failure.
 		 */
@@ -189,7 +244,198 @@ class random_carver_t
 			cm_io::reader_t& carvemaps,
 			wedge::reader_t& wedges,
 			unsigned int maxdepth, 
-			bool interp, bool verbose);
+			bool interp, bool verbose,
+			carve_map_batch_t::ACCURACY acc
+				= carve_map_batch_t::ACCURACY_HIGH,
+			bool coherent = false,
+			chunk_stats_t* stats = NULL);
+
+		/**
+		 * Carves the subtree of a job, splitting it if large
+		 *
+		 * This function is run as a task on the threadpool.  If
+		 * the job references many wedges, its node will be
+		 * split into sub-octants, and each non-empty sub-octant
+		 * will be scheduled as its own task.  Since each
+		 * sub-octant is a disjoint subtree, no locks are needed
+		 * to carve them in parallel.  Sub-octants are given a
+		 * higher priority than whole chunks, so idle threads
+		 * pick up the pieces of a dense chunk before starting
+		 * on new chunks.
+		 *
+		 * Otherwise, the job's node is carved directly with
+		 * carve_node().
+		 *
+		 * The job is freed once it and all its sub-octants have
+		 * been carved.
+		 *
+		 * @param tp         The threadpool to schedule
+		 *                   sub-octants on
+		 * @param job        The job to carve
+		 * @param inds       The scan indices to use
+		 * @param carvemaps  The referenced input carve maps
+		 * @param wedges     The referenced input carve wedges
+		 * @param maxdepth   The relative max depth to carve
+		 * @param interp     Whether to interpolate the wedge
+		 *                   geometry
+		 * @param acc        The accuracy of the vectorized
+		 *                   carve map evaluation
+		 * @param coherent   Whether to sort the wedges along
+		 *                   a space-filling curve
+		 *
+		 * @return     Returns zero on success, non-zero on failure.
+		 */
+		static int carve_subtree(boost::threadpool::prio_pool* tp,
+			carve_job_t* job,
+			std::set<chunk::point_index_t> inds,
+			cm_io::reader_t& carvemaps,
+			wedge::reader_t& wedges,
+			unsigned int maxdepth, bool interp,
+			carve_map_batch_t::ACCURACY acc,
+			bool coherent = false);
+
+		/**
+		 * Sorts the wedges of a node by which child they carve
+		 *
+		 * Will determine which children of the given node
+		 * intersect each referenced wedge, creating those
+		 * children as needed, which is the same as what
+		 * octnode_t::insert() would do at this level.
+		 *
+		 * Only the shape of each wedge is read, which does not
+		 * need the full carve maps.
+		 *
+		 * @param node       The node to split
+		 * @param inds       The scan indices to sort
+		 * @param subinds    Where to store the indices for
+		 *                   each child of node
+		 * @param carvemaps  The referenced input carve maps
+		 * @param wedges     The referenced input carve wedges
+		 * @param interp     Whether to interpolate the wedge
+		 *                   geometry
+		 *
+		 * @return     Returns zero on success, non-zero on failure.
+		 */
+		static int split_node(octnode_t* node,
+			const std::set<chunk::point_index_t>& inds,
+			std::vector<std::set<chunk::point_index_t> >& subinds,
+			cm_io::reader_t& carvemaps,
+			wedge::reader_t& wedges, bool interp);
+};
+
+/**
+ * The chunk_stats_t class records how long a chunk took to carve
+ *
+ * Since large chunks are split into several tasks, the
+ * time of a chunk spans from when its first task starts to when
+ * its last task finishes.
+ */
+class chunk_stats_t
+{
+	/* parameters */
+	public:
+
+		/* the chunk that was carved */
+		std::string chunkfile;
+
+		/* the number of wedges referenced by the chunk */
+		size_t num_wedges;
+
+		/* the number of tasks the chunk was split into */
+		std::atomic<unsigned int> num_tasks;
+
+		/* the number of carve maps used by the tasks of the
+		 * chunk, and how many of them were read from file
+		 * rather than found in a cache */
+		std::atomic<size_t> num_map_gets;
+		std::atomic<size_t> num_map_reads;
+
+		/* the wall-clock time the first task started, and
+		 * the total wall-clock time to carve, in seconds */
+		std::chrono::steady_clock::time_point start;
+		double elapsed;
+
+	/* functions */
+	public:
+
+		/**
+		 * Constructs empty stats
+		 */
+		chunk_stats_t()
+		{
+			this->num_wedges = 0;
+			this->num_tasks  = 0;
+			this->num_map_gets  = 0;
+			this->num_map_reads = 0;
+			this->elapsed    = 0;
+		};
+};
+
+/**
+ * The carve_job_t class represents the carving of one subtree
+ *
+ * Each chunk is carved by a job.  Jobs for large subtrees spawn
+ * a sub-job for each sub-octant, and a job is finished when it
+ * and all its sub-jobs are finished.
+ */
+class carve_job_t
+{
+	/* parameters */
+	public:
+
+		/* the root of the subtree to carve */
+		octnode_t* node;
+
+		/* the job that spawned this one, or NULL for
+		 * the job of a whole chunk */
+		carve_job_t* parent;
+
+		/* the number of splits between this job and its chunk,
+		 * which is used as its scheduling priority */
+		unsigned int level;
+
+		/* the stats of the chunk this job belongs to */
+		chunk_stats_t* stats;
+
+		/* whether this job was split into sub-jobs */
+		bool split;
+
+		/* the number of unfinished sub-jobs, plus one for
+		 * this job itself */
+		std::atomic<unsigned int> remaining;
+
+	/* functions */
+	public:
+
+		/**
+		 * Constructs a job for the given subtree
+		 *
+		 * @param n   The root of the subtree
+		 * @param p   The parent job, or NULL
+		 * @param s   The stats of the chunk
+		 */
+		carve_job_t(octnode_t* n, carve_job_t* p,
+		            chunk_stats_t* s)
+		{
+			this->node      = n;
+			this->parent    = p;
+			this->level     = (p == NULL) ? 0 : (p->level + 1);
+			this->stats     = s;
+			this->split     = false;
+			this->remaining = 1;
+		};
+
+		/**
+		 * Marks one part of this job as finished
+		 *
+		 * Should be called once by this job's own task, and
+		 * once by each sub-job.  When all parts are finished,
+		 * the node of this job is simplified, the parent is
+		 * notified, and this job is freed.
+		 *
+		 * @param job   The job to mark
+		 */
+		static void finish(carve_job_t* job);
 };
 
 #endif
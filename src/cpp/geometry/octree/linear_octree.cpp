@@ -0,0 +1,466 @@
+#include "linear_octree.h"
+#include "octree.h"
+#include "octnode.h"
+#include "octdata.h"
+#include "shape.h"
+#include "octfile.h"
+#include <util/error_codes.h>
+#include <Eigen/Dense>
+#include <algorithm>
+#include <iostream>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+/**
+ * @file   linear_octree.cpp
+ * @author Eric Turner <elturner@eecs.berkeley.edu>
+ * @brief  A compact, read-only octree stored as sorted arrays
+ *
+ * @section DESCRIPTION
+ *
+ * This file implements the linear_octree_t class, which is a read-only
+ * alternative to octree_t for programs that only need to look at
+ * a carved tree.
+ */
+
+using namespace std;
+using namespace Eigen;
+
+/* The digit of a node's code at each level is formed from one bit of
+ * each of its x, y, and z positions, in that order from the least
+ * significant bit.  This maps the child indices of octnode_t (see
+ * relative_child_pos()) to those digits. */
+static const unsigned int CHILD_DIGIT[CHILDREN_PER_NODE] =
+				{ 7, 6, 4, 5, 3, 2, 0, 1 };
+
+/* helper functions */
+
+/**
+ * Spreads the lowest 21 bits of a value to every third bit
+ */
+static inline uint64_t spread_bits(uint64_t v)
+{
+	v &= 0x1fffff;
+	v = (v | (v << 32)) & 0x001f00000000ffffULL;
+	v = (v | (v << 16)) & 0x001f0000ff0000ffULL;
+	v = (v | (v <<  8)) & 0x100f00f00f00f00fULL;
+	v = (v | (v <<  4)) & 0x10c30c30c30c30c3ULL;
+	v = (v | (v <<  2)) & 0x1249249249249249ULL;
+	return v;
+}
+
+/**
+ * Gathers every third bit of a value into the lowest 21 bits
+ */
+static inline uint64_t gather_bits(uint64_t v)
+{
+	v &= 0x1249249249249249ULL;
+	v = (v | (v >>  2)) & 0x10c30c30c30c30c3ULL;
+	v = (v | (v >>  4)) & 0x100f00f00f00f00fULL;
+	v = (v | (v >>  8)) & 0x001f0000ff0000ffULL;
+	v = (v | (v >> 16)) & 0x001f00000000ffffULL;
+	v = (v | (v >> 32)) & 0x1fffff;
+	return v;
+}
+
+/**
+ * Reorders the elements of an array
+ *
+ * @param v      The array to reorder
+ * @param perm   The index in the original array of each new element
+ */
+template<class T> static void permute(vector<T>& v,
+                                      const vector<size_t>& perm)
+{
+	vector<T> sorted(perm.size());
+	size_t i;
+
+	for(i = 0; i < perm.size(); i++)
+		sorted[i] = v[perm[i]];
+	v.swap(sorted);
+}
+
+/* function implementations */
+
+linear_octree_t::linear_octree_t()
+{
+	this->clear();
+}
+
+void linear_octree_t::clear()
+{
+	this->root_center = Vector3d::Zero();
+	this->root_halfwidth = 0;
+	this->max_depth = -1;
+
+	/* free the arrays */
+	vector<uint64_t>().swap(this->codes);
+	vector<uint8_t>().swap(this->depths);
+	vector<unsigned int>().swap(this->count);
+	vector<double>().swap(this->total_weight);
+	vector<double>().swap(this->prob_sum);
+	vector<double>().swap(this->prob_sum_sq);
+	vector<double>().swap(this->surface_sum);
+	vector<double>().swap(this->corner_sum);
+	vector<double>().swap(this->planar_sum);
+	vector<int>().swap(this->fp_room);
+}
+
+int linear_octree_t::init(const octree_t& tree)
+{
+	const octnode_t* root;
+	int ret;
+
+	/* destroy any existing information */
+	this->clear();
+
+	/* check for an empty tree */
+	root = tree.get_root();
+	this->max_depth = tree.get_max_depth();
+	if(root == NULL)
+		return 0;
+	if(this->max_depth > MAX_SUPPORTED_DEPTH)
+	{
+		cerr << "[linear_octree_t::init]\tTree is too deep: "
+		     << this->max_depth << endl;
+		return -1;
+	}
+
+	/* copy the nodes */
+	this->root_center = root->center;
+	this->root_halfwidth = root->halfwidth;
+	ret = this->add_subtree(root, 0, 0, 0, 0);
+	if(ret)
+		return PROPEGATE_ERROR(-2, ret);
+	this->sort();
+
+	/* success */
+	return 0;
+}
+
+int linear_octree_t::parse(const string& fn)
+{
+	octfile::reader_t infile;
+	vector<unsigned char> buf;
+	const char* nodes;
+	uint64_t x, y, z;
+	double w;
+	size_t i, loc, size;
+	int ret;
+
+	/* destroy any existing information */
+	this->clear();
+
+	/* open the file, which reads its directory of blocks */
+	ret = infile.open(fn);
+	if(ret)
+	{
+		cerr << "[linear_octree_t::parse]\tUnable to open file: "
+		     << fn << endl;
+		return PROPEGATE_ERROR(-1, ret);
+	}
+	this->max_depth = infile.get_max_depth();
+	this->root_center = infile.get_root_center();
+	this->root_halfwidth = infile.get_root_halfwidth();
+	if(this->max_depth > MAX_SUPPORTED_DEPTH)
+	{
+		cerr << "[linear_octree_t::parse]\tTree is too deep: "
+		     << this->max_depth << endl;
+		return -2;
+	}
+
+	/* read the nodes of each block */
+	for(i = 0; i < infile.num_blocks(); i++)
+	{
+		const octfile::block_t& b = infile.get_block(i);
+
+		/* find the integer position of the block's root */
+		w = 2*b.halfwidth;
+		x = (uint64_t) floor((b.center(0) - this->root_center(0)
+				+ this->root_halfwidth) / w);
+		y = (uint64_t) floor((b.center(1) - this->root_center(1)
+				+ this->root_halfwidth) / w);
+		z = (uint64_t) floor((b.center(2) - this->root_center(2)
+				+ this->root_halfwidth) / w);
+
+		/* read the subtree, decompressing it if needed */
+		ret = infile.read_block(i, buf, nodes, size);
+		if(ret)
+		{
+			cerr << "[linear_octree_t::parse]\tUnable to read "
+			     << "block #" << i << " of file: " << fn << endl;
+			return PROPEGATE_ERROR(-3, ret);
+		}
+		loc = 0;
+		ret = this->parse_subtree(nodes, size, loc,
+				infile.get_version(), x, y, z, b.depth);
+		if(ret)
+		{
+			cerr << "[linear_octree_t::parse]\tUnable to parse "
+			     << "octree file: " << fn << endl;
+			return PROPEGATE_ERROR(-4, ret);
+		}
+	}
+
+	/* put the nodes in order */
+	this->sort();
+	return 0;
+}
+
+Vector3d linear_octree_t::get_center(size_t i) const
+{
+	Vector3d p;
+	double res, hw;
+
+	/* the code gives the min corner of the node at the max depth */
+	res = this->get_resolution();
+	hw = this->get_halfwidth(i);
+	p << (double) gather_bits(this->codes[i]),
+	     (double) gather_bits(this->codes[i] >> 1),
+	     (double) gather_bits(this->codes[i] >> 2);
+	return (this->root_center
+		+ Vector3d::Constant(hw - this->root_halfwidth) + res*p);
+}
+
+void linear_octree_t::get_data(size_t i, octdata_t& d) const
+{
+	d.count        = this->count[i];
+	d.total_weight = this->total_weight[i];
+	d.prob_sum     = this->prob_sum[i];
+	d.prob_sum_sq  = this->prob_sum_sq[i];
+	d.surface_sum  = this->surface_sum[i];
+	d.corner_sum   = this->corner_sum[i];
+	d.planar_sum   = this->planar_sum[i];
+	d.fp_room      = this->fp_room[i];
+	d.is_carved    = false;
+}
+
+size_t linear_octree_t::num_bytes() const
+{
+	return sizeof(*this)
+		+ this->codes.capacity()*sizeof(uint64_t)
+		+ this->depths.capacity()*sizeof(uint8_t)
+		+ this->count.capacity()*sizeof(unsigned int)
+		+ this->total_weight.capacity()*sizeof(double)
+		+ this->prob_sum.capacity()*sizeof(double)
+		+ this->prob_sum_sq.capacity()*sizeof(double)
+		+ this->surface_sum.capacity()*sizeof(double)
+		+ this->corner_sum.capacity()*sizeof(double)
+		+ this->planar_sum.capacity()*sizeof(double)
+		+ this->fp_room.capacity()*sizeof(int);
+}
+
+void linear_octree_t::find(shape_t& s) const
+{
+	/* the root is not checked for intersection, the same
+	 * as in octree_t::find() */
+	if(this->codes.empty())
+		return;
+	this->find(s, 0, this->codes.size(), 0, 0,
+	           this->root_center, this->root_halfwidth);
+}
+
+/* helper functions */
+
+void linear_octree_t::add(uint64_t x, uint64_t y, uint64_t z,
+                          unsigned int depth, const octdata_t& d)
+{
+	unsigned int shift;
+
+	/* the code is the position of the min corner at max depth */
+	shift = this->max_depth - depth;
+	this->codes.push_back(spread_bits(x << shift)
+			| (spread_bits(y << shift) << 1)
+			| (spread_bits(z << shift) << 2));
+	this->depths.push_back(depth);
+
+	/* copy the data */
+	this->count.push_back(d.count);
+	this->total_weight.push_back(d.total_weight);
+	this->prob_sum.push_back(d.prob_sum);
+	this->prob_sum_sq.push_back(d.prob_sum_sq);
+	this->surface_sum.push_back(d.surface_sum);
+	this->corner_sum.push_back(d.corner_sum);
+	this->planar_sum.push_back(d.planar_sum);
+	this->fp_room.push_back(d.fp_room);
+}
+
+/**
+ * Orders nodes by code, then by depth
+ */
+class node_order_t
+{
+	public:
+		const vector<uint64_t>& codes;
+		const vector<uint8_t>& depths;
+
+		node_order_t(const vector<uint64_t>& c,
+		             const vector<uint8_t>& d)
+			: codes(c), depths(d)
+		{};
+
+		inline bool operator() (size_t a, size_t b) const
+		{
+			if(this->codes[a] != this->codes[b])
+				return (this->codes[a] < this->codes[b]);
+			return (this->depths[a] < this->depths[b]);
+		};
+};
+
+void linear_octree_t::sort()
+{
+	vector<size_t> perm(this->codes.size());
+	size_t i;
+
+	/* find the sorted order of the nodes */
+	for(i = 0; i < perm.size(); i++)
+		perm[i] = i;
+	std::sort(perm.begin(), perm.end(),
+	          node_order_t(this->codes, this->depths));
+
+	/* move each array into that order */
+	permute(this->codes, perm);
+	permute(this->depths, perm);
+	permute(this->count, perm);
+	permute(this->total_weight, perm);
+	permute(this->prob_sum, perm);
+	permute(this->prob_sum_sq, perm);
+	permute(this->surface_sum, perm);
+	permute(this->corner_sum, perm);
+	permute(this->planar_sum, perm);
+	permute(this->fp_room, perm);
+}
+
+int linear_octree_t::add_subtree(const octnode_t* node, uint64_t x,
+                                 uint64_t y, uint64_t z,
+                                 unsigned int depth)
+{
+	unsigned int i, k;
+	int ret;
+
+	/* nodes can't be deeper than the tree */
+	if(depth > (unsigned int) this->max_depth)
+		return -1;
+
+	/* add this node if it has data */
+	if(node->data != NULL)
+		this->add(x, y, z, depth, *(node->data));
+
+	/* add the children */
+	for(i = 0; i < CHILDREN_PER_NODE; i++)
+	{
+		if(node->children[i] == NULL)
+			continue;
+
+		k = CHILD_DIGIT[i];
+		ret = this->add_subtree(node->children[i],
+				2*x + (k & 1), 2*y + ((k >> 1) & 1),
+				2*z + ((k >> 2) & 1), depth+1);
+		if(ret)
+			return PROPEGATE_ERROR(-2, ret);
+	}
+
+	/* success */
+	return 0;
+}
+
+int linear_octree_t::parse_subtree(const char* buf, size_t size,
+                                   size_t& loc, unsigned int v,
+                                   uint64_t x, uint64_t y, uint64_t z,
+                                   unsigned int depth)
+{
+	octdata_t data;
+	unsigned int i, k;
+	int ret;
+
+	/* nodes can't be deeper than the tree */
+	if(depth > (unsigned int) this->max_depth)
+		return -1;
+
+	/* skip the geometry of this node, which is in the same
+	 * format as read by octnode_t::parse() */
+	loc += 4*sizeof(double);
+	if(loc >= size)
+		return -2;
+
+	/* read the data of this node, if any */
+	if(buf[loc++] != 0)
+	{
+		ret = data.parse(buf, size, loc, v);
+		if(ret)
+			return PROPEGATE_ERROR(-3, ret);
+		this->add(x, y, z, depth, data);
+	}
+
+	/* read each child that exists */
+	for(i = 0; i < CHILDREN_PER_NODE; i++)
+	{
+		if(loc >= size)
+			return -4;
+		if(buf[loc++] == 0)
+			continue;
+
+		k = CHILD_DIGIT[i];
+		ret = this->parse_subtree(buf, size, loc, v,
+				2*x + (k & 1), 2*y + ((k >> 1) & 1),
+				2*z + ((k >> 2) & 1), depth+1);
+		if(ret)
+			return PROPEGATE_ERROR(-5, ret);
+	}
+
+	/* success */
+	return 0;
+}
+
+void linear_octree_t::find(shape_t& s, size_t begin, size_t end,
+                           uint64_t code, unsigned int depth,
+                           const Vector3d& c, double hw) const
+{
+	vector<uint64_t>::const_iterator it;
+	size_t bounds[CHILDREN_PER_NODE+1];
+	octdata_t data, *ret;
+	uint64_t span;
+	unsigned int i, k;
+	Vector3d cc;
+	double chw;
+
+	/* if this node has data, it is the first in the range */
+	if(begin < end && this->depths[begin] == depth)
+	{
+		this->get_data(begin, data);
+		ret = s.apply_to_leaf(c, hw, &data);
+		if(ret != &data && ret != NULL)
+			delete ret; /* the tree would own this */
+		begin++;
+	}
+	if(begin >= end || depth >= (unsigned int) this->max_depth)
+		return;
+
+	/* split the range among the children, each of which
+	 * covers a contiguous range of codes */
+	span = ((uint64_t) 1) << (3*(this->max_depth - depth - 1));
+	bounds[0] = begin;
+	for(k = 1; k < CHILDREN_PER_NODE; k++)
+	{
+		it = lower_bound(this->codes.begin() + bounds[k-1],
+		                 this->codes.begin() + end, code + k*span);
+		bounds[k] = it - this->codes.begin();
+	}
+	bounds[CHILDREN_PER_NODE] = end;
+
+	/* recurse on the children in the same order as octnode_t */
+	chw = hw / 2;
+	for(i = 0; i < CHILDREN_PER_NODE; i++)
+	{
+		k = CHILD_DIGIT[i];
+		if(bounds[k] == bounds[k+1])
+			continue; /* no data in this child */
+
+		cc = relative_child_pos(i)*chw + c;
+		if(s.intersects(cc, chw))
+			this->find(s, bounds[k], bounds[k+1],
+			           code + k*span, depth+1, cc, chw);
+	}
+}
@@ -0,0 +1,307 @@
+#ifndef LINEAR_OCTREE_H
+#define LINEAR_OCTREE_H
+
+/**
+ * @file   linear_octree.h
+ * @author Eric Turner <elturner@eecs.berkeley.edu>
+ * @brief  A compact, read-only octree stored as sorted arrays
+ *
+ * @section DESCRIPTION
+ *
+ * This file defines the linear_octree_t class, which is a read-only
+ * alternative to octree_t for programs that only need to look at
+ * a carved tree.
+ *
+ * Rather than allocating each node with pointers to its children,
+ * and storing the center and halfwidth of every node, this class
+ * only stores the nodes that have data.  Each one is identified by
+ * the Morton code of its minimum corner at the tree's max depth,
+ * along with its depth.  The geometry of each node is computed from
+ * these values and the root of the tree.  The nodes are sorted by
+ * code, so that a subtree is always a contiguous range of nodes.
+ *
+ * The data of the nodes are stored as one array per field of
+ * octdata_t, so that a pass over all nodes that looks at only one
+ * field (such as the probability) reads memory sequentially.
+ */
+
+#include "octree.h"
+#include "octnode.h"
+#include "octdata.h"
+#include "shape.h"
+#include <Eigen/Dense>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+/**
+ * The linear_octree_t class stores a read-only octree in flat arrays
+ */
+class linear_octree_t
+{
+	/* parameters */
+	public:
+
+		/* the deepest tree that can be represented, so that
+		 * the Morton code of a node fits in 64 bits */
+		static const int MAX_SUPPORTED_DEPTH = 21;
+
+	/* parameters */
+	private:
+
+		/* the geometry of the root node */
+		Eigen::Vector3d root_center;
+		double root_halfwidth;
+		int max_depth;
+
+		/* the location of each node, sorted by code.  If a
+		 * node with data has descendants with data, then it
+		 * shares its code with the first of them, and comes
+		 * first since it has the smaller depth. */
+		std::vector<uint64_t> codes;
+		std::vector<uint8_t> depths;
+
+		/* the fields of each node's data, as in octdata_t */
+		std::vector<unsigned int> count;
+		std::vector<double> total_weight;
+		std::vector<double> prob_sum;
+		std::vector<double> prob_sum_sq;
+		std::vector<double> surface_sum;
+		std::vector<double> corner_sum;
+		std::vector<double> planar_sum;
+		std::vector<int> fp_room;
+
+	/* functions */
+	public:
+
+		/*--------------*/
+		/* constructors */
+		/*--------------*/
+
+		/**
+		 * Constructs an empty tree
+		 */
+		linear_octree_t();
+
+		/**
+		 * Frees all memory and resources
+		 */
+		void clear();
+
+		/**
+		 * Builds this tree from the given octree
+		 *
+		 * Any existing information in this tree is destroyed.
+		 *
+		 * @param tree   The octree to copy
+		 *
+		 * @return    Returns zero on success, non-zero on failure.
+		 */
+		int init(const octree_t& tree);
+
+		/**
+		 * Builds this tree by reading an octfile
+		 *
+		 * The file is read directly into this structure, without
+		 * constructing an octree_t in memory.  Files of any
+		 * version of the octfile format can be read.  Any existing
+		 * information in this tree is destroyed.
+		 *
+		 * @param fn   The path to the .oct file to read
+		 *
+		 * @return     Returns zero on success, non-zero on failure.
+		 */
+		int parse(const std::string& fn);
+
+		/*-----------*/
+		/* accessors */
+		/*-----------*/
+
+		/**
+		 * Retrieves the number of nodes with data in this tree
+		 */
+		inline size_t size() const
+		{ return this->codes.size(); };
+
+		/**
+		 * Retrieves the max depth of this tree
+		 */
+		inline int get_max_depth() const
+		{ return this->max_depth; };
+
+		/**
+		 * Retrieves the center of the root of this tree
+		 */
+		inline const Eigen::Vector3d& get_root_center() const
+		{ return this->root_center; };
+
+		/**
+		 * Retrieves the halfwidth of the root of this tree
+		 */
+		inline double get_root_halfwidth() const
+		{ return this->root_halfwidth; };
+
+		/**
+		 * Retrieves the resolution of the tree, in units of length
+		 */
+		inline double get_resolution() const
+		{
+			return (2.0 * this->root_halfwidth)
+				/ (((uint64_t) 1) << this->max_depth);
+		};
+
+		/**
+		 * Retrieves the depth of the i'th node
+		 */
+		inline int get_depth(size_t i) const
+		{ return this->depths[i]; };
+
+		/**
+		 * Retrieves the halfwidth of the i'th node
+		 */
+		inline double get_halfwidth(size_t i) const
+		{
+			return this->root_halfwidth
+				/ (((uint64_t) 1) << this->depths[i]);
+		};
+
+		/**
+		 * Retrieves the center position of the i'th node
+		 *
+		 * @param i   The index of the node
+		 *
+		 * @return    Returns the center of the node
+		 */
+		Eigen::Vector3d get_center(size_t i) const;
+
+		/**
+		 * Copies the data of the i'th node into an octdata_t
+		 *
+		 * @param i   The index of the node
+		 * @param d   Where to store the node's data
+		 */
+		void get_data(size_t i, octdata_t& d) const;
+
+		/**
+		 * Retrieves the probability of the i'th node
+		 *
+		 * This is the same value as octdata_t::get_probability()
+		 */
+		inline double get_probability(size_t i) const
+		{
+			if(this->count[i] > 0 && this->total_weight[i] > 0)
+				return (this->prob_sum[i]
+						/ this->total_weight[i]);
+			return octdata_t::UNOBSERVED_PROBABILITY;
+		};
+
+		/**
+		 * Returns true iff the i'th node is interior
+		 *
+		 * This is the same value as octdata_t::is_interior()
+		 */
+		inline bool is_interior(size_t i) const
+		{
+			return (this->get_probability(i)
+				> octdata_t::UNOBSERVED_PROBABILITY);
+		};
+
+		/**
+		 * Retrieves the floor plan room of the i'th node
+		 */
+		inline int get_fp_room(size_t i) const
+		{ return this->fp_room[i]; };
+
+		/**
+		 * Retrieves the number of bytes used by this tree
+		 */
+		size_t num_bytes() const;
+
+		/*----------*/
+		/* geometry */
+		/*----------*/
+
+		/**
+		 * Will find all nodes with data that overlap this shape
+		 *
+		 * This function visits the nodes in the same order, and
+		 * calls the same functions of the shape, as
+		 * octree_t::find().  For each node found, the
+		 * apply_to_leaf() function of the shape is given a
+		 * temporary copy of the node's data.  Since this tree
+		 * is read-only, any changes the shape makes to those
+		 * data are discarded.
+		 *
+		 * @param s   The shape to test
+		 */
+		void find(shape_t& s) const;
+
+	/* helper functions */
+	private:
+
+		/**
+		 * Adds a node with data to the end of the arrays
+		 *
+		 * The nodes must be sorted with sort() after all
+		 * nodes are added.
+		 *
+		 * @param x,y,z   The integer position of the node at
+		 *                its own depth
+		 * @param depth   The depth of the node
+		 * @param d       The data of the node
+		 */
+		void add(uint64_t x, uint64_t y, uint64_t z,
+		         unsigned int depth, const octdata_t& d);
+
+		/**
+		 * Sorts the nodes by code, then by depth
+		 */
+		void sort();
+
+		/**
+		 * Recursively adds the nodes of an octree
+		 *
+		 * @param node    The node to add, along with its subnodes
+		 * @param x,y,z   The integer position of the node
+		 * @param depth   The depth of the node
+		 *
+		 * @return   Returns zero on success, non-zero on failure.
+		 */
+		int add_subtree(const octnode_t* node, uint64_t x,
+		                uint64_t y, uint64_t z, unsigned int depth);
+
+		/**
+		 * Recursively parses the nodes of an octfile
+		 *
+		 * @param buf     The contents of the file
+		 * @param size    The end of the block being read
+		 * @param loc     The location of the node in the file,
+		 *                which is moved past its subtree
+		 * @param v       The version of the file
+		 * @param x,y,z   The integer position of the node
+		 * @param depth   The depth of the node
+		 *
+		 * @return   Returns zero on success, non-zero on failure.
+		 */
+		int parse_subtree(const char* buf, size_t size,
+		                  size_t& loc, unsigned int v,
+		                  uint64_t x, uint64_t y, uint64_t z,
+		                  unsigned int depth);
+
+		/**
+		 * Recursively finds the nodes that overlap a shape
+		 *
+		 * @param s       The shape to test
+		 * @param begin   The first node in this subtree
+		 * @param end     One past the last node in this subtree
+		 * @param code    The code of this subtree's min corner
+		 * @param depth   The depth of this subtree's root
+		 * @param c       The center of this subtree's root
+		 * @param hw      The halfwidth of this subtree's root
+		 */
+		void find(shape_t& s, size_t begin, size_t end,
+		          uint64_t code, unsigned int depth,
+		          const Eigen::Vector3d& c, double hw) const;
+};
+
+#endif
@@ -2,6 +2,7 @@
 #include <algorithm>
 #include <cmath>
 #include <stdlib.h>
+#include <string.h>
 
 /**
  * @file octdata.cpp
@@ -187,6 +188,46 @@ int octdata_t::parse(istream& is, unsigned int v)
 		return -1; /* failure */
 	return 0; /* success */
 }
+
+int octdata_t::parse(const char* buf, size_t size, size_t& loc,
+                     unsigned int v)
+{
+	size_t n;
+
+	/* check that all fields are in the buffer.  The outdated
+	 * version of the format has no 'total_weight' field */
+	n = sizeof(this->count) + 5*sizeof(double) + sizeof(this->fp_room);
+	if(v > 1)
+		n += sizeof(this->total_weight);
+	if(loc + n > size)
+		return -1; /* failure */
+
+	/* read data from buffer in little-endian
+	 * binary notation */
+	memcpy(&(this->count), buf + loc, sizeof(this->count));
+	loc += sizeof(this->count);
+	if(v > 1)
+	{
+		memcpy(&(this->total_weight), buf + loc,
+				sizeof(this->total_weight));
+		loc += sizeof(this->total_weight);
+	}
+	else
+		this->total_weight = (double) this->count;
+	memcpy(&(this->prob_sum), buf + loc, sizeof(this->prob_sum));
+	loc += sizeof(this->prob_sum);
+	memcpy(&(this->prob_sum_sq), buf + loc, sizeof(this->prob_sum_sq));
+	loc += sizeof(this->prob_sum_sq);
+	memcpy(&(this->surface_sum), buf + loc, sizeof(this->surface_sum));
+	loc += sizeof(this->surface_sum);
+	memcpy(&(this->corner_sum), buf + loc, sizeof(this->corner_sum));
+	loc += sizeof(this->corner_sum);
+	memcpy(&(this->planar_sum), buf + loc, sizeof(this->planar_sum));
+	loc += sizeof(this->planar_sum);
+	memcpy(&(this->fp_room), buf + loc, sizeof(this->fp_room));
+	loc += sizeof(this->fp_room);
+	return 0; /* success */
+}
 		
 void octdata_t::add_sample(double w, double prob, double surf, 
                            double corner, double planar)
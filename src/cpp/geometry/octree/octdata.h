@@ -12,6 +12,7 @@
  * these to the tree.
  */
 
+#include <util/slab_allocator.h>
 #include <iostream>
 
 /* this class represents the data that are stored in the nodes of
@@ -48,6 +49,9 @@ class octdata_t
 		 * previous techniques. */
 		bool is_carved;
 
+	/* the linear octree stores these fields as arrays */
+	friend class linear_octree_t;
+
 	/* public parameters */
 	public:
 
@@ -68,6 +72,13 @@ class octdata_t
 		/* constructors */
 		/*--------------*/
 
+		/* every leaf of a tree has a data object, so these
+		 * are allocated from slabs rather than one at a time */
+		static void* operator new(size_t n)
+		{ return slab_allocator_t<octdata_t>::allocate(n); };
+		static void operator delete(void* p, size_t n)
+		{ slab_allocator_t<octdata_t>::deallocate(p, n); };
+
 		/**
 		 * Initializes empty octdata object
 		 */
@@ -179,6 +190,23 @@ class octdata_t
 		 */
 		int parse(std::istream& is, unsigned int v);
 
+		/**
+		 * Parses these data from a buffer in memory
+		 *
+		 * Reads the same format as parse(is, v), starting at
+		 * the given location in the buffer.  After this call,
+		 * the location will be just past the parsed data.
+		 *
+		 * @param buf   The buffer to read from
+		 * @param size  The size of the buffer, in bytes
+		 * @param loc   The location in the buffer to read
+		 * @param v     The version number of the file to parse
+		 *
+		 * @return    Returns zero on success, non-zero on failure.
+		 */
+		int parse(const char* buf, size_t size, size_t& loc,
+		          unsigned int v);
+
 		/*
 		 *########################################################
 		 * The remaining functions will not be called by octree_t
@@ -0,0 +1,402 @@
+#include "octfile.h"
+#include <util/error_codes.h>
+#include <lodepng/lodepng.h>
+#include <Eigen/Dense>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <string.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+/**
+ * @file   octfile.cpp
+ * @author Eric Turner <elturner@eecs.berkeley.edu>
+ * @brief  Reads the header and block directory of .oct files
+ *
+ * @section DESCRIPTION
+ *
+ * This file contains the classes used to read the layout of .oct files,
+ * which store serialized octrees.
+ */
+
+using namespace std;
+using namespace Eigen;
+using namespace octfile;
+
+/*--------*/
+/* codecs */
+/*--------*/
+
+int octfile::compress(const char* in, size_t n, string& out)
+{
+	LodePNGCompressSettings settings;
+	vector<unsigned char> buf;
+	unsigned int ret;
+
+	/* the serialized nodes are mostly repeated short patterns, so
+	 * a small window without lazy matching loses little of the
+	 * ratio while running much faster than the defaults.  Most of
+	 * the remaining time is spent building a dynamic huffman tree
+	 * for each deflate block, so the fixed tree is used instead,
+	 * which is about three times faster for a similar size */
+	lodepng_compress_settings_init(&settings);
+	settings.btype        = 1;
+	settings.windowsize   = 2048;
+	settings.nicematch    = 128;
+	settings.lazymatching = 0;
+
+	/* compress the buffer */
+	ret = lodepng::compress(buf, (const unsigned char*) in, n,
+	                        settings);
+	if(ret)
+	{
+		cerr << "[octfile::compress]\tError " << ret << ": "
+		     << lodepng_error_text(ret) << endl;
+		return -1;
+	}
+	out.assign(buf.begin(), buf.end());
+	return 0;
+}
+
+int octfile::decompress(const char* in, size_t n, size_t raw_size,
+                        vector<unsigned char>& out)
+{
+	unsigned int ret;
+
+	/* decompress the buffer */
+	out.clear();
+	out.reserve(raw_size);
+	ret = lodepng::decompress(out, (const unsigned char*) in, n);
+	if(ret)
+	{
+		cerr << "[octfile::decompress]\tError " << ret << ": "
+		     << lodepng_error_text(ret) << endl;
+		return -1;
+	}
+
+	/* check that the whole block was recovered */
+	if(out.size() != raw_size)
+		return -2;
+	return 0;
+}
+
+/*---------------*/
+/* block_t class */
+/*---------------*/
+
+bool block_t::intersects(const Vector3d& bmin, const Vector3d& bmax) const
+{
+	unsigned int i;
+
+	/* check for separation along each axis */
+	for(i = 0; i < 3; i++)
+		if(this->center(i) + this->halfwidth < bmin(i)
+				|| this->center(i) - this->halfwidth > bmax(i))
+			return false;
+	return true;
+}
+
+void block_t::serialize(ostream& os) const
+{
+	double d;
+
+	/* write the entry in little-endian binary notation */
+	d = this->center(0); os.write((char*) &d, sizeof(d));
+	d = this->center(1); os.write((char*) &d, sizeof(d));
+	d = this->center(2); os.write((char*) &d, sizeof(d));
+	os.write((char*) &(this->halfwidth), sizeof(this->halfwidth));
+	os.write((char*) &(this->depth),     sizeof(this->depth));
+	os.write((char*) &(this->offset),    sizeof(this->offset));
+	os.write((char*) &(this->size),      sizeof(this->size));
+	os.write((char*) &(this->raw_size),  sizeof(this->raw_size));
+}
+
+int block_t::parse(const char* data, size_t size, size_t loc,
+                   unsigned int v)
+{
+	double d[4];
+
+	/* check that the entry is within the file */
+	if(loc + ((v < OCTFILE_CODEC_VERSION) ? ENTRY_SIZE
+				: CODEC_ENTRY_SIZE) > size)
+		return -1;
+
+	/* read the entry */
+	memcpy(d, data + loc, sizeof(d));
+	loc += sizeof(d);
+	this->center << d[0], d[1], d[2];
+	this->halfwidth = d[3];
+	memcpy(&(this->depth), data + loc, sizeof(this->depth));
+	loc += sizeof(this->depth);
+	memcpy(&(this->offset), data + loc, sizeof(this->offset));
+	loc += sizeof(this->offset);
+	memcpy(&(this->size), data + loc, sizeof(this->size));
+	loc += sizeof(this->size);
+	if(v < OCTFILE_CODEC_VERSION)
+		this->raw_size = this->size; /* older blocks not compressed */
+	else
+		memcpy(&(this->raw_size), data + loc,
+		       sizeof(this->raw_size));
+
+	/* the block must also be within the file */
+	if(this->offset > size || this->size > size - this->offset)
+		return -2;
+	return 0;
+}
+
+/*----------------*/
+/* reader_t class */
+/*----------------*/
+
+reader_t::reader_t()
+{
+	/* initialize values */
+	this->fd = -1;
+	this->data = NULL;
+	this->data_size = 0;
+	this->close();
+}
+
+reader_t::~reader_t()
+{
+	/* free all memory and resources */
+	this->close();
+}
+
+int reader_t::open(const std::string& fn)
+{
+	struct stat st;
+	void* addr;
+	double d[4];
+	unsigned int i, n;
+	size_t loc, entry_size;
+	int ret;
+
+	/* close any open files */
+	this->close();
+
+	/* attempt to open this file */
+	this->fd = ::open(fn.c_str(), O_RDONLY);
+	if(this->fd < 0 || fstat(this->fd, &st) != 0)
+	{
+		cerr << "[octfile::reader_t::open]\tUnable to open file: "
+		     << fn << endl;
+		this->close();
+		return -1;
+	}
+
+	/* map the whole file into memory.  Pages are loaded on
+	 * demand, so only the parsed blocks are read from disk */
+	this->data_size = st.st_size;
+	if(this->data_size < OLD_HEADER_SIZE)
+	{
+		cerr << "[octfile::reader_t::open]\tNot an octree file: "
+		     << fn << endl;
+		this->close();
+		return -2;
+	}
+	addr = mmap(NULL, this->data_size, PROT_READ, MAP_SHARED,
+	            this->fd, 0);
+	if(addr == MAP_FAILED)
+	{
+		cerr << "[octfile::reader_t::open]\tUnable to map file "
+		     << "into memory: " << fn << endl;
+		this->data_size = 0;
+		this->close();
+		return -3;
+	}
+	this->data = (const char*) addr;
+
+	/* check the magic number */
+	if(!strncmp(this->data, OCTFILE_OLD_MAGIC_NUMBER,
+				OCTFILE_MAGIC_LENGTH))
+	{
+		/* the oldest version has no version number */
+		cerr << "[octfile::reader_t::open]\tNote: this file is "
+		     << "using outdated version of octree file "
+		     << "format. Attempting to parse..." << endl;
+		this->version = 1;
+		loc = OCTFILE_MAGIC_LENGTH;
+	}
+	else if(!strncmp(this->data, OCTFILE_MAGIC_NUMBER,
+				OCTFILE_MAGIC_LENGTH)
+			&& this->data_size >= HEADER_SIZE)
+	{
+		memcpy(&(this->version), this->data + OCTFILE_MAGIC_LENGTH,
+		       sizeof(this->version));
+		loc = OCTFILE_MAGIC_LENGTH + sizeof(this->version);
+	}
+	else
+	{
+		cerr << "[octfile::reader_t::open]\tNot an octree file: "
+		     << fn << endl;
+		this->close();
+		return -4;
+	}
+
+	/* check version info */
+	if(this->version > OCTFILE_CURRENT_VERSION)
+	{
+		cerr << "[octfile::reader_t::open]\tInput file has "
+		     << "version #" << this->version << ", while this "
+		     << "parser expects version #"
+		     << OCTFILE_CURRENT_VERSION << endl
+		     << "\tfile: " << fn << endl << endl
+		     << "\tPLEASE UPDATE TO LATEST VERSION OF CODE" << endl;
+		this->close();
+		return -5;
+	}
+
+	/* the rest of the header is common to all versions */
+	memcpy(&(this->max_depth), this->data + loc,
+	       sizeof(this->max_depth));
+	loc += sizeof(this->max_depth);
+	memcpy(&(this->num_nodes), this->data + loc,
+	       sizeof(this->num_nodes));
+	loc += sizeof(this->num_nodes);
+
+	/* older files store the whole tree as one block, whose
+	 * geometry is at the start of the root node */
+	if(this->version < OCTFILE_BLOCK_VERSION)
+	{
+		if(loc + sizeof(d) > this->data_size)
+		{
+			cerr << "[octfile::reader_t::open]\tFile is "
+			     << "truncated: " << fn << endl;
+			this->close();
+			return -6;
+		}
+		memcpy(d, this->data + loc, sizeof(d));
+		this->root_center << d[0], d[1], d[2];
+		this->root_halfwidth = d[3];
+		this->blocks.resize(1);
+		this->blocks[0].center    = this->root_center;
+		this->blocks[0].halfwidth = this->root_halfwidth;
+		this->blocks[0].depth     = 0;
+		this->blocks[0].offset    = loc;
+		this->blocks[0].size      = this->data_size - loc;
+		this->blocks[0].raw_size  = this->blocks[0].size;
+		return 0;
+	}
+
+	/* newer files store the root geometry and the directory */
+	if(this->data_size < ((this->version < OCTFILE_CODEC_VERSION)
+				? BLOCK_HEADER_SIZE : CODEC_HEADER_SIZE))
+	{
+		cerr << "[octfile::reader_t::open]\tFile is truncated: "
+		     << fn << endl;
+		this->close();
+		return -7;
+	}
+	memcpy(d, this->data + loc, sizeof(d));
+	loc += sizeof(d);
+	this->root_center << d[0], d[1], d[2];
+	this->root_halfwidth = d[3];
+	memcpy(&n, this->data + loc, sizeof(n));
+	loc += sizeof(n);
+	entry_size = block_t::ENTRY_SIZE;
+	if(this->version >= OCTFILE_CODEC_VERSION)
+	{
+		/* the codec of the blocks follows the block count */
+		memcpy(&(this->codec), this->data + loc,
+		       sizeof(this->codec));
+		loc += sizeof(this->codec);
+		entry_size = block_t::CODEC_ENTRY_SIZE;
+		if(this->codec != CODEC_NONE && this->codec != CODEC_ZLIB)
+		{
+			cerr << "[octfile::reader_t::open]\tUnknown codec #"
+			     << this->codec << " in file: " << fn << endl;
+			this->close();
+			return -8;
+		}
+	}
+
+	/* read the directory */
+	if(n > (this->data_size - loc) / entry_size)
+	{
+		cerr << "[octfile::reader_t::open]\tFile is truncated: "
+		     << fn << endl;
+		this->close();
+		return -9;
+	}
+	this->blocks.resize(n);
+	for(i = 0; i < n; i++)
+	{
+		ret = this->blocks[i].parse(this->data, this->data_size,
+		                            loc, this->version);
+		if(ret)
+		{
+			ret = PROPEGATE_ERROR(-10, ret);
+			cerr << "[octfile::reader_t::open]\tError " << ret
+			     << ": Bad directory entry #" << i
+			     << " in file: " << fn << endl;
+			this->close();
+			return ret;
+		}
+		loc += entry_size;
+	}
+
+	/* success */
+	return 0;
+}
+
+void reader_t::close()
+{
+	/* check if file is mapped */
+	if(this->data != NULL)
+	{
+		munmap((void*) this->data, this->data_size);
+		this->data = NULL;
+	}
+	this->data_size = 0;
+
+	/* check if file is open */
+	if(this->fd >= 0)
+	{
+		::close(this->fd);
+		this->fd = -1;
+	}
+
+	/* reset the header */
+	this->version = 0;
+	this->codec = CODEC_NONE;
+	this->max_depth = -1;
+	this->num_nodes = 0;
+	this->root_center = Vector3d::Zero();
+	this->root_halfwidth = 0;
+	this->blocks.clear();
+}
+
+int reader_t::read_block(size_t i, vector<unsigned char>& buf,
+                         const char*& nodes, size_t& size) const
+{
+	const block_t& b = this->blocks[i];
+	int ret;
+
+	/* uncompressed blocks are read from the mapping, which
+	 * includes the blocks of a compressed file that were
+	 * stored as-is because they did not shrink */
+	if(this->codec == CODEC_NONE || b.size == b.raw_size)
+	{
+		nodes = this->data + b.offset;
+		size = b.size;
+		return 0;
+	}
+
+	/* otherwise, decompress the block */
+	ret = decompress(this->data + b.offset, b.size, b.raw_size, buf);
+	if(ret)
+	{
+		cerr << "[octfile::reader_t::read_block]\tUnable to "
+		     << "decompress block #" << i << endl;
+		return PROPEGATE_ERROR(-1, ret);
+	}
+	nodes = (const char*) buf.data();
+	size = buf.size();
+	return 0;
+}
@@ -0,0 +1,316 @@
+#ifndef OCTFILE_H
+#define OCTFILE_H
+
+/**
+ * @file   octfile.h
+ * @author Eric Turner <elturner@eecs.berkeley.edu>
+ * @brief  Reads the header and block directory of .oct files
+ *
+ * @section DESCRIPTION
+ *
+ * This file contains the classes used to read the layout of .oct files,
+ * which store serialized octrees.
+ *
+ * Starting with version 3, an octfile stores its tree as a set of
+ * blocks.  Each block is a subtree, serialized in the same prefix
+ * depth-first order as the whole tree was in earlier versions, and
+ * the header contains a directory with the geometry and file offset of
+ * every block.  This allows a program to load only the parts of a
+ * tree that intersect a region of interest.
+ *
+ * Starting with version 4, each block may also be compressed, so that
+ * blocks can be encoded and decoded independently by separate threads.
+ * The codec used is stored in the header, and the directory stores
+ * the uncompressed size of every block.
+ *
+ * Files of earlier versions are presented by the reader as having a
+ * single block that contains the whole tree.
+ *
+ * The file format is described in:
+ *
+ * 	docs/filetypes/octree_serialization_file.txt
+ */
+
+#include <Eigen/Dense>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+/* the following defines are used for reading and writing files */
+#define OCTFILE_MAGIC_NUMBER      "octtree"
+#define OCTFILE_OLD_MAGIC_NUMBER  "octfile"
+#define OCTFILE_MAGIC_LENGTH      8
+#define OCTFILE_CURRENT_VERSION   4
+
+/* the first version of the format that is split into blocks */
+#define OCTFILE_BLOCK_VERSION     3
+
+/* the first version of the format whose blocks can be compressed */
+#define OCTFILE_CODEC_VERSION     4
+
+/* the depth of the blocks written to new files.  Each block holds a
+ * subtree whose root is at this depth, unless a leaf is found above
+ * this depth. */
+#define OCTFILE_BLOCK_DEPTH       5
+
+/* all octfile classes are in this namespace */
+namespace octfile
+{
+	/* the size of the header of each version, in bytes */
+	static const size_t OLD_HEADER_SIZE = 16; /* version 1 */
+	static const size_t HEADER_SIZE     = 20; /* version 2 */
+	static const size_t BLOCK_HEADER_SIZE = 56; /* version 3 */
+	static const size_t CODEC_HEADER_SIZE = 60; /* version 4+ */
+
+	/* the codecs that blocks can be stored with */
+	enum CODEC
+	{
+		CODEC_NONE = 0, /* blocks are stored as-is */
+		CODEC_ZLIB = 1  /* blocks are zlib streams */
+	};
+
+	/**
+	 * Compresses a buffer with the zlib codec
+	 *
+	 * This uses the deflate implementation of lodepng, which is
+	 * not a fast codec.  Even with the faster settings used here,
+	 * it encodes at around 30 MB/s per thread, several times
+	 * slower than writing the blocks uncompressed, so compression
+	 * is meant for archiving files rather than for every run.
+	 *
+	 * @param in    The buffer to compress
+	 * @param n     The number of bytes in the buffer
+	 * @param out   Where to store the compressed bytes
+	 *
+	 * @return    Returns zero on success, non-zero on failure.
+	 */
+	int compress(const char* in, size_t n, std::string& out);
+
+	/**
+	 * Decompresses a buffer written by compress()
+	 *
+	 * @param in        The compressed buffer
+	 * @param n         The number of bytes in the buffer
+	 * @param raw_size  The expected size after decompression
+	 * @param out       Where to store the decompressed bytes
+	 *
+	 * @return    Returns zero on success, non-zero on failure.
+	 */
+	int decompress(const char* in, size_t n, size_t raw_size,
+	               std::vector<unsigned char>& out);
+
+	/**
+	 * The block_t class describes one subtree stored in the file
+	 */
+	class block_t
+	{
+		/* parameters */
+		public:
+
+			/* the geometry of the root of this block */
+			Eigen::Vector3d center;
+			double halfwidth;
+
+			/* the depth of the root of this block in the
+			 * whole tree */
+			unsigned int depth;
+
+			/* the location of this block in the file,
+			 * in bytes from the start of the file */
+			uint64_t offset;
+			uint64_t size;
+
+			/* the size of this block once decompressed,
+			 * which is the same as size if the file is
+			 * not compressed, or if this block was stored
+			 * as-is because compressing it did not make it
+			 * any smaller */
+			uint64_t raw_size;
+
+			/* the size of a directory entry, in bytes */
+			static const size_t ENTRY_SIZE       = 52; /* v3 */
+			static const size_t CODEC_ENTRY_SIZE = 60; /* v4+ */
+
+		/* functions */
+		public:
+
+			/**
+			 * Checks if this block intersects a bounding box
+			 *
+			 * @param bmin   The minimum corner of the box
+			 * @param bmax   The maximum corner of the box
+			 *
+			 * @return    Returns true iff they intersect.
+			 */
+			bool intersects(const Eigen::Vector3d& bmin,
+			                const Eigen::Vector3d& bmax) const;
+
+			/**
+			 * Writes this block's directory entry to a stream
+			 *
+			 * The entry is written in the current version
+			 * of the format.
+			 *
+			 * @param os   The binary stream to write to
+			 */
+			void serialize(std::ostream& os) const;
+
+			/**
+			 * Parses this block's directory entry from memory
+			 *
+			 * @param data   The contents of the file
+			 * @param size   The size of the file, in bytes
+			 * @param loc    The location of the entry
+			 * @param v      The version of the file
+			 *
+			 * @return    Returns zero on success, non-zero
+			 *            on failure.
+			 */
+			int parse(const char* data, size_t size, size_t loc,
+			          unsigned int v);
+	};
+
+	/**
+	 * The reader_t class maps an octfile into memory
+	 *
+	 * The whole file is mapped read-only, and pages are loaded
+	 * on demand, so only the blocks that are parsed are read
+	 * from disk.
+	 */
+	class reader_t
+	{
+		/* parameters */
+		private:
+
+			/* the mapping of the file */
+			int fd;
+			const char* data;
+			size_t data_size;
+
+			/* header information */
+			unsigned int version;
+			unsigned int codec;
+			int max_depth;
+			unsigned int num_nodes;
+
+			/* the geometry of the root of the tree */
+			Eigen::Vector3d root_center;
+			double root_halfwidth;
+
+			/* the directory of blocks in this file */
+			std::vector<block_t> blocks;
+
+		/* functions */
+		public:
+
+			/**
+			 * Constructs an empty reader
+			 */
+			reader_t();
+
+			/**
+			 * Frees all memory and resources
+			 */
+			~reader_t();
+
+			/**
+			 * Opens an octfile and parses its directory
+			 *
+			 * @param fn   The path to the file to open
+			 *
+			 * @return     Returns zero on success, non-zero
+			 *             on failure.
+			 */
+			int open(const std::string& fn);
+
+			/**
+			 * Closes the file, if it is open
+			 */
+			void close();
+
+			/**
+			 * Retrieves the serialized nodes of a block
+			 *
+			 * If the block is compressed, it is decompressed
+			 * into the given buffer.  Otherwise, including for
+			 * blocks of a compressed file that are stored
+			 * as-is, the nodes
+			 * are read directly from the mapped file.  This
+			 * function can be called by multiple threads at
+			 * once, as long as each uses its own buffer.
+			 *
+			 * @param i      The index of the block to read
+			 * @param buf    A buffer to use for decompression
+			 * @param nodes  Where to store a pointer to the
+			 *               serialized nodes of the block
+			 * @param size   Where to store the number of bytes
+			 *               of the serialized nodes
+			 *
+			 * @return   Returns zero on success, non-zero
+			 *           on failure.
+			 */
+			int read_block(size_t i, std::vector<unsigned char>& buf,
+			               const char*& nodes, size_t& size) const;
+
+			/*-----------*/
+			/* accessors */
+			/*-----------*/
+
+			/**
+			 * Retrieves the contents of the file
+			 */
+			inline const char* get_data() const
+			{ return this->data; };
+
+			/**
+			 * Retrieves the version of the file
+			 */
+			inline unsigned int get_version() const
+			{ return this->version; };
+
+			/**
+			 * Retrieves the codec used for the blocks
+			 */
+			inline unsigned int get_codec() const
+			{ return this->codec; };
+
+			/**
+			 * Retrieves the max depth of the stored tree
+			 */
+			inline int get_max_depth() const
+			{ return this->max_depth; };
+
+			/**
+			 * Retrieves the number of nodes in the stored tree
+			 */
+			inline unsigned int get_num_nodes() const
+			{ return this->num_nodes; };
+
+			/**
+			 * Retrieves the center of the root of the tree
+			 */
+			inline const Eigen::Vector3d& get_root_center() const
+			{ return this->root_center; };
+
+			/**
+			 * Retrieves the halfwidth of the root of the tree
+			 */
+			inline double get_root_halfwidth() const
+			{ return this->root_halfwidth; };
+
+			/**
+			 * Retrieves the number of blocks in the file
+			 */
+			inline size_t num_blocks() const
+			{ return this->blocks.size(); };
+
+			/**
+			 * Retrieves the i'th block of the file
+			 */
+			inline const block_t& get_block(size_t i) const
+			{ return this->blocks[i]; };
+	};
+}
+
+#endif
@@ -3,6 +3,7 @@
 #include "octdata.h"
 #include <Eigen/Dense>
 #include <iostream>
+#include <string.h>
 #include <set>
 
 /**
@@ -321,8 +322,11 @@ void octnode_t::find(shape_t& s)
 
 void octnode_t::insert(shape_t& s, int d)
 {
-	Vector3d child_center;
-	unsigned int i;
+	Vector3d centers[CHILDREN_PER_NODE];
+	octnode_t* leaves[CHILDREN_PER_NODE];
+	octdata_t* datas[CHILDREN_PER_NODE];
+	bool hits[CHILDREN_PER_NODE];
+	unsigned int i, n;
 	double chw;
 
 	/* check if we reached final depth, or if this node
@@ -336,34 +340,51 @@ void octnode_t::insert(shape_t& s, int d)
 		return;
 	}
 
-	/* recurse over children */
+	/* check which children the shape intersects, whether or
+	 * not they exist yet, all at once */
 	chw = this->halfwidth / 2; /* children are half the width */
+	for(i = 0; i < CHILDREN_PER_NODE; i++)
+		centers[i] = (this->children[i] != NULL)
+				? this->children[i]->center
+				: (Vector3d) (relative_child_pos(i)*chw
+						+ this->center);
+	s.intersects_block(CHILDREN_PER_NODE, centers, chw, hits);
+
+	/* recurse over children */
+	n = 0;
 	for(i = 0; i < CHILDREN_PER_NODE; i++)
 	{
-		/* check if child exists */
-		if(this->children[i] != NULL)
-		{
-			/* check for intersection */
-			if(!s.intersects(this->children[i]->center,
-				         this->children[i]->halfwidth))
-				continue;
-		}
-		else
+		/* check for intersection */
+		if(!hits[i])
+			continue;
+
+		/* if the child does not exist, make the subnode */
+		if(this->children[i] == NULL)
+			this->children[i] = new octnode_t(centers[i], chw);
+
+		/* if the children are at the final depth, then they
+		 * are leaves, so defer them to be applied as a block */
+		if(d == 1)
 		{
-			/* child does not exist. check
-			 * if shape would intersect it. */
-			child_center = relative_child_pos(i)*chw
-					+ this->center; 
-			if(!s.intersects(child_center, chw))
-				continue;
-
-			/* shape intersects it, so make the subnode */
-			this->children[i] = new octnode_t(child_center,chw);
+			leaves[n++] = this->children[i];
+			continue;
 		}
 
 		/* recurse */
 		this->children[i]->insert(s, d-1);
 	}
+
+	/* apply the shape to any deferred leaves all at once */
+	if(n == 0)
+		return;
+	for(i = 0; i < n; i++)
+	{
+		centers[i] = leaves[i]->center;
+		datas[i]   = leaves[i]->data;
+	}
+	s.apply_to_leaves(n, centers, chw, datas);
+	for(i = 0; i < n; i++)
+		leaves[i]->data = datas[i];
 }
 
 void octnode_t::subdivide(const shape_t& s, int d)
@@ -575,6 +596,65 @@ int octnode_t::parse(std::istream& is, unsigned int v)
 	return 0;
 }
 
+int octnode_t::parse(const char* buf, size_t size, size_t& loc,
+                     unsigned int v)
+{
+	double d[4];
+	unsigned int i;
+	int ret;
+
+	/* read in geometry information */
+	if(loc + sizeof(d) + 1 > size)
+		return -1; /* buffer too small */
+	memcpy(d, buf + loc, sizeof(d));
+	loc += sizeof(d);
+	this->center << d[0], d[1], d[2];
+	this->halfwidth = d[3];
+
+	/* delete any existing data */
+	if(this->data != NULL)
+	{
+		delete (this->data);
+		this->data = NULL;
+	}
+
+	/* read in data information, if the flag states
+	 * that this node has data */
+	if(buf[loc++] != 0)
+	{
+		this->data = new octdata_t();
+		ret = this->data->parse(buf, size, loc, v);
+		if(ret)
+			return -2; /* could not read data */
+	}
+
+	/* read in child information */
+	for(i = 0; i < CHILDREN_PER_NODE; i++)
+	{
+		/* delete any existing child here */
+		if(this->children[i] != NULL)
+		{
+			delete (this->children[i]);
+			this->children[i] = NULL;
+		}
+
+		/* check if i'th child exists in buffer */
+		if(loc >= size)
+			return -3; /* buffer too small */
+		if(buf[loc++] == 0)
+			continue;
+
+		/* read in child recursively in a depth-first manner */
+		this->children[i] = new octnode_t();
+		ret = this->children[i]->parse(buf, size, loc, v);
+		if(ret)
+			return -4; /* could not parse child */
+	}
+
+	/* success */
+	return 0;
+}
+
 int octnode_t::verify() const
 {
 	size_t i, j;
@@ -14,6 +14,7 @@
 
 #include "shape.h"
 #include "octdata.h"
+#include <util/slab_allocator.h>
 #include <Eigen/Dense>
 #include <iostream>
 #include <set>
@@ -50,8 +51,14 @@ class octnode_t
 		/* constructors */
 		/*--------------*/
 		
-		/* eigen constructions must be properly aligned */
-		EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+		/* trees can have hundreds of millions of nodes, so
+		 * they are allocated from slabs rather than one at a
+		 * time.  The center does not need to be aligned, since
+		 * Eigen does not vectorize a Vector3d. */
+		static void* operator new(size_t n)
+		{ return slab_allocator_t<octnode_t>::allocate(n); };
+		static void operator delete(void* p, size_t n)
+		{ slab_allocator_t<octnode_t>::deallocate(p, n); };
 		
 		/**
 		 * Constructs empty leaf node
@@ -221,7 +228,9 @@ class octnode_t
 		 * After this call, all leaf nodes under this node that
 		 * are intersected by this line segment are given to
 		 * the input shape, where s.apply_to_leaf() is called
-		 * on each of their data elements.
+		 * on each of their data elements.  Sibling leaves at
+		 * the final depth are instead given together to
+		 * s.apply_to_leaves().
 		 *
 		 * This function is recursive, and will perform intersection
 		 * checks for all subnodes, but NOT for the top-level
@@ -312,6 +321,24 @@ class octnode_t
 		 */
 		int parse(std::istream& is, unsigned int v);
 
+		/**
+		 * Will parse tree information from a buffer in memory
+		 *
+		 * Reads the same format as parse(is, v), starting at
+		 * the given location in the buffer.  After this call,
+		 * the location will be just past this node and its
+		 * subnodes.
+		 *
+		 * @param buf   The buffer to read from
+		 * @param size  The size of the buffer, in bytes
+		 * @param loc   The location in the buffer to read
+		 * @param v     The version number of the input file
+		 *
+		 * @return     Returns zero on success, non-zero on failure.
+		 */
+		int parse(const char* buf, size_t size, size_t& loc,
+		          unsigned int v);
+
 		/*-----------*/
 		/* debugging */
 		/*-----------*/
@@ -2,14 +2,22 @@
 #include "octnode.h"
 #include "octdata.h"
 #include "shape.h"
+#include "octfile.h"
 #include <util/error_codes.h>
+#include <util/slab_allocator.h>
+#include <boost/threadpool.hpp>
+#include <boost/thread.hpp>
+#include <boost/bind.hpp>
 #include <string>
 #include <iomanip>
 #include <iostream>
 #include <fstream>
+#include <sstream>
+#include <algorithm>
 #include <stdlib.h>
 #include <cmath>
 #include <set>
+#include <vector>
 #include <float.h>
 #include <Eigen/Dense>
 #include <Eigen/Geometry>
@@ -23,6 +31,31 @@ using namespace Eigen;
 #define GET_RELATIVE_DEPTH(rootsize, leafsize) \
 		( (int) round( log((rootsize) / (leafsize)) / log(2.0) ) );
 
+/* the number of blocks per thread that are encoded at once when
+ * writing a file, which bounds the memory used to buffer them */
+#define SERIALIZE_BLOCKS_PER_THREAD 16
+
+/* the number of subtrees per thread that are simplified in parallel,
+ * which is used to decide how far down the tree to fork */
+#define SIMPLIFY_SUBTREES_PER_THREAD 8
+
+/* helper functions */
+static unsigned int get_io_threads(unsigned int num_threads);
+static void find_subtrees(octnode_t* node, unsigned int depth,
+                          unsigned int fork_depth,
+                          vector<octnode_t*>& subtrees);
+static void simplify_subtree(octnode_t* node, char* result);
+static bool simplify_top(octnode_t* node, unsigned int depth,
+                         unsigned int fork_depth,
+                         const vector<char>& results, size_t& next);
+static void find_blocks(const octnode_t* node, unsigned int depth,
+                        vector<const octnode_t*>& roots,
+                        vector<octfile::block_t>& blocks);
+static void encode_block(const octnode_t* node, bool compress,
+                         string* buf, uint64_t* raw_size, int* ret);
+static void decode_block(const octfile::reader_t* infile, size_t i,
+                         octnode_t* node, int* ret);
+
 /***** OCTTREE FUNCTIONS ****/
 
 octree_t::octree_t()
@@ -47,6 +80,7 @@ octree_t::~octree_t()
 
 octree_t::octree_t(const Eigen::Vector3d& c, double hw, double r)
 {
+	this->root = NULL;
 	this->set(c, hw, r);
 }
 
@@ -101,6 +135,11 @@ void octree_t::clear()
 	{
 		delete (this->root);
 		this->root = NULL;
+
+		/* if that was the last tree, give the memory of
+		 * all nodes back to the system at once */
+		slab_allocator_t<octnode_t>::release_if_unused();
+		slab_allocator_t<octdata_t>::release_if_unused();
 	}
 	this->max_depth = -1;
 }
@@ -332,16 +371,104 @@ void octree_t::filter(const std::set<octdata_t*>& whitelist)
 		this->root->filter(whitelist);
 }
 
-/* The following defines are used for reading and writing files */
-#define OCTFILE_MAGIC_NUMBER      "octtree"
-#define OCTFILE_OLD_MAGIC_NUMBER  "octfile"
-#define OCTFILE_MAGIC_LENGTH      8
-#define OCTFILE_CURRENT_VERSION   2
+void octree_t::simplify(unsigned int num_threads)
+{
+	vector<octnode_t*> subtrees;
+	vector<char> results;
+	unsigned int fork_depth;
+	size_t i, next;
+
+	/* check if there is anything to simplify */
+	if(this->root == NULL)
+		return;
+
+	/* determine how many threads to use */
+	if(num_threads == 0)
+		num_threads = boost::thread::hardware_concurrency();
+	if(num_threads <= 1)
+	{
+		/* nothing to gain from a pool */
+		this->root->simplify_recur();
+		return;
+	}
+
+	/* fork deep enough into the tree that there are several
+	 * subtrees for each thread to process */
+	fork_depth = 0;
+	while((1u << (3*fork_depth))
+			< SIMPLIFY_SUBTREES_PER_THREAD * num_threads)
+		fork_depth++;
+	find_subtrees(this->root, 0, fork_depth, subtrees);
+
+	/* the subtrees are disjoint, so they can be simplified
+	 * independently */
+	results.resize(subtrees.size(), 0);
+	{
+		/* the pool waits for all tasks when it goes out
+		 * of scope */
+		boost::threadpool::pool tp(num_threads);
+		for(i = 0; i < subtrees.size(); i++)
+			tp.schedule(boost::bind(simplify_subtree,
+			                        subtrees[i], &(results[i])));
+	}
+
+	/* finish by simplifying the top levels of the tree, which
+	 * visits the subtrees in the same order they were found */
+	next = 0;
+	simplify_top(this->root, 0, fork_depth, results, next);
+}
+
+/**
+ * Finds the subtrees of a tree that are written as blocks
+ *
+ * Blocks are rooted at the depth OCTFILE_BLOCK_DEPTH, or above
+ * that depth at any leaf or any node with data.
+ *
+ * @param node    The root of the subtree to search
+ * @param depth   The depth of node in the tree
+ * @param roots   Where to store the root node of each block
+ * @param blocks  Where to store the directory entry of each block
+ */
+static void find_blocks(const octnode_t* node, unsigned int depth,
+                        vector<const octnode_t*>& roots,
+                        vector<octfile::block_t>& blocks)
+{
+	octfile::block_t b;
+	unsigned int i;
+
+	/* check if this node is the root of a block */
+	if(depth >= OCTFILE_BLOCK_DEPTH || node->isleaf()
+			|| node->data != NULL)
+	{
+		b.center    = node->center;
+		b.halfwidth = node->halfwidth;
+		b.depth     = depth;
+		b.offset    = 0; /* set when written */
+		b.size      = 0;
+		b.raw_size  = 0;
+		roots.push_back(node);
+		blocks.push_back(b);
+		return;
+	}
+
+	/* otherwise, search the children */
+	for(i = 0; i < CHILDREN_PER_NODE; i++)
+		if(node->children[i] != NULL)
+			find_blocks(node->children[i], depth+1,
+			            roots, blocks);
+}
 
-int octree_t::serialize(const string& fn) const
+int octree_t::serialize(const string& fn, bool compress,
+                        unsigned int num_threads) const
 {
+	vector<const octnode_t*> roots;
+	vector<octfile::block_t> blocks;
+	vector<string> bufs;
+	vector<int> rets;
 	ofstream outfile;
-	unsigned int c, v;
+	streampos dir;
+	unsigned int c, v, i, j, m, n, codec, batch_size;
+	double d;
 
 	/* open binary file for writing */
 	outfile.open(fn.c_str(), ios_base::out | ios_base::binary);
@@ -361,104 +488,154 @@ int octree_t::serialize(const string& fn) const
 	outfile.write((char*) &(this->max_depth), sizeof(this->max_depth));
 	outfile.write((char*) &c, sizeof(c));
 
-	/* export tree information */
-	this->root->serialize(outfile);
+	/* export the geometry of the root, and split the
+	 * tree into blocks */
+	for(i = 0; i < 4; i++)
+	{
+		if(this->root == NULL)
+			d = 0;
+		else
+			d = (i < 3) ? this->root->center(i)
+					: this->root->halfwidth;
+		outfile.write((char*) &d, sizeof(d));
+	}
+	if(this->root != NULL)
+		find_blocks(this->root, 0, roots, blocks);
+	n = blocks.size();
+	outfile.write((char*) &n, sizeof(n));
+	codec = compress ? octfile::CODEC_ZLIB : octfile::CODEC_NONE;
+	outfile.write((char*) &codec, sizeof(codec));
+
+	/* leave space for the directory, which is written once
+	 * the location of each block is known */
+	dir = outfile.tellp();
+	for(i = 0; i < n; i++)
+		blocks[i].serialize(outfile);
+
+	/* the blocks are independent, so they are encoded in parallel,
+	 * a batch at a time, and written in order */
+	num_threads = get_io_threads(num_threads);
+	batch_size = SERIALIZE_BLOCKS_PER_THREAD * num_threads;
+	boost::threadpool::pool tp(num_threads);
+	for(i = 0; i < n; i += batch_size)
+	{
+		/* encode this batch */
+		m = min(batch_size, n - i);
+		bufs.resize(m);
+		rets.resize(m);
+		for(j = 0; j < m; j++)
+			tp.schedule(boost::bind(encode_block, roots[i+j],
+			                        compress, &(bufs[j]),
+			                        &(blocks[i+j].raw_size),
+			                        &(rets[j])));
+		tp.wait();
+
+		/* export each block of the batch */
+		for(j = 0; j < m; j++)
+		{
+			if(rets[j])
+			{
+				cerr << "[octree_t::serialize]\tUnable to "
+				     << "encode block #" << (i+j) << endl;
+				outfile.close();
+				return PROPEGATE_ERROR(-2, rets[j]);
+			}
+			blocks[i+j].offset = outfile.tellp();
+			blocks[i+j].size = bufs[j].size();
+			outfile.write(bufs[j].data(), bufs[j].size());
+			string().swap(bufs[j]); /* free memory */
+		}
+	}
+
+	/* export the directory */
+	outfile.seekp(dir);
+	for(i = 0; i < n; i++)
+		blocks[i].serialize(outfile);
 
 	/* clean up */
+	if(outfile.fail())
+	{
+		outfile.close();
+		return -3; /* could not write file */
+	}
 	outfile.close();
 	return 0;
 }
 	
-int octree_t::parse(const string& fn)
+int octree_t::parse(const string& fn, unsigned int num_threads)
 {
-	char magic[OCTFILE_MAGIC_LENGTH];
-	ifstream infile;
-	unsigned int c, v;
+	/* parse every block of the file */
+	return this->parse(fn, Vector3d::Constant(-DBL_MAX),
+	                       Vector3d::Constant(DBL_MAX), num_threads);
+}
+	
+int octree_t::parse(const string& fn, const Vector3d& bmin,
+                    const Vector3d& bmax, unsigned int num_threads)
+{
+	octfile::reader_t infile;
+	vector<octnode_t*> nodes;
+	vector<size_t> inds;
+	vector<int> rets;
+	octnode_t* node;
+	size_t i;
 	int ret;
 
-	/* open binary file for reading */
-	v = 0; /* invalid version */
-	infile.open(fn.c_str(), ios_base::in | ios_base::binary);
-	if(!(infile.is_open()))
+	/* open the file, which reads its directory of blocks */
+	ret = infile.open(fn);
+	if(ret)
 	{
-		cerr << "[octree_t::parse]\tUnable to open file: "
+		cerr << "[octree_t::parse]\tUnable to open octree file: "
 		     << fn << endl;
-		return -1; /* could not open file */
+		return PROPEGATE_ERROR(-1, ret);
 	}
 
-	/* check magic number from header */
-	infile.read(magic, OCTFILE_MAGIC_LENGTH);
-	if(strcmp(magic, OCTFILE_MAGIC_NUMBER))
+	/* destroy any existing information */
+	this->clear();
+	this->max_depth = infile.get_max_depth();
+	this->root = new octnode_t(infile.get_root_center(),
+	                           infile.get_root_halfwidth());
+
+	/* make the nodes above each block that is within the box.
+	 * Since the blocks are disjoint subtrees, they can then be
+	 * parsed in parallel */
+	for(i = 0; i < infile.num_blocks(); i++)
 	{
-		/* check if this is an outdated file */
-		if(!strcmp(magic, OCTFILE_OLD_MAGIC_NUMBER))
+		const octfile::block_t& b = infile.get_block(i);
+		if(!(b.intersects(bmin, bmax)))
+			continue;
+		node = this->root->expand(b.center, b.depth);
+		if(node == NULL)
 		{
-			cerr << "[octree_t::parse]\tNote: this file is "
-			     << "using outdated version of octree file "
-			     << "format. Attempting to parse..." << endl;
-			v = 1; /* represents old version */
+			cerr << "[octree_t::parse]\tBlock #" << i << " is "
+			     << "outside of tree in file: " << fn << endl;
+			return -2;
 		}
-		else
-		{
-			/* unknown format */
-			cerr << "[octree_t::parse]\tNot an octree file: "
-			     << fn << endl;
-			infile.close();
-			return -2; /* not a valid octfile */
-		}
-	}
-
-	/* parse header of old version of file */
-	if(v == 1)
-	{
-		/* depth of tree */
-		infile.read((char*) &(this->max_depth), 
-					sizeof(this->max_depth));
-		
-		/* count # of nodes in tree */
-		infile.read((char*) &c, sizeof(c)); 
-	}
-	else /* parse header for newer versions */
-	{
-		/* get remainder of header information */
-		infile.read((char*) &v, sizeof(v)); /* version on file */
-
-		/* depth of tree */
-		infile.read((char*) &(this->max_depth), 
-					sizeof(this->max_depth));
-		
-		/* count # of nodes in tree */
-		infile.read((char*) &c, sizeof(c)); 
+		nodes.push_back(node);
+		inds.push_back(i);
 	}
 
-	/* check version info */
-	if(v > OCTFILE_CURRENT_VERSION)
+	/* read in each block */
+	rets.resize(inds.size());
+	if(inds.size() == 1)
+		decode_block(&infile, inds[0], nodes[0], &(rets[0]));
+	else if(!inds.empty())
 	{
-		cerr << "[octree_t::parse]\tInput file has version #"
-		     << v << ", while this parser expects version #"
-		     << OCTFILE_CURRENT_VERSION << endl
-		     << "\tfile: " << fn << endl << endl
-		     << "\tPLEASE UPDATE TO LATEST VERSION OF CODE" << endl;
-		return -3;
-	}
-
-	/* destroy any existing information */
-	if(this->root != NULL)
-		delete (this->root);
-	this->root = new octnode_t();
-
-	/* read in tree information */
-	ret = this->root->parse(infile, v);
-	if(ret)
-	{
-		cerr << "[octree_t::parse]\tUnable to parse octree file: "
-		     << fn << endl;
-		infile.close();
-		return PROPEGATE_ERROR(-4, ret);
+		boost::threadpool::pool tp(get_io_threads(num_threads));
+		for(i = 0; i < inds.size(); i++)
+			tp.schedule(boost::bind(decode_block, &infile,
+			                        inds[i], nodes[i],
+			                        &(rets[i])));
+		tp.wait();
 	}
+	for(i = 0; i < rets.size(); i++)
+		if(rets[i])
+		{
+			cerr << "[octree_t::parse]\tUnable to parse octree "
+			     << "file: " << fn << endl;
+			return PROPEGATE_ERROR(-3, rets[i]);
+		}
 
-	/* clean up */
-	infile.close();
+	/* success */
 	return 0;
 }
 		
@@ -490,3 +667,186 @@ int octree_t::verify() const
 	/* success */
 	return 0;
 }
+
+/*------------------*/
+/* helper functions */
+/*------------------*/
+
+/**
+ * Gets the number of threads to use to read or write a file
+ *
+ * @param num_threads   The number of threads requested, or zero
+ *                      to use the number of cores
+ *
+ * @return   Returns the number of threads to use, at least one
+ */
+static unsigned int get_io_threads(unsigned int num_threads)
+{
+	/* by default, use every core */
+	if(num_threads == 0)
+		num_threads = boost::thread::hardware_concurrency();
+	return (num_threads == 0) ? 1 : num_threads;
+}
+
+/**
+ * Finds the subtrees of a tree that are simplified in parallel
+ *
+ * Subtrees are rooted at the non-leaf nodes at the given fork depth.
+ * They are listed in the same order that simplify_top() visits them.
+ *
+ * @param node         The root of the subtree to search
+ * @param depth        The depth of node in the tree
+ * @param fork_depth   The depth of the subtrees to find
+ * @param subtrees     Where to store the root node of each subtree
+ */
+static void find_subtrees(octnode_t* node, unsigned int depth,
+                          unsigned int fork_depth,
+                          vector<octnode_t*>& subtrees)
+{
+	unsigned int i;
+
+	/* leaves are already simplified */
+	if(node->isleaf())
+		return;
+
+	/* check if we've descended far enough */
+	if(depth >= fork_depth)
+	{
+		subtrees.push_back(node);
+		return;
+	}
+
+	/* otherwise, search the children */
+	for(i = 0; i < CHILDREN_PER_NODE; i++)
+		if(node->children[i] != NULL)
+			find_subtrees(node->children[i], depth+1,
+			              fork_depth, subtrees);
+}
+
+/**
+ * Recursively simplifies one subtree of a tree
+ *
+ * @param node     The root node of the subtree
+ * @param result   Where to store whether the subtree was fully
+ *                 simplified
+ */
+static void simplify_subtree(octnode_t* node, char* result)
+{
+	*result = node->simplify_recur() ? 1 : 0;
+}
+
+/**
+ * Simplifies the levels of a tree above the parallel subtrees
+ *
+ * This follows the same logic as octnode_t::simplify_recur(), but
+ * uses the results of the subtrees that were already simplified
+ * in place of recursing below the fork depth.
+ *
+ * @param node         The node to simplify
+ * @param depth        The depth of node in the tree
+ * @param fork_depth   The depth of the simplified subtrees
+ * @param results      The results of simplifying each subtree
+ * @param next         The index of the next subtree result
+ *
+ * @return   Returns true iff the node was fully simplified
+ */
+static bool simplify_top(octnode_t* node, unsigned int depth,
+                         unsigned int fork_depth,
+                         const vector<char>& results, size_t& next)
+{
+	bool should_simplify;
+	unsigned int i;
+
+	/* check if already simplified */
+	if(node->isleaf())
+		return true;
+
+	/* check if this subtree was simplified in parallel */
+	if(depth >= fork_depth)
+		return (results[next++] != 0);
+
+	/* attempt to simplify children */
+	should_simplify = true;
+	for(i = 0; i < CHILDREN_PER_NODE; i++)
+	{
+		if(node->children[i] == NULL)
+			should_simplify = false; /* not all exist */
+		else
+			should_simplify &= simplify_top(node->children[i],
+					depth+1, fork_depth, results, next);
+	}
+
+	/* simplify this node if all children were simplified */
+	if(!should_simplify)
+		return false;
+	return node->simplify();
+}
+
+/**
+ * Serializes one block of a tree into a buffer
+ *
+ * @param node       The root node of the block
+ * @param compress   Whether to compress the serialized block.  A
+ *                   block that does not shrink is stored as-is.
+ * @param buf        Where to store the encoded block
+ * @param raw_size   Where to store the size of the block before
+ *                   compression
+ * @param ret        Where to store zero on success, non-zero
+ *                   on failure
+ */
+static void encode_block(const octnode_t* node, bool compress,
+                         string* buf, uint64_t* raw_size, int* ret)
+{
+	ostringstream os(ios_base::out | ios_base::binary);
+	string raw;
+
+	/* serialize the nodes of the block */
+	node->serialize(os);
+	raw = os.str();
+	*raw_size = raw.size();
+
+	/* compress them if needed */
+	if(!compress)
+	{
+		buf->swap(raw);
+		*ret = 0;
+		return;
+	}
+	*ret = octfile::compress(raw.data(), raw.size(), *buf);
+
+	/* store the block as-is if it did not shrink, which readers
+	 * detect by its size being equal to its raw size */
+	if(*ret == 0 && buf->size() >= raw.size())
+		buf->swap(raw);
+}
+
+/**
+ * Parses one block of a file into the node at its root
+ *
+ * @param infile   The file to read
+ * @param i        The index of the block to parse
+ * @param node     The node at the root of the block
+ * @param ret      Where to store zero on success, non-zero
+ *                 on failure
+ */
+static void decode_block(const octfile::reader_t* infile, size_t i,
+                         octnode_t* node, int* ret)
+{
+	vector<unsigned char> buf;
+	const char* nodes;
+	size_t size, loc;
+
+	/* get the serialized nodes, decompressing them if needed */
+	*ret = infile->read_block(i, buf, nodes, size);
+	if(*ret)
+	{
+		*ret = PROPEGATE_ERROR(-1, *ret);
+		return;
+	}
+
+	/* parse the nodes */
+	loc = 0;
+	*ret = node->parse(nodes, size, loc, infile->get_version());
+	if(*ret)
+		*ret = PROPEGATE_ERROR(-2, *ret);
+}
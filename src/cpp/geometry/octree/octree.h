@@ -140,6 +140,10 @@ class octree_t
 		 *
 		 * Clears all information from tree.  set_resolution()
 		 * must be called before adding more data.
+		 *
+		 * Nodes are allocated from shared slabs, which are
+		 * returned to the system all at once when the last
+		 * tree in the program is cleared.
 		 */
 		void clear();
 
@@ -288,6 +292,20 @@ class octree_t
 		 */
 		void filter(const std::set<octdata_t*>& whitelist);
 
+		/**
+		 * Will recursively simplify the nodes of this tree
+		 *
+		 * This call is equivalent to calling simplify_recur()
+		 * on the root node, but the subtrees below the top few
+		 * levels of the tree are simplified in parallel.  The
+		 * resulting tree does not depend on the number of
+		 * threads used.
+		 *
+		 * @param num_threads   The number of threads to use.  If
+		 *                      zero, will use the number of cores.
+		 */
+		void simplify(unsigned int num_threads=0);
+
 		/*-----*/
 		/* i/o */
 		/*-----*/
@@ -299,26 +317,70 @@ class octree_t
 		 * specified binary file.  The tree can be
 		 * perfectly reconstructed by using this information.
 		 *
-		 * @param fn   The path to output file to write
+		 * The tree is written as a directory of blocks, each
+		 * of which is a subtree, so that regions of the tree
+		 * can be parsed without reading the whole file.  The
+		 * blocks are encoded in parallel, and can optionally
+		 * be compressed, which makes the file smaller but
+		 * several times slower to write.
+		 *
+		 * @param fn            The path to output file to write
+		 * @param compress      Whether to compress each block
+		 * @param num_threads   The number of threads to use.  If
+		 *                      zero, will use the number of cores.
 		 *
 		 * @return     Returns zero on success, non-zero on failure.
 		 */
-		int serialize(const std::string& fn) const;
+		int serialize(const std::string& fn,
+		              bool compress=false,
+		              unsigned int num_threads=0) const;
 
 		/**
-		 * Parses serialization of octree from stream
+		 * Parses serialization of octree from file
 		 *
-		 * Reads from the specified stream and creates the
+		 * Reads from the specified file and creates the
 		 * tree described.  This will destroy any existing data.
 		 *
-		 * Assumes the content of the stream is formatted in the
-		 * same manner as octree_t::serialize().
+		 * Assumes the content of the file is formatted in the
+		 * same manner as octree_t::serialize(), or in any
+		 * earlier version of that format.  The blocks of the
+		 * file are decompressed and parsed in parallel.
+		 *
+		 * @param fn            The path to the input file to parse
+		 * @param num_threads   The number of threads to use.  If
+		 *                      zero, will use the number of cores.
+		 *
+		 * @return     Returns 0 on success, non-zero on failure.
+		 */
+		int parse(const std::string& fn,
+		          unsigned int num_threads=0);
+
+		/**
+		 * Parses the part of an octree file within a box
+		 *
+		 * Reads from the specified file and creates the
+		 * tree described, but only parses the blocks of the
+		 * file that intersect the given bounding box.  All
+		 * nodes that intersect the box will be parsed, but
+		 * nodes outside the box may be parsed as well, since
+		 * whole blocks are read at a time.
+		 *
+		 * The time to parse is proportional to the size of
+		 * the region.  Files written before the format was
+		 * split into blocks are always parsed fully.
 		 *
-		 * @param fn   The path to the input file to parse
+		 * @param fn            The path to the input file to parse
+		 * @param bmin          The minimum corner of the bounding box
+		 * @param bmax          The maximum corner of the bounding box
+		 * @param num_threads   The number of threads to use.  If
+		 *                      zero, will use the number of cores.
 		 *
 		 * @return     Returns 0 on success, non-zero on failure.
 		 */
-		int parse(const std::string& fn);
+		int parse(const std::string& fn,
+		          const Eigen::Vector3d& bmin,
+		          const Eigen::Vector3d& bmax,
+		          unsigned int num_threads=0);
 
 		/*-----------*/
 		/* debugging */
@@ -4,6 +4,9 @@
 #include <util/error_codes.h>
 #include <util/progress_bar.h>
 #include <util/tictoc.h>
+#include <boost/threadpool.hpp>
+#include <boost/bind.hpp>
+#include <boost/ref.hpp>
 #include <Eigen/Dense>
 #include <algorithm>
 #include <utility>
@@ -11,8 +14,6 @@
 #include <string>
 #include <vector>
 #include <queue>
-#include <map>
-#include <set>
 
 /**
  * @file octtopo.cpp
@@ -39,110 +40,369 @@ using namespace octtopo;
 
 #define APPROX_ZERO 0.0000001
 
+/* the number of subtrees to build per thread, so that the threads
+ * stay balanced even if subtrees vary in size */
+#define SUBTREES_PER_THREAD 8
+
+/* the hash table of nodes is kept at most half full */
+#define MIN_HASH_BITS   4
+#define HASH_MULTIPLIER 0x9E3779B97F4A7C15ULL
+
+/* helper functions */
+
+/**
+ * Gets the child on the other side of the parent along a face's axis
+ *
+ * Given a child index and a face, will return the index of the
+ * child of the same parent that is the mirror image of the given
+ * child across the plane perpendicular to the face normal.
+ *
+ * @param i   The child index
+ * @param f   The face that defines the axis
+ *
+ * @return    Returns the mirrored child index
+ */
+static inline size_t mirror_child(size_t i, CUBE_FACE f)
+{
+	/* The ordering of octnodes can be found here 
+	 * (taken from octnode.h):
+	 * 
+	 * 		y
+	 *              ^
+	 *       1      |      0
+	 *              |
+	 * -------------+-------------> x	(top, z+)
+	 *              |
+	 *       2      |      3
+	 *              |
+	 *
+	 * 		y
+	 *              ^
+	 *       5      |      4
+	 *              |
+	 * -------------+-------------> x	(bottom, z-)
+	 *              |
+	 *       6      |      7
+	 *              |
+	 */
+	static const size_t xmirror[CHILDREN_PER_NODE]
+		= { 1, 0, 3, 2, 5, 4, 7, 6 };
+	static const size_t ymirror[CHILDREN_PER_NODE]
+		= { 3, 2, 1, 0, 7, 6, 5, 4 };
+	static const size_t zmirror[CHILDREN_PER_NODE]
+		= { 4, 5, 6, 7, 0, 1, 2, 3 };
+
+	switch(f)
+	{
+		case FACE_XMINUS:
+		case FACE_XPLUS:
+			return xmirror[i];
+		case FACE_YMINUS:
+		case FACE_YPLUS:
+			return ymirror[i];
+		case FACE_ZMINUS:
+		case FACE_ZPLUS:
+			return zmirror[i];
+	}
+
+	/* will never get here */
+	return i;
+}
+
+/**
+ * Checks if a child touches the given face of its parent
+ *
+ * @param i   The child index
+ * @param f   The face of the parent to check
+ *
+ * @return    Returns true iff the i'th child touches face f
+ */
+static inline bool child_on_face(size_t i, CUBE_FACE f)
+{
+	/* children on the positive side of each axis */
+	static const bool xplus[CHILDREN_PER_NODE]
+		= { true, false, false, true, true, false, false, true };
+	static const bool yplus[CHILDREN_PER_NODE]
+		= { true, true, false, false, true, true, false, false };
+	static const bool zplus[CHILDREN_PER_NODE]
+		= { true, true, true, true, false, false, false, false };
+
+	switch(f)
+	{
+		case FACE_XMINUS:	return !xplus[i];
+		case FACE_XPLUS:	return  xplus[i];
+		case FACE_YMINUS:	return !yplus[i];
+		case FACE_YPLUS:	return  yplus[i];
+		case FACE_ZMINUS:	return !zplus[i];
+		case FACE_ZPLUS:	return  zplus[i];
+	}
+
+	/* will never get here */
+	return false;
+}
+
+/**
+ * Hashes a node pointer into a table of the given size
+ *
+ * @param node   The node to hash
+ * @param bits   The log-base-2 of the table size
+ *
+ * @return       Returns the table index for the node
+ */
+static inline size_t hash_node(octnode_t* node, unsigned int bits)
+{
+	/* multiplicative hashing keeps the high bits, which depend
+	 * on all bits of the pointer */
+	return (size_t) ((((unsigned long long) node) * HASH_MULTIPLIER)
+			>> (64 - bits));
+}
+
 /*-----------------------------------------*/
 /* octneighbors_t function implementations */
 /*-----------------------------------------*/
 
 octneighbors_t::octneighbors_t()
-{}
-
-octneighbors_t::octneighbors_t(const octneighbors_t& other)
 {
-	size_t i;
-	for(i = 0; i < NUM_FACES_PER_CUBE; i++)
-		this->neighs[i].insert(other.neighs[i].begin(),
-					other.neighs[i].end());
+	this->clear();
 }
 
 void octneighbors_t::clear()
 { 
 	size_t i;
 	for(i = 0; i < NUM_FACES_PER_CUBE; i++)
-		this->neighs[i].clear();
+		this->first[i] = this->last[i] = NULL;
 }
 
-void octneighbors_t::add_all(const std::vector<octnode_t*>& ns, CUBE_FACE f)
+bool octneighbors_t::contains(octnode_t* n, CUBE_FACE f) const
 {
-	size_t i, n;
-	n = ns.size();
-	for(i = 0; i < n; i++)
-		this->add(ns[i], f);
+	return (std::find(this->first[f], this->last[f], n)
+			!= this->last[f]);
 }
 
 void octneighbors_t::get_singletons(octnode_t* ns[NUM_FACES_PER_CUBE]) const
 {
 	size_t i;
 	for(i = 0; i < NUM_FACES_PER_CUBE; i++)
-		ns[i] = (this->neighs[i].size() == 1)
-				? (*(this->neighs[i].begin())) : NULL;
-}
-			
-octneighbors_t& octneighbors_t::operator = (const octneighbors_t& other)
-{
-	size_t i;
-
-	/* copy each value */
-	for(i = 0; i < NUM_FACES_PER_CUBE; i++)
-	{
-		/* destroy existing */
-		this->neighs[i].clear();
-		this->neighs[i].insert(other.neighs[i].begin(),
-				other.neighs[i].end());
-	}
-
-	/* return changed object */
-	return (*this);
+		ns[i] = (this->last[i] - this->first[i] == 1)
+				? (*(this->first[i])) : NULL;
 }
 
 /*------------------------------------*/
 /* octtopo_t function implementations */
 /*------------------------------------*/
 
-int octtopo_t::init(const octree_t& tree)
+octtopo_t::const_iterator::const_iterator(const octtopo_t* t, size_t i)
+	: topo(t), index(i)
 {
-	int ret;
+	this->update();
+}
+
+void octtopo_t::const_iterator::update()
+{
+	/* only populate if referencing a valid node */
+	if(this->topo == NULL || this->index >= this->topo->nodes.size())
+		return;
+	this->value.first = this->topo->nodes[this->index];
+	this->topo->get_neighbors(this->index, this->value.second);
+}
+
+int octtopo_t::init(const octree_t& tree, unsigned int num_threads)
+{
+	vector<octnode_t*> roots, next_roots, uncles, next_uncles;
+	vector<vector<octnode_t*> > task_nodes, task_edges;
+	vector<vector<size_t> > task_offsets;
+	octnode_t* ns[NUM_FACES_PER_CUBE];
+	size_t k, i, j, base, num_nodes, num_edges;
+	bool expanded;
+
+	/* clear any existing info */
+	this->clear();
+	if(tree.get_root() == NULL)
+	{
+		/* empty tree, so empty topology */
+		this->build_hash();
+		return 0;
+	}
+
+	/* determine how many threads to use */
+	if(num_threads == 0)
+		num_threads = boost::thread::hardware_concurrency();
+	if(num_threads == 0)
+		num_threads = 1;
 
 	/* the root node of this tree can't have any neighbors, since
 	 * there are no other nodes on that level */
-	this->neighs.clear();
-	this->neighs.insert(pair<octnode_t*, octneighbors_t>(
-			tree.get_root(), octneighbors_t()));
+	roots.push_back(tree.get_root());
+	uncles.resize(NUM_FACES_PER_CUBE, NULL);
+
+	/* split the tree into subtrees, level by level, until there
+	 * are enough to keep all threads busy.  Each level is kept
+	 * in depth-first order, so that concatenating the subtrees
+	 * gives the same ordering as a single traversal */
+	while(num_threads > 1
+			&& roots.size() < SUBTREES_PER_THREAD*num_threads)
+	{
+		next_roots.clear();
+		next_uncles.clear();
+		expanded = false;
+		for(k = 0; k < roots.size(); k++)
+		{
+			/* leaves can't be split any further */
+			if(roots[k]->isleaf())
+			{
+				next_roots.push_back(roots[k]);
+				next_uncles.insert(next_uncles.end(),
+					uncles.begin() + NUM_FACES_PER_CUBE*k,
+					uncles.begin()
+					+ NUM_FACES_PER_CUBE*(k+1));
+				continue;
+			}
+
+			/* replace this subtree with its children */
+			for(i = 0; i < CHILDREN_PER_NODE; i++)
+			{
+				if(roots[k]->children[i] == NULL)
+					continue;
+				octtopo_t::get_child_neighbors(roots[k],
+					&(uncles[NUM_FACES_PER_CUBE*k]), i, ns);
+				next_roots.push_back(roots[k]->children[i]);
+				next_uncles.insert(next_uncles.end(),
+					ns, ns + NUM_FACES_PER_CUBE);
+			}
+			expanded = true;
+		}
 
-	/* recursively populate the map with the subnodes of this tree */
-	this->init_children(tree.get_root());
+		/* check if this level was any different */
+		if(!expanded)
+			break;
+		roots.swap(next_roots);
+		uncles.swap(next_uncles);
+	}
 
-	/* now that all nodes have been mapped, clean up */
-	ret = this->remove_nonleafs();
-	if(ret)
-		return PROPEGATE_ERROR(-1, ret);
+	/* the offsets of each subtree start at zero */
+	this->offsets.push_back(0);
+	if(roots.size() == 1)
+	{
+		/* no need for threading, so just populate the
+		 * lists directly */
+		octtopo_t::init_children(roots[0], &(uncles[0]),
+			this->nodes, this->offsets, this->edges);
+		this->build_hash();
+		return 0;
+	}
+
+	/* compute the topology of each subtree in parallel.  The tree
+	 * is only read, and the neighbors of each subtree's root
+	 * are known, so leaves along the boundary of a subtree can
+	 * find their neighbors in the adjacent subtrees directly */
+	task_nodes.resize(roots.size());
+	task_offsets.resize(roots.size());
+	task_edges.resize(roots.size());
+	{
+		/* the pool waits for all tasks when it goes out
+		 * of scope */
+		boost::threadpool::pool tp(num_threads);
+		for(k = 0; k < roots.size(); k++)
+			tp.schedule(boost::bind(&octtopo_t::init_children,
+				roots[k], &(uncles[NUM_FACES_PER_CUBE*k]),
+				boost::ref(task_nodes[k]),
+				boost::ref(task_offsets[k]),
+				boost::ref(task_edges[k])));
+	}
+
+	/* stitch the subtrees together, shifting the offsets of each
+	 * subtree by the number of edges that precede it */
+	num_nodes = num_edges = 0;
+	for(k = 0; k < roots.size(); k++)
+	{
+		num_nodes += task_nodes[k].size();
+		num_edges += task_edges[k].size();
+	}
+	this->nodes.reserve(num_nodes);
+	this->offsets.reserve(NUM_FACES_PER_CUBE*num_nodes + 1);
+	this->edges.reserve(num_edges);
+	for(k = 0; k < roots.size(); k++)
+	{
+		base = this->edges.size();
+		this->nodes.insert(this->nodes.end(),
+			task_nodes[k].begin(), task_nodes[k].end());
+		for(j = 0; j < task_offsets[k].size(); j++)
+			this->offsets.push_back(base + task_offsets[k][j]);
+		this->edges.insert(this->edges.end(),
+			task_edges[k].begin(), task_edges[k].end());
+
+		/* free the memory of this subtree */
+		vector<octnode_t*>().swap(task_nodes[k]);
+		vector<size_t>().swap(task_offsets[k]);
+		vector<octnode_t*>().swap(task_edges[k]);
+	}
+
+	/* index the leaves */
+	this->build_hash();
 
 	/* success */
 	return 0;
 }
-			
-int octtopo_t::add(octnode_t* node, const octneighbors_t& neighs)
+
+void octtopo_t::clear()
 {
-	pair<map<octnode_t*,octneighbors_t>::iterator, bool> it;
-
-	/* attempt to insert values */
-	it = this->neighs.insert(
-			pair<octnode_t*, octneighbors_t>(node, neighs));
-	if(it.second)
-		return 0; /* value inserted */
-	return -1; /* value already exists */
+	this->nodes.clear();
+	this->offsets.clear();
+	this->edges.clear();
+	this->hash_keys.clear();
+	this->hash_vals.clear();
+	this->hash_bits = 0;
+}
+
+size_t octtopo_t::find(octnode_t* node) const
+{
+	size_t h, mask;
+
+	/* check for empty structure */
+	if(node == NULL || this->hash_keys.empty())
+		return this->nodes.size();
+
+	/* linearly probe from the hashed position */
+	mask = this->hash_keys.size() - 1;
+	h = hash_node(node, this->hash_bits);
+	while(this->hash_keys[h] != NULL)
+	{
+		if(this->hash_keys[h] == node)
+			return this->hash_vals[h];
+		h = (h + 1) & mask;
+	}
+
+	/* not found */
+	return this->nodes.size();
+}
+
+void octtopo_t::get_neighbors(size_t i, octneighbors_t& neighs) const
+{
+	octnode_t* const* base;
+	size_t fi;
+
+	/* each face is a range of the edges list */
+	base = (this->edges.empty() ? NULL : &(this->edges[0]));
+	for(fi = 0; fi < NUM_FACES_PER_CUBE; fi++)
+	{
+		neighs.first[fi] = base
+			+ this->offsets[NUM_FACES_PER_CUBE*i + fi];
+		neighs.last[fi] = base
+			+ this->offsets[NUM_FACES_PER_CUBE*i + fi + 1];
+	}
 }
 			
 int octtopo_t::get(octnode_t* node, octneighbors_t& neighs) const
 {
-	map<octnode_t*, octneighbors_t>::const_iterator it;
+	size_t i;
 
 	/* find the node */
-	it = this->neighs.find(node);
-	if(it == this->neighs.end())
+	i = this->find(node);
+	if(i >= this->nodes.size())
 		return -1; /* node not in structure */
 
-	/* copy the neighbors of this node */
-	neighs = it->second;
+	/* reference the neighbors of this node */
+	this->get_neighbors(i, neighs);
 	return 0;
 }
 			
@@ -168,15 +428,13 @@ bool octtopo_t::are_neighbors(octnode_t* a, octnode_t* b) const
 
 	/* search through a's neighbors, looking for b */
 	for(fi = 0; fi < NUM_FACES_PER_CUBE; fi++)
-		if(a_neighs.neighs[fi].count(b))
+		if(a_neighs.contains(b, all_cube_faces[fi]))
 		{
 			/* 'b' is a neighbor of 'a' on face fi,
 			 * so verify that 'a' is a neigh of
 			 * 'b' on the opposite face */
-			if(b_neighs.neighs[
-					octtopo::get_opposing_face(
-					octtopo::all_cube_faces[fi])]
-					.count(a))
+			if(b_neighs.contains(a, get_opposing_face(
+					all_cube_faces[fi])))
 				return true; /* they are neighbors */
 
 			/* if got here, the neighboring is asymmetric,
@@ -192,13 +450,13 @@ bool octtopo_t::are_neighbors(octnode_t* a, octnode_t* b) const
 			
 int octtopo_t::remove_outliers(double neigh_thresh)
 {
-	queue<map<octnode_t*, octneighbors_t>::iterator> 
-				in_to_check, out_to_check;
-	map<octnode_t*, octneighbors_t>::iterator it;
+	queue<size_t> in_to_check, out_to_check;
+	vector<pair<octnode_t*, size_t> > order;
 	vector<octnode_t*> ns;
+	octnode_t* node;
 	progress_bar_t progbar;
 	tictoc_t clk;
-	size_t num_seen, fi, ni, num_neighs;
+	size_t i, fi, base, num_seen, ni, num_neighs;
 	double count, myarea, neigharea;
 	bool current_in;
 
@@ -212,15 +470,27 @@ int octtopo_t::remove_outliers(double neigh_thresh)
 	progbar.set_name("Removing outliers");
 	num_seen = 0;
 
+	/* Which nodes get flipped depends on the order they are
+	 * checked in.  To give the same results as before the
+	 * topology was stored in arrays, visit the nodes in order
+	 * of their addresses, and the neighbors of each face in
+	 * order of their addresses, as the std::map and std::set
+	 * of the old topology did. */
+	order.resize(this->nodes.size());
+	for(i = 0; i < this->nodes.size(); i++)
+		order[i] = make_pair(this->nodes[i], i);
+	sort(order.begin(), order.end());
+
 	/* iterate over all available nodes, add them to our queues */
-	for(it = this->neighs.begin(); it != this->neighs.end(); it++)
+	for(i = 0; i < order.size(); i++)
 	{
 		/* add to appropriate queue */
-		if(this->node_is_interior(it->first))
-			in_to_check.push(it);
+		if(this->node_is_interior(order[i].first))
+			in_to_check.push(order[i].second);
 		else
-			out_to_check.push(it);
+			out_to_check.push(order[i].second);
 	}
+	vector<pair<octnode_t*, size_t> >().swap(order);
 
 	/* We want to check all the interior nodes first,
 	 * to see if they should be flipped to exterior nodes.
@@ -238,49 +508,56 @@ int octtopo_t::remove_outliers(double neigh_thresh)
 		if(in_to_check.empty())
 		{
 			/* get next currently exterior node */
-			it = out_to_check.front();
+			i = out_to_check.front();
 			out_to_check.pop();
 			current_in = false;
 		}
 		else
 		{
 			/* get next currently interior node */
-			it = in_to_check.front();
+			i = in_to_check.front();
 			in_to_check.pop();
 			current_in = true;
 		}
 		num_seen++;
 
 		/* make sure this value is legit */
-		if(it == this->neighs.end())
+		if(i >= this->nodes.size())
 		{
 			progbar.clear();
 			cerr << "[octtopo_t::remove_outliers]\tError! "
-			     << "encountered invalid iterator in queue."
+			     << "encountered invalid index in queue."
 			     << endl;
 			return -1;
 		}
 
 		/* check if we've already flipped this node */
-		if(it->first->data == NULL)
+		node = this->nodes[i];
+		if(node->data == NULL)
 			continue;
-		if(this->node_is_interior(it->first) != current_in)
+		if(this->node_is_interior(node) != current_in)
 			continue; /* already flipped */
 
 		/* get this node's total surface area */
-		myarea = it->first->surface_area();
+		myarea = node->surface_area();
 
-		/* get this node's neighbors */
-		ns.clear();
+		/* get this node's neighbors, which are stored
+		 * contiguously for all faces, and sort each face */
+		base = this->offsets[NUM_FACES_PER_CUBE*i];
+		ns.assign(this->edges.begin() + base, this->edges.begin()
+				+ this->offsets[NUM_FACES_PER_CUBE*(i+1)]);
 		for(fi = 0; fi < NUM_FACES_PER_CUBE; fi++)
-			it->second.get(all_cube_faces[fi], ns);
+			sort(ns.begin() + (this->offsets[
+					NUM_FACES_PER_CUBE*i + fi] - base),
+				ns.begin() + (this->offsets[
+					NUM_FACES_PER_CUBE*i + fi + 1] - base));
+		num_neighs = ns.size();
 
 		/* iterate through the neighbors, looking for nodes
 		 * whose flags disagree with the current node's flag.
 		 *
 		 * If there are a sufficient number of disagreeing
 		 * neighbors, then this node is an outlier. */
-		num_neighs = ns.size();
 		count = 0;
 		for(ni = 0; ni < num_neighs; ni++)
 			if(this->node_is_interior(ns[ni]) != current_in)
@@ -289,7 +566,7 @@ int octtopo_t::remove_outliers(double neigh_thresh)
 				 * with the current node, so count
 				 * its shared area towards the total */
 				neigharea = min(ns[ni]->halfwidth,
-						it->first->halfwidth);
+						node->halfwidth);
 				neigharea = 4*neigharea*neigharea;
 
 				/* weight this neighbor's vote based
@@ -303,15 +580,14 @@ int octtopo_t::remove_outliers(double neigh_thresh)
 			continue; /* not an outlier */
 
 		/* This node is an outlier, so we want to flip it. */
-		it->first->data->flip();
+		node->data->flip();
 
 		/* We also want to then double-check all its 
 		 * neighbors that used to agree (and now disagree),
 		 * since they may be outliers, too. */
 		for(ni = 0; ni < num_neighs; ni++)
 			if(this->node_is_interior(ns[ni]) == current_in)
-				in_to_check.push(
-					this->neighs.find(ns[ni]));
+				in_to_check.push(this->find(ns[ni]));
 	}
 	
 	/* success */
@@ -336,9 +612,9 @@ bool octtopo_t::node_is_interior(octnode_t* node)
 			
 int octtopo_t::writeobj(const string& filename) const
 {
-	map<octnode_t*, octneighbors_t>::const_iterator it;
-	vector<octnode_t*> ns;
-	vector<octnode_t*>::iterator nit;
+	octneighbors_t edges;
+	octnode_t* node;
+	octnode_t* const* nit;
 	Vector3d p;
 	ofstream outfile;
 	progress_bar_t progbar;
@@ -354,32 +630,32 @@ int octtopo_t::writeobj(const string& filename) const
 	outfile << "# This file auto-generated by Eric Turner's" << endl
 	        << "# geometry code for UC Berkeley's VIP Lab."
 		<< "#" << endl
-		<< "# The original octree had " << this->neighs.size()
+		<< "# The original octree had " << this->nodes.size()
 		<< " nodes." << endl
 	        << endl << endl;
 
 	/* iterate through the nodes */
 	progbar.set_name("Exporting OBJ");
-	n = this->neighs.size(); i = 0;
-	for(it = this->neighs.begin(); it != this->neighs.end(); it++)
+	n = this->nodes.size();
+	for(i = 0; i < n; i++)
 	{
 		/* inform user of progress */
-		progbar.update(i++, n);
+		progbar.update(i, n);
 
 		/* only proceed if interior */
-		if(!(this->node_is_interior(it->first)))
+		node = this->nodes[i];
+		if(!(this->node_is_interior(node)))
 			continue;
 
 		/* iterate over faces, looking for exterior neighbors */
-		hw = it->first->halfwidth;
+		hw = node->halfwidth;
+		this->get_neighbors(i, edges);
 		for(fi = 0; fi < NUM_FACES_PER_CUBE; fi++)
 		{
-			/* get nodes neighboring on this face */
-			ns.clear();
-			it->second.get(all_cube_faces[fi], ns);
-
-			/* check for external nodes */
-			for(nit = ns.begin(); nit != ns.end(); nit++)
+			/* check nodes neighboring on this face
+			 * for external nodes */
+			for(nit = edges.begin(all_cube_faces[fi]);
+				nit != edges.end(all_cube_faces[fi]); nit++)
 			{
 				/* record neighbor's surface area */
 				other_hw = (*nit)->halfwidth;
@@ -395,15 +671,14 @@ int octtopo_t::writeobj(const string& filename) const
 						get_opposing_face(
 						all_cube_faces[fi]), false);
 				else
-					this->writeobjface(outfile, 
-						it->first, 
+					this->writeobjface(outfile, node,
 						all_cube_faces[fi], true);
 			}
 
 			/* check if it is an interior node against 
 			 * null space */
-			if(ns.empty())
-				this->writeobjface(outfile, it->first,
+			if(edges.size(all_cube_faces[fi]) == 0)
+				this->writeobjface(outfile, node,
 					all_cube_faces[fi], true);
 		}
 	}
@@ -572,243 +847,136 @@ void octtopo_t::writeobjface(ostream& os, octnode_t* n,
 		os << "f -4 -3 -2 -1" << endl;
 }
 
-void octtopo_t::init_children(octnode_t* node)
+void octtopo_t::init_children(octnode_t* node,
+		octnode_t* const uncles[NUM_FACES_PER_CUBE],
+		vector<octnode_t*>& nodes, vector<size_t>& offsets,
+		vector<octnode_t*>& edges)
 {
-	octneighbors_t ns[CHILDREN_PER_NODE];
-	octnode_t* uncles[NUM_FACES_PER_CUBE];
-	octnode_t* cousins[CHILDREN_PER_NODE];
-	unsigned int i;
+	octnode_t* ns[NUM_FACES_PER_CUBE];
+	size_t i, fi;
 
-	/* only need to process if given node is non-leaf */
+	/* leaf nodes are stored, along with the leaves that touch
+	 * each of their faces */
 	if(node->isleaf())
+	{
+		nodes.push_back(node);
+		for(fi = 0; fi < NUM_FACES_PER_CUBE; fi++)
+		{
+			/* the neighbor on this level is either null,
+			 * a leaf, or the root of a subtree whose
+			 * leaves on the opposing face are neighbors */
+			if(uncles[fi] != NULL)
+				octtopo_t::get_face_leaves(edges, uncles[fi],
+					get_opposing_face(all_cube_faces[fi]));
+			offsets.push_back(edges.size());
+		}
 		return;
+	}
 
-	/* get all existing neighbors of current node */
-	this->neighs[node].get_singletons(uncles);
-
-	/* each child of this node must be added as a special case,
-	 * based on the relative position of the child with respect to
-	 * the other nodes in play (which includes children of the current
-	 * node's neighbors).
-	 *
-	 * The ordering of octnodes can be found here 
-	 * (taken from octnode.h):
-	 * 
-	 * 		y
-	 *              ^
-	 *       1      |      0
-	 *              |
-	 * -------------+-------------> x	(top, z+)
-	 *              |
-	 *       2      |      3
-	 *              |
-	 *
-	 * 		y
-	 *              ^
-	 *       5      |      4
-	 *              |
-	 * -------------+-------------> x	(bottom, z-)
-	 *              |
-	 *       6      |      7
-	 *              |
-	 */
-
-	/* internal linkages of this node's children */
-
-	/* top level */
-	ns[0].add(node->children[1], FACE_XMINUS);
-	ns[1].add(node->children[0], FACE_XPLUS);
-	ns[1].add(node->children[2], FACE_YMINUS);
-	ns[2].add(node->children[1], FACE_YPLUS);
-	ns[2].add(node->children[3], FACE_XPLUS);
-	ns[3].add(node->children[2], FACE_XMINUS);
-	ns[3].add(node->children[0], FACE_YPLUS);
-	ns[0].add(node->children[3], FACE_YMINUS);
-	
-	/* bottom level */
-	ns[4].add(node->children[5], FACE_XMINUS);
-	ns[5].add(node->children[4], FACE_XPLUS);
-	ns[5].add(node->children[6], FACE_YMINUS);
-	ns[6].add(node->children[5], FACE_YPLUS);
-	ns[6].add(node->children[7], FACE_XPLUS);
-	ns[7].add(node->children[6], FACE_XMINUS);
-	ns[7].add(node->children[4], FACE_YPLUS);
-	ns[4].add(node->children[7], FACE_YMINUS);
-
-	/* up-down */
-	ns[0].add(node->children[4], FACE_ZMINUS);
-	ns[1].add(node->children[5], FACE_ZMINUS);
-	ns[2].add(node->children[6], FACE_ZMINUS);
-	ns[3].add(node->children[7], FACE_ZMINUS);
-	ns[4].add(node->children[0], FACE_ZPLUS);
-	ns[5].add(node->children[1], FACE_ZPLUS);
-	ns[6].add(node->children[2], FACE_ZPLUS);
-	ns[7].add(node->children[3], FACE_ZPLUS);
-
-	/* external linkages to other nodes on current level */
-	
-	/* cousins x-plus */
-	octtopo_t::get_children_of(cousins, uncles[FACE_XPLUS]);
-	ns[0].add(cousins[1], FACE_XPLUS);
-	ns[3].add(cousins[2], FACE_XPLUS);
-	ns[4].add(cousins[5], FACE_XPLUS);
-	ns[7].add(cousins[6], FACE_XPLUS);
-
-	/* cousins x-minus */
-	octtopo_t::get_children_of(cousins, uncles[FACE_XMINUS]);
-	ns[1].add(cousins[0], FACE_XMINUS);
-	ns[2].add(cousins[3], FACE_XMINUS);
-	ns[5].add(cousins[4], FACE_XMINUS);
-	ns[6].add(cousins[7], FACE_XMINUS);
-	
-	/* cousins y-plus */
-	octtopo_t::get_children_of(cousins, uncles[FACE_YPLUS]);
-	ns[0].add(cousins[3], FACE_YPLUS);
-	ns[1].add(cousins[2], FACE_YPLUS);
-	ns[4].add(cousins[7], FACE_YPLUS);
-	ns[5].add(cousins[6], FACE_YPLUS);
-	
-	/* cousins y-minus */
-	octtopo_t::get_children_of(cousins, uncles[FACE_YMINUS]);
-	ns[3].add(cousins[0], FACE_YMINUS);
-	ns[2].add(cousins[1], FACE_YMINUS);
-	ns[7].add(cousins[4], FACE_YMINUS);
-	ns[6].add(cousins[5], FACE_YMINUS);
-	
-	/* cousins z-plus */
-	octtopo_t::get_children_of(cousins, uncles[FACE_ZPLUS]);
-	ns[0].add(cousins[4], FACE_ZPLUS);
-	ns[1].add(cousins[5], FACE_ZPLUS);
-	ns[2].add(cousins[6], FACE_ZPLUS);
-	ns[3].add(cousins[7], FACE_ZPLUS);
-	
-	/* cousins z-minus */
-	octtopo_t::get_children_of(cousins, uncles[FACE_ZMINUS]);
-	ns[4].add(cousins[0], FACE_ZMINUS);
-	ns[5].add(cousins[1], FACE_ZMINUS);
-	ns[6].add(cousins[2], FACE_ZMINUS);
-	ns[7].add(cousins[3], FACE_ZMINUS);
-
-	/* For each child, check if it exists and pair it appropriately
-	 * with the populated neighbor object
-	 */
+	/* recurse through each child of this node */
 	for(i = 0; i < CHILDREN_PER_NODE; i++)
 	{
 		/* check if exists */
 		if(node->children[i] == NULL)
 			continue; /* move on to next child */
 
-		/* aggressively add this child into neighbor map */
-		this->neighs[node->children[i]] = ns[i];
-	
-		/* recurse */
-		this->init_children(node->children[i]);
+		/* populate the neighbors of this child and recurse */
+		octtopo_t::get_child_neighbors(node, uncles, i, ns);
+		octtopo_t::init_children(node->children[i], ns,
+				nodes, offsets, edges);
 	}
 }
-			
-void octtopo_t::get_children_of(octnode_t* cs[CHILDREN_PER_NODE], 
-					octnode_t* p)
-{
-	bool isleaf;
-	size_t i;
 
-	/* iterate over child pointers */
-	isleaf = (p == NULL || p->isleaf());
-	for(i = 0; i < CHILDREN_PER_NODE; i++)
+void octtopo_t::get_child_neighbors(octnode_t* node,
+		octnode_t* const uncles[NUM_FACES_PER_CUBE],
+		size_t i, octnode_t* ns[NUM_FACES_PER_CUBE])
+{
+	size_t j, fi;
+	CUBE_FACE f;
+
+	/* each child of this node neighbors either one of its siblings,
+	 * or one of the children of this node's neighbor on the same
+	 * level (its cousin).  Either way, the neighbor is the mirror
+	 * image of the child across that face.  If the neighbor of this
+	 * node is a leaf, then it is also the neighbor of the child. */
+	for(fi = 0; fi < NUM_FACES_PER_CUBE; fi++)
 	{
-		/* check if no children exist */
-		if(isleaf)
-			cs[i] = p; /* store parent */
-		else /* at least some children exist */
-			cs[i] = p->children[i]; /* store child */
+		f = all_cube_faces[fi];
+		j = mirror_child(i, f);
+		if(!child_on_face(i, f))
+			ns[fi] = node->children[j]; /* sibling */
+		else if(uncles[fi] == NULL || uncles[fi]->isleaf())
+			ns[fi] = uncles[fi]; /* uncle */
+		else
+			ns[fi] = uncles[fi]->children[j]; /* cousin */
 	}
 }
 			
-int octtopo_t::remove_nonleafs()
+void octtopo_t::get_face_leaves(vector<octnode_t*>& leaves,
+                                octnode_t* node, CUBE_FACE f)
 {
-	map<octnode_t*, octneighbors_t>::iterator it, nit;
-	set<octnode_t*> to_remove;
-	set<octnode_t*>::iterator sit;
-	CUBE_FACE face, opp;
-	size_t fi;
-	bool isleaf;
+	size_t i;
 
-	/* iterate through the neighbors, removing references to non-leafs
-	 * and verifying that references between leafs are bidirectional */
-	for(it = this->neighs.begin(); it != this->neighs.end(); it++)
+	/* leaves are their own face */
+	if(node->isleaf())
 	{
-		/* check if this node is a leaf */
-		isleaf = it->first->isleaf();
-
-		/* we will want to remove this node */
-		if(!isleaf)
-			to_remove.insert(it->first);
-		
-		/* iterate through the neighbors of the 
-		 * current node */
-		for(fi = 0; fi < NUM_FACES_PER_CUBE; fi++)
-		{
-			/* iterate through neighbors on this face */
-			face = all_cube_faces[fi];
-			for(sit = it->second.neighs[face].begin();
-				sit != it->second.neighs[face].end(); sit++)
-			{
-				/* get neighbor */
-				nit = this->neighs.find(*sit);
-				if(nit == this->neighs.end())
-					return -1; /* ERROR */
-
-				/* this neighbor's reference of the
-				 * current node should be on the opposing
-				 * face */
-				opp = get_opposing_face(face);
-
-				/* if the current node is a leaf, we want
-				 * to keep it and add a reference to its
-				 * neighbor.  if the current node is not
-				 * a leaf, then we want to remove it and
-				 * remove any references from the neighbor
-				 */
-				if(isleaf)
-					nit->second.add(it->first, opp);
-				else
-					nit->second.remove(it->first, opp);
-
-			}
-		}
+		leaves.push_back(node);
+		return;
 	}
 
-	/* remove the non-leaf nodes in the map */
-	for(sit = to_remove.begin(); sit != to_remove.end(); sit++)
-		this->neighs.erase(*sit);
-	to_remove.clear();
+	/* recurse on the children that touch this face */
+	for(i = 0; i < CHILDREN_PER_NODE; i++)
+		if(node->children[i] != NULL && child_on_face(i, f))
+			octtopo_t::get_face_leaves(leaves,
+					node->children[i], f);
+}
 
-	/* success */
-	return 0;
+void octtopo_t::build_hash()
+{
+	size_t i, h, mask, n;
+
+	/* size the table to be at most half full */
+	n = this->nodes.size();
+	this->hash_bits = MIN_HASH_BITS;
+	while((((size_t) 1) << this->hash_bits) < 2*n)
+		this->hash_bits++;
+	this->hash_keys.assign(((size_t) 1) << this->hash_bits, NULL);
+	this->hash_vals.resize(this->hash_keys.size());
+
+	/* insert each node, linearly probing on collisions */
+	mask = this->hash_keys.size() - 1;
+	for(i = 0; i < n; i++)
+	{
+		h = hash_node(this->nodes[i], this->hash_bits);
+		while(this->hash_keys[h] != NULL)
+			h = (h + 1) & mask;
+		this->hash_keys[h] = this->nodes[i];
+		this->hash_vals[h] = i;
+	}
 }
 			
 int octtopo_t::verify() const
 {
-	map<octnode_t*, octneighbors_t>::const_iterator it, opp_it;
-	vector<octnode_t*> ns, ns_opp;
-	vector<octnode_t*>::iterator nit;
+	octneighbors_t edges, opp_edges;
+	octnode_t* const* nit;
 	octnode_t* curr, *neigh;
 	double width_sum, dist;
 	CUBE_FACE opp;
-	size_t i;
+	size_t i, j, k;
 	int ret;
 
-	if(this->neighs.empty())
+	if(this->nodes.empty())
 	{
 		/* not an error, but make a note */
 		cerr << "[octtopo_t::verify]\tWARNING: empty map" << endl;
 	}
 
 	/* iterate over each node in the map */
-	for(it = this->neighs.begin(); it != this->neighs.end(); it++)
+	for(j = 0; j < this->nodes.size(); j++)
 	{
 		/* check for null nodes */
-		if(it->first == NULL)
+		curr = this->nodes[j];
+		if(curr == NULL)
 		{
 			/* notify user of error */
 			ret = -1;
@@ -817,29 +985,25 @@ int octtopo_t::verify() const
 			return ret;
 		}
 
+		/* only leaf nodes are stored */
+		if(!(curr->isleaf()))
+		{
+			/* notify user of error */
+			ret = -2;
+			cerr << "[octtopo_t::verify]\tERROR " << ret << ": "
+			     << "Encountered non-leaf node " << curr
+			     << endl;
+			return ret;
+		}
+
 		/* iterate over faces of current node */
+		this->get_neighbors(j, edges);
 		for(i = 0; i < NUM_FACES_PER_CUBE; i++)
 		{
-			/* get neighbors on this face */
-			ns.clear(); it->second.get(all_cube_faces[i], ns);
-
-			/* check for non-singletons */
-			if(ns.size() > 1 && !(it->first->isleaf()))
-			{
-				/* notify user of error */
-				ret = -2;
-				cerr << "[octtopo_t::verify]\t"
-				     << "ERROR " << ret << ": "
-				     << "Encountered " << ns.size() << " "
-				     << "neighbors on face "
-				     << all_cube_faces[i]
-				     << " of node " << it->first << endl;
-				return ret;
-			}
-			
 			/* iterate over neighbors on this face */
 			opp = get_opposing_face(all_cube_faces[i]);
-			for(nit = ns.begin(); nit != ns.end(); nit++)
+			for(nit = edges.begin(all_cube_faces[i]);
+				nit != edges.end(all_cube_faces[i]); nit++)
 			{
 				/* make sure not null */
 				if(*nit == NULL)
@@ -848,7 +1012,7 @@ int octtopo_t::verify() const
 					ret = -3;
 					cerr << "[octtopo_t::verify]\t"
 					     << "ERROR " << ret << ": "
-					     << (it->first) << " has null "
+					     << curr << " has null "
 					     << "neighbor on "
 					     << all_cube_faces[i]
 					     << endl;
@@ -856,7 +1020,7 @@ int octtopo_t::verify() const
 				}
 
 				/* make sure we have no autoloops */
-				if(*nit == it->first)
+				if(*nit == curr)
 				{
 					/* notify user of error */
 					ret = -4;
@@ -871,8 +1035,8 @@ int octtopo_t::verify() const
 
 				/* get neighbor's neighbors, and check
 				 * if current node is among them */
-				opp_it = this->neighs.find(*nit);
-				if(opp_it == this->neighs.end())
+				k = this->find(*nit);
+				if(k >= this->nodes.size())
 				{
 					/* notify user of error */
 					ret = -5;
@@ -880,29 +1044,27 @@ int octtopo_t::verify() const
 					     << "ERROR " << ret << ": "
 					     << (*nit) << " not in map "
 					     << "even though "
-					     << it->first << " thinks it "
+					     << curr << " thinks it "
 					     << "neighbors on "
 					     << all_cube_faces[i]
 					     << endl;
 					return ret;
 				}
 
-				ns_opp.clear(); opp_it->second.get(opp,
-								ns_opp);
-				if(find(ns_opp.begin(), ns_opp.end(), 
-						it->first) == ns_opp.end())
+				this->get_neighbors(k, opp_edges);
+				if(!(opp_edges.contains(curr, opp)))
 				{
 					/* notify user of error */
 					ret = -6;
 					cerr << "[octtopo_t::verify]\t"
 					     << "ERROR " << ret << ": "
-					     << it->first << " claims "
+					     << curr << " claims "
 					     << "neighbor on "
 					     << all_cube_faces[i]
 					     << " is " << (*nit) << " but "
 					     << " this node's neighbors "
 					     << "on " << opp << " does not "
-					     << "show " << it->first
+					     << "show " << curr
 					     << endl;
 					return ret;
 				}
@@ -910,8 +1072,7 @@ int octtopo_t::verify() const
 				/* check that these nodes are geometrically
 				 * touching, by comparing their displacement
 				 * with their widths */
-				curr = it->first;
-				neigh = opp_it->first;
+				neigh = this->nodes[k];
 				width_sum = curr->halfwidth
 						+ neigh->halfwidth;
 				dist = 0;
@@ -24,8 +24,7 @@
 #include <iostream>
 #include <string>
 #include <vector>
-#include <set>
-#include <map>
+#include <utility>
 
 /**
  * This namespace contains all classes and definitions for node topology
@@ -125,6 +124,11 @@ namespace octtopo
 	
 	/**
 	 * The octneighbors_t class represents neighbors of a single octnode
+	 *
+	 * This object is a lightweight view into the neighbor lists
+	 * stored in an octtopo_t.  It does not own any memory, so it
+	 * is cheap to copy, but it is only valid as long as the
+	 * topology that populated it is unmodified.
 	 */
 	class octneighbors_t
 	{
@@ -135,9 +139,12 @@ namespace octtopo
 		private:
 
 			/**
-			 * Stores the neighboring nodes to this node
+			 * The neighboring nodes on each face, stored
+			 * as the range [first[f], last[f]) of the
+			 * neighbor list of the originating topology
 			 */
-			std::set<octnode_t*> neighs[NUM_FACES_PER_CUBE];
+			octnode_t* const* first[NUM_FACES_PER_CUBE];
+			octnode_t* const* last[NUM_FACES_PER_CUBE];
 			
 		/* functions */
 		public:
@@ -147,16 +154,10 @@ namespace octtopo
 			/*--------------*/
 
 			/**
-			 * Default constructor
+			 * Default constructor, which has no neighbors
 			 */
 			octneighbors_t();
 
-			/**
-			 * Constructs this object from given octneighbors_t
-			 */
-			octneighbors_t(
-				const octtopo::octneighbors_t& other);
-
 			/*-----------*/
 			/* modifiers */
 			/*-----------*/
@@ -166,55 +167,39 @@ namespace octtopo
 			 */
 			void clear();
 
+			/*-----------*/
+			/* accessors */
+			/*-----------*/
+
 			/**
-			 * Adds a neighbor to this structure
+			 * Gets the start of the neighbors on a face
 			 *
-			 * Given a neighbor and a face direction, will
-			 * store the neighbor appropriately in this object.
+			 * @param f   The face to analyze
 			 *
-			 * @param n   The neighboring node to store
-			 * @param f   The face on which n neighbors
+			 * @return    Returns pointer to first neighbor
 			 */
-			inline void add(octnode_t* n, CUBE_FACE f)
-			{
-				/* ignore if pointer is null */
-				if(n != NULL)
-					this->neighs[f].insert(n);
-			};
+			inline octnode_t* const* begin(CUBE_FACE f) const
+			{ return this->first[f]; };
 
 			/**
-			 * Adds all neighbors to this structure
+			 * Gets the end of the neighbors on a face
 			 *
-			 * Given a list of neighbors and a face direction,
-			 * will store the neighbors appropriately in this
-			 * object.
+			 * @param f   The face to analyze
 			 *
-			 * @param ns  The neighboring nodes to store
-			 * @param f   The face on which ns neighbor
+			 * @return    Returns pointer past last neighbor
 			 */
-			void add_all(const std::vector<octnode_t*>& ns,
-			             CUBE_FACE f);
+			inline octnode_t* const* end(CUBE_FACE f) const
+			{ return this->last[f]; };
 
 			/**
-			 * Removes neighbor from this structure
-			 *
-			 * Given a neighbor node and a face, will
-			 * remove this neighbor from this face.
+			 * Gets the number of neighbors on a face
 			 *
-			 * @param n   The node to remove
-			 * @param f   The face on which n neighbors
+			 * @param f   The face to analyze
 			 *
-			 * @return    Returns true if it was removed,
-			 *            false if never there to begin with
+			 * @return    Returns the number of neighbors on f
 			 */
-			inline bool remove(octnode_t* n, CUBE_FACE f)
-			{
-				return (0 < this->neighs[f].erase(n));
-			};
-
-			/*-----------*/
-			/* accessors */
-			/*-----------*/
+			inline size_t size(CUBE_FACE f) const
+			{ return (this->last[f] - this->first[f]); };
 
 			/**
 			 * Gets the neighbors for a particular face
@@ -232,17 +217,25 @@ namespace octtopo
 					std::vector<octnode_t*>& ns) const
 			{ 
 				ns.insert(ns.end(), 
-					this->neighs[f].begin(), 
-					this->neighs[f].end());
+					this->first[f], 
+					this->last[f]);
 			};
 
+			/**
+			 * Checks if a node neighbors on a given face
+			 *
+			 * @param n   The node to search for
+			 * @param f   The face to search
+			 *
+			 * @return    Returns true iff n is a neighbor on f
+			 */
+			bool contains(octnode_t* n, CUBE_FACE f) const;
+
 			/**
 			 * Gets all 'singleton' neighbors
 			 *
 			 * A singleton neighbor is one where there is
-			 * exactly one neighbor on a given face.  Any
-			 * non-leaf node should have all its neighbors
-			 * as singletons (assuming the neighbors exist).
+			 * exactly one neighbor on a given face.
 			 *
 			 * Here, if a neighbor is non-singleton (either
 			 * because there are multiple neighbors on a face
@@ -254,54 +247,166 @@ namespace octtopo
 			 */
 			void get_singletons(
 				octnode_t* ns[NUM_FACES_PER_CUBE]) const;
-
-			/*-----------*/
-			/* operators */
-			/*-----------*/
-
-			/**
-			 * Copies values from given neighbor object to this
-			 *
-			 * Will destroy any existing info in this object
-			 * and replace it with a copy of the info in the
-			 * given octneighbors_t object.
-			 *
-			 * @param other   The object to copy
-			 *
-			 * @return        A reference to the modified object
-			 */
-			octneighbors_t& operator = 
-					(const octneighbors_t& other);
 	};
 
 	/**
 	 * The octtopo_t class represents the octnodes' neighbor topology
+	 *
+	 * Only the leaf nodes of the tree are stored.  Each leaf is
+	 * given a dense index, and the neighbors of all leaves are
+	 * packed into a single array, so that the neighbors of the i'th
+	 * node on face f are a contiguous range of that array.  A hash
+	 * table maps node pointers to their indices.
 	 */
 	class octtopo_t
 	{
+		/* types */
+		public:
+
+			/**
+			 * Iterates over the nodes of this topology
+			 *
+			 * Each referenced element is a pair, where a
+			 * pointer to the given octnode is the first
+			 * value, and the neighbor-structure for that
+			 * node is the second element.
+			 */
+			class const_iterator
+			{
+				/* security */
+				friend class octtopo_t;
+
+				/* parameters */
+				private:
+
+					/* the topology being iterated */
+					const octtopo_t* topo;
+
+					/* the index of the current node */
+					size_t index;
+
+					/* the current element */
+					std::pair<octnode_t*,
+						octneighbors_t> value;
+
+				/* functions */
+				private:
+
+					/**
+					 * Constructs iterator at given index
+					 */
+					const_iterator(const octtopo_t* t,
+					               size_t i);
+
+					/**
+					 * Populates the current element
+					 */
+					void update();
+
+				public:
+
+					/**
+					 * Constructs invalid iterator
+					 */
+					const_iterator() : topo(NULL), index(0)
+					{};
+
+					/* operators */
+
+					inline const std::pair<octnode_t*,
+						octneighbors_t>&
+							operator*() const
+					{ return this->value; };
+
+					inline const std::pair<octnode_t*,
+						octneighbors_t>*
+							operator->() const
+					{ return &(this->value); };
+
+					inline const_iterator& operator++()
+					{
+						this->index++;
+						this->update();
+						return (*this);
+					};
+
+					inline const_iterator operator++(int)
+					{
+						const_iterator prev(*this);
+						++(*this);
+						return prev;
+					};
+
+					inline bool operator == (
+						const const_iterator& o) const
+					{
+						return (this->index == o.index
+							&& this->topo
+							== o.topo);
+					};
+
+					inline bool operator != (
+						const const_iterator& o) const
+					{ return !((*this) == o); };
+			};
+
 		/* parameters */
 		private:
 	
 			/**
-			 * A mapping between octnodes and their neighbors
+			 * The leaf nodes of the tree, in depth-first
+			 * order.  A node's position in this list is
+			 * its index.
+			 */
+			std::vector<octnode_t*> nodes;
+
+			/**
+			 * The neighbors of the i'th node on face f are
+			 * the elements in the range:
+			 *
+			 * 	[offsets[6*i + f], offsets[6*i + f + 1])
+			 *
+			 * of the edges list.
+			 */
+			std::vector<size_t> offsets;
+			std::vector<octnode_t*> edges;
+
+			/**
+			 * An open-addressed hash table that maps node
+			 * pointers to their indices.  Its size is a power
+			 * of two, and empty slots have null keys.
 			 */
-			std::map<octnode_t*, octneighbors_t> neighs;
+			std::vector<octnode_t*> hash_keys;
+			std::vector<size_t> hash_vals;
+			unsigned int hash_bits;
 
 		/* functions */
 		public:
 
+			/**
+			 * Constructs an empty topology
+			 */
+			octtopo_t() : hash_bits(0) {};
+
 			/**
 			 * Initializes this structure from the given octree
 			 *
 			 * Based on the given tree, will initialize all
 			 * nodes' neighbor sets.
 			 *
-			 * @param tree   The tree to use to initialize
+			 * The subtrees of the octree are processed in
+			 * parallel, and the result does not depend on
+			 * the number of threads used.
+			 *
+			 * @param tree         The tree to use to initialize
+			 * @param num_threads  The number of threads to use.
+			 *                     If zero, will use all cores.
 			 *
 			 * @return     Returns zero on success, non-zero
 			 *             on failure.
 			 */
-			int init(const octree_t& tree);
+			int init(const octree_t& tree,
+			         unsigned int num_threads=0);
 
 			/**
 			 * Retrieves the begin iterator for the stored nodes
@@ -309,17 +414,10 @@ namespace octtopo
 			 * Will return an iterator to the first node
 			 * neighbor object stored in this structure.
 			 *
-			 * Each referenced element is a pair, where a
-			 * pointer to the given octnode is the first
-			 * value, and the neighbor-structure for that
-			 * node is the second element.
-			 *
 			 * @return   Returns first iterator in structure
 			 */
-			inline std::map<octnode_t*,
-				octneighbors_t>::const_iterator
-					begin() const
-			{ return this->neighs.begin(); };
+			inline const_iterator begin() const
+			{ return const_iterator(this, 0); };
 
 			/**
 			 * Retrieves the end iterator for the stored nodes
@@ -329,22 +427,29 @@ namespace octtopo
 			 *
 			 * @return   Returns the end iterator of structure
 			 */
-			inline std::map<octnode_t*,
-			       octneighbors_t>::const_iterator
-				       end() const
-			{ return this->neighs.end(); };
+			inline const_iterator end() const
+			{ return const_iterator(this, this->nodes.size()); };
 
 			/**
 			 * Clears all information from this structure
 			 */
-			inline void clear()
-			{ this->neighs.clear(); };
+			void clear();
 
 			/**
 			 * Returns the number of nodes in this topology
 			 */
 			inline size_t size() const
-			{ return this->neighs.size(); };
+			{ return this->nodes.size(); };
+
+			/**
+			 * Finds the index of a node in this topology
+			 *
+			 * @param node   The node to find
+			 *
+			 * @return   Returns the index of the node, or
+			 *           size() if the node is not present.
+			 */
+			size_t find(octnode_t* node) const;
 
 			/**
 			 * Checks if this topology contains a node
@@ -357,23 +462,27 @@ namespace octtopo
 			 * @return   Returns true iff contains node
 			 */
 			inline bool contains(octnode_t* node) const
-			{ return this->neighs.count(node); };
+			{ return (this->find(node) < this->nodes.size()); };
 
 			/**
-			 * Adds a node (and its edges) to this topology
+			 * Retrieves the node at the given index
 			 *
-			 * Given a node an its neighbors, will add to this
-			 * topology structure.
+			 * @param i   The index to retrieve, less than size()
 			 *
-			 * @param node     The octnode to add
-			 * @param neighs   The neighs to associate with node
+			 * @return    Returns the i'th node
+			 */
+			inline octnode_t* get_node(size_t i) const
+			{ return this->nodes[i]; };
+
+			/**
+			 * Retrieves the neighbors of the node at an index
 			 *
-			 * @return    Returns zero on success, non-zero on
-			 *            failure.  Failure occurs if the node
-			 *            is already present in the map.
+			 * @param i       The index of the node, less
+			 *                than size()
+			 * @param neighs  The neighbor structure to populate
 			 */
-			int add(octnode_t* node,
-			        const octneighbors_t& neighs);
+			void get_neighbors(size_t i,
+			                   octneighbors_t& neighs) const;
 
 			/**
 			 * Retrieves the neighbors structure for given node
@@ -490,45 +599,67 @@ namespace octtopo
 		private:
 
 			/**
-			 * Recursively initializes neighbors of children
-			 *
-			 * Given an octnode with valid neighbors in the
-			 * this->neighs map, will generate neighbor mappings
-			 * for the children of this node recursively.
-			 *
-			 * @param node   The node to analyze
+			 * Recursively initializes neighbors of leaf nodes
+			 *
+			 * Given an octnode and, for each of its faces,
+			 * the node on the same level that neighbors it
+			 * (or a leaf at a coarser level, or null), will
+			 * append the leaves of this node's subtree and
+			 * their neighbors to the given lists.
+			 *
+			 * The tree is only read, so separate subtrees
+			 * can be initialized concurrently.
+			 *
+			 * @param node     The node to analyze
+			 * @param uncles   The neighbors of node on each face
+			 * @param nodes    Where to append the leaves
+			 * @param offsets  Where to append the end of each
+			 *                 leaf's neighbors on each face
+			 *                 in the edges list
+			 * @param edges    Where to append the neighbors
 			 */
-			void init_children(octnode_t* node);
+			static void init_children(octnode_t* node,
+				octnode_t* const uncles[NUM_FACES_PER_CUBE],
+				std::vector<octnode_t*>& nodes,
+				std::vector<size_t>& offsets,
+				std::vector<octnode_t*>& edges);
 
 			/**
-			 * Retrieves nodes at child level given parent node
+			 * Gets the neighbors of a child node
 			 *
-			 * Given a node, will retrieve pointers to its
-			 * children.  If the parent node is a leaf, then
-			 * all child pointers will refer to the original
-			 * parent node.  If the parent node is null, then
-			 * the children will also be null.
+			 * Given a node, its neighbors on the same level,
+			 * and a child index, will determine the
+			 * neighbors of that child on its own level.
 			 *
-			 * @param cs   Where to store the child pointers
-			 * @param p    The parent node
+			 * @param node     The parent node
+			 * @param uncles   The neighbors of node on each face
+			 * @param i        The index of the child
+			 * @param ns       Where to store the neighbors of
+			 *                 the child on each face
 			 */
-			static void get_children_of(
-				octnode_t* cs[CHILDREN_PER_NODE], 
-				octnode_t* p);
+			static void get_child_neighbors(octnode_t* node,
+				octnode_t* const uncles[NUM_FACES_PER_CUBE],
+				size_t i, octnode_t* ns[NUM_FACES_PER_CUBE]);
 
 			/**
-			 * Removes all elements that do not represent leafs
+			 * Retrieves the leaves of a subtree along a face
 			 *
-			 * Will remove all neighbor objects from this
-			 * object's map that are not associated with leaf
-			 * nodes in the given tree.  This saves space,
-			 * since often we only care about the neighbor
-			 * relations on leaf nodes.
+			 * Given a node, will append to the list all leaf
+			 * nodes in its subtree that touch the given face
+			 * of the node.
 			 *
-			 * @return   Returns zero on success, non-zero on
-			 *           failure.
+			 * @param leaves   Where to append the leaves
+			 * @param node     The root of the subtree
+			 * @param f        The face to check
+			 */
+			static void get_face_leaves(
+				std::vector<octnode_t*>& leaves,
+				octnode_t* node, CUBE_FACE f);
+
+			/**
+			 * Populates the hash table from the node list
 			 */
-			int remove_nonleafs();
+			void build_hash();
 	
 			/*-----------*/
 			/* debugging */
@@ -72,6 +72,32 @@ class shape_t
 		virtual bool intersects(const Eigen::Vector3d& c,
 		                        double hw) const =0;
 
+		/**
+		 * Checks if this shape intersects a block of boxes
+		 *
+		 * Performs the same test as intersects() on each of
+		 * n boxes of the same size, such as the children of
+		 * an octnode.  Shapes that can share work between the
+		 * boxes should override this function.  By default,
+		 * it just calls intersects() on each box in order.
+		 *
+		 * @param n      The number of boxes
+		 * @param cs     The centers of the boxes
+		 * @param hw     The half-width of the boxes
+		 * @param hits   Where to store whether the shape
+		 *               intersects each box
+		 */
+		virtual void intersects_block(unsigned int n,
+		                              const Eigen::Vector3d* cs,
+		                              double hw, bool* hits) const
+		{
+			unsigned int i;
+
+			/* test each box individually */
+			for(i = 0; i < n; i++)
+				hits[i] = this->intersects(cs[i], hw);
+		};
+
 		/**
 		 * Will be called on leaf nodes this shape intersects
 		 *
@@ -94,6 +120,32 @@ class shape_t
 		virtual octdata_t* apply_to_leaf(const Eigen::Vector3d& c,
 		                                 double hw,
 		                                 octdata_t* d) =0;
+
+		/**
+		 * Will be called on a block of sibling leaf nodes
+		 *
+		 * This function performs the same operation as
+		 * apply_to_leaf() on each of n leaf nodes of the same
+		 * size, replacing each element of ds with the modified
+		 * data.  Shapes that can evaluate several locations
+		 * at once should override this function.  By default,
+		 * it just calls apply_to_leaf() on each node in order.
+		 *
+		 * @param n    The number of leaf nodes
+		 * @param cs   The center positions of the leaf nodes
+		 * @param hw   The half-width of the leaf nodes
+		 * @param ds   The original data of each node, can be null
+		 */
+		virtual void apply_to_leaves(unsigned int n,
+		                             const Eigen::Vector3d* cs,
+		                             double hw, octdata_t** ds)
+		{
+			unsigned int i;
+
+			/* apply to each leaf individually */
+			for(i = 0; i < n; i++)
+				ds[i] = this->apply_to_leaf(cs[i], hw, ds[i]);
+		};
 };
 
 #endif
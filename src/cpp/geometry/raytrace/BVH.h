@@ -0,0 +1,279 @@
+#ifndef H_BVH_H
+#define H_BVH_H
+
+/*
+	BVH.h
+
+	This header file defines a bounding volume hierarchy over a
+	triangle soup.  It has the same interface as OctTree, and is
+	used in its place to support ray tracing operations.
+
+	The hierarchy is built with the surface area heuristic, and
+	is stored in flat arrays: the nodes in depth-first order, and
+	the vertices of the triangles in the order of the leaves, so
+	that a traversal does not allocate memory or follow pointers.
+	The ray-triangle test is watertight, so rays never slip between
+	adjacent triangles of a closed mesh.
+
+	A built hierarchy can be saved to an index file, which later
+	runs can load by mapping it into memory instead of rebuilding
+	it.  A loaded BVH traces rays directly from the mapped arrays.
+*/
+
+/* includes */
+#include <vector>
+#include <string>
+#include <memory>
+#include <stdint.h>
+
+#include "Triangle3.h"
+
+/* Declare classess upfront */
+template<typename T> struct BVHNode;
+template<typename T> class BVH;
+
+/* The BVHNode structure, which is 32 bytes for floats */
+template<typename T>
+struct BVHNode
+{
+	// The bounds of all triangles in this node
+	T bmin[3];
+	T bmax[3];
+
+	// For a leaf, the index of its first triangle.  For an
+	// interior node, the index of its second child.  The first
+	// child always immediately follows its parent.
+	unsigned int offset;
+
+	// The number of triangles in a leaf, or zero for an
+	// interior node
+	unsigned short count;
+
+	// The axis along which an interior node was split
+	unsigned short axis;
+};
+
+/* include the helpers */
+#include "BVHHelper.h"
+#include "BVHFile.h"
+
+/* The BVH class implementation */
+template<typename T>
+class BVH
+{
+public:
+
+	/* enum that defines the default number of triangles per leaf */
+	enum {DEFAULT_LEAF_SIZE = 4};
+
+	/*
+	* Constructor
+	*
+	* The maximum leaf size is the most triangles stored in one
+	* leaf of the hierarchy.
+	*/
+	BVH(size_t max_leaf_size = DEFAULT_LEAF_SIZE)
+		: _max_leaf_size(max_leaf_size), _mapped(),
+		_mapped_triangles(NULL), _key(0) {};
+	BVH(const std::vector<Triangle3<T> >& triangles,
+		size_t max_leaf_size = DEFAULT_LEAF_SIZE)
+		: _max_leaf_size(max_leaf_size), _mapped(),
+		_mapped_triangles(NULL), _key(0)
+	{
+		rebuild(triangles);
+	}
+
+	/*
+	* Test if the tree is empty
+	*/
+	inline bool empty() const { return (num_nodes() == 0); };
+
+	/*
+	* Rebuild function.  Destroys the contents of the tree and rebuilds
+	* with the new geometry.
+	*
+	* Returns true if the tree was able to rebuild or false if it was
+	* not able to rebuild the tree
+	*/
+	inline bool rebuild(const std::vector<Triangle3<T> >& triangles)
+	{
+		_mapping.reset();
+		_key = 0;
+		_contents = triangles;
+		BVHHelper::build<T>(_contents, _max_leaf_size,
+			_nodes, _verts, _ids);
+		return !_nodes.empty();
+	}
+
+	/*
+	* Saves the hierarchy to an index file, which can be loaded
+	* by later runs.  The key is stored in the file, and should
+	* identify the geometry the hierarchy was built from.
+	*
+	* Returns true on success, false on failure.
+	*/
+	inline bool save(const std::string& filename,
+		uint64_t key = 0) const
+	{
+		return BVHFile::write<T>(filename, key, _max_leaf_size,
+			view(), num_triangles() ? &(triangle(0)) : NULL);
+	}
+
+	/*
+	* Loads a hierarchy from an index file written by save().
+	* The file is mapped into memory, and the hierarchy and its
+	* triangles are read from the mapping as they are used.
+	*
+	* Returns true on success.  If the file can't be mapped, or
+	* is not a valid index, false is returned and the contents
+	* of the tree are unchanged.
+	*/
+	inline bool load(const std::string& filename)
+	{
+		std::shared_ptr<BVHFile::mapping_t> mapping(
+			new BVHFile::mapping_t());
+		BVHFile::header_t header;
+		BVHHelper::tree_view_t<T> tree;
+		const Triangle3<T>* triangles;
+
+		/* map and validate the file */
+		if(!(mapping->open(filename)) || !(BVHFile::read<T>(
+				*mapping, header, tree, triangles)))
+			return false;
+
+		/* replace the contents with the mapped arrays */
+		std::vector<BVHNode<T> >().swap(_nodes);
+		std::vector<T>().swap(_verts);
+		std::vector<size_t>().swap(_ids);
+		std::vector<Triangle3<T> >().swap(_contents);
+		_mapping = mapping;
+		_mapped = tree;
+		_mapped_triangles = triangles;
+		_max_leaf_size = header.max_leaf_size;
+		_key = header.key;
+		return true;
+	}
+
+	/*
+	* Gets the key stored with a loaded index, or zero if this
+	* hierarchy was built
+	*/
+	inline uint64_t key() const
+		{ return _key; };
+
+	/*
+	*	Access triangle by number
+	*/
+	inline const Triangle3<T>& triangle(size_t i) const
+		{ return _mapping ? _mapped_triangles[i] : _contents[i]; };
+
+	/*
+	*	Get number of triangles
+	*/
+	inline size_t num_triangles() const
+		{return view().num_triangles;};
+
+	/*
+	*	Get number of nodes in the hierarchy
+	*/
+	inline size_t num_nodes() const
+		{return view().num_nodes;};
+
+	/*
+	* Ray trace the ray against the geometry stored in the BVH.
+	*
+	* This function returns false if it does not intersect any
+	* of the geometry in the model.  Otherwise, the closest
+	* intersection point and the id of the triangle hit are
+	* stored.  This function is safe to call from multiple
+	* threads at once.
+	*
+	*/
+	inline bool ray_trace(const T* origin,
+		const T* direction,
+		T* intersection,
+		size_t * id) const
+	{
+		return BVHHelper::ray_trace<T>(view(),
+			origin,
+			direction,
+			intersection,
+			id);
+	};
+
+	/*
+	* Ray trace a set of n rays, given as consecutive triples of
+	* origins and directions.
+	*
+	* The rays are traced in packets of BVHHelper::PACKET_SIZE,
+	* which is fastest when neighboring rays are coherent, such
+	* as the rays of a small tile of pixels.  For each ray, hits[i]
+	* is set to what ray_trace() would return, and on a hit the
+	* same intersection point and id are stored.  This function is
+	* safe to call from multiple threads at once.
+	*/
+	inline void ray_trace_packet(size_t n,
+		const T* origins,
+		const T* directions,
+		T* intersections,
+		size_t * ids,
+		bool * hits) const
+	{
+		BVHHelper::ray_trace_packet<T>(view(),
+			n,
+			origins,
+			directions,
+			intersections,
+			ids,
+			hits);
+	};
+
+private:
+
+	/*
+	* Gets the arrays of the hierarchy, which are either the
+	* arrays built by this object or those of a mapped index
+	*/
+	inline BVHHelper::tree_view_t<T> view() const
+	{
+		BVHHelper::tree_view_t<T> tree;
+
+		if(_mapping)
+			return _mapped;
+		tree.nodes = _nodes.empty() ? NULL : &(_nodes[0]);
+		tree.num_nodes = _nodes.size();
+		tree.verts = _verts.empty() ? NULL : &(_verts[0]);
+		tree.ids = _ids.empty() ? NULL : &(_ids[0]);
+		tree.num_triangles = _ids.size();
+		return tree;
+	};
+
+	// This is the maximal number of triangles in each leaf
+	size_t _max_leaf_size;
+
+	// These are the nodes of the hierarchy, in depth-first order
+	std::vector<BVHNode<T> > _nodes;
+
+	// These are the vertices of the triangles, nine values per
+	// triangle, in the order that they appear in the leaves
+	std::vector<T> _verts;
+
+	// These are the ids of the triangles, in the same order
+	std::vector<size_t> _ids;
+
+	// This is the internal list of the contents of the tree, in
+	// their original order
+	std::vector<Triangle3<T> > _contents;
+
+	// When the hierarchy is loaded from an index file, this is
+	// the mapping of the file, which is shared by all copies of
+	// this object, and these are the arrays within it
+	std::shared_ptr<BVHFile::mapping_t> _mapping;
+	BVHHelper::tree_view_t<T> _mapped;
+	const Triangle3<T>* _mapped_triangles;
+
+	// This is the key stored with a loaded index
+	uint64_t _key;
+};
+
+#endif
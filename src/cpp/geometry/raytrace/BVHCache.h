@@ -0,0 +1,175 @@
+#ifndef H_BVHCACHE_H
+#define H_BVHCACHE_H
+
+/*
+	BVHCache.h
+
+	This header file defines a cache of BVH index files, which lets
+	programs that trace the same mesh on every run skip reading the
+	mesh and building its hierarchy.
+
+	Each index is named by a key, which is a hash of the contents of
+	the mesh file and the parameters of the hierarchy.  A program
+	looks for the index of its key, and maps it if it exists and is
+	valid.  Otherwise, it builds the hierarchy from the mesh and saves
+	the index for later runs.  Since the key depends on the contents
+	of the mesh, an index is never used for a mesh that has changed.
+*/
+
+/* includes */
+#include <string>
+#include <sstream>
+#include <iomanip>
+#include <cstring>
+#include <stdint.h>
+
+#include "BVH.h"
+#include "BVHFile.h"
+
+namespace BVHCache
+{
+
+/*
+* Mixes one 8-byte word into a running hash.  Each word is scrambled
+* by multiplies and rotations before it is combined, as in the rounds
+* of MurmurHash3 and xxHash, so every bit of the word affects the low
+* and high bits of the hash alike.
+*/
+inline uint64_t mix_word(uint64_t hash, uint64_t word)
+{
+	const uint64_t C1 = 0x87c37b91114253d5ULL;
+	const uint64_t C2 = 0x4cf5ad432745937fULL;
+
+	word *= C1;
+	word = (word << 31) | (word >> 33);
+	word *= C2;
+	hash ^= word;
+	hash = (hash << 27) | (hash >> 37);
+	return hash * 5 + 0x52dce729;
+}
+
+/*
+* Finishes a hash, so that every input bit affects every output bit.
+* This is the 64-bit finalizer of MurmurHash3.
+*/
+inline uint64_t finish(uint64_t hash)
+{
+	hash ^= hash >> 33;
+	hash *= 0xff51afd7ed558ccdULL;
+	hash ^= hash >> 33;
+	hash *= 0xc4ceb9fe1a85ec53ULL;
+	hash ^= hash >> 33;
+	return hash;
+}
+
+/*
+* Computes a 64-bit hash of the contents of a file, which mixes in each
+* 8-byte word of the file, then the remaining bytes and the size.  The
+* file is mapped rather than read, so hashing a large mesh is limited
+* only by the speed of the disk.
+*
+* Returns true on success, false if the file can't be mapped.
+*/
+inline bool hash_file(const std::string& filename, uint64_t& hash)
+{
+	const uint64_t SEED = 14695981039346656037ULL;
+	BVHFile::mapping_t mapping;
+	uint64_t word;
+	size_t i;
+
+	/* map the file */
+	if(!(mapping.open(filename)))
+		return false;
+
+	/* hash the whole words, then the remaining bytes padded
+	 * with zeros, which the size tells apart from real zeros */
+	hash = SEED;
+	for(i = 0; i + sizeof(word) <= mapping.size; i += sizeof(word))
+	{
+		memcpy(&word, mapping.data + i, sizeof(word));
+		hash = mix_word(hash, word);
+	}
+	if(i < mapping.size)
+	{
+		word = 0;
+		memcpy(&word, mapping.data + i, mapping.size - i);
+		hash = mix_word(hash, word);
+	}
+	hash = finish(hash ^ (uint64_t) mapping.size);
+	return true;
+}
+
+/*
+* Computes the key of the index built from a mesh with the given hash,
+* which also depends on the leaf size, so that hierarchies built with
+* different parameters are stored separately
+*/
+inline uint64_t make_key(uint64_t mesh_hash, size_t max_leaf_size)
+{
+	return finish(mix_word(mesh_hash, (uint64_t) max_leaf_size));
+}
+
+/*
+* Gets the directory a mesh file is in, which is where its index is
+* cached unless another directory is given
+*/
+inline std::string default_dir(const std::string& meshfile)
+{
+	size_t pos;
+
+	pos = meshfile.find_last_of('/');
+	if(pos == std::string::npos)
+		return ".";
+	if(pos == 0)
+		return "/";
+	return meshfile.substr(0, pos);
+}
+
+/*
+* Gets the path of the index with the given key in a cache directory,
+* which is the key in hexadecimal with the .bvh extension
+*/
+inline std::string index_file(const std::string& cachedir, uint64_t key)
+{
+	std::stringstream ss;
+
+	if(!cachedir.empty())
+		ss << cachedir << '/';
+	ss << std::hex << std::setw(16) << std::setfill('0') << key
+		<< ".bvh";
+	return ss.str();
+}
+
+/*
+* Loads the index with the given key from the cache.  The index is
+* only used if it maps, is valid, and stores the same key.
+*
+* Returns true on success.  On failure, the tree is unchanged.
+*/
+template<typename T>
+bool load(BVH<T>& tree, const std::string& cachedir, uint64_t key)
+{
+	BVH<T> loaded;
+
+	if(!(loaded.load(index_file(cachedir, key)))
+			|| loaded.key() != key)
+		return false;
+	tree = loaded;
+	return true;
+}
+
+/*
+* Saves a built tree to the cache under the given key.  Any existing
+* index with the same key is replaced.
+*
+* Returns true on success, false on failure.
+*/
+template<typename T>
+bool save(const BVH<T>& tree, const std::string& cachedir, uint64_t key)
+{
+	return tree.save(index_file(cachedir, key), key);
+}
+
+}
+
+#endif
@@ -0,0 +1,340 @@
+#ifndef H_BVHFILE_H
+#define H_BVHFILE_H
+
+/*
+	BVHFile.h
+
+	This header file defines the index file of a BVH, which stores a
+	built hierarchy so that later runs can memory-map it instead of
+	rebuilding it from the mesh.  The arrays in the file have the same
+	layout as they do in memory, so a mapped index is ready to trace
+	as soon as it has been validated.
+
+	The format is described in:
+
+		docs/filetypes/bvh_file_format.txt
+*/
+
+/* includes */
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+#include <cstring>
+#include <stdint.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "Triangle3.h"
+#include "BVHHelper.h"
+
+/* the following defines are used for reading and writing files */
+#define BVHFILE_MAGIC_NUMBER     "bvhtree"
+#define BVHFILE_MAGIC_LENGTH     8
+#define BVHFILE_CURRENT_VERSION  1
+
+namespace BVHFile
+{
+
+/*
+* The alignment of each array in the file, in bytes
+*/
+enum {ALIGNMENT = 64};
+
+/*
+* The header at the start of the file, which is 64 bytes
+*/
+struct header_t
+{
+	char magic[BVHFILE_MAGIC_LENGTH];
+	uint32_t version;
+
+	// The sizes of the stored types, which must match the sizes
+	// of the types of the program that maps the file
+	uint32_t value_size;
+	uint32_t node_size;
+	uint32_t triangle_size;
+	uint32_t id_size;
+	uint32_t reserved;
+
+	// The key of the geometry the hierarchy was built from,
+	// which is chosen by the program that wrote it
+	uint64_t key;
+
+	// The parameters and sizes of the hierarchy
+	uint64_t max_leaf_size;
+	uint64_t num_nodes;
+	uint64_t num_triangles;
+};
+
+/*
+* Computes the locations and sizes of the arrays in a file with the
+* given header, which are the nodes, the vertices, the ids and the
+* triangles, and the total size of the file
+*/
+inline void layout(const header_t& h, uint64_t* offsets, uint64_t* sizes,
+	uint64_t& total)
+{
+	int i;
+
+	sizes[0] = h.num_nodes * h.node_size;
+	sizes[1] = 9 * h.num_triangles * h.value_size;
+	sizes[2] = h.num_triangles * h.id_size;
+	sizes[3] = h.num_triangles * h.triangle_size;
+	total = sizeof(header_t);
+	for(i = 0; i < 4; i++)
+	{
+		total = (total + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+		offsets[i] = total;
+		total += sizes[i];
+	}
+}
+
+/*
+* A read-only memory mapping of a whole file, which is unmapped when
+* this object is destroyed
+*/
+class mapping_t
+{
+public:
+
+	mapping_t() : data(NULL), size(0), _fd(-1) {};
+	~mapping_t() { close(); };
+
+	/*
+	* Maps the given file.  Pages are read from disk on demand.
+	*
+	* Returns true on success, false on failure.
+	*/
+	inline bool open(const std::string& filename)
+	{
+		struct stat st;
+		void* addr;
+
+		/* open the file and find its size */
+		close();
+		_fd = ::open(filename.c_str(), O_RDONLY);
+		if(_fd < 0 || fstat(_fd, &st) != 0 || st.st_size <= 0)
+		{
+			close();
+			return false;
+		}
+
+		/* map it into memory */
+		addr = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED,
+			_fd, 0);
+		if(addr == MAP_FAILED)
+		{
+			close();
+			return false;
+		}
+		data = (const char*) addr;
+		size = st.st_size;
+		return true;
+	};
+
+	/*
+	* Unmaps the file, if one is mapped
+	*/
+	inline void close()
+	{
+		if(data != NULL)
+			munmap((void*) data, size);
+		data = NULL;
+		size = 0;
+		if(_fd >= 0)
+			::close(_fd);
+		_fd = -1;
+	};
+
+	// The contents of the file
+	const char* data;
+	size_t size;
+
+private:
+
+	// The mapping owns its file, so it can't be copied
+	mapping_t(const mapping_t&);
+	mapping_t& operator=(const mapping_t&);
+
+	// The descriptor of the mapped file
+	int _fd;
+};
+
+/*
+* Checks that the nodes of a mapped hierarchy form a tree that can be
+* traversed safely: every child comes after its parent and is visited
+* once, every leaf is within the triangle arrays, and no traversal can
+* overflow the fixed size stack.
+*/
+template<typename T>
+bool validate(const BVHHelper::tree_view_t<T>& tree)
+{
+	std::vector<bool> visited;
+	unsigned int stack[BVHHelper::STACK_SIZE];
+	unsigned int top, ni;
+
+	/* an empty tree has no triangles */
+	if(tree.num_nodes == 0)
+		return (tree.num_triangles == 0);
+
+	/* walk the tree in the same way as a traversal, which pushes
+	 * both children of an interior node */
+	visited.resize(tree.num_nodes, false);
+	top = 0;
+	stack[top++] = 0;
+	while(top > 0)
+	{
+		ni = stack[--top];
+		if(visited[ni])
+			return false;
+		visited[ni] = true;
+		const BVHNode<T>& node = tree.nodes[ni];
+		if(node.count > 0)
+		{
+			if((size_t) node.offset + node.count
+					> tree.num_triangles)
+				return false;
+			continue;
+		}
+		if(node.axis > 2 || (size_t) ni + 1 >= tree.num_nodes
+				|| node.offset <= ni + 1
+				|| node.offset >= tree.num_nodes
+				|| top + 2 > BVHHelper::STACK_SIZE)
+			return false;
+		stack[top++] = ni + 1;
+		stack[top++] = node.offset;
+	}
+	return true;
+}
+
+/*
+* Writes the given hierarchy and its triangles to an index file.  The
+* file is written under a temporary name and then renamed, so that a
+* program that maps it never sees a partial file.
+*
+* Returns true on success, false on failure.
+*/
+template<typename T>
+bool write(const std::string& filename,
+	uint64_t key,
+	size_t max_leaf_size,
+	const BVHHelper::tree_view_t<T>& tree,
+	const Triangle3<T>* triangles)
+{
+	std::stringstream tmpname;
+	std::ofstream outfile;
+	header_t header;
+	uint64_t offsets[4], sizes[4], total;
+	const char* arrays[4];
+	char zeros[ALIGNMENT];
+	bool ok;
+	int i;
+
+	/* fill in the header */
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, BVHFILE_MAGIC_NUMBER, BVHFILE_MAGIC_LENGTH);
+	header.version       = BVHFILE_CURRENT_VERSION;
+	header.value_size    = sizeof(T);
+	header.node_size     = sizeof(BVHNode<T>);
+	header.triangle_size = sizeof(Triangle3<T>);
+	header.id_size       = sizeof(size_t);
+	header.key           = key;
+	header.max_leaf_size = max_leaf_size;
+	header.num_nodes     = tree.num_nodes;
+	header.num_triangles = tree.num_triangles;
+	layout(header, offsets, sizes, total);
+	arrays[0] = (const char*) tree.nodes;
+	arrays[1] = (const char*) tree.verts;
+	arrays[2] = (const char*) tree.ids;
+	arrays[3] = (const char*) triangles;
+
+	/* write the header and the arrays, padding each array
+	 * to its aligned location */
+	tmpname << filename << ".tmp" << getpid();
+	outfile.open(tmpname.str().c_str(),
+		std::ios::out | std::ios::binary | std::ios::trunc);
+	if(!(outfile.is_open()))
+		return false;
+	memset(zeros, 0, sizeof(zeros));
+	outfile.write((const char*) &header, sizeof(header));
+	for(i = 0; i < 4; i++)
+	{
+		outfile.write(zeros, (std::streamsize) (offsets[i]
+			- (uint64_t) outfile.tellp()));
+		if(sizes[i] > 0)
+			outfile.write(arrays[i], (std::streamsize) sizes[i]);
+	}
+	ok = (!(outfile.fail()) && (uint64_t) outfile.tellp() == total);
+	outfile.close();
+	if(!ok || outfile.fail())
+	{
+		remove(tmpname.str().c_str());
+		return false;
+	}
+
+	/* move the finished file into place */
+	if(rename(tmpname.str().c_str(), filename.c_str()) != 0)
+	{
+		remove(tmpname.str().c_str());
+		return false;
+	}
+	return true;
+}
+
+/*
+* Reads the hierarchy stored in a mapped index file.  The header, the
+* sizes of the arrays, and the structure of the tree are validated, and
+* the arrays of the hierarchy and its triangles are set to point into
+* the mapping.
+*
+* Returns true on success, false if the file is not a valid index for
+* this type.
+*/
+template<typename T>
+bool read(const mapping_t& mapping,
+	header_t& header,
+	BVHHelper::tree_view_t<T>& tree,
+	const Triangle3<T>*& triangles)
+{
+	uint64_t offsets[4], sizes[4], total;
+
+	/* check the header */
+	if(mapping.data == NULL || mapping.size < sizeof(header_t))
+		return false;
+	memcpy(&header, mapping.data, sizeof(header));
+	if(memcmp(header.magic, BVHFILE_MAGIC_NUMBER, BVHFILE_MAGIC_LENGTH)
+			|| header.version != BVHFILE_CURRENT_VERSION
+			|| header.value_size != sizeof(T)
+			|| header.node_size != sizeof(BVHNode<T>)
+			|| header.triangle_size != sizeof(Triangle3<T>)
+			|| header.id_size != sizeof(size_t))
+		return false;
+
+	/* check that the file holds exactly the arrays it claims,
+	 * without letting large counts overflow the sizes */
+	if(header.num_nodes > mapping.size / sizeof(BVHNode<T>)
+			|| header.num_triangles > mapping.size
+				/ sizeof(Triangle3<T>))
+		return false;
+	layout(header, offsets, sizes, total);
+	if(total != mapping.size)
+		return false;
+
+	/* point into the mapping, and check the tree */
+	tree.nodes = (const BVHNode<T>*) (mapping.data + offsets[0]);
+	tree.num_nodes = header.num_nodes;
+	tree.verts = (const T*) (mapping.data + offsets[1]);
+	tree.ids = (const size_t*) (mapping.data + offsets[2]);
+	tree.num_triangles = header.num_triangles;
+	triangles = (const Triangle3<T>*) (mapping.data + offsets[3]);
+	return validate<T>(tree);
+}
+
+}
+
+#endif
@@ -0,0 +1,941 @@
+#ifndef H_BVHHELPER_H
+#define H_BVHHELPER_H
+
+/* utility functions for the BVH */
+
+/* includes */
+#include <vector>
+#include <cmath>
+#include <algorithm>
+
+#include <util/simd.h>
+
+#include "Triangle3.h"
+#include "BVH.h"
+
+namespace BVHHelper
+{
+
+/*
+* The number of bins used to estimate the surface area heuristic
+* along each axis when splitting a node
+*/
+enum {NUM_SAH_BINS = 16};
+
+/*
+* Below this depth, nodes are split at their median instead of by the
+* surface area heuristic, which bounds the depth of the hierarchy and
+* so the size of the traversal stack
+*/
+enum {MAX_SAH_DEPTH = 32};
+
+/*
+* The bounds and centroid of a triangle, used while building
+*/
+template<typename T>
+struct build_tri_t
+{
+	T bmin[3];
+	T bmax[3];
+	T centroid[3];
+	size_t index;
+};
+
+/*
+* Compares triangles by their centroid along one axis
+*/
+template<typename T>
+class centroid_less_t
+{
+public:
+	centroid_less_t(int a) : axis(a) {};
+	int axis;
+	inline bool operator()(const build_tri_t<T>& a,
+		const build_tri_t<T>& b) const
+	{ return a.centroid[axis] < b.centroid[axis]; };
+};
+
+/*
+* Checks whether a triangle's centroid falls below a split plane
+*/
+template<typename T>
+class below_split_t
+{
+public:
+	below_split_t(int a, T c0, T s, int b)
+		: axis(a), cmin(c0), scale(s), bin(b) {};
+	int axis;
+	T cmin;
+	T scale;
+	int bin;
+	inline bool operator()(const build_tri_t<T>& t) const
+	{ return bin_of(t.centroid[axis], cmin, scale) <= bin; };
+	static inline int bin_of(T c, T cmin, T scale)
+	{
+		int b = (int) ((c - cmin) * scale);
+		return std::min(std::max(b, 0), NUM_SAH_BINS-1);
+	};
+};
+
+/*
+* Grows the bounds (bmin, bmax) to contain the given bounds
+*/
+template<typename T>
+inline void grow_bounds(T* bmin, T* bmax, const T* omin, const T* omax)
+{
+	for(int k = 0; k < 3; k++)
+	{
+		if(omin[k] < bmin[k])
+			bmin[k] = omin[k];
+		if(omax[k] > bmax[k])
+			bmax[k] = omax[k];
+	}
+}
+
+/*
+* Resets the bounds (bmin, bmax) to be empty
+*/
+template<typename T>
+inline void empty_bounds(T* bmin, T* bmax)
+{
+	bmin[0] = bmin[1] = bmin[2] = T(1e30);
+	bmax[0] = bmax[1] = bmax[2] = T(-1e30);
+}
+
+/*
+* Computes half the surface area of the given bounds
+*/
+template<typename T>
+inline T half_area(const T* bmin, const T* bmax)
+{
+	T dx = bmax[0]-bmin[0];
+	T dy = bmax[1]-bmin[1];
+	T dz = bmax[2]-bmin[2];
+	if(dx < 0 || dy < 0 || dz < 0)
+		return 0;
+	return dx*dy + dy*dz + dz*dx;
+}
+
+/*
+* Finds the best split of the triangles [first, last) by the binned
+* surface area heuristic.  Returns the number of triangles placed in
+* the first child, or zero if no useful split was found.  The axis of
+* the split is stored in split_axis.
+*
+* The triangles are partitioned in place.
+*/
+template<typename T>
+size_t sah_split(std::vector<build_tri_t<T> >& tris,
+	size_t first, size_t last,
+	const T* cmin, const T* cmax, int& split_axis)
+{
+	T bin_min[NUM_SAH_BINS][3], bin_max[NUM_SAH_BINS][3];
+	size_t bin_count[NUM_SAH_BINS];
+	T left_area[NUM_SAH_BINS];
+	size_t left_count[NUM_SAH_BINS];
+	T acc_min[3], acc_max[3];
+	T scale, cost, best_cost;
+	size_t i, acc_count;
+	int axis, b, best_axis, best_bin;
+
+	/* check each axis */
+	best_cost = T(1e30);
+	best_axis = -1;
+	best_bin = -1;
+	for(axis = 0; axis < 3; axis++)
+	{
+		/* can't split along an axis with no extent */
+		if(!(cmax[axis] > cmin[axis]))
+			continue;
+		scale = T(NUM_SAH_BINS) / (cmax[axis] - cmin[axis]);
+
+		/* put the triangles in bins */
+		for(b = 0; b < NUM_SAH_BINS; b++)
+		{
+			empty_bounds<T>(bin_min[b], bin_max[b]);
+			bin_count[b] = 0;
+		}
+		for(i = first; i < last; i++)
+		{
+			b = below_split_t<T>::bin_of(tris[i].centroid[axis],
+				cmin[axis], scale);
+			grow_bounds<T>(bin_min[b], bin_max[b],
+				tris[i].bmin, tris[i].bmax);
+			bin_count[b]++;
+		}
+
+		/* sweep from the left, then from the right, to get
+		 * the cost of splitting after each bin */
+		empty_bounds<T>(acc_min, acc_max);
+		acc_count = 0;
+		for(b = 0; b < NUM_SAH_BINS-1; b++)
+		{
+			grow_bounds<T>(acc_min, acc_max, bin_min[b], bin_max[b]);
+			acc_count += bin_count[b];
+			left_area[b] = half_area<T>(acc_min, acc_max);
+			left_count[b] = acc_count;
+		}
+		empty_bounds<T>(acc_min, acc_max);
+		acc_count = 0;
+		for(b = NUM_SAH_BINS-1; b > 0; b--)
+		{
+			grow_bounds<T>(acc_min, acc_max, bin_min[b], bin_max[b]);
+			acc_count += bin_count[b];
+			if(left_count[b-1] == 0 || acc_count == 0)
+				continue;
+			cost = left_area[b-1]*left_count[b-1]
+				+ half_area<T>(acc_min, acc_max)*acc_count;
+			if(cost < best_cost)
+			{
+				best_cost = cost;
+				best_axis = axis;
+				best_bin = b-1;
+			}
+		}
+	}
+
+	/* check if any split was found */
+	if(best_axis < 0)
+		return 0;
+
+	/* partition the triangles about the best split */
+	split_axis = best_axis;
+	scale = T(NUM_SAH_BINS) / (cmax[best_axis] - cmin[best_axis]);
+	return std::partition(tris.begin()+first, tris.begin()+last,
+		below_split_t<T>(best_axis, cmin[best_axis], scale, best_bin))
+		- (tris.begin()+first);
+}
+
+/*
+* Recursively builds the node for the triangles [first, last), appending
+* it and its subtree to the node list in depth-first order, so that the
+* first child of an interior node always immediately follows it.
+*/
+template<typename T>
+void build_recur(std::vector<build_tri_t<T> >& tris,
+	size_t first, size_t last, size_t depth, size_t max_leaf_size,
+	std::vector<BVHNode<T> >& nodes)
+{
+	T cmin[3], cmax[3];
+	size_t i, n, index, mid;
+	int k, axis;
+
+	/* add this node, and compute its bounds */
+	index = nodes.size();
+	nodes.push_back(BVHNode<T>());
+	empty_bounds<T>(nodes[index].bmin, nodes[index].bmax);
+	empty_bounds<T>(cmin, cmax);
+	for(i = first; i < last; i++)
+	{
+		grow_bounds<T>(nodes[index].bmin, nodes[index].bmax,
+			tris[i].bmin, tris[i].bmax);
+		grow_bounds<T>(cmin, cmax, tris[i].centroid, tris[i].centroid);
+	}
+
+	/* small nodes become leaves */
+	n = last - first;
+	if(n <= max_leaf_size)
+	{
+		nodes[index].offset = (unsigned int) first;
+		nodes[index].count = (unsigned short) n;
+		nodes[index].axis = 0;
+		return;
+	}
+
+	/* split by the surface area heuristic, unless the tree is
+	 * already deep or no split is found, in which case split at
+	 * the median along the longest axis */
+	mid = 0;
+	axis = 0;
+	if(depth < MAX_SAH_DEPTH)
+		mid = sah_split<T>(tris, first, last, cmin, cmax, axis);
+	if(mid == 0 || mid == n)
+	{
+		mid = n/2;
+		axis = 0;
+		for(k = 1; k < 3; k++)
+			if(cmax[k]-cmin[k] > cmax[axis]-cmin[axis])
+				axis = k;
+		std::nth_element(tris.begin()+first, tris.begin()+first+mid,
+			tris.begin()+last, centroid_less_t<T>(axis));
+	}
+
+	/* build the children */
+	build_recur<T>(tris, first, first+mid, depth+1, max_leaf_size, nodes);
+	nodes[index].offset = (unsigned int) nodes.size();
+	nodes[index].count = 0;
+	nodes[index].axis = (unsigned short) axis;
+	build_recur<T>(tris, first+mid, last, depth+1, max_leaf_size, nodes);
+}
+
+/*
+* Builds the BVH of the given triangles.  The nodes are stored in
+* depth-first order, and the vertices and ids of the triangles are
+* copied into flat arrays in the order of the leaves.
+*/
+template<typename T>
+void build(const std::vector<Triangle3<T> >& triangles,
+	size_t max_leaf_size,
+	std::vector<BVHNode<T> >& nodes,
+	std::vector<T>& verts,
+	std::vector<size_t>& ids)
+{
+	std::vector<build_tri_t<T> > tris;
+	size_t i, j;
+	int k;
+
+	/* clear any previous contents */
+	nodes.clear();
+	verts.clear();
+	ids.clear();
+	if(triangles.empty())
+		return;
+
+	/* compute the bounds and centroids of each triangle */
+	tris.resize(triangles.size());
+	for(i = 0; i < triangles.size(); i++)
+	{
+		for(k = 0; k < 3; k++)
+		{
+			tris[i].bmin[k] = std::min(std::min(
+				triangles[i].vertex(0,k),
+				triangles[i].vertex(1,k)),
+				triangles[i].vertex(2,k));
+			tris[i].bmax[k] = std::max(std::max(
+				triangles[i].vertex(0,k),
+				triangles[i].vertex(1,k)),
+				triangles[i].vertex(2,k));
+			tris[i].centroid[k] = (tris[i].bmin[k]
+				+ tris[i].bmax[k]) / 2;
+		}
+		tris[i].index = i;
+	}
+
+	/* build the hierarchy */
+	max_leaf_size = std::max<size_t>(1, std::min<size_t>(
+		max_leaf_size, 0xffff));
+	nodes.reserve(2*triangles.size()/max_leaf_size + 1);
+	build_recur<T>(tris, 0, tris.size(), 0, max_leaf_size, nodes);
+
+	/* copy the triangles in leaf order */
+	verts.resize(9*tris.size());
+	ids.resize(tris.size());
+	for(i = 0; i < tris.size(); i++)
+	{
+		const Triangle3<T>& t = triangles[tris[i].index];
+		for(j = 0; j < 3; j++)
+			for(k = 0; k < 3; k++)
+				verts[9*i + 3*j + k] = t.vertex(j,k);
+		ids[i] = t.id();
+	}
+}
+
+/*
+* The flat arrays of a built hierarchy.  These are owned by a BVH, or
+* mapped from an index file written by BVHFile.
+*/
+template<typename T>
+struct tree_view_t
+{
+	const BVHNode<T>* nodes;
+	size_t num_nodes;
+	const T* verts;
+	const size_t* ids;
+	size_t num_triangles;
+};
+
+/*
+* The precomputed values of a ray used by the traversal and by the
+* watertight triangle test
+*/
+template<typename T>
+struct ray_info_t
+{
+	T origin[3];
+	T direction[3];
+	T inv_direction[3];
+	int sign[3];
+
+	/* the axis along which the direction is largest, and the
+	 * other two axes, ordered to preserve winding */
+	int kx, ky, kz;
+
+	/* the shear constants */
+	T Sx, Sy, Sz;
+
+	ray_info_t(const T* o, const T* d)
+	{
+		for(int k = 0; k < 3; k++)
+		{
+			origin[k] = o[k];
+			direction[k] = d[k];
+			inv_direction[k] = T(1) / d[k];
+			sign[k] = (d[k] < 0);
+		}
+
+		/* find the largest dimension of the direction */
+		kz = 0;
+		if(std::abs(d[1]) > std::abs(d[kz]))
+			kz = 1;
+		if(std::abs(d[2]) > std::abs(d[kz]))
+			kz = 2;
+		kx = (kz + 1) % 3;
+		ky = (kx + 1) % 3;
+		if(d[kz] < 0)
+			std::swap(kx, ky);
+
+		/* the shear that maps the direction to +z */
+		Sx = d[kx] / d[kz];
+		Sy = d[ky] / d[kz];
+		Sz = T(1) / d[kz];
+	};
+};
+
+/*
+* Tests the ray against an axis aligned box, returning true if it
+* enters the box before tmax.  The entry distance is stored in tnear.
+*
+* Comparisons are ordered so that a NaN slab distance, which occurs
+* when the origin lies on a slab of a box the ray is parallel to,
+* leaves the interval unchanged.
+*/
+template<typename T>
+inline bool ray_box(const ray_info_t<T>& r,
+	const T* bmin, const T* bmax, T tmax, T& tnear)
+{
+	const T* b[2] = {bmin, bmax};
+	T t0, t1, tfar;
+
+	tnear = 0;
+	tfar = tmax;
+	for(int k = 0; k < 3; k++)
+	{
+		t0 = (b[r.sign[k]][k] - r.origin[k]) * r.inv_direction[k];
+		t1 = (b[1-r.sign[k]][k] - r.origin[k]) * r.inv_direction[k];
+		if(t0 > tnear)
+			tnear = t0;
+		if(t1 < tfar)
+			tfar = t1;
+	}
+	return (tnear <= tfar);
+}
+
+/*
+* Tests the ray against the triangle with the given vertices using the
+* watertight test described in:
+*
+*      Sven Woop, Carsten Benthin, and Ingo Wald
+*      "Watertight Ray/Triangle Intersection"
+*      Journal of Computer Graphics Techniques, 2(1):65-82, 2013
+*
+* Rays that pass through a shared edge or vertex hit at least one of
+* the triangles that share it.  If the ray hits the triangle at a
+* distance in [0, tmax), the distance is stored in t and true is
+* returned.  Distances are in units of the direction vector.
+*/
+template<typename T>
+inline bool ray_triangle(const ray_info_t<T>& r, const T* v, T tmax, T& t)
+{
+	T A[3], B[3], C[3];
+	T Ax, Ay, Bx, By, Cx, Cy, U, V, W, det, Tn;
+
+	/* translate the vertices relative to the ray origin */
+	for(int k = 0; k < 3; k++)
+	{
+		A[k] = v[k] - r.origin[k];
+		B[k] = v[3+k] - r.origin[k];
+		C[k] = v[6+k] - r.origin[k];
+	}
+
+	/* shear and scale the vertices */
+	Ax = A[r.kx] - r.Sx*A[r.kz];
+	Ay = A[r.ky] - r.Sy*A[r.kz];
+	Bx = B[r.kx] - r.Sx*B[r.kz];
+	By = B[r.ky] - r.Sy*B[r.kz];
+	Cx = C[r.kx] - r.Sx*C[r.kz];
+	Cy = C[r.ky] - r.Sy*C[r.kz];
+
+	/* compute the scaled barycentric coordinates, falling back to
+	 * double precision on the edges of the triangle */
+	U = Cx*By - Cy*Bx;
+	V = Ax*Cy - Ay*Cx;
+	W = Bx*Ay - By*Ax;
+	if(U == 0 || V == 0 || W == 0)
+	{
+		U = (T) ((double) Cx*(double) By - (double) Cy*(double) Bx);
+		V = (T) ((double) Ax*(double) Cy - (double) Ay*(double) Cx);
+		W = (T) ((double) Bx*(double) Ay - (double) By*(double) Ax);
+	}
+
+	/* the ray misses if the signs disagree */
+	if((U < 0 || V < 0 || W < 0) && (U > 0 || V > 0 || W > 0))
+		return false;
+	det = U + V + W;
+	if(det == 0)
+		return false;
+
+	/* compute the scaled distance, and check that it is in range
+	 * before dividing by the determinant */
+	Tn = U*r.Sz*A[r.kz] + V*r.Sz*B[r.kz] + W*r.Sz*C[r.kz];
+	if(det < 0)
+	{
+		if(Tn > 0 || Tn <= tmax*det)
+			return false;
+	}
+	else if(Tn < 0 || Tn >= tmax*det)
+		return false;
+	t = Tn / det;
+	return true;
+}
+
+/*
+* The number of nodes that can be pending during a traversal.  At most
+* one node per level is pending, and the depth of the hierarchy is at
+* most MAX_SAH_DEPTH plus the depth of a median split of 2^32 triangles.
+*/
+enum {STACK_SIZE = MAX_SAH_DEPTH + 34};
+
+/*
+* Does the ray tracing function.  The closest hit triangle is found by
+* a depth-first traversal with a fixed size stack, which visits the
+* nearer child first and skips nodes beyond the closest hit so far.
+*/
+template<typename T>
+bool ray_trace(const tree_view_t<T>& tree,
+	const T* origin,
+	const T* direction,
+	T* intersection,
+	size_t * id)
+{
+	unsigned int stack[STACK_SIZE];
+	unsigned int top, ni, i, end;
+	size_t hit;
+	T closest, tnear, t;
+
+	/* check for an empty hierarchy */
+	if(tree.num_nodes == 0)
+		return false;
+
+	/* precompute the values of the ray */
+	ray_info_t<T> r(origin, direction);
+	closest = T(1e30);
+	hit = tree.num_triangles;
+
+	/* start at the root */
+	top = 0;
+	stack[top++] = 0;
+	while(top > 0)
+	{
+		/* skip nodes that the ray misses, or that are
+		 * beyond the closest hit so far */
+		ni = stack[--top];
+		const BVHNode<T>& node = tree.nodes[ni];
+		if(!ray_box<T>(r, node.bmin, node.bmax, closest, tnear))
+			continue;
+
+		/* if this node is a leaf, test its triangles */
+		if(node.count > 0)
+		{
+			end = node.offset + node.count;
+			for(i = node.offset; i < end; i++)
+				if(ray_triangle<T>(r, tree.verts + 9*i, closest, t))
+				{
+					closest = t;
+					hit = i;
+				}
+			continue;
+		}
+
+		/* otherwise push the children, so that the nearer
+		 * child is visited first */
+		if(r.sign[node.axis])
+		{
+			stack[top++] = ni + 1;
+			stack[top++] = node.offset;
+		}
+		else
+		{
+			stack[top++] = node.offset;
+			stack[top++] = ni + 1;
+		}
+	}
+
+	/* check if anything was hit */
+	if(hit == tree.num_triangles)
+		return false;
+	for(i = 0; i < 3; i++)
+		intersection[i] = origin[i] + closest*direction[i];
+	*id = tree.ids[hit];
+	return true;
+}
+
+
+/*
+* The number of rays traced together as a packet, such as a 4x4 tile
+* of the pixels of an image
+*/
+enum {PACKET_SIZE = 16};
+
+/*
+* Traces a packet of rays one ray at a time.  This is used for the
+* types that do not have a vectorized packet traversal.
+*/
+template<typename T>
+struct packet_tracer_t
+{
+	static void trace(const tree_view_t<T>& tree,
+		size_t n,
+		const T* origins,
+		const T* directions,
+		T* intersections,
+		size_t * hit_ids,
+		bool * hits)
+	{
+		for(size_t i = 0; i < n; i++)
+			hits[i] = ray_trace<T>(tree, origins + 3*i, directions + 3*i,
+				intersections + 3*i, hit_ids + i);
+	};
+};
+
+/*
+* Traces a packet of float rays with four rays in each simd vector.
+*
+* The packet is traversed depth-first, in the same order as a single
+* ray would be, with a mask of the rays that are still active in each
+* subtree.  Each ray is tested against the same boxes and triangles,
+* in the same order and with the same float operations, as it would
+* be by ray_trace(), so the results are identical.  This requires the
+* rays to agree on the signs of their directions and on the axes of
+* the watertight test, which holds for a small tile of an image except
+* where it straddles an axis.  Packets that do not agree are traced
+* one ray at a time.
+*/
+template<>
+struct packet_tracer_t<float>
+{
+	/* the number of simd vectors in a packet */
+	enum {NUM_GROUPS = PACKET_SIZE / SIMD_VEC4F_WIDTH};
+
+	/* the precomputed values of the rays of a packet */
+	struct packet_t
+	{
+		simd::vec4f origin[3][NUM_GROUPS];
+		simd::vec4f inv_direction[3][NUM_GROUPS];
+		simd::vec4f Sx[NUM_GROUPS];
+		simd::vec4f Sy[NUM_GROUPS];
+		simd::vec4f Sz[NUM_GROUPS];
+
+		/* the values shared by all rays of the packet */
+		int sign[3];
+		int kx, ky, kz;
+	};
+
+	/* a pending node, with the rays that entered its parent */
+	struct entry_t
+	{
+		unsigned int node;
+		simd::vec4f active[NUM_GROUPS];
+	};
+
+	/*
+	* The vectorized form of ray_box(), returning the mask of
+	* the rays in group g that enter the box before tmax
+	*/
+	static inline simd::vec4f box(const packet_t& p, int g,
+		const BVHNode<float>& node, const simd::vec4f& tmax)
+	{
+		const float* b[2] = {node.bmin, node.bmax};
+		simd::vec4f t0, t1, tnear, tfar;
+
+		tnear = simd::vec4f(0);
+		tfar = tmax;
+		for(int k = 0; k < 3; k++)
+		{
+			t0 = (simd::vec4f(b[p.sign[k]][k]) - p.origin[k][g])
+				* p.inv_direction[k][g];
+			t1 = (simd::vec4f(b[1-p.sign[k]][k]) - p.origin[k][g])
+				* p.inv_direction[k][g];
+			tnear = simd::select(simd::lt(tnear, t0), t0, tnear);
+			tfar = simd::select(simd::lt(t1, tfar), t1, tfar);
+		}
+		return simd::le(tnear, tfar);
+	};
+
+	/*
+	* The vectorized form of ray_triangle(), which tests the
+	* active rays of group g against triangle i, updating the
+	* closest distance and the triangle hit by each of them
+	*/
+	static inline void triangle(const packet_t& p, int g,
+		const float* v, unsigned int i, const simd::vec4f& active,
+		simd::vec4f& closest, size_t* hit)
+	{
+		simd::vec4f A[3], B[3], C[3];
+		simd::vec4f Ax, Ay, Bx, By, Cx, Cy, U, V, W, det, Tn;
+		simd::vec4f zero, miss, tdet;
+		float lane[9][SIMD_VEC4F_WIDTH];
+		int m, l;
+
+		/* translate the vertices relative to the ray origins */
+		for(int k = 0; k < 3; k++)
+		{
+			A[k] = simd::vec4f(v[k]) - p.origin[k][g];
+			B[k] = simd::vec4f(v[3+k]) - p.origin[k][g];
+			C[k] = simd::vec4f(v[6+k]) - p.origin[k][g];
+		}
+
+		/* shear and scale the vertices */
+		Ax = A[p.kx] - p.Sx[g]*A[p.kz];
+		Ay = A[p.ky] - p.Sy[g]*A[p.kz];
+		Bx = B[p.kx] - p.Sx[g]*B[p.kz];
+		By = B[p.ky] - p.Sy[g]*B[p.kz];
+		Cx = C[p.kx] - p.Sx[g]*C[p.kz];
+		Cy = C[p.ky] - p.Sy[g]*C[p.kz];
+
+		/* compute the scaled barycentric coordinates */
+		U = Cx*By - Cy*Bx;
+		V = Ax*Cy - Ay*Cx;
+		W = Bx*Ay - By*Ax;
+
+		/* the rays on the edges of the triangle fall back to
+		 * double precision, one lane at a time */
+		zero = simd::vec4f(0);
+		m = simd::movemask(simd::mask_and(active, simd::mask_or(
+			simd::eq(U, zero), simd::mask_or(
+			simd::eq(V, zero), simd::eq(W, zero)))));
+		if(m)
+		{
+			Ax.store(lane[0]); Ay.store(lane[1]);
+			Bx.store(lane[2]); By.store(lane[3]);
+			Cx.store(lane[4]); Cy.store(lane[5]);
+			U.store(lane[6]); V.store(lane[7]); W.store(lane[8]);
+			for(l = 0; l < SIMD_VEC4F_WIDTH; l++)
+			{
+				if(!(m & (1 << l)))
+					continue;
+				lane[6][l] = (float) ((double) lane[4][l]
+					* (double) lane[3][l]
+					- (double) lane[5][l]
+					* (double) lane[2][l]);
+				lane[7][l] = (float) ((double) lane[0][l]
+					* (double) lane[5][l]
+					- (double) lane[1][l]
+					* (double) lane[4][l]);
+				lane[8][l] = (float) ((double) lane[2][l]
+					* (double) lane[1][l]
+					- (double) lane[3][l]
+					* (double) lane[0][l]);
+			}
+			U = simd::vec4f::load(lane[6]);
+			V = simd::vec4f::load(lane[7]);
+			W = simd::vec4f::load(lane[8]);
+		}
+
+		/* the rays miss if the signs disagree */
+		miss = simd::mask_and(
+			simd::mask_or(simd::lt(U, zero), simd::mask_or(
+				simd::lt(V, zero), simd::lt(W, zero))),
+			simd::mask_or(simd::lt(zero, U), simd::mask_or(
+				simd::lt(zero, V), simd::lt(zero, W))));
+		det = U + V + W;
+		miss = simd::mask_or(miss, simd::eq(det, zero));
+
+		/* compute the scaled distances, and check that they are
+		 * in range before dividing by the determinant */
+		Tn = U*p.Sz[g]*A[p.kz] + V*p.Sz[g]*B[p.kz]
+			+ W*p.Sz[g]*C[p.kz];
+		tdet = closest*det;
+		miss = simd::mask_or(miss, simd::select(simd::lt(det, zero),
+			simd::mask_or(simd::lt(zero, Tn), simd::le(Tn, tdet)),
+			simd::mask_or(simd::lt(Tn, zero), simd::le(tdet, Tn))));
+
+		/* record the hits */
+		miss = simd::mask_andnot(miss, active);
+		m = simd::movemask(miss);
+		if(!m)
+			return;
+		closest = simd::select(miss, Tn / det, closest);
+		for(l = 0; l < SIMD_VEC4F_WIDTH; l++)
+			if(m & (1 << l))
+				hit[l] = i;
+	};
+
+	static void trace(const tree_view_t<float>& tree,
+		size_t n,
+		const float* origins,
+		const float* directions,
+		float* intersections,
+		size_t * hit_ids,
+		bool * hits)
+	{
+		packet_t p;
+		entry_t stack[STACK_SIZE];
+		simd::vec4f active[NUM_GROUPS];
+		simd::vec4f closest[NUM_GROUPS];
+		float buf[9][PACKET_SIZE];
+		size_t hit[PACKET_SIZE];
+		int masks[NUM_GROUPS];
+		unsigned int top, ni, i, end;
+		int g, k, any;
+		size_t j;
+
+		/* check for an empty hierarchy */
+		if(tree.num_nodes == 0)
+		{
+			for(j = 0; j < n; j++)
+				hits[j] = false;
+			return;
+		}
+
+		/* precompute the values of each ray, padding the packet
+		 * with copies of the first ray, and check that the rays
+		 * agree on the values that they must share */
+		for(j = 0; j < PACKET_SIZE; j++)
+		{
+			ray_info_t<float> r(origins + 3*(j < n ? j : 0),
+				directions + 3*(j < n ? j : 0));
+			if(j == 0)
+			{
+				for(k = 0; k < 3; k++)
+					p.sign[k] = r.sign[k];
+				p.kx = r.kx;
+				p.ky = r.ky;
+				p.kz = r.kz;
+			}
+			else if(r.sign[0] != p.sign[0]
+				|| r.sign[1] != p.sign[1]
+				|| r.sign[2] != p.sign[2] || r.kx != p.kx
+				|| r.ky != p.ky || r.kz != p.kz)
+				break;
+			for(k = 0; k < 3; k++)
+			{
+				buf[k][j] = r.origin[k];
+				buf[3+k][j] = r.inv_direction[k];
+			}
+			buf[6][j] = r.Sx;
+			buf[7][j] = r.Sy;
+			buf[8][j] = r.Sz;
+		}
+		if(j < PACKET_SIZE)
+		{
+			for(j = 0; j < n; j++)
+				hits[j] = ray_trace<float>(tree, origins + 3*j, directions + 3*j,
+					intersections + 3*j, hit_ids + j);
+			return;
+		}
+		for(g = 0; g < NUM_GROUPS; g++)
+		{
+			for(k = 0; k < 3; k++)
+			{
+				p.origin[k][g] = simd::vec4f::load(
+					buf[k] + SIMD_VEC4F_WIDTH*g);
+				p.inv_direction[k][g] = simd::vec4f::load(
+					buf[3+k] + SIMD_VEC4F_WIDTH*g);
+			}
+			p.Sx[g] = simd::vec4f::load(buf[6]+SIMD_VEC4F_WIDTH*g);
+			p.Sy[g] = simd::vec4f::load(buf[7]+SIMD_VEC4F_WIDTH*g);
+			p.Sz[g] = simd::vec4f::load(buf[8]+SIMD_VEC4F_WIDTH*g);
+			closest[g] = simd::vec4f(1e30f);
+		}
+		for(j = 0; j < PACKET_SIZE; j++)
+			hit[j] = tree.num_triangles;
+
+		/* start at the root, with all rays active */
+		top = 0;
+		stack[top].node = 0;
+		for(g = 0; g < NUM_GROUPS; g++)
+			stack[top].active[g] = simd::eq(closest[g],
+				closest[g]);
+		top++;
+		while(top > 0)
+		{
+			/* deactivate the rays that miss this node, or
+			 * for which it is beyond the closest hit so far */
+			top--;
+			ni = stack[top].node;
+			const BVHNode<float>& node = tree.nodes[ni];
+			any = 0;
+			for(g = 0; g < NUM_GROUPS; g++)
+			{
+				active[g] = stack[top].active[g];
+				masks[g] = simd::movemask(active[g]);
+				if(!masks[g])
+					continue;
+				active[g] = simd::mask_and(active[g],
+					box(p, g, node, closest[g]));
+				masks[g] = simd::movemask(active[g]);
+				any |= masks[g];
+			}
+			if(!any)
+				continue;
+
+			/* if this node is a leaf, test its triangles */
+			if(node.count > 0)
+			{
+				end = node.offset + node.count;
+				for(i = node.offset; i < end; i++)
+					for(g = 0; g < NUM_GROUPS; g++)
+						if(masks[g])
+							triangle(p, g,
+							tree.verts + 9*i, i,
+							active[g],
+							closest[g],
+							hit + SIMD_VEC4F_WIDTH*g);
+				continue;
+			}
+
+			/* otherwise push the children, so that the nearer
+			 * child is visited first */
+			stack[top].node = (p.sign[node.axis] ? ni + 1
+					: node.offset);
+			stack[top+1].node = (p.sign[node.axis] ? node.offset
+					: ni + 1);
+			for(g = 0; g < NUM_GROUPS; g++)
+				stack[top].active[g] = stack[top+1].active[g]
+					= active[g];
+			top += 2;
+		}
+
+		/* store the results of the rays of the packet */
+		for(g = 0; g < NUM_GROUPS; g++)
+			closest[g].store(buf[0] + SIMD_VEC4F_WIDTH*g);
+		for(j = 0; j < n; j++)
+		{
+			hits[j] = (hit[j] != tree.num_triangles);
+			if(!hits[j])
+				continue;
+			for(k = 0; k < 3; k++)
+				intersections[3*j+k] = origins[3*j+k]
+					+ buf[0][j]*directions[3*j+k];
+			hit_ids[j] = tree.ids[hit[j]];
+		}
+	};
+};
+
+/*
+* Traces a set of rays, PACKET_SIZE at a time.  The results of each ray
+* are the same as ray_trace() would return for it.
+*/
+template<typename T>
+void ray_trace_packet(const tree_view_t<T>& tree,
+	size_t n,
+	const T* origins,
+	const T* directions,
+	T* intersections,
+	size_t * hit_ids,
+	bool * hits)
+{
+	size_t i, m;
+
+	for(i = 0; i < n; i += PACKET_SIZE)
+	{
+		m = std::min<size_t>(n - i, PACKET_SIZE);
+		packet_tracer_t<T>::trace(tree, m,
+			origins + 3*i, directions + 3*i,
+			intersections + 3*i, hit_ids + i, hits + i);
+	}
+}
+
+}
+
+#endif
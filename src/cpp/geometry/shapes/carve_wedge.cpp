@@ -1,12 +1,17 @@
 #include "carve_wedge.h"
 #include <geometry/carve/gaussian/carve_map.h>
+#include <geometry/carve/gaussian/carve_map_batch.h>
+#include <geometry/octree/octnode.h>
 #include <geometry/octree/octdata.h>
 #include <geometry/poly_intersect/pcube.h>
 #include <geometry/poly_intersect/get_polygon_normal.h>
 #include <geometry/shapes/linesegment.h>
 #include <util/error_codes.h>
+#include <util/simd.h>
+#include <algorithm>
 #include <stdlib.h>
 #include <iostream>
+#include <cmath>
 #include <Eigen/Dense>
 
 /**
@@ -60,7 +65,6 @@ using namespace Eigen;
  *                                                                
  */
 
-#define NUM_TRIANGLES_PER_WEDGE 10 /* number of triangles to test */
 #define NUM_EDGES_PER_WEDGE 15 /* number of edges to test */
 
 #define NUM_VERTS_PER_TRI 3 /* basic geometry */
@@ -100,6 +104,15 @@ static const unsigned int edge_inds[NUM_EDGES_PER_WEDGE][2] = {
 				{1, 5}, /* cross-diagonals, scanpoints */
 				{4, 2}};
 
+/* the index of the only edge above that is not an edge of one of the
+ * triangles.  The union of the triangles and this edge contains every
+ * vertex and edge of the wedge. */
+#define UNSHARED_EDGE_INDEX 10
+
+/* helper functions */
+static int separated_lanes(unsigned int nv, const double* const* ps,
+                           const double* norm, const simd::vec4d* qs);
+
 /* function implementations */
 
 /*--------------*/
@@ -120,59 +133,74 @@ carve_wedge_t::carve_wedge_t()
 
 void carve_wedge_t::init(carve_map_t* a1, carve_map_t* a2,
                          carve_map_t* b1, carve_map_t* b2,
-                         double nb, bool interp)
+                         double nb, bool interp,
+                         carve_map_batch_t::ACCURACY acc)
 {
-	Vector3d u, as, bs, a1p, a2p, b1p, b2p;
-	double s;
+	Vector3d s_means[NUM_MAPS_PER_WEDGE];
+	Vector3d p_means[NUM_MAPS_PER_WEDGE];
+	double p_vars[NUM_MAPS_PER_WEDGE];
+	unsigned int i;
 
 	/* save these maps to this object */
 	this->maps[0] = a1;
 	this->maps[1] = a2;
 	this->maps[2] = b1;
 	this->maps[3] = b2;
+	this->batch.init(this->maps, acc);
+
+	/* get the means and variances of the maps */
+	for(i = 0; i < NUM_MAPS_PER_WEDGE; i++)
+	{
+		this->maps[i]->get_sensor_mean(s_means[i]);
+		this->maps[i]->get_scanpoint_mean(p_means[i]);
+		p_vars[i] = this->maps[i]->get_scanpoint_var();
+	}
+
+	/* define the shape from these values */
+	this->init_shape(s_means, p_means, p_vars, nb, interp);
+}
+
+void carve_wedge_t::init_shape(const Vector3d* s_means,
+                               const Vector3d* p_means,
+                               const double* p_vars, double nb,
+                               bool interp)
+{
+	Vector3d u;
+	unsigned int i;
 
 	/* define vertex positions for this wedge.  Note that we
 	 * want the scanpoint vertex positions to be spread farther 
 	 * than the mean positions for each carve map, so that the carving
-	 * can apply to the full spread of each distribution. */
-	
-	/* get mean of points */
-	a1->get_sensor_mean(as);
-	a1->get_scanpoint_mean(a1p);
-	a2->get_scanpoint_mean(a2p);
-	b1->get_sensor_mean(bs);
-	b1->get_scanpoint_mean(b1p);
-	b2->get_scanpoint_mean(b2p);
+	 * can apply to the full spread of each distribution.
+	 *
+	 * Both maps of a frame share the sensor position of that
+	 * frame, so the first map of each frame is used for it. */
 
 	/* find position of vertex #0 */
-	this->verts[0] = as;
+	this->verts[0] = s_means[0];
 	
 	/* find position of vertex #1 */
-	u = (a1p - as);
+	u = (p_means[0] - s_means[0]);
 	u.normalize(); /* unit vector in direction away from shape */
-	s = a1->get_scanpoint_var(); /* variance in this direction */
-	this->verts[1] = a1p + nb*sqrt(s)*u;
+	this->verts[1] = p_means[0] + nb*sqrt(p_vars[0])*u;
 
 	/* find position of vertex #2 */
-	u = (a2p - as);
+	u = (p_means[1] - s_means[0]);
 	u.normalize(); /* unit vector in direction away from shape */
-	s = a2->get_scanpoint_var(); /* variance in this direction */
-	this->verts[2] = a2p + nb*sqrt(s)*u;
+	this->verts[2] = p_means[1] + nb*sqrt(p_vars[1])*u;
 
 	/* find position of vertex #3 */
-	this->verts[3] = bs;
+	this->verts[3] = s_means[2];
 
 	/* find position of vertex #4 */
-	u = (b1p - bs);
+	u = (p_means[2] - s_means[2]);
 	u.normalize(); /* unit vector in direction away from shape */
-	s = b1->get_scanpoint_var(); /* variance in this direction */
-	this->verts[4] = b1p + nb*sqrt(s)*u;
+	this->verts[4] = p_means[2] + nb*sqrt(p_vars[2])*u;
 
 	/* find position of vertex #5 */
-	u = (b2p - bs);
+	u = (p_means[3] - s_means[2]);
 	u.normalize(); /* unit vector in direction away from shape */
-	s = b2->get_scanpoint_var(); /* variance in this direction */
-	this->verts[5] = b2p + nb*sqrt(s)*u;
+	this->verts[5] = p_means[3] + nb*sqrt(p_vars[3])*u;
 	
 	/* what are the distances of adjacent points within a scan? */
 	d12 = (this->verts[1] - this->verts[2]).norm(); /* this frame */
@@ -183,6 +211,13 @@ void carve_wedge_t::init(carve_map_t* a1, carve_map_t* a2,
 	d14 = (this->verts[1] - this->verts[4]).norm(); /* scanpoint i */
 	d25 = (this->verts[2] - this->verts[5]).norm(); /* scanpoint i+1 */
 
+	/* cache the normals of each triangle */
+	for(i = 0; i < NUM_TRIANGLES_PER_WEDGE; i++)
+		this->norms[i] = (this->verts[tri_inds[i][1]]
+				- this->verts[tri_inds[i][0]]).cross(
+				this->verts[tri_inds[i][2]]
+				- this->verts[tri_inds[i][0]]);
+
 	/* save interpolation value */
 	this->interpolate = interp;
 }
@@ -207,6 +242,77 @@ bool carve_wedge_t::intersects(const Eigen::Vector3d& c, double hw) const
 	return this->intersects_nointerp(c, hw);
 }
 
+void carve_wedge_t::intersects_block(unsigned int n, const Vector3d* cs,
+                                     double hw, bool* hits) const
+{
+	double vs[NUM_VERTICES_PER_WEDGE][3];
+	double qs[3][SIMD_VEC4D_WIDTH];
+	const double* ps[NUM_VERTS_PER_TRI];
+	simd::vec4d q[3];
+	unsigned int i, j, k, m;
+	int lanes, found, sep;
+	double s;
+
+	/* the non-interpolated test is a single line segment, so
+	 * there is no work to share between the boxes */
+	if(!(this->interpolate))
+	{
+		for(i = 0; i < n; i++)
+			hits[i] = this->intersects_nointerp(cs[i], hw);
+		return;
+	}
+
+	/* prepare array of transformed vertices, which are the
+	 * vertices of this wedge in the transform where each box
+	 * is a unit box, and the first box is centered at the
+	 * origin.  This is shared by all boxes in the block. */
+	s = 0.5/hw; /* scale factor */
+	for(i = 0; i < NUM_VERTICES_PER_WEDGE; i++)
+		for(j = 0; j < 3; j++) /* iterate over dimensions */
+			vs[i][j] = (this->verts[i](j) - cs[0](j)) * s;
+
+	/* test the boxes four at a time, one per simd lane */
+	for(i = 0; i < n; i += m)
+	{
+		/* get the centers of these boxes in the same
+		 * transform.  Unused lanes repeat the last box. */
+		m = min(n - i, (unsigned int) SIMD_VEC4D_WIDTH);
+		for(j = 0; j < SIMD_VEC4D_WIDTH; j++)
+			for(k = 0; k < 3; k++)
+				qs[k][j] = (cs[i + min(j, m-1)](k)
+						- cs[0](k)) * s;
+		for(k = 0; k < 3; k++)
+			q[k] = simd::vec4d::load(qs[k]);
+		lanes = (1 << m) - 1;
+
+		/* the wedge intersects a box iff one of its triangles
+		 * or its unshared edge does, since these contain all
+		 * of its vertices, edges, and faces.  Stop as soon as
+		 * every box is found to intersect. */
+		found = 0;
+		for(j = 0; j < NUM_TRIANGLES_PER_WEDGE && found != lanes;
+								j++)
+		{
+			for(k = 0; k < NUM_VERTS_PER_TRI; k++)
+				ps[k] = vs[tri_inds[j][k]];
+			sep = separated_lanes(NUM_VERTS_PER_TRI, ps,
+			                      this->norms[j].data(), q);
+			found |= (~sep & lanes);
+		}
+		if(found != lanes)
+		{
+			ps[0] = vs[edge_inds[UNSHARED_EDGE_INDEX][0]];
+			ps[1] = vs[edge_inds[UNSHARED_EDGE_INDEX][1]];
+			sep = separated_lanes(2, ps, NULL, q);
+			found |= (~sep & lanes);
+		}
+
+		/* store the results */
+		for(j = 0; j < m; j++)
+			hits[i+j] = ((found >> j) & 1);
+	}
+}
+
 inline bool carve_wedge_t::intersects_rays(const Eigen::Vector3d& c, 
 						double hw) const
 {
@@ -368,37 +474,16 @@ inline bool carve_wedge_t::intersects_nointerp(const Eigen::Vector3d& c,
 octdata_t* carve_wedge_t::apply_to_leaf(const Eigen::Vector3d& c,
                                         double hw, octdata_t* d)
 {
-	double vi, val, wi, weight, surf, corner, planar, xsize;
-	unsigned int i;
-
-	/* sample the originating carve maps at this location */
-	val = 0;
-	surf = 1;
-	corner = 0;
-	planar = 0;
-	xsize = 2*hw;
-	weight = wi = 0;
-	for(i = 0; i < NUM_MAPS_PER_WEDGE; i++)
-	{
-		/* interpolate between the original carve maps
-		 * to get value at this position */
-		vi      = this->maps[i]->compute(c, xsize, wi);
-		val    += wi*vi;
-		weight += wi;
-		surf   *= (1-this->maps[i]->get_surface_prob(c, xsize));
-		corner += wi*this->maps[i]->get_corner_prob();
-		planar += wi*this->maps[i]->get_planar_prob();
-	}
+	double val, weight, surf, corner, planar;
 
-	/* keep weights in the generated octdata structures, so that all
-	 * samples in each space are fused at once in a weighted
-	 * average representing Maximum A Posteriori (MAP) estimate */
-
-	/* use the average of this sample */
-	val    /= weight;
-	surf    = 1 - surf; /* 1 - Prob(no map on surface) */
-	corner /= weight;
-	planar /= weight;
+	/* sample the originating carve maps at this location, and
+	 * interpolate between them to get the value at this position.
+	 *
+	 * The weights are kept in the generated octdata structures,
+	 * so that all samples in each space are fused at once in a
+	 * weighted average representing Maximum A Posteriori (MAP)
+	 * estimate */
+	this->batch.compute(c, 2*hw, val, weight, surf, corner, planar);
 
 	/* check if data already exist for this spot */
 	if(d == NULL)
@@ -412,6 +497,34 @@ octdata_t* carve_wedge_t::apply_to_leaf(const Eigen::Vector3d& c,
 	return d;
 }
 
+void carve_wedge_t::apply_to_leaves(unsigned int n,
+                                    const Eigen::Vector3d* cs,
+                                    double hw, octdata_t** ds)
+{
+	double val[CHILDREN_PER_NODE], weight[CHILDREN_PER_NODE];
+	double surf[CHILDREN_PER_NODE], corner[CHILDREN_PER_NODE];
+	double planar[CHILDREN_PER_NODE];
+	unsigned int i, j, m;
+
+	/* process the leaves in blocks of siblings */
+	for(i = 0; i < n; i += m)
+	{
+		/* sample the carve maps for this block */
+		m = min(n - i, (unsigned int) CHILDREN_PER_NODE);
+		this->batch.compute_block(m, cs + i, 2*hw, val, weight,
+		                          surf, corner, planar);
+
+		/* add the samples to the data */
+		for(j = 0; j < m; j++)
+		{
+			if(ds[i+j] == NULL)
+				ds[i+j] = new octdata_t();
+			ds[i+j]->add_sample(weight[j], val[j], surf[j],
+			                    corner[j], planar[j]);
+		}
+	}
+}
+
 /*-----------*/
 /* debugging */
 /*-----------*/
@@ -484,3 +597,108 @@ void carve_wedge_t::writexyz(std::ostream& os) const
 		   << " 0 0 255" << endl;
 	}
 }
+
+/*------------------*/
+/* helper functions */
+/*------------------*/
+
+/**
+ * Finds which of four unit boxes are separated from a polygon along
+ * one axis
+ *
+ * @param a     The axis to project onto, which need not be normalized
+ * @param nv    The number of vertices of the polygon
+ * @param ps    The vertices of the polygon
+ * @param qs    The x, y, and z coordinates of the box centers
+ * @param sep   The mask of separated boxes, which is updated with
+ *              the boxes that are separated along this axis
+ */
+static inline void separate_on_axis(const double* a, unsigned int nv,
+                                    const double* const* ps,
+                                    const simd::vec4d* qs,
+                                    simd::vec4d& sep)
+{
+	simd::vec4d t, r;
+	double lo, hi, p;
+	unsigned int k;
+
+	/* project the polygon onto the axis */
+	lo = hi = a[0]*ps[0][0] + a[1]*ps[0][1] + a[2]*ps[0][2];
+	for(k = 1; k < nv; k++)
+	{
+		p = a[0]*ps[k][0] + a[1]*ps[k][1] + a[2]*ps[k][2];
+		lo = min(lo, p);
+		hi = max(hi, p);
+	}
+
+	/* project the boxes onto the axis, which gives their
+	 * centers and radii along it */
+	t = simd::vec4d(a[0])*qs[0] + simd::vec4d(a[1])*qs[1]
+			+ simd::vec4d(a[2])*qs[2];
+	r = simd::vec4d(0.5*(fabs(a[0]) + fabs(a[1]) + fabs(a[2])));
+
+	/* a box is separated if the intervals do not overlap */
+	sep = simd::mask_or(sep, simd::mask_or(
+			simd::lt(t + r, simd::vec4d(lo)),
+			simd::lt(simd::vec4d(hi), t - r)));
+}
+
+/**
+ * Finds which of four unit boxes are separated from a polygon
+ *
+ * Uses the separating axis theorem to test a triangle or line
+ * segment against four axis-aligned boxes of width 1 at once.  The
+ * candidate axes are the box normals, the triangle normal, and the
+ * cross products of each edge with each box normal.  Boxes that
+ * touch the polygon are considered to intersect it.
+ *
+ * @param nv     The number of vertices, 3 for a triangle or 2 for
+ *               a line segment
+ * @param ps     The vertices of the polygon
+ * @param norm   The normal of the triangle, or NULL for a segment
+ * @param qs     The x, y, and z coordinates of the box centers
+ *
+ * @return   Returns a bitmask, where bit i is set iff the i'th
+ *           box is separated from the polygon.
+ */
+static int separated_lanes(unsigned int nv, const double* const* ps,
+                           const double* norm, const simd::vec4d* qs)
+{
+	simd::vec4d sep;
+	double a[3];
+	unsigned int i, j;
+
+	/* no boxes are separated yet */
+	sep = simd::vec4d(0.0);
+
+	/* test the normals of the boxes */
+	for(j = 0; j < 3; j++)
+	{
+		a[0] = a[1] = a[2] = 0;
+		a[j] = 1;
+		separate_on_axis(a, nv, ps, qs, sep);
+	}
+
+	/* test the normal of the triangle */
+	if(norm != NULL)
+		separate_on_axis(norm, nv, ps, qs, sep);
+
+	/* test the cross product of each edge with each box
+	 * normal.  A segment has only one edge. */
+	for(i = 0; i < ((nv == 2) ? 1 : nv); i++)
+	{
+		const double* u = ps[i];
+		const double* v = ps[(i+1) % nv];
+		for(j = 0; j < 3; j++)
+		{
+			/* a = (v - u) x e_j */
+			a[j] = 0;
+			a[(j+1)%3] = v[(j+2)%3] - u[(j+2)%3];
+			a[(j+2)%3] = u[(j+1)%3] - v[(j+1)%3];
+			separate_on_axis(a, nv, ps, qs, sep);
+		}
+	}
+
+	/* return the result as a bitmask */
+	return simd::movemask(sep);
+}
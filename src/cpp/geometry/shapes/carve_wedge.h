@@ -22,6 +22,7 @@
  */
 
 #include <geometry/carve/gaussian/carve_map.h>
+#include <geometry/carve/gaussian/carve_map_batch.h>
 #include <geometry/octree/shape.h>
 #include <geometry/octree/octdata.h>
 #include <iostream>
@@ -30,6 +31,7 @@
 /* the following defines are used for this class */
 #define NUM_MAPS_PER_WEDGE 4 /* number of scanpoints to make a wedge */
 #define NUM_VERTICES_PER_WEDGE 6 /* number of vertices in polyhedron */
+#define NUM_TRIANGLES_PER_WEDGE 10 /* number of triangles to test */
 
 /**
  * This class represents a 3D shape formed by four scan points
@@ -48,6 +50,10 @@ class carve_wedge_t : public shape_t
 		 * maps, which is handled elsewhere. */
 		carve_map_t* maps[NUM_MAPS_PER_WEDGE];
 
+		/* the parameters of the above maps, packed so that
+		 * all of them can be evaluated together */
+		carve_map_batch_t batch;
+
 		/* the following define the world-coordinate vertices
 		 * of this wedge.  These vertices are placed outside
 		 * the mean-positions of the scans, so that the wedge
@@ -63,6 +69,11 @@ class carve_wedge_t : public shape_t
 		 * have to recompute them every time. */
 		double d12, d45, d03, d14, d25;
 
+		/* the normal vectors of the triangles of this wedge,
+		 * which are cached for the separating-axis tests in
+		 * intersects_block().  These are not normalized. */
+		Eigen::Vector3d norms[NUM_TRIANGLES_PER_WEDGE];
+
 		/**
 		 * Indicates whether the wedge should interpolate
 		 * its shape for intersection tests.
@@ -109,10 +120,38 @@ class carve_wedge_t : public shape_t
 		 * @param nb   number of standard deviations of buffer
 		 * @param interp   Whether to interpolate in intersection
 		 *                 tests.
+		 * @param acc      The accuracy of the vectorized evaluation
+		 *                 of the carve maps.
 		 */
 		void init(carve_map_t* a1, carve_map_t* a2,
 		          carve_map_t* b1, carve_map_t* b2,
-			  double nb, bool interp);
+			  double nb, bool interp,
+			  carve_map_batch_t::ACCURACY acc
+				= carve_map_batch_t::ACCURACY_HIGH);
+
+		/**
+		 * Initialize only the shape of this wedge
+		 *
+		 * Sets the vertices of this wedge the same way as init(),
+		 * from the values each carve map would report, but does
+		 * not reference any carve maps.  A wedge initialized this
+		 * way can be tested with intersects(), but can not be
+		 * applied to any nodes.
+		 *
+		 * Each array is given in the order a1, a2, b1, b2, as
+		 * in init().
+		 *
+		 * @param s_means  The sensor means of the maps
+		 * @param p_means  The scan point means of the maps
+		 * @param p_vars   The scan point variances of the maps
+		 *                 along their rays
+		 * @param nb       number of standard deviations of buffer
+		 * @param interp   Whether to interpolate in intersection
+		 *                 tests.
+		 */
+		void init_shape(const Eigen::Vector3d* s_means,
+		                const Eigen::Vector3d* p_means,
+		                const double* p_vars, double nb, bool interp);
 
 		/*-----------*/
 		/* accessors */
@@ -153,6 +192,25 @@ class carve_wedge_t : public shape_t
 		 * @return    Returns true iff this intersects given box
 		 */
 		bool intersects(const Eigen::Vector3d& c, double hw) const;
+
+		/**
+		 * Checks if this shape intersects a block of boxes
+		 *
+		 * Gives the same results as calling intersects() on
+		 * each box, but transforms the wedge once for the
+		 * whole block, and tests four boxes at a time with
+		 * vectorized separating-axis tests against each
+		 * triangle of the wedge.
+		 *
+		 * @param n      The number of boxes
+		 * @param cs     The centers of the boxes
+		 * @param hw     The half-width of the boxes
+		 * @param hits   Where to store whether this wedge
+		 *               intersects each box
+		 */
+		void intersects_block(unsigned int n,
+		                      const Eigen::Vector3d* cs,
+		                      double hw, bool* hits) const;
 		
 		/**
 		 * Helper function for intersection()
@@ -207,6 +265,22 @@ class carve_wedge_t : public shape_t
 		octdata_t* apply_to_leaf(const Eigen::Vector3d& c,
 		                         double hw, octdata_t* d);
 
+		/**
+		 * Applies this mapping to a block of sibling leaves
+		 *
+		 * Performs the same operation as apply_to_leaf() on
+		 * each of the given leaves, evaluating the carve maps
+		 * of this wedge for the whole block at once.
+		 *
+		 * @param n     The number of leaves
+		 * @param cs    The locations of the leaves in space
+		 * @param hw    The half-width of the leaves
+		 * @param ds    The data elements to modify, can be null
+		 */
+		void apply_to_leaves(unsigned int n,
+		                     const Eigen::Vector3d* cs,
+		                     double hw, octdata_t** ds);
+
 		/*-----------*/
 		/* debugging */
 		/*-----------*/
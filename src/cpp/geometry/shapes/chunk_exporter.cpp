@@ -25,7 +25,7 @@
  * that can be inserted into an octree.  By inserting this shape,
  * the tree's data elements will be created but not populated, and
  * the information about which shapes intersect which nodes will
- * be exported as chunk files.
+ * be exported as chunks, packed into a single .chunkarchive file.
  *
  * This class requires the Eigen framework.
  * This class requires Boost Filesystem.
@@ -44,8 +44,8 @@ chunk_exporter_t::chunk_exporter_t()
 	this->reference_shape    = NULL;
 	this->vals.clear();
 	this->chunklist_filename = "";
-	this->full_chunk_dir     = "";
 	this->rel_chunk_dir      = "";
+	this->rel_archive        = "";
 }
 
 chunk_exporter_t::~chunk_exporter_t()
@@ -74,33 +74,53 @@ void chunk_exporter_t::set(shape_t* rs, const vector<point_index_t>& v)
 }
 		
 #define FILE_SEP_CHARS "\\/"
-void chunk_exporter_t::open(const string& clfile, const string& chunk_dir)
+#define DEFAULT_ARCHIVE_NAME "chunks"
+int chunk_exporter_t::open(const string& clfile, const string& chunk_dir)
 {
+	boost::filesystem::path archivefile;
+	string dir;
 	size_t found;
+	int ret;
 
 	/* copy over file names */
 	this->chunklist_filename = clfile;
 	this->rel_chunk_dir = chunk_dir;
 
-	/* determine path to chunk dir from working directory */
+	/* the archive is named after the chunk directory, without
+	 * any trailing separators */
+	this->rel_archive = chunk_dir;
+	while(!(this->rel_archive.empty()) 
+			&& this->rel_archive.find_last_of(FILE_SEP_CHARS)
+				== this->rel_archive.size()-1)
+		this->rel_archive.erase(this->rel_archive.size()-1);
+	if(this->rel_archive.empty())
+		this->rel_archive = DEFAULT_ARCHIVE_NAME;
+	this->rel_archive += CHUNKARCHIVE_EXTENSION;
+
+	/* determine path to archive from working directory */
 	found = clfile.find_last_of(FILE_SEP_CHARS);
 	if(found == string::npos)
-	{
-		/* in working directory, no work needs to be done */
-		this->full_chunk_dir = chunk_dir;
-		return;
-	}
-	
-	/* prepend path to chunklists directory to the chunk_dir */
-	this->full_chunk_dir = clfile.substr(0, found+1) + chunk_dir;
-	if(this->full_chunk_dir.find_last_of(FILE_SEP_CHARS)
-			!= this->full_chunk_dir.size()-1)
-	{	
-		/* make sure the full chunk directory ends with
-		 * a file separator, so we can easily generate
-		 * the filepaths to chunk files */
-		this->full_chunk_dir.push_back(FILE_SEPERATOR);
-	}
+		dir = ""; /* in working directory */
+	else
+		dir = clfile.substr(0, found+1);
+	archivefile = dir + this->rel_archive;
+
+	/* make sure the directory for the archive exists 
+	 *
+	 * Since we don't care about whether the directory
+	 * already existed, we don't need to check the return
+	 * code. */
+	if(archivefile.has_parent_path())
+		boost::filesystem::create_directories(
+				archivefile.parent_path());
+
+	/* open the archive for writing */
+	ret = this->archive.open(archivefile.string());
+	if(ret)
+		return PROPEGATE_ERROR(-1, ret);
+
+	/* success */
+	return 0;
 }
 		
 int chunk_exporter_t::close(const octree_t& tree)
@@ -133,22 +153,28 @@ int chunk_exporter_t::close(const octree_t& tree)
 int chunk_exporter_t::close(double cx, double cy, double cz, double hw)
 {
 	chunklist_writer_t outfile;
-	map<octdata_t*, chunk_writer_t*>::iterator mit;
+	map<octdata_t*, size_t>::iterator mit;
 	int ret;
 
-	/* close all open chunk files */
-	for(mit = this->chunk_map.begin();
-			mit != this->chunk_map.end(); mit++)
-		mit->second->close();
+	/* finish writing the archive */
+	ret = this->archive.close();
+	if(ret)
+	{
+		this->chunk_map.clear();
+		return PROPEGATE_ERROR(-1, ret);
+	}
 
 	/* prepare the chunklist file for writing */
 	outfile.init(cx, cy, cz, hw, this->rel_chunk_dir,
-	             this->chunk_map.size());
+	             this->chunk_map.size(), this->rel_archive);
 
 	/* open the file for writing */
 	ret = outfile.open(this->chunklist_filename);
 	if(ret)
-		return PROPEGATE_ERROR(-1, ret);
+	{
+		this->chunk_map.clear();
+		return PROPEGATE_ERROR(-2, ret);
+	}
 
 	/* write each chunk uuid to file */
 	for(mit = this->chunk_map.begin();
@@ -160,13 +186,6 @@ int chunk_exporter_t::close(double cx, double cy, double cz, double hw)
 
 	/* clean up */
 	outfile.close();
-	for(mit = this->chunk_map.begin();
-			mit != this->chunk_map.end(); mit++)
-	{
-		/* free allocated writer */
-		delete (mit->second);
-		mit->second = NULL;
-	}
 	this->chunk_map.clear();
 
 	/* success */
@@ -176,38 +195,22 @@ int chunk_exporter_t::close(double cx, double cy, double cz, double hw)
 octdata_t* chunk_exporter_t::apply_to_leaf(const Vector3d& c,
                                            double hw, octdata_t* d)
 {
-	string filename, uuid_str;
-	boost::filesystem::path chunkfile;
-	unsigned long long uuid;
-	map<octdata_t*, chunk_writer_t*>::iterator mit;
-	pair<map<octdata_t*, chunk_writer_t*>::iterator, bool> ins;
+	map<octdata_t*, size_t>::iterator mit;
+	pair<map<octdata_t*, size_t>::iterator, bool> ins;
 	vector<point_index_t>::iterator vit;
-	int ret;
 
-	/* check if chunk file already exists for this data */
+	/* check if chunk already exists for this data */
 	if(d == NULL)
 	{
 		/* prepare a new data object */
 		d = new octdata_t();
 	
-		/* create a chunk file based on this data object */
-		uuid = (unsigned long long) d;
-		uuid_str = chunk_exporter_t::ptr_to_uuid(d);
-		filename = chunklist_reader_t::get_chunkfile_for(
-				this->full_chunk_dir, uuid_str);
-
-		/* make sure the directory tree for this file exists 
-		 *
-		 * Since we don't care about whether the directory
-		 * already existed, we don't need to check the return
-		 * code. */
-		chunkfile = filename;
-		boost::filesystem::create_directories(
-				chunkfile.parent_path());
-
-		/* insert into map */
-		ins = this->chunk_map.insert(pair<octdata_t*,
-				chunk_writer_t*>(d, new chunk_writer_t()));
+		/* create a chunk in the archive based on this data
+		 * object, and insert into map */
+		ins = this->chunk_map.insert(pair<octdata_t*, size_t>(d,
+				this->archive.add_chunk(
+					(unsigned long long) d,
+					c(0), c(1), c(2), hw)));
 		if(!(ins.second))
 		{
 			/* We've already inserted this data pointer!?!?
@@ -222,18 +225,6 @@ octdata_t* chunk_exporter_t::apply_to_leaf(const Vector3d& c,
 
 		/* keep the iterator */
 		mit = ins.first;
-
-		/* prepare file for writing */
-		mit->second->init(uuid, c(0), c(1), c(2), hw);
-		ret = mit->second->open(filename);
-		if(ret)
-		{
-			/* unable to open file! */
-			cerr << "[chunk_exporter_t::apply_to_leaf]\t"
-			     << "Error " << ret << ": Unable to write "
-			     << "to chunk file" << endl << endl;
-			return d;
-		}
 	}
 	else
 	{
@@ -250,16 +241,17 @@ octdata_t* chunk_exporter_t::apply_to_leaf(const Vector3d& c,
 			     << "WARNING: need to insert pre-existing data"
 			     << endl << endl;
 			ins = this->chunk_map.insert(pair<octdata_t*,
-				chunk_writer_t*>(d, new chunk_writer_t()));
+				size_t>(d, this->archive.add_chunk(
+					(unsigned long long) d,
+					c(0), c(1), c(2), hw)));
 			mit = ins.first;
 		}
 	}
 
-	/* add all values to file */
+	/* add all values to chunk */
 	for(vit = this->vals.begin(); vit != this->vals.end(); vit++)
-		mit->second->write(*vit);
+		this->archive.write(mit->second, *vit);
 
 	/* success */
 	return d;
 }
-
@@ -12,7 +12,7 @@
  * that can be inserted into an octree.  By inserting this shape,
  * the tree's data elements will be created but not populated, and
  * the information about which shapes intersect which nodes will
- * be exported as chunk files.
+ * be exported as chunks, packed into a single .chunkarchive file.
  *
  * This class requires the Eigen framework.
  */
@@ -47,13 +47,21 @@ class chunk_exporter_t : public shape_t
 		 *
 		 * All observed leafs are exported as chunks.  Each leaf
 		 * is uniquely identified by the address of its data. This
-		 * list of file descriptors is kept so that one
-		 * chunk file is generated for each leaf that contains
-		 * all intersection information, over many inserted
-		 * shapes.  These files will be maintained until
-		 * this object is closed.
+		 * map gives the index of each leaf's chunk within the
+		 * archive, so that one chunk is generated for each leaf
+		 * that contains all intersection information, over many
+		 * inserted shapes.
 		 */
-		std::map<octdata_t*, chunk::chunk_writer_t*> chunk_map;
+		std::map<octdata_t*, size_t> chunk_map;
+
+		/**
+		 * The archive that all chunks are written to
+		 *
+		 * Chunk contents are streamed to this archive as they
+		 * are generated, so only a bounded amount is kept in
+		 * memory.
+		 */
+		chunk::chunk_archive_writer_t archive;
 
 		/**
 		 * This value represents the current shape to intersect
@@ -84,10 +92,10 @@ class chunk_exporter_t : public shape_t
 		std::string chunklist_filename;
 
 		/**
-		 * The directory to store the .chunk files
+		 * The location of the .chunkarchive file
 		 */
-		std::string full_chunk_dir; /* relative to working dir */
 		std::string rel_chunk_dir; /* relative to chunklist file */
+		std::string rel_archive; /* relative to chunklist file */
 
 	/* functions */
 	public:
@@ -136,32 +144,34 @@ class chunk_exporter_t : public shape_t
 		 *
 		 * This function must be called before performing any
 		 * inserts with this object.  This function specifies the
-		 * location of the .chunklist and corresponding .chunk
-		 * files.
+		 * location of the .chunklist and corresponding 
+		 * .chunkarchive file.
 		 *
-		 * When specifying the relative directory for the .chunk
-		 * files, note that this is relative to the location
+		 * The chunks are packed into an archive named after
+		 * the given chunk directory, relative to the location
 		 * of the .chunklist file, so if:
 		 *
 		 * clfile = "foo/bar/list.chunklist"
 		 * chunk_dir = "baz"
 		 *
-		 * then the chunk files will be stored in:
+		 * then the chunks will be stored in:
 		 *
-		 * foo/bar/baz/<chunkname>.chunk
+		 * foo/bar/baz.chunkarchive
 		 *
 		 * @param clfile     Where to write the chunklist file
-		 * @param chunk_dir  The relative directory to store chunks
+		 * @param chunk_dir  The relative name to store chunks
+		 *
+		 * @return    Returns zero on success, non-zero on failure.
 		 */
-		void open(const std::string& clfile,
+		int open(const std::string& clfile,
 		         const std::string& chunk_dir);
 
 		/**
 		 * Will generate a .chunklist file and close all chunks.
 		 *
-		 * Calling this function will close all file streams to
-		 * chunks that are currently active, and will generate
-		 * a corresponding .chunklist file for these chunks.
+		 * Calling this function will finish writing the chunk
+		 * archive, and will generate a corresponding .chunklist
+		 * file for these chunks.
 		 *
 		 * After this call, you must make another call to open()
 		 * to use this object again.
@@ -245,11 +255,11 @@ class chunk_exporter_t : public shape_t
 		};
 
 		/**
-		 * Will update chunk file for this leaf
+		 * Will update chunk for this leaf
 		 *
 		 * By calling this, will generate/append the current
-		 * chunk values to the chunk file associated with this
-		 * leaf.  The file is hashed by the address of the leaf's
+		 * chunk values to the chunk associated with this
+		 * leaf.  The chunk is hashed by the address of the leaf's
 		 * data. If the leaf has no data, then a data object will
 		 * be allocated to the leaf and returned.
 		 *
@@ -3,6 +3,8 @@
 #include <list>
 #include <set>
 #include <string>
+#include <boost/thread/shared_mutex.hpp>
+#include <boost/thread/locks.hpp>
 #include <opencv2/opencv.hpp>
 #include <opencv2/highgui/highgui.hpp>
 
@@ -31,6 +33,7 @@ image_cache_t::~image_cache_t()
 void image_cache_t::set_capacity(unsigned int s)
 {
 	/* reset capacity value */
+	boost::unique_lock<boost::shared_mutex> lock(this->mtx);
 	this->capacity = s;
 
 	/* make sure we are not over capacity */
@@ -40,6 +43,7 @@ void image_cache_t::set_capacity(unsigned int s)
 void image_cache_t::clear()
 {
 	/* clear all structures in this object */
+	boost::unique_lock<boost::shared_mutex> lock(this->mtx);
 	this->image_list.clear();
 	this->lookup.clear();
 }
@@ -47,42 +51,63 @@ void image_cache_t::clear()
 int image_cache_t::get(const string& path, Mat& m)
 {
 	cache_map_t::iterator it;
+	Mat img;
 
-	/* check if this image is in the cache */
-	it = this->lookup.find(path);
-	if(it == this->lookup.end())
+	/* the most recent image is the one a thread usually needs, and
+	 * getting it doesn't reorder the cache, so readers can share */
 	{
-		/* not in cache, retrieve from filesystem */ 
-		m = imread(path, CV_LOAD_IMAGE_COLOR);
-		if(m.data == NULL)
-			return -1; /* could not load from file */
-
-		/* store in cache as the most recent item */
-		this->image_list.push_front(image_cache_element_t(path, m));
+		boost::shared_lock<boost::shared_mutex> lock(this->mtx);
+		it = this->lookup.find(path);
+		if(it != this->lookup.end()
+				&& it->second == this->image_list.begin())
+		{
+			/* shallow copy image to given Mat */
+			m = it->second->image;
+			return 0;
+		}
+	}
 
-		/* store reference in lookup map */
-		this->lookup.insert(pair<string, listptr_t>(
-		                    path, this->image_list.begin()));
+	/* otherwise, wait until no other thread is reading this image */
+	boost::unique_lock<boost::shared_mutex> lock(this->mtx);
+	while(this->loading.count(path))
+		this->loaded.wait(lock);
 
-		/* ensure that the cache is not over-capacity */
-		this->enforce_capacity();
-	}
-	else
+	/* check if this image is in the cache */
+	it = this->lookup.find(path);
+	if(it != this->lookup.end())
 	{
 		/* shallow copy image to given Mat */
 		m = it->second->image;
 		
 		/* set this image to be the most recent item in cache */
-		if(it->second != this->image_list.begin())
-		{
-			/* not already first in list, erase and reinsert */
-			this->image_list.push_front(*(it->second));
-			this->image_list.erase(it->second);
-			it->second = this->image_list.begin();
-		}
+		this->image_list.splice(this->image_list.begin(),
+		                        this->image_list, it->second);
+		return 0;
 	}
+
+	/* not in cache, retrieve from filesystem without the lock, so
+	 * that other threads can use the cache while it is read */
+	this->loading.insert(path);
+	lock.unlock();
+	img = imread(path, CV_LOAD_IMAGE_COLOR);
+	lock.lock();
+	this->loading.erase(path);
+	this->loaded.notify_all();
+	if(img.data == NULL)
+		return -1; /* could not load from file */
+
+	/* store in cache as the most recent item */
+	this->image_list.push_front(image_cache_element_t(path, img));
+
+	/* store reference in lookup map */
+	this->lookup.insert(pair<string, listptr_t>(
+	                    path, this->image_list.begin()));
+
+	/* ensure that the cache is not over-capacity */
+	this->enforce_capacity();
 	
 	/* success */
+	m = img;
 	return 0;
 }
 		
@@ -91,6 +116,7 @@ void image_cache_t::print_status()
 	listptr_t lit;
 
 	/* print out capacity information */
+	boost::unique_lock<boost::shared_mutex> lock(this->mtx);
 	cout << "cache size: " << this->image_list.size() << " / "
 	     << this->capacity << " :" << endl;
 	
@@ -10,14 +10,20 @@
  * This file defines the image_cache_t, which reads imagery
  * from the filesystem for quick access, and will maintain
  * cache size based on the class parameters by freeing memory
- * for the least recently used items.
+ * for the least recently used items.  The cache is thread-safe,
+ * so one camera's images can be shared by several threads.  Threads
+ * that find their image in the cache only share a reader lock, and
+ * images are read from disk without holding the lock.
  *
  * This code links to OpenCV 2.4.7
  */
 
 #include <list>
 #include <map>
+#include <set>
 #include <string>
+#include <boost/thread/shared_mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
 #include <opencv2/opencv.hpp>
 
 /* the following classes are defined in this file */
@@ -63,6 +69,19 @@ class image_cache_t
 		 * representation of that image. */
 		cache_map_t lookup;
 
+		/* The paths of the images that are being read from disk
+		 * by some thread, which are not yet in the cache */
+		std::set<std::string> loading;
+
+		/* This mutex is locked by each public function, so
+		 * that the cache can be accessed from multiple threads.
+		 * Look-ups of the most recent image only lock it shared,
+		 * since they don't change the cache. */
+		boost::shared_mutex mtx;
+
+		/* signaled when a thread finishes reading an image */
+		boost::condition_variable_any loaded;
+
 	/* functions */
 	public:
 
@@ -104,6 +123,11 @@ class image_cache_t
 		 * disk, stored in the cache, and stored in the 
 		 * specified Mat.
 		 *
+		 * The image is read without locking the cache, so other
+		 * threads can get images in the meantime.  Threads that
+		 * need the same image wait for it, so an image that
+		 * several threads need is only read once.
+		 *
 		 * @param path   The path to the image to retrieve
 		 * @param m      Where to store the retrieved image
 		 *
@@ -1,17 +1,19 @@
 #include "scanorama.h"
 #include "scanorama_point.h"
-#include <image/fisheye/fisheye_camera.h>
+#include <image/camera.h>
 #include <util/tictoc.h>
 #include <util/error_codes.h>
 #include <util/progress_bar.h>
-#include <libe57/E57Foundation.h>
-#include <libe57/E57Simple.h>
 #include <lodepng/lodepng.h>
 #include <Eigen/Dense>
+#include <boost/threadpool.hpp>
+#include <boost/bind.hpp>
 #include <iostream>
 #include <cstring>
+#include <algorithm>
 #include <vector>
 #include <cmath>
+#include <cfloat>
 
 /**
  * @file     scanorama.cpp
@@ -28,6 +30,16 @@
 using namespace std;
 using namespace Eigen;
 
+/* the width of the square tiles of points that are traced together,
+ * so that each tile is one packet of rays */
+#define SCANORAMA_TILE_SIZE 4
+
+/* the number of columns traced by each task, which is a multiple of the
+ * tile size, and the number of points colored by each task, when a
+ * scanorama is processed in parallel */
+#define SCANORAMA_COLUMNS_PER_TASK 64
+#define SCANORAMA_POINTS_PER_TASK  65536
+
 /*--------------------------*/
 /* function implementations */
 /*--------------------------*/
@@ -91,22 +103,15 @@ void scanorama_t::init_sphere(double t, const Eigen::Vector3d& cen,
 		}
 }
 		
-int scanorama_t::init_geometry(const OctTree<float>& octree,
+int scanorama_t::init_geometry(const BVH<float>& model,
 				double t, const Eigen::Vector3d& cen,
-				size_t r, size_t c, double bw)
+				size_t r, size_t c, double bw,
+				unsigned int nt)
 {
-	progress_bar_t progbar;
-	double radius, theta, phi, dt, dp, w, x, y, z, nx, ny, nz, unitwidth;
-	float origin[3]; /* origin of raytracing */
-	float d[3]; /* raytracing direction */
-	float inter[3]; /* intersection point */
-	size_t triangleID;
-	size_t ri, ci, i;
-	bool suc;
+	size_t tj;
 
 	/* first, clear any existing information */
 	this->clear();
-	progbar.set_name("   Pose geometry");
 
 	/* next, allocate the appropriate number of points */
 	this->points.resize(r*c);
@@ -116,83 +121,20 @@ int scanorama_t::init_geometry(const OctTree<float>& octree,
 	this->num_cols   = c;
 	this->blendwidth = bw;
 
-	/* copy scan center to be origin of raytracing */
-	origin[0] = this->center[0];
-	origin[1] = this->center[1];
-	origin[2] = this->center[2];
-
-	/* iterate over the points and define the geometry of a sphere */
-	radius = 1; /* direction is unit-vector */
-	dt = (2 * M_PI) / this->num_cols; /* delta-theta */
-	dp = (M_PI) / this->num_rows; /* delta-phi */
-	unitwidth = sin( (dt+dp) / 4.0 );
-	for(ci = 0; ci < this->num_cols; ci++) /* column-major order */
+	/* trace blocks of columns in parallel.  The pool waits for
+	 * all tasks when it goes out of scope */
+	if(nt <= 1)
 	{
-		/* update progress bar */
-		progbar.update(ci, this->num_cols);
-
-		/* iterate over rows */
-		for(ri = 0; ri < this->num_rows; ri++)
-		{
-			/* we want to set the current point to reside
-			 * on the unit sphere centered at this->center */
-			theta = dt * ci;
-			phi   = dp * ri;
-			w     = radius * sin(phi);
-			d[2]  = radius * cos(phi);
-			d[1]  =      w * sin(theta);
-			d[0]  =     -w * cos(theta);
-
-			/* perform a raytrace from the scan center along
-			 * the direction vector d to determine
-			 * the location of the scan point */
-			suc = octree.ray_trace(origin,d,inter,&triangleID);
-			if(!suc)
-			{
-				/* unable to raytrace, set depth
-				 * to be zero */
-				x = origin[0];
-				y = origin[1];
-				z = origin[2];
-				nx = ny = nz = 0;
-			}
-			else
-			{
-				/* successfully raytraced, so determine
-				 * position of intersect point in
-				 * the scan's coordinate system */
-				x = inter[0] - origin[0];
-				y = inter[1] - origin[1];
-				z = inter[2] - origin[2];
-				
-				/* get the triangle object that was hit */
-				const Triangle3<float>& tri = octree.triangle(
-								triangleID);
-				nx = tri.normal(0);
-				ny = tri.normal(1);
-				nz = tri.normal(2);
-			}
-
-			/* store in appropriate point */
-			i = ci*this->num_rows + ri; /* column major */
-			this->points[i].x  = x;
-			this->points[i].y  = y;
-			this->points[i].z  = z;
-			this->points[i].nx = nx;
-			this->points[i].ny = ny;
-			this->points[i].nz = nz;
-
-			/* estimate the uncertainty width of
-			 * this point, based on half the average
-			 * of the angular difference between points */
-			this->points[i].width = 
-				sqrt(x*x + y*y + z*z) * unitwidth;
-
-			/* No color has been assigned yet, so set
-			 * it to black */
-			this->points[i].color.set(0.0f,0.0f,0.0f);
-			this->points[i].quality = -DBL_MAX;
-		}
+		this->trace_columns(&model, 0, this->num_cols);
+		return 0;
+	}
+	{
+		boost::threadpool::pool tp(nt);
+		for(tj = 0; tj < this->num_cols;
+				tj += SCANORAMA_COLUMNS_PER_TASK)
+			tp.schedule(boost::bind(&scanorama_t::trace_columns,
+				this, &model, tj, std::min(this->num_cols,
+				tj + SCANORAMA_COLUMNS_PER_TASK)));
 	}
 
 	/* success */
@@ -201,81 +143,50 @@ int scanorama_t::init_geometry(const OctTree<float>& octree,
 		
 int scanorama_t::apply(camera_t* cam)
 {
-	progress_bar_t progbar;
-	color_t newcolor;
-	double px, py, pz, q;
-	double dq, w1, w2;
-	int ret, r, g, b;
-	size_t i, n;
+	vector<camera_t*> cams(1, cam);
+	int ret;
 
-	/* iterate through all points */
-	progbar.set_name("  Applying image");
+	/* color all points with this camera */
+	this->apply_range(&cams, 0, this->points.size(), &ret);
+	return ret;
+}
+		
+int scanorama_t::apply(const std::vector<camera_t*>& cams,
+				unsigned int nt)
+{
+	vector<int> rets;
+	size_t k, n, num_tasks;
+
+	/* color blocks of points in parallel */
 	n = this->points.size();
-	for(i = 0; i < n; i++)
+	num_tasks = (n + SCANORAMA_POINTS_PER_TASK - 1)
+			/ SCANORAMA_POINTS_PER_TASK;
+	rets.resize(num_tasks, 0);
+	if(nt <= 1)
 	{
-		/* update progress bar */
-		progbar.update(i,n);
-
-		/* get the world coordinates for the current point */
-		px = this->center(0) + this->points[i].x;
-		py = this->center(1) + this->points[i].y;
-		pz = this->center(2) + this->points[i].z;
-
-		/* get the color of this point according to the argument
-		 * camera */
-		ret = cam->color_point_antialias(px,py,pz, 
-				this->points[i].width,
-				this->timestamp,r,g,b,q);
-		if(ret)
-		{
-			/* report error */
-			ret = PROPEGATE_ERROR(-1, ret);
-			cerr << "[scanorama_t::apply]\tError " 
-			     << ret << ": Unable to color point #"
-			     << i << "/" << n << endl;
-			return ret;
-		}
-
-		/* check if the quality is better */
-		dq = q - this->points[i].quality;
-		if(q < 0)
-		{
-			/* if quality is negative, we don't want it */
-			continue;
-		}
-		else if(fabs(dq) < this->blendwidth)
-		{
-			/* This point has already been colored, and 
-			 * the new image provides roughly the same quality
-			 * of coloring.  Rather than replace the color,
-			 * we should perform a blending to allow for
-			 * smooth transistions between texture sources.
-			 *
-			 * We want to average the values together,
-			 * weighted on their qualtiy */
-			newcolor.set_ints(r,g,b);
-
-			/* Get the weighting of the new color
-			 *
-			 * Blending is linear across the blending width */
-			w2 = (dq + this->blendwidth)/(2 * this->blendwidth);
-
-			/* weight of original color */
-			w1 = 1 - w2; 
-
-			/* apply the average */
-			this->points[i].color
-				= ( this->points[i].color * w1 )
-				+ ( newcolor * w2 );
-		}
-		else if(q > this->points[i].quality)
-		{
-			/* replace the color */
-			this->points[i].quality = q;
-			this->points[i].color.set_ints(r,g,b);
-		}
+		for(k = 0; k < num_tasks; k++)
+			this->apply_range(&cams,
+				k*SCANORAMA_POINTS_PER_TASK,
+				std::min(n, (k+1)*SCANORAMA_POINTS_PER_TASK),
+				&(rets[k]));
+	}
+	else
+	{
+		/* the pool waits for all tasks when it goes out
+		 * of scope */
+		boost::threadpool::pool tp(nt);
+		for(k = 0; k < num_tasks; k++)
+			tp.schedule(boost::bind(&scanorama_t::apply_range,
+				this, &cams, k*SCANORAMA_POINTS_PER_TASK,
+				std::min(n, (k+1)*SCANORAMA_POINTS_PER_TASK),
+				&(rets[k])));
 	}
 
+	/* check for errors */
+	for(k = 0; k < num_tasks; k++)
+		if(rets[k])
+			return PROPEGATE_ERROR(-1, rets[k]);
+
 	/* success */
 	return 0;
 }
@@ -530,192 +441,6 @@ int scanorama_t::writeptg(const std::string& filename) const
 	return 0;
 }
 
-int scanorama_t::writee57(const std::string& filename) const
-{
-	progress_bar_t progbar;
-	string coordinate_metadata(""); /* optional string */
-	e57::Writer outfile(filename, coordinate_metadata);
-	e57::Data3D header;
-	double*   xdata;
-	double*   ydata;
-	double*   zdata;
-	int8_t*   xyzinvalid;
-	double*   intdata; /* intensity */
-	int8_t*   intinvalid;
-	uint16_t* reddata;
-	uint16_t* greendata;
-	uint16_t* bluedata;
-	int8_t*   colorinvalid;
-	int32_t*  rowindex;
-	int32_t*  colindex;
-	double*   timedata;
-	size_t bpos, epos, nSize, r, c, i;
-	int scan_index;
-
-	/* make sure the file is open */
-	if(!(outfile.IsOpen()))
-	{
-		cerr << "[scanorama_t::writee57]\tUnable to open output "
-		     << "file: \"" << filename << "\"" << endl;
-		return -1;
-	}
-
-	/* get the name of this scan position by parsing the filename */
-	bpos = filename.find_last_of("\\/");
-	if(bpos == string::npos)
-		bpos = 0;
-	else
-		bpos++;
-	epos = filename.find_last_of(".");
-	header.name = filename.substr(bpos, epos);
-
-	/* populate the header of the output e57 file */
-	header.guid = "{D3817EC3-A3DD-4a81-9EF5-2FFD0EC91D5A}";
-	header.acquisitionStart.dateTimeValue   = this->timestamp;
-	header.acquisitionEnd.dateTimeValue     = this->timestamp;
-	header.pointsSize                       = this->points.size(); 
-	
-	header.pointFields.cartesianXField      = true;
-	header.pointFields.cartesianYField      = true;
-	header.pointFields.cartesianZField      = true;
-	header.pointFields.cartesianInvalidStateField = true;
-	header.pointFields.intensityField       = true;
-	header.pointFields.isIntensityInvalidField = true;
-	header.pointFields.colorRedField        = true;
-	header.pointFields.colorGreenField      = true;
-	header.pointFields.colorBlueField       = true;
-	header.pointFields.isColorInvalidField  = true;
-	header.pointFields.rowIndexField        = true;
-	header.pointFields.columnIndexField     = true;
-	header.pointFields.timeStampField       = true;
-	
-	header.indexBounds.rowMinimum           = 0;
-	header.indexBounds.rowMaximum           = this->num_rows - 1;
-	header.indexBounds.columnMinimum        = 0;
-	header.indexBounds.columnMaximum        = this->num_cols - 1;
-	header.indexBounds.returnMinimum        = 0;
-	header.indexBounds.returnMaximum        = 0;
-	header.intensityLimits.intensityMinimum = 0.0;
-	header.intensityLimits.intensityMaximum = 1.0;
-	header.colorLimits.colorRedMinimum      = 0;
-	header.colorLimits.colorRedMaximum      = 255;
-	header.colorLimits.colorGreenMinimum    = 0;
-	header.colorLimits.colorGreenMaximum    = 255;
-	header.colorLimits.colorBlueMinimum     = 0;
-	header.colorLimits.colorBlueMaximum     = 255;
-	header.pose.rotation.w                  = 1;
-	header.pose.rotation.x                  = 0;
-	header.pose.rotation.y                  = 0;
-	header.pose.rotation.z                  = 0;
-	header.pose.translation.x               = this->center(0);
-	header.pose.translation.y               = this->center(1);
-	header.pose.translation.z               = this->center(2);
-	header.pointGroupingSchemes.groupingByLine.groupsSize 
-						= this->num_cols;
-	header.pointGroupingSchemes.groupingByLine.pointCountSize
-						= this->num_rows;
-	scan_index = outfile.NewData3D(header);
-	
-	/* set up scan buffers to write the points */
-	nSize        = this->num_rows;
-	xdata        = new double[nSize];
-	ydata        = new double[nSize];
-	zdata        = new double[nSize];
-	xyzinvalid   = new int8_t[nSize];
-	intdata      = new double[nSize];
-	intinvalid   = new int8_t[nSize];
-	reddata      = new uint16_t[nSize];
-	greendata    = new uint16_t[nSize];
-	bluedata     = new uint16_t[nSize];
-	colorinvalid = new int8_t[nSize];
-	rowindex     = new int32_t[nSize];
-	colindex     = new int32_t[nSize];
-	timedata     = new double[nSize];
-	e57::CompressedVectorWriter datawriter
-			= outfile.SetUpData3DPointsData(
-					scan_index, /* data block index */
-					nSize, /* size of each buffer */
-					xdata, 
-					ydata,
-					zdata,
-					xyzinvalid,
-					intdata,
-					intinvalid,
-					reddata,
-					greendata,
-					bluedata,
-					colorinvalid,
-					NULL, /* spherical range */
-					NULL, /* spherical azimuth */
-					NULL, /* spherical elevation */
-					NULL, /* spherical invalid */
-					rowindex,
-					colindex,
-					NULL, /* return index */
-					NULL, /* return count */
-					timedata,
-					NULL  /* time invalid */
-					);
-
-	/* iterate over the points, inserting into output file 
-	 *
-	 * Remember, scanoramas are in column-major order */
-	progbar.set_name("   Exporting E57");
-	for(c = 0; c < this->num_cols; c++)
-	{
-		/* update user on progress */
-		progbar.update(c, this->num_cols);
-
-		/* populate buffer with current column */
-		for(r = 0; r < this->num_rows; r++)
-		{
-			/* get index of this point */
-			i = r + (c * this->num_rows);
-
-			/* add this point to the buffers */
-			xdata[r]        = this->points[i].x;
-			ydata[r]        = this->points[i].y;
-			zdata[r]        = this->points[i].z;
-			xyzinvalid[r]   = false;
-			intdata[r]      =
-				this->points[i].color.get_grayscale();
-			intinvalid[r]   = (this->points[i].quality <= 0);
-			reddata[r]      = 
-				this->points[i].color.get_red_int();
-			greendata[r]    =
-				this->points[i].color.get_green_int();
-			bluedata[r]     = 
-				this->points[i].color.get_blue_int();
-			colorinvalid[r] = (this->points[i].quality <= 0);
-			rowindex[r]     = this->num_rows - r - 1;
-			colindex[r]     = c;
-			timedata[r]     = this->timestamp;
-		}
-
-		/* export buffer */
-		datawriter.write(nSize);
-	}
-
-	/* success */
-	progbar.clear();
-	datawriter.close();
-	outfile.Close();
-	delete[] xdata;
-	delete[] ydata;
-	delete[] zdata;
-	delete[] xyzinvalid;
-	delete[] intdata;
-	delete[] intinvalid;
-	delete[] reddata;
-	delete[] greendata;
-	delete[] bluedata;
-	delete[] colorinvalid;
-	delete[] rowindex;
-	delete[] colindex;
-	delete[] timedata;
-	return 0;
-}
-		
 int scanorama_t::writepng(const std::string& filename) const
 {
 	vector<unsigned char> image; /* RGBA pixel values */
@@ -857,3 +582,199 @@ int scanorama_t::writepng_depth(const std::string& filename) const
 	/* success */
 	return 0;
 }
+		
+void scanorama_t::trace_columns(const BVH<float>* model,
+				size_t c_begin, size_t c_end)
+{
+	double radius, theta, phi, dt, dp, w, x, y, z, nx, ny, nz, unitwidth;
+	float origin[3]; /* origin of raytracing */
+	float origins[3*SCANORAMA_TILE_SIZE*SCANORAMA_TILE_SIZE];
+	float dirs[3*SCANORAMA_TILE_SIZE*SCANORAMA_TILE_SIZE];
+	float inters[3*SCANORAMA_TILE_SIZE*SCANORAMA_TILE_SIZE];
+	size_t triangleIDs[SCANORAMA_TILE_SIZE*SCANORAMA_TILE_SIZE];
+	bool hits[SCANORAMA_TILE_SIZE*SCANORAMA_TILE_SIZE];
+	size_t ri, ci, ti, tj, ri_end, ci_end, i, j, k;
+
+	/* copy scan center to be origin of raytracing */
+	origin[0] = this->center[0];
+	origin[1] = this->center[1];
+	origin[2] = this->center[2];
+
+	/* iterate over the points and define the geometry of a sphere,
+	 * tracing square tiles of neighboring points together */
+	radius = 1; /* direction is unit-vector */
+	dt = (2 * M_PI) / this->num_cols; /* delta-theta */
+	dp = (M_PI) / this->num_rows; /* delta-phi */
+	unitwidth = sin( (dt+dp) / 4.0 );
+	for(tj = c_begin; tj < c_end; tj += SCANORAMA_TILE_SIZE)
+	{
+		ci_end = std::min(tj + SCANORAMA_TILE_SIZE, c_end);
+
+		/* iterate over tiles of rows */
+		for(ti = 0; ti < this->num_rows; ti += SCANORAMA_TILE_SIZE)
+		{
+			ri_end = std::min(ti + SCANORAMA_TILE_SIZE,
+						this->num_rows);
+
+			/* we want to set the current point to reside
+			 * on the unit sphere centered at this->center */
+			j = 0;
+			for(ci = tj; ci < ci_end; ci++)
+				for(ri = ti; ri < ri_end; ri++)
+				{
+					theta = dt * ci;
+					phi   = dp * ri;
+					w     = radius * sin(phi);
+					dirs[3*j+2] = radius * cos(phi);
+					dirs[3*j+1] =      w * sin(theta);
+					dirs[3*j]   =     -w * cos(theta);
+					for(k = 0; k < 3; k++)
+						origins[3*j+k] = origin[k];
+					j++;
+				}
+
+			/* perform a raytrace from the scan center along
+			 * each direction vector to determine the
+			 * locations of the scan points */
+			model->ray_trace_packet(j, origins, dirs, inters,
+						triangleIDs, hits);
+
+			/* store the points, in the same order */
+			j = 0;
+			for(ci = tj; ci < ci_end; ci++)
+				for(ri = ti; ri < ri_end; ri++, j++)
+				{
+					if(!hits[j])
+					{
+						/* unable to raytrace, set depth
+						 * to be zero */
+						x = origin[0];
+						y = origin[1];
+						z = origin[2];
+						nx = ny = nz = 0;
+					}
+					else
+					{
+						/* successfully raytraced, so
+						 * determine position of
+						 * intersect point in the
+						 * scan's coordinate system */
+						x = inters[3*j]   - origin[0];
+						y = inters[3*j+1] - origin[1];
+						z = inters[3*j+2] - origin[2];
+
+						/* get the triangle object
+						 * that was hit */
+						const Triangle3<float>& tri
+							= model->triangle(
+							triangleIDs[j]);
+						nx = tri.normal(0);
+						ny = tri.normal(1);
+						nz = tri.normal(2);
+					}
+
+					/* store in appropriate point */
+					i = ci*this->num_rows + ri; /* col major */
+					this->points[i].x  = x;
+					this->points[i].y  = y;
+					this->points[i].z  = z;
+					this->points[i].nx = nx;
+					this->points[i].ny = ny;
+					this->points[i].nz = nz;
+
+					/* estimate the uncertainty width of
+					 * this point, based on half the
+					 * average of the angular difference
+					 * between points */
+					this->points[i].width = 
+						sqrt(x*x + y*y + z*z)
+						* unitwidth;
+
+					/* No color has been assigned yet,
+					 * so set it to black */
+					this->points[i].color.set(0.0f,0.0f,0.0f);
+					this->points[i].quality = -DBL_MAX;
+				}
+		}
+	}
+}
+		
+void scanorama_t::apply_range(const std::vector<camera_t*>* cams,
+				size_t i_begin, size_t i_end, int* ret)
+{
+	color_t newcolor;
+	double px, py, pz, q;
+	double dq, w1, w2;
+	int r, g, b;
+	size_t ci, i;
+
+	/* apply each camera to all points of the range, in order */
+	*ret = 0;
+	for(ci = 0; ci < cams->size(); ci++)
+		for(i = i_begin; i < i_end; i++)
+		{
+			/* get the world coordinates for the current point */
+			px = this->center(0) + this->points[i].x;
+			py = this->center(1) + this->points[i].y;
+			pz = this->center(2) + this->points[i].z;
+
+			/* get the color of this point according to the
+			 * camera */
+			*ret = (*cams)[ci]->color_point_antialias(px,py,pz, 
+					this->points[i].width,
+					this->timestamp,r,g,b,q);
+			if(*ret)
+			{
+				/* report error */
+				*ret = PROPEGATE_ERROR(-1, *ret);
+				cerr << "[scanorama_t::apply]\tError " 
+				     << *ret << ": Unable to color point #"
+				     << i << "/" << this->points.size()
+				     << " with camera "
+				     << (*cams)[ci]->name() << endl;
+				return;
+			}
+
+			/* check if the quality is better */
+			dq = q - this->points[i].quality;
+			if(q < 0)
+			{
+				/* if quality is negative, we don't want it */
+				continue;
+			}
+			else if(fabs(dq) < this->blendwidth)
+			{
+				/* This point has already been colored, and 
+				 * the new image provides roughly the same
+				 * quality of coloring.  Rather than replace
+				 * the color, we should perform a blending to
+				 * allow for smooth transistions between
+				 * texture sources.
+				 *
+				 * We want to average the values together,
+				 * weighted on their qualtiy */
+				newcolor.set_ints(r,g,b);
+
+				/* Get the weighting of the new color
+				 *
+				 * Blending is linear across the blending
+				 * width */
+				w2 = (dq + this->blendwidth)
+					/ (2 * this->blendwidth);
+
+				/* weight of original color */
+				w1 = 1 - w2; 
+
+				/* apply the average */
+				this->points[i].color
+					= ( this->points[i].color * w1 )
+					+ ( newcolor * w2 );
+			}
+			else if(q > this->points[i].quality)
+			{
+				/* replace the color */
+				this->points[i].quality = q;
+				this->points[i].color.set_ints(r,g,b);
+			}
+		}
+}
@@ -14,10 +14,11 @@
  */
 
 #include "scanorama_point.h"
-#include <image/fisheye/fisheye_camera.h>
-#include <geometry/raytrace/OctTree.h>
+#include <image/camera.h>
+#include <geometry/raytrace/BVH.h>
 #include <Eigen/Dense>
 #include <iostream>
+#include <string>
 #include <vector>
 
 /**
@@ -156,22 +157,28 @@ class scanorama_t
 		/**
 		 * Initialize the point geometry from the specified model
 		 *
-		 * Given a mesh model stored in an octree, position each
+		 * Given a mesh model stored in a hierarchy, position each
 		 * point in this scanorama by raytracing from the scan
 		 * center in each pixel direction.
 		 *
-		 * @param octree   The octree model to use
+		 * Blocks of columns are traced in parallel.  Each point
+		 * is computed independently, so the result does not
+		 * depend on the number of threads.
+		 *
+		 * @param model    The model to use
 		 * @param t        The timestamp to set for this scanorama
 		 * @param cen      The center position of this scanorama
 		 * @param r        Number of rows to use
 		 * @param c        Number of columns to use
 		 * @param bw       The blendwidth to use (range [0,1])
+		 * @param nt       The number of threads to use
 		 *
 		 * @return     Returns zero on success, non-zero on failure.
 		 */
-		int init_geometry(const OctTree<float>& octree,
+		int init_geometry(const BVH<float>& model,
 				double t, const Eigen::Vector3d& cen,
-				size_t r, size_t c, double bw);
+				size_t r, size_t c, double bw,
+				unsigned int nt = 1);
 
 		/*-------*/
 		/* color */
@@ -192,6 +199,25 @@ class scanorama_t
 		 */
 		int apply(camera_t* cam);
 
+		/**
+		 * Applies color of a list of cameras to this scanorama
+		 *
+		 * Has the same result as calling apply() for each
+		 * camera in order.  Blocks of points are colored in
+		 * parallel, and each block applies the cameras in
+		 * order, so every point is blended in the same order
+		 * as it would be by the serial calls.  The cameras
+		 * may be shared by several threads at once, since
+		 * their image caches are thread-safe.
+		 *
+		 * @param cams   The camera objects to utilize
+		 * @param nt     The number of threads to use
+		 *
+		 * @return     Returns zero on success, non-zero on failure.
+		 */
+		int apply(const std::vector<camera_t*>& cams,
+				unsigned int nt = 1);
+
 		/*-----*/
 		/* i/o */
 		/*-----*/
@@ -300,6 +326,35 @@ class scanorama_t
 		 * @return   Return zero on success, non-zero on failure.
 		 */
 		int writepng_depth(const std::string& filename) const;
+
+	/* helper functions */
+	private:
+
+		/**
+		 * Raytraces the points of a range of columns
+		 *
+		 * The geometry of this scanorama must already be
+		 * allocated.  The range should start on a multiple
+		 * of the tile size.
+		 *
+		 * @param model    The model to use
+		 * @param c_begin  The first column to trace (inclusive)
+		 * @param c_end    The last column to trace (exclusive)
+		 */
+		void trace_columns(const BVH<float>* model,
+				size_t c_begin, size_t c_end);
+
+		/**
+		 * Applies the colors of cameras to a range of points
+		 *
+		 * @param cams     The camera objects to utilize, in order
+		 * @param i_begin  The first point to color (inclusive)
+		 * @param i_end    The last point to color (exclusive)
+		 * @param ret      Where to store the return code, which
+		 *                 is zero on success, non-zero on failure
+		 */
+		void apply_range(const std::vector<camera_t*>* cams,
+				size_t i_begin, size_t i_end, int* ret);
 };
 
 #endif
@@ -0,0 +1,211 @@
+#include "scanorama.h"
+#include "scanorama_point.h"
+#include <util/progress_bar.h>
+#include <libe57/E57Foundation.h>
+#include <libe57/E57Simple.h>
+#include <iostream>
+#include <string>
+
+/**
+ * @file     scanorama_e57.cpp
+ * @author   Eric Turner <elturner@indoorreality.com>
+ * @brief    Exports scanorama_t pointclouds to the E57 format
+ *
+ * @section DESCRIPTION
+ *
+ * This file contains the E57 exporter of the scanorama_t class.  It
+ * is kept apart from scanorama.cpp so that the rest of the class can
+ * be built without libe57 and its xerces dependency.
+ */
+
+using namespace std;
+
+/*--------------------------*/
+/* function implementations */
+/*--------------------------*/
+
+int scanorama_t::writee57(const std::string& filename) const
+{
+	progress_bar_t progbar;
+	string coordinate_metadata(""); /* optional string */
+	e57::Writer outfile(filename, coordinate_metadata);
+	e57::Data3D header;
+	double*   xdata;
+	double*   ydata;
+	double*   zdata;
+	int8_t*   xyzinvalid;
+	double*   intdata; /* intensity */
+	int8_t*   intinvalid;
+	uint16_t* reddata;
+	uint16_t* greendata;
+	uint16_t* bluedata;
+	int8_t*   colorinvalid;
+	int32_t*  rowindex;
+	int32_t*  colindex;
+	double*   timedata;
+	size_t bpos, epos, nSize, r, c, i;
+	int scan_index;
+
+	/* make sure the file is open */
+	if(!(outfile.IsOpen()))
+	{
+		cerr << "[scanorama_t::writee57]\tUnable to open output "
+		     << "file: \"" << filename << "\"" << endl;
+		return -1;
+	}
+
+	/* get the name of this scan position by parsing the filename */
+	bpos = filename.find_last_of("\\/");
+	if(bpos == string::npos)
+		bpos = 0;
+	else
+		bpos++;
+	epos = filename.find_last_of(".");
+	header.name = filename.substr(bpos, epos);
+
+	/* populate the header of the output e57 file */
+	header.guid = "{D3817EC3-A3DD-4a81-9EF5-2FFD0EC91D5A}";
+	header.acquisitionStart.dateTimeValue   = this->timestamp;
+	header.acquisitionEnd.dateTimeValue     = this->timestamp;
+	header.pointsSize                       = this->points.size(); 
+	
+	header.pointFields.cartesianXField      = true;
+	header.pointFields.cartesianYField      = true;
+	header.pointFields.cartesianZField      = true;
+	header.pointFields.cartesianInvalidStateField = true;
+	header.pointFields.intensityField       = true;
+	header.pointFields.isIntensityInvalidField = true;
+	header.pointFields.colorRedField        = true;
+	header.pointFields.colorGreenField      = true;
+	header.pointFields.colorBlueField       = true;
+	header.pointFields.isColorInvalidField  = true;
+	header.pointFields.rowIndexField        = true;
+	header.pointFields.columnIndexField     = true;
+	header.pointFields.timeStampField       = true;
+	
+	header.indexBounds.rowMinimum           = 0;
+	header.indexBounds.rowMaximum           = this->num_rows - 1;
+	header.indexBounds.columnMinimum        = 0;
+	header.indexBounds.columnMaximum        = this->num_cols - 1;
+	header.indexBounds.returnMinimum        = 0;
+	header.indexBounds.returnMaximum        = 0;
+	header.intensityLimits.intensityMinimum = 0.0;
+	header.intensityLimits.intensityMaximum = 1.0;
+	header.colorLimits.colorRedMinimum      = 0;
+	header.colorLimits.colorRedMaximum      = 255;
+	header.colorLimits.colorGreenMinimum    = 0;
+	header.colorLimits.colorGreenMaximum    = 255;
+	header.colorLimits.colorBlueMinimum     = 0;
+	header.colorLimits.colorBlueMaximum     = 255;
+	header.pose.rotation.w                  = 1;
+	header.pose.rotation.x                  = 0;
+	header.pose.rotation.y                  = 0;
+	header.pose.rotation.z                  = 0;
+	header.pose.translation.x               = this->center(0);
+	header.pose.translation.y               = this->center(1);
+	header.pose.translation.z               = this->center(2);
+	header.pointGroupingSchemes.groupingByLine.groupsSize 
+						= this->num_cols;
+	header.pointGroupingSchemes.groupingByLine.pointCountSize
+						= this->num_rows;
+	scan_index = outfile.NewData3D(header);
+	
+	/* set up scan buffers to write the points */
+	nSize        = this->num_rows;
+	xdata        = new double[nSize];
+	ydata        = new double[nSize];
+	zdata        = new double[nSize];
+	xyzinvalid   = new int8_t[nSize];
+	intdata      = new double[nSize];
+	intinvalid   = new int8_t[nSize];
+	reddata      = new uint16_t[nSize];
+	greendata    = new uint16_t[nSize];
+	bluedata     = new uint16_t[nSize];
+	colorinvalid = new int8_t[nSize];
+	rowindex     = new int32_t[nSize];
+	colindex     = new int32_t[nSize];
+	timedata     = new double[nSize];
+	e57::CompressedVectorWriter datawriter
+			= outfile.SetUpData3DPointsData(
+					scan_index, /* data block index */
+					nSize, /* size of each buffer */
+					xdata, 
+					ydata,
+					zdata,
+					xyzinvalid,
+					intdata,
+					intinvalid,
+					reddata,
+					greendata,
+					bluedata,
+					colorinvalid,
+					NULL, /* spherical range */
+					NULL, /* spherical azimuth */
+					NULL, /* spherical elevation */
+					NULL, /* spherical invalid */
+					rowindex,
+					colindex,
+					NULL, /* return index */
+					NULL, /* return count */
+					timedata,
+					NULL  /* time invalid */
+					);
+
+	/* iterate over the points, inserting into output file 
+	 *
+	 * Remember, scanoramas are in column-major order */
+	progbar.set_name("   Exporting E57");
+	for(c = 0; c < this->num_cols; c++)
+	{
+		/* update user on progress */
+		progbar.update(c, this->num_cols);
+
+		/* populate buffer with current column */
+		for(r = 0; r < this->num_rows; r++)
+		{
+			/* get index of this point */
+			i = r + (c * this->num_rows);
+
+			/* add this point to the buffers */
+			xdata[r]        = this->points[i].x;
+			ydata[r]        = this->points[i].y;
+			zdata[r]        = this->points[i].z;
+			xyzinvalid[r]   = false;
+			intdata[r]      =
+				this->points[i].color.get_grayscale();
+			intinvalid[r]   = (this->points[i].quality <= 0);
+			reddata[r]      = 
+				this->points[i].color.get_red_int();
+			greendata[r]    =
+				this->points[i].color.get_green_int();
+			bluedata[r]     = 
+				this->points[i].color.get_blue_int();
+			colorinvalid[r] = (this->points[i].quality <= 0);
+			rowindex[r]     = this->num_rows - r - 1;
+			colindex[r]     = c;
+			timedata[r]     = this->timestamp;
+		}
+
+		/* export buffer */
+		datawriter.write(nSize);
+	}
+
+	/* success */
+	progbar.clear();
+	datawriter.close();
+	outfile.Close();
+	delete[] xdata;
+	delete[] ydata;
+	delete[] zdata;
+	delete[] xyzinvalid;
+	delete[] intdata;
+	delete[] intinvalid;
+	delete[] reddata;
+	delete[] greendata;
+	delete[] bluedata;
+	delete[] colorinvalid;
+	delete[] rowindex;
+	delete[] colindex;
+	delete[] timedata;
+	return 0;
+}
@@ -6,12 +6,15 @@
 #include <image/fisheye/fisheye_camera.h>
 #include <image/rectilinear/rectilinear_camera.h>
 #include <geometry/system_path.h>
-#include <geometry/raytrace/OctTree.h>
+#include <geometry/raytrace/BVH.h>
+#include <geometry/raytrace/BVHCache.h>
 #include <geometry/raytrace/Triangle3.h>
 #include <util/progress_bar.h>
 #include <util/error_codes.h>
 #include <util/tictoc.h>
 #include <Eigen/Dense>
+#include <boost/threadpool.hpp>
+#include <boost/bind.hpp>
 #include <iostream>
 #include <iomanip>
 #include <fstream>
@@ -60,7 +63,9 @@ void scanorama_maker_t::clear()
 		
 int scanorama_maker_t::init(const std::string& pathfile,
 				const std::string& configfile,
-				const std::string& modelfile)
+				const std::string& modelfile,
+				const std::string& cachedir,
+				bool rebuild)
 {
 	int ret;
 
@@ -90,7 +95,7 @@ int scanorama_maker_t::init(const std::string& pathfile,
 	}
 
 	/* parse the model file */
-	ret = this->populate_octree(modelfile);
+	ret = this->populate_octree(modelfile, cachedir, rebuild);
 	if(ret)
 	{
 		/* unable to parse */
@@ -155,10 +160,10 @@ int scanorama_maker_t::add_rectilinear_camera(const std::string& metafile,
 }
 		
 int scanorama_maker_t::populate_scanorama(scanorama_t& scan,
-				double t, size_t r, size_t c, double bw)
+				double t, size_t r, size_t c, double bw,
+				unsigned int nt)
 {
 	pose_t p;
-	size_t i, n;
 	int ret;
 
 	/* get the position of the system at this timestamp */
@@ -174,7 +179,7 @@ int scanorama_maker_t::populate_scanorama(scanorama_t& scan,
 	}
 
 	/* prepare the point geometry for this scanorama */
-	ret = scan.init_geometry(this->model, t, p.T, r, c, bw);
+	ret = scan.init_geometry(this->model, t, p.T, r, c, bw, nt);
 	if(ret)
 	{
 		/* error occurred */
@@ -185,22 +190,16 @@ int scanorama_maker_t::populate_scanorama(scanorama_t& scan,
 		return ret;
 	}
 
-	/* attempt to color this geometry with the camera imagery */
-	n = this->cameras.size();
-	for(i = 0; i < n; i++)
+	/* attempt to color this geometry with the camera imagery.  For
+	 * each camera, attempt to color as many points as possible. */
+	ret = scan.apply(this->cameras, nt);
+	if(ret)
 	{
-		/* for each camera, attempt to color as many points
-		 * as possible. */
-		ret = scan.apply(this->cameras[i]);
-		if(ret)
-		{
-			ret = PROPEGATE_ERROR(-3, ret);
-			cerr << "[scanorama_maker_t::populate_scanorama]\t"
-			     << "ERROR " << ret << ": could not color "
-			     << "with imagery from camera #" << i 
-			     << "." << endl;
-			return ret;
-		}
+		ret = PROPEGATE_ERROR(-3, ret);
+		cerr << "[scanorama_maker_t::populate_scanorama]\t"
+		     << "ERROR " << ret << ": could not color "
+		     << "with camera imagery." << endl;
+		return ret;
 	}
 
 	/* success */
@@ -212,15 +211,29 @@ int scanorama_maker_t::generate_all(const std::string& prefix_out,
 				const std::string& meta_out,
 				const std::vector<double>& times,
 				size_t r, size_t c, double bw,
-				int begin_idx, int end_idx)
+				int begin_idx, int end_idx,
+				unsigned int nt)
 {
 	progress_bar_t progbar;
 	scanolist_io::scanolist_t metaoutfile;
-	scanorama_t scan;
-	stringstream ss_prefix, ss_full;
+	scanorama_t scans[2];
+	stringstream ss_prefix;
 	tictoc_t clk;
-	size_t i, n;
-	int ret;
+	size_t i, b, n;
+	int ret, export_ret;
+
+	/* determine how many threads to use */
+	if(nt == 0)
+		nt = boost::thread::hardware_concurrency();
+	if(nt == 0)
+		nt = 1;
+
+	/* files are written by a separate thread, which exports one
+	 * scanorama while the next one is generated.  The pool waits
+	 * for its task when it goes out of scope, so it is declared
+	 * after the scanoramas it exports. */
+	boost::threadpool::pool writer(1);
+	export_ret = 0;
 
 	/* prepare the progress bar for user */
 	tic(clk);
@@ -240,7 +253,9 @@ int scanorama_maker_t::generate_all(const std::string& prefix_out,
 	for(i = 0; i < n; i++)
 		metaoutfile.add_camera(this->cameras[i]->name());
 
-	/* iterate over the list of timestamps */
+	/* iterate over the list of timestamps, alternating between
+	 * the two scanoramas so that one can be exported while the
+	 * other is generated */
 	for(i = (size_t) begin_idx; i < (size_t) end_idx; i++)
 	{
 		/* update progress bar 
@@ -250,7 +265,9 @@ int scanorama_maker_t::generate_all(const std::string& prefix_out,
 		progbar.update( (i - begin_idx) , (end_idx - begin_idx) );
 
 		/* populate the scan */
-		ret = this->populate_scanorama(scan, times[i], r, c, bw);
+		b = (i - begin_idx) % 2;
+		ret = this->populate_scanorama(scans[b], times[i],
+				r, c, bw, nt);
 		if(ret)
 		{
 			/* error occurred */
@@ -263,152 +280,24 @@ int scanorama_maker_t::generate_all(const std::string& prefix_out,
 			return ret;
 		}
 
+		/* wait for the previous scan to be exported */
+		writer.wait();
+		if(export_ret)
+		{
+			progbar.clear();
+			return export_ret;
+		}
+
 		/* determine where to export this scanorama */
 		ss_prefix.clear();
 		ss_prefix.str("");
 		ss_prefix << prefix_out;
 		ss_prefix << std::setfill('0') << std::setw(8) << i;
 
-		/* check if we want to export .ptx file */
-		if((out_format & PTX_FORMAT) != 0)
-		{
-			/* prepare output file */
-			ss_full.clear();
-			ss_full.str("");
-			ss_full << ss_prefix.str() << ".ptx";
-			ofstream outfile(ss_full.str());
-			if(!(outfile.is_open()))
-			{
-				progbar.clear();
-				ret = PROPEGATE_ERROR(-2, ret);
-				cerr << "[scanorama_maker_t::"
-				     << "generate_all]\t"
-				     << "Unable to export to .ptx "
-				     << "file: "
-				     << ss_full.str() << endl;
-				return ret;
-			}
-
-			/* export to file */
-			scan.writeptx(outfile);
-			outfile.close();
-		}
-
-		/* check if we want to export .ptg */
-		if((out_format & PTG_FORMAT) != 0)
-		{
-			/* make output file name */
-			ss_full.clear();
-			ss_full.str("");
-			ss_full << ss_prefix.str() << ".ptg";
-
-			/* write it to disk */
-			ret = scan.writeptg(ss_full.str());
-			if(ret)
-			{
-				/* error occurred */
-				progbar.clear();
-				ret = PROPEGATE_ERROR(-3, ret);
-				cerr << "[scanorama_maker_t::"
-				     << "generate_all]\t"
-				     << "ERROR " << ret 
-				     << ": Unable to open "
-				     << "scanorama file: " 
-				     << ss_full.str() << endl;
-				return ret;
-			}
-		}
-
-		/* check if we want to export .e57 */
-		if((out_format & E57_FORMAT) != 0)
-		{
-			/* make output file name */
-			ss_full.clear();
-			ss_full.str("");
-			ss_full << ss_prefix.str() << ".e57";
-
-			/* write it to disk */
-			ret = scan.writee57(ss_full.str());
-			if(ret)
-			{
-				/* error occurred */
-				progbar.clear();
-				ret = PROPEGATE_ERROR(-4, ret);
-				cerr << "[scanorama_maker_t::"
-				     << "generate_all]\t"
-				     << "ERROR " << ret 
-				     << ": Unable to open "
-				     << "scanorama file: " 
-				     << ss_full.str() << endl;
-				return ret;
-			}
-		}
-		
-		/* write to png as well */
-		if((out_format & PNG_FORMAT) != 0)
-		{
-			ss_full.clear();
-			ss_full.str("");
-			ss_full << ss_prefix.str() << ".png";
-			ret = scan.writepng(ss_full.str());
-			if(ret)
-			{
-				/* unable to export png */
-				progbar.clear();
-				cerr << "[scanorama_maker_t::"
-				     << "generate_all]\t"
-				     << "ERROR " << ret 
-				     << ": Unable to export "
-				     << "scanorama #" << i 
-				     << " as a PNG image"
-				     << endl;
-				return PROPEGATE_ERROR(-5, ret);
-			}
-		}
-	
-		/* write to normal-map png if specified */
-		if((out_format & NORMAL_PNG_FORMAT) != 0)
-		{
-			ss_full.clear();
-			ss_full.str("");
-			ss_full << ss_prefix.str() << "_normal.png";
-			ret = scan.writepng_normal(ss_full.str());
-			if(ret)
-			{
-				/* unable to write */
-				progbar.clear();
-				cerr << "[scanorama_maker_t::"
-				     << "generate_all]\t"
-				     << "ERROR " << ret
-				     << ": Unable to export "
-				     << "scanorama #" << i
-				     << " to a normal-map PNG image."
-				     << endl;
-				return PROPEGATE_ERROR(-6, ret);
-			}
-		}
-		
-		/* write to depth-map png if specified */
-		if((out_format & NORMAL_PNG_FORMAT) != 0)
-		{
-			ss_full.clear();
-			ss_full.str("");
-			ss_full << ss_prefix.str() << "_depth.png";
-			ret = scan.writepng_depth(ss_full.str());
-			if(ret)
-			{
-				/* unable to write */
-				progbar.clear();
-				cerr << "[scanorama_maker_t::"
-				     << "generate_all]\t"
-				     << "ERROR " << ret
-				     << ": Unable to export "
-				     << "scanorama #" << i
-				     << " to a depth-map PNG image."
-				     << endl;
-				return PROPEGATE_ERROR(-6, ret);
-			}
-		}
+		/* export it while the next scan is generated */
+		writer.schedule(boost::bind(&scanorama_maker_t::export_scan,
+				this, &(scans[b]), ss_prefix.str(),
+				out_format, &export_ret));
 
 		/* store metadata */
 		metaoutfile.add(
@@ -416,6 +305,14 @@ int scanorama_maker_t::generate_all(const std::string& prefix_out,
 				ss_prefix.str()));
 	}
 
+	/* wait for the last scan to be exported */
+	writer.wait();
+	if(export_ret)
+	{
+		progbar.clear();
+		return export_ret;
+	}
+
 	/* if specified, write the metadata to output file */
 	if(!(meta_out.empty()))
 	{
@@ -442,7 +339,8 @@ int scanorama_maker_t::generate_along_path(const std::string& prefix_out,
 			const std::string& meta_out,
 			double minspacedist, double maxspacedist,
 			size_t r, size_t c, double bw,
-			int begin_idx, int end_idx)
+			int begin_idx, int end_idx,
+			unsigned int nt)
 {
 	vector<double> times;
 	tictoc_t clk;
@@ -561,7 +459,7 @@ int scanorama_maker_t::generate_along_path(const std::string& prefix_out,
 	
 	/* now that we've populated the times list, make the scanoramas */
 	ret = this->generate_all(prefix_out, out_format, meta_out,
-			times, r, c, bw, begin_idx, end_idx);
+			times, r, c, bw, begin_idx, end_idx, nt);
 	if(ret)
 	{
 		/* some error occurred during processing */
@@ -576,21 +474,43 @@ int scanorama_maker_t::generate_along_path(const std::string& prefix_out,
 	return 0;
 }
 		
-int scanorama_maker_t::populate_octree(const std::string& modelfile)
+int scanorama_maker_t::populate_octree(const std::string& modelfile,
+				const std::string& cachedir,
+				bool rebuild)
 {
-	mesh_io::mesh_t mesh;
+	mesh_io::trimesh_t mesh;
 	vector<Triangle3<float> > triangles;
-	float v1[3];
-	float v2[3];
-	float v3[3];
+	const unsigned int* tri;
+	uint64_t hash, key;
+	size_t i, n;
 	int ret;
 
+	/* check for a cached index of this model, which is keyed
+	 * by the contents of the model file */
+	key = 0;
+	if(!cachedir.empty())
+	{
+		if(!BVHCache::hash_file(modelfile, hash))
+		{
+			/* error occurred */
+			ret = -1;
+			cerr << "[scanorama_maker_t::populate_octree]"
+			     << "\tERROR " << ret
+			     << ": Unable to read mesh file: " << modelfile
+			     << endl;
+			return ret;
+		}
+		key = BVHCache::make_key(hash, BVH<float>::DEFAULT_LEAF_SIZE);
+		if(!rebuild && BVHCache::load(this->model, cachedir, key))
+			return 0; /* no need to read the mesh */
+	}
+
 	/* first read mesh from disk */
 	ret = mesh.read(modelfile);
 	if(ret)
 	{
 		/* error occurred */
-		ret = PROPEGATE_ERROR(-1, ret);
+		ret = PROPEGATE_ERROR(-2, ret);
 		cerr << "[scanorama_maker_t::populate_octree]"
 		     << "\tERROR " << ret
 		     << ": Unable to parse mesh file: " << modelfile
@@ -599,44 +519,148 @@ int scanorama_maker_t::populate_octree(const std::string& modelfile)
 	}
 
 	/* loop over the triangles creating triangle */
-	for(size_t i = 0; i < mesh.num_polys(); i++)
+	n = mesh.num_tris();
+	triangles.reserve(n);
+	for(i = 0; i < n; i++)
 	{
-		v1[0] = (float)(mesh.get_vert(
-					mesh.get_poly(i).vertices[0]).x);
-		v1[1] = (float)(mesh.get_vert(
-					mesh.get_poly(i).vertices[0]).y);
-		v1[2] = (float)(mesh.get_vert(
-					mesh.get_poly(i).vertices[0]).z);
-		v2[0] = (float)(mesh.get_vert(
-					mesh.get_poly(i).vertices[1]).x);
-		v2[1] = (float)(mesh.get_vert(
-					mesh.get_poly(i).vertices[1]).y);
-		v2[2] = (float)(mesh.get_vert(
-					mesh.get_poly(i).vertices[1]).z);
-		v3[0] = (float)(mesh.get_vert(
-					mesh.get_poly(i).vertices[2]).x);
-		v3[1] = (float)(mesh.get_vert(
-					mesh.get_poly(i).vertices[2]).y);
-		v3[2] = (float)(mesh.get_vert(
-					mesh.get_poly(i).vertices[2]).z);
-		triangles.push_back(Triangle3<float>(v1, v2, v3, i));
+		tri = mesh.get_tri(i);
+		triangles.push_back(Triangle3<float>(mesh.get_vert(tri[0]),
+				mesh.get_vert(tri[1]),
+				mesh.get_vert(tri[2]), i));
 	}
 
-	/* move triangles to octree */
+	/* move triangles to the hierarchy */
 	if(!(this->model.rebuild(triangles)))
 	{	
 		/* error occurred */
-		ret = -2;
+		ret = -3;
 		cerr << "[scanorama_maker_t::populate_octree]"
 		     << "\tERROR " << ret
-		     << ": Unable to init octree" << endl;
+		     << ": Unable to init hierarchy" << endl;
 		return ret;
 	}
 
+	/* save the index for later runs.  This is not fatal, since
+	 * the hierarchy has already been built. */
+	if(!cachedir.empty() && !BVHCache::save(this->model, cachedir, key))
+		cerr << "[scanorama_maker_t::populate_octree]"
+		     << "\tWARNING: Unable to cache hierarchy in: "
+		     << BVHCache::index_file(cachedir, key) << endl;
+
 	/* success */
 	return 0;
 }
 		
+void scanorama_maker_t::export_scan(const scanorama_t* scan,
+				const std::string& prefix,
+				scano_format_t out_format, int* ret) const
+{
+	string filename;
+
+	/* check if we want to export .ptx file */
+	*ret = 0;
+	if((out_format & PTX_FORMAT) != 0)
+	{
+		/* prepare output file */
+		filename = prefix + ".ptx";
+		ofstream outfile(filename.c_str());
+		if(!(outfile.is_open()))
+		{
+			*ret = -2;
+			cerr << "[scanorama_maker_t::export_scan]\t"
+			     << "Unable to export to .ptx file: "
+			     << filename << endl;
+			return;
+		}
+
+		/* export to file */
+		scan->writeptx(outfile);
+		outfile.close();
+	}
+
+	/* check if we want to export .ptg */
+	if((out_format & PTG_FORMAT) != 0)
+	{
+		/* write it to disk */
+		filename = prefix + ".ptg";
+		*ret = scan->writeptg(filename);
+		if(*ret)
+		{
+			/* error occurred */
+			*ret = PROPEGATE_ERROR(-3, *ret);
+			cerr << "[scanorama_maker_t::export_scan]\t"
+			     << "ERROR " << *ret << ": Unable to open "
+			     << "scanorama file: " << filename << endl;
+			return;
+		}
+	}
+
+	/* check if we want to export .e57 */
+	if((out_format & E57_FORMAT) != 0)
+	{
+		/* write it to disk */
+		filename = prefix + ".e57";
+		*ret = scan->writee57(filename);
+		if(*ret)
+		{
+			/* error occurred */
+			*ret = PROPEGATE_ERROR(-4, *ret);
+			cerr << "[scanorama_maker_t::export_scan]\t"
+			     << "ERROR " << *ret << ": Unable to open "
+			     << "scanorama file: " << filename << endl;
+			return;
+		}
+	}
+
+	/* write to png as well */
+	if((out_format & PNG_FORMAT) != 0)
+	{
+		*ret = scan->writepng(prefix + ".png");
+		if(*ret)
+		{
+			/* unable to export png */
+			*ret = PROPEGATE_ERROR(-5, *ret);
+			cerr << "[scanorama_maker_t::export_scan]\t"
+			     << "ERROR " << *ret << ": Unable to export "
+			     << "scanorama " << prefix
+			     << " as a PNG image" << endl;
+			return;
+		}
+	}
+
+	/* write to normal-map png if specified */
+	if((out_format & NORMAL_PNG_FORMAT) != 0)
+	{
+		*ret = scan->writepng_normal(prefix + "_normal.png");
+		if(*ret)
+		{
+			/* unable to write */
+			*ret = PROPEGATE_ERROR(-6, *ret);
+			cerr << "[scanorama_maker_t::export_scan]\t"
+			     << "ERROR " << *ret << ": Unable to export "
+			     << "scanorama " << prefix
+			     << " to a normal-map PNG image." << endl;
+			return;
+		}
+	}
+
+	/* write to depth-map png if specified */
+	if((out_format & NORMAL_PNG_FORMAT) != 0)
+	{
+		*ret = scan->writepng_depth(prefix + "_depth.png");
+		if(*ret)
+		{
+			/* unable to write */
+			*ret = PROPEGATE_ERROR(-6, *ret);
+			cerr << "[scanorama_maker_t::export_scan]\t"
+			     << "ERROR " << *ret << ": Unable to export "
+			     << "scanorama " << prefix
+			     << " to a depth-map PNG image." << endl;
+			return;
+		}
+	}
+}
+		
 size_t scanorama_maker_t::index_jump_by_dist(
 			const std::vector<transform_t,
 	        	    Eigen::aligned_allocator<transform_t> >& poses,
@@ -18,7 +18,7 @@
 #include "scanorama.h"
 #include <image/camera.h>
 #include <geometry/system_path.h>
-#include <geometry/raytrace/OctTree.h>
+#include <geometry/raytrace/BVH.h>
 #include <Eigen/Dense>
 #include <string>
 #include <vector>
@@ -69,11 +69,12 @@ class scanorama_maker_t
 		std::vector<camera_t*> cameras;
 
 		/**
-		 * The model geometry, represented as a triangulated mesh.
+		 * The model geometry, represented as a triangulated mesh
+		 * stored in a bounding volume hierarchy.
 		 *
 		 * units: meters
 		 */
-		OctTree<float> model;
+		BVH<float> model;
 
 	/* functions */
 	public:
@@ -86,12 +87,8 @@ class scanorama_maker_t
 		 * Default constructor 
 		 *
 		 * Creates empty object. 
-		 *
-		 * This octree is constructed with a maximum depth of 12.
-		 * By default, the tree has a maximum depth of 10, which
-		 * tends to not be enough for some of our larger models.
 		 */
-		scanorama_maker_t() : path(), cameras(), model(12)
+		scanorama_maker_t() : path(), cameras(), model()
 		{};
 
 		/**
@@ -117,12 +114,20 @@ class scanorama_maker_t
 		 * @param configfile  The .xml hardware configuration file
 		 * @param modelfile   The model geometry 
 		 *                    (either .obj or .ply)
+		 * @param cachedir    The directory where the index of
+		 *                    the model's hierarchy is cached.  If
+		 *                    empty, the cache is not used.
+		 * @param rebuild     If true, the hierarchy is rebuilt
+		 *                    and its cached index replaced, even
+		 *                    if a valid index exists.
 		 *
 		 * @return     Returns zero on success, non-zero on failure.
 		 */
 		int init(const std::string& pathfile,
 				const std::string& configfile,
-				const std::string& modelfile);
+				const std::string& modelfile,
+				const std::string& cachedir = "",
+				bool rebuild = false);
 
 		/**
 		 * Adds a fisheye camera to be used to color 
@@ -177,11 +182,13 @@ class scanorama_maker_t
 		 * @param r        Number of rows to use
 		 * @param c        Number of columns to use
 		 * @param bw       The blendwidth to use (range [0,1])
+		 * @param nt       The number of threads to use
 		 *
 		 * @return     Returns zero on success, non-zero on failure.
 		 */
 		int populate_scanorama(scanorama_t& scan,
-				double t, size_t r, size_t c, double bw);
+				double t, size_t r, size_t c, double bw,
+				unsigned int nt = 1);
 
 		/**
 		 * Generates and exports scanoramas for list of timestamps.
@@ -190,6 +197,11 @@ class scanorama_maker_t
 		 * will export scanoramas for each of the specified
 		 * timestamps.
 		 *
+		 * Each scanorama is traced and colored in parallel,
+		 * and is exported by a separate thread while the next
+		 * scanorama is generated.  The exported files are the
+		 * same for any number of threads.
+		 *
 		 * NOTE:  The scanoramas will be centered at the system 
 		 * common coordiantes.  It may be worthwhile in the future
 		 * to adjust this to center the scanorama at one of the
@@ -208,6 +220,8 @@ class scanorama_maker_t
 		 *                    exporting, exclusive (default = -1,
 		 *                    which indicates that all values
 		 *                    should be used)
+		 * @param nt          The number of threads to use.  If
+		 *                    zero, uses one thread per core.
 		 *
 		 * @return    Returns zero on success, non-zero on failure.
 		 */
@@ -216,7 +230,8 @@ class scanorama_maker_t
 				const std::string& meta_out,
 				const std::vector<double>& times,
 				size_t r, size_t c, double bw,
-				int begin_idx = 0, int end_idx = -1);
+				int begin_idx = 0, int end_idx = -1,
+				unsigned int nt = 1);
 
 		/**
 		 * Generates and exports scanoramas along the path at
@@ -246,6 +261,8 @@ class scanorama_maker_t
 		 *                     (default = -1,
 		 *                     which indicates that all values
 		 *                     should be used)
+		 * @param nt           The number of threads to use.  If
+		 *                     zero, uses one thread per core.
 		 *
 		 *
 		 * @return    Returns zero on success, non-zero on failure.
@@ -255,20 +272,53 @@ class scanorama_maker_t
 			const std::string& meta_out,
 			double minspacedist, double maxspacedist,
 			size_t r, size_t c, double bw,
-			int begin_idx = 0, int end_idx = -1);
+			int begin_idx = 0, int end_idx = -1,
+			unsigned int nt = 1);
 
 	/* helper functions */
 	private:
 
 		/**
-		 * Populates the octree structure that stores the model
+		 * Populates the hierarchy that stores the model
 		 * for efficient raytracing operations.
 		 *
+		 * If a cache directory is given, the hierarchy is
+		 * mapped from its cached index when one exists for
+		 * the contents of the model file.  Otherwise, it is
+		 * built from the model and its index is saved to the
+		 * cache for later runs.
+		 *
 		 * @param modelfile   Where to read the model from
+		 * @param cachedir    The cache directory, or empty to
+		 *                    always build the hierarchy
+		 * @param rebuild     If true, ignore any cached index
 		 *
 		 * @return    Returns zero on success, non-zero on failure.
 		 */
-		int populate_octree(const std::string& modelfile);
+		int populate_octree(const std::string& modelfile,
+				const std::string& cachedir,
+				bool rebuild);
+
+		/**
+		 * Exports a generated scanorama to each of the
+		 * specified file formats.
+		 *
+		 * This is called from a separate thread, so that
+		 * files are written while the next scanorama is
+		 * generated.  The scanorama must not be modified
+		 * until this call returns.
+		 *
+		 * @param scan        The scanorama to export
+		 * @param prefix      The prefix of the output files
+		 *                    for this scanorama
+		 * @param out_format  The output file formats
+		 * @param ret         Where to store the return code,
+		 *                    which is zero on success, non-zero
+		 *                    on failure.
+		 */
+		void export_scan(const scanorama_t* scan,
+				const std::string& prefix,
+				scano_format_t out_format, int* ret) const;
 
 		/**
 		 * Finds the first index that is at least min_dist away
@@ -6,7 +6,13 @@
 #include <fstream>
 #include <string>
 #include <string.h>
+#include <algorithm>
 #include <iostream>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
 
 /**
  * @file carve_map_io.h
@@ -34,6 +40,9 @@ using namespace cm_io;
 reader_t::reader_t()
 {
 	/* initialize values */
+	this->fd = -1;
+	this->data = NULL;
+	this->data_size = 0;
 	this->frames = NULL;
 }
 			
@@ -45,39 +54,56 @@ reader_t::~reader_t()
 			
 int reader_t::open(const std::string& filename)
 {
+	struct stat st;
+	void* addr;
 	int ret;
-	size_t f, n, m;
-	gauss_dist_t gd;
+	size_t f, n, loc;
 
 	/* close any open files */
 	this->close();
 
-	/* lock the mutex, since we're going to edit the stream */
-	this->mtx.lock();
-	
 	/* attempt to open this file */
-	this->infile.open(filename.c_str(),
-			ios_base::in | ios_base::binary);
-	if(!(this->infile.is_open()))
+	this->fd = ::open(filename.c_str(), O_RDONLY);
+	if(this->fd < 0 || fstat(this->fd, &st) != 0)
 	{
 		/* report error to user */
 		cerr << "[cm_io::reader_t::open]\tUnable to open file: "
 		     << filename << endl << endl;
-		this->mtx.unlock();
+		this->close();
 		return -1;
 	}
 
+	/* map the whole file into memory.  Pages are loaded on
+	 * demand, so this is cheap even for large files */
+	this->data_size = st.st_size;
+	if(this->data_size > 0)
+	{
+		addr = mmap(NULL, this->data_size, PROT_READ, 
+				MAP_SHARED, this->fd, 0);
+		if(addr == MAP_FAILED)
+		{
+			/* report error to user */
+			cerr << "[cm_io::reader_t::open]\tUnable to map "
+			     << "file into memory: " << filename 
+			     << endl << endl;
+			this->data_size = 0;
+			this->close();
+			return -2;
+		}
+		this->data = (const char*) addr;
+	}
+
 	/* parse the header */
-	ret = this->header.parse(this->infile);
+	ret = this->header.parse(this->data, this->data_size);
 	if(ret)
 	{
 		/* report error */
-		ret = PROPEGATE_ERROR(-2, ret);
+		ret = PROPEGATE_ERROR(-3, ret);
 		cerr << "[cm_io::reader_t::open]\tError " << ret << ": "
 		     << "Could not parse header from " << filename << ".  "
 		     << "Are you sure this is the right file?"
 		     << endl << endl;
-		this->mtx.unlock();
+		this->close();
 		return ret;
 	}
 
@@ -86,38 +112,47 @@ int reader_t::open(const std::string& filename)
 	this->frames = new frame_t[n];
 
 	/* attempt to read all frames in this file */
+	loc = HEADER_SIZE;
 	for(f = 0; f < n; f++)
 	{
 		/* parse the next frame */
-		ret = this->frames[f].parse(this->infile);
+		ret = this->frames[f].parse(this->data, 
+				this->data_size, loc);
 		if(ret)
 		{
 			/* report error */
-			ret = PROPEGATE_ERROR(-3, ret);
+			ret = PROPEGATE_ERROR(-4, ret);
 			cerr << "[cm_io::reader_t::open]\tError " << ret
 			     << ": Unable to parse frame #" << f
 			     << endl << endl;
-			this->mtx.unlock();
+			this->close();
 			return ret;
 		}
 
-		/* iterate through points in frame */
-		m = this->num_points_in_frame(f);
-		this->infile.seekg(m*POINT_INFO_SIZE, ios_base::cur);
+		/* skip past the points in frame */
+		loc += FRAME_HEADER_SIZE
+			+ this->num_points_in_frame(f)*POINT_INFO_SIZE;
 	}
 
 	/* success */
-	this->mtx.unlock();
 	return 0;
 }
 			
 void reader_t::close()
 {
-	/* check if stream is open */
-	if(this->infile.is_open())
+	/* check if file is mapped */
+	if(this->data != NULL)
+	{
+		munmap((void*) this->data, this->data_size);
+		this->data = NULL;
+	}
+	this->data_size = 0;
+
+	/* check if file is open */
+	if(this->fd >= 0)
 	{
-		/* since stream is open, close it */
-		this->infile.close();
+		::close(this->fd);
+		this->fd = -1;
 	}
 
 	/* check if memory is allocated */
@@ -127,46 +162,167 @@ void reader_t::close()
 		delete[] (this->frames);
 		this->frames = NULL;
 	}
+	this->header.num_frames = 0;
 }
 			
-int reader_t::read(carve_map_t& cm, size_t f, size_t i)
+int reader_t::read(carve_map_t& cm, size_t f, size_t i) const
 {
 	gauss_dist_t dist;
 	double planar_prob, corner_prob;
-	int ret;
+	const char* p;
 
 	/* verify input */
 	if(this->frames == NULL || this->num_frames() <= f)
 		return -1;
-	
-	/* prepare to access the stream, which requires locking
-	 * the mutex */
-	this->mtx.lock();
+	if(this->frames[f].num_points <= i)
+		return -2;
 
-	/* move the stream to the appropriate position for the
-	 * given frame and point*/
-	this->infile.seekg(this->frames[f].fileloc
-			+ ((streampos) (FRAME_HEADER_SIZE 
-			+ i*POINT_INFO_SIZE)));
+	/* get the location of this point in the mapped file, which
+	 * was verified to be in bounds when the frame was parsed */
+	p = this->data + this->frames[f].fileloc
+		+ FRAME_HEADER_SIZE + i*POINT_INFO_SIZE;
 
 	/* read the scanpoint distribution from file */
-	ret = dist.parse(this->infile);
-	if(ret)
-	{
-		this->mtx.unlock();
-		return PROPEGATE_ERROR(-1, ret);
-	}
-	this->infile.read((char*) &planar_prob, sizeof(planar_prob));
-	this->infile.read((char*) &corner_prob, sizeof(corner_prob));
+	dist.parse(p);
+	p += GAUSS_DIST_SIZE;
+	memcpy(&planar_prob, p, sizeof(planar_prob));
+	p += sizeof(planar_prob);
+	memcpy(&corner_prob, p, sizeof(corner_prob));
 
 	/* populate carve map with appropriate values */
 	cm.init(this->frames[f].sensor_pos.mean,
-	        this->frames[f].sensor_pos.cov, dist.mean, dist.cov);
+	        this->frames[f].sensor_pos.cov,
+	        this->frames[f].sensor_axes,
+		dist.mean, dist.cov);
 	cm.set_planar_prob(planar_prob);
 	cm.set_corner_prob(corner_prob);
 
 	/* success */
-	this->mtx.unlock();
+	return 0;
+}
+
+int reader_t::read_means(Vector3d& s, Vector3d& p, size_t f,
+                         size_t i) const
+{
+	const char* buf;
+	double v[3];
+
+	/* verify input */
+	if(this->frames == NULL || this->num_frames() <= f)
+		return -1;
+	if(this->frames[f].num_points <= i)
+		return -2;
+
+	/* the scan point mean is the first value of its point info,
+	 * and the sensor mean is stored with the frame */
+	buf = this->data + this->frames[f].fileloc
+		+ FRAME_HEADER_SIZE + i*POINT_INFO_SIZE;
+	memcpy(v, buf, VECTOR_SIZE);
+	p << v[0], v[1], v[2];
+	s = this->frames[f].sensor_pos.mean;
+
+	/* success */
+	return 0;
+}
+
+int reader_t::read_extent(Vector3d& s, Vector3d& p, double& var,
+                          size_t f, size_t i) const
+{
+	Matrix<double, 1, 3> rt;
+	gauss_dist_t dist;
+	Vector3d ray;
+
+	/* verify input */
+	if(this->frames == NULL || this->num_frames() <= f)
+		return -1;
+	if(this->frames[f].num_points <= i)
+		return -2;
+
+	/* get the scan point distribution from the mapped file */
+	dist.parse(this->data + this->frames[f].fileloc
+		+ FRAME_HEADER_SIZE + i*POINT_INFO_SIZE);
+	p = dist.mean;
+	s = this->frames[f].sensor_pos.mean;
+
+	/* marginalize the variance along the ray, computed the same
+	 * way as in carve_map_t::init() so the results are identical */
+	ray = p - s;
+	ray /= ray.norm();
+	rt = ray.transpose();
+	var = rt * dist.cov * ray;
+
+	/* success */
+	return 0;
+}
+
+/*---------------*/
+/* cache_t class */
+/*---------------*/
+
+cache_t::cache_t(size_t capacity)
+{
+	/* allocate the maps once, so that they never move */
+	capacity = max(capacity, MIN_CAPACITY);
+	this->maps.resize(capacity);
+	this->frames.resize(capacity);
+	this->points.resize(capacity);
+	this->last_used.resize(capacity);
+	this->clear();
+}
+
+void cache_t::clear()
+{
+	/* the maps themselves don't need to be freed */
+	this->clock = 0;
+	this->num_cached = 0;
+	this->num_gets = 0;
+	this->num_reads = 0;
+}
+
+int cache_t::get(carve_map_t*& cm, const reader_t& reader,
+                 size_t f, size_t i)
+{
+	size_t j, k;
+	int ret;
+
+	/* the cache is small, so just search the whole thing */
+	this->clock++;
+	this->num_gets++;
+	for(j = 0; j < this->num_cached; j++)
+		if(this->frames[j] == f && this->points[j] == i)
+		{
+			/* found it */
+			this->last_used[j] = this->clock;
+			cm = &(this->maps[j]);
+			return 0;
+		}
+
+	/* not found, so replace the least recently used map, or
+	 * use an empty slot if the cache isn't full yet */
+	if(this->num_cached < this->maps.size())
+		j = this->num_cached++;
+	else
+	{
+		j = 0;
+		for(k = 1; k < this->maps.size(); k++)
+			if(this->last_used[k] < this->last_used[j])
+				j = k;
+	}
+
+	/* read it from file.  If this fails, the slot is marked
+	 * so that it is never matched and is replaced first. */
+	this->num_reads++;
+	this->frames[j] = this->points[j] = (size_t) -1;
+	this->last_used[j] = 0;
+	ret = reader.read(this->maps[j], f, i);
+	if(ret)
+		return PROPEGATE_ERROR(-1, ret);
+	this->frames[j] = f;
+	this->points[j] = i;
+	this->last_used[j] = this->clock;
+	cm = &(this->maps[j]);
+
+	/* success */
 	return 0;
 }
 
@@ -282,13 +438,12 @@ header_t::header_t()
 	this->num_frames = 0;
 }
 			
-int header_t::parse(istream& is)
+int header_t::parse(const char* buf, size_t len)
 {
-	char m[MAGIC_NUMBER_SIZE];
-
 	/* check for magic number */
-	is.read(m, MAGIC_NUMBER_SIZE);
-	if(memcmp(m, MAGIC_NUMBER.c_str(), MAGIC_NUMBER_SIZE))
+	if(buf == NULL || len < HEADER_SIZE 
+			|| memcmp(buf, MAGIC_NUMBER.c_str(),
+			          MAGIC_NUMBER_SIZE))
 	{
 		/* wrong magic number */
 		cerr << "[cm_io::header_t::parse]\t"
@@ -296,16 +451,20 @@ int header_t::parse(istream& is)
 		return -1;
 	}
 
-	/* parse the input binary stream,
+	/* parse the input binary buffer,
 	 * all values are assumed to be in little-endian ordering */
-	is.read((char*) &(this->num_frames), sizeof(this->num_frames));
+	memcpy(&(this->num_frames), buf + MAGIC_NUMBER_SIZE,
+	       sizeof(this->num_frames));
 
-	/* check file stream */
-	if(is.bad())
+	/* every frame takes at least a frame header, so a larger count
+	 * means the header is corrupt.  Check this before the caller
+	 * allocates space for that many frames */
+	if(this->num_frames > (len - HEADER_SIZE) / FRAME_HEADER_SIZE)
 	{
-		/* could not finish header */
 		cerr << "[cm_io::header_t::parse]\t"
-		     << "Unable to parse header information" << endl;
+		     << "Number of frames (" << this->num_frames << ") "
+		     << "does not fit in file" << endl;
+		this->num_frames = 0;
 		return -2;
 	}
 
@@ -333,18 +492,28 @@ frame_t::frame_t()
 	this->num_points = 0;
 }
 
-int frame_t::parse(std::istream& is)
+int frame_t::parse(const char* buf, size_t len, size_t loc)
 {
-	int ret;
-
 	/* store location of this frame in file*/
-	this->fileloc = is.tellg();
+	this->fileloc = loc;
 
-	/* parse stream */
-	is.read((char*) &(this->num_points), sizeof(this->num_points));
-	ret = this->sensor_pos.parse(is);
-	if(ret)
-		return PROPEGATE_ERROR(-1, ret);
+	/* verify the frame header is in the file */
+	if(loc + FRAME_HEADER_SIZE > len)
+		return -1;
+
+	/* parse buffer */
+	memcpy(&(this->num_points), buf + loc, sizeof(this->num_points));
+	this->sensor_pos.parse(buf + loc + sizeof(this->num_points));
+
+	/* verify all points of this frame are in the file */
+	if(this->num_points > (len - loc - FRAME_HEADER_SIZE)
+					/ POINT_INFO_SIZE)
+		return -2;
+
+	/* the sensor distribution is the same for every point
+	 * in this frame, so decompose it now */
+	carve_map_t::get_principal_axes(this->sensor_axes,
+	                                this->sensor_pos.cov);
 
 	/* success */
 	return 0;
@@ -380,30 +549,18 @@ void gauss_dist_t::serialize(ostream& os) const
 	os.write((char*) &(this->cov(2,2)), sizeof(this->cov(2,2)));
 }
 			
-int gauss_dist_t::parse(istream& is)
+void gauss_dist_t::parse(const char* buf)
 {
-	/* import mean position */
-	is.read((char*) &(this->mean(0)), sizeof(this->mean(0)));
-	is.read((char*) &(this->mean(1)), sizeof(this->mean(1)));
-	is.read((char*) &(this->mean(2)), sizeof(this->mean(2)));
-
-	/* import covariance (upper triangle) */
-	is.read((char*) &(this->cov(0,0)), sizeof(this->cov(0,0)));
-	is.read((char*) &(this->cov(0,1)), sizeof(this->cov(0,1)));
-	is.read((char*) &(this->cov(0,2)), sizeof(this->cov(0,2)));
-	is.read((char*) &(this->cov(1,1)), sizeof(this->cov(1,1)));
-	is.read((char*) &(this->cov(1,2)), sizeof(this->cov(1,2)));
-	is.read((char*) &(this->cov(2,2)), sizeof(this->cov(2,2)));	
-
-	/* copy covariance values to lower triangle */
-	this->cov(1,0) = this->cov(0,1);
-	this->cov(2,0) = this->cov(0,2);
-	this->cov(2,1) = this->cov(1,2);
-
-	/* verify that stream is good */
-	if(is.bad())
-		return -1;
+	double v[6];
 
-	/* success */
-	return 0;
+	/* import mean position */
+	memcpy(v, buf, VECTOR_SIZE);
+	this->mean << v[0], v[1], v[2];
+
+	/* import covariance (upper triangle), and copy values
+	 * to lower triangle */
+	memcpy(v, buf + VECTOR_SIZE, COV_MAT_SIZE);
+	this->cov << v[0], v[1], v[2],
+	             v[1], v[3], v[4],
+	             v[2], v[4], v[5];
 }
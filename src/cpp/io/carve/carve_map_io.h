@@ -12,6 +12,13 @@
  * which house the probability distributions of the input scan points
  * and the sensor positions, which are modeled as gaussians in global 3D
  * coordinates.
+ *
+ * Files are read through a read-only memory map, so that many threads
+ * can read carve maps from the same reader concurrently without
+ * locking.
+ *
+ * Since neighboring wedges share carve maps, each thread can also keep
+ * a cache_t of its most recently read carve maps.
  */
 
 #include <geometry/carve/gaussian/carve_map.h>
@@ -19,8 +26,6 @@
 #include <fstream>
 #include <string>
 #include <vector>
-#include <ios>
-#include <mutex> /* this needs to use g++ flag: -std=c++0x */
 
 /**
  * This namespace houses all i/o classes for .carvemap files
@@ -29,6 +34,7 @@ namespace cm_io
 {
 	/* the following classes are defined in this namespace */
 	class reader_t;
+	class cache_t;
 	class writer_t;
 	class header_t;
 	class frame_t;
@@ -137,22 +143,21 @@ namespace cm_io
 			void serialize(std::ostream& os) const;
 
 			/**
-			 * Will parse a gauss_dist_t from given stream
+			 * Will parse a gauss_dist_t from given buffer
 			 *
 			 * Will parse the information from the given
-			 * file stream, and store the resulting info
+			 * buffer, and store the resulting info
 			 * in this structure.  This will read a vector
 			 * and the upper half of the covariance matrix
 			 * from file, populating the mean and covariance
 			 * matrix in this structure, under the assumption
 			 * that the covariance matrix is symmetric.
 			 *
-			 * @param is   The input stream to use
-			 *
-			 * @return     Returns zero on success, non-zero
-			 *             on failure.
+			 * @param buf  The buffer to read, which must
+			 *             contain at least GAUSS_DIST_SIZE
+			 *             bytes
 			 */
-			int parse(std::istream& is);
+			void parse(const char* buf);
 	};
 
 	/**
@@ -169,7 +174,7 @@ namespace cm_io
 		private:
 
 			/* the position of the start of frame in file */
-			std::streampos fileloc;
+			size_t fileloc;
 
 			/* Number of scan points in this frame */
 			size_t num_points;
@@ -178,6 +183,11 @@ namespace cm_io
 			 * this frame */
 			gauss_dist_t sensor_pos;
 
+			/* the principal axes of the sensor covariance,
+			 * which are shared by every carve map in this
+			 * frame, so are only computed once */
+			Eigen::Matrix3d sensor_axes;
+
 		/* functions */
 		public:
 		
@@ -195,15 +205,16 @@ namespace cm_io
 			 *
 			 * This function will parse the number of points
 			 * and the sensor pos from a frame that is contained
-			 * in the input stream.
+			 * in the input buffer.
 			 *
-			 * @param is  The input stream should be aligned to
-			 *            the start of the frame.
+			 * @param buf  The buffer of the whole file
+			 * @param len  The length of buf, in bytes
+			 * @param loc  The offset of the frame in buf
 			 *
 			 * @return    Returns zero on success,
 			 *            non-zero on failure.
 			 */
-			int parse(std::istream& is);
+			int parse(const char* buf, size_t len, size_t loc);
 
 			/**
 			 * Will serialize this frame's header info to stream
@@ -242,14 +253,15 @@ namespace cm_io
 			header_t();
 
 			/**
-			 * Parses the header info from given file stream
+			 * Parses the header info from given buffer
 			 *
-			 * @param is   The input file stream to parse
+			 * @param buf  The start of the file contents
+			 * @param len  The length of buf, in bytes
 			 *
 			 * @return     Returns zero on success,
 			 *             non-zero on failure.
 			 */
-			int parse(std::istream& is);
+			int parse(const char* buf, size_t len);
 
 			/**
 			 * Prints the header info to the given stream
@@ -262,14 +274,21 @@ namespace cm_io
 	/**
 	 * The reader_t class can parse a .carvemap file and give random-
 	 * access to its contents
+	 *
+	 * The file is memory-mapped, and after open() returns the
+	 * reader is never modified by read(), so any number of threads
+	 * can call read() concurrently.
 	 */
 	class reader_t
 	{
 		/* parameters */
 		private:
 
-			/* the file stream to the carvemap file */
-			std::ifstream infile;
+			/* the file descriptor and memory map of the
+			 * carvemap file */
+			int fd;
+			const char* data;
+			size_t data_size;
 
 			/* the header information of this file */
 			header_t header;
@@ -280,11 +299,6 @@ namespace cm_io
 			 * be appropriately freed on deconstruction */
 			frame_t* frames;
 
-			/* This mutex will lock each time the get() function
-			 * is called, to allow this reader to be threadsafe
-			 */
-			std::mutex mtx;
-
 		/* functions */
 		public:
 
@@ -316,9 +330,12 @@ namespace cm_io
 			/**
 			 * Closes any open streams
 			 *
-			 * This call will close the file if it is open.  If
+			 * This call will unmap the file if it is open.  If
 			 * no file is open, then this call is a no-op. This
 			 * call will also free any used dynamic memory.
+			 *
+			 * This must not be called while other threads
+			 * are still reading.
 			 */
 			void close();
 
@@ -356,6 +373,8 @@ namespace cm_io
 			 * will parse the info of this carve map and store
 			 * the results in the given structure.
 			 *
+			 * This call is threadsafe and does not lock.
+			 *
 			 * @param cm   Where to store the parsed data
 			 * @param f    The frame index of this carve map
 			 * @param i    The point index within frame
@@ -363,7 +382,161 @@ namespace cm_io
 			 * @return     Returns zero on success, non-zero
 			 *             on failure.
 			 */
-			int read(carve_map_t& cm, size_t f, size_t i);
+			int read(carve_map_t& cm, size_t f, size_t i) const;
+
+			/**
+			 * Retrieves the mean positions of a carve map
+			 *
+			 * Gets the mean sensor position and the mean
+			 * scan point position of the specified carve
+			 * map, without initializing a full carve_map_t.
+			 *
+			 * This call is threadsafe and does not lock.
+			 *
+			 * @param s    Where to store the sensor mean
+			 * @param p    Where to store the scan point mean
+			 * @param f    The frame index of this carve map
+			 * @param i    The point index within frame
+			 *
+			 * @return     Returns zero on success, non-zero
+			 *             on failure.
+			 */
+			int read_means(Eigen::Vector3d& s, Eigen::Vector3d& p,
+			               size_t f, size_t i) const;
+
+			/**
+			 * Retrieves the means and ray variance of a map
+			 *
+			 * Gets the same mean positions as read_means(),
+			 * as well as the variance of the scan point
+			 * distribution along the ray from the sensor,
+			 * which is the value of get_scanpoint_var() of
+			 * the full carve map.  This is enough to find
+			 * the shape of a wedge, without the principal
+			 * axes a full carve_map_t needs.
+			 *
+			 * This call is threadsafe and does not lock.
+			 *
+			 * @param s    Where to store the sensor mean
+			 * @param p    Where to store the scan point mean
+			 * @param var  Where to store the scan point variance
+			 * @param f    The frame index of this carve map
+			 * @param i    The point index within frame
+			 *
+			 * @return     Returns zero on success, non-zero
+			 *             on failure.
+			 */
+			int read_extent(Eigen::Vector3d& s, Eigen::Vector3d& p,
+			                double& var, size_t f, size_t i) const;
+
+		/* helper functions */
+		private:
+
+			/* the reader owns its file descriptor and
+			 * memory map, so it cannot be copied */
+			reader_t(const reader_t& other);
+			reader_t& operator=(const reader_t& other);
+	};
+
+	/**
+	 * The cache_t class holds recently read carve maps
+	 *
+	 * Reading a carve map requires computing the principal axes of
+	 * its scan point distribution, and neighboring wedges reference
+	 * many of the same carve maps.  This cache keeps the most
+	 * recently used carve maps, keyed by frame and point index,
+	 * and only reads a carve map from the file when it is not
+	 * already cached.
+	 *
+	 * A cache should always be given the same reader, and is not
+	 * threadsafe, so each thread should use its own.
+	 */
+	class cache_t
+	{
+		/* parameters */
+		public:
+
+			/* the smallest allowed capacity, which is the
+			 * number of carve maps used by one wedge, so
+			 * that all of them can be held at once */
+			static const size_t MIN_CAPACITY = 4;
+
+			/* the default capacity */
+			static const size_t DEFAULT_CAPACITY = 32;
+
+		/* parameters */
+		private:
+
+			/* the cached carve maps */
+			std::vector<carve_map_t> maps;
+
+			/* the frame and point index of each cached map */
+			std::vector<size_t> frames;
+			std::vector<size_t> points;
+
+			/* the time each cached map was last used, which
+			 * is the value of the clock at that call */
+			std::vector<size_t> last_used;
+			size_t clock;
+
+			/* the number of maps currently cached */
+			size_t num_cached;
+
+			/* the number of calls to get(), and how many of
+			 * them had to read from the file */
+			size_t num_gets;
+			size_t num_reads;
+
+		/* functions */
+		public:
+
+			/**
+			 * Constructs an empty cache
+			 *
+			 * @param capacity   The number of carve maps to
+			 *                   hold, which is at least
+			 *                   MIN_CAPACITY
+			 */
+			cache_t(size_t capacity = DEFAULT_CAPACITY);
+
+			/**
+			 * Removes all maps from this cache, and resets
+			 * its statistics
+			 */
+			void clear();
+
+			/**
+			 * Gets the specified carve map
+			 *
+			 * If the carve map is not cached, it is read
+			 * from the given reader, replacing the least
+			 * recently used map.  The returned map remains
+			 * valid for at least the next MIN_CAPACITY-1
+			 * calls, so all maps of a wedge can be gotten
+			 * before the wedge is used.
+			 *
+			 * @param cm       Where to store a pointer to the map
+			 * @param reader   The reader to read maps from
+			 * @param f        The frame index of this carve map
+			 * @param i        The point index within frame
+			 *
+			 * @return     Returns zero on success, non-zero
+			 *             on failure.
+			 */
+			int get(carve_map_t*& cm, const reader_t& reader,
+			        size_t f, size_t i);
+
+			/**
+			 * Retrieves the number of calls to get()
+			 */
+			inline size_t get_num_gets() const
+			{ return this->num_gets; };
+
+			/**
+			 * Retrieves the number of maps read from file
+			 */
+			inline size_t get_num_reads() const
+			{ return this->num_reads; };
 	};
 
 	/**
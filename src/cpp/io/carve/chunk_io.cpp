@@ -7,6 +7,13 @@
 #include <string>
 #include <string.h>
 #include <vector>
+#include <algorithm>
+#include <stdlib.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include <util/error_codes.h>
 
 /**
@@ -15,8 +22,8 @@
  *
  * @section DESCRIPTION
  *
- * Implements the reader and writer classes for the .chunk and .chunklist
- * file formats.
+ * Implements the reader and writer classes for the .chunk, .chunklist,
+ * and .chunkarchive file formats.
  */
 
 /* use the following namespaces for the implementations in this file */
@@ -34,7 +41,7 @@ chunklist_header_t::chunklist_header_t()
 			
 void chunklist_header_t::init(double cx, double cy, double cz, 
                               double hw, const std::string& cd, 
-                              size_t nc)
+                              size_t nc, const std::string& ca)
 {
 	/* set all values in the header to either default values or
 	 * to the provided values */
@@ -44,6 +51,7 @@ void chunklist_header_t::init(double cx, double cy, double cz,
 	this->halfwidth = hw;
 	this->chunk_dir = cd;
 	this->num_chunks = nc;
+	this->chunk_archive = ca;
 }
 			
 int chunklist_header_t::parse(istream& infile)
@@ -107,6 +115,11 @@ int chunklist_header_t::parse(istream& infile)
 						!= FILE_SEPERATOR)
 				this->chunk_dir.push_back(FILE_SEPERATOR);
 		}
+		else if(!tag.compare(HEADER_TAG_CHUNK_ARCHIVE))
+		{
+			/* store the chunk archive path */
+			parser >> (this->chunk_archive);
+		}
 		else
 		{
 			/* unknown tag */
@@ -164,6 +177,9 @@ void chunklist_header_t::print(ostream& outfile) const
 	   << this->num_chunks << endl
 	   << HEADER_TAG_CHUNK_DIR << " "
 	   << this->chunk_dir << endl;
+	if(!(this->chunk_archive.empty()))
+		outfile << HEADER_TAG_CHUNK_ARCHIVE << " "
+		        << this->chunk_archive << endl;
 
 	/* close the header */
 	outfile << END_HEADER_STRING << endl;
@@ -240,6 +256,16 @@ size_t chunklist_reader_t::num_chunks() const
 {
 	return this->header.num_chunks;
 }
+
+string chunklist_reader_t::archive_file() const
+{
+	/* check if chunks are stored as files */
+	if(this->header.chunk_archive.empty())
+		return "";
+
+	/* archive path is relative to the chunklist */
+	return this->directory + this->header.chunk_archive;
+}
 			
 int chunklist_reader_t::next(std::string& file)
 {
@@ -257,9 +283,12 @@ int chunklist_reader_t::next(std::string& file)
 		return -2;
 
 	/* populate the file location */
-	file = chunklist_reader_t::get_chunkfile_for(
-			this->directory + this->header.chunk_dir,
-			uuid);
+	if(!(this->header.chunk_archive.empty()))
+		file = this->archive_file() + ARCHIVE_UUID_SEPERATOR + uuid;
+	else
+		file = chunklist_reader_t::get_chunkfile_for(
+				this->directory + this->header.chunk_dir,
+				uuid);
 
 	/* success */
 	return 0;
@@ -307,10 +336,10 @@ chunklist_writer_t::~chunklist_writer_t()
 
 void chunklist_writer_t::init(double cx, double cy, double cz, 
                               double hw, const std::string& cd, 
-                              size_t nc)
+                              size_t nc, const std::string& ca)
 {
 	/* initialize header object */
-	this->header.init(cx, cy, cz, hw, cd, nc);
+	this->header.init(cx, cy, cz, hw, cd, nc, ca);
 }
 			
 int chunklist_writer_t::open(const std::string& filename)
@@ -460,7 +489,8 @@ void chunk_header_t::write_num_points(std::ostream& os,
 
 chunk_reader_t::chunk_reader_t()
 {
-	/* No parameters need to be explicitly set */
+	/* set defaults */
+	this->archived_pos = 0;
 }
 
 chunk_reader_t::~chunk_reader_t()
@@ -469,13 +499,65 @@ chunk_reader_t::~chunk_reader_t()
 	this->close();
 }
 			
-int chunk_reader_t::open(const std::string& filename)
+int chunk_reader_t::open(const std::string& filename,
+                         const chunk_archive_reader_t* archive)
 {
+	chunk_archive_reader_t local_archive;
+	chunk_archive_entry_t entry;
+	string archivefile;
+	unsigned long long uuid;
+	size_t sep, c;
 	int ret;
 
 	/* close any open streams */
 	this->close();
 
+	/* check if this file references a chunk in an archive */
+	sep = filename.find_last_of(ARCHIVE_UUID_SEPERATOR);
+	if(sep != string::npos && sep > filename.find_last_of("\\/")
+			&& sep+1 < filename.size())
+	{
+		/* get the archive and uuid referenced */
+		archivefile = filename.substr(0, sep);
+		uuid = strtoull(filename.c_str() + sep + 1, NULL, 16);
+
+		/* open the archive if the caller did not */
+		if(archive == NULL 
+			|| archive->get_filename().compare(archivefile))
+		{
+			ret = local_archive.open(archivefile);
+			if(ret)
+				return PROPEGATE_ERROR(-1, ret);
+			archive = &local_archive;
+		}
+
+		/* read the chunk from the archive */
+		ret = archive->find(uuid, c);
+		if(ret)
+		{
+			cerr << "[chunk::chunk_reader_t::open]\t"
+			     << "Chunk not found in archive: "
+			     << filename << endl;
+			return PROPEGATE_ERROR(-2, ret);
+		}
+		ret = archive->read(c, entry, this->archived_pts);
+		if(ret)
+		{
+			cerr << "[chunk::chunk_reader_t::open]\t"
+			     << "Unable to read chunk from archive: "
+			     << filename << endl;
+			this->archived_pts.clear();
+			return PROPEGATE_ERROR(-3, ret);
+		}
+
+		/* store the header info of this chunk */
+		this->header.init(entry.uuid, entry.center_x,
+		                  entry.center_y, entry.center_z,
+		                  entry.halfwidth);
+		this->header.num_points = this->archived_pts.size();
+		return 0;
+	}
+
 	/* attempt to open binary file stream */
 	this->infile.open(filename.c_str(),
 			ios_base::in | ios_base::binary);
@@ -485,7 +567,7 @@ int chunk_reader_t::open(const std::string& filename)
 		cerr << "[chunk::chunk_reader_t::open]\t"
 		     << "Unable to open file for reading: "
 		     << filename << endl;
-		return -1;
+		return -4;
 	}
 
 	/* read in header information */
@@ -497,7 +579,7 @@ int chunk_reader_t::open(const std::string& filename)
 		     << "Unable to parse header from file: "
 		     << filename << endl;
 		this->infile.close();
-		return -2;
+		return -5;
 	}
 
 	/* success */
@@ -506,6 +588,15 @@ int chunk_reader_t::open(const std::string& filename)
 			
 int chunk_reader_t::next(point_index_t& i)
 {
+	/* check if reading from an archived chunk */
+	if(!(this->infile.is_open()))
+	{
+		if(this->archived_pos >= this->archived_pts.size())
+			return -1; /* no more points */
+		i = this->archived_pts[this->archived_pos++];
+		return 0;
+	}
+
 	/* check if we're good */
 	if(this->infile.bad())
 		return -1; /* not good */
@@ -542,6 +633,10 @@ void chunk_reader_t::close()
 	/* check if streams are open.  If so, close them */
 	if(this->infile.is_open())
 		this->infile.close();
+
+	/* free any archived points */
+	this->archived_pts.clear();
+	this->archived_pos = 0;
 }
 
 /*--------------------------*/
@@ -641,6 +736,436 @@ void chunk_writer_t::close()
 	this->pts.clear();
 }
 
+/*---------------------------------*/
+/* chunk_archive_entry_t functions */
+/*---------------------------------*/
+
+chunk_archive_entry_t::chunk_archive_entry_t()
+{
+	/* set default values */
+	this->uuid = 0;
+	this->center_x = 0.0;
+	this->center_y = 0.0;
+	this->center_z = 0.0;
+	this->halfwidth = -1;
+	this->num_points = 0;
+	this->last_block = 0;
+}
+
+void chunk_archive_entry_t::parse(const char* buf)
+{
+	/* all values are assumed to be in little-endian ordering,
+	 * and may not be aligned within the buffer */
+	memcpy(&(this->uuid), buf, sizeof(this->uuid));
+	buf += sizeof(this->uuid);
+	memcpy(&(this->center_x), buf, sizeof(this->center_x));
+	buf += sizeof(this->center_x);
+	memcpy(&(this->center_y), buf, sizeof(this->center_y));
+	buf += sizeof(this->center_y);
+	memcpy(&(this->center_z), buf, sizeof(this->center_z));
+	buf += sizeof(this->center_z);
+	memcpy(&(this->halfwidth), buf, sizeof(this->halfwidth));
+	buf += sizeof(this->halfwidth);
+	memcpy(&(this->num_points), buf, sizeof(this->num_points));
+	buf += sizeof(this->num_points);
+	memcpy(&(this->last_block), buf, sizeof(this->last_block));
+}
+
+void chunk_archive_entry_t::print(std::ostream& os) const
+{
+	/* write values */
+	os.write((char*) &(this->uuid),       sizeof(this->uuid));
+	os.write((char*) &(this->center_x),   sizeof(this->center_x));
+	os.write((char*) &(this->center_y),   sizeof(this->center_y));
+	os.write((char*) &(this->center_z),   sizeof(this->center_z));
+	os.write((char*) &(this->halfwidth),  sizeof(this->halfwidth));
+	os.write((char*) &(this->num_points), sizeof(this->num_points));
+	os.write((char*) &(this->last_block), sizeof(this->last_block));
+}
+
+/*----------------------------------*/
+/* chunk_archive_reader_t functions */
+/*----------------------------------*/
+
+/* the size of the header of each block in an archive:
+ * the uuid, the offset of the previous block, and the count */
+#define ARCHIVE_BLOCK_HEADER_SIZE (2*sizeof(unsigned long long) \
+                                   + sizeof(unsigned int))
+
+/* the size of the footer of an archive: the offset of the
+ * chunk table, and the number of chunks */
+#define ARCHIVE_FOOTER_SIZE (2*sizeof(unsigned long long))
+
+chunk_archive_reader_t::chunk_archive_reader_t()
+{
+	/* set defaults */
+	this->fd = -1;
+	this->data = NULL;
+	this->data_size = 0;
+	this->table = NULL;
+	this->num_entries = 0;
+	this->filename = "";
+}
+
+chunk_archive_reader_t::~chunk_archive_reader_t()
+{
+	/* free all resources */
+	this->close();
+}
+
+int chunk_archive_reader_t::open(const std::string& fn)
+{
+	struct stat st;
+	unsigned long long table_loc, n;
+	void* addr;
+
+	/* close any open files */
+	this->close();
+
+	/* attempt to open the file */
+	this->fd = ::open(fn.c_str(), O_RDONLY);
+	if(this->fd < 0 || fstat(this->fd, &st) != 0)
+	{
+		cerr << "[chunk::chunk_archive_reader_t::open]\t"
+		     << "Unable to open file for reading: "
+		     << fn << endl;
+		this->close();
+		return -1;
+	}
+
+	/* check the file is large enough to be valid */
+	this->data_size = st.st_size;
+	if(this->data_size < CHUNKARCHIVE_MAGIC_NUMBER_SIZE
+				+ ARCHIVE_FOOTER_SIZE)
+	{
+		cerr << "[chunk::chunk_archive_reader_t::open]\t"
+		     << "Input file is not a valid .chunkarchive file: "
+		     << fn << endl;
+		this->close();
+		return -2;
+	}
+
+	/* map the file into memory */
+	addr = mmap(NULL, this->data_size, PROT_READ, MAP_SHARED,
+	            this->fd, 0);
+	if(addr == MAP_FAILED)
+	{
+		cerr << "[chunk::chunk_archive_reader_t::open]\t"
+		     << "Unable to map file into memory: " 
+		     << fn << endl;
+		this->data_size = 0;
+		this->close();
+		return -3;
+	}
+	this->data = (const char*) addr;
+
+	/* check for magic number */
+	if(memcmp(this->data, CHUNKARCHIVE_MAGIC_NUMBER.c_str(),
+			CHUNKARCHIVE_MAGIC_NUMBER_SIZE))
+	{
+		cerr << "[chunk::chunk_archive_reader_t::open]\t"
+		     << "Input file is not a valid .chunkarchive file: "
+		     << fn << endl;
+		this->close();
+		return -4;
+	}
+
+	/* read the footer, and verify the table is in the file */
+	memcpy(&table_loc, this->data + this->data_size 
+			- ARCHIVE_FOOTER_SIZE, sizeof(table_loc));
+	memcpy(&n, this->data + this->data_size - sizeof(n), sizeof(n));
+	if(table_loc > this->data_size - ARCHIVE_FOOTER_SIZE
+		|| n > (this->data_size - ARCHIVE_FOOTER_SIZE - table_loc)
+				/ chunk_archive_entry_t::SIZE)
+	{
+		cerr << "[chunk::chunk_archive_reader_t::open]\t"
+		     << "Chunk table is corrupt in file: "
+		     << fn << endl;
+		this->close();
+		return -5;
+	}
+	this->table = this->data + table_loc;
+	this->num_entries = n;
+
+	/* success */
+	this->filename = fn;
+	return 0;
+}
+
+void chunk_archive_reader_t::close()
+{
+	/* unmap the file */
+	if(this->data != NULL)
+	{
+		munmap((void*) this->data, this->data_size);
+		this->data = NULL;
+	}
+	this->data_size = 0;
+	this->table = NULL;
+	this->num_entries = 0;
+	this->filename = "";
+
+	/* close the file */
+	if(this->fd >= 0)
+	{
+		::close(this->fd);
+		this->fd = -1;
+	}
+}
+
+int chunk_archive_reader_t::find(unsigned long long uuid, size_t& c) const
+{
+	unsigned long long u;
+	size_t lo, hi, mid;
+
+	/* binary search the table, which is sorted by uuid */
+	lo = 0;
+	hi = this->num_entries;
+	while(lo < hi)
+	{
+		mid = lo + (hi - lo)/2;
+		memcpy(&u, this->table + mid*chunk_archive_entry_t::SIZE,
+		       sizeof(u));
+		if(u < uuid)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	/* check if we found it */
+	if(lo >= this->num_entries)
+		return -1;
+	memcpy(&u, this->table + lo*chunk_archive_entry_t::SIZE, sizeof(u));
+	if(u != uuid)
+		return -2;
+
+	/* success */
+	c = lo;
+	return 0;
+}
+
+int chunk_archive_reader_t::read(size_t c, chunk_archive_entry_t& e,
+                                 std::vector<point_index_t>& pts) const
+{
+	vector<unsigned long long> blocks;
+	unsigned long long loc, u;
+	unsigned int count;
+	const char* p;
+	size_t i, n, total;
+
+	/* verify input */
+	if(c >= this->num_entries)
+		return -1;
+	e.parse(this->table + c*chunk_archive_entry_t::SIZE);
+
+	/* walk backwards through the blocks of this chunk */
+	total = 0;
+	for(loc = e.last_block; loc != 0; )
+	{
+		/* check that this block is in the file */
+		if(loc < CHUNKARCHIVE_MAGIC_NUMBER_SIZE 
+				|| loc + ARCHIVE_BLOCK_HEADER_SIZE 
+					> this->data_size)
+			return -2;
+		p = this->data + loc;
+		memcpy(&u, p, sizeof(u));
+		p += sizeof(u);
+		blocks.push_back(loc);
+
+		/* check that it belongs to this chunk */
+		if(u != e.uuid)
+			return -3;
+		memcpy(&loc, p, sizeof(loc));
+		p += sizeof(loc);
+		memcpy(&count, p, sizeof(count));
+		total += count;
+
+		/* blocks are written in order, so the previous
+		 * block must come earlier in the file */
+		if(loc >= blocks.back())
+			return -4;
+	}
+	if(total != e.num_points)
+		return -5;
+
+	/* read the blocks in the order they were written */
+	pts.resize(total);
+	total = 0;
+	for(i = blocks.size(); i > 0; i--)
+	{
+		p = this->data + blocks[i-1] + 2*sizeof(unsigned long long);
+		memcpy(&count, p, sizeof(count));
+		p += sizeof(count);
+		n = count;
+		if(blocks[i-1] + ARCHIVE_BLOCK_HEADER_SIZE
+				+ n*sizeof(size_t) > this->data_size)
+			return -6;
+		for(; n > 0; n--, p += sizeof(size_t))
+			memcpy(&(pts[total++].wedge_index), p, sizeof(size_t));
+	}
+
+	/* success */
+	return 0;
+}
+
+/*----------------------------------*/
+/* chunk_archive_writer_t functions */
+/*----------------------------------*/
+
+chunk_archive_writer_t::chunk_archive_writer_t()
+{
+	/* set defaults */
+	this->num_buffered = 0;
+}
+
+chunk_archive_writer_t::~chunk_archive_writer_t()
+{
+	/* close the file if it is open */
+	this->close();
+}
+
+int chunk_archive_writer_t::open(const std::string& filename)
+{
+	/* close streams if necessary */
+	this->close();
+
+	/* attempt to open this binary file for writing */
+	this->outfile.open(filename.c_str(),
+			ios_base::out | ios_base::binary);
+	if(!(this->outfile.is_open()))
+	{
+		/* unable to open file for writing */
+		cerr << "[chunk::chunk_archive_writer_t::open]\t"
+		     << "Unable to open file for writing: "
+		     << filename << endl;
+		return -1;
+	}
+
+	/* write magic number */
+	this->outfile.write(CHUNKARCHIVE_MAGIC_NUMBER.c_str(),
+	                    CHUNKARCHIVE_MAGIC_NUMBER_SIZE);
+
+	/* success */
+	return 0;
+}
+
+size_t chunk_archive_writer_t::add_chunk(unsigned long long uuid,
+                                         double cx, double cy, double cz,
+                                         double hw)
+{
+	chunk_archive_entry_t e;
+
+	/* prepare the table entry for this chunk */
+	e.uuid = uuid;
+	e.center_x = cx;
+	e.center_y = cy;
+	e.center_z = cz;
+	e.halfwidth = hw;
+
+	/* add it, with an empty buffer */
+	this->entries.push_back(e);
+	this->buffers.resize(this->entries.size());
+	return (this->entries.size() - 1);
+}
+
+void chunk_archive_writer_t::write(size_t c, const point_index_t& i)
+{
+	size_t j, n;
+
+	/* buffer this index */
+	this->buffers[c].push_back(i);
+	this->entries[c].num_points++;
+	this->num_buffered++;
+
+	/* check if this chunk has a full block to write */
+	if(this->buffers[c].size() >= ARCHIVE_BLOCK_SIZE)
+		this->flush(c);
+
+	/* check if too much is buffered overall */
+	if(this->num_buffered >= ARCHIVE_MAX_BUFFERED)
+	{
+		n = this->buffers.size();
+		for(j = 0; j < n; j++)
+			this->flush(j);
+	}
+}
+
+int chunk_archive_writer_t::close()
+{
+	unsigned long long table_loc, n;
+	vector<chunk_archive_entry_t> sorted;
+	size_t i;
+
+	/* check if stream is even open */
+	if(!(this->outfile.is_open()))
+		return 0;
+
+	/* write any remaining buffered indices */
+	n = this->buffers.size();
+	for(i = 0; i < n; i++)
+		this->flush(i);
+
+	/* write the chunk table sorted by uuid, so that it can be
+	 * searched by readers */
+	sorted.insert(sorted.end(), this->entries.begin(),
+	              this->entries.end());
+	std::sort(sorted.begin(), sorted.end());
+	table_loc = this->outfile.tellp();
+	for(i = 0; i < n; i++)
+		sorted[i].print(this->outfile);
+
+	/* write the footer */
+	this->outfile.write((char*) &table_loc, sizeof(table_loc));
+	this->outfile.write((char*) &n, sizeof(n));
+
+	/* check the stream before closing it */
+	i = this->outfile.bad();
+	this->outfile.close();
+	this->entries.clear();
+	this->buffers.clear();
+	this->num_buffered = 0;
+	if(i)
+	{
+		cerr << "[chunk::chunk_archive_writer_t::close]\t"
+		     << "Unable to finish writing archive" << endl;
+		return -1;
+	}
+
+	/* success */
+	return 0;
+}
+
+void chunk_archive_writer_t::flush(size_t c)
+{
+	unsigned long long loc;
+	unsigned int count;
+	size_t i;
+
+	/* check if there is anything to write */
+	count = this->buffers[c].size();
+	if(count == 0)
+		return;
+
+	/* write the block header, which links to the previous
+	 * block of this chunk */
+	loc = this->outfile.tellp();
+	this->outfile.write((char*) &(this->entries[c].uuid),
+	                    sizeof(this->entries[c].uuid));
+	this->outfile.write((char*) &(this->entries[c].last_block),
+	                    sizeof(this->entries[c].last_block));
+	this->outfile.write((char*) &count, sizeof(count));
+	this->entries[c].last_block = loc;
+
+	/* write the indices */
+	for(i = 0; i < count; i++)
+		this->buffers[c][i].print(this->outfile);
+
+	/* free the buffer, rather than keeping its capacity, so
+	 * the memory used stays bounded */
+	this->num_buffered -= count;
+	vector<point_index_t>().swap(this->buffers[c]);
+}
+
 /*-------------------------*/
 /* point_index_t functions */
 /*-------------------------*/
@@ -10,6 +10,10 @@
  * This file contains classes used to read and write .chunk files,
  * which are used to define which scan points intersect which subsets
  * of the scan volume.
+ *
+ * Chunks can either be stored as individual .chunk files, or packed
+ * together into a single .chunkarchive file, which is indexed by
+ * chunk uuid.
  */
 
 #include <string>
@@ -35,6 +39,9 @@ namespace chunk
 	class chunk_header_t;
 	class chunk_reader_t;
 	class chunk_writer_t;
+	class chunk_archive_entry_t;
+	class chunk_archive_reader_t;
+	class chunk_archive_writer_t;
 	class point_index_t;
 
 	/* the following definitions are used for .chunklist file i/o */
@@ -43,17 +50,36 @@ namespace chunk
 	static const size_t      CHUNKFILE_MAGIC_NUMBER_SIZE =
 	                        (CHUNKFILE_MAGIC_NUMBER.size()+1);
 	static const std::string END_HEADER_STRING           = "end_header";
+	static const std::string CHUNKARCHIVE_MAGIC_NUMBER   = "chunkarchive";
+	static const size_t      CHUNKARCHIVE_MAGIC_NUMBER_SIZE =
+	                        (CHUNKARCHIVE_MAGIC_NUMBER.size()+1);
 
 	/* the following are valid header tags in the .chunklist file */
 	static const std::string HEADER_TAG_CENTER        = "center";
 	static const std::string HEADER_TAG_HALFWIDTH     = "halfwidth";
 	static const std::string HEADER_TAG_NUM_CHUNKS    = "num_chunks";
 	static const std::string HEADER_TAG_CHUNK_DIR     = "chunk_dir";
+	static const std::string HEADER_TAG_CHUNK_ARCHIVE = "chunk_archive";
 
 	/* the following are file extensions used by these classes */
 	static const std::string CHUNKFILE_EXTENSION      = ".chunk";
+	static const std::string CHUNKARCHIVE_EXTENSION   = ".chunkarchive";
 	static const char FILE_SEPERATOR                  = '/';
 
+	/* Chunks stored in an archive are referenced by strings of the
+	 * form <archive file>#<uuid>, which can be given to 
+	 * chunk_reader_t::open() in place of a .chunk file path */
+	static const char ARCHIVE_UUID_SEPERATOR          = '#';
+
+	/* Chunk archives are written as a stream of blocks, where each
+	 * block holds indices for a single chunk.  These values bound
+	 * the memory used when writing archives, in units of number of
+	 * point indices:  a chunk is flushed to disk when it buffers a
+	 * full block, and all chunks are flushed when the total buffered
+	 * across all chunks reaches the max. */
+	static const size_t ARCHIVE_BLOCK_SIZE            = 1024;
+	static const size_t ARCHIVE_MAX_BUFFERED          = (1 << 22);
+
 	/* Chunk files are put into a hierarchical directory structure,
 	 * used to make sure no one directory has too many files in it.
 	 * The following value indicates how often a new directory is
@@ -80,6 +106,9 @@ namespace chunk
 			size_t num_chunks; /* number of chunks */
 			std::string chunk_dir; /* location of chunk files,
 			                        * includes '/' at end */
+			std::string chunk_archive; /* location of chunk
+			                            * archive, empty if
+			                            * chunks are files */
 
 		/* functions */
 		public:
@@ -101,10 +130,12 @@ namespace chunk
 			 * @param hw   The halfwidth of root
 			 * @param cd   The chunk directory
 			 * @param nc   The number of chunks to write
+			 * @param ca   The chunk archive file, if chunks
+			 *             are packed into an archive
 			 */
 			void init(double cx, double cy, double cz, 
 			          double hw, const std::string& cd, 
-			          size_t nc);
+			          size_t nc, const std::string& ca = "");
 
 			/**
 			 * Parses the header from the given file stream
@@ -235,6 +266,17 @@ namespace chunk
 			 */
 			size_t num_chunks() const;
 
+			/**
+			 * Returns the path to the chunk archive
+			 *
+			 * If the chunks of this list are packed into
+			 * a .chunkarchive file, then returns its path
+			 * (relative to the working directory).  If the
+			 * chunks are stored as individual .chunk files,
+			 * then returns the empty string.
+			 */
+			std::string archive_file() const;
+
 			/**
 			 * Retrieves the next chunk file
 			 *
@@ -244,6 +286,11 @@ namespace chunk
 			 * be relative to the currently parsed .chunklist
 			 * file.
 			 *
+			 * If the chunks are stored in an archive, then
+			 * the returned string references the chunk
+			 * within the archive file.  In either case,
+			 * it can be passed to chunk_reader_t::open().
+			 *
 			 * @param file    The next parsed chunk file path
 			 *
 			 * @return        Returns zero on success,
@@ -322,10 +369,13 @@ namespace chunk
 			 * @param hw   The halfwidth of root
 			 * @param cd   The chunk directory
 			 * @param nc   The number of chunks to write
+			 * @param ca   The chunk archive file, relative
+			 *             to the chunklist, if chunks are
+			 *             packed into an archive
 			 */
 			void init(double cx, double cy, double cz, 
 			          double hw, const std::string& cd, 
-			          size_t nc);
+			          size_t nc, const std::string& ca = "");
 
 			/**
 			 * Opens file for writing
@@ -469,6 +519,12 @@ namespace chunk
 			/* header information from the file */
 			chunk_header_t header;
 
+			/* if this chunk was read from an archive, then
+			 * its indices are stored here, and next()
+			 * iterates over them rather than the stream */
+			std::vector<point_index_t> archived_pts;
+			size_t archived_pos;
+
 		/* functions */
 		public:
 
@@ -541,12 +597,21 @@ namespace chunk
 			 * .chunk file for reading.  On success, the
 			 * header will be parsed from the file.
 			 *
+			 * The filename may also reference a chunk
+			 * within a .chunkarchive file, as returned by
+			 * chunklist_reader_t::next().  If the archive
+			 * is already open, it can be provided to avoid
+			 * reopening it.
+			 *
 			 * @param filename   The path to the file to open
+			 * @param archive    Optional.  The opened archive
+			 *                   that filename references
 			 *
 			 * @return    Returns zero on success, non-zero
 			 *            on error.
 			 */
-			int open(const std::string& filename);
+			int open(const std::string& filename,
+			         const chunk_archive_reader_t* archive=NULL);
 
 			/**
 			 * Retrieves the next index set from the file
@@ -672,6 +737,274 @@ namespace chunk
 			void close();
 	};
 	
+	/**
+	 * An entry in the chunk table of a .chunkarchive file
+	 */
+	class chunk_archive_entry_t
+	{
+		/* parameters */
+		public:
+
+			/* the geometry of this chunk, as in the
+			 * header of a .chunk file */
+			unsigned long long uuid;
+			double center_x;
+			double center_y;
+			double center_z;
+			double halfwidth;
+			unsigned int num_points;
+
+			/* the offset in the archive of the last block
+			 * written for this chunk, which references the
+			 * blocks before it.  Zero if no blocks. */
+			unsigned long long last_block;
+
+		/* functions */
+		public:
+
+			/**
+			 * Initializes default (invalid) entry
+			 */
+			chunk_archive_entry_t();
+
+			/**
+			 * Parses an entry from the given buffer
+			 *
+			 * @param buf   The buffer to read, which must
+			 *              contain at least SIZE bytes
+			 */
+			void parse(const char* buf);
+
+			/**
+			 * Prints this entry to the given binary stream
+			 *
+			 * @param os   The stream to write to
+			 */
+			void print(std::ostream& os) const;
+
+			/**
+			 * Used for sorting entries by uuid
+			 */
+			inline bool operator < (
+				const chunk_archive_entry_t& other) const
+			{ return (this->uuid < other.uuid); };
+
+			/**
+			 * The size of an entry on disk, in bytes
+			 */
+			static const size_t SIZE = (2*sizeof(unsigned long long)
+			                + 4*sizeof(double) + sizeof(unsigned int));
+	};
+
+	/**
+	 * This parses packed .chunkarchive files from disk.
+	 *
+	 * The archive is memory-mapped, and is not modified after
+	 * being opened, so multiple threads can read chunks from
+	 * the same archive concurrently.
+	 */
+	class chunk_archive_reader_t
+	{
+		/* parameters */
+		private:
+
+			/* the file descriptor and memory map of the
+			 * archive */
+			int fd;
+			const char* data;
+			size_t data_size;
+
+			/* the chunk table, which is sorted by uuid */
+			const char* table;
+			size_t num_entries;
+
+			/* the path to the open archive */
+			std::string filename;
+
+		/* functions */
+		public:
+
+			/*--------------*/
+			/* constructors */
+			/*--------------*/
+
+			/**
+			 * Initializes empty reader
+			 */
+			chunk_archive_reader_t();
+
+			/**
+			 * Frees all memory and resources
+			 */
+			~chunk_archive_reader_t();
+
+			/*-----*/
+			/* i/o */
+			/*-----*/
+
+			/**
+			 * Opens a .chunkarchive file for reading
+			 *
+			 * @param fn   The path to the archive to open
+			 *
+			 * @return     Returns zero on success, non-zero
+			 *             on failure.
+			 */
+			int open(const std::string& fn);
+
+			/**
+			 * Closes the archive, if open
+			 *
+			 * This must not be called while other threads
+			 * are still reading.
+			 */
+			void close();
+
+			/*-----------*/
+			/* accessors */
+			/*-----------*/
+
+			/**
+			 * Returns the path to the opened archive
+			 */
+			inline const std::string& get_filename() const
+			{ return this->filename; };
+
+			/**
+			 * Returns the number of chunks in the archive
+			 */
+			inline size_t num_chunks() const
+			{ return this->num_entries; };
+
+			/**
+			 * Finds the table index of the given chunk
+			 *
+			 * @param uuid   The uuid of the chunk to find
+			 * @param c      Where to store the table index
+			 *
+			 * @return       Returns zero on success, non-zero
+			 *               if the chunk is not present.
+			 */
+			int find(unsigned long long uuid, size_t& c) const;
+
+			/**
+			 * Reads the given chunk from the archive
+			 *
+			 * Will read the table entry and all point
+			 * indices of the c'th chunk, in the order they
+			 * were written.  This call is threadsafe.
+			 *
+			 * @param c     The table index of the chunk
+			 * @param e     Where to store the table entry
+			 * @param pts   Where to store the point indices
+			 *
+			 * @return      Returns zero on success, non-zero
+			 *              on failure.
+			 */
+			int read(size_t c, chunk_archive_entry_t& e,
+			         std::vector<point_index_t>& pts) const;
+	};
+
+	/**
+	 * This writes packed .chunkarchive files to disk.
+	 *
+	 * Point indices are buffered per chunk and streamed to disk
+	 * as blocks, so the memory used does not depend on the total
+	 * number of indices written.
+	 */
+	class chunk_archive_writer_t
+	{
+		/* parameters */
+		private:
+
+			/* the output stream to write to */
+			std::ofstream outfile;
+
+			/* the table entry of each chunk added */
+			std::vector<chunk_archive_entry_t> entries;
+
+			/* the indices for each chunk that have not
+			 * yet been written to disk */
+			std::vector<std::vector<point_index_t> > buffers;
+			size_t num_buffered;
+
+		/* functions */
+		public:
+
+			/*--------------*/
+			/* constructors */
+			/*--------------*/
+
+			/**
+			 * Initializes empty writer
+			 */
+			chunk_archive_writer_t();
+
+			/**
+			 * Frees all memory and resources
+			 */
+			~chunk_archive_writer_t();
+
+			/*-----*/
+			/* i/o */
+			/*-----*/
+
+			/**
+			 * Opens a .chunkarchive file for writing
+			 *
+			 * @param filename   The file to write to
+			 *
+			 * @return    Returns zero on success, non-zero
+			 *            on failure.
+			 */
+			int open(const std::string& filename);
+
+			/**
+			 * Adds a new chunk to this archive
+			 *
+			 * @param uuid   The uuid for this chunk
+			 * @param cx     The x-coordinate of chunk center
+			 * @param cy     The y-coordinate of chunk center
+			 * @param cz     The z-coordinate of chunk center
+			 * @param hw     The halfwidth of chunk volume
+			 *
+			 * @return   Returns the index of the new chunk,
+			 *           to be used with write()
+			 */
+			size_t add_chunk(unsigned long long uuid,
+			                 double cx, double cy, double cz,
+			                 double hw);
+
+			/**
+			 * Writes a point index to the given chunk
+			 *
+			 * @param c   The index of the chunk, as returned
+			 *            by add_chunk()
+			 * @param i   The point index to write
+			 */
+			void write(size_t c, const point_index_t& i);
+
+			/**
+			 * Flushes all chunks and writes the chunk table
+			 *
+			 * If the writer is not open, this is a no-op.
+			 *
+			 * @return    Returns zero on success, non-zero
+			 *            on failure.
+			 */
+			int close();
+
+		/* helper functions */
+		private:
+
+			/**
+			 * Writes the buffered indices of a chunk as a block
+			 *
+			 * @param c   The index of the chunk to flush
+			 */
+			void flush(size_t c);
+	};
+	
 	/**
 	 * This class represents the global indices of a single scan point
 	 */
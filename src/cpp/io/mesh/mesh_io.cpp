@@ -21,6 +21,29 @@
 using namespace std;
 using namespace mesh_io;
 
+/* helper functions */
+
+/**
+ * Determines the file format to use for the given file name
+ *
+ * @param filename   The filename to analyze
+ * @param current    The current format of the mesh
+ *
+ * @return   Returns the deduced format
+ */
+static FILE_FORMAT format_for_file(const string& filename,
+                                   FILE_FORMAT current);
+
+/**
+ * Returns the given format with or without color
+ *
+ * @param f       The format to modify
+ * @param color   Whether the format should have color
+ *
+ * @return   Returns the modified format
+ */
+static FILE_FORMAT format_with_color(FILE_FORMAT f, bool color);
+
 /*---------------------------------*/
 /* mesh_t function implementations */ 
 /*---------------------------------*/
@@ -162,53 +185,7 @@ int mesh_t::write(const string& filename, FILE_FORMAT f) const
 			
 void mesh_t::set_color(bool color)
 {
-	if(color)
-	{
-		switch(this->format)
-		{
-			default:
-				/* do nothing */
-				return;
-
-			/* go from non-colored to color */
-			case FORMAT_UNKNOWN:
-			case FORMAT_OBJ:
-				this->format = FORMAT_OBJ_COLOR;
-				break;
-			case FORMAT_PLY_ASCII:
-				this->format = FORMAT_PLY_ASCII_COLOR;
-				break;
-			case FORMAT_PLY_BE:
-				this->format = FORMAT_PLY_BE_COLOR;
-				break;
-			case FORMAT_PLY_LE:
-				this->format = FORMAT_PLY_LE_COLOR;
-				break;
-		}
-	}
-	else
-	{
-		switch(this->format)
-		{
-			default:
-				/* do nothing */
-				return;
-
-			/* go from colored to non-colored */
-			case FORMAT_OBJ_COLOR:
-				this->format = FORMAT_OBJ;
-				break;
-			case FORMAT_PLY_ASCII_COLOR:
-				this->format = FORMAT_PLY_ASCII;
-				break;
-			case FORMAT_PLY_BE_COLOR:
-				this->format = FORMAT_PLY_BE;
-				break;
-			case FORMAT_PLY_LE_COLOR:
-				this->format = FORMAT_PLY_LE;
-				break;
-		}
-	}
+	this->format = format_with_color(this->format, color);
 }
 			
 void mesh_t::clear()
@@ -253,67 +230,7 @@ void mesh_t::add(const mesh_t& other)
 			
 FILE_FORMAT mesh_t::get_format(const string& filename) const
 {
-	size_t p;
-	string suffix;
-
-	/* get position of last dot */
-	p = filename.find_last_of('.');
-	if(p == string::npos)
-		return FORMAT_UNKNOWN;
-
-	/* determine format from suffix */
-	suffix = filename.substr(p);
-	if(suffix.compare(".obj") == 0)
-	{
-		/* check if we read in an OBJ, in which
-		 * case we should write out with the same
-		 * formatting options */
-		switch(this->format)
-		{
-			/* check if already an obj */
-			case FORMAT_OBJ:
-			case FORMAT_OBJ_COLOR:
-				return this->format;
-
-			/* check if colored of another format */
-			case FORMAT_PLY_ASCII_COLOR:
-			case FORMAT_PLY_BE_COLOR:
-			case FORMAT_PLY_LE_COLOR:
-				return FORMAT_OBJ_COLOR;
-
-			/* return uncolored obj */
-			default:
-				return FORMAT_OBJ;
-		}
-	}
-	if(suffix.compare(".ply") == 0)
-	{
-		/* check if we read in a PLY file, in 
-		 * which case we should write out in the
-		 * same manner */
-		switch(this->format)
-		{
-			/* check if already a ply format */
-			case FORMAT_PLY_ASCII:
-			case FORMAT_PLY_BE:
-			case FORMAT_PLY_LE:
-			case FORMAT_PLY_ASCII_COLOR:
-			case FORMAT_PLY_BE_COLOR:
-			case FORMAT_PLY_LE_COLOR:
-				return this->format;
-
-			/* check if colored of another format */
-			case FORMAT_OBJ_COLOR:
-				return FORMAT_PLY_LE_COLOR;
-
-			/* return uncolored ply */
-			default:
-				return FORMAT_PLY_LE;
-		}
-	}
-
-	/* unknown format */
-	return FORMAT_UNKNOWN;
+	return format_for_file(filename, this->format);
 }
 
 /*----------------------------------*/
@@ -500,3 +417,358 @@ int polygon_t::serialize(std::ostream& os, FILE_FORMAT ff) const
 	return 0;
 }
 
+/*------------------------------------*/
+/* trimesh_t function implementations */
+/*------------------------------------*/
+
+int trimesh_t::read(const string& filename)
+{
+	mesh_t mesh;
+	int ret;
+
+	/* clear any existing info */
+	this->clear();
+
+	/* infer the file format from the name */
+	this->format = format_for_file(filename, FORMAT_UNKNOWN);
+
+	/* call the file-specific functions */
+	switch(this->format)
+	{
+		/* unknown */
+		default:
+		case FORMAT_UNKNOWN:
+			cerr << "[trimesh_t::read]\tUnknown file format: "
+			     << filename << endl;
+			return -1;
+
+		/* obj */
+		case FORMAT_OBJ:
+		case FORMAT_OBJ_COLOR:
+			ret = this->read_obj(filename);
+			if(ret)
+			{
+				/* report error */
+				cerr << "[trimesh_t::read]\t"
+				     << "Error " << ret 
+				     << ": Unable to parse "
+				     << "OBJ file: " << filename << endl;
+				return -2;
+			}
+			break;
+
+		/* ply */
+		case FORMAT_PLY_ASCII:
+		case FORMAT_PLY_ASCII_COLOR:
+		case FORMAT_PLY_BE:
+		case FORMAT_PLY_BE_COLOR:
+		case FORMAT_PLY_LE:
+		case FORMAT_PLY_LE_COLOR:
+			ret = this->read_ply(filename);
+			if(ret)
+			{
+				/* report error */
+				cerr << "[trimesh_t::read]\tError " << ret 
+				     << ": Unable to parse PLY file: "
+				     << filename << endl;
+				return -3;
+			}
+			break;
+	}
+
+	/* success */
+	return 0;
+}
+			
+int trimesh_t::write(const string& filename) const
+{
+	/* infer the file format from the name */
+	return this->write(filename,
+			format_for_file(filename, this->format));
+}
+			
+int trimesh_t::write(const string& filename, FILE_FORMAT f) const
+{
+	mesh_t mesh;
+	int ret;
+
+	/* call format-specific write function */
+	switch(f)
+	{
+		/* unknown */
+		default:
+		case FORMAT_UNKNOWN:
+			cerr << "[trimesh_t::write]\tUnknown file format: "
+			     << filename << endl;
+			return -1;
+
+		/* obj */
+		case FORMAT_OBJ:
+		case FORMAT_OBJ_COLOR:
+			ret = this->write_obj(filename, 
+					(f == FORMAT_OBJ_COLOR));
+			if(ret)
+			{
+				/* report error */
+				cerr << "[trimesh_t::write]\t"
+				     << "Error " << ret 
+				     << ": Unable to write "
+				     << "OBJ file: " << filename << endl;
+				return -2;
+			}
+			break;
+
+		/* binary ply */
+		case FORMAT_PLY_LE:
+		case FORMAT_PLY_LE_COLOR:
+			ret = this->write_ply(filename, f);
+			if(ret)
+			{
+				/* report error */
+				cerr << "[trimesh_t::write]\tError " << ret 
+				     << ": Unable to write PLY file: "
+				     << filename << endl;
+				return -3;
+			}
+			break;
+
+		/* other formats are written by the generic mesh */
+		case FORMAT_PLY_ASCII:
+		case FORMAT_PLY_ASCII_COLOR:
+		case FORMAT_PLY_BE:
+		case FORMAT_PLY_BE_COLOR:
+			this->get(mesh);
+			ret = mesh.write(filename, f);
+			if(ret)
+			{
+				/* report error */
+				cerr << "[trimesh_t::write]\tError " << ret 
+				     << ": Unable to write PLY file: "
+				     << filename << endl;
+				return -4;
+			}
+			break;
+	}
+
+	/* success */
+	return 0;
+}
+
+bool trimesh_t::has_color() const
+{
+	switch(this->format)
+	{
+		default:
+			return false;
+		case FORMAT_OBJ_COLOR:
+		case FORMAT_PLY_ASCII_COLOR:
+		case FORMAT_PLY_BE_COLOR:
+		case FORMAT_PLY_LE_COLOR:
+			return true;
+	}
+}
+			
+void trimesh_t::set_color(bool color)
+{
+	this->format = format_with_color(this->format, color);
+}
+
+void trimesh_t::get(mesh_t& mesh) const
+{
+	vector<vertex_t> verts;
+	vector<polygon_t> polys;
+	size_t i, n;
+
+	/* copy the vertices */
+	n = this->num_verts();
+	verts.resize(n);
+	for(i = 0; i < n; i++)
+	{
+		verts[i].set_pos(this->positions[3*i],
+				this->positions[3*i + 1],
+				this->positions[3*i + 2]);
+		verts[i].set_color(this->colors[3*i],
+				this->colors[3*i + 1],
+				this->colors[3*i + 2]);
+	}
+
+	/* copy the triangles */
+	n = this->num_tris();
+	polys.resize(n);
+	for(i = 0; i < n; i++)
+		polys[i].set(this->indices[3*i], this->indices[3*i + 1],
+				this->indices[3*i + 2]);
+
+	/* store in the mesh */
+	mesh.clear();
+	mesh.set(verts, polys);
+	mesh.set_color(this->has_color());
+}
+			
+void trimesh_t::clear()
+{
+	this->positions.clear();
+	this->colors.clear();
+	this->indices.clear();
+	this->format = FORMAT_UNKNOWN;
+}
+			
+void trimesh_t::reserve(size_t nv, size_t nt)
+{
+	this->positions.reserve(3*nv);
+	this->colors.reserve(3*nv);
+	this->indices.reserve(3*nt);
+}
+
+void trimesh_t::set(const mesh_t& mesh)
+{
+	const polygon_t* poly;
+	size_t i, j, n, num_tris;
+
+	/* clear existing info */
+	this->positions.clear();
+	this->colors.clear();
+	this->indices.clear();
+
+	/* count the triangles after splitting polygons */
+	n = mesh.num_polys();
+	num_tris = 0;
+	for(i = 0; i < n; i++)
+		if(mesh.get_poly(i).vertices.size() >= 3)
+			num_tris += mesh.get_poly(i).vertices.size() - 2;
+	this->reserve(mesh.num_verts(), num_tris);
+
+	/* copy the vertices */
+	n = mesh.num_verts();
+	for(i = 0; i < n; i++)
+		this->add_vert(mesh.get_vert(i).x, mesh.get_vert(i).y,
+				mesh.get_vert(i).z, mesh.get_vert(i).red,
+				mesh.get_vert(i).green,
+				mesh.get_vert(i).blue);
+
+	/* copy the polygons as triangle fans */
+	n = mesh.num_polys();
+	for(i = 0; i < n; i++)
+	{
+		poly = &(mesh.get_poly(i));
+		for(j = 2; j < poly->vertices.size(); j++)
+			this->add_tri(poly->vertices[0],
+					poly->vertices[j-1],
+					poly->vertices[j]);
+	}
+
+	/* use the same format */
+	this->format = mesh.has_color() ? FORMAT_PLY_LE_COLOR
+				: FORMAT_PLY_LE;
+}
+
+/*------------------*/
+/* helper functions */
+/*------------------*/
+
+static FILE_FORMAT format_for_file(const string& filename,
+                                   FILE_FORMAT current)
+{
+	size_t p;
+	string suffix;
+
+	/* get position of last dot */
+	p = filename.find_last_of('.');
+	if(p == string::npos)
+		return FORMAT_UNKNOWN;
+
+	/* determine format from suffix */
+	suffix = filename.substr(p);
+	if(suffix.compare(".obj") == 0)
+	{
+		/* check if we read in an OBJ, in which
+		 * case we should write out with the same
+		 * formatting options */
+		switch(current)
+		{
+			/* check if already an obj */
+			case FORMAT_OBJ:
+			case FORMAT_OBJ_COLOR:
+				return current;
+
+			/* check if colored of another format */
+			case FORMAT_PLY_ASCII_COLOR:
+			case FORMAT_PLY_BE_COLOR:
+			case FORMAT_PLY_LE_COLOR:
+				return FORMAT_OBJ_COLOR;
+
+			/* return uncolored obj */
+			default:
+				return FORMAT_OBJ;
+		}
+	}
+	if(suffix.compare(".ply") == 0)
+	{
+		/* check if we read in a PLY file, in 
+		 * which case we should write out in the
+		 * same manner */
+		switch(current)
+		{
+			/* check if already a ply format */
+			case FORMAT_PLY_ASCII:
+			case FORMAT_PLY_BE:
+			case FORMAT_PLY_LE:
+			case FORMAT_PLY_ASCII_COLOR:
+			case FORMAT_PLY_BE_COLOR:
+			case FORMAT_PLY_LE_COLOR:
+				return current;
+
+			/* check if colored of another format */
+			case FORMAT_OBJ_COLOR:
+				return FORMAT_PLY_LE_COLOR;
+
+			/* return uncolored ply */
+			default:
+				return FORMAT_PLY_LE;
+		}
+	}
+
+	/* unknown format */
+	return FORMAT_UNKNOWN;
+}
+
+static FILE_FORMAT format_with_color(FILE_FORMAT f, bool color)
+{
+	if(color)
+	{
+		switch(f)
+		{
+			default:
+				/* do nothing */
+				return f;
+
+			/* go from non-colored to color */
+			case FORMAT_UNKNOWN:
+			case FORMAT_OBJ:
+				return FORMAT_OBJ_COLOR;
+			case FORMAT_PLY_ASCII:
+				return FORMAT_PLY_ASCII_COLOR;
+			case FORMAT_PLY_BE:
+				return FORMAT_PLY_BE_COLOR;
+			case FORMAT_PLY_LE:
+				return FORMAT_PLY_LE_COLOR;
+		}
+	}
+	
+	switch(f)
+	{
+		default:
+			/* do nothing */
+			return f;
+
+		/* go from colored to non-colored */
+		case FORMAT_OBJ_COLOR:
+			return FORMAT_OBJ;
+		case FORMAT_PLY_ASCII_COLOR:
+			return FORMAT_PLY_ASCII;
+		case FORMAT_PLY_BE_COLOR:
+			return FORMAT_PLY_BE;
+		case FORMAT_PLY_LE_COLOR:
+			return FORMAT_PLY_LE;
+	}
+}
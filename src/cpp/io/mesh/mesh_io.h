@@ -30,6 +30,7 @@ namespace mesh_io
 	class vertex_t;
 	class polygon_t;
 	class mesh_t;
+	class trimesh_t;
 	
 	/**
 	 * This enumeration describes the supported file formats
@@ -398,6 +399,27 @@ namespace mesh_io
 			 */
 			int write(const std::string& filename, 
 			          FILE_FORMAT f) const;
+
+			/**
+			 * Writes the header of a PLY file to a stream
+			 *
+			 * This allows a PLY file to be streamed to disk
+			 * without holding the whole mesh in memory.  After
+			 * this call, the given number of vertices and then
+			 * polygons should be written with their serialize()
+			 * functions, using the same file format.
+			 *
+			 * @param os          The stream to write to
+			 * @param ff          The PLY file format to use
+			 * @param num_verts   The number of vertices
+			 * @param num_polys   The number of polygons
+			 *
+			 * @return     Returns zero on success, non-zero on
+			 *             failure.
+			 */
+			static int write_ply_header(std::ostream& os,
+					FILE_FORMAT ff, size_t num_verts,
+					size_t num_polys);
 		
 
 			/*-----------*/
@@ -654,6 +676,322 @@ namespace mesh_io
 			int write_ply(const std::string& filename,
 			              FILE_FORMAT ff) const;
 	};
+
+	/**
+	 * The trimesh_t class is a compact representation of
+	 * a triangle mesh.
+	 *
+	 * Unlike mesh_t, which stores each polygon as its own list
+	 * of indices, this class stores the positions, colors, and
+	 * vertex indices of the whole mesh in flat arrays.  Binary
+	 * PLY files are read by mapping them into memory and are
+	 * written in large blocks, and OBJ files are parsed from a
+	 * single buffer, so large meshes can be imported and
+	 * exported quickly.
+	 *
+	 * Polygons with more than three vertices are split into
+	 * triangle fans when imported.  Positions are stored in
+	 * single precision, as in binary PLY files.
+	 */
+	class trimesh_t
+	{
+		/* parameters */
+		private:
+
+			/**
+			 * The positions of the vertices
+			 *
+			 * The i'th vertex is stored at indices
+			 * [3*i, 3*i+2] as x, y, z.
+			 */
+			std::vector<float> positions;
+
+			/**
+			 * The colors of the vertices
+			 *
+			 * The i'th vertex has color stored at indices
+			 * [3*i, 3*i+2] as red, green, blue.
+			 */
+			std::vector<unsigned char> colors;
+
+			/**
+			 * The vertex indices of the triangles
+			 *
+			 * The i'th triangle references the vertices
+			 * stored at indices [3*i, 3*i+2].
+			 */
+			std::vector<unsigned int> indices;
+
+			/**
+			 * The format of this mesh
+			 *
+			 * As with mesh_t, this is set when a file is
+			 * parsed, and is used to deduce the format of
+			 * files written from this mesh.
+			 */
+			FILE_FORMAT format;
+
+		/* functions */
+		public:
+
+			/*--------------*/
+			/* constructors */
+			/*--------------*/
+
+			/**
+			 * Constructs default (empty) mesh
+			 */
+			trimesh_t()
+			{ this->format = FORMAT_UNKNOWN; };
+
+			/*-----*/
+			/* i/o */
+			/*-----*/
+
+			/**
+			 * Parses this mesh from the specified file
+			 *
+			 * The format of the file is deduced from its
+			 * name.  Little-endian binary PLY files and OBJ
+			 * files are parsed directly into this structure.
+			 * Other formats are parsed with mesh_t and
+			 * converted.
+			 *
+			 * @param filename   The file to parse
+			 *
+			 * @return   Returns zero on success,
+			 *           non-zero on failure.
+			 */
+			int read(const std::string& filename);
+
+			/**
+			 * Will export this mesh to the specified file.
+			 *
+			 * The file format will be deduced from the
+			 * file name.
+			 *
+			 * @param filename   Where to write the file
+			 *
+			 * @return     Returns zero on success, non-zero on
+			 *             failure.
+			 */
+			int write(const std::string& filename) const;
+
+			/**
+			 * Will export this mesh to the specified file.
+			 *
+			 * Little-endian binary PLY files and OBJ files
+			 * are written directly from this structure.
+			 * Other formats are converted to a mesh_t and
+			 * written by it.
+			 *
+			 * @param filename   Where to write the file
+			 * @param f          The file format to use
+			 *
+			 * @return     Returns zero on success, non-zero on
+			 *             failure.
+			 */
+			int write(const std::string& filename,
+			          FILE_FORMAT f) const;
+
+			/*-----------*/
+			/* accessors */
+			/*-----------*/
+
+			/**
+			 * Retrieves the number of vertices in this mesh
+			 *
+			 * @return   Returns number of vertices
+			 */
+			inline size_t num_verts() const
+			{ return this->positions.size() / 3; };
+
+			/**
+			 * Retrieves the position of the i'th vertex
+			 *
+			 * @param i   The index of the vertex
+			 *
+			 * @return    Returns a pointer to the x, y, z
+			 *            coordinates of the vertex
+			 */
+			inline const float* get_vert(size_t i) const
+			{ return &(this->positions[3*i]); };
+
+			/**
+			 * Retrieves the color of the i'th vertex
+			 *
+			 * @param i   The index of the vertex
+			 *
+			 * @return    Returns a pointer to the red, green,
+			 *            blue values of the vertex
+			 */
+			inline const unsigned char* get_color(size_t i) const
+			{ return &(this->colors[3*i]); };
+
+			/**
+			 * Retrieves the number of triangles in this mesh
+			 *
+			 * @return   Returns the number of triangles
+			 */
+			inline size_t num_tris() const
+			{ return this->indices.size() / 3; };
+
+			/**
+			 * Retrieves the vertex indices of the i'th triangle
+			 *
+			 * @param i   The index of the triangle
+			 *
+			 * @return    Returns a pointer to the three
+			 *            vertex indices of the triangle
+			 */
+			inline const unsigned int* get_tri(size_t i) const
+			{ return &(this->indices[3*i]); };
+
+			/**
+			 * Checks if color is defined for vertices on
+			 * this mesh.
+			 *
+			 * @return   Returns true iff vertices have color
+			 */
+			bool has_color() const;
+
+			/**
+			 * Sets color for the vertices
+			 *
+			 * Behaves the same as mesh_t::set_color().
+			 *
+			 * @param color  Whether to use color or not
+			 */
+			void set_color(bool color);
+
+			/**
+			 * Copies this mesh into the given mesh_t
+			 *
+			 * @param mesh   Where to store the mesh
+			 */
+			void get(mesh_t& mesh) const;
+
+			/*-----------*/
+			/* modifiers */
+			/*-----------*/
+
+			/**
+			 * Clears all information from this mesh
+			 */
+			void clear();
+
+			/**
+			 * Reserves space for the given number of elements
+			 *
+			 * @param nv   The number of vertices to reserve
+			 * @param nt   The number of triangles to reserve
+			 */
+			void reserve(size_t nv, size_t nt);
+
+			/**
+			 * Adds a vertex to the end of this mesh
+			 *
+			 * @param x   The x-coordinate of vertex
+			 * @param y   The y-coordinate of vertex
+			 * @param z   The z-coordinate of vertex
+			 * @param r   The red component of color
+			 * @param g   The green component of color
+			 * @param b   The blue component of color
+			 */
+			inline void add_vert(float x, float y, float z,
+			                     unsigned char r = 255,
+			                     unsigned char g = 255,
+			                     unsigned char b = 255)
+			{
+				this->positions.push_back(x);
+				this->positions.push_back(y);
+				this->positions.push_back(z);
+				this->colors.push_back(r);
+				this->colors.push_back(g);
+				this->colors.push_back(b);
+			};
+
+			/**
+			 * Adds a triangle to the end of this mesh
+			 *
+			 * @param i  The first vertex index
+			 * @param j  The second vertex index
+			 * @param k  The third vertex index
+			 */
+			inline void add_tri(unsigned int i, unsigned int j,
+			                    unsigned int k)
+			{
+				this->indices.push_back(i);
+				this->indices.push_back(j);
+				this->indices.push_back(k);
+			};
+
+			/**
+			 * Sets this mesh to a copy of the given mesh_t
+			 *
+			 * Polygons with more than three vertices are split
+			 * into triangle fans, and polygons with fewer than
+			 * three vertices are ignored.
+			 *
+			 * @param mesh   The mesh to copy
+			 */
+			void set(const mesh_t& mesh);
+
+		/* helper functions */
+		private:
+
+			/**
+			 * Reads a Wavefront OBJ file
+			 *
+			 * The whole file is read into memory with a
+			 * single call before it is parsed.
+			 *
+			 * @param filename   The file to parse
+			 *
+			 * @return   Returns zero on success, non-zero
+			 *           on failure.
+			 */
+			int read_obj(const std::string& filename);
+
+			/**
+			 * Exports a Wavefront OBJ file
+			 *
+			 * @param filename   The file to write to
+			 * @param color      If true, will write color info
+			 *
+			 * @return       Returns zero on success, non-zero
+			 *               on failure.
+			 */
+			int write_obj(const std::string& filename,
+			              bool color) const;
+
+			/**
+			 * Reads a Stanford Polygon (PLY) file
+			 *
+			 * Little-endian binary files are mapped into
+			 * memory and parsed in place.  Other files are
+			 * parsed by mesh_t.
+			 *
+			 * @param filename   The file to parse
+			 *
+			 * @return   Returns zero on success, non-zero
+			 *           on failure.
+			 */
+			int read_ply(const std::string& filename);
+
+			/**
+			 * Exports a Stanford Polygon (PLY) file
+			 *
+			 * @param filename    The file to write to
+			 * @param ff          The file format to use
+			 *                    when writing
+			 *
+			 * @return    Returns zero on success, non-zero
+			 *            on failure.
+			 */
+			int write_ply(const std::string& filename,
+			              FILE_FORMAT ff) const;
+	};
 }
 
 #endif
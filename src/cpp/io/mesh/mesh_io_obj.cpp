@@ -4,6 +4,9 @@
 #include <fstream>
 #include <string>
 #include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 /**
  * @file   mesh_io_obj.cpp
@@ -27,6 +30,10 @@ using namespace mesh_io;
 #define FACE_FLAG             "f"
 #define TEXTURE_SEP_CHARACTER "/"
 
+/* the following values are used to export files in blocks */
+#define WRITE_BUFFER_SIZE     (1 << 20) /* bytes */
+#define MAX_LINE_LENGTH       256 /* bytes */
+
 /*---------------------------------*/
 /* mesh_t function implementations */ 
 /*---------------------------------*/
@@ -226,3 +233,231 @@ int mesh_t::write_obj(const std::string& filename, bool color) const
 	outfile.close();
 	return 0;
 }
+
+/*------------------------------------*/
+/* trimesh_t function implementations */ 
+/*------------------------------------*/
+
+int trimesh_t::read_obj(const string& filename)
+{
+	ifstream infile;
+	vector<char> buf;
+	vector<unsigned int> poly;
+	char* line;
+	char* line_end;
+	char* buf_end;
+	char* p;
+	char* q;
+	double x, y, z;
+	long r, g, b, ind;
+	size_t i, len;
+
+	/* read the whole file into memory */
+	infile.open(filename.c_str(), ios_base::in | ios_base::binary);
+	if(!(infile.is_open()))
+	{
+		/* report error */
+		cerr << "[trimesh_t::read_obj]\tUnable to open file for "
+		     << "reading: " << filename << endl;
+		return -1;
+	}
+	infile.seekg(0, ios_base::end);
+	len = infile.tellg();
+	infile.seekg(0, ios_base::beg);
+	buf.resize(len + 1);
+	infile.read(&(buf[0]), len);
+	if(infile.fail())
+	{
+		cerr << "[trimesh_t::read_obj]\tUnable to read file: "
+		     << filename << endl;
+		return -2;
+	}
+	infile.close();
+	buf[len] = '\0';
+	buf_end = &(buf[0]) + len;
+
+	/* iterate through the lines of the file, terminating
+	 * each line in place so it can be parsed */
+	this->format = FORMAT_OBJ;
+	for(line = &(buf[0]); line < buf_end; line = line_end + 1)
+	{
+		/* find the end of this line */
+		line_end = (char*) memchr(line, '\n', buf_end - line);
+		if(line_end == NULL)
+			line_end = buf_end;
+		*line_end = '\0';
+
+		/* remove any comments from this line */
+		p = strchr(line, COMMENT_CHARACTER[0]);
+		if(p != NULL)
+			*p = '\0';
+
+		/* trim any whitespace in the front */
+		p = line + strspn(line, WHITESPACE);
+		if(*p == '\0')
+			continue; /* blank line */
+
+		/* determine the type of line based on the first value */
+		len = strcspn(p, WHITESPACE);
+		if(len == 1 && *p == VERTEX_FLAG[0])
+		{
+			/* this is a vertex */
+			p++;
+			x = strtod(p, &p);
+			y = strtod(p, &p);
+			z = strtod(p, &p);
+
+			/* check if there's color */
+			r = strtol(p, &q, 10);
+			if(q != p)
+			{
+				/* read in color */
+				g = strtol(q, &q, 10);
+				b = strtol(q, &q, 10);
+				this->add_vert(x, y, z, r, g, b);
+				this->format = FORMAT_OBJ_COLOR;
+			}
+			else
+				this->add_vert(x, y, z);
+		}
+		else if(len == 1 && *p == FACE_FLAG[0])
+		{
+			/* this is a face, so read in as many
+			 * indices as possible.  Any values between
+			 * a slash and the next whitespace denote
+			 * texture or normal indices, which are
+			 * skipped. */
+			poly.clear();
+			for(p++; ; p = q + strcspn(q, WHITESPACE))
+			{
+				/* get next index */
+				ind = strtol(p, &q, 10);
+				if(q == p)
+					break;
+		
+				/* check value */
+				if(ind > 0)
+				{
+					/* obj indexes from 1, not 0 */
+					poly.push_back(ind - 1);
+				}
+				else if(ind < 0)
+				{
+					/* relative indexing */
+					poly.push_back(this->num_verts()
+								+ ind);
+				}
+				else
+				{
+					/* can't handle zero */
+					cerr << "[trimesh_t::read_obj]Error! "
+					     << "triangle #"
+					     << this->num_tris()
+					     << " has vertex index 0"
+					     << endl;
+					return -3;
+				}
+			}
+
+			/* store it as a triangle fan */
+			for(i = 2; i < poly.size(); i++)
+				this->add_tri(poly[0], poly[i-1], poly[i]);
+		}
+	}
+
+	/* success */
+	return 0;
+}
+			
+int trimesh_t::write_obj(const std::string& filename, bool color) const
+{
+	ofstream outfile;
+	vector<char> buf;
+	size_t i, n, len;
+	int k;
+
+	/* attempt to open file for writing */
+	outfile.open(filename.c_str(), ios_base::out | ios_base::binary);
+	if(!(outfile.is_open()))
+	{
+		cerr << "[trimesh_t::write_obj]\tUnable to open file "
+		     << "for writing: " << filename << endl;
+		return -1;
+	}
+
+	/* OBJ files don't have a header, but write the same comments
+	 * as mesh_t at the top just to describe the file */
+	outfile << "# Mesh generated using [mesh_io] c++ package" << endl
+		<< "#" << endl
+		<< "# [mesh_io] Written by Eric Turner" << endl
+		<< "#           <elturner@eecs.berkeley.edu>" << endl
+		<< "#" << endl
+		<< "# Num vertices: " << this->num_verts() << endl
+		<< "# Num polygons: " << this->num_tris() << endl
+		<< "#" << endl;
+
+	/* format the vertices into blocks, using the same
+	 * formatting as the default for output streams */
+	buf.resize(WRITE_BUFFER_SIZE + MAX_LINE_LENGTH);
+	len = 0;
+	n = this->num_verts();
+	for(i = 0; i < n; i++)
+	{
+		/* flush the block if full */
+		if(len >= WRITE_BUFFER_SIZE)
+		{
+			outfile.write(&(buf[0]), len);
+			len = 0;
+		}
+
+		/* write this vertex */
+		if(color)
+			k = snprintf(&(buf[len]), MAX_LINE_LENGTH,
+				"v %g %g %g %d %d %d\n",
+				this->positions[3*i],
+				this->positions[3*i + 1],
+				this->positions[3*i + 2],
+				this->colors[3*i],
+				this->colors[3*i + 1],
+				this->colors[3*i + 2]);
+		else
+			k = snprintf(&(buf[len]), MAX_LINE_LENGTH,
+				"v %g %g %g\n",
+				this->positions[3*i],
+				this->positions[3*i + 1],
+				this->positions[3*i + 2]);
+		len += k;
+	}
+
+	/* format the triangles, which index from 1 */
+	n = this->num_tris();
+	for(i = 0; i < n; i++)
+	{
+		/* flush the block if full */
+		if(len >= WRITE_BUFFER_SIZE)
+		{
+			outfile.write(&(buf[0]), len);
+			len = 0;
+		}
+
+		/* write this triangle */
+		k = snprintf(&(buf[len]), MAX_LINE_LENGTH, "f %u %u %u\n",
+				this->indices[3*i] + 1,
+				this->indices[3*i + 1] + 1,
+				this->indices[3*i + 2] + 1);
+		len += k;
+	}
+	outfile.write(&(buf[0]), len);
+	
+	/* check the file */
+	if(outfile.fail())
+	{
+		cerr << "[trimesh_t::write_obj]\tUnable to write to file: "
+		     << filename << endl;
+		return -2;
+	}
+
+	/* clean up */
+	outfile.close();
+	return 0;
+}
@@ -5,6 +5,12 @@
 #include <string>
 #include <vector>
 #include <float.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
 
 /**
  * @file   mesh_io_ply.cpp
@@ -41,6 +47,13 @@ using namespace mesh_io;
 #define LIST_TYPE            "list"
 #define LIST_UCHAR_INT_TYPE  (LIST_TYPE " uchar int")
 #define LIST_INT_INT_TYPE    (LIST_TYPE " int int")
+#define LIST_UCHAR_UINT_TYPE (LIST_TYPE " uchar uint")
+
+/* the following values are used to export binary files in blocks */
+#define WRITE_BUFFER_SIZE    (1 << 20) /* bytes */
+#define NUM_XYZ              3
+#define NUM_RGB              3
+#define NUM_TRI_VERTS        3
 
 /* the following names of elements and properties are supported */
 const string vertex_names[] = {"vertex", "vert", "Vertex", "VERTEX", 
@@ -253,36 +266,35 @@ class ply_element_t
 };
 
 
-/*---------------------------------*/
-/* mesh_t function implementations */ 
-/*---------------------------------*/
-		
-int mesh_t::read_ply(const std::string& filename)
+/**
+ * Parses the header of a PLY file
+ *
+ * The given stream is left at the start of the body of the file.
+ *
+ * @param infile     The stream to parse
+ * @param elements   Where to store the elements described by the header
+ * @param format     Where to store the format of the file
+ *
+ * @return   Returns zero on success, non-zero on failure.
+ */
+int read_ply_header(istream& infile, vector<ply_element_t>& elements,
+                    FILE_FORMAT& format)
 {
-	ifstream infile;
-	vector<ply_element_t> elements;
-	vertex_t vert;
-	polygon_t face;
 	stringstream ss;
 	string tline, field;
 	bool readingheader;
-	size_t elem_idx, num_elem, vert_idx, num_vert, face_idx, num_face;
-	int ret;
-
-	/* open file for reading */
-	infile.open(filename.c_str(), ios_base::in | ios_base::binary);
-	if(!(infile.is_open()))
-	{
-		cerr << "[mesh_t::ready_ply]\tUnable to open file for "
-		     << "reading: " << filename << endl;
-		return -1;
-	}
 
 	/* parse the header */
 	readingheader = true;
 	while(readingheader)
 	{
 		/* read the next line */
+		if(infile.eof())
+		{
+			cerr << "[read_ply_header]\tReached end of file "
+			     << "before end of header" << endl;
+			return -1;
+		}
 		getline(infile, tline);
 		ss.clear();
 		ss.str(tline);
@@ -307,14 +319,14 @@ int mesh_t::read_ply(const std::string& filename)
 
 			/* check against known formats */
 			if(field.compare(FORMAT_ASCII_FLAG) == 0)
-				this->format = FORMAT_PLY_ASCII_COLOR;
+				format = FORMAT_PLY_ASCII_COLOR;
 			else if(field.compare(FORMAT_BE_FLAG) == 0)
-				this->format = FORMAT_PLY_BE_COLOR;
+				format = FORMAT_PLY_BE_COLOR;
 			else if(field.compare(FORMAT_LE_FLAG) == 0)
-				this->format = FORMAT_PLY_LE_COLOR;
+				format = FORMAT_PLY_LE_COLOR;
 			else
 			{
-				cerr << "[mesh_t::read_ply]\tUnknown PLY "
+				cerr << "[read_ply_header]\tUnknown PLY "
 				     << "format: " << field << endl;
 				return -2;
 			}
@@ -345,9 +357,9 @@ int mesh_t::read_ply(const std::string& filename)
 			/* check that element exists */
 			if(elements.empty())
 			{
-				cerr << "[mesh_t::read_ply]\tProperty flag "
+				cerr << "[read_ply_header]\tProperty flag "
 				     << "appeared before element flag in "
-				     << "header of " << filename << endl;
+				     << "header" << endl;
 				return -3;
 			}
 			
@@ -378,13 +390,105 @@ int mesh_t::read_ply(const std::string& filename)
 		else
 		{
 			/* unknown flag */
-			cerr << "[mesh_t::read_ply]\tUnable to parse "
+			cerr << "[read_ply_header]\tUnable to parse "
 			     << "line in header: \"" << tline << "\"" 
 			     << endl;
 			return -4;
 		}
 	}
 
+	/* success */
+	return 0;
+}
+
+/**
+ * Checks if the given element describes vertices that can be read
+ * directly from a binary file
+ *
+ * @param elem    The element to check
+ * @param color   Will be set to true iff the vertices have color
+ *
+ * @return   Returns true iff the vertices are stored as
+ *           float x, y, z and optionally uchar red, green, blue
+ */
+bool is_packed_vertex(const ply_element_t& elem, bool& color)
+{
+	size_t i;
+
+	/* check the number of properties */
+	if(elem.props.size() != NUM_XYZ 
+			&& elem.props.size() != NUM_XYZ + NUM_RGB)
+		return false;
+	color = (elem.props.size() == NUM_XYZ + NUM_RGB);
+
+	/* check the types */
+	for(i = 0; i < elem.props.size(); i++)
+		if(elem.props[i].type.compare(
+				(i < NUM_XYZ) ? FLOAT_TYPE : UCHAR_TYPE) != 0)
+			return false;
+
+	/* check the names */
+	return (string_in_arr(elem.props[0].name, x_names, num_x_names)
+		&& string_in_arr(elem.props[1].name, y_names, num_y_names)
+		&& string_in_arr(elem.props[2].name, z_names, num_z_names)
+		&& (!color || (string_in_arr(elem.props[3].name,
+					red_names, num_red_names)
+			&& string_in_arr(elem.props[4].name,
+					green_names, num_green_names)
+			&& string_in_arr(elem.props[5].name,
+					blue_names, num_blue_names))));
+}
+
+/**
+ * Checks if the given element describes faces that can be read
+ * directly from a binary file
+ *
+ * @param elem   The element to check
+ *
+ * @return   Returns true iff the faces are stored as a list of
+ *           ints, with the size of the list stored as a uchar
+ */
+bool is_packed_face(const ply_element_t& elem)
+{
+	return (elem.props.size() == 1
+		&& (elem.props[0].type.compare(LIST_UCHAR_INT_TYPE) == 0
+			|| elem.props[0].type.compare(
+					LIST_UCHAR_UINT_TYPE) == 0)
+		&& string_in_arr(elem.props[0].name, vertex_indices_names,
+					num_vertex_indices_names));
+}
+
+/*---------------------------------*/
+/* mesh_t function implementations */ 
+/*---------------------------------*/
+		
+int mesh_t::read_ply(const std::string& filename)
+{
+	ifstream infile;
+	vector<ply_element_t> elements;
+	vertex_t vert;
+	polygon_t face;
+	size_t elem_idx, num_elem, vert_idx, num_vert, face_idx, num_face;
+	int ret;
+
+	/* open file for reading */
+	infile.open(filename.c_str(), ios_base::in | ios_base::binary);
+	if(!(infile.is_open()))
+	{
+		cerr << "[mesh_t::ready_ply]\tUnable to open file for "
+		     << "reading: " << filename << endl;
+		return -1;
+	}
+
+	/* parse the header */
+	ret = read_ply_header(infile, elements, this->format);
+	if(ret)
+	{
+		cerr << "[mesh_t::read_ply]\tError " << ret << ": Unable to "
+		     << "parse header of " << filename << endl;
+		return -2;
+	}
+
 	/* iterate over the elements in this file */
 	num_elem = elements.size();
 	for(elem_idx = 0; elem_idx < num_elem; elem_idx++)
@@ -518,39 +622,88 @@ int mesh_t::write_ply(const std::string& filename, FILE_FORMAT ff) const
 		return -2;
 	}
 
+	/* write the header */
+	ret = mesh_t::write_ply_header(outfile, ff, this->vertices.size(),
+					this->polygons.size());
+	if(ret)
+	{
+		/* report error */
+		cerr << "[mesh_t::write_ply]\tError " << ret << ": "
+		     << "Unable to write header" << endl;
+		return -3;
+	}
+
+	/* write out vertices */
+	n = this->vertices.size();
+	for(i = 0; i < n; i++)
+	{
+		/* export this vertex */
+		ret = this->vertices[i].serialize(outfile, ff);
+		if(ret)
+		{
+			/* report error */
+			cerr << "[mesh_t::write_ply]\tError " << ret << ": "
+			     << "Unable to write vertex #" << i << endl;
+			return -4;
+		}
+	}
+
+	/* write out faces */
+	n = this->polygons.size();
+	for(i = 0; i < n; i++)
+	{
+		/* export this polygon */
+		ret = this->polygons[i].serialize(outfile, ff);
+		if(ret)
+		{
+			/* report error */
+			cerr << "[mesh_t::write_ply]\tError " << ret << ": "
+			     << "Unable to write polygon #" << i << endl;
+			return -5;
+		}
+	}
+
+	/* clean up */
+	outfile.close();
+	return 0;
+}
+
+int mesh_t::write_ply_header(std::ostream& os, FILE_FORMAT ff,
+                             size_t num_verts, size_t num_polys)
+{
 	/* magic number */
-	outfile << MAGIC_NUMBER << endl;
+	os << MAGIC_NUMBER << endl;
 
 	/* specify format */
 	switch(ff)
 	{
 		default:
-			cerr << "[mesh_t::write_ply]\tNot valid PLY file "
-			     << "format: " << ff << endl;
-			return -3;
+			cerr << "[mesh_t::write_ply_header]\tNot valid PLY "
+			     << "file format: " << ff << endl;
+			return -1;
 		case FORMAT_PLY_ASCII:
 		case FORMAT_PLY_ASCII_COLOR:
-			outfile << FORMAT_FLAG       << " "
+			os << FORMAT_FLAG       << " "
 				<< FORMAT_ASCII_FLAG << " "
 				<< SUPPORTED_VERSION << endl;
 			break;
 		case FORMAT_PLY_BE:
 		case FORMAT_PLY_BE_COLOR:
-			outfile << FORMAT_FLAG       << " "
+			os << FORMAT_FLAG       << " "
 				<< FORMAT_BE_FLAG    << " "
 				<< SUPPORTED_VERSION << endl;
 			break;
 		case FORMAT_PLY_LE:
 		case FORMAT_PLY_LE_COLOR:
-			outfile << FORMAT_FLAG       << " "
+			os << FORMAT_FLAG       << " "
 				<< FORMAT_LE_FLAG    << " "
 				<< SUPPORTED_VERSION << endl;
 			break;
 	}
 
 	/* specify vertex format */
-	outfile << ELEMENT_FLAG    << " "
-		<< vertex_names[0] << " " << this->vertices.size() << endl
+	os << ELEMENT_FLAG    << " "
+		<< vertex_names[0] << " " << num_verts << endl
 	        << PROPERTY_FLAG   << " "
 		<< FLOAT_TYPE     << " "
 		<< x_names[0]      << endl
@@ -567,7 +720,7 @@ int mesh_t::write_ply(const std::string& filename, FILE_FORMAT ff) const
 		case FORMAT_PLY_ASCII_COLOR:
 		case FORMAT_PLY_BE_COLOR:
 		case FORMAT_PLY_LE_COLOR:
-			outfile << PROPERTY_FLAG   << " "
+			os << PROPERTY_FLAG   << " "
 				<< UCHAR_TYPE        << " " 
 				<< red_names[0]    << endl
 			        << PROPERTY_FLAG   << " "
@@ -583,44 +736,313 @@ int mesh_t::write_ply(const std::string& filename, FILE_FORMAT ff) const
 	}
 
 	/* specify faces */
-	outfile << ELEMENT_FLAG            << " "
+	os << ELEMENT_FLAG            << " "
 	        << face_names[0]           << " " 
-		<< this->polygons.size()   << endl
+		<< num_polys               << endl
 	        << PROPERTY_FLAG           << " "
 		<< LIST_UCHAR_INT_TYPE     << " "
 		<< vertex_indices_names[0] << endl;
 
 	/* end header information */
-	outfile << END_HEADER_FLAG << endl;
+	os << END_HEADER_FLAG << endl;
 
-	/* write out vertices */
-	n = this->vertices.size();
-	for(i = 0; i < n; i++)
+	/* check the stream */
+	if(os.fail())
+		return -2;
+	return 0;
+}
+
+/*------------------------------------*/
+/* trimesh_t function implementations */ 
+/*------------------------------------*/
+
+int trimesh_t::read_ply(const std::string& filename)
+{
+	ifstream infile;
+	vector<ply_element_t> elements;
+	mesh_t mesh;
+	struct stat st;
+	const char* data;
+	void* addr;
+	size_t elem_idx, num_elem, i, j, n, num_verts, data_size, loc, stride;
+	unsigned int first, prev, curr;
+	unsigned char num;
+	FILE_FORMAT format;
+	bool color, packed;
+	int fd, ret;
+
+	/* open file and parse the header */
+	infile.open(filename.c_str(), ios_base::in | ios_base::binary);
+	if(!(infile.is_open()))
 	{
-		/* export this vertex */
-		ret = this->vertices[i].serialize(outfile, ff);
+		cerr << "[trimesh_t::read_ply]\tUnable to open file for "
+		     << "reading: " << filename << endl;
+		return -1;
+	}
+	format = this->format;
+	ret = read_ply_header(infile, elements, format);
+	if(ret)
+	{
+		cerr << "[trimesh_t::read_ply]\tError " << ret << ": Unable "
+		     << "to parse header of " << filename << endl;
+		return -2;
+	}
+	loc = infile.tellg();
+	infile.close();
+	this->format = format;
+
+	/* check if the body can be read directly, which requires
+	 * a little-endian file of packed vertices and faces */
+	packed = (this->format == FORMAT_PLY_LE_COLOR);
+	color = true;
+	num_elem = elements.size();
+	for(elem_idx = 0; packed && elem_idx < num_elem; elem_idx++)
+	{
+		if(string_in_arr(elements[elem_idx].name, vertex_names,
+					num_vertex_names))
+			packed = is_packed_vertex(elements[elem_idx], color);
+		else if(string_in_arr(elements[elem_idx].name, face_names,
+					num_face_names))
+			packed = is_packed_face(elements[elem_idx]);
+		else
+			packed = false;
+	}
+	if(!packed)
+	{
+		/* use the generic parser */
+		ret = mesh.read(filename);
 		if(ret)
 		{
-			/* report error */
-			cerr << "[mesh_t::write_ply]\tError " << ret << ": "
-			     << "Unable to write vertex #" << i << endl;
-			return -4;
+			cerr << "[trimesh_t::read_ply]\tError " << ret 
+			     << ": Unable to parse file: " << filename
+			     << endl;
+			return -3;
 		}
+		this->set(mesh);
+		this->format = format;
+		return 0;
 	}
+	if(!color)
+		this->format = FORMAT_PLY_LE;
 
-	/* write out faces */
-	n = this->polygons.size();
+	/* map the file into memory */
+	fd = ::open(filename.c_str(), O_RDONLY);
+	if(fd < 0 || fstat(fd, &st) != 0)
+	{
+		cerr << "[trimesh_t::read_ply]\tUnable to open file: "
+		     << filename << endl;
+		if(fd >= 0)
+			::close(fd);
+		return -4;
+	}
+	data_size = st.st_size;
+	addr = (data_size == 0) ? MAP_FAILED
+		: mmap(NULL, data_size, PROT_READ, MAP_SHARED, fd, 0);
+	::close(fd);
+	if(addr == MAP_FAILED)
+	{
+		cerr << "[trimesh_t::read_ply]\tUnable to map file into "
+		     << "memory: " << filename << endl;
+		return -5;
+	}
+	data = (const char*) addr;
+	madvise(addr, data_size, MADV_SEQUENTIAL);
+
+	/* parse the body of the file in place */
+	ret = 0;
+	num_verts = 0;
+	for(elem_idx = 0; !ret && elem_idx < num_elem; elem_idx++)
+	{
+		n = elements[elem_idx].num_elements;
+		if(string_in_arr(elements[elem_idx].name, vertex_names,
+					num_vertex_names))
+		{
+			/* check that all vertices are in the file */
+			is_packed_vertex(elements[elem_idx], color);
+			stride = NUM_XYZ*sizeof(float)
+				+ (color ? NUM_RGB : 0);
+			if(loc + n*stride > data_size)
+			{
+				cerr << "[trimesh_t::read_ply]\tFile ends "
+				     << "before vertex #" << n << endl;
+				ret = -6;
+				break;
+			}
+
+			/* copy the vertices */
+			num_verts += n;
+			this->positions.resize(NUM_XYZ*num_verts);
+			this->colors.resize(NUM_RGB*num_verts, 255);
+			for(i = num_verts - n; i < num_verts; i++)
+			{
+				memcpy(&(this->positions[NUM_XYZ*i]),
+					data + loc, NUM_XYZ*sizeof(float));
+				if(color)
+					memcpy(&(this->colors[NUM_RGB*i]),
+						data + loc
+						+ NUM_XYZ*sizeof(float),
+						NUM_RGB);
+				loc += stride;
+			}
+		}
+		else
+		{
+			/* copy the faces, splitting any polygons
+			 * with more than three vertices into fans */
+			this->indices.reserve(this->indices.size()
+						+ NUM_TRI_VERTS*n);
+			for(i = 0; i < n; i++)
+			{
+				/* get size of face */
+				if(loc + sizeof(num) > data_size)
+				{
+					ret = -7;
+					break;
+				}
+				num = (unsigned char) data[loc];
+				loc += sizeof(num);
+				if(loc + num*sizeof(int) > data_size)
+				{
+					ret = -7;
+					break;
+				}
+
+				/* copy triangles directly */
+				if(num == NUM_TRI_VERTS)
+				{
+					j = this->indices.size();
+					this->indices.resize(
+						j + NUM_TRI_VERTS);
+					memcpy(&(this->indices[j]),
+						data + loc,
+						NUM_TRI_VERTS*sizeof(int));
+					loc += NUM_TRI_VERTS*sizeof(int);
+					continue;
+				}
+				
+				/* split other polygons */
+				first = prev = 0;
+				for(j = 0; j < num; j++)
+				{
+					memcpy(&curr, data + loc, 
+							sizeof(int));
+					loc += sizeof(int);
+					if(j == 0)
+						first = curr;
+					else if(j >= 2)
+						this->add_tri(first,
+							prev, curr);
+					prev = curr;
+				}
+			}
+			if(ret)
+				cerr << "[trimesh_t::read_ply]\tFile ends "
+				     << "before face #" << i << endl;
+		}
+	}
+
+	/* clean up */
+	munmap(addr, data_size);
+	if(ret)
+	{
+		this->clear();
+		return ret;
+	}
+	return 0;
+}
+	
+int trimesh_t::write_ply(const std::string& filename, FILE_FORMAT ff) const
+{
+	ofstream outfile;
+	vector<char> buf;
+	size_t i, n, len, stride;
+	unsigned char num;
+	bool color;
+	int ret;
+
+	/* only binary little-endian files are written directly */
+	switch(ff)
+	{
+		default:
+			cerr << "[trimesh_t::write_ply]\tNot valid binary PLY "
+			     << "file format: " << ff << endl;
+			return -1;
+		case FORMAT_PLY_LE:
+			color = false;
+			break;
+		case FORMAT_PLY_LE_COLOR:
+			color = true;
+			break;
+	}
+
+	/* open the file and write the header */
+	outfile.open(filename.c_str(), ios_base::out | ios_base::binary);
+	if(!(outfile.is_open()))
+	{
+		cerr << "[trimesh_t::write_ply]\tUnable to open file for "
+		     << "writing: " << filename << endl;
+		return -2;
+	}
+	ret = mesh_t::write_ply_header(outfile, ff, this->num_verts(),
+					this->num_tris());
+	if(ret)
+	{
+		cerr << "[trimesh_t::write_ply]\tError " << ret << ": "
+		     << "Unable to write header" << endl;
+		return -3;
+	}
+
+	/* pack the vertices into blocks */
+	buf.resize(WRITE_BUFFER_SIZE);
+	stride = NUM_XYZ*sizeof(float) + (color ? NUM_RGB : 0);
+	n = this->num_verts();
+	len = 0;
 	for(i = 0; i < n; i++)
 	{
-		/* export this polygon */
-		ret = this->polygons[i].serialize(outfile, ff);
-		if(ret)
+		/* flush the block if full */
+		if(len + stride > buf.size())
 		{
-			/* report error */
-			cerr << "[mesh_t::write_ply]\tError " << ret << ": "
-			     << "Unable to write polygon #" << i << endl;
-			return -5;
+			outfile.write(&(buf[0]), len);
+			len = 0;
 		}
+
+		/* add the vertex */
+		memcpy(&(buf[len]), &(this->positions[NUM_XYZ*i]),
+				NUM_XYZ*sizeof(float));
+		if(color)
+			memcpy(&(buf[len + NUM_XYZ*sizeof(float)]),
+				&(this->colors[NUM_RGB*i]), NUM_RGB);
+		len += stride;
+	}
+
+	/* pack the triangles into blocks */
+	num = NUM_TRI_VERTS;
+	stride = sizeof(num) + NUM_TRI_VERTS*sizeof(int);
+	n = this->num_tris();
+	for(i = 0; i < n; i++)
+	{
+		/* flush the block if full */
+		if(len + stride > buf.size())
+		{
+			outfile.write(&(buf[0]), len);
+			len = 0;
+		}
+
+		/* add the triangle */
+		buf[len] = (char) num;
+		memcpy(&(buf[len + sizeof(num)]),
+				&(this->indices[NUM_TRI_VERTS*i]),
+				NUM_TRI_VERTS*sizeof(int));
+		len += stride;
+	}
+	outfile.write(&(buf[0]), len);
+
+	/* check the file */
+	if(outfile.fail())
+	{
+		cerr << "[trimesh_t::write_ply]\tUnable to write to file: "
+		     << filename << endl;
+		return -4;
 	}
 
 	/* clean up */
@@ -6,10 +6,12 @@
 #include <geometry/octree/octtopo.h>
 #include <mesh/partition/node_partitioner.h>
 #include <mesh/surface/node_boundary.h>
+#include <mesh/surface/node_boundary_stream.h>
 #include <mesh/surface/planar_region_graph.h>
 #include <mesh/surface/node_corner.h>
 #include <mesh/surface/node_corner_map.h>
 #include <mesh/surface/face_mesher.h>
+#include <mesh/surface/tiled_face_mesher.h>
 #include <mesh/surface/region_mesher.h>
 #include <util/error_codes.h>
 #include <util/tictoc.h>
@@ -37,6 +39,12 @@
 using namespace std;
 using namespace Eigen;
 
+/* the following suffixes are appended to output files to name the
+ * spill files used when streaming boundary faces */
+#define OBJECT_SPILL_SUFFIX   ".objects.faces"
+#define ROOM_SPILL_SUFFIX     ".room.faces"
+#define BOUNDARY_SPILL_SUFFIX ".faces"
+
 /*--------------------------*/
 /* function implementations */
 /*--------------------------*/
@@ -48,6 +56,8 @@ int tree_exporter::export_all(const std::string& filename,
 	octtopo::octtopo_t top;
 	node_boundary_t object_boundary;
 	node_boundary_t room_boundary;
+	node_boundary_stream_t object_stream;
+	node_boundary_stream_t room_stream;
 	node_corner::corner_map_t corner_map;
 	planar_region_graph_t region_graph;
 	face_mesher_t face_mesher;
@@ -70,16 +80,28 @@ int tree_exporter::export_all(const std::string& filename,
 		return PROPEGATE_ERROR(-2, ret);
 	toc(clk, "Initializing topology");
 
-	/* extract the object boundary nodes */
-	ret = object_boundary.populate(top, node_boundary_t::SEG_OBJECTS);
+	/* extract the object boundary nodes, writing them to a spill
+	 * file if a spill buffer is given */
+	if(region_mesher.get_boundary_spill_buffer() > 0)
+		ret = object_stream.populate(top,
+				filename + OBJECT_SPILL_SUFFIX,
+				region_mesher.get_boundary_spill_buffer(),
+				node_boundary_t::SEG_OBJECTS);
+	else
+		ret = object_boundary.populate(top,
+				node_boundary_t::SEG_OBJECTS);
 	if(ret)
 		return PROPEGATE_ERROR(-3, ret);
 
 	/* generate dense mesh from this geometry */
 	tic(clk);
-	ret = face_mesher.add(tree, object_boundary);
+	if(region_mesher.get_boundary_spill_buffer() > 0)
+		ret = face_mesher.add(tree, object_stream);
+	else
+		ret = face_mesher.add(tree, object_boundary);
 	if(ret)
 		return PROPEGATE_ERROR(-4, ret);
+	object_stream.clear();
 	toc(clk, "Generating dense mesh");
 
 	/* remove outliers from topology */
@@ -88,16 +110,30 @@ int tree_exporter::export_all(const std::string& filename,
 		return PROPEGATE_ERROR(-5, ret);
 
 	/* extract the boundary nodes using the generated topology */
-	ret = room_boundary.populate(top, node_boundary_t::SEG_ROOM);
+	if(region_mesher.get_boundary_spill_buffer() > 0)
+		ret = room_stream.populate(top,
+				filename + ROOM_SPILL_SUFFIX,
+				region_mesher.get_boundary_spill_buffer(),
+				node_boundary_t::SEG_ROOM);
+	else
+		ret = room_boundary.populate(top,
+				node_boundary_t::SEG_ROOM);
 	if(ret)
 		return PROPEGATE_ERROR(-6, ret);
 
 	/* extract the corners of the model from this boundary */
 	tic(clk);
-	corner_map.add(tree, room_boundary);
+	if(region_mesher.get_boundary_spill_buffer() > 0)
+	{
+		ret = corner_map.add(tree, room_stream);
+		if(ret)
+			return PROPEGATE_ERROR(-7, ret);
+	}
+	else
+		corner_map.add(tree, room_boundary);
 	ret = corner_map.populate_edges(tree);
 	if(ret)
-		return PROPEGATE_ERROR(-7, ret);
+		return PROPEGATE_ERROR(-8, ret);
 	toc(clk, "Computing corners");
 
 	/* form planar regions from these boundary faces */
@@ -106,30 +142,36 @@ int tree_exporter::export_all(const std::string& filename,
 			region_mesher.get_coalesce_distthresh(), 
 			region_mesher.get_use_isosurface_pos(), 
 			planar_region_graph_t::COALESCE_WITH_L2_NORM); 
-	ret = region_graph.populate(room_boundary);
+	region_graph.init_sharding(
+			region_mesher.get_coalesce_shard_size());
+	if(region_mesher.get_boundary_spill_buffer() > 0)
+		ret = region_graph.populate(room_stream);
+	else
+		ret = region_graph.populate(room_boundary);
 	if(ret)
-		return PROPEGATE_ERROR(-8, ret);
+		return PROPEGATE_ERROR(-9, ret);
+	room_stream.clear();
 	toc(clk, "Forming regions");
 
 	/* coalesce regions */
 	tic(clk);
 	ret = region_graph.coalesce_regions();
 	if(ret)
-		return PROPEGATE_ERROR(-9, ret);
+		return PROPEGATE_ERROR(-10, ret);
 	toc(clk, "Coalescing regions");
 
 	/* mesh the region graph */
 	tic(clk);
 	ret = region_mesher.init(tree, region_graph, corner_map);
 	if(ret)
-		return PROPEGATE_ERROR(-10, ret);
+		return PROPEGATE_ERROR(-11, ret);
 	toc(clk, "Meshing regions");
 	
 	/* generate the topologically watertight mesh */
 	tic(clk);
 	ret = region_mesher.compute_mesh(mesh, tree);
 	if(ret)
-		return PROPEGATE_ERROR(-11, ret);
+		return PROPEGATE_ERROR(-12, ret);
 	mesh.add(face_mesher.get_mesh());
 	toc(clk, "Generating planar mesh");
 
@@ -137,7 +179,7 @@ int tree_exporter::export_all(const std::string& filename,
 	tic(clk);
 	ret = mesh.write(filename);	
 	if(ret)
-		return PROPEGATE_ERROR(-12, ret);
+		return PROPEGATE_ERROR(-13, ret);
 	toc(clk, "Writing full mesh");
 
 	/* success */
@@ -146,14 +188,21 @@ int tree_exporter::export_all(const std::string& filename,
 
 int tree_exporter::export_dense_mesh(const std::string& filename,
                                      const octree_t& tree,
-                                     node_boundary_t::SEG_SCHEME scheme)
+                                     node_boundary_t::SEG_SCHEME scheme,
+                                     const std::string& xml_settings)
 {
 	octtopo::octtopo_t top;
 	node_boundary_t boundary;
 	face_mesher_t mesher;
+	tiled_face_mesher_t tiled_mesher;
 	tictoc_t clk;
 	int ret;
 
+	/* import settings */
+	ret = tiled_mesher.import(xml_settings);
+	if(ret)
+		return PROPEGATE_ERROR(-5, ret);
+
 	/* initialize the octree topology */
 	tic(clk);
 	ret = top.init(tree);
@@ -161,6 +210,17 @@ int tree_exporter::export_dense_mesh(const std::string& filename,
 		return PROPEGATE_ERROR(-1, ret);
 	toc(clk, "Initializing topology");
 
+	/* if tiling, mesh and export one tile at a time */
+	if(tiled_mesher.get_tile_size() > 0)
+	{
+		tic(clk);
+		ret = tiled_mesher.write(filename, tree, top, scheme);
+		if(ret)
+			return PROPEGATE_ERROR(-6, ret);
+		toc(clk, "Exporting tiled mesh");
+		return 0;
+	}
+
 	/* extract the boundary nodes using the generated topology */
 	ret = boundary.populate(top, scheme);
 	if(ret)
@@ -191,6 +251,7 @@ int tree_exporter::export_planar_mesh(const std::string& filename,
 {
 	octtopo::octtopo_t top;
 	node_boundary_t boundary;
+	node_boundary_stream_t stream;
 	node_corner::corner_map_t corner_map;
 	planar_region_graph_t region_graph;
 	region_mesher::mesher_t mesher;
@@ -217,17 +278,30 @@ int tree_exporter::export_planar_mesh(const std::string& filename,
 	if(ret)
 		return PROPEGATE_ERROR(-3, ret);
 
-	/* extract the boundary nodes using the generated topology */
-	ret = boundary.populate(top, scheme);
+	/* extract the boundary nodes using the generated topology,
+	 * writing them to a spill file if a spill buffer is given */
+	if(mesher.get_boundary_spill_buffer() > 0)
+		ret = stream.populate(top, filename + BOUNDARY_SPILL_SUFFIX,
+				mesher.get_boundary_spill_buffer(),
+				scheme);
+	else
+		ret = boundary.populate(top, scheme);
 	if(ret)
 		return PROPEGATE_ERROR(-4, ret);
 
 	/* extract the corners of the model from this boundary */
 	tic(clk);
-	corner_map.add(tree, boundary);
+	if(mesher.get_boundary_spill_buffer() > 0)
+	{
+		ret = corner_map.add(tree, stream);
+		if(ret)
+			return PROPEGATE_ERROR(-5, ret);
+	}
+	else
+		corner_map.add(tree, boundary);
 	ret = corner_map.populate_edges(tree);
 	if(ret)
-		return PROPEGATE_ERROR(-5, ret);
+		return PROPEGATE_ERROR(-6, ret);
 	toc(clk, "Computing corners");
 
 	/* form planar regions from these boundary faces */
@@ -236,37 +310,43 @@ int tree_exporter::export_planar_mesh(const std::string& filename,
 			mesher.get_coalesce_distthresh(), 
 			mesher.get_use_isosurface_pos(), 
 			planar_region_graph_t::COALESCE_WITH_L2_NORM); 
-	ret = region_graph.populate(boundary);
+	region_graph.init_sharding(
+			mesher.get_coalesce_shard_size());
+	if(mesher.get_boundary_spill_buffer() > 0)
+		ret = region_graph.populate(stream);
+	else
+		ret = region_graph.populate(boundary);
 	if(ret)
-		return PROPEGATE_ERROR(-6, ret);
+		return PROPEGATE_ERROR(-7, ret);
+	stream.clear();
 	toc(clk, "Forming regions");
 
 	/* coalesce regions (use arbitrary parameters) */
 	tic(clk);
 	ret = region_graph.coalesce_regions();
 	if(ret)
-		return PROPEGATE_ERROR(-7, ret);
+		return PROPEGATE_ERROR(-8, ret);
 	toc(clk, "Coalescing regions");
 
 	/* mesh the region graph */
 	tic(clk);
 	ret = mesher.init(tree, region_graph, corner_map);
 	if(ret)
-		return PROPEGATE_ERROR(-8, ret);
+		return PROPEGATE_ERROR(-9, ret);
 	toc(clk, "Meshing regions");
 	
 	/* generate the topologically watertight mesh */
 	tic(clk);
 	ret = mesher.compute_mesh(mesh, tree);
 	if(ret)
-		return PROPEGATE_ERROR(-9, ret);
+		return PROPEGATE_ERROR(-10, ret);
 	toc(clk, "Generating mesh");
 
 	/* export the mesh to disk */
 	tic(clk);
 	ret = mesh.write(filename);	
 	if(ret)
-		return PROPEGATE_ERROR(-10, ret);
+		return PROPEGATE_ERROR(-11, ret);
 	toc(clk, "Writing mesh");
 
 	/* success */
@@ -367,6 +447,7 @@ int tree_exporter::export_regions(const std::string& filename,
 {
 	octtopo::octtopo_t top;
 	node_boundary_t boundary;
+	node_boundary_stream_t stream;
 	node_corner::corner_map_t corner_map;
 	planar_region_graph_t region_graph;
 	region_mesher::mesher_t mesher;
@@ -387,17 +468,30 @@ int tree_exporter::export_regions(const std::string& filename,
 		return PROPEGATE_ERROR(-2, ret);
 	toc(clk, "Initializing topology");
 
-	/* extract the boundary nodes using the generated topology */
-	ret = boundary.populate(top, scheme);
+	/* extract the boundary nodes using the generated topology,
+	 * writing them to a spill file if a spill buffer is given */
+	if(mesher.get_boundary_spill_buffer() > 0)
+		ret = stream.populate(top, filename + BOUNDARY_SPILL_SUFFIX,
+				mesher.get_boundary_spill_buffer(),
+				scheme);
+	else
+		ret = boundary.populate(top, scheme);
 	if(ret)
 		return PROPEGATE_ERROR(-3, ret);
 
 	/* extract the corners of the model from this boundary */
 	tic(clk);
-	corner_map.add(tree, boundary);
+	if(mesher.get_boundary_spill_buffer() > 0)
+	{
+		ret = corner_map.add(tree, stream);
+		if(ret)
+			return PROPEGATE_ERROR(-4, ret);
+	}
+	else
+		corner_map.add(tree, boundary);
 	ret = corner_map.populate_edges(tree);
 	if(ret)
-		return PROPEGATE_ERROR(-4, ret);
+		return PROPEGATE_ERROR(-5, ret);
 	toc(clk, "Computing corners");
 
 	/* form planar regions from these boundary faces */
@@ -406,23 +500,29 @@ int tree_exporter::export_regions(const std::string& filename,
 			mesher.get_coalesce_distthresh(), 
 			mesher.get_use_isosurface_pos(), 
 			planar_region_graph_t::COALESCE_WITH_L2_NORM); 
-	ret = region_graph.populate(boundary);
+	region_graph.init_sharding(
+			mesher.get_coalesce_shard_size());
+	if(mesher.get_boundary_spill_buffer() > 0)
+		ret = region_graph.populate(stream);
+	else
+		ret = region_graph.populate(boundary);
 	if(ret)
-		return PROPEGATE_ERROR(-5, ret);
+		return PROPEGATE_ERROR(-6, ret);
+	stream.clear();
 	toc(clk, "Forming regions");
 
 	/* coalesce regions (use arbitrary parameters) */
 	tic(clk);
 	ret = region_graph.coalesce_regions();
 	if(ret)
-		return PROPEGATE_ERROR(-6, ret);
+		return PROPEGATE_ERROR(-7, ret);
 	toc(clk, "Coalescing regions");
 
 	/* export regions to file */
 	tic(clk);
 	ret = region_graph.writeobj(filename, false);
 	if(ret)
-		return PROPEGATE_ERROR(-7, ret);
+		return PROPEGATE_ERROR(-8, ret);
 	toc(clk, "Writing OBJ");
 
 	/* success */
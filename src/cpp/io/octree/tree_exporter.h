@@ -48,16 +48,23 @@ namespace tree_exporter
 	 * mesh is based off a variant of dual contouring, and gives
 	 * a fairly smooth and organic appearance.
 	 *
+	 * If the settings specify a tile size, then the domain
+	 * of the tree is split into tiles that are meshed in parallel
+	 * and streamed to disk, so that the whole mesh is never held
+	 * in memory.  In this case, the output must be a .ply file.
+	 *
 	 * @param filename   The path to the .obj/.ply file to write
 	 * @param tree       The tree to export
 	 * @param scheme      Specifies whether to export the whole scene,
 	 *                    just the objects, or just the rooms
+	 * @param xml_settings The settings file to import
 	 *
 	 * @return           Returns zero on success, non-zero on failure.
 	 */
 	int export_dense_mesh(const std::string& filename,
 	                      const octree_t& tree,
-	                      node_boundary_t::SEG_SCHEME scheme);
+	                      node_boundary_t::SEG_SCHEME scheme,
+                              const std::string& xml_settings);
 
 	/**
 	 * Exports a planar mesh of the octree to the specified file
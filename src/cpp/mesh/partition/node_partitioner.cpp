@@ -6,10 +6,12 @@
 #include <util/union_find.h>
 #include <util/tictoc.h>
 #include <Eigen/Dense>
+#include <boost/threadpool.hpp>
+#include <boost/bind.hpp>
+#include <algorithm>
 #include <sstream>
 #include <string>
 #include <vector>
-#include <map>
 
 /**
  * @file   node_partitioner.cpp
@@ -24,7 +26,9 @@
  * building features.
  *
  * Objects in the environment will be divided based on connectivity, in
- * attempt to separate each object from the others.
+ * attempt to separate each object from the others.  The edges of the
+ * topology are processed in parallel chunks with a concurrent
+ * union-find structure.
  *
  * Created July 8th, 2014
  */
@@ -33,73 +37,96 @@ using namespace std;
 using namespace Eigen;
 using namespace octtopo;
 
+/* the number of topology nodes whose edges are processed by each
+ * task, and the number of partitions populated by each task */
+#define NODES_PER_TASK      16384
+#define PARTITIONS_PER_TASK 64
+
 /*--------------------------*/
 /* function implementations */
 /*--------------------------*/
 
-int node_partitioner_t::partition(const octtopo_t& topo)
+int node_partitioner_t::partition(const octtopo_t& topo,
+                                  unsigned int num_threads)
 {
-	map<octnode_t*, octneighbors_t>::const_iterator it;
-	map<octnode_t*, size_t> indices;
-	vector<octnode_t*> rev_indices;
-	union_find_t us;
-	vector<octnode_t*> neighs;
-	vector<vector<size_t> > final_unions;
-	size_t fi, i, j, num_nodes, myind, num_unions;
-	int ret;
+	concurrent_union_find_t us;
+	vector<vector<size_t> > final_unions, sorted_unions;
+	vector<octnode_t*> roots;
+	vector<pair<octnode_t*, size_t> > order;
+	vector<int> rets;
+	size_t i, k, n, num_tasks;
 
-	/* index the nodes of the octree referenced in the topology */
-	for(it = topo.begin(); it != topo.end(); it++)
-		if((indices.insert(pair<octnode_t*, size_t>(it->first,
-						indices.size()))).second)
-			rev_indices.push_back(it->first); /* newly added */
+	/* determine how many threads to use */
+	if(num_threads == 0)
+		num_threads = boost::thread::hardware_concurrency();
+	if(num_threads == 0)
+		num_threads = 1;
 
-	/* populate the union-find structure with edges */
-	us.init(indices.size());
-	for(it = topo.begin(); it != topo.end(); it++)
+	/* the nodes of the topology are already densely indexed,
+	 * so add the edges of each chunk of nodes in parallel */
+	n = topo.size();
+	us.init(n);
+	num_tasks = (n + NODES_PER_TASK - 1) / NODES_PER_TASK;
+	rets.resize(num_tasks, 0);
 	{
-		/* iterate over faces of current node,
-		 * getting all neighbors */
-		neighs.clear();
-		for(fi = 0; fi < NUM_FACES_PER_CUBE; fi++)
-			it->second.get(all_cube_faces[fi], neighs);
-	
-		/* iterate over neighbors, adding each edge to the
-		 * union-find structure */
-		myind = indices[it->first];
-		num_nodes = neighs.size();
-		for(i = 0; i < num_nodes; i++)
+		/* the pool waits for all tasks when it goes out
+		 * of scope */
+		boost::threadpool::pool tp(num_threads);
+		for(k = 0; k < num_tasks; k++)
+			tp.schedule(boost::bind(
+				&node_partitioner_t::add_edges, &topo, &us,
+				k*NODES_PER_TASK,
+				min(n, (k+1)*NODES_PER_TASK),
+				&(rets[k])));
+	}
+	for(k = 0; k < num_tasks; k++)
+		if(rets[k])
+			return PROPEGATE_ERROR(-1, rets[k]);
+
+	/* find the root that the original serial union-find gives
+	 * each union, in parallel chunks */
+	us.get_unions(final_unions);
+	n = final_unions.size();
+	roots.resize(n);
+	num_tasks = (n + PARTITIONS_PER_TASK - 1) / PARTITIONS_PER_TASK;
+	{
+		boost::threadpool::pool tp(num_threads);
+		for(k = 0; k < num_tasks; k++)
 		{
-			/* only counts as an edge if both are labeled
-			 * the same */
-			if(it->first->data->is_interior() 
-					!= neighs[i]->data->is_interior())
-				continue;
-			if(it->first->data->get_fp_room()
-					!= neighs[i]->data->get_fp_room())
-				continue;
-
-			/* add this edge to graph */
-			ret = us.add_edge(myind, indices[neighs[i]]);
-			if(ret)
-				return PROPEGATE_ERROR(-1, ret);
+			i = k*PARTITIONS_PER_TASK;
+			tp.schedule(boost::bind(
+				&node_partitioner_t::find_roots,
+				&topo, &final_unions, &roots, i,
+				min(n, i + PARTITIONS_PER_TASK)));
 		}
 	}
 
-	/* populate list of node sets */
-	us.get_unions(final_unions);
-	num_unions = final_unions.size();
-	this->partitions.resize(num_unions);
-	for(i = 0; i < num_unions; i++)
+	/* the original union-find listed unions in the order of
+	 * their roots, and its nodes were indexed by pointer, so
+	 * sort the unions the same way */
+	order.resize(n);
+	for(i = 0; i < n; i++)
+		order[i] = make_pair(roots[i], i);
+	sort(order.begin(), order.end());
+	sorted_unions.resize(n);
+	for(i = 0; i < n; i++)
+		sorted_unions[i].swap(final_unions[order[i].second]);
+	final_unions.swap(sorted_unions);
+
+	/* populate list of node sets, in parallel chunks */
+	this->partitions.clear();
+	this->partitions.resize(n);
+	num_tasks = (n + PARTITIONS_PER_TASK - 1) / PARTITIONS_PER_TASK;
 	{
-		/* copy the nodes from this union to the current
-		 * partition */
-		this->partitions[i].clear();
-		num_nodes = final_unions[i].size();
-		for(j = 0; j < num_nodes; j++)
-			this->partitions[i].add(
-				rev_indices[final_unions[i][j]]
-					);
+		boost::threadpool::pool tp(num_threads);
+		for(k = 0; k < num_tasks; k++)
+		{
+			i = k*PARTITIONS_PER_TASK;
+			tp.schedule(boost::bind(
+				&node_partitioner_t::fill_partitions, this,
+				&topo, &final_unions, i,
+				min(n, i + PARTITIONS_PER_TASK)));
+		}
 	}
 
 	/* success */
@@ -136,3 +163,149 @@ int node_partitioner_t::writeobjs(const std::string& prefix) const
 	toc(clk, "Writing objects");
 	return 0;
 }
+
+/*------------------*/
+/* helper functions */
+/*------------------*/
+
+void node_partitioner_t::add_edges(const octtopo_t* topo,
+                                   concurrent_union_find_t* us,
+                                   size_t first, size_t last, int* ret)
+{
+	octneighbors_t neighs;
+	octnode_t* const* nit;
+	octnode_t* node;
+	size_t i, fi, j;
+
+	/* iterate over the nodes in this range */
+	*ret = 0;
+	for(i = first; i < last; i++)
+	{
+		/* iterate over faces of current node,
+		 * getting all neighbors */
+		node = topo->get_node(i);
+		topo->get_neighbors(i, neighs);
+		for(fi = 0; fi < NUM_FACES_PER_CUBE; fi++)
+			for(nit = neighs.begin(all_cube_faces[fi]);
+					nit != neighs.end(all_cube_faces[fi]);
+					nit++)
+			{
+				/* only counts as an edge if both are 
+				 * labeled the same */
+				if(node->data->is_interior() 
+						!= (*nit)->data->is_interior())
+					continue;
+				if(node->data->get_fp_room()
+						!= (*nit)->data->get_fp_room())
+					continue;
+
+				/* add this edge to graph */
+				j = topo->find(*nit);
+				*ret = us->add_edge(i, j);
+				if(*ret)
+				{
+					*ret = PROPEGATE_ERROR(-1, *ret);
+					return;
+				}
+			}
+	}
+}
+
+void node_partitioner_t::fill_partitions(const octtopo_t* topo,
+		const vector<vector<size_t> >* unions,
+		size_t first, size_t last)
+{
+	size_t i, j, num_nodes;
+
+	/* copy the nodes from each union to its partition */
+	for(i = first; i < last; i++)
+	{
+		num_nodes = unions->at(i).size();
+		for(j = 0; j < num_nodes; j++)
+			this->partitions[i].add(
+				topo->get_node(unions->at(i)[j]));
+	}
+}
+
+void node_partitioner_t::find_roots(const octtopo_t* topo,
+		const vector<vector<size_t> >* unions,
+		vector<octnode_t*>* roots, size_t first, size_t last)
+{
+	vector<pair<octnode_t*, size_t> > nodes;
+	vector<size_t> forest;
+	vector<octnode_t*> ns;
+	octneighbors_t neighs;
+	octnode_t* node;
+	size_t i, j, a, b, ra, rb, fi, num_nodes;
+
+	/* replay the original union-find on each union */
+	for(i = first; i < last; i++)
+	{
+		/* the original indexed nodes in pointer order */
+		num_nodes = unions->at(i).size();
+		nodes.resize(num_nodes);
+		forest.resize(num_nodes);
+		for(j = 0; j < num_nodes; j++)
+		{
+			nodes[j].first = topo->get_node(unions->at(i)[j]);
+			nodes[j].second = unions->at(i)[j];
+			forest[j] = j;
+		}
+		sort(nodes.begin(), nodes.end());
+
+		/* add the edges of each node in the same order.  Every
+		 * edge of a node in this union is within the union */
+		for(a = 0; a < num_nodes; a++)
+		{
+			node = nodes[a].first;
+			topo->get_neighbors(nodes[a].second, neighs);
+			for(fi = 0; fi < NUM_FACES_PER_CUBE; fi++)
+			{
+				/* neighbors were kept in pointer order */
+				ns.assign(neighs.begin(all_cube_faces[fi]),
+					neighs.end(all_cube_faces[fi]));
+				sort(ns.begin(), ns.end());
+				for(j = 0; j < ns.size(); j++)
+				{
+					/* only edges between nodes with
+					 * the same labels */
+					if(node->data->is_interior()
+						!= ns[j]->data->is_interior())
+						continue;
+					if(node->data->get_fp_room()
+						!= ns[j]->data->get_fp_room())
+						continue;
+
+					/* the root of b's tree goes under
+					 * the root of a's tree */
+					b = lower_bound(nodes.begin(),
+						nodes.end(), make_pair(ns[j],
+						(size_t) 0)) - nodes.begin();
+					ra = find_root(forest, a);
+					rb = find_root(forest, b);
+					forest[rb] = ra;
+				}
+			}
+		}
+
+		/* the root of the union */
+		roots->at(i) = nodes[find_root(forest, 0)].first;
+	}
+}
+
+size_t node_partitioner_t::find_root(vector<size_t>& forest, size_t i)
+{
+	size_t r, p;
+
+	/* find the root, then point the path at it */
+	r = i;
+	while(forest[r] != r)
+		r = forest[r];
+	while(forest[i] != r)
+	{
+		p = forest[i];
+		forest[i] = r;
+		i = p;
+	}
+	return r;
+}
@@ -14,7 +14,9 @@
  * building features.
  *
  * Objects in the environment will be divided based on connectivity, in
- * attempt to separate each object from the others.
+ * attempt to separate each object from the others.  The edges of the
+ * topology are processed in parallel chunks with a concurrent
+ * union-find structure.
  *
  * Created July 7th, 2014
  */
@@ -22,6 +24,7 @@
 #include "node_set.h"
 #include <geometry/octree/octtopo.h>
 #include <util/error_codes.h>
+#include <util/union_find.h>
 #include <Eigen/Dense>
 #include <string>
 #include <vector>
@@ -56,11 +59,39 @@ class node_partitioner_t
 		 * algorithm based on connectivity described in the
 		 * octtopo_t value given.
 		 *
-		 * @param topo The octree's topology
+		 * The edges of the topology are processed on multiple
+		 * threads.  The resulting partitions do not depend on
+		 * the number of threads, and are in the same order as
+		 * when the edges are added one at a time.
+		 *
+		 * @param topo         The octree's topology
+		 * @param num_threads  The number of threads to use.
+		 *                     If zero, will use all cores.
 		 *
 		 * @return     Returns zero on success, non-zero on failure.
 		 */
-		int partition(const octtopo::octtopo_t& topo);
+		int partition(const octtopo::octtopo_t& topo,
+		              unsigned int num_threads=0);
+
+		/*-----------*/
+		/* accessors */
+		/*-----------*/
+
+		/**
+		 * Retrieves the number of partitions formed
+		 */
+		inline size_t size() const
+		{ return this->partitions.size(); };
+
+		/**
+		 * Retrieves the i'th partition
+		 *
+		 * @param i   The index of the partition, less than size()
+		 *
+		 * @return    Returns the set of nodes in the partition
+		 */
+		inline const node_set_t& get_partition(size_t i) const
+		{ return this->partitions[i]; };
 
 		/*-----------*/
 		/* debugging */
@@ -79,6 +110,69 @@ class node_partitioner_t
 		 * @return     Returns zero on success, non-zero on failure.
 		 */
 		int writeobjs(const std::string& prefix) const;
+
+	/* helper functions */
+	private:
+
+		/**
+		 * Adds the edges of a range of nodes to the union-find
+		 *
+		 * This is called on multiple threads at once, each
+		 * with a different range of nodes of the topology.
+		 *
+		 * @param topo    The octree's topology
+		 * @param us      The union-find structure to modify
+		 * @param first   The index of the first node to process
+		 * @param last    One past the index of the last node
+		 * @param ret     Where to store the return code
+		 */
+		static void add_edges(const octtopo::octtopo_t* topo,
+				concurrent_union_find_t* us,
+				size_t first, size_t last, int* ret);
+
+		/**
+		 * Populates a range of partitions from lists of nodes
+		 *
+		 * @param topo     The octree's topology
+		 * @param unions   The node indices of each partition
+		 * @param first    The index of the first partition
+		 * @param last     One past the index of the last partition
+		 */
+		void fill_partitions(const octtopo::octtopo_t* topo,
+				const std::vector<std::vector<size_t> >*
+					unions,
+				size_t first, size_t last);
+
+		/**
+		 * Finds the root of a range of unions
+		 *
+		 * This is the root that the serial union-find gives
+		 * each union when edges are added one node at a time,
+		 * with nodes and their neighbors in pointer order.
+		 * Partitions are listed in the order of these roots.
+		 *
+		 * @param topo     The octree's topology
+		 * @param unions   The node indices of each union
+		 * @param roots    Where to store the root of each union
+		 * @param first    The index of the first union
+		 * @param last     One past the index of the last union
+		 */
+		static void find_roots(const octtopo::octtopo_t* topo,
+				const std::vector<std::vector<size_t> >*
+					unions,
+				std::vector<octnode_t*>* roots,
+				size_t first, size_t last);
+
+		/**
+		 * Finds the root of a node in a union-find forest
+		 *
+		 * @param forest   The parent of each node
+		 * @param i        The node to look up
+		 *
+		 * @return    Returns the root of the node
+		 */
+		static size_t find_root(std::vector<size_t>& forest,
+				size_t i);
 };
 
 #endif
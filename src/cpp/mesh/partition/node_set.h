@@ -71,6 +71,22 @@ class node_set_t
 		inline size_t size() const
 		{ return (this->nodes.size()); };
 
+		/**
+		 * Retrieves the beginning of the nodes in this set
+		 *
+		 * @return   Returns an iterator to the first node
+		 */
+		inline std::set<octnode_t*>::const_iterator begin() const
+		{ return this->nodes.begin(); };
+
+		/**
+		 * Retrieves the end of the nodes in this set
+		 *
+		 * @return   Returns the end iterator of the nodes
+		 */
+		inline std::set<octnode_t*>::const_iterator end() const
+		{ return this->nodes.end(); };
+
 		/**
 		 * Adds a node to this set
 		 *
@@ -2,6 +2,10 @@
 #include <geometry/octree/octree.h>
 #include <geometry/octree/octnode.h>
 #include <geometry/octree/octdata.h>
+#include <boost/threadpool.hpp>
+#include <boost/thread.hpp>
+#include <boost/bind.hpp>
+#include <vector>
 
 /**
  * @file   octree_padder.cpp
@@ -25,14 +29,46 @@ using namespace octree_padder;
 using namespace std;
 using namespace Eigen;
 
+/* the number of subtrees per thread that are padded in parallel,
+ * which is used to decide how far down the tree to fork */
+#define PAD_SUBTREES_PER_THREAD 8
+
 /*--------------------------*/
 /* function implementations */
 /*--------------------------*/
 
-void octree_padder::pad(octree_t& tree)
+void octree_padder::pad(octree_t& tree, unsigned int num_threads)
 {
-	/* just call the recursive function, given the root of the tree */
-	pad_recur(tree.get_root());
+	vector<octnode_t*> subtrees;
+	unsigned int fork_depth;
+	size_t i;
+
+	/* determine how many threads to use */
+	if(num_threads == 0)
+		num_threads = boost::thread::hardware_concurrency();
+	if(num_threads <= 1)
+	{
+		/* just call the recursive function, given the
+		 * root of the tree */
+		pad_recur(tree.get_root());
+		return;
+	}
+
+	/* fork deep enough into the tree that there are several
+	 * subtrees for each thread to process */
+	fork_depth = 0;
+	while((1u << (3*fork_depth))
+			< PAD_SUBTREES_PER_THREAD * num_threads)
+		fork_depth++;
+	pad_top(tree.get_root(), 0, fork_depth, subtrees);
+
+	/* the subtrees are disjoint, so they can be padded
+	 * independently.  The pool waits for all tasks when
+	 * it goes out of scope. */
+	boost::threadpool::pool tp(num_threads);
+	for(i = 0; i < subtrees.size(); i++)
+		tp.schedule(boost::bind(octree_padder::pad_recur,
+		                        subtrees[i]));
 }
 	
 void octree_padder::pad_recur(octnode_t* node)
@@ -71,3 +107,39 @@ void octree_padder::pad_recur(octnode_t* node)
 		octree_padder::pad_recur(node->children[i]);
 	}
 }
+		
+void octree_padder::pad_top(octnode_t* node, unsigned int depth,
+                            unsigned int fork_depth,
+                            vector<octnode_t*>& subtrees)
+{
+	size_t i;
+
+	/* stop if we reach a null node */
+	if(node == NULL)
+		return;
+
+	/* if we've descended far enough, the rest of this
+	 * subtree is padded later */
+	if(depth >= fork_depth)
+	{
+		subtrees.push_back(node);
+		return;
+	}
+
+	/* leaves should have data */
+	if(node->isleaf())
+	{
+		if(node->data == NULL)
+			node->data = new octdata_t();
+		return;
+	}
+
+	/* pad any null children, and continue down the tree */
+	for(i = 0; i < CHILDREN_PER_NODE; i++)
+	{
+		if(node->children[i] == NULL)
+			node->init_child(i);
+		octree_padder::pad_top(node->children[i], depth+1,
+		                       fork_depth, subtrees);
+	}
+}
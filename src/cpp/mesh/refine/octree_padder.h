@@ -21,6 +21,7 @@
 
 #include <geometry/octree/octree.h>
 #include <geometry/octree/octnode.h>
+#include <vector>
 
 /**
  * The octree_padder_t namespace is used to modify an octree structure
@@ -55,9 +56,15 @@ namespace octree_padder
 	 * for finding and reconstructing the boundary of the environment
 	 * in an efficient manner.
 	 *
-	 * @param tree   The octree to recursively modify
+	 * The top levels of the tree are padded first, and then
+	 * the subtrees below them are padded in parallel.  The
+	 * resulting tree does not depend on the number of threads.
+	 *
+	 * @param tree          The octree to recursively modify
+	 * @param num_threads   The number of threads to use.  If zero,
+	 *                      will use the number of cores.
 	 */
-	void pad(octree_t& tree);
+	void pad(octree_t& tree, unsigned int num_threads=0);
 
 	/*------------------*/
 	/* helper functions */
@@ -72,6 +79,22 @@ namespace octree_padder
 	 * @param node  The node to recursively check.
 	 */
 	void pad_recur(octnode_t* node);
+
+	/**
+	 * Pads the top levels of a tree, and finds the subtrees below
+	 *
+	 * Will pad the nodes above the given depth the same way as
+	 * pad_recur(), and store the nodes at the given depth, so
+	 * that they can be padded independently.
+	 *
+	 * @param node         The node to recursively check
+	 * @param depth        The depth of node in the tree
+	 * @param fork_depth   The depth of the subtrees to find
+	 * @param subtrees     Where to store the root of each subtree
+	 */
+	void pad_top(octnode_t* node, unsigned int depth,
+	             unsigned int fork_depth,
+	             std::vector<octnode_t*>& subtrees);
 }
 
 #endif
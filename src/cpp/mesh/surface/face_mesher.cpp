@@ -2,9 +2,13 @@
 #include <io/mesh/mesh_io.h>
 #include <geometry/octree/octree.h>
 #include <mesh/surface/node_boundary.h>
+#include <mesh/surface/node_boundary_stream.h>
 #include <mesh/surface/node_corner.h>
 #include <mesh/surface/node_corner_map.h>
 #include <util/error_codes.h>
+#include <Eigen/Dense>
+#include <algorithm>
+#include <vector>
 #include <map>
 
 /**
@@ -55,109 +59,68 @@ int face_mesher_t::add(const octree_t& tree,
 	return 0;
 }
 
+int face_mesher_t::add(const octree_t& tree,
+                       const node_boundary_stream_t& stream)
+{
+	corner_map_t corners;
+	int ret;
+
+	/* construct corners from the streamed faces */
+	ret = corners.add(tree, stream);
+	if(ret)
+		return PROPEGATE_ERROR(-1, ret);
+
+	/* add all these corners to this structure */
+	ret = this->add(tree, corners);
+	if(ret)
+		return PROPEGATE_ERROR(-2, ret);
+
+	/* success */
+	this->mesh.set_color(true);
+	return 0;
+}
+
 int face_mesher_t::add(const octree_t& tree,
 		       const corner_map_t& corners)
 {
 	ccmap_t::const_iterator it;
 	faceset_t::const_iterator fit;
+	vector<node_face_t> faces;
+	vector<size_t> inds;
 	vector<pair<double, size_t> > face_inds; /* <sort value, index> */
-	Vector3d face_pos, norm, avg_norm, a, b, pos, disp, com;
 	mesh_io::polygon_t poly;
-	double normmag, total_weight, area;
+	Vector3d pos;
 	size_t i, num_faces;
 
 	/* iterate over the corners given */
 	for(it = corners.begin(); it != corners.end(); it++)
 	{
-		/* reset values for this corner */
-		avg_norm << 0,0,0; /* reset to zero */
-		com << 0,0,0; /* reset center-of-mass to zero */
-		face_inds.clear();
-		poly.clear();
-		it->first.get_position(tree, pos);
-		total_weight = 0;
-
 		/* add all faces to this structure */
+		faces.clear();
+		inds.clear();
 		for(fit = it->second.begin_faces(); 
 				fit != it->second.end_faces(); fit++)
 		{
-			/* compute position of this face's center */
-			fit->get_isosurface_pos(face_pos);
-
-			/* add this face */
-			face_inds.push_back(pair<double, size_t>
-					(0.0, this->add(*fit, face_pos)));
-		
-			/* compute normal for this face */
-			fit->get_normal(norm);
-
-			/* each face counts proportional
-			 * to its surface area when performing
-			 * the weighted average */
-			area = fit->get_area();
-			avg_norm += norm * area;
-			com += face_pos * area;
-			total_weight += area;
+			faces.push_back(*fit);
+			inds.push_back(this->add(*fit));
 		}
 
-		/* compute average normal for all faces */
-		normmag = avg_norm.norm();
-		if(normmag < APPROX_ZERO)
-			avg_norm << 0,0,1; /* arbitrary */
-		else
-			avg_norm /= normmag; /* normalize */
-		com /= total_weight; /* compute center-of-mass */
-
 		/* check that we have sufficient faces to make a polygon */
-		num_faces = face_inds.size();
+		num_faces = faces.size();
 		if(num_faces < 3)
 		{
+			it->first.get_position(tree, pos);
 			cerr << "[face_mesher_t::add]\tFound corner that "
 			     << "is connected to fewer than three faces!"
 			     << endl 
 			     << "\tCorner pos: " << pos.transpose() << endl
-			     << "\tavg_norm: "     << avg_norm << endl
-			     << "\tNum faces: "    << num_faces << endl
-			     << "\ttotal weight: " << total_weight << endl
+			     << "\tNum faces: "  << num_faces << endl
 			     << endl;
 			continue;
 		}
 
-		/* the face normals all point outwards (from interior
-		 * to exterior), but we want our polygon's normal
-		 * to point inwards (from exterior to interior) */
-		avg_norm *= -1;
-
-		/* make up some coordinate axis for the tangent
-		 * plane of this corner (remember that the corner
-		 * will become a polygon) */
-		if(abs(avg_norm(0)) < abs(avg_norm(1)))
-			a << 1,0,0; /* x-axis less in line with norm */
-		else
-			a << 0,1,0; /* y-axis less in line with norm */
-		b = avg_norm.cross(a);
-		b.normalize();
-		a = b.cross(avg_norm);
-
-		/* sort the faces around the corner by their angle
-		 * along these coordinate axes */
-		for(i = 0; i < num_faces; i++)
-		{
-			/* get displacement of vertex from corner pos */
-			disp(0) = this->mesh.get_vert(
-					face_inds[i].second).x;
-			disp(1) = this->mesh.get_vert(
-					face_inds[i].second).y;
-			disp(2) = this->mesh.get_vert(
-					face_inds[i].second).z;
-			disp -= com; /* displacement relative to 
-					center-of-mass */
-
-			/* compute angle of this vertex with respect
-			 * to the coordinates (a,b) */
-			face_inds[i].first = atan2(disp.dot(b),disp.dot(a));
-		}
-		std::sort(face_inds.begin(), face_inds.end());
+		/* sort the faces around the corner */
+		face_mesher_t::order_faces(faces, inds, face_inds);
 
 		/* add a polygon about this corner from all the vertices
 		 * from these faces
@@ -177,6 +140,80 @@ int face_mesher_t::add(const octree_t& tree,
 	/* success */
 	return 0;
 }
+
+void face_mesher_t::order_faces(const vector<node_face_t>& faces,
+			const vector<size_t>& inds,
+			vector<pair<double, size_t> >& face_inds)
+{
+	vector<Vector3d> face_pos;
+	Vector3d norm, avg_norm, a, b, disp, com;
+	double normmag, total_weight, area;
+	size_t i, num_faces;
+
+	/* reset values for this corner */
+	avg_norm << 0,0,0; /* reset to zero */
+	com << 0,0,0; /* reset center-of-mass to zero */
+	face_inds.clear();
+	total_weight = 0;
+
+	/* compute the position and normal of each face */
+	num_faces = faces.size();
+	face_pos.resize(num_faces);
+	for(i = 0; i < num_faces; i++)
+	{
+		/* compute position of this face's center */
+		faces[i].get_isosurface_pos(face_pos[i]);
+		face_inds.push_back(pair<double, size_t>(0.0, inds[i]));
+
+		/* compute normal for this face */
+		faces[i].get_normal(norm);
+
+		/* each face counts proportional
+		 * to its surface area when performing
+		 * the weighted average */
+		area = faces[i].get_area();
+		avg_norm += norm * area;
+		com += face_pos[i] * area;
+		total_weight += area;
+	}
+
+	/* compute average normal for all faces */
+	normmag = avg_norm.norm();
+	if(normmag < APPROX_ZERO)
+		avg_norm << 0,0,1; /* arbitrary */
+	else
+		avg_norm /= normmag; /* normalize */
+	com /= total_weight; /* compute center-of-mass */
+
+	/* the face normals all point outwards (from interior
+	 * to exterior), but we want our polygon's normal
+	 * to point inwards (from exterior to interior) */
+	avg_norm *= -1;
+
+	/* make up some coordinate axis for the tangent
+	 * plane of this corner (remember that the corner
+	 * will become a polygon) */
+	if(abs(avg_norm(0)) < abs(avg_norm(1)))
+		a << 1,0,0; /* x-axis less in line with norm */
+	else
+		a << 0,1,0; /* y-axis less in line with norm */
+	b = avg_norm.cross(a);
+	b.normalize();
+	a = b.cross(avg_norm);
+
+	/* sort the faces around the corner by their angle
+	 * along these coordinate axes */
+	for(i = 0; i < num_faces; i++)
+	{
+		/* displacement relative to center-of-mass */
+		disp = face_pos[i] - com;
+
+		/* compute angle of this vertex with respect
+		 * to the coordinates (a,b) */
+		face_inds[i].first = atan2(disp.dot(b),disp.dot(a));
+	}
+	std::sort(face_inds.begin(), face_inds.end());
+}
 		
 size_t face_mesher_t::add(const node_face_t& face)
 {
@@ -21,7 +21,10 @@
 #include <io/mesh/mesh_io.h>
 #include <geometry/octree/octree.h>
 #include <mesh/surface/node_boundary.h>
+#include <mesh/surface/node_boundary_stream.h>
 #include <mesh/surface/node_corner_map.h>
+#include <Eigen/Dense>
+#include <vector>
 #include <map>
 
 /**
@@ -94,6 +97,22 @@ class face_mesher_t
 		int add(const octree_t& tree, 
 		        const node_boundary_t& boundary);
 
+		/**
+		 * Adds all faces in the given boundary stream to
+		 * this mesh.
+		 *
+		 * This is the same as adding a node_boundary_t of
+		 * the same faces, but reads the faces from the spill
+		 * file of the stream.
+		 *
+		 * @param tree       The original octree
+		 * @param stream     The streamed faces to add
+		 *
+		 * @return     Returns zero on success, non-zero on failure.
+		 */
+		int add(const octree_t& tree,
+		        const node_boundary_stream_t& stream);
+
 		/**
 		 * Adds all faces and corners in the given corner map
 		 * to this mesh.
@@ -166,6 +185,29 @@ class face_mesher_t
 		inline const mesh_io::mesh_t get_mesh() const
 		{ return this->mesh; };
 
+		/*----------*/
+		/* geometry */
+		/*----------*/
+
+		/**
+		 * Orders the faces that meet at a corner
+		 *
+		 * The vertex of each face is placed at the face's
+		 * isosurface position.  These vertices are sorted by
+		 * their angle about the corner, so that they describe
+		 * a polygon whose normal points from exterior to
+		 * interior.
+		 *
+		 * @param faces      The faces that meet at the corner
+		 * @param inds       The vertex index of each face
+		 * @param face_inds  Where to store the sorted
+		 *                   <angle, vertex index> pairs
+		 */
+		static void order_faces(const std::vector<node_face_t>& faces,
+				const std::vector<size_t>& inds,
+				std::vector<std::pair<double, size_t> >&
+					face_inds);
+
 	/* helper functions */
 	private:
 
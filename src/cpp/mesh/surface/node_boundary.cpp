@@ -38,12 +38,53 @@ using namespace Eigen;
 
 #define APPROX_ZERO  0.000000001
 
+/* the following constants are used for the hash table of faces */
+
+#define MIN_INDEX_BITS   4
+#define INDEX_MULTIPLIER 0x9E3779B97F4A7C15ULL
+
+/* the following helper functions are used in this file */
+
+/**
+ * Computes the hashed slot of a face
+ *
+ * @param f      The face to hash
+ * @param bits   The number of bits in the hash table size
+ *
+ * @return   Returns the first slot to probe for this face
+ */
+static inline size_t hash_face(const node_face_t& f, unsigned int bits)
+{
+	return (size_t) ((f.get_key() * INDEX_MULTIPLIER) >> (64 - bits));
+}
+
+/**
+ * Orders the entries of a node-face mapping by node
+ */
+static inline bool node_face_map_less(
+		const pair<octnode_t*, node_face_t>& a,
+		const pair<octnode_t*, node_face_t>& b)
+{
+	return (a.first < b.first);
+}
+
+/**
+ * Orders the entries of a face mapping by face
+ */
+static inline bool face_map_less(
+		const pair<node_face_t, node_face_info_t>& a,
+		const pair<node_face_t, node_face_info_t>& b)
+{
+	return (a.first < b.first);
+}
+
 /*--------------------------*/
 /* function implementations */
 /*--------------------------*/
 		
 node_boundary_t::node_boundary_t()
 {
+	this->face_index_bits = 0;
 	this->scheme = SEG_ALL;
 }
 
@@ -76,12 +117,12 @@ int node_boundary_t::populate(const octtopo_t& topo, SEG_SCHEME segscheme)
 	return 0;
 }
 		
-bool node_boundary_t::node_is_interior(octnode_t* node) const
+bool node_boundary_t::node_is_interior(octnode_t* node,
+                                       SEG_SCHEME segscheme)
 {
 	/* whether this node is interior or exterior depends
-	 * on the current segmentation scheme for this boundary
-	 * object. */
-	switch(this->scheme)
+	 * on the segmentation scheme for the boundary */
+	switch(segscheme)
 	{
 		default:
 		case SEG_ALL:
@@ -122,11 +163,11 @@ int node_boundary_t::get_nearby_faces(const octtopo_t& topo,
 		octnode_t* node, faceset_t& nfs) const
 {
 	octneighbors_t edges;
-	vector<octnode_t*> neighs;
+	octnode_t* const* nit;
 	pair<nodefacemap_t::const_iterator, 
 		nodefacemap_t::const_iterator> range;
 	nodefacemap_t::const_iterator it;
-	size_t fi, i, n;
+	size_t fi;
 	CUBE_FACE f;
 	int ret;
 
@@ -144,16 +185,11 @@ int node_boundary_t::get_nearby_faces(const octtopo_t& topo,
 	{
 		f = octtopo::all_cube_faces[fi];
 
-		/* get the neighboring nodes on this face */
-		neighs.clear();
-		edges.get(f, neighs);
-
-		/* iterate over neighboring nodes */
-		n = neighs.size();
-		for(i = 0; i < n; i++)
+		/* iterate over neighboring nodes on this face */
+		for(nit = edges.begin(f); nit != edges.end(f); nit++)
 		{
 			/* get the faces that abut the given node */
-			range = this->node_face_map.equal_range(neighs[i]);
+			range = this->find_node(*nit);
 			for(it = range.first; it != range.second; it++)
 				nfs.insert(it->second);
 		}
@@ -163,28 +199,148 @@ int node_boundary_t::get_nearby_faces(const octtopo_t& topo,
 	return 0;
 }
 		
-pair<faceset_t::const_iterator, faceset_t::const_iterator>
+int node_boundary_t::get_nearby_faces(const octtopo_t& topo,
+		octnode_t* node, facelist_t& nfs) const
+{
+	octneighbors_t edges;
+	octnode_t* const* nit;
+	pair<nodefacemap_t::const_iterator, 
+		nodefacemap_t::const_iterator> range;
+	nodefacemap_t::const_iterator it;
+	size_t fi;
+	CUBE_FACE f;
+	int ret;
+
+	/* verify input */
+	if(node == NULL)
+		return 0; /* no neighbors */
+
+	/* find the node in the topology */
+	ret = topo.get(node, edges);
+	if(ret)
+		return PROPEGATE_ERROR(-1, ret);
+
+	/* iterate over all neighboring nodes */
+	for(fi = 0; fi < NUM_FACES_PER_CUBE; fi++)
+	{
+		f = octtopo::all_cube_faces[fi];
+
+		/* iterate over neighboring nodes on this face */
+		for(nit = edges.begin(f); nit != edges.end(f); nit++)
+		{
+			/* get the faces that abut the given node */
+			range = this->find_node(*nit);
+			for(it = range.first; it != range.second; it++)
+				nfs.push_back(it->second);
+		}
+	}
+
+	/* success */
+	return 0;
+}
+
+facemap_t::const_iterator node_boundary_t::find(const node_face_t& f) const
+{
+	size_t h, mask;
+
+	/* check for empty structure */
+	if(this->face_index.empty())
+		return this->faces.end();
+
+	/* linearly probe from the hashed position */
+	mask = this->face_index.size() - 1;
+	h = hash_face(f, this->face_index_bits);
+	while(this->face_index[h] != 0)
+	{
+		if(this->faces[this->face_index[h] - 1].first == f)
+			return (this->faces.begin()
+					+ (this->face_index[h] - 1));
+		h = (h + 1) & mask;
+	}
+
+	/* not found */
+	return this->faces.end();
+}
+		
+pair<facelist_t::const_iterator, facelist_t::const_iterator>
 		node_boundary_t::get_neighbors(const node_face_t& f) const
 {
+	static const facelist_t empty_list;
 	facemap_t::const_iterator fit;
 
 	/* get the info for this face */
-	fit = this->faces.find(f);
+	fit = this->find(f);
 	if(fit == this->faces.end())
 	{
-		/* return an empty interval using a dummy set */
-		faceset_t dummy;
-		return pair<faceset_t::const_iterator,
-			faceset_t::const_iterator>(dummy.end(), 
-						dummy.end());
+		/* return an empty interval */
+		return pair<facelist_t::const_iterator,
+			facelist_t::const_iterator>(empty_list.end(), 
+						empty_list.end());
 	}
 
-	/* return the iterators to the neighbor set for this face */
-	return pair<faceset_t::const_iterator,
-			faceset_t::const_iterator>(
+	/* return the iterators to the neighbor list for this face */
+	return pair<facelist_t::const_iterator,
+			facelist_t::const_iterator>(
 				fit->second.neighbors.begin(),
 				fit->second.neighbors.end());
 }
+
+pair<nodefacemap_t::const_iterator, nodefacemap_t::const_iterator>
+		node_boundary_t::find_node(octnode_t* node) const
+{
+	/* the faces of each node are a contiguous range */
+	return equal_range(this->node_face_map.begin(),
+			this->node_face_map.end(),
+			pair<octnode_t*, node_face_t>(node, node_face_t()),
+			node_face_map_less);
+}
+		
+bool node_boundary_t::faces_are_linked(const octtopo_t& topo,
+                                       const node_face_t& a,
+                                       const node_face_t& b)
+{
+	Vector3d ap, bp, normal;
+
+	/* check edge case of the faces being the same */
+	if(a == b)
+		return false; /* don't want self-linkages */
+
+	/* can't be neighbors if they don't share an edge */
+	if(!(a.shares_edge_with(b)))
+		return false;
+
+	/* check if they have the same interior or exterior
+	 * nodes.  If so, then they share an edge along that
+	 * node, and should be linked */
+	if(a.interior == b.interior || a.exterior == b.exterior)
+		return true;
+
+	/* since the faces don't share either node, that means
+	 * that all of the following must be true for them
+	 * to link:
+	 *
+	 * 	- their interiors must neighbor
+	 * 	- their exteriors must neighbor
+	 * 	- faces must be same direction
+	 * 	- faces on the same plane
+	 */
+	if(!(topo.are_neighbors(a.interior, b.interior)))
+		return false; /* not int. neighbors */
+	if(!(topo.are_neighbors(a.exterior, b.exterior)))
+		return false; /* not ext. neighbors */
+	if(a.direction != b.direction)
+		return false; /* not same direction */
+
+	a.get_center(ap);
+	b.get_center(bp);
+	octtopo::cube_face_normals(a.direction, normal);
+	if(abs(normal.dot(ap - bp)) > APPROX_ZERO)
+		return false; /* not coplanar */
+
+	/* if got here, then the two faces share an edge, and
+	 * should be linked */
+	return true;
+}
 		
 int node_boundary_t::writeobj(const string& filename) const
 {
@@ -221,7 +377,7 @@ int node_boundary_t::writeobj(const string& filename) const
 int node_boundary_t::writeobj_cliques(const std::string& filename) const
 {
 	facemap_t::const_iterator fit;
-	faceset_t::const_iterator nit;
+	facelist_t::const_iterator nit;
 	ofstream outfile;
 	Vector3d p, norm;
 	double halfwidth;
@@ -301,8 +457,7 @@ int node_boundary_t::writeobj_cliques(const std::string& filename) const
 
 int node_boundary_t::populate_faces(const octtopo_t& topo)
 {
-	map<octnode_t*, octneighbors_t>::const_iterator it;
-	pair<facemap_t::iterator, bool> ins;
+	octtopo_t::const_iterator it;
 	node_face_t face;
 	vector<octnode_t*> neighs;
 	size_t f, i, j, n, num_nodes;
@@ -359,19 +514,9 @@ int node_boundary_t::populate_faces(const octtopo_t& topo)
 				face.exterior = neighs[i];
 				
 				/* store face info */
-				ins = this->faces.insert(pair<node_face_t,
+				this->faces.push_back(pair<node_face_t,
 						node_face_info_t>(
 						face, node_face_info_t()));
-				if(!(ins.second))
-				{
-					/* unable to insert face */
-					progbar.clear();
-					cerr << "[node_boundary_t::"
-					     << "populate_faces]\tSomehow,"
-					     << " current face was already"
-					     << " inserted!?" << endl;
-					return -1;
-				}
 
 				/* keep track of all the faces generated
 				 * for each node.
@@ -380,7 +525,7 @@ int node_boundary_t::populate_faces(const octtopo_t& topo)
 				 * node and the opposing node, since both
 				 * are connected to the face. */
 				if(neighs[i] != NULL)
-					this->node_face_map.insert(
+					this->node_face_map.push_back(
 						std::pair<octnode_t*,
 							node_face_t>(
 							neighs[i], face));
@@ -388,24 +533,43 @@ int node_boundary_t::populate_faces(const octtopo_t& topo)
 			
 			/* record current node in mapping */
 			if(found_exterior)
-				this->node_face_map.insert(
+				this->node_face_map.push_back(
 					std::pair<octnode_t*,node_face_t>(
 						it->first, face));
 		}
 	}
+	progbar.clear();
+
+	/* sort the faces, so that they can be iterated in order.
+	 * The node mapping is sorted stably, so that the faces of
+	 * each node keep the order they were generated in. */
+	sort(this->faces.begin(), this->faces.end(), face_map_less);
+	stable_sort(this->node_face_map.begin(), this->node_face_map.end(),
+			node_face_map_less);
+	n = this->faces.size();
+	for(i = 1; i < n; i++)
+		if(this->faces[i-1].first == this->faces[i].first)
+		{
+			/* the same face was generated twice */
+			cerr << "[node_boundary_t::populate_faces]\t"
+			     << "Somehow, current face was already"
+			     << " inserted!?" << endl;
+			return -1;
+		}
+
+	/* index the faces for look-ups */
+	this->build_face_index();
 
 	/* success */
-	progbar.clear();
 	return 0;
 }
 		
 int node_boundary_t::populate_face_linkages(const octtopo_t& topo)
 {
 	facemap_t::iterator fit;
-	faceset_t nearby_faces;
-	faceset_t::iterator nit;
+	facelist_t nearby_faces;
+	facelist_t::iterator nit, nend;
 	node_face_t face;
-	Vector3d fp, np, normal;
 	progress_bar_t progbar;
 	size_t j, num_faces;
 	int ret;
@@ -444,76 +608,17 @@ int node_boundary_t::populate_face_linkages(const octtopo_t& topo)
 		if(ret)
 			return PROPEGATE_ERROR(-2, ret);
 
-		/* for each potential face, check if it should be linked */
-		for(nit = nearby_faces.begin(); 
-				nit != nearby_faces.end(); nit++)
-		{
-			/* check edge case of the faces being the same */
-			if(face == *nit)
-				continue; /* don't want self-linkages */
-
-			/* can't be neighbors if they don't share
-			 * an edge */
-			if(!(face.shares_edge_with(*nit)))
-				continue;
-
-			/* check if they have the same interior or exterior
-			 * nodes.  If so, then they are definitely
-			 * candidates to be linked */
-			if(face.interior == nit->interior)
-			{
-				/* guaranteed to link if their exteriors
-				 * neighbor */
-				
-				/* if got here, then the two faces
-				 * share an edge, and should be 
-				 * linked */
-				fit->second.neighbors.insert(*nit);
-			}
-			else if(face.exterior == nit->exterior)
-			{
-				/* guaranteed to link if their interiors
-				 * are neighbors */
-				
-				/* if got here, then the two faces
-				 * share an edge, and should be 
-				 * linked */
-				fit->second.neighbors.insert(*nit);
-			}
-			else
-			{
-				/* since the faces don't share either
-				 * node, that means that all of the
-				 * following must be true for them
-				 * to link:
-				 *
-				 * 	- their interiors must neighbor
-				 * 	- their exteriors must neighbor
-				 * 	- faces must be same direction
-				 * 	- faces on the same plane
-				 */
-				if(!(topo.are_neighbors(face.interior,
-							nit->interior)))
-					continue; /* not int. neighbors */
-				if(!(topo.are_neighbors(face.exterior,
-							nit->exterior)))
-					continue; /* not ext. neighbors */
-				if(face.direction != nit->direction)
-					continue; /* not same direction */
-
-				face.get_center(fp);
-				nit->get_center(np);
-				octtopo::cube_face_normals(face.direction,
-								normal);
-				if(abs(normal.dot(fp - np)) > APPROX_ZERO)
-					continue; /* not coplanar */
-
-				/* if got here, then the two faces
-				 * share an edge, and should be 
-				 * linked */
-				fit->second.neighbors.insert(*nit);
-			}
-		}
+		/* remove repeats, leaving the faces in sorted order */
+		sort(nearby_faces.begin(), nearby_faces.end());
+		nend = unique(nearby_faces.begin(), nearby_faces.end());
+
+		/* for each potential face, check if it should be linked.
+		 * Since the faces are sorted, the neighbors list will
+		 * be as well. */
+		for(nit = nearby_faces.begin(); nit != nend; nit++)
+			if(node_boundary_t::faces_are_linked(topo,
+							face, *nit))
+				fit->second.neighbors.push_back(*nit);
 	}
 
 	/* success */
@@ -521,6 +626,28 @@ int node_boundary_t::populate_face_linkages(const octtopo_t& topo)
 	return 0;
 }
 
+void node_boundary_t::build_face_index()
+{
+	size_t i, h, n, mask;
+
+	/* size the table to be at most half full */
+	n = this->faces.size();
+	this->face_index_bits = MIN_INDEX_BITS;
+	while((((size_t) 1) << this->face_index_bits) < 2*n)
+		this->face_index_bits++;
+	this->face_index.assign(((size_t) 1) << this->face_index_bits, 0);
+
+	/* insert each face by linear probing */
+	mask = this->face_index.size() - 1;
+	for(i = 0; i < n; i++)
+	{
+		h = hash_face(this->faces[i].first, this->face_index_bits);
+		while(this->face_index[h] != 0)
+			h = (h + 1) & mask;
+		this->face_index[h] = i + 1;
+	}
+}
+
 /*--------------------------------------*/
 /* node_face_t function implementations */
 /*--------------------------------------*/
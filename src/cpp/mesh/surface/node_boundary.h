@@ -18,6 +18,7 @@
 #include <geometry/octree/octtopo.h>
 #include <mesh/partition/node_set.h>
 #include <Eigen/Dense>
+#include <algorithm>
 #include <utility>
 #include <ostream>
 #include <string>
@@ -30,10 +31,13 @@ class node_face_t;
 class node_face_info_t;
 class node_boundary_t;
 
-/* the following typedefs are used for these classes */
-typedef std::multimap<octnode_t*, node_face_t>  nodefacemap_t;
-typedef std::map<node_face_t, node_face_info_t> facemap_t;
-typedef std::set<node_face_t>                   faceset_t;
+/* the following typedefs are used for these classes.  The
+ * boundary faces are stored in vectors sorted by key, so they
+ * can be iterated in the same order as a std::map */
+typedef std::vector<std::pair<octnode_t*, node_face_t> > nodefacemap_t;
+typedef std::vector<std::pair<node_face_t, node_face_info_t> > facemap_t;
+typedef std::set<node_face_t>                            faceset_t;
+typedef std::vector<node_face_t>                         facelist_t;
 
 /**
  * This class represents a face of a node
@@ -240,6 +244,26 @@ class node_face_t
 		/* operators */
 		/*-----------*/
 
+		/**
+		 * Computes an integer key for this face
+		 *
+		 * The key mixes the addresses of the originating
+		 * nodes with the direction of the face, so that faces
+		 * can be indexed in open-addressed hash tables.  Keys
+		 * are not unique, so faces with equal keys must still
+		 * be compared.
+		 *
+		 * @return   Returns the key for this face
+		 */
+		inline unsigned long long get_key() const
+		{
+			return ((((unsigned long long) this->interior)
+				* 0x9E3779B97F4A7C15ULL)
+				^ (((unsigned long long) this->exterior)
+				* 0xC2B2AE3D27D4EB4FULL))
+				+ ((unsigned long long) this->direction);
+		};
+
 		/**
 		 * Copies information from the given node into this object
 		 */
@@ -343,8 +367,9 @@ class node_face_info_t
 	private:
 
 		/* this value represents the list of faces that are 
-		 * connected in some way to this face */
-		faceset_t neighbors;
+		 * connected in some way to this face, sorted in the
+		 * same order as a faceset_t */
+		facelist_t neighbors;
 
 	/* functions */
 	public:
@@ -363,8 +388,7 @@ class node_face_info_t
 		 * Constructs this info from the given info object
 		 */
 		node_face_info_t(const node_face_info_t& other)
-			: neighbors(other.neighbors.begin(), 
-					other.neighbors.end())
+			: neighbors(other.neighbors)
 		{};
 
 		/**
@@ -373,24 +397,40 @@ class node_face_info_t
 		inline void clear()
 		{ this->neighbors.clear(); };
 
+		/**
+		 * Adds a face to the neighbors of this face
+		 *
+		 * Does nothing if the face is already a neighbor.
+		 *
+		 * @param f   The neighboring face to add
+		 */
+		inline void add(const node_face_t& f)
+		{
+			facelist_t::iterator it = std::lower_bound(
+					this->neighbors.begin(),
+					this->neighbors.end(), f);
+			if(it == this->neighbors.end() || *it != f)
+				this->neighbors.insert(it, f);
+		};
+
 		/*-----------*/
 		/* accessors */
 		/*-----------*/
 		
 		/**
-		 * Returns the beginning iterator to the neighbors set
+		 * Returns the beginning iterator to the neighbors list
 		 *
 		 * @return   The begin iterator to this->neighbors
 		 */
-		inline faceset_t::const_iterator begin() const
+		inline facelist_t::const_iterator begin() const
 		{ return this->neighbors.begin(); };
 
 		/**
-		 * Returns the end iterator to the neighbors set
+		 * Returns the end iterator to the neighbors list
 		 *
 		 * @return   The end iterator to this->neighbors
 		 */
-		inline faceset_t::const_iterator end() const
+		inline facelist_t::const_iterator end() const
 		{ return this->neighbors.end(); };
 
 		/*-----------*/
@@ -404,9 +444,7 @@ class node_face_info_t
 				const node_face_info_t& other)
 		{
 			/* copy values */
-			this->neighbors.clear();
-			this->neighbors.insert(other.neighbors.begin(),
-					other.neighbors.end());
+			this->neighbors = other.neighbors;
 
 			/* return the result */
 			return (*this);
@@ -451,8 +489,9 @@ class node_boundary_t
 		 * This mapping represents, for each octnode,
 		 * which faces abut that node.  The node can be
 		 * either interior or exterior.  Since multiple
-		 * faces can abut each node, this must be stored
-		 * as a multimap.
+		 * faces can abut each node, this is stored as
+		 * a list sorted by node, so that the faces of
+		 * a node form a contiguous range.
 		 */
 		nodefacemap_t node_face_map;
 
@@ -462,10 +501,21 @@ class node_boundary_t
 		 * The set of faces is populated using the
 		 * boundary nodes.  This mapping gives information
 		 * about each node face, such as what adjoining faces
-		 * it touches.
+		 * it touches.  It is sorted by face.
 		 */
 		facemap_t faces;
 
+		/**
+		 * An open-addressed hash table of the faces
+		 *
+		 * Each slot stores one plus the position of a face
+		 * in the faces list, or zero if empty.  The slots
+		 * are hashed by the integer key of each face, so
+		 * that faces can be found without a binary search.
+		 */
+		std::vector<size_t> face_index;
+		unsigned int face_index_bits;
+
 		/**
 		 * The segmentation scheme used for this boundary
 		 *
@@ -518,6 +568,8 @@ class node_boundary_t
 		{
 			this->node_face_map.clear();
 			this->faces.clear();
+			this->face_index.clear();
+			this->face_index_bits = 0;
 			this->scheme = SEG_ALL;
 		};
 
@@ -536,7 +588,23 @@ class node_boundary_t
 		 */
 		inline facemap_t::const_iterator end() const
 		{ return this->faces.end(); };
-		
+
+		/**
+		 * Returns the number of faces in this boundary
+		 */
+		inline size_t size() const
+		{ return this->faces.size(); };
+
+		/**
+		 * Finds the given face in this boundary
+		 *
+		 * @param f   The face to find
+		 *
+		 * @return    Returns an iterator to the face and its
+		 *            info, or end() if f is not a boundary face.
+		 */
+		facemap_t::const_iterator find(const node_face_t& f) const;
+
 
 		/*------------*/
 		/* processing */
@@ -557,7 +625,39 @@ class node_boundary_t
 		 * @return       Returns true iff 'node' is considered
 		 *               interior under the current scheme.
 		 */
-		bool node_is_interior(octnode_t* node) const;
+		inline bool node_is_interior(octnode_t* node) const
+		{ return node_is_interior(node, this->scheme); };
+
+		/**
+		 * Will specify if a given node is interior, based on
+		 * the given segmentation scheme.
+		 *
+		 * @param node      The node to analyze
+		 * @param segscheme The segmentation scheme to use
+		 *
+		 * @return       Returns true iff 'node' is considered
+		 *               interior under the given scheme.
+		 */
+		static bool node_is_interior(octnode_t* node,
+				SEG_SCHEME segscheme);
+
+		/**
+		 * Checks if two boundary faces should be linked
+		 *
+		 * Given two distinct faces that are near each other,
+		 * will determine if they should be neighbors in the
+		 * boundary graph.  Faces are linked iff they share an
+		 * edge and either share a node or lie on the same plane
+		 * between neighboring nodes.
+		 *
+		 * @param topo   The octree topology
+		 * @param a      The first face
+		 * @param b      The second face
+		 *
+		 * @return       Returns true iff a and b should be linked
+		 */
+		static bool faces_are_linked(const octtopo::octtopo_t& topo,
+				const node_face_t& a, const node_face_t& b);
 
 		/**
 		 * Retrieves a faces that neighbor a node
@@ -593,8 +693,8 @@ class node_boundary_t
 		 *
 		 * @return    The start/end pair of iterators to f's neighs
 		 */
-		std::pair<faceset_t::const_iterator,
-			faceset_t::const_iterator>
+		std::pair<facelist_t::const_iterator,
+			facelist_t::const_iterator>
 				get_neighbors(const node_face_t& f) const;
 
 		/**
@@ -611,10 +711,9 @@ class node_boundary_t
 		 * @return   Returns start/end pair of iterators for
 		 *           the retrieved faces.
 		 */
-		inline std::pair<nodefacemap_t::const_iterator,
+		std::pair<nodefacemap_t::const_iterator,
 			nodefacemap_t::const_iterator>
-				find_node(octnode_t* node) const
-		{ return this->node_face_map.equal_range(node); };
+				find_node(octnode_t* node) const;
 
 		/*-----------*/
 		/* debugging */
@@ -677,6 +776,29 @@ class node_boundary_t
 		 * @return    Returns zero on success, non-zero on failure.
 		 */
 		int populate_face_linkages(const octtopo::octtopo_t& topo);
+
+		/**
+		 * Retrieves the faces that neighbor a node
+		 *
+		 * Performs the same search as get_nearby_faces(),
+		 * but appends the faces to a list, which may
+		 * contain repeats.
+		 *
+		 * @param topo       The octree topology
+		 * @param node       The node to analyze
+		 * @param nfs        The list to append to
+		 *
+		 * @return      Returns zero on success, non-zero on failure
+		 */
+		int get_nearby_faces(const octtopo::octtopo_t& topo,
+			octnode_t* node, facelist_t& nfs) const;
+
+		/**
+		 * Populates the hash table of faces
+		 *
+		 * Must be called after the faces list is sorted.
+		 */
+		void build_face_index();
 };
 
 #endif
@@ -0,0 +1,543 @@
+#include "node_boundary_stream.h"
+#include <geometry/octree/octnode.h>
+#include <geometry/octree/octtopo.h>
+#include <mesh/surface/node_boundary.h>
+#include <util/progress_bar.h>
+#include <util/error_codes.h>
+#include <util/tictoc.h>
+#include <boost/threadpool.hpp>
+#include <boost/bind.hpp>
+#include <algorithm>
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <stdio.h>
+
+/**
+ * @file   node_boundary_stream.cpp
+ * @author Eric Turner <elturner@eecs.berkeley.edu>
+ * @brief  Computes boundary faces of octrees one tile at a time
+ *
+ * @section DESCRIPTION
+ *
+ * This file contains classes used to compute the same boundary faces
+ * and face linkages as the node_boundary_t class, but without storing
+ * all of them in memory at once.  The leaves of the octree topology are
+ * split into spatial tiles, which are processed independently and
+ * written to a spill file on disk.  The faces can then be read back
+ * in order with the node_boundary_reader_t class.
+ *
+ * Since the leaves of the topology are stored in depth-first order,
+ * each contiguous range of leaves is a spatially coherent tile.  The
+ * faces along the seams of a tile are found from the topology itself,
+ * so no faces from neighboring tiles need to be kept in memory.
+ */
+
+using namespace octtopo;
+using namespace std;
+
+/* the following constants are used for the spill file format.  Each
+ * record is stored as a list of size_t values:
+ *
+ * 	interior node index
+ * 	exterior node index (or NULL_NODE_INDEX)
+ * 	direction
+ * 	number of neighbors
+ * 	neighbor face indices...
+ */
+#define NULL_NODE_INDEX     ((size_t) -1)
+#define RECORD_HEADER_SIZE  4
+
+/* the number of neighbors per face, used to estimate how many faces
+ * can be held in a buffer of a given size */
+#define ESTIMATED_NEIGHBORS_PER_FACE  8
+
+/*-------------------------------------------------*/
+/* node_boundary_stream_t function implementations */
+/*-------------------------------------------------*/
+
+node_boundary_stream_t::node_boundary_stream_t()
+{
+	this->topo = NULL;
+	this->scheme = node_boundary_t::SEG_ALL;
+}
+
+node_boundary_stream_t::~node_boundary_stream_t()
+{
+	this->clear();
+}
+
+int node_boundary_stream_t::populate(const octtopo_t& topo,
+                                     const string& filename,
+                                     size_t bufsize,
+                                     node_boundary_t::SEG_SCHEME segscheme,
+                                     unsigned int num_threads)
+{
+	vector<vector<size_t> > bufs;
+	vector<int> rets;
+	vector<size_t> tiles;
+	ofstream outfile;
+	progress_bar_t progbar;
+	tictoc_t clk;
+	size_t i, m, t, b, nt, num_tiles, faces_per_tile;
+
+	/* count the faces of each node, which determines the
+	 * index of each face */
+	tic(clk);
+	this->index(topo, segscheme);
+	m = this->boundary_nodes.size();
+
+	/* determine the number of threads to use */
+	nt = num_threads;
+	if(nt == 0)
+		nt = boost::thread::hardware_concurrency();
+	if(nt == 0)
+		nt = 1;
+
+	/* each thread holds the records of one tile in memory, so
+	 * choose the size of tiles to fit within the buffer */
+	faces_per_tile = bufsize / (nt * sizeof(size_t)
+			* (RECORD_HEADER_SIZE+ESTIMATED_NEIGHBORS_PER_FACE));
+	if(faces_per_tile == 0)
+		faces_per_tile = 1;
+	tiles.push_back(0);
+	for(i = 0; i < m; i++)
+		if(this->face_offsets[i+1] - this->face_offsets[tiles.back()]
+				>= faces_per_tile)
+			tiles.push_back(i+1);
+	if(tiles.back() != m)
+		tiles.push_back(m);
+	num_tiles = tiles.size() - 1;
+
+	/* open the spill file for writing.  It is owned by this
+	 * object once opened, so that clear() removes it */
+	outfile.open(filename.c_str(), ios_base::out | ios_base::binary);
+	if(!(outfile.is_open()))
+	{
+		cerr << "[node_boundary_stream_t::populate]\tUnable to "
+		     << "open spill file: " << filename << endl;
+		return -1;
+	}
+	this->spillfile = filename;
+
+	/* process the tiles in batches of one tile per thread, and
+	 * write the records of each batch in order */
+	progbar.set_name("Streaming boundary faces");
+	bufs.resize(nt);
+	rets.resize(nt);
+	{
+		boost::threadpool::pool tp(nt);
+		for(t = 0; t < num_tiles; t += b)
+		{
+			/* update user on progress */
+			progbar.update(t, num_tiles);
+
+			/* compute this batch of tiles */
+			b = min(nt, num_tiles - t);
+			for(i = 0; i < b; i++)
+				tp.schedule(boost::bind(
+					&node_boundary_stream_t::process_tile,
+					this, tiles[t+i], tiles[t+i+1],
+					&(bufs[i]), &(rets[i])));
+			tp.wait();
+
+			/* export the records to disk */
+			for(i = 0; i < b; i++)
+			{
+				if(rets[i])
+				{
+					progbar.clear();
+					outfile.close();
+					this->clear();
+					return PROPEGATE_ERROR(-2, rets[i]);
+				}
+				if(!(bufs[i].empty()))
+					outfile.write((char*) &(bufs[i][0]),
+						bufs[i].size()*sizeof(size_t));
+				bufs[i].clear();
+			}
+			if(outfile.fail())
+			{
+				progbar.clear();
+				cerr << "[node_boundary_stream_t::populate]"
+				     << "\tUnable to write to spill file: "
+				     << filename << endl;
+				outfile.close();
+				this->clear();
+				return -3;
+			}
+		}
+	}
+
+	/* success */
+	outfile.close();
+	progbar.clear();
+	toc(clk, "Streaming boundary faces");
+	return 0;
+}
+
+void node_boundary_stream_t::index(const octtopo_t& topo,
+                                   node_boundary_t::SEG_SCHEME segscheme)
+{
+	vector<node_face_t> faces;
+	size_t i, n;
+
+	/* remove any existing info */
+	this->clear();
+	this->topo = &topo;
+	this->scheme = segscheme;
+
+	/* count the faces of each node */
+	n = topo.size();
+	this->face_offsets.push_back(0);
+	for(i = 0; i < n; i++)
+	{
+		faces.clear();
+		this->get_node_faces(i, faces);
+		if(faces.empty())
+			continue;
+		this->boundary_nodes.push_back(i);
+		this->face_offsets.push_back(this->face_offsets.back()
+						+ faces.size());
+	}
+}
+
+void node_boundary_stream_t::clear()
+{
+	/* remove the spill file from disk */
+	if(!(this->spillfile.empty()))
+		remove(this->spillfile.c_str());
+	this->spillfile.clear();
+
+	/* clear the indices */
+	this->boundary_nodes.clear();
+	this->face_offsets.clear();
+	this->topo = NULL;
+	this->scheme = node_boundary_t::SEG_ALL;
+}
+
+int node_boundary_stream_t::get_face(size_t id, node_face_t& f) const
+{
+	vector<node_face_t> faces;
+	size_t i;
+
+	/* check arguments */
+	if(id >= this->size())
+		return -1;
+
+	/* find the node whose faces contain this index */
+	i = (upper_bound(this->face_offsets.begin(),
+			this->face_offsets.end(), id)
+			- this->face_offsets.begin()) - 1;
+
+	/* regenerate the faces of this node */
+	this->get_node_faces(this->boundary_nodes[i], faces);
+	if(id - this->face_offsets[i] >= faces.size())
+		return -2;
+	f = faces[id - this->face_offsets[i]];
+	return 0;
+}
+
+int node_boundary_stream_t::find_face(const node_face_t& f,
+                                      size_t& id) const
+{
+	vector<node_face_t> faces;
+	vector<size_t>::const_iterator it;
+	size_t i, k;
+
+	/* find the interior node of this face */
+	i = this->topo->find(f.interior);
+	if(i >= this->topo->size())
+		return -1;
+	it = lower_bound(this->boundary_nodes.begin(),
+			this->boundary_nodes.end(), i);
+	if(it == this->boundary_nodes.end() || *it != i)
+		return -2; /* node has no faces */
+
+	/* find the face among the faces of this node */
+	this->get_node_faces(i, faces);
+	for(k = 0; k < faces.size(); k++)
+		if(faces[k] == f)
+		{
+			id = this->face_offsets[it
+				- this->boundary_nodes.begin()] + k;
+			return 0;
+		}
+
+	/* not a boundary face */
+	return -3;
+}
+
+int node_boundary_stream_t::get_info(const vector<size_t>& ids,
+                                     node_face_info_t& info) const
+{
+	node_face_t f;
+	size_t i, n;
+	int ret;
+
+	/* add each face to the info */
+	info.clear();
+	n = ids.size();
+	for(i = 0; i < n; i++)
+	{
+		ret = this->get_face(ids[i], f);
+		if(ret)
+			return PROPEGATE_ERROR(-1, ret);
+		info.add(f);
+	}
+
+	/* success */
+	return 0;
+}
+
+/*-----------------------------------------*/
+/* node_boundary_stream_t helper functions */
+/*-----------------------------------------*/
+
+void node_boundary_stream_t::get_node_faces(size_t i,
+                                   vector<node_face_t>& faces) const
+{
+	octneighbors_t edges;
+	octnode_t* const* nit;
+	octnode_t* node;
+	size_t fi;
+	CUBE_FACE f;
+
+	/* only interior nodes have faces */
+	node = this->topo->get_node(i);
+	if(!(node_boundary_t::node_is_interior(node, this->scheme)))
+		return;
+
+	/* iterate over faces, looking for exterior neighbors, in
+	 * the same way as node_boundary_t::populate_faces() */
+	this->topo->get_neighbors(i, edges);
+	for(fi = 0; fi < NUM_FACES_PER_CUBE; fi++)
+	{
+		f = all_cube_faces[fi];
+
+		/* if this node abuts null space, then that counts
+		 * as exterior */
+		if(edges.size(f) == 0)
+		{
+			if(!(node_boundary_t::node_is_interior(NULL,
+							this->scheme)))
+				faces.push_back(node_face_t(node, NULL, f));
+			continue;
+		}
+
+		/* add a face for each exterior neighbor */
+		for(nit = edges.begin(f); nit != edges.end(f); nit++)
+			if(!(node_boundary_t::node_is_interior(*nit,
+							this->scheme)))
+				faces.push_back(node_face_t(node, *nit, f));
+	}
+}
+
+int node_boundary_stream_t::get_abutting_faces(octnode_t* node,
+                                   vector<node_face_t>& faces) const
+{
+	octneighbors_t edges;
+	octnode_t* const* nit;
+	size_t i, fi;
+	CUBE_FACE f;
+
+	/* find the node in the topology */
+	i = this->topo->find(node);
+	if(i >= this->topo->size())
+		return -1;
+
+	/* interior nodes abut their own faces */
+	if(node_boundary_t::node_is_interior(node, this->scheme))
+	{
+		this->get_node_faces(i, faces);
+		return 0;
+	}
+
+	/* exterior nodes abut the faces of their interior neighbors */
+	this->topo->get_neighbors(i, edges);
+	for(fi = 0; fi < NUM_FACES_PER_CUBE; fi++)
+	{
+		f = all_cube_faces[fi];
+		for(nit = edges.begin(f); nit != edges.end(f); nit++)
+			if(node_boundary_t::node_is_interior(*nit,
+							this->scheme))
+				faces.push_back(node_face_t(*nit, node,
+						get_opposing_face(f)));
+	}
+
+	/* success */
+	return 0;
+}
+
+int node_boundary_stream_t::get_nearby_faces(octnode_t* node,
+                                   vector<node_face_t>& faces) const
+{
+	octneighbors_t edges;
+	octnode_t* const* nit;
+	size_t i, fi;
+	CUBE_FACE f;
+	int ret;
+
+	/* verify input */
+	if(node == NULL)
+		return 0; /* no neighbors */
+
+	/* find the node in the topology */
+	i = this->topo->find(node);
+	if(i >= this->topo->size())
+		return -1;
+
+	/* get the faces that abut each neighboring node */
+	this->topo->get_neighbors(i, edges);
+	for(fi = 0; fi < NUM_FACES_PER_CUBE; fi++)
+	{
+		f = all_cube_faces[fi];
+		for(nit = edges.begin(f); nit != edges.end(f); nit++)
+		{
+			ret = this->get_abutting_faces(*nit, faces);
+			if(ret)
+				return PROPEGATE_ERROR(-2, ret);
+		}
+	}
+
+	/* success */
+	return 0;
+}
+
+void node_boundary_stream_t::process_tile(size_t first, size_t last,
+                                          vector<size_t>* buf,
+                                          int* ret) const
+{
+	vector<node_face_t> faces, nearby;
+	vector<node_face_t>::iterator nit;
+	size_t i, k, m, id, start;
+
+	/* iterate over the nodes in this tile */
+	for(i = first; i < last; i++)
+	{
+		/* get the faces of this node */
+		faces.clear();
+		this->get_node_faces(this->boundary_nodes[i], faces);
+		for(k = 0; k < faces.size(); k++)
+		{
+			/* write the header of this face's record */
+			buf->push_back(this->boundary_nodes[i]);
+			buf->push_back((faces[k].exterior == NULL)
+				? NULL_NODE_INDEX
+				: this->topo->find(faces[k].exterior));
+			buf->push_back((size_t) faces[k].direction);
+			buf->push_back(0);
+			start = buf->size();
+
+			/* get all nearby faces that have the potential
+			 * to be linked to this face */
+			nearby.clear();
+			*ret = this->get_nearby_faces(faces[k].interior,
+							nearby);
+			if(*ret)
+			{
+				*ret = PROPEGATE_ERROR(-1, *ret);
+				return;
+			}
+			*ret = this->get_nearby_faces(faces[k].exterior,
+							nearby);
+			if(*ret)
+			{
+				*ret = PROPEGATE_ERROR(-2, *ret);
+				return;
+			}
+			sort(nearby.begin(), nearby.end());
+			nit = unique(nearby.begin(), nearby.end());
+
+			/* record the index of each linked face */
+			for(m = 0; m < (size_t) (nit - nearby.begin()); m++)
+			{
+				if(!(node_boundary_t::faces_are_linked(
+						*(this->topo), faces[k],
+						nearby[m])))
+					continue;
+				*ret = this->find_face(nearby[m], id);
+				if(*ret)
+				{
+					*ret = PROPEGATE_ERROR(-3, *ret);
+					return;
+				}
+				buf->push_back(id);
+			}
+			(*buf)[start-1] = buf->size() - start;
+			sort(buf->begin() + start, buf->end());
+		}
+	}
+
+	/* success */
+	*ret = 0;
+}
+
+/*-------------------------------------------------*/
+/* node_boundary_reader_t function implementations */
+/*-------------------------------------------------*/
+
+int node_boundary_reader_t::open(const node_boundary_stream_t& s)
+{
+	/* close any open file */
+	this->close();
+
+	/* open the spill file of the stream */
+	this->infile.open(s.spillfile.c_str(),
+			ios_base::in | ios_base::binary);
+	if(!(this->infile.is_open()))
+	{
+		cerr << "[node_boundary_reader_t::open]\tUnable to open "
+		     << "spill file: " << s.spillfile << endl;
+		return -1;
+	}
+
+	/* success */
+	this->stream = &s;
+	this->next_id = 0;
+	return 0;
+}
+
+int node_boundary_reader_t::next(size_t& id, node_face_t& face,
+                                 vector<size_t>& neighs)
+{
+	size_t header[RECORD_HEADER_SIZE];
+
+	/* check that there is another face to read */
+	if(this->eof())
+		return -1;
+
+	/* read the header of this record */
+	this->infile.read((char*) header, sizeof(header));
+	if(this->infile.fail())
+		return -2;
+	face.init(this->stream->topo->get_node(header[0]),
+			(header[1] == NULL_NODE_INDEX) ? NULL
+			: this->stream->topo->get_node(header[1]),
+			(CUBE_FACE) header[2]);
+
+	/* read the neighbors of this face */
+	neighs.resize(header[3]);
+	if(!(neighs.empty()))
+	{
+		this->infile.read((char*) &(neighs[0]),
+				neighs.size()*sizeof(size_t));
+		if(this->infile.fail())
+			return -3;
+	}
+
+	/* success */
+	id = this->next_id++;
+	return 0;
+}
+
+void node_boundary_reader_t::close()
+{
+	/* close the file if it is open */
+	if(this->infile.is_open())
+		this->infile.close();
+	this->infile.clear();
+	this->stream = NULL;
+	this->next_id = 0;
+}
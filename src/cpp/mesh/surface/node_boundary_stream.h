@@ -0,0 +1,344 @@
+#ifndef NODE_BOUNDARY_STREAM_H
+#define NODE_BOUNDARY_STREAM_H
+
+/**
+ * @file node_boundary_stream.h
+ * @author Eric Turner <elturner@eecs.berkeley.edu>
+ * @brief  Computes boundary faces of octrees one tile at a time
+ *
+ * @section DESCRIPTION
+ *
+ * This file contains classes used to compute the same boundary faces
+ * and face linkages as the node_boundary_t class, but without storing
+ * all of them in memory at once.  The leaves of the octree topology are
+ * split into spatial tiles, which are processed independently and
+ * written to a spill file on disk.  The faces can then be read back
+ * in order with the node_boundary_reader_t class.
+ *
+ * Each face is identified by an index, which is derived from the
+ * index of its interior node in the topology.  This allows faces in
+ * other tiles to be referenced without storing them, since the faces
+ * of any node can be regenerated from the topology.
+ */
+
+#include <geometry/octree/octtopo.h>
+#include <mesh/surface/node_boundary.h>
+#include <fstream>
+#include <string>
+#include <vector>
+
+/* the following classes are defined in this file */
+class node_boundary_stream_t;
+class node_boundary_reader_t;
+
+/**
+ * The node_boundary_stream_t class writes boundary faces to a spill file
+ *
+ * Only the faces of the tiles currently being processed are kept in
+ * memory, in a buffer of a given size, and the rest are on disk.  This
+ * is not an out-of-core algorithm: the tree and topology, and an index
+ * of the nodes that have faces, must still fit in memory.
+ */
+class node_boundary_stream_t
+{
+	/* security */
+	friend class node_boundary_reader_t;
+	friend class tiled_face_mesher_t;
+
+	/* parameters */
+	private:
+
+		/**
+		 * The topology that was used to generate these faces
+		 *
+		 * The topology must not be modified or freed while
+		 * this object is in use.
+		 */
+		const octtopo::octtopo_t* topo;
+
+		/**
+		 * The segmentation scheme used for this boundary
+		 */
+		node_boundary_t::SEG_SCHEME scheme;
+
+		/**
+		 * The topology indices of the nodes that have faces
+		 *
+		 * These are the interior nodes of the boundary, in
+		 * increasing order.  Only these nodes are indexed,
+		 * since they are typically a small fraction of the
+		 * leaves of the tree.
+		 */
+		std::vector<size_t> boundary_nodes;
+
+		/**
+		 * The index of the first face of each boundary node
+		 *
+		 * The faces whose interior node is boundary_nodes[i]
+		 * have indices in the range
+		 * [face_offsets[i], face_offsets[i+1]).  This vector
+		 * has one more element than boundary_nodes.
+		 */
+		std::vector<size_t> face_offsets;
+
+		/**
+		 * The location of the spill file on disk
+		 *
+		 * The spill file stores, for each face in order, the
+		 * topology indices of its nodes, its direction, and the
+		 * indices of its neighboring faces.
+		 */
+		std::string spillfile;
+
+	/* functions */
+	public:
+
+		/*----------------*/
+		/* initialization */
+		/*----------------*/
+
+		/**
+		 * Constructs an empty stream
+		 */
+		node_boundary_stream_t();
+
+		/**
+		 * Frees all memory and removes the spill file
+		 */
+		~node_boundary_stream_t();
+
+		/**
+		 * Computes the indices of the boundary faces
+		 *
+		 * Will determine which nodes of the topology have
+		 * faces, and how many, which defines the index of
+		 * each face.  No spill file is written, so only
+		 * get_face() and find_face() may be used after this
+		 * call.  This is performed by populate().
+		 *
+		 * @param topo        The octree topology to use
+		 * @param segscheme   The segmentation scheme to use
+		 */
+		void index(const octtopo::octtopo_t& topo,
+				node_boundary_t::SEG_SCHEME segscheme
+					= node_boundary_t::SEG_ALL);
+
+		/**
+		 * Generates the boundary faces of a topology
+		 *
+		 * Will compute the same faces and linkages as
+		 * node_boundary_t::populate(), and write them
+		 * to the given spill file.
+		 *
+		 * The buffer size bounds how many faces are held
+		 * in memory at once, across all threads, before
+		 * they are written.  It does not include the memory
+		 * of the tree, the topology, or the face index.  If
+		 * unable to compute or write the faces, the partial
+		 * spill file is removed.
+		 *
+		 * @param topo        The octree topology to use
+		 * @param filename    Where to write the spill file
+		 * @param bufsize     The size of the face buffer, in bytes
+		 * @param segscheme   The segmentation scheme to use
+		 * @param num_threads The number of threads to use.  If
+		 *                    zero, will use the number of cores.
+		 *
+		 * @return    Returns zero on success, non-zero on failure.
+		 */
+		int populate(const octtopo::octtopo_t& topo,
+				const std::string& filename,
+				size_t bufsize,
+				node_boundary_t::SEG_SCHEME segscheme
+					= node_boundary_t::SEG_ALL,
+				unsigned int num_threads=0);
+
+		/**
+		 * Clears all info and removes the spill file
+		 */
+		void clear();
+
+		/*-----------*/
+		/* accessors */
+		/*-----------*/
+
+		/**
+		 * Returns the number of faces in this boundary
+		 */
+		inline size_t size() const
+		{
+			return (this->face_offsets.empty() ? 0
+					: this->face_offsets.back());
+		};
+
+		/**
+		 * Retrieves the face with the given index
+		 *
+		 * @param id   The index of the face, less than size()
+		 * @param f    Where to store the face
+		 *
+		 * @return     Returns zero on success, non-zero on failure.
+		 */
+		int get_face(size_t id, node_face_t& f) const;
+
+		/**
+		 * Finds the index of the given face
+		 *
+		 * @param f    The face to find
+		 * @param id   Where to store the index of the face
+		 *
+		 * @return     Returns zero on success, non-zero if
+		 *             the face is not in this boundary.
+		 */
+		int find_face(const node_face_t& f, size_t& id) const;
+
+		/**
+		 * Retrieves the faces with the given indices
+		 *
+		 * Any existing neighbors in the info object will
+		 * be removed.
+		 *
+		 * @param ids    The indices of the faces to retrieve
+		 * @param info   Where to store the faces as neighbors
+		 *
+		 * @return     Returns zero on success, non-zero on failure.
+		 */
+		int get_info(const std::vector<size_t>& ids,
+				node_face_info_t& info) const;
+
+	/* helper functions */
+	private:
+
+		/**
+		 * Generates the faces whose interior is the i'th node
+		 *
+		 * The faces are generated in a fixed order, which
+		 * defines their indices.  Faces are appended to the
+		 * given vector.
+		 *
+		 * @param i      The index of the node in the topology
+		 * @param faces  Where to append the faces
+		 */
+		void get_node_faces(size_t i,
+				std::vector<node_face_t>& faces) const;
+
+		/**
+		 * Generates the faces that abut the given node
+		 *
+		 * The node can be either the interior or the exterior
+		 * node of these faces.  Faces are appended to the
+		 * given vector.
+		 *
+		 * @param node   The node to analyze
+		 * @param faces  Where to append the faces
+		 *
+		 * @return     Returns zero on success, non-zero on failure.
+		 */
+		int get_abutting_faces(octnode_t* node,
+				std::vector<node_face_t>& faces) const;
+
+		/**
+		 * Generates the faces that abut neighbors of a node
+		 *
+		 * This is the same superset of faces as is found by
+		 * node_boundary_t::get_nearby_faces().  Faces are
+		 * appended to the given vector, and may be repeated.
+		 *
+		 * @param node   The node to analyze
+		 * @param faces  Where to append the faces
+		 *
+		 * @return     Returns zero on success, non-zero on failure.
+		 */
+		int get_nearby_faces(octnode_t* node,
+				std::vector<node_face_t>& faces) const;
+
+		/**
+		 * Computes the spill records for a tile of nodes
+		 *
+		 * The tile consists of the boundary nodes
+		 * boundary_nodes[first] through boundary_nodes[last-1].
+		 * The records of all faces of these nodes are appended
+		 * to the given buffer.
+		 *
+		 * @param first   The first boundary node of the tile
+		 * @param last    One past the last boundary node
+		 * @param buf     Where to store the records
+		 * @param ret     Where to store the return code
+		 */
+		void process_tile(size_t first, size_t last,
+				std::vector<size_t>* buf, int* ret) const;
+};
+
+/**
+ * The node_boundary_reader_t class reads faces from a spill file
+ *
+ * Faces are read in order of their indices, along with the indices
+ * of their neighbors.
+ */
+class node_boundary_reader_t
+{
+	/* parameters */
+	private:
+
+		/**
+		 * The stream being read
+		 */
+		const node_boundary_stream_t* stream;
+
+		/**
+		 * The open spill file
+		 */
+		std::ifstream infile;
+
+		/**
+		 * The index of the next face to read
+		 */
+		size_t next_id;
+
+	/* functions */
+	public:
+
+		/**
+		 * Constructs a reader that is not open
+		 */
+		node_boundary_reader_t() : stream(NULL), next_id(0) {};
+
+		/**
+		 * Opens the spill file of the given stream
+		 *
+		 * @param s   The stream to read, which must have
+		 *            been populated.
+		 *
+		 * @return    Returns zero on success, non-zero on failure.
+		 */
+		int open(const node_boundary_stream_t& s);
+
+		/**
+		 * Returns true iff all faces have been read
+		 */
+		inline bool eof() const
+		{
+			return (this->stream == NULL
+				|| this->next_id >= this->stream->size());
+		};
+
+		/**
+		 * Reads the next face from the spill file
+		 *
+		 * @param id      Where to store the index of the face
+		 * @param face    Where to store the face
+		 * @param neighs  Where to store the indices of the
+		 *                face's neighbors
+		 *
+		 * @return    Returns zero on success, non-zero on failure.
+		 */
+		int next(size_t& id, node_face_t& face,
+				std::vector<size_t>& neighs);
+
+		/**
+		 * Closes the spill file
+		 */
+		void close();
+};
+
+#endif
@@ -4,6 +4,7 @@
 #include <geometry/octree/octtopo.h>
 #include <mesh/surface/node_boundary.h>
 #include <Eigen/Dense>
+#include <algorithm>
 #include <iostream>
 
 /**
@@ -44,41 +45,41 @@ void corner_t::writeobj(std::ostream& os, const octree_t& tree) const
 			
 void corner_t::writecsv(std::ostream& os) const
 {
-	os << this->x_ind << ","
-	   << this->y_ind << ","
-	   << this->z_ind << ",";
+	os << this->x_ind() << ","
+	   << this->y_ind() << ","
+	   << this->z_ind() << ",";
 }
 			
 bool corner_t::within_bounds(const corner_t& min_c,
 					const corner_t& max_c) const
 {
+	int x, y, z;
+
 	/* check that this corner falls within the given bounds */
-	if(this->x_ind < min_c.x_ind || this->x_ind > max_c.x_ind)
+	x = this->x_ind();
+	y = this->y_ind();
+	z = this->z_ind();
+	if(x < min_c.x_ind() || x > max_c.x_ind())
 		return false; /* out of bounds in x */
-	if(this->y_ind < min_c.y_ind || this->y_ind > max_c.y_ind)
+	if(y < min_c.y_ind() || y > max_c.y_ind())
 		return false; /* out of bounds in y */
-	if(this->z_ind < min_c.z_ind || this->z_ind > max_c.z_ind)
+	if(z < min_c.z_ind() || z > max_c.z_ind())
 		return false; /* out of bounds in z */
 	return true; /* in bounds */
 }
 			
 void corner_t::update_bounds(corner_t& min_c, corner_t& max_c) const
 {
-	/* update x-component */
-	if(this->x_ind < min_c.x_ind)
-		min_c.x_ind = this->x_ind;
-	if(this->x_ind > max_c.x_ind)
-		max_c.x_ind = this->x_ind;
-	
-	/* update y-component */
-	if(this->y_ind < min_c.y_ind)
-		min_c.y_ind = this->y_ind;
-	if(this->y_ind > max_c.y_ind)
-		max_c.y_ind = this->y_ind;
+	int x, y, z;
+
+	/* get the current indices of this corner */
+	x = this->x_ind();
+	y = this->y_ind();
+	z = this->z_ind();
 
-	/* update z-component */
-	if(this->z_ind < min_c.z_ind)
-		min_c.z_ind = this->z_ind;
-	if(this->z_ind > max_c.z_ind)
-		max_c.z_ind = this->z_ind;
+	/* update each component of the bounds */
+	min_c.set_indices(min(x, min_c.x_ind()), min(y, min_c.y_ind()),
+			min(z, min_c.z_ind()));
+	max_c.set_indices(max(x, max_c.x_ind()), max(y, max_c.y_ind()),
+			max(z, max_c.z_ind()));
 }
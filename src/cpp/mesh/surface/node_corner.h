@@ -186,34 +186,66 @@ namespace node_corner
 		private:
 
 			/**
-			 * The x-coordinate of this corner's index
+			 * The discretized position of this corner
 			 *
-			 * In order to unique represent a corner
+			 * In order to uniquely represent a corner
 			 * value, we store its discretized position
 			 * in units of half-resolutions of the tree.
+			 *
+			 * The x, y, and z indices are each offset by
+			 * CORNER_INDEX_BIAS and packed into one integer,
+			 * with x in the most significant bits.  This
+			 * means that comparing keys gives the same
+			 * ordering as comparing the indices one axis
+			 * at a time, but only takes one operation.
 			 */
-			int x_ind;
+			unsigned long long key;
+
+		/* functions */
+		public:
+
+			/*-----------*/
+			/* constants */
+			/*-----------*/
 
 			/**
-			 * The y-coordinate of this corner's index
-			 *
-			 * In order to unique represent a corner
-			 * value, we store its discretized position
-			 * in units of half-resolutions of the tree.
+			 * The number of bits used for each index
 			 */
-			int y_ind;
-			
+			static const unsigned int CORNER_INDEX_BITS = 21;
+
 			/**
-			 * The z-coordinate of this corner's index
+			 * The offset added to each index before packing
+			 */
+			static const int CORNER_INDEX_BIAS
+					= (1 << (CORNER_INDEX_BITS - 1));
+
+			/**
+			 * Checks if every corner of a tree can be stored
 			 *
-			 * In order to unique represent a corner
-			 * value, we store its discretized position
-			 * in units of half-resolutions of the tree.
+			 * Corners are indexed in half-resolutions from
+			 * the center of the tree's root, so each index
+			 * must be less than CORNER_INDEX_BIAS in
+			 * magnitude.  The root of a tree of depth d is
+			 * 2^d half-resolutions from its center to its
+			 * faces, so deeper trees would have corners that
+			 * wrap into the keys of other corners.
+			 *
+			 * @param tree   The tree to check
+			 *
+			 * @return   Returns true iff every corner of the
+			 *           tree can be stored.
 			 */
-			int z_ind;
+			static inline bool fits(const octree_t& tree)
+			{
+				/* an empty tree has no corners */
+				if(tree.get_root() == NULL)
+					return true;
 
-		/* functions */
-		public:
+				/* the root extends the farthest from
+				 * its center */
+				return (tree.get_max_depth()
+					< (int) (CORNER_INDEX_BITS - 1));
+			};
 
 			/*--------------*/
 			/* constructors */
@@ -222,8 +254,8 @@ namespace node_corner
 			/**
 			 * Constructs corner with invalid parameters
 			 */
-			corner_t() : x_ind(0), y_ind(0), z_ind(0)
-			{};
+			corner_t()
+			{ this->set_indices(0, 0, 0); };
 
 			/**
 			 * Constructs corner given another corner
@@ -231,9 +263,7 @@ namespace node_corner
 			 * @param other   The other corner to copy
 			 */
 			corner_t(const corner_t& other)
-				:	x_ind(other.x_ind), 
-					y_ind(other.y_ind),
-					z_ind(other.z_ind)
+				:	key(other.key)
 			{};
 
 			/**
@@ -345,9 +375,9 @@ namespace node_corner
 				p = (pos - center) / (0.5 * res);
 
 				/* get discretized coordinates */
-				this->x_ind = (int) round(p(0));
-				this->y_ind = (int) round(p(1));
-				this->z_ind = (int) round(p(2));
+				this->set_indices((int) round(p(0)),
+						(int) round(p(1)),
+						(int) round(p(2)));
 			};
 
 			/**
@@ -372,11 +402,66 @@ namespace node_corner
 				p(2) = 0.0;
 
 				/* get discretized coordinates */
-				this->x_ind = (int) round(p(0));
-				this->y_ind = (int) round(p(1));
-				this->z_ind = (int) round(p(2));
+				this->set_indices((int) round(p(0)),
+						(int) round(p(1)),
+						(int) round(p(2)));
 			};
 
+			/**
+			 * Sets the discretized indices of this corner
+			 *
+			 * Each index must be less than CORNER_INDEX_BIAS
+			 * in magnitude, which holds for every corner of
+			 * a tree for which fits() is true.
+			 *
+			 * @param x   The x-index, in half-resolutions
+			 * @param y   The y-index, in half-resolutions
+			 * @param z   The z-index, in half-resolutions
+			 */
+			inline void set_indices(int x, int y, int z)
+			{
+				this->key =
+					(((unsigned long long)
+					(x + CORNER_INDEX_BIAS))
+					<< (2*CORNER_INDEX_BITS))
+					| (((unsigned long long)
+					(y + CORNER_INDEX_BIAS))
+					<< CORNER_INDEX_BITS)
+					| ((unsigned long long)
+					(z + CORNER_INDEX_BIAS));
+			};
+
+			/*-----------*/
+			/* accessors */
+			/*-----------*/
+
+			/**
+			 * Returns the integer key of this corner
+			 *
+			 * Each corner has a unique key, which can be
+			 * used to index it in hash tables.
+			 */
+			inline unsigned long long get_key() const
+			{ return this->key; };
+
+			/**
+			 * Returns the x-index of this corner
+			 */
+			inline int x_ind() const
+			{ return this->get_index(2*CORNER_INDEX_BITS); };
+
+			/**
+			 * Returns the y-index of this corner
+			 */
+			inline int y_ind() const
+			{ return this->get_index(CORNER_INDEX_BITS); };
+
+			/**
+			 * Returns the z-index of this corner
+			 */
+			inline int z_ind() const
+			{ return this->get_index(0); };
+
 			/*----------*/
 			/* geometry */
 			/*----------*/
@@ -411,9 +496,9 @@ namespace node_corner
 			{
 				res *= 0.5;
 				pos = center;
-				pos(0) += this->x_ind * res;
-				pos(1) += this->y_ind * res;
-				pos(2) += this->z_ind * res;
+				pos(0) += this->x_ind() * res;
+				pos(1) += this->y_ind() * res;
+				pos(2) += this->z_ind() * res;
 			};
 
 			/**
@@ -464,9 +549,9 @@ namespace node_corner
 					const corner_t& other) const
 			{
 				size_t count = 0;
-				count += (this->x_ind != other.x_ind);
-				count += (this->y_ind != other.y_ind);
-				count += (this->z_ind != other.z_ind);
+				count += (this->x_ind() != other.x_ind());
+				count += (this->y_ind() != other.y_ind());
+				count += (this->z_ind() != other.z_ind());
 				return count;
 			};
 
@@ -483,10 +568,15 @@ namespace node_corner
 			 */
 			inline void increment_towards(const corner_t& goal)
 			{
+				int x, y, z;
+
 				/* modify each dimension */
-				this->x_ind += sgn(goal.x_ind-this->x_ind);
-				this->y_ind += sgn(goal.y_ind-this->y_ind);
-				this->z_ind += sgn(goal.z_ind-this->z_ind);
+				x = this->x_ind();
+				y = this->y_ind();
+				z = this->z_ind();
+				this->set_indices(x + sgn(goal.x_ind() - x),
+						y + sgn(goal.y_ind() - y),
+						z + sgn(goal.z_ind() - z));
 			};
 
 			/*-----------*/
@@ -503,9 +593,7 @@ namespace node_corner
 			inline corner_t& operator = (const corner_t& other)
 			{
 				/* copy the values */
-				this->x_ind = other.x_ind;
-				this->y_ind = other.y_ind;
-				this->z_ind = other.z_ind;
+				this->key = other.key;
 
 				/* return the result */
 				return (*this);
@@ -524,9 +612,7 @@ namespace node_corner
 			{
 				/* the corners are equal if their
 				 * discretized positions are equal */
-				return ( (this->x_ind == other.x_ind)
-					&& (this->y_ind == other.y_ind)
-					&& (this->z_ind == other.z_ind) );
+				return (this->key == other.key);
 			};
 
 			/**
@@ -541,9 +627,7 @@ namespace node_corner
 						const corner_t& other) const
 			{
 				/* equal only if their indices are equal */
-				return ( (this->x_ind != other.x_ind)
-					|| (this->y_ind != other.y_ind)
-					|| (this->z_ind != other.z_ind) );
+				return (this->key != other.key);
 			};
 
 			/**
@@ -559,16 +643,9 @@ namespace node_corner
 			 */
 			inline bool operator < (const corner_t& other) const
 			{
-				/* sort by each coordiante*/
-				if(this->x_ind < other.x_ind)
-					return true;
-				if(this->x_ind > other.x_ind)
-					return false;
-				if(this->y_ind < other.y_ind)
-					return true;
-				if(this->y_ind > other.y_ind)
-					return false;
-				return (this->z_ind < other.z_ind);
+				/* sort by each coordiante, which is
+				 * the same as sorting by key */
+				return (this->key < other.key);
 			};
 
 			/*-----------*/
@@ -604,14 +681,31 @@ namespace node_corner
 			 */
 			inline bool isbad() const
 			{ 
-				if(abs(this->x_ind) > 10000)
+				if(abs(this->x_ind()) > 10000)
 					return true;
-				if(abs(this->y_ind) > 10000)
+				if(abs(this->y_ind()) > 10000)
 					return true;
-				if(abs(this->z_ind) > 10000)
+				if(abs(this->z_ind()) > 10000)
 					return true;
 				return false;
 			};
+
+		/* helper functions */
+		private:
+
+			/**
+			 * Unpacks one of the indices from the key
+			 *
+			 * @param shift   The bit offset of the index
+			 *
+			 * @return   Returns the index, without its bias
+			 */
+			inline int get_index(unsigned int shift) const
+			{
+				return ((int) ((this->key >> shift)
+					& ((1ULL << CORNER_INDEX_BITS) - 1)))
+					- CORNER_INDEX_BIAS;
+			};
 	};			
 }
 
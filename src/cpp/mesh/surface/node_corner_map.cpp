@@ -2,8 +2,12 @@
 #include <geometry/octree/octnode.h>
 #include <geometry/octree/octtopo.h>
 #include <mesh/surface/node_boundary.h>
+#include <mesh/surface/node_boundary_stream.h>
 #include <mesh/surface/node_corner.h>
+#include <util/error_codes.h>
 #include <Eigen/Dense>
+#include <iostream>
+#include <vector>
 #include <set>
 #include <map>
 
@@ -23,6 +27,28 @@ using namespace std;
 using namespace Eigen;
 using namespace node_corner;
 
+/* the following constants are used for the hash table of corners */
+
+#define MIN_INDEX_BITS   4
+#define INDEX_MULTIPLIER 0x9E3779B97F4A7C15ULL
+#define EMPTY_INDEX_KEY  (~0ULL) /* never a valid corner key */
+
+/* the following helper functions are used in this file */
+
+/**
+ * Computes the hashed slot of a corner key
+ *
+ * @param key    The key of the corner to hash
+ * @param bits   The number of bits in the hash table size
+ *
+ * @return   Returns the first slot to probe for this key
+ */
+static inline size_t hash_corner_key(unsigned long long key,
+                                     unsigned int bits)
+{
+	return (size_t) ((key * INDEX_MULTIPLIER) >> (64 - bits));
+}
+
 /*----------------------------------------*/
 /* corner_info_t function implementations */
 /*----------------------------------------*/
@@ -70,7 +96,6 @@ void corner_info_t::writeobj_edges(std::ostream& os,
 
 void corner_map_t::add(const octree_t& tree, octnode_t* n)
 {
-	pair<ccmap_t::iterator, bool> ins;
 	corner_t corner;
 	size_t ci;
 
@@ -80,14 +105,10 @@ void corner_map_t::add(const octree_t& tree, octnode_t* n)
 		/* construct this corner */ 
 		corner.set(tree, n, ci);
 
-		/* add to this map */
-		ins = this->corners.insert(pair<corner_t, corner_info_t>(
-					corner, corner_info_t()));
-
-		/* Either the corner was just added, or it was already
-		 * present.  In either case, add this node to the info
-		 * for this corner. */
-		ins.first->second.add(n);
+		/* Either the corner is added to the map, or it was
+		 * already present.  In either case, add this node
+		 * to the info for this corner. */
+		this->insert(corner)->second.add(n);
 	}
 }
 
@@ -99,7 +120,6 @@ void corner_map_t::add_all(const octree_t& tree)
 			
 void corner_map_t::add(const octree_t& tree, const node_face_t& f)
 {
-	pair<ccmap_t::iterator, bool> ins;
 	corner_t corner;
 	size_t ci;
 
@@ -109,24 +129,19 @@ void corner_map_t::add(const octree_t& tree, const node_face_t& f)
 		/* construct this corner */ 
 		corner.set(tree, f, ci);
 
-		/* add to this map */
-		ins = this->corners.insert(pair<corner_t, corner_info_t>(
-					corner, corner_info_t()));
-
-		/* Either the corner was just added, or it was already
-		 * present.  In either case, add this face to the info
-		 * for this corner. */
-		ins.first->second.add(f);
+		/* Either the corner is added to the map, or it was
+		 * already present.  In either case, add this face
+		 * to the info for this corner. */
+		this->insert(corner)->second.add(f);
 	}
 }
 			
 void corner_map_t::add(const octree_t& tree, const node_face_t& f,
 					const node_face_info_t& neighs)
 {
-	pair<ccmap_t::iterator, bool> ins;
 	corner_t c;
 	corner_t min_c, max_c;
-	faceset_t::const_iterator fit;
+	facelist_t::const_iterator fit;
 	double hw;
 	size_t ci;
 
@@ -136,14 +151,10 @@ void corner_map_t::add(const octree_t& tree, const node_face_t& f,
 		/* construct this corner */ 
 		c.set(tree, f, ci);
 		
-		/* add to this map */
-		ins = this->corners.insert(pair<corner_t, 
-				corner_info_t>(c, corner_info_t()));
-
-		/* Either the corner was just added, or it was already
-		 * present.  In either case, add this face to the info
-		 * for this corner. */
-		ins.first->second.add(f);
+		/* Either the corner is added to the map, or it was
+		 * already present.  In either case, add this face
+		 * to the info for this corner. */
+		this->insert(c)->second.add(f);
 
 		/* record the min and max observed */
 		if(ci == 0)
@@ -180,10 +191,7 @@ void corner_map_t::add(const octree_t& tree, const node_face_t& f,
 				continue; /* don't care about this corner */
 				
 			/* add this face to the neighbor's corner */
-			ins = this->corners.insert(
-					pair<corner_t, corner_info_t>(
-					c, corner_info_t()));
-			ins.first->second.add(f);
+			this->insert(c)->second.add(f);
 		}
 	}
 }
@@ -198,6 +206,44 @@ void corner_map_t::add(const octree_t& tree,
 		this->add(tree, it->first, it->second); /* add it */
 }
 
+int corner_map_t::add(const octree_t& tree,
+			const node_boundary_stream_t& stream)
+{
+	node_boundary_reader_t reader;
+	node_face_info_t info;
+	vector<size_t> neighs;
+	node_face_t f;
+	size_t id;
+	int ret;
+
+	/* check that the corners of this tree can be stored */
+	if(!(corner_t::fits(tree)))
+	{
+		cerr << "[corner_map_t::add]\tTree is too large for "
+		     << "its resolution to index its corners" << endl;
+		return -1;
+	}
+
+	/* iterate through the faces in the stream */
+	ret = reader.open(stream);
+	if(ret)
+		return PROPEGATE_ERROR(-2, ret);
+	while(!(reader.eof()))
+	{
+		ret = reader.next(id, f, neighs);
+		if(ret)
+			return PROPEGATE_ERROR(-3, ret);
+		ret = stream.get_info(neighs, info);
+		if(ret)
+			return PROPEGATE_ERROR(-4, ret);
+		this->add(tree, f, info); /* add it */
+	}
+
+	/* success */
+	reader.close();
+	return 0;
+}
+
 int corner_map_t::populate_edges(const octree_t& tree)
 {
 	ccmap_t::iterator cit, eit, eit_best;
@@ -205,6 +251,16 @@ int corner_map_t::populate_edges(const octree_t& tree)
 	corner_t e;
 	size_t ci;
 
+	/* check that the corners of this tree can be stored, since
+	 * otherwise distinct corners may share a key */
+	if(!(corner_t::fits(tree)))
+	{
+		cerr << "[corner_map_t::populate_edges]\tTree is too "
+		     << "large for its resolution to index its corners"
+		     << endl;
+		return -1;
+	}
+
 	/* iterate over every corner stored in this map */
 	for(cit = this->corners.begin(); cit != this->corners.end(); cit++)
 	{
@@ -241,9 +297,9 @@ int corner_map_t::populate_edges(const octree_t& tree)
 				/* get this corner in our map.  Note, this
 				 * corner SHOULD be in our map, since the
 				 * face is in our map */
-				eit_best = this->corners.find(e);
+				eit_best = this->find(e);
 				if(eit_best == this->corners.end())
-					return -1;
+					return -2;
 
 				/* Check that they form minimal edges by 
 				 * iterating down the edge.  We can do 
@@ -262,7 +318,7 @@ int corner_map_t::populate_edges(const octree_t& tree)
 					e.increment_towards(cit->first))
 				{
 					/* check if e exists in this map */
-					eit = this->corners.find(e);
+					eit = this->find(e);
 					if(eit == this->corners.end())
 						continue;
 
@@ -294,7 +350,7 @@ pair<set<octnode_t*>::const_iterator, set<octnode_t*>::const_iterator>
 	ccmap_t::const_iterator it;
 
 	/* look up this corner */
-	it = this->corners.find(c);
+	it = this->find(c);
 	if(it == this->corners.end())
 		return p; /* corner is not in map */
 
@@ -313,7 +369,7 @@ pair<faceset_t::const_iterator, faceset_t::const_iterator>
 	ccmap_t::const_iterator it;
 
 	/* look up this corner */
-	it = this->corners.find(c);
+	it = this->find(c);
 	if(it == this->corners.end())
 		return p;
 
@@ -332,7 +388,7 @@ pair<cornerset_t::const_iterator, cornerset_t::const_iterator>
 	ccmap_t::const_iterator it;
 
 	/* look up this corner */
-	it = this->corners.find(c);
+	it = this->find(c);
 	if(it == this->corners.end())
 		return p;
 
@@ -368,7 +424,7 @@ void corner_map_t::writeobj_edges(std::ostream& os, const octree_t& tree,
 	Vector3d mypos;
 
 	/* find this corner */
-	cit = this->corners.find(c);
+	cit = this->find(c);
 	if(cit == this->corners.end())
 		return;
 		
@@ -378,6 +434,94 @@ void corner_map_t::writeobj_edges(std::ostream& os, const octree_t& tree,
 	/* export its edges */
 	cit->second.writeobj_edges(os, tree, mypos);
 }
+
+ccmap_t::iterator corner_map_t::insert(const corner_t& c)
+{
+	size_t slot;
+
+	/* keep the hash table at most half full */
+	if(2*(this->corners.size() + 1) > this->index_keys.size())
+		this->rebuild_index(this->corners.size() + 1);
+
+	/* check if this corner is already in the map */
+	slot = this->find_slot(c.get_key());
+	if(this->index_keys[slot] != EMPTY_INDEX_KEY)
+		return this->index_vals[slot];
+
+	/* add it to both the map and the hash table */
+	this->index_keys[slot] = c.get_key();
+	this->index_vals[slot] = this->corners.insert(
+			pair<corner_t, corner_info_t>(c,
+			corner_info_t())).first;
+	return this->index_vals[slot];
+}
+
+ccmap_t::iterator corner_map_t::find(const corner_t& c)
+{
+	size_t slot;
+
+	/* check for empty structure */
+	if(this->index_keys.empty())
+		return this->corners.end();
+
+	/* look up the corner in the hash table */
+	slot = this->find_slot(c.get_key());
+	if(this->index_keys[slot] == EMPTY_INDEX_KEY)
+		return this->corners.end();
+	return this->index_vals[slot];
+}
+
+ccmap_t::const_iterator corner_map_t::find(const corner_t& c) const
+{
+	size_t slot;
+
+	/* check for empty structure */
+	if(this->index_keys.empty())
+		return this->corners.end();
+
+	/* look up the corner in the hash table */
+	slot = this->find_slot(c.get_key());
+	if(this->index_keys[slot] == EMPTY_INDEX_KEY)
+		return this->corners.end();
+	return this->index_vals[slot];
+}
+
+size_t corner_map_t::find_slot(unsigned long long key) const
+{
+	size_t h, mask;
+
+	/* linearly probe from the hashed position */
+	mask = this->index_keys.size() - 1;
+	h = hash_corner_key(key, this->index_bits);
+	while(this->index_keys[h] != EMPTY_INDEX_KEY
+			&& this->index_keys[h] != key)
+		h = (h + 1) & mask;
+	return h;
+}
+
+void corner_map_t::rebuild_index(size_t n)
+{
+	ccmap_t::iterator it;
+	size_t slot;
+
+	/* size the table to be at most half full */
+	if(n < this->corners.size())
+		n = this->corners.size();
+	this->index_bits = MIN_INDEX_BITS;
+	while((((size_t) 1) << this->index_bits) < 2*n)
+		this->index_bits++;
+	this->index_keys.assign(((size_t) 1) << this->index_bits,
+			EMPTY_INDEX_KEY);
+	this->index_vals.resize(this->index_keys.size());
+
+	/* insert every corner of the map */
+	for(it = this->corners.begin(); it != this->corners.end(); it++)
+	{
+		slot = this->find_slot(it->first.get_key());
+		this->index_keys[slot] = it->first.get_key();
+		this->index_vals[slot] = it;
+	}
+}
 			
 void corner_map_t::add_all(const octree_t& tree, octnode_t* node)
 {
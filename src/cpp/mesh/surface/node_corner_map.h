@@ -16,8 +16,10 @@
 #include <geometry/octree/octnode.h>
 #include <geometry/octree/octtopo.h>
 #include <mesh/surface/node_boundary.h>
+#include <mesh/surface/node_boundary_stream.h>
 #include <mesh/surface/node_corner.h>
 #include <Eigen/Dense>
+#include <vector>
 #include <set>
 #include <map>
 
@@ -259,9 +261,57 @@ namespace node_corner
 			 */
 			ccmap_t corners;
 
+			/**
+			 * An open-addressed hash table of the corners
+			 *
+			 * The corners map is kept so that the corners
+			 * can be iterated in sorted order, but looking
+			 * them up by walking the map is slow.  This table
+			 * maps the integer key of each corner to its
+			 * position in the map, so that corners can be
+			 * found by probing a flat array instead.  Empty
+			 * slots have a key of EMPTY_INDEX_KEY.
+			 */
+			std::vector<unsigned long long> index_keys;
+			std::vector<ccmap_t::iterator> index_vals;
+			unsigned int index_bits;
+
 		/* functions */
 		public:
 
+			/*--------------*/
+			/* constructors */
+			/*--------------*/
+
+			/**
+			 * Constructs an empty map
+			 */
+			corner_map_t() : index_bits(0) {};
+
+			/**
+			 * Constructs a copy of the given map
+			 *
+			 * @param other   The map to copy
+			 */
+			corner_map_t(const corner_map_t& other)
+				: corners(other.corners), index_bits(0)
+			{ this->rebuild_index(); };
+
+			/**
+			 * Copies the given map into this one
+			 *
+			 * @param other   The map to copy
+			 *
+			 * @return   Returns the modified map
+			 */
+			inline corner_map_t& operator = (
+					const corner_map_t& other)
+			{
+				this->corners = other.corners;
+				this->rebuild_index();
+				return (*this);
+			};
+
 			/*-----------*/
 			/* modifiers */
 			/*-----------*/
@@ -270,7 +320,12 @@ namespace node_corner
 			 * Clears all info from this map
 			 */
 			inline void clear()
-			{ this->corners.clear(); };
+			{
+				this->corners.clear();
+				this->index_keys.clear();
+				this->index_vals.clear();
+				this->index_bits = 0;
+			};
 
 			/** 
 			 * Adds the given node to this map
@@ -337,6 +392,22 @@ namespace node_corner
 			void add(const octree_t& tree,
 					const node_boundary_t& boundary);
 
+			/**
+			 * Adds all faces in the given boundary stream
+			 *
+			 * Will read the faces from the spill file of
+			 * the given stream, adding each face to this
+			 * mapping.
+			 *
+			 * @param tree     The originating tree
+			 * @param stream   The streamed boundary faces
+			 *
+			 * @return    Returns zero on success, non-zero
+			 *            on failure.
+			 */
+			int add(const octree_t& tree,
+				const node_boundary_stream_t& stream);
+
 			/*------------*/
 			/* processing */
 			/*------------*/
@@ -477,6 +548,54 @@ namespace node_corner
 		/* helper functions */
 		private:
 
+			/**
+			 * Finds the given corner, inserting it if needed
+			 *
+			 * If the corner is not already in this map, it
+			 * will be added with an empty info struct.
+			 *
+			 * @param c   The corner to find
+			 *
+			 * @return    Returns the position of c in the map
+			 */
+			ccmap_t::iterator insert(const corner_t& c);
+
+			/**
+			 * Finds the given corner in this map
+			 *
+			 * @param c   The corner to find
+			 *
+			 * @return    Returns the position of c in the map,
+			 *            or corners.end() if c is not in
+			 *            the map.
+			 */
+			ccmap_t::iterator find(const corner_t& c);
+			ccmap_t::const_iterator find(const corner_t& c) const;
+
+			/**
+			 * Finds the slot of the hash table for a key
+			 *
+			 * The hash table must not be empty.
+			 *
+			 * @param key   The key of the corner to find
+			 *
+			 * @return      Returns the slot that holds the
+			 *              key, or the empty slot where it
+			 *              would be inserted.
+			 */
+			size_t find_slot(unsigned long long key) const;
+
+			/**
+			 * Repopulates the hash table from the corners map
+			 *
+			 * The table is resized so that it is at most half
+			 * full, and will be large enough to hold the given
+			 * number of corners.
+			 *
+			 * @param n   The minimum number of corners to fit
+			 */
+			void rebuild_index(size_t n=0);
+
 			/**
 			 * Recursively adds all leaf nodes under the
 			 * given node to this mapping.
@@ -32,6 +32,17 @@ using namespace Eigen;
 /* function implementations */
 /*--------------------------*/
 
+void planar_region_t::init(const node_face_t& seed)
+{
+	/* clear any existing information for this region */
+	this->clear();
+
+	/* prepare plane geometry based on seed face */
+	seed.get_center(this->plane.point);
+	octtopo::cube_face_normals(seed.direction, this->plane.normal);
+	this->add(seed);
+}
+
 void planar_region_t::floodfill(const node_face_t& seed,
 				const node_boundary_t& boundary,
 				faceset_t& blacklist)
@@ -45,8 +56,8 @@ void planar_region_t::floodfill(const node_face_t& seed,
 				faceset_t& blacklist, double planethresh)
 {
 	queue<node_face_t> to_check;
-	pair<faceset_t::const_iterator, faceset_t::const_iterator> range;
-	faceset_t::const_iterator it;
+	pair<facelist_t::const_iterator, facelist_t::const_iterator> range;
+	facelist_t::const_iterator it;
 
 	/* clear any existing information for this region */
 	this->clear();
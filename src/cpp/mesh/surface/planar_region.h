@@ -62,6 +62,17 @@ class planar_region_t
 		inline void clear()
 		{ this->faces.clear(); };
 
+		/**
+		 * Initializes this region to contain only the given face
+		 *
+		 * The plane geometry of this region will be set to
+		 * the geometry of the seed face.  Any information stored
+		 * in this planar region will be destroyed.
+		 *
+		 * @param seed   The seed face for this region
+		 */
+		void init(const node_face_t& seed);
+
 		/*------------*/
 		/* processing */
 		/*------------*/
@@ -2,15 +2,21 @@
 #include <geometry/octree/octdata.h>
 #include <geometry/octree/octtopo.h>
 #include <mesh/surface/node_boundary.h>
+#include <mesh/surface/node_boundary_stream.h>
 #include <mesh/surface/planar_region.h>
 #include <util/error_codes.h>
+#include <util/union_find.h>
 #include <util/progress_bar.h>
+#include <boost/threadpool.hpp>
+#include <boost/bind.hpp>
 #include <iostream>
 #include <fstream>
 #include <vector>
 #include <string>
 #include <queue>
 #include <map>
+#include <algorithm>
+#include <utility>
 #include <float.h>
 #include <Eigen/Dense>
 #include <Eigen/StdVector>
@@ -45,6 +51,52 @@ using namespace Eigen;
 #define DEFAULT_FIT_TO_ISOSURFACE   false
 #define APPROX_ZERO                 0.00001
 
+/* the number of regions or pairs processed by each parallel task */
+#define REGIONS_PER_TASK            256
+
+/* the precision of the space-filling curve used to form shards */
+#define SHARD_ORDER_BITS            10
+
+/* helper functions */
+
+/**
+ * Interleaves the bits of three integers into a Morton code
+ *
+ * @param x   The first coordinate, with SHARD_ORDER_BITS bits
+ * @param y   The second coordinate, with SHARD_ORDER_BITS bits
+ * @param z   The third coordinate, with SHARD_ORDER_BITS bits
+ *
+ * @return    Returns the interleaved code
+ */
+static unsigned long long morton_code(unsigned int x, unsigned int y,
+                                      unsigned int z)
+{
+	unsigned long long code;
+	unsigned int b;
+
+	code = 0;
+	for(b = 0; b < SHARD_ORDER_BITS; b++)
+		code |= ((unsigned long long) ((x >> b) & 1) << (3*b))
+			| ((unsigned long long) ((y >> b) & 1) << (3*b+1))
+			| ((unsigned long long) ((z >> b) & 1) << (3*b+2));
+	return code;
+}
+
+/**
+ * Compares regions by their position along a space-filling curve
+ *
+ * @param a   The first region, with its Morton code
+ * @param b   The second region, with its Morton code
+ *
+ * @return    Returns true iff a is before b along the curve
+ */
+static bool region_order_less(
+		const pair<unsigned long long, regionmap_t::iterator>& a,
+		const pair<unsigned long long, regionmap_t::iterator>& b)
+{
+	return (a.first < b.first);
+}
+
 /*--------------------------*/
 /* function implementations */
 /*--------------------------*/
@@ -55,6 +107,7 @@ planar_region_graph_t::planar_region_graph_t()
 			DEFAULT_DISTANCE_THRESHOLD,
 			DEFAULT_FIT_TO_ISOSURFACE,
 			COALESCE_WITH_L_INF_NORM);
+	this->init_sharding(0, 0);
 }
 
 void planar_region_graph_t::init(double planethresh, double distthresh,
@@ -65,6 +118,13 @@ void planar_region_graph_t::init(double planethresh, double distthresh,
 	this->fit_to_isosurface   = fitiso;
 	this->strategy            = strat;
 }
+
+void planar_region_graph_t::init_sharding(size_t shardsize,
+                                          unsigned int numthreads)
+{
+	this->shard_size  = shardsize;
+	this->num_threads = numthreads;
+}
 	
 regionmap_t::const_iterator planar_region_graph_t::lookup_face(
 					const node_face_t& f) const
@@ -83,8 +143,9 @@ regionmap_t::const_iterator planar_region_graph_t::lookup_face(
 int planar_region_graph_t::populate(const node_boundary_t& boundary)
 {
 	facemap_t::const_iterator it;
-	faceset_t::const_iterator fit, nit;
-	pair<faceset_t::const_iterator, faceset_t::const_iterator> neighs;
+	faceset_t::const_iterator fit;
+	facelist_t::const_iterator nit;
+	pair<facelist_t::const_iterator, facelist_t::const_iterator> neighs;
 	seedmap_t::const_iterator neigh_seed;
 	regionmap_t::iterator rit;
 	set<node_face_t> blacklist;
@@ -179,158 +240,207 @@ int planar_region_graph_t::populate(const node_boundary_t& boundary)
 	return 0;
 }
 		
-int planar_region_graph_t::coalesce_regions()
+int planar_region_graph_t::populate(const node_boundary_stream_t& stream)
 {
-	priority_queue<planar_region_pair_t> pq;
-	regionmap_t::iterator rit, sit;
-	faceset_t::iterator fit;
-	planar_region_pair_t pair, old_pair;
-	progress_bar_t progbar;
-	size_t num_faces, i, pq_size, original_num_regions;
+	node_boundary_reader_t reader;
+	union_find_t components;
+	vector<vector<size_t> > unions;
+	vector<unsigned char> directions;
+	vector<size_t> region_of, neighs;
+	vector<regionmap_t::iterator> union_regions;
+	vector<node_face_t> union_seeds;
+	pair<regionmap_t::iterator, bool> ins;
+	regionmap_t::iterator rit;
+	node_face_t face;
+	size_t i, j, n, id;
 	int ret;
 
-	/* prepare progress bar */
-	progbar.set_name("Coalescing");
-	progbar.set_color(progress_bar_t::BLUE);
-
-	/* create a queue with all possible region merges */
-	i = 0;
-	for(rit = this->regions.begin(); rit != this->regions.end(); rit++)
+	/* the regions are the same as would be formed by flood fill:
+	 * the connected components of linked faces that have the
+	 * same direction and meet the planarity threshold.  Faces
+	 * that don't meet the threshold are in regions by themselves.
+	 *
+	 * First, record the direction of each face that may be
+	 * joined with its neighbors. */
+	n = stream.size();
+	directions.resize(n, octtopo::NUM_FACES_PER_CUBE);
+	ret = reader.open(stream);
+	if(ret)
+		return PROPEGATE_ERROR(-1, ret);
+	while(!(reader.eof()))
 	{
-		/* update user on status */
-		progbar.update(i++, this->regions.size());
-
-		/* iterate through the neighbors of this region to
-		 * get pairs of regions */
-		for(fit = rit->second.neighbor_seeds.begin();
-				fit != rit->second.neighbor_seeds.end(); 
-					fit++)
-		{
-			/* to prevent duplication, only add a pair if the
-			 * neighbor's seed is greater than the current
-			 * region seed (since all linkages are 
-			 * bidirectional, not doing this would result in
-			 * twice as many pairs as needed). */
-			if(*fit < rit->first)
-				continue;
+		ret = reader.next(id, face, neighs);
+		if(ret)
+			return PROPEGATE_ERROR(-2, ret);
+		if(face.get_planarity() >= this->planarity_threshold)
+			directions[id] = (unsigned char) face.direction;
+	}
 
-			/* generate the pairing of neighboring regions */
-			pair.first = rit->first; /* this region */
-			pair.second = *fit; /* the neighboring region */
-			ret = this->compute_planefit(pair);
-			if(ret)
-				return PROPEGATE_ERROR(-1, ret);
+	/* find the connected components of the faces */
+	components.init(n);
+	ret = reader.open(stream);
+	if(ret)
+		return PROPEGATE_ERROR(-3, ret);
+	while(!(reader.eof()))
+	{
+		ret = reader.next(id, face, neighs);
+		if(ret)
+			return PROPEGATE_ERROR(-4, ret);
+		if(directions[id] == octtopo::NUM_FACES_PER_CUBE)
+			continue; /* in a region by itself */
+		for(i = 0; i < neighs.size(); i++)
+			if(directions[neighs[i]] == directions[id])
+			{
+				ret = components.add_edge(id, neighs[i]);
+				if(ret)
+					return PROPEGATE_ERROR(-5, ret);
+			}
+	}
+	directions.clear();
 
-			/* add this pair to the queue */
-			pq.push(pair);
-		}
+	/* label each face by its component */
+	components.get_unions(unions);
+	region_of.resize(n);
+	for(i = 0; i < unions.size(); i++)
+	{
+		for(j = 0; j < unions[i].size(); j++)
+			region_of[unions[i][j]] = i;
+		vector<size_t>().swap(unions[i]);
 	}
 
-	/* redo progress bar for next stage */
-	progbar.clear();
-	pq_size = 0;
-	original_num_regions = this->regions.size();
+	/* the seed of each region is its least face, which is
+	 * the face that populate() would have started its flood
+	 * fill from when iterating over a node_boundary_t */
+	union_seeds.resize(unions.size());
+	ret = reader.open(stream);
+	if(ret)
+		return PROPEGATE_ERROR(-6, ret);
+	while(!(reader.eof()))
+	{
+		ret = reader.next(id, face, neighs);
+		if(ret)
+			return PROPEGATE_ERROR(-7, ret);
+		if(union_seeds[region_of[id]].interior == NULL
+				|| face < union_seeds[region_of[id]])
+			union_seeds[region_of[id]] = face;
+	}
 
-	/* cycle through queue, get next region to merge */
-	while(!pq.empty())
+	/* create a region for each component */
+	union_regions.resize(unions.size());
+	for(i = 0; i < unions.size(); i++)
 	{
-		/* get next pair to check */
-		pair = pq.top();
-		pq.pop();
+		ins = this->regions.insert(pair<node_face_t,
+				planar_region_info_t>(union_seeds[i],
+				planar_region_info_t()));
+		if(!(ins.second))
+			return -8; /* seed is in two regions */
+		ins.first->second.region.init(union_seeds[i]);
+		union_regions[i] = ins.first;
+	}
+	union_seeds.clear();
+
+	/* add each face to its region, and record which regions
+	 * neighbor each other */
+	ret = reader.open(stream);
+	if(ret)
+		return PROPEGATE_ERROR(-9, ret);
+	while(!(reader.eof()))
+	{
+		ret = reader.next(id, face, neighs);
+		if(ret)
+			return PROPEGATE_ERROR(-10, ret);
+		rit = union_regions[region_of[id]];
+		rit->second.region.add(face);
+		this->seeds[face] = rit->first;
+		for(i = 0; i < neighs.size(); i++)
+			if(region_of[neighs[i]] != region_of[id])
+				rit->second.neighbor_seeds.insert(
+					union_regions[region_of[
+					neighs[i]]]->first);
+	}
+	reader.close();
 
-		/* update user on status */
-		if(pq_size < pq.size())
-			/* queue is growing */
-			progbar.set_color(progress_bar_t::RED);
-		else if(pq_size == pq.size())
-			/* queue remains the same size */
-			progbar.set_color(progress_bar_t::YELLOW);
-		else
-			/* queue is shrinking */
-			progbar.set_color(progress_bar_t::GREEN);
-		pq_size = pq.size();
-		progbar.update(original_num_regions - this->regions.size(),
-				original_num_regions);
+	/* ensure the normal is oriented for each region */
+	for(rit = this->regions.begin(); rit != this->regions.end(); rit++)
+		rit->second.region.orient_normal();
 
-		/* check if distance thresholds met.  if not, quit */
-		if(pair.err > this->distance_threshold)
-			break; /* all remaining pairs won't pass either */
+	/* success */
+	return 0;
+}
 		
-		/* check for duplicate pairs in the queue -- only need
-		 * to process each one once */
-		if(pair.equivalent_to(old_pair))
-			continue;
-		old_pair = pair; /* duplicates will always be adjacent */
-
-		/* get info for the two regions involved */
-		rit = this->regions.find(pair.first);
-		sit = this->regions.find(pair.second);
+int planar_region_graph_t::coalesce_regions()
+{
+	vector<priority_queue<planar_region_pair_t> > shard_pqs;
+	priority_queue<planar_region_pair_t> pq;
+	vector<planar_region_pair_t> pairs;
+	vector<int> rets;
+	regionmap_t::iterator rit, sit;
+	size_t i, num_shards, nt;
+	int ret;
 
-		/* check if regions still exist */
-		if(rit == this->regions.end() || sit == this->regions.end())
-			continue; /* not valid pair anymore */
-		
-		/* check if planarity threshold met.  If not, then
-		 * abort this merge */
-		if((rit->second.get_planarity() < this->planarity_threshold)
-			|| (sit->second.get_planarity() 
-				< this->planarity_threshold))
+	/* if sharding, then coalesce within each shard first, since
+	 * shards can be processed in parallel */
+	if(this->shard_size > 0)
+	{
+		/* compute the initial merges, and sort them by shard */
+		ret = this->fit_all_pairs(pairs);
+		if(ret)
+			return PROPEGATE_ERROR(-1, ret);
+		num_shards = this->assign_shards();
+		shard_pqs.resize(num_shards);
+		for(i = 0; i < pairs.size(); i++)
 		{
-			/* one or both of the input planes don't meet
-			 * the planarity threshold, which indicates that
-			 * the geometry described by these planes may not
-			 * be well-represented by a plane, so they shouldn't
-			 * be merged. */
-			continue;
+			/* only keep pairs within a shard that
+			 * could be merged */
+			if(pairs[i].err > this->distance_threshold)
+				continue;
+			rit = this->regions.find(pairs[i].first);
+			sit = this->regions.find(pairs[i].second);
+			if(rit->second.shard == sit->second.shard)
+				shard_pqs[rit->second.shard].push(pairs[i]);
 		}
-
-		/* use checksum to see if we need to recalc plane */
-		num_faces = rit->second.region.num_faces()
-				+ sit->second.region.num_faces();
-		if(num_faces != pair.num_faces)
+		vector<planar_region_pair_t>().swap(pairs);
+
+		/* coalesce each shard in parallel.  The pool waits
+		 * for all tasks when it goes out of scope */
+		rets.resize(num_shards, 0);
+		nt = this->num_threads;
+		if(nt == 0)
+			nt = boost::thread::hardware_concurrency();
 		{
-			/* regions have been modified, compute
-			 * fitting planes the pair */
-			ret = this->compute_planefit(pair);
-			if(ret)
-				return PROPEGATE_ERROR(-2, ret);
-	
-			/* since we had to recompute the plane information,
-			 * this pair may not actually be as low-cost as
-			 * we thought.  We should reinsert it into the
-			 * queue to see if it is still on top */
-			if(pair.err <= this->distance_threshold)
-				pq.push(pair);
-			continue;
+			boost::threadpool::pool tp((nt == 0) ? 1 : nt);
+			for(i = 0; i < num_shards; i++)
+				tp.schedule(boost::bind(
+					&planar_region_graph_t::coalesce_shard,
+					this, &(shard_pqs[i]), i,
+					&(rets[i])));
 		}
+		for(i = 0; i < num_shards; i++)
+			if(rets[i])
+				return PROPEGATE_ERROR(-2, rets[i]);
 
-		/* merge the regions */
-		ret = this->merge_regions(pair);
-		if(ret)
-			return PROPEGATE_ERROR(-3, ret);
-		
-		/* Insert new neighbor merges into the queue.
-		 *
-		 * Note that the second region in our pair no
-		 * longer exists, so just insert neighbor-pairs
-		 * of the first region. */
-		for(fit = rit->second.neighbor_seeds.begin();
-				fit != rit->second.neighbor_seeds.end(); 
-					fit++)
-		{
-			/* generate the pairing of neighboring regions */
-			pair.first = rit->first; /* this region */
-			pair.second = *fit; /* the neighboring region */
-			ret = this->compute_planefit(pair);
-			if(ret)
-				return PROPEGATE_ERROR(-4, ret);
-
-			/* add this pair to the queue */
-			if(pair.err <= this->distance_threshold)
-				pq.push(pair);
-		}
+		/* update the links between shards */
+		this->reconcile_shards();
 	}
 
+	/* create a queue with all possible region merges, which
+	 * are computed in parallel.  Without shards, every pair is
+	 * queued, as it always has been, so that ties between pairs
+	 * are broken the same way */
+	ret = this->fit_all_pairs(pairs);
+	if(ret)
+		return PROPEGATE_ERROR(-3, ret);
+	for(i = 0; i < pairs.size(); i++)
+		if(this->shard_size == 0
+				|| pairs[i].err <= this->distance_threshold)
+			pq.push(pairs[i]);
+	vector<planar_region_pair_t>().swap(pairs);
+
+	/* merge regions across the whole graph */
+	ret = this->coalesce_queue(pq, 0, false);
+	if(ret)
+		return PROPEGATE_ERROR(-4, ret);
+
 	/* success */
 	return 0;
 }
@@ -399,11 +509,11 @@ void planar_region_graph_t::writeobj_linkages(ostream& os) const
 /* helper functions */
 /*------------------*/
 
-int planar_region_graph_t::compute_planefit(planar_region_pair_t& pair)
+int planar_region_graph_t::fit_pair(planar_region_pair_t& pair) const
 {
 	std::vector<Eigen::Vector3d, 
 			Eigen::aligned_allocator<Eigen::Vector3d> > centers;
-	regionmap_t::iterator fit, sit;
+	regionmap_t::const_iterator fit, sit;
 	size_t i, nf;
 	double d, v;
 
@@ -412,30 +522,19 @@ int planar_region_graph_t::compute_planefit(planar_region_pair_t& pair)
 	if(fit == this->regions.end())
 		return -1;
 	sit = this->regions.find(pair.second);
-	if(fit == this->regions.end())
+	if(sit == this->regions.end())
 		return -2;
 
-	/* get the center points for each face in each of the regions.
-	 *
-	 * We only need to compute them if they are not already cached */
-	if(fit->second.centers.size() != fit->second.region.num_faces())
-	{
-		/* get face center positions for first region */
-		fit->second.centers.clear();
-		fit->second.variances.clear();
-		fit->second.region.find_face_centers(fit->second.centers,
-					fit->second.variances,
-					this->fit_to_isosurface);	
-	}
-	if(sit->second.centers.size() != sit->second.region.num_faces() )
-	{
-		/* get face center positions for second region */
-		sit->second.centers.clear();
-		sit->second.variances.clear();
-		sit->second.region.find_face_centers(sit->second.centers,
-					sit->second.variances,
-					this->fit_to_isosurface);	
-	}
+	/* the center points for each face in each of the regions
+	 * should already be cached */
+	if(fit->second.centers.size() != fit->second.region.num_faces()
+			|| sit->second.centers.size()
+			!= sit->second.region.num_faces())
+		return -3;
+
+	/* record which versions of the regions are used */
+	pair.first_version = fit->second.version;
+	pair.second_version = sit->second.version;
 
 	/* perform PCA on these points */
 	centers.insert(centers.end(), fit->second.centers.begin(),
@@ -443,12 +542,7 @@ int planar_region_graph_t::compute_planefit(planar_region_pair_t& pair)
 	centers.insert(centers.end(), sit->second.centers.begin(),
 				sit->second.centers.end());
 	pair.plane.fit(centers);
-	
-	/* verify the checksum */
 	pair.num_faces = centers.size();
-	if(pair.num_faces != fit->second.region.num_faces() 
-				+ sit->second.region.num_faces())
-		return -3;
 
 	/* determine the error by iterating over the points */
 	pair.err = 0;
@@ -499,7 +593,370 @@ int planar_region_graph_t::compute_planefit(planar_region_pair_t& pair)
 	return 0;
 }
 		
-int planar_region_graph_t::merge_regions(const planar_region_pair_t& pair)
+void planar_region_graph_t::cache_region(planar_region_info_t& info) const
+{
+	/* only need to compute the centers if not already cached */
+	if(info.centers.size() != info.region.num_faces())
+	{
+		info.centers.clear();
+		info.variances.clear();
+		info.region.find_face_centers(info.centers, info.variances,
+					this->fit_to_isosurface);
+	}
+
+	/* cache the planarity as well */
+	info.get_planarity();
+}
+		
+void planar_region_graph_t::cache_regions(
+			const vector<regionmap_t::iterator>* regs,
+			size_t begin, size_t end) const
+{
+	size_t i;
+
+	for(i = begin; i < end; i++)
+		this->cache_region((*regs)[i]->second);
+}
+		
+void planar_region_graph_t::fit_pairs(vector<planar_region_pair_t>* pairs,
+                                      size_t begin, size_t end,
+                                      int* ret) const
+{
+	size_t i;
+
+	/* fit each pair, stopping on the first error */
+	*ret = 0;
+	for(i = begin; i < end && *ret == 0; i++)
+		*ret = this->fit_pair((*pairs)[i]);
+}
+		
+int planar_region_graph_t::fit_all_pairs(vector<planar_region_pair_t>& pairs)
+{
+	vector<regionmap_t::iterator> regs;
+	regionmap_t::iterator rit;
+	faceset_t::iterator fit;
+	vector<int> rets;
+	size_t i, n, nt;
+
+	/* determine number of threads to use */
+	nt = this->num_threads;
+	if(nt == 0)
+		nt = boost::thread::hardware_concurrency();
+	if(nt == 0)
+		nt = 1;
+
+	/* list the regions, and all pairs of neighboring regions.
+	 *
+	 * To prevent duplication, only add a pair if the neighbor's
+	 * seed is greater than the current region seed (since all
+	 * linkages are bidirectional, not doing this would result in
+	 * twice as many pairs as needed). */
+	pairs.clear();
+	for(rit = this->regions.begin(); rit != this->regions.end(); rit++)
+	{
+		regs.push_back(rit);
+		for(fit = rit->second.neighbor_seeds.begin();
+				fit != rit->second.neighbor_seeds.end(); 
+					fit++)
+		{
+			if(*fit < rit->first)
+				continue;
+			pairs.push_back(planar_region_pair_t());
+			pairs.back().first = rit->first; /* this region */
+			pairs.back().second = *fit; /* the neighbor */
+		}
+	}
+
+	/* cache the statistics of each region, and then fit each
+	 * pair.  Each task only modifies its own elements, so the
+	 * results do not depend on the number of threads */
+	n = regs.size();
+	{
+		boost::threadpool::pool tp(nt);
+		for(i = 0; i < n; i += REGIONS_PER_TASK)
+			tp.schedule(boost::bind(
+				&planar_region_graph_t::cache_regions, this,
+				&regs, i, min(n, i + REGIONS_PER_TASK)));
+	}
+	n = pairs.size();
+	rets.resize(n / REGIONS_PER_TASK + 1, 0);
+	{
+		boost::threadpool::pool tp(nt);
+		for(i = 0; i < n; i += REGIONS_PER_TASK)
+			tp.schedule(boost::bind(
+				&planar_region_graph_t::fit_pairs, this,
+				&pairs, i, min(n, i + REGIONS_PER_TASK),
+				&(rets[i / REGIONS_PER_TASK])));
+	}
+	for(i = 0; i < rets.size(); i++)
+		if(rets[i])
+			return PROPEGATE_ERROR(-1, rets[i]);
+
+	/* success */
+	return 0;
+}
+		
+size_t planar_region_graph_t::assign_shards()
+{
+	vector<pair<unsigned long long, regionmap_t::iterator> > order;
+	vector<Vector3d, aligned_allocator<Vector3d> > pos;
+	regionmap_t::iterator rit;
+	Vector3d lo, hi, scale, q;
+	size_t i, j;
+
+	/* find the mean position of each region, which have all
+	 * been cached by fit_all_pairs() */
+	for(rit = this->regions.begin(); rit != this->regions.end(); rit++)
+	{
+		q = Vector3d::Zero();
+		for(j = 0; j < rit->second.centers.size(); j++)
+			q += rit->second.centers[j];
+		if(!(rit->second.centers.empty()))
+			q /= rit->second.centers.size();
+		pos.push_back(q);
+		order.push_back(make_pair(0ULL, rit));
+	}
+	if(pos.empty())
+		return 0;
+
+	/* quantize positions within the bounds of all regions */
+	lo = hi = pos[0];
+	for(i = 1; i < pos.size(); i++)
+	{
+		lo = lo.cwiseMin(pos[i]);
+		hi = hi.cwiseMax(pos[i]);
+	}
+	for(i = 0; i < 3; i++)
+		scale(i) = (hi(i) - lo(i) > APPROX_ZERO)
+			? (((1 << SHARD_ORDER_BITS) - 1) / (hi(i) - lo(i)))
+			: 0;
+	for(i = 0; i < pos.size(); i++)
+	{
+		q = (pos[i] - lo).cwiseProduct(scale);
+		order[i].first = morton_code((unsigned int) q(0),
+				(unsigned int) q(1), (unsigned int) q(2));
+	}
+
+	/* sort regions along the curve, keeping the ordering of
+	 * the map to break ties, and cut into shards */
+	stable_sort(order.begin(), order.end(), region_order_less);
+	for(i = 0; i < order.size(); i++)
+		order[i].second->second.shard = i / this->shard_size;
+	return (order.size() + this->shard_size - 1) / this->shard_size;
+}
+		
+void planar_region_graph_t::reconcile_shards()
+{
+	regionmap_t::iterator rit, dit;
+	faceset_t::iterator fit;
+	faceset_t neighs;
+	seedmap_t::iterator sit;
+
+	/* the seed of every face has been kept up to date, so the
+	 * region that each neighbor was merged into can be found by
+	 * looking up that neighbor's seed face */
+	for(rit = this->regions.begin(); rit != this->regions.end(); rit++)
+	{
+		if(rit->second.merged)
+			continue;
+		neighs.clear();
+		for(fit = rit->second.neighbor_seeds.begin();
+				fit != rit->second.neighbor_seeds.end();
+					fit++)
+		{
+			sit = this->seeds.find(*fit);
+			if(sit != this->seeds.end()
+					&& sit->second != rit->first)
+				neighs.insert(sit->second);
+		}
+		rit->second.neighbor_seeds.swap(neighs);
+	}
+
+	/* remove the regions that were merged */
+	rit = this->regions.begin();
+	while(rit != this->regions.end())
+	{
+		dit = rit++;
+		if(dit->second.merged)
+			this->regions.erase(dit);
+	}
+}
+		
+int planar_region_graph_t::coalesce_queue(
+			priority_queue<planar_region_pair_t>& pq,
+			size_t shard, bool sharded)
+{
+	regionmap_t::iterator rit, sit, nit;
+	faceset_t::iterator fit;
+	planar_region_pair_t pair, old_pair;
+	progress_bar_t progbar;
+	size_t num_faces, pq_size, original_num_regions;
+	bool lazy;
+	int ret;
+
+	/* out-of-date pairs are discarded by version only when
+	 * coalescing with shards.  Otherwise, they are refit and
+	 * requeued as they always have been, so the regions are the
+	 * same as before sharding was added. */
+	lazy = (this->shard_size > 0);
+
+	/* prepare progress bar, which is only shown when coalescing
+	 * the whole graph */
+	progbar.set_name("Coalescing");
+	pq_size = 0;
+	original_num_regions = this->regions.size();
+
+	/* cycle through queue, get next region to merge */
+	while(!pq.empty())
+	{
+		/* get next pair to check */
+		pair = pq.top();
+		pq.pop();
+
+		/* update user on status */
+		if(!sharded)
+		{
+			if(pq_size < pq.size())
+				/* queue is growing */
+				progbar.set_color(progress_bar_t::RED);
+			else if(pq_size == pq.size())
+				/* queue remains the same size */
+				progbar.set_color(progress_bar_t::YELLOW);
+			else
+				/* queue is shrinking */
+				progbar.set_color(progress_bar_t::GREEN);
+			pq_size = pq.size();
+			progbar.update(original_num_regions
+					- this->regions.size(),
+					original_num_regions);
+		}
+
+		/* check if distance thresholds met.  if not, quit */
+		if(pair.err > this->distance_threshold)
+			break; /* all remaining pairs won't pass either */
+
+		/* check for duplicate pairs in the queue -- only need
+		 * to process each one once */
+		if(!lazy)
+		{
+			if(pair.equivalent_to(old_pair))
+				continue;
+			old_pair = pair; /* duplicates are always adjacent */
+		}
+
+		/* get info for the two regions involved */
+		rit = this->regions.find(pair.first);
+		sit = this->regions.find(pair.second);
+
+		/* check if regions still exist */
+		if(rit == this->regions.end() || sit == this->regions.end()
+				|| rit->second.merged || sit->second.merged)
+			continue; /* not valid pair anymore */
+
+		/* check if either region has changed since this pair
+		 * was computed.  If so, a fresh pair was added to the
+		 * queue when it changed, so this one can be ignored */
+		if(lazy && (rit->second.version != pair.first_version
+				|| sit->second.version
+				!= pair.second_version))
+			continue;
+		
+		/* check if planarity threshold met.  If not, then
+		 * abort this merge */
+		if((rit->second.compute_planarity() 
+				< this->planarity_threshold)
+			|| (sit->second.compute_planarity() 
+				< this->planarity_threshold))
+		{
+			/* one or both of the input planes don't meet
+			 * the planarity threshold, which indicates that
+			 * the geometry described by these planes may not
+			 * be well-represented by a plane, so they shouldn't
+			 * be merged. */
+			continue;
+		}
+
+		/* use checksum to see if we need to recalc plane */
+		num_faces = rit->second.region.num_faces()
+				+ sit->second.region.num_faces();
+		if(!lazy && num_faces != pair.num_faces)
+		{
+			/* regions have been modified, compute
+			 * fitting planes the pair */
+			ret = this->fit_pair(pair);
+			if(ret)
+			{
+				progbar.clear();
+				return PROPEGATE_ERROR(-1, ret);
+			}
+	
+			/* since we had to recompute the plane information,
+			 * this pair may not actually be as low-cost as
+			 * we thought.  We should reinsert it into the
+			 * queue to see if it is still on top */
+			if(pair.err <= this->distance_threshold)
+				pq.push(pair);
+			continue;
+		}
+
+		/* merge the regions */
+		ret = this->merge_regions(pair, sharded);
+		if(ret)
+		{
+			progbar.clear();
+			return PROPEGATE_ERROR(-2, ret);
+		}
+		
+		/* Insert new neighbor merges into the queue.
+		 *
+		 * Note that the second region in our pair no
+		 * longer exists, so just insert neighbor-pairs
+		 * of the first region. */
+		for(fit = rit->second.neighbor_seeds.begin();
+				fit != rit->second.neighbor_seeds.end(); 
+					fit++)
+		{
+			/* when sharded, only neighbors in the same
+			 * shard can be merged */
+			if(sharded)
+			{
+				nit = this->regions.find(*fit);
+				if(nit == this->regions.end()
+						|| nit->second.shard != shard)
+					continue;
+			}
+
+			/* generate the pairing of neighboring regions */
+			pair.first = rit->first; /* this region */
+			pair.second = *fit; /* the neighboring region */
+			ret = this->fit_pair(pair);
+			if(ret)
+			{
+				progbar.clear();
+				return PROPEGATE_ERROR(-3, ret);
+			}
+
+			/* add this pair to the queue */
+			if(pair.err <= this->distance_threshold)
+				pq.push(pair);
+		}
+	}
+
+	/* success */
+	if(!sharded)
+		progbar.clear();
+	return 0;
+}
+		
+void planar_region_graph_t::coalesce_shard(
+			priority_queue<planar_region_pair_t>* pq,
+			size_t shard, int* ret)
+{
+	*ret = this->coalesce_queue(*pq, shard, true);
+}
+		
+int planar_region_graph_t::merge_regions(const planar_region_pair_t& pair,
+                                         bool sharded)
 {
 	regionmap_t::iterator fit, sit, neighinfo;
 	faceset_t::iterator faceit, nit;
@@ -519,8 +976,10 @@ int planar_region_graph_t::merge_regions(const planar_region_pair_t& pair)
 		/* add this face to the first region's set */
 		fit->second.region.add(*faceit);
 
-		/* update seed information for this face to first region */
-		this->seeds[*faceit] = fit->first; /* now in first region */
+		/* update seed information for this face to first region.
+		 * The face is already in the map, so it is updated
+		 * in place, which allows shards to do this concurrently */
+		this->seeds.find(*faceit)->second = fit->first;
 	}
 	
 	/* verify that checksum matches */
@@ -538,13 +997,16 @@ int planar_region_graph_t::merge_regions(const planar_region_pair_t& pair)
 
 		/* perform following only if neighbor isn't first region */
 		if(*nit != fit->first)
-		{
-			/* add this neighbor to the first region */
 			fit->second.neighbor_seeds.insert(*nit);
 
-			/* add first region as neighbor of this neighbor */
+		/* neighbors in other shards are updated after all
+		 * shards are coalesced */
+		if(sharded && neighinfo->second.shard != fit->second.shard)
+			continue;
+		
+		/* add first region as neighbor of this neighbor */
+		if(*nit != fit->first)
 			neighinfo->second.neighbor_seeds.insert(fit->first);
-		}
 		
 		/* remove second region as a neighbor of this neighbor */
 		neighinfo->second.neighbor_seeds.erase(sit->first);
@@ -557,15 +1019,24 @@ int planar_region_graph_t::merge_regions(const planar_region_pair_t& pair)
 	fit->second.variances.insert(fit->second.variances.end(),
 			sit->second.variances.begin(),
 			sit->second.variances.end());
-	fit->second.planarity = min(fit->second.get_planarity(), 
-					sit->second.get_planarity());
+	fit->second.planarity = min(fit->second.compute_planarity(), 
+					sit->second.compute_planarity());
+	fit->second.version++;
 
 	/* update region's plane information */
 	fit->second.region.set_plane(pair.plane);
 	fit->second.region.orient_normal(); /* normal points inwards */
 
-	/* remove second region from this graph */
-	this->regions.erase(sit);
+	/* remove second region from this graph.  If sharded, then
+	 * other shards may be looking up regions, so the map
+	 * can't be modified until all shards are done */
+	if(sharded)
+	{
+		sit->second.merged = true;
+		sit->second.neighbor_seeds.clear();
+	}
+	else
+		this->regions.erase(sit);
 
 	/* success */
 	return 0;
@@ -581,6 +1052,9 @@ planar_region_info_t::planar_region_info_t(const node_face_t& f,
 {
 	/* initialize planarity value to be not-yet-computed */
 	this->planarity = -1;
+	this->version = 0;
+	this->shard = 0;
+	this->merged = false;
 
 	/* initialize the region based on floodfill of this face */
 	this->region.floodfill(f, boundary, blacklist, planethresh);
@@ -22,10 +22,12 @@
 
 #include <geometry/shapes/plane.h>
 #include <mesh/surface/node_boundary.h>
+#include <mesh/surface/node_boundary_stream.h>
 #include <mesh/surface/planar_region.h>
 #include <iostream>
 #include <vector>
 #include <string>
+#include <queue>
 #include <map>
 #include <float.h>
 #include <Eigen/Dense>
@@ -97,6 +99,25 @@ class planar_region_info_t
 		 */
 		double planarity;
 
+		/**
+		 * The number of times this region has been merged with
+		 * another region.  Pairs that were fit to an older
+		 * version of this region are out of date.
+		 */
+		size_t version;
+
+		/**
+		 * The shard of the graph that contains this region,
+		 * when coalescing regions in parallel.
+		 */
+		size_t shard;
+
+		/**
+		 * Whether this region has been merged into another
+		 * region, and is waiting to be removed from the graph.
+		 */
+		bool merged;
+
 	/* functions */
 	public:
 
@@ -106,6 +127,9 @@ class planar_region_info_t
 		planar_region_info_t()
 		{
 			this->planarity = -1; /* not yet computed */
+			this->version = 0;
+			this->shard = 0;
+			this->merged = false;
 		};
 
 		/**
@@ -207,6 +231,20 @@ class planar_region_pair_t
 		 */
 		size_t num_faces;
 
+		/**
+		 * The versions of the two regions when the plane fit
+		 * was computed.
+		 *
+		 * Whenever a region is modified, fresh pairs are made
+		 * for it and all its neighbors, so if either version
+		 * is out of date then this pair can be discarded
+		 * without being recomputed.  This is only done when
+		 * coalescing with shards, since it changes which pairs
+		 * are merged.
+		 */
+		size_t first_version;
+		size_t second_version;
+
 	/* functions */
 	public:
 
@@ -217,6 +255,8 @@ class planar_region_pair_t
 		{ 
 			this->err = DBL_MAX; 
 			this->num_faces = 0;
+			this->first_version = 0;
+			this->second_version = 0;
 		};
 
 		/**
@@ -227,7 +267,9 @@ class planar_region_pair_t
 				second(other.second),
 				plane(other.plane),
 				err(other.err),
-				num_faces(other.num_faces)
+				num_faces(other.num_faces),
+				first_version(other.first_version),
+				second_version(other.second_version)
 		{};
 
 		/*-----------*/
@@ -266,6 +308,8 @@ class planar_region_pair_t
 			this->plane = other.plane;
 			this->err = other.err;
 			this->num_faces = other.num_faces;
+			this->first_version = other.first_version;
+			this->second_version = other.second_version;
 
 			/* return the modified result */
 			return (*this);
@@ -426,6 +470,29 @@ class planar_region_graph_t
 		 */
 		COALESCING_STRATEGY strategy;
 
+		/**
+		 * The number of regions in each shard of the graph
+		 * when coalescing in parallel.
+		 *
+		 * If non-zero, then regions are grouped into spatially
+		 * coherent shards of this size, each shard is coalesced
+		 * independently, and then the merges across shards are
+		 * performed.  If zero, then all regions are coalesced
+		 * in one pass.
+		 *
+		 * The result depends on the shard size, but not on the
+		 * number of threads.  Out-of-date pairs are discarded
+		 * rather than refit when sharding, so a non-zero shard
+		 * size changes the result even with a single shard.
+		 */
+		size_t shard_size;
+
+		/**
+		 * The number of threads to use for coalescing.  If zero,
+		 * will use all available cores.
+		 */
+		unsigned int num_threads;
+
 	/* functions */
 	public:
 
@@ -460,6 +527,20 @@ class planar_region_graph_t
 		void init(double planethresh,double distthresh,bool fitiso,
 			COALESCING_STRATEGY strat=COALESCE_WITH_L_INF_NORM);
 
+		/**
+		 * Sets how to parallelize region coalescing
+		 *
+		 * By default, regions are not sharded and all cores
+		 * are used to compute plane fits.
+		 *
+		 * @param shardsize    The number of regions per shard,
+		 *                     or zero to coalesce without shards
+		 * @param numthreads   The number of threads to use, or
+		 *                     zero to use all cores
+		 */
+		void init_sharding(size_t shardsize,
+		                   unsigned int numthreads=0);
+
 		/*-----------*/
 		/* accessors */
 		/*-----------*/
@@ -522,6 +603,21 @@ class planar_region_graph_t
 		 */
 		int populate(const node_boundary_t& boundary);
 
+		/**
+		 * Populates the set of regions from a stream of faces
+		 *
+		 * Will form the same regions as populate() does for a
+		 * node_boundary_t, but reads the faces and their
+		 * linkages from the spill file of the given stream,
+		 * so that the linkages never need to be stored in
+		 * memory.
+		 *
+		 * @param stream   The streamed boundary faces of the model
+		 *
+		 * @return     Returns zero on success, non-zero on failure
+		 */
+		int populate(const node_boundary_stream_t& stream);
+
 		/**
 		 * Will attempt to coalesce regions in this graph
 		 *
@@ -567,26 +663,126 @@ class planar_region_graph_t
 	private:
 
 		/**
-		 * Will compute the best-fit plane for the combination
-		 * of the two regions in this pair.
+		 * Computes the best-fit plane for a pair of regions
 		 *
 		 * Will perform PCA analysis on the center points of the
 		 * faces in these regions.  Will also compute the
-		 * normalized maximal error (in units of standard
-		 * deviations) of these center points from the computed
-		 * plane.
+		 * normalized error (in units of standard deviations)
+		 * of these center points from the computed plane.
 		 *
 		 * These values will be stored in the parameters of this
-		 * structure 'plane' and 'max_err' respectively.
+		 * structure 'plane' and 'err' respectively.
 		 *
-		 * This call will cache statistical information in
-		 * this structure.
+		 * The face centers of both regions must already be
+		 * cached with cache_region().  This function does not
+		 * modify the graph, so it can be called concurrently.
 		 *
 		 * @param pair   The pair of regions to analyze
 		 *
 		 * @return    Returns zero on success, non-zero on failure.
 		 */
-		int compute_planefit(planar_region_pair_t& pair);
+		int fit_pair(planar_region_pair_t& pair) const;
+
+		/**
+		 * Caches the face centers and planarity of a region
+		 *
+		 * This only modifies the given region, so it can be
+		 * called concurrently on different regions.
+		 *
+		 * @param info   The region to analyze
+		 */
+		void cache_region(planar_region_info_t& info) const;
+
+		/**
+		 * Caches the centers and planarity of a range of regions
+		 *
+		 * @param regs    The list of regions
+		 * @param begin   The first index to cache
+		 * @param end     One past the last index to cache
+		 */
+		void cache_regions(
+			const std::vector<regionmap_t::iterator>* regs,
+			size_t begin, size_t end) const;
+
+		/**
+		 * Fits a range of pairs of regions
+		 *
+		 * @param pairs   The list of pairs to fit
+		 * @param begin   The first index to fit
+		 * @param end     One past the last index to fit
+		 * @param ret     Where to store zero on success,
+		 *                non-zero on failure.
+		 */
+		void fit_pairs(std::vector<planar_region_pair_t>* pairs,
+		               size_t begin, size_t end, int* ret) const;
+
+		/**
+		 * Computes plane fits for all neighboring regions
+		 *
+		 * Will cache the statistics of each region, and then
+		 * fit each pair of neighboring regions, in parallel.
+		 * The pairs are listed in a deterministic order.
+		 *
+		 * @param pairs   Where to store the pairs
+		 *
+		 * @return    Returns zero on success, non-zero on failure.
+		 */
+		int fit_all_pairs(std::vector<planar_region_pair_t>& pairs);
+
+		/**
+		 * Assigns each region to a shard
+		 *
+		 * Regions are sorted along a space-filling curve, and
+		 * consecutive runs of this->shard_size regions form
+		 * each shard.
+		 *
+		 * @return    Returns the number of shards
+		 */
+		size_t assign_shards();
+
+		/**
+		 * Updates neighbor links after coalescing shards
+		 *
+		 * Removes the regions that were merged while coalescing
+		 * shards, and replaces any references to them with the
+		 * regions they were merged into.
+		 */
+		void reconcile_shards();
+
+		/**
+		 * Merges pairs of regions from a queue
+		 *
+		 * Will pop pairs from the given queue, merging each
+		 * pair that meets the thresholds, until no more pairs
+		 * can be merged.
+		 *
+		 * If sharded, then only regions in the given shard are
+		 * merged, and the graph is only modified within that
+		 * shard, so that separate shards can be coalesced
+		 * concurrently.  In that case, reconcile_shards() must
+		 * be called once all shards are done.
+		 *
+		 * @param pq       The queue of pairs to merge
+		 * @param shard    The shard being coalesced
+		 * @param sharded  Whether to restrict to the shard
+		 *
+		 * @return    Returns zero on success, non-zero on failure.
+		 */
+		int coalesce_queue(
+			std::priority_queue<planar_region_pair_t>& pq,
+			size_t shard, bool sharded);
+
+		/**
+		 * Coalesces the regions of one shard
+		 *
+		 * @param pq       The queue of pairs within the shard
+		 * @param shard    The shard being coalesced
+		 * @param ret      Where to store zero on success,
+		 *                 non-zero on failure.
+		 */
+		void coalesce_shard(
+			std::priority_queue<planar_region_pair_t>* pq,
+			size_t shard, int* ret);
 
 		/**
 		 * Will combine the two regions into one region
@@ -597,11 +793,19 @@ class planar_region_graph_t
 		 * regions from the structure, and updating seed-neighbor
 		 * linkages.
 		 *
-		 * @param pair   The pair of regions to join
+		 * If sharded, then the second region is only marked as
+		 * merged rather than removed, and neighbors of the
+		 * second region in other shards are left unmodified
+		 * until reconcile_shards() is called.
+		 *
+		 * @param pair     The pair of regions to join
+		 * @param sharded  Whether the graph is being coalesced
+		 *                 by shard
 		 *
 		 * @return     Returns zero on success, non-zero on failure.
 		 */
-		int merge_regions(const planar_region_pair_t& pair);
+		int merge_regions(const planar_region_pair_t& pair,
+		                  bool sharded=false);
 };
 
 #endif
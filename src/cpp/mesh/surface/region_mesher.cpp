@@ -12,6 +12,8 @@
 #include <util/error_codes.h>
 #include <util/set_ops.h>
 #include <Eigen/Dense>
+#include <boost/threadpool.hpp>
+#include <boost/bind.hpp>
 #include <iostream>
 #include <fstream>
 #include <vector>
@@ -41,9 +43,19 @@ using namespace node_corner;
 #define XML_NODE_OUTLIERTHRESH   "octsurf_node_outlierthresh"
 #define XML_COALESCE_DISTTHRESH  "octsurf_coalesce_distthresh"
 #define XML_COALESCE_PLANETHRESH "octsurf_coalesce_planethresh"
+#define XML_COALESCE_SHARD_SIZE  "octsurf_coalesce_shard_size"
+#define XML_BOUNDARY_SPILL_BUF   "octsurf_boundary_spill_buffer"
 #define XML_USE_ISOSURFACE_POS   "octsurf_use_isosurface_pos"
 #define XML_MIN_SINGULAR_VALUE   "octsurf_min_singular_value"
 #define XML_MAX_COLINEARITY      "octsurf_max_colinearity"
+#define XML_NUM_THREADS          "octsurf_num_threads"
+
+/* the spill buffer is given in megabytes in the settings file */
+#define MEGABYTES_TO_BYTES       ((size_t) 1048576)
+
+/* the number of elements processed by each threaded task */
+#define VERTICES_PER_TASK        4096
+#define REGIONS_PER_TASK         16
 
 /*-----------------------------------*/
 /* mesher_t function implementations */
@@ -79,9 +91,12 @@ int mesher_t::import(const std::string& xml_settings)
 		this->node_outlierthresh = 1.0;
 		this->coalesce_distthresh = 2.0;
 		this->coalesce_planethresh = 0.0;
+		this->coalesce_shard_size = 0;
+		this->boundary_spill_buffer = 0;
 		this->use_isosurface_pos = false;
 		this->min_singular_value = 0.1;
 		this->max_colinearity = 0.99;
+		this->num_threads = 0;
 		return 0;
 	}
 
@@ -104,6 +119,13 @@ int mesher_t::import(const std::string& xml_settings)
 	if(settings.is_prop(XML_COALESCE_PLANETHRESH))
 		this->coalesce_planethresh = settings.getAsDouble(
 					XML_COALESCE_PLANETHRESH);
+	if(settings.is_prop(XML_COALESCE_SHARD_SIZE))
+		this->coalesce_shard_size = settings.getAsUint(
+					XML_COALESCE_SHARD_SIZE);
+	if(settings.is_prop(XML_BOUNDARY_SPILL_BUF))
+		this->boundary_spill_buffer = MEGABYTES_TO_BYTES
+				* settings.getAsUint(
+					XML_BOUNDARY_SPILL_BUF);
 	if(settings.is_prop(XML_USE_ISOSURFACE_POS))
 		this->use_isosurface_pos = settings.getAsUint(
 					XML_USE_ISOSURFACE_POS);
@@ -113,6 +135,9 @@ int mesher_t::import(const std::string& xml_settings)
 	if(settings.is_prop(XML_MAX_COLINEARITY))
 		this->max_colinearity = settings.getAsDouble(
 					XML_MAX_COLINEARITY);
+	if(settings.is_prop(XML_NUM_THREADS))
+		this->num_threads = settings.getAsUint(
+					XML_NUM_THREADS);
 
 	/* success */
 	return 0;
@@ -126,7 +151,10 @@ int mesher_t::init(const octree_t& tree,
 	planemap_t::iterator pit; /* access this->regions */
 	regionmap_t::const_iterator rit; /* access region_graph */
 	vertmap_t::iterator vit; /* access this->vertices */
+	vector<vertmap_t::iterator> verts;
 	faceset_t::const_iterator fit;
+	vector<int> rets;
+	size_t i, n, nt;
 	int ret;
 
 	/* clear any existing data */
@@ -173,14 +201,32 @@ int mesher_t::init(const octree_t& tree,
 			/* add the current vertex to this region */
 			pit->second.add(vit->first);
 		}
+		verts.push_back(vit);
+	}
 
-		/* now that we have prepared this vertex, we can compute
-		 * its ideal 3D position based on the set of regions
-		 * that intersect it. */
- 		ret = this->compute_vertex_pos(vit);
-		if(ret)
-			return PROPEGATE_ERROR(-4, ret);
+	/* now that we have prepared the vertices, we can compute
+	 * their ideal 3D positions based on the set of regions
+	 * that intersect them.  Each vertex is positioned
+	 * independently, so blocks of vertices are processed
+	 * in parallel. */
+	nt = this->num_threads;
+	if(nt == 0)
+		nt = boost::thread::hardware_concurrency();
+	if(nt == 0)
+		nt = 1;
+	n = verts.size();
+	rets.resize(n / VERTICES_PER_TASK + 1, 0);
+	{
+		boost::threadpool::pool tp(nt);
+		for(i = 0; i < n; i += VERTICES_PER_TASK)
+			tp.schedule(boost::bind(
+				&mesher_t::compute_vertex_pos_block, this,
+				&verts, i, min(n, i + VERTICES_PER_TASK),
+				&(rets[i / VERTICES_PER_TASK])));
 	}
+	for(i = 0; i < rets.size(); i++)
+		if(rets[i])
+			return PROPEGATE_ERROR(-4, rets[i]);
 
 	/* success */
 	return 0;
@@ -421,8 +467,13 @@ int mesher_t::compute_mesh(mesh_io::mesh_t& mesh,
 	vertmap_t::const_iterator vit;
 	map<corner_t, size_t> vert_inds;
 	pair<map<corner_t, size_t>::iterator, bool> ins;
+	vector<planemap_t::const_iterator> regs;
+	vector<color_t> colors;
+	vector<mesh_io::mesh_t> meshes;
+	vector<int> rets;
 	mesh_io::vertex_t v;
-	int ret;
+	mesh_io::polygon_t poly;
+	size_t i, j, k, n, nt, offset, base;
 
 	/* iterate over the vertices in this mesher.  We want to add them
 	 * to the output mesh */
@@ -444,20 +495,117 @@ int mesher_t::compute_mesh(mesh_io::mesh_t& mesh,
 	}
 
 	/* now that we've inserted all the vertices, we can go
-	 * through the regions and add triangles */
+	 * through the regions and add triangles.  Each region is
+	 * given its color in order, so that the colors are the
+	 * same as if the regions were meshed one at a time */
 	for(pit = this->regions.begin(); pit != this->regions.end(); pit++)
 	{
-		/* make triangles for this region */
-		ret = pit->second.compute_mesh_isostuff(mesh, 
-						vert_inds, tree);
-		if(ret)
-			return PROPEGATE_ERROR(-2, ret);
+		/* empty regions are not meshed */
+		if(pit->second.get_region().num_faces() == 0)
+			continue;
+		regs.push_back(pit);
+		colors.push_back(color_t());
+		colors.back().set_random();
+	}
+	if(regs.empty())
+		return 0; /* nothing to triangulate */
+	mesh.set_color(true);
+
+	/* make triangles for each region in parallel, each into
+	 * its own mesh */
+	nt = this->num_threads;
+	if(nt == 0)
+		nt = boost::thread::hardware_concurrency();
+	if(nt == 0)
+		nt = 1;
+	n = regs.size();
+	meshes.resize(n);
+	rets.resize(n / REGIONS_PER_TASK + 1, 0);
+	{
+		boost::threadpool::pool tp(nt);
+		for(i = 0; i < n; i += REGIONS_PER_TASK)
+			tp.schedule(boost::bind(
+				&mesher_t::compute_mesh_block, this,
+				&regs, &colors, &vert_inds, &tree, &meshes,
+				i, min(n, i + REGIONS_PER_TASK),
+				&(rets[i / REGIONS_PER_TASK])));
+	}
+	for(i = 0; i < rets.size(); i++)
+		if(rets[i])
+			return PROPEGATE_ERROR(-2, rets[i]);
+
+	/* merge the region meshes in order.  Indices less than the
+	 * offset refer to shared vertices, and the rest refer to
+	 * the region's own vertices, which are appended to the
+	 * output mesh */
+	offset = vert_inds.size();
+	for(i = 0; i < n; i++)
+	{
+		/* add the new vertices of this region */
+		base = mesh.num_verts();
+		for(j = 0; j < meshes[i].num_verts(); j++)
+			mesh.add(meshes[i].get_vert(j));
+
+		/* add the triangles, updating their indices */
+		for(j = 0; j < meshes[i].num_polys(); j++)
+		{
+			poly.set(meshes[i].get_poly(j).vertices);
+			for(k = 0; k < poly.vertices.size(); k++)
+				if(poly.vertices[k] >= offset)
+					poly.vertices[k] += base - offset;
+			mesh.add(poly);
+		}
+
+		/* free this region's mesh */
+		meshes[i].clear();
 	}
 		
 	/* success */
 	return 0;
 }
 			
+void mesher_t::compute_vertex_pos_block(
+			const vector<vertmap_t::iterator>* verts,
+			size_t first, size_t last, int* ret)
+{
+	size_t i;
+
+	/* position each vertex in this block */
+	for(i = first; i < last; i++)
+	{
+		*ret = this->compute_vertex_pos(verts->at(i));
+		if(*ret)
+		{
+			*ret = PROPEGATE_ERROR(-1, *ret);
+			return;
+		}
+	}
+}
+			
+void mesher_t::compute_mesh_block(
+			const vector<planemap_t::const_iterator>* regs,
+			const vector<color_t>* colors,
+			const map<corner_t, size_t>* vert_inds,
+			const octree_t* tree,
+			vector<mesh_io::mesh_t>* meshes,
+			size_t first, size_t last, int* ret) const
+{
+	size_t i;
+
+	/* mesh each region in this block into its own mesh */
+	for(i = first; i < last; i++)
+	{
+		*ret = regs->at(i)->second.compute_mesh_isostuff(
+				meshes->at(i), *vert_inds, *tree,
+				colors->at(i), vert_inds->size());
+		if(*ret)
+		{
+			*ret = PROPEGATE_ERROR(-1, *ret);
+			return;
+		}
+	}
+}
+
 int mesher_t::writeobj_vertices(std::ostream& os) const
 {
 	planemap_t::const_iterator pit;
@@ -552,10 +700,34 @@ int region_info_t::compute_mesh_isostuff(mesh_io::mesh_t& mesh,
 						size_t>& vert_ind,
 					const octree_t& tree) const
 {
-	region_isostuffer_t isostuff;
 	color_t color;
 	int ret;
 
+	/* check if this region is empty */
+	if(this->region_it->second.get_region().num_faces() == 0)
+		return 0; /* do nothing */
+
+	/* mesh this region with a random color */
+	mesh.set_color(true);
+	color.set_random();
+	ret = this->compute_mesh_isostuff(mesh, vert_ind, tree, color, 0);
+	if(ret)
+		return PROPEGATE_ERROR(-1, ret);
+
+	/* success */
+	return 0;
+}
+
+int region_info_t::compute_mesh_isostuff(mesh_io::mesh_t& mesh,
+				const std::map<node_corner::corner_t,
+						size_t>& vert_ind,
+					const octree_t& tree,
+					const color_t& color,
+					size_t offset) const
+{
+	region_isostuffer_t isostuff;
+	int ret;
+
 	/* check if this region is empty */
 	if(this->region_it->second.get_region().num_faces() == 0)
 		return 0; /* do nothing */
@@ -568,8 +740,7 @@ int region_info_t::compute_mesh_isostuff(mesh_io::mesh_t& mesh,
 
 	/* we want the output geometry to be topologically watertight,
 	 * so we want neighboring nodes to share vertices. */
-	mesh.set_color(true);
-	color.set_random();
+	isostuff.set_index_offset(offset);
 	ret = isostuff.compute_verts(mesh, color);
 	if(ret)
 		return PROPEGATE_ERROR(-2, ret);
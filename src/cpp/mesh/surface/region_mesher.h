@@ -21,6 +21,7 @@
 #include <mesh/surface/planar_region_graph.h>
 #include <mesh/surface/node_corner_map.h>
 #include <mesh/surface/node_corner.h>
+#include <image/color.h>
 #include <Eigen/Dense>
 #include <iostream>
 #include <vector>
@@ -116,6 +117,30 @@ namespace region_mesher
 			 */
 			double coalesce_planethresh;
 
+			/**
+			 * The number of regions in each shard when
+			 * coalescing regions in parallel.  If zero,
+			 * regions are coalesced without sharding.
+			 */
+			size_t coalesce_shard_size;
+
+			/**
+			 * The size of the buffer of boundary faces to
+			 * compute before writing them to a spill file.
+			 * If non-zero, the faces are written to a spill
+			 * file on disk, in tiles that fit within this
+			 * buffer, instead of being kept in memory.  If
+			 * zero, all faces are kept in memory.
+			 *
+			 * This does not bound the memory of the rest of
+			 * the process.  The tree, its topology, and the
+			 * corners and regions formed from the faces are
+			 * still held in memory.
+			 *
+			 * units:  bytes
+			 */
+			size_t boundary_spill_buffer;
+
 			/**
 			 * Whether or not to use the isosurface
 			 * position of each node face's center
@@ -150,6 +175,14 @@ namespace region_mesher
 			 */
 			double max_colinearity;
 
+			/**
+			 * The number of threads to use when placing
+			 * vertices and triangulating regions.  If zero,
+			 * will use the number of cores.  The output mesh
+			 * does not depend on this value.
+			 */
+			unsigned int num_threads;
+
 		/* functions */
 		public:
 
@@ -236,6 +269,20 @@ namespace region_mesher
 			inline double get_coalesce_planethresh() const
 			{ return this->coalesce_planethresh; };
 
+			/**
+			 * Retrieves the number of regions per shard
+			 * when coalescing.
+			 */
+			inline size_t get_coalesce_shard_size() const
+			{ return this->coalesce_shard_size; };
+
+			/**
+			 * Retrieves the size of the buffer, in bytes,
+			 * for writing boundary faces to a spill file.
+			 */
+			inline size_t get_boundary_spill_buffer() const
+			{ return this->boundary_spill_buffer; };
+
 			/**
 			 * Retrieves the flag for whether to use
 			 * the isosurface position for face centers.
@@ -250,6 +297,13 @@ namespace region_mesher
 			inline double get_min_singular_value() const
 			{ return this->min_singular_value; };
 
+			/**
+			 * Retrieves the number of threads to use
+			 * when meshing.
+			 */
+			inline unsigned int get_num_threads() const
+			{ return this->num_threads; };
+
 			/*-----*/
 			/* i/o */
 			/*-----*/
@@ -264,6 +318,11 @@ namespace region_mesher
 			 * then make sure that the argument
 			 * mesh is clear before this call.
 			 *
+			 * Regions are triangulated in parallel, each
+			 * into its own mesh, and these meshes are merged
+			 * in region order, so the output is the same as
+			 * meshing each region in turn.
+			 *
 			 * @param mesh   The mesh to add to
 			 * @param tree   The originating tree for this model
 			 *
@@ -347,6 +406,51 @@ namespace region_mesher
 			 *              on failure.
 			 */
 			int compute_vertex_pos(vertmap_t::iterator vit);
+
+			/**
+			 * Computes the positions of a block of vertices
+			 *
+			 * Calls compute_vertex_pos() on the vertices
+			 * (*verts)[first] through (*verts)[last-1].  Each
+			 * call only modifies its own vertex, so blocks
+			 * can be processed in parallel.
+			 *
+			 * @param verts   The list of all vertices
+			 * @param first   The first vertex of the block
+			 * @param last    One past the last vertex
+			 * @param ret     Where to store the return code
+			 */
+			void compute_vertex_pos_block(
+				const std::vector<vertmap_t::iterator>* verts,
+				size_t first, size_t last, int* ret);
+
+			/**
+			 * Triangulates a block of regions
+			 *
+			 * Each region (*regs)[i], for i in [first,last),
+			 * is triangulated into (*meshes)[i].  New vertices
+			 * in these meshes are indexed starting at the
+			 * number of elements in vert_inds, so that they can
+			 * be told apart from the shared vertices.
+			 *
+			 * @param regs       The list of regions to mesh
+			 * @param colors     The color of each region
+			 * @param vert_inds  The indices of shared vertices
+			 * @param tree       The originating tree
+			 * @param meshes     Where to store each region's mesh
+			 * @param first      The first region of the block
+			 * @param last       One past the last region
+			 * @param ret        Where to store the return code
+			 */
+			void compute_mesh_block(
+				const std::vector<planemap_t::const_iterator>*
+						regs,
+				const std::vector<color_t>* colors,
+				const std::map<node_corner::corner_t,
+						size_t>* vert_inds,
+				const octree_t* tree,
+				std::vector<mesh_io::mesh_t>* meshes,
+				size_t first, size_t last, int* ret) const;
 	};
 	
 	/**
@@ -641,6 +745,34 @@ namespace region_mesher
 						size_t>& vert_ind,
 					const octree_t& tree) const;
 
+			/**
+			 * Will triangulate this region with a given color
+			 *
+			 * Performs the same meshing as the above function,
+			 * but does not draw a random color, and indexes
+			 * new vertices starting at the given offset plus
+			 * the number of vertices already in the mesh.
+			 * Since it does not modify any shared state, it
+			 * can be called for different regions in parallel,
+			 * each with its own mesh.
+			 *
+			 * @param mesh       Where to store the output
+			 * @param vert_ind   The mapping from vertices to
+			 *                   indices in the mesh.
+			 * @param tree       The originating tree
+			 * @param color      The color of new vertices
+			 * @param offset     The index offset of new vertices
+			 *
+			 * @return       Returns zero on success, non-zero
+			 *               on failure.
+			 */
+			int compute_mesh_isostuff(mesh_io::mesh_t& mesh,
+				const std::map<node_corner::corner_t,
+						size_t>& vert_ind,
+					const octree_t& tree,
+					const color_t& color,
+					size_t offset) const;
+
 			/*-----------*/
 			/* debugging */
 			/*-----------*/
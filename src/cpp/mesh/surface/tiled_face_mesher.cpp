@@ -0,0 +1,791 @@
+#include "tiled_face_mesher.h"
+#include <io/mesh/mesh_io.h>
+#include <xmlreader/xmlsettings.h>
+#include <geometry/octree/octree.h>
+#include <geometry/octree/octnode.h>
+#include <geometry/octree/octtopo.h>
+#include <mesh/surface/face_mesher.h>
+#include <mesh/surface/node_boundary.h>
+#include <mesh/surface/node_boundary_stream.h>
+#include <mesh/surface/node_corner.h>
+#include <mesh/surface/node_corner_map.h>
+#include <util/progress_bar.h>
+#include <util/error_codes.h>
+#include <boost/threadpool.hpp>
+#include <boost/bind.hpp>
+#include <Eigen/Dense>
+#include <algorithm>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <stdio.h>
+#include <math.h>
+
+/**
+ * @file    tiled_face_mesher.cpp
+ * @author  Eric Turner <elturner@eecs.berkeley.edu>
+ * @brief   Converts octree geometry to a dense mesh one tile at a time
+ *
+ * @section DESCRIPTION
+ *
+ * This file contains the tiled_face_mesher_t class, which generates
+ * the same dense mesh as the face_mesher_t class, but without storing
+ * all boundary faces or the whole mesh in memory at once.
+ *
+ * The domain of the octree is partitioned into cubic tiles, which are
+ * meshed independently on multiple threads and streamed to disk.  Each
+ * corner of the octree, and so each polygon of the mesh, belongs to
+ * exactly one tile.  The vertices of the mesh are the boundary faces,
+ * which are indexed globally by a node_boundary_stream_t, so vertices
+ * along the seams of tiles are shared without any communication
+ * between tiles.
+ */
+
+using namespace std;
+using namespace Eigen;
+using namespace node_corner;
+
+/* the following defines are used to access parameters stored
+ * in the .xml settings file. */
+#define XML_DENSE_TILE_SIZE   "octsurf_dense_tile_size"
+#define XML_DENSE_TILE_FILES  "octsurf_dense_tile_files"
+#define XML_NUM_THREADS       "octsurf_num_threads"
+
+/* the following suffixes are used to name output files */
+#define PLY_SUFFIX            ".ply"
+#define TILE_INDEX_SUFFIX     ".tiles"
+#define TRIANGLE_SPILL_SUFFIX ".tris"
+
+/* the output mesh is always a binary PLY file */
+#define TILED_MESH_FORMAT     mesh_io::FORMAT_PLY_LE_COLOR
+
+/* the number of vertices in each triangle */
+#define NUM_VERTS_PER_TRIANGLE 3
+
+/* the width reserved for the number of tiles in the index file */
+#define TILE_COUNT_WIDTH      20
+
+/* helper functions */
+static int tile_floor(int v, int w);
+static string get_stem(const string& filename);
+
+/*----------------------------------------------*/
+/* tiled_face_mesher_t function implementations */
+/*----------------------------------------------*/
+
+tiled_face_mesher_t::tiled_face_mesher_t()
+{
+	/* set default parameters */
+	this->import(string(""));
+	this->tree = NULL;
+	this->tile_width = 1;
+}
+
+int tiled_face_mesher_t::import(const std::string& xml_settings)
+{
+	XmlSettings settings;
+
+	/* check if the file is empty */
+	if(xml_settings.empty())
+	{
+		/* no file provided, use default settings */
+		this->tile_size = 0.0;
+		this->tile_files = false;
+		this->num_threads = 0;
+		return 0;
+	}
+
+	/* open and parse xml file */
+	if(!settings.read(xml_settings))
+	{
+		/* unable to open file */
+		cerr << "[tiled_face_mesher_t::import]\tUnable to import "
+		     << "xml settings from: " << xml_settings << endl;
+		return -1;
+	}
+
+	/* read in the settings information */
+	if(settings.is_prop(XML_DENSE_TILE_SIZE))
+		this->tile_size = settings.getAsDouble(
+					XML_DENSE_TILE_SIZE);
+	if(settings.is_prop(XML_DENSE_TILE_FILES))
+		this->tile_files = settings.getAsUint(
+					XML_DENSE_TILE_FILES);
+	if(settings.is_prop(XML_NUM_THREADS))
+		this->num_threads = settings.getAsUint(
+					XML_NUM_THREADS);
+
+	/* success */
+	return 0;
+}
+
+int tiled_face_mesher_t::write(const std::string& filename,
+                               const octree_t& tree,
+                               const octtopo::octtopo_t& topo,
+                               node_boundary_t::SEG_SCHEME scheme)
+{
+	vector<corner_t> tiles;
+	size_t nt;
+	int ret;
+
+	/* check arguments */
+	if(this->tile_size <= 0)
+	{
+		cerr << "[tiled_face_mesher_t::write]\tInvalid tile size: "
+		     << this->tile_size << endl;
+		return -1;
+	}
+	if(filename.size() < string(PLY_SUFFIX).size()
+			|| filename.compare(filename.size()
+				- string(PLY_SUFFIX).size(),
+				string::npos, PLY_SUFFIX) != 0)
+	{
+		cerr << "[tiled_face_mesher_t::write]\tTiled meshes can "
+		     << "only be written as PLY files: " << filename
+		     << endl;
+		return -2;
+	}
+	if(!(corner_t::fits(tree)))
+	{
+		cerr << "[tiled_face_mesher_t::write]\tTree is too large "
+		     << "for its resolution to index its corners" << endl;
+		return -3;
+	}
+
+	/* index the boundary faces, which are the vertices of
+	 * the output mesh */
+	this->tree = &tree;
+	this->faces.index(topo, scheme);
+
+	/* corner indices are in units of half the resolution */
+	this->tile_width = (int) round(this->tile_size
+				/ (0.5 * tree.get_resolution()));
+	if(this->tile_width < 1)
+		this->tile_width = 1;
+	this->find_tiles(tiles);
+
+	/* determine the number of threads to use */
+	nt = this->num_threads;
+	if(nt == 0)
+		nt = boost::thread::hardware_concurrency();
+	if(nt == 0)
+		nt = 1;
+
+	/* mesh the tiles */
+	if(this->tile_files)
+		ret = this->write_tiles(filename, tiles, nt);
+	else
+		ret = this->write_merged(filename, tiles, nt);
+
+	/* clean up */
+	this->faces.clear();
+	this->tree = NULL;
+	if(ret)
+		return PROPEGATE_ERROR(-4, ret);
+	return 0;
+}
+
+/*--------------------------------------------*/
+/* tiled_face_mesher_t helper implementations */
+/*--------------------------------------------*/
+
+void tiled_face_mesher_t::find_tiles(vector<corner_t>& tiles) const
+{
+	set<corner_t> found;
+	corner_t c, min_c, max_c;
+	octnode_t* node;
+	size_t i, n, ci;
+	int x, y, z, w;
+
+	/* each tile touched by a node with faces may contain
+	 * corners of those faces */
+	w = this->tile_width;
+	n = this->faces.boundary_nodes.size();
+	for(i = 0; i < n; i++)
+	{
+		/* get the bounds of this node */
+		node = this->faces.topo->get_node(
+					this->faces.boundary_nodes[i]);
+		for(ci = 0; ci < NUM_CORNERS_PER_CUBE; ci++)
+		{
+			c.set(*(this->tree), node, ci);
+			if(ci == 0)
+				min_c = max_c = c;
+			else
+				c.update_bounds(min_c, max_c);
+		}
+
+		/* add every tile within these bounds */
+		for(x = tile_floor(min_c.x_ind(), w);
+				x <= tile_floor(max_c.x_ind(), w); x++)
+			for(y = tile_floor(min_c.y_ind(), w);
+					y <= tile_floor(max_c.y_ind(), w); y++)
+				for(z = tile_floor(min_c.z_ind(), w);
+						z <= tile_floor(max_c.z_ind(),
+							w); z++)
+				{
+					c.set_indices(x*w, y*w, z*w);
+					found.insert(c);
+				}
+	}
+
+	/* store the tiles in order */
+	tiles.clear();
+	tiles.insert(tiles.end(), found.begin(), found.end());
+}
+
+bool tiled_face_mesher_t::touches(const corner_t& min_c,
+                                  const corner_t& max_c,
+                                  const corner_t& tile) const
+{
+	int w;
+
+	/* the tile covers the corner indices [tile, tile + w - 1] */
+	w = this->tile_width;
+	if(max_c.x_ind() < tile.x_ind() || min_c.x_ind() >= tile.x_ind()+w)
+		return false;
+	if(max_c.y_ind() < tile.y_ind() || min_c.y_ind() >= tile.y_ind()+w)
+		return false;
+	if(max_c.z_ind() < tile.z_ind() || min_c.z_ind() >= tile.z_ind()+w)
+		return false;
+	return true;
+}
+
+void tiled_face_mesher_t::gather_faces(octnode_t* node,
+                                       const corner_t& tile,
+                                       vector<node_face_t>& found) const
+{
+	vector<node_face_t> node_faces;
+	corner_t c, min_c, max_c;
+	size_t i, k, ci;
+
+	/* check for null nodes */
+	if(node == NULL)
+		return;
+
+	/* check if this node touches the tile */
+	for(ci = 0; ci < NUM_CORNERS_PER_CUBE; ci++)
+	{
+		c.set(*(this->tree), node, ci);
+		if(ci == 0)
+			min_c = max_c = c;
+		else
+			c.update_bounds(min_c, max_c);
+	}
+	if(!(this->touches(min_c, max_c, tile)))
+		return;
+
+	/* recurse through children */
+	if(!(node->isleaf()))
+	{
+		for(i = 0; i < CHILDREN_PER_NODE; i++)
+			this->gather_faces(node->children[i], tile, found);
+		return;
+	}
+
+	/* get the faces of this leaf */
+	i = this->faces.topo->find(node);
+	if(i >= this->faces.topo->size())
+		return;
+	this->faces.get_node_faces(i, node_faces);
+
+	/* keep the faces that touch the tile */
+	for(k = 0; k < node_faces.size(); k++)
+	{
+		for(ci = 0; ci < NUM_CORNERS_PER_SQUARE; ci++)
+		{
+			c.set(*(this->tree), node_faces[k], ci);
+			if(ci == 0)
+				min_c = max_c = c;
+			else
+				c.update_bounds(min_c, max_c);
+		}
+		if(this->touches(min_c, max_c, tile))
+			found.push_back(node_faces[k]);
+	}
+}
+
+void tiled_face_mesher_t::process_tile(const corner_t* tile,
+                                       vector<size_t>* tris,
+                                       int* ret) const
+{
+	vector<node_face_t> found, nearby, corner_faces;
+	vector<node_face_t>::iterator nit;
+	vector<size_t> inds, ids;
+	vector<pair<double, size_t> > face_inds;
+	map<node_face_t, size_t> ranks;
+	corner_map_t corners;
+	ccmap_t::const_iterator cit;
+	faceset_t::const_iterator fit;
+	node_face_info_t info;
+	corner_t max_c;
+	Vector3d pos;
+	size_t i, m, id, num_faces;
+	double hw;
+
+	/* find the faces that may have corners in this tile */
+	tris->clear();
+	this->gather_faces(this->tree->get_root(), *tile, found);
+
+	/* add each face to the corners of this tile.  Only the
+	 * smaller linked faces affect the corners of a face, so
+	 * those are the only neighbors that are computed */
+	for(i = 0; i < found.size(); i++)
+	{
+		nearby.clear();
+		*ret = this->faces.get_nearby_faces(found[i].interior,
+						nearby);
+		if(*ret)
+		{
+			*ret = PROPEGATE_ERROR(-1, *ret);
+			return;
+		}
+		*ret = this->faces.get_nearby_faces(found[i].exterior,
+						nearby);
+		if(*ret)
+		{
+			*ret = PROPEGATE_ERROR(-2, *ret);
+			return;
+		}
+		sort(nearby.begin(), nearby.end());
+		nit = unique(nearby.begin(), nearby.end());
+
+		/* keep the smaller linked faces */
+		info.clear();
+		hw = found[i].get_halfwidth();
+		for(m = 0; m < (size_t) (nit - nearby.begin()); m++)
+			if(nearby[m].get_halfwidth() < hw
+					&& node_boundary_t::faces_are_linked(
+						*(this->faces.topo),
+						found[i], nearby[m]))
+				info.add(nearby[m]);
+		corners.add(*(this->tree), found[i], info);
+	}
+
+	/* face_mesher_t breaks ties when ordering the faces of a
+	 * corner by the order in which it first saw each face, which
+	 * is by the first corner of each face, then by face.  Every
+	 * corner of a gathered face is in this map, so that order
+	 * can be found here. */
+	for(cit = corners.begin(); cit != corners.end(); cit++)
+		for(fit = cit->second.begin_faces();
+				fit != cit->second.end_faces(); fit++)
+			ranks.insert(pair<node_face_t, size_t>(*fit,
+						ranks.size()));
+
+	/* make a polygon for each corner in this tile */
+	max_c.set_indices(tile->x_ind() + this->tile_width - 1,
+			tile->y_ind() + this->tile_width - 1,
+			tile->z_ind() + this->tile_width - 1);
+	for(cit = corners.begin(); cit != corners.end(); cit++)
+	{
+		/* corners of other tiles are meshed by those tiles */
+		if(!(cit->first.within_bounds(*tile, max_c)))
+			continue;
+
+		/* get the faces of this corner, indexed by
+		 * their position in the boundary index */
+		corner_faces.clear();
+		inds.clear();
+		for(fit = cit->second.begin_faces();
+				fit != cit->second.end_faces(); fit++)
+		{
+			*ret = this->faces.find_face(*fit, id);
+			if(*ret)
+			{
+				*ret = PROPEGATE_ERROR(-3, *ret);
+				return;
+			}
+			corner_faces.push_back(*fit);
+			inds.push_back(ranks[*fit]);
+			if(ids.size() <= inds.back())
+				ids.resize(inds.back() + 1);
+			ids[inds.back()] = id;
+		}
+
+		/* check that we have sufficient faces to make a polygon */
+		num_faces = corner_faces.size();
+		if(num_faces < 3)
+		{
+			cit->first.get_position(*(this->tree), pos);
+			cerr << "[tiled_face_mesher_t::process_tile]\tFound "
+			     << "corner that is connected to fewer than "
+			     << "three faces!" << endl
+			     << "\tCorner pos: " << pos.transpose() << endl
+			     << "\tNum faces: "  << num_faces << endl
+			     << endl;
+			continue;
+		}
+
+		/* split the polygon about this corner into triangles */
+		face_mesher_t::order_faces(corner_faces, inds, face_inds);
+		for(i = 1; i < num_faces-1; i++)
+		{
+			tris->push_back(ids[face_inds[0].second]);
+			tris->push_back(ids[face_inds[i].second]);
+			tris->push_back(ids[face_inds[i+1].second]);
+		}
+	}
+
+	/* success */
+	*ret = 0;
+}
+
+int tiled_face_mesher_t::write_merged(const string& filename,
+                                      const vector<corner_t>& tiles,
+                                      size_t nt) const
+{
+	vector<vector<size_t> > bufs;
+	vector<node_face_t> node_faces;
+	vector<int> rets;
+	ofstream outfile, trifile;
+	ifstream infile;
+	progress_bar_t progbar;
+	mesh_io::polygon_t poly;
+	mesh_io::vertex_t vert;
+	string trifilename;
+	Vector3d pos;
+	size_t i, j, k, t, b, num_tiles, num_polys;
+	int ret;
+
+	/* the triangles are written to a spill file as they are
+	 * generated, since the header of the output needs to know
+	 * how many there are */
+	trifilename = filename + TRIANGLE_SPILL_SUFFIX;
+	trifile.open(trifilename.c_str(), ios_base::out | ios_base::binary);
+	if(!(trifile.is_open()))
+	{
+		cerr << "[tiled_face_mesher_t::write_merged]\tUnable to "
+		     << "open spill file: " << trifilename << endl;
+		return -1;
+	}
+
+	/* process the tiles in batches of one tile per thread, and
+	 * write the triangles of each batch in order */
+	progbar.set_name("Meshing tiles");
+	num_tiles = tiles.size();
+	num_polys = 0;
+	bufs.resize(nt);
+	rets.resize(nt);
+	{
+		boost::threadpool::pool tp(nt);
+		for(t = 0; t < num_tiles; t += b)
+		{
+			/* update user on progress */
+			progbar.update(t, num_tiles);
+
+			/* compute this batch of tiles */
+			b = min(nt, num_tiles - t);
+			for(i = 0; i < b; i++)
+				tp.schedule(boost::bind(
+					&tiled_face_mesher_t::process_tile,
+					this, &(tiles[t+i]), &(bufs[i]),
+					&(rets[i])));
+			tp.wait();
+
+			/* export the triangles to disk */
+			for(i = 0; i < b; i++)
+			{
+				if(rets[i])
+				{
+					progbar.clear();
+					trifile.close();
+					remove(trifilename.c_str());
+					return PROPEGATE_ERROR(-2, rets[i]);
+				}
+				for(j = 0; j < bufs[i].size();
+						j += NUM_VERTS_PER_TRIANGLE)
+				{
+					poly.set(bufs[i][j], bufs[i][j+1],
+							bufs[i][j+2]);
+					poly.serialize(trifile,
+							TILED_MESH_FORMAT);
+					num_polys++;
+				}
+				bufs[i].clear();
+			}
+		}
+	}
+	progbar.clear();
+	if(trifile.fail())
+	{
+		cerr << "[tiled_face_mesher_t::write_merged]\tUnable to "
+		     << "write to spill file: " << trifilename << endl;
+		trifile.close();
+		remove(trifilename.c_str());
+		return -3;
+	}
+	trifile.close();
+
+	/* write the header and the vertices, which are the
+	 * boundary faces in the order of their indices */
+	outfile.open(filename.c_str(), ios_base::out | ios_base::binary);
+	if(!(outfile.is_open()))
+	{
+		cerr << "[tiled_face_mesher_t::write_merged]\tUnable to "
+		     << "open file for writing: " << filename << endl;
+		remove(trifilename.c_str());
+		return -4;
+	}
+	ret = mesh_io::mesh_t::write_ply_header(outfile, TILED_MESH_FORMAT,
+				this->faces.size(), num_polys);
+	if(ret)
+	{
+		remove(trifilename.c_str());
+		return PROPEGATE_ERROR(-5, ret);
+	}
+	for(i = 0; i < this->faces.boundary_nodes.size(); i++)
+	{
+		node_faces.clear();
+		this->faces.get_node_faces(this->faces.boundary_nodes[i],
+						node_faces);
+		for(k = 0; k < node_faces.size(); k++)
+		{
+			node_faces[k].get_isosurface_pos(pos);
+			vert.x = pos(0);
+			vert.y = pos(1);
+			vert.z = pos(2);
+			vert.serialize(outfile, TILED_MESH_FORMAT);
+		}
+	}
+
+	/* append the triangles */
+	infile.open(trifilename.c_str(), ios_base::in | ios_base::binary);
+	if(!(infile.is_open()))
+	{
+		cerr << "[tiled_face_mesher_t::write_merged]\tUnable to "
+		     << "read spill file: " << trifilename << endl;
+		remove(trifilename.c_str());
+		return -6;
+	}
+	if(num_polys > 0)
+		outfile << infile.rdbuf();
+	infile.close();
+	remove(trifilename.c_str());
+	if(outfile.fail())
+	{
+		cerr << "[tiled_face_mesher_t::write_merged]\tUnable to "
+		     << "write to file: " << filename << endl;
+		return -7;
+	}
+
+	/* success */
+	outfile.close();
+	return 0;
+}
+
+int tiled_face_mesher_t::write_tiles(const string& filename,
+                                     const vector<corner_t>& tiles,
+                                     size_t nt) const
+{
+	vector<vector<size_t> > bufs;
+	vector<size_t> ids;
+	vector<size_t>::iterator it;
+	vector<int> rets;
+	ofstream indexfile;
+	progress_bar_t progbar;
+	mesh_io::mesh_t mesh;
+	mesh_io::polygon_t poly;
+	mesh_io::vertex_t vert;
+	node_face_t f;
+	stringstream tilename;
+	string stem, indexname;
+	Vector3d pos, tile_min, tile_max;
+	double hr;
+	streampos count_pos;
+	size_t i, j, k, t, b, num_tiles, num_written;
+	int ret;
+
+	/* open the index file */
+	stem = get_stem(filename);
+	indexname = stem + TILE_INDEX_SUFFIX;
+	indexfile.open(indexname.c_str());
+	if(!(indexfile.is_open()))
+	{
+		cerr << "[tiled_face_mesher_t::write_tiles]\tUnable to "
+		     << "open index file: " << indexname << endl;
+		return -1;
+	}
+
+	/* the index file lists the number of vertices in the
+	 * merged mesh, then each tile as:
+	 *
+	 * 	file num_verts num_tris min_x min_y min_z max_x max_y max_z
+	 * 	global index of each vertex of the tile...
+	 */
+	indexfile << "num_vertices " << this->faces.size() << endl
+	          << "num_tiles    ";
+
+	/* empty tiles are not written, so the number of tiles is
+	 * not known until they are meshed.  Leave room for it, and
+	 * fill it in at the end */
+	count_pos = indexfile.tellp();
+	indexfile << setw(TILE_COUNT_WIDTH) << left << 0 << endl;
+	num_written = 0;
+
+	/* process the tiles in batches of one tile per thread, and
+	 * write each tile of the batch in order */
+	progbar.set_name("Meshing tiles");
+	hr = 0.5 * this->tree->get_resolution();
+	num_tiles = tiles.size();
+	bufs.resize(nt);
+	rets.resize(nt);
+	{
+		boost::threadpool::pool tp(nt);
+		for(t = 0; t < num_tiles; t += b)
+		{
+			/* update user on progress */
+			progbar.update(t, num_tiles);
+
+			/* compute this batch of tiles */
+			b = min(nt, num_tiles - t);
+			for(i = 0; i < b; i++)
+				tp.schedule(boost::bind(
+					&tiled_face_mesher_t::process_tile,
+					this, &(tiles[t+i]), &(bufs[i]),
+					&(rets[i])));
+			tp.wait();
+
+			/* export each tile to its own file */
+			for(i = 0; i < b; i++)
+			{
+				if(rets[i])
+				{
+					progbar.clear();
+					return PROPEGATE_ERROR(-2, rets[i]);
+				}
+
+				/* the vertices of this tile are the
+				 * faces it references, in order */
+				ids = bufs[i];
+				sort(ids.begin(), ids.end());
+				it = unique(ids.begin(), ids.end());
+				ids.resize(it - ids.begin());
+				if(ids.empty())
+					continue; /* empty tile */
+
+				/* build the mesh of this tile */
+				mesh.clear();
+				for(k = 0; k < ids.size(); k++)
+				{
+					ret = this->faces.get_face(ids[k], f);
+					if(ret)
+					{
+						progbar.clear();
+						return PROPEGATE_ERROR(-3,
+								ret);
+					}
+					f.get_isosurface_pos(pos);
+					vert.x = pos(0);
+					vert.y = pos(1);
+					vert.z = pos(2);
+					mesh.add(vert);
+				}
+				for(j = 0; j < bufs[i].size();
+						j += NUM_VERTS_PER_TRIANGLE)
+				{
+					poly.clear();
+					for(k = 0; k < NUM_VERTS_PER_TRIANGLE;
+							k++)
+						poly.vertices.push_back(
+							lower_bound(
+							ids.begin(),
+							ids.end(),
+							bufs[i][j+k])
+							- ids.begin());
+					mesh.add(poly);
+				}
+				bufs[i].clear();
+
+				/* write the tile */
+				tilename.str("");
+				tilename << stem << "_"
+				         << (tiles[t+i].x_ind()
+						 / this->tile_width) << "_"
+				         << (tiles[t+i].y_ind()
+						 / this->tile_width) << "_"
+				         << (tiles[t+i].z_ind()
+						 / this->tile_width)
+				         << PLY_SUFFIX;
+				ret = mesh.write(tilename.str(),
+						TILED_MESH_FORMAT);
+				if(ret)
+				{
+					progbar.clear();
+					return PROPEGATE_ERROR(-4, ret);
+				}
+
+				/* add it to the index */
+				tiles[t+i].get_position(*(this->tree),
+							tile_min);
+				tile_max = tile_min + Vector3d::Constant(
+						this->tile_width * hr);
+				indexfile << tilename.str() << " "
+				          << mesh.num_verts() << " "
+				          << mesh.num_polys() << " "
+				          << tile_min.transpose() << " "
+				          << tile_max.transpose() << endl;
+				for(k = 0; k < ids.size(); k++)
+					indexfile << (k == 0 ? "" : " ")
+					          << ids[k];
+				indexfile << endl;
+				num_written++;
+			}
+		}
+	}
+	progbar.clear();
+
+	/* record the number of tiles that were written */
+	indexfile.seekp(count_pos);
+	indexfile << setw(TILE_COUNT_WIDTH) << left << num_written;
+
+	/* check the index file */
+	if(indexfile.fail())
+	{
+		cerr << "[tiled_face_mesher_t::write_tiles]\tUnable to "
+		     << "write index file: " << indexname << endl;
+		return -5;
+	}
+
+	/* success */
+	indexfile.close();
+	return 0;
+}
+
+/*------------------*/
+/* helper functions */
+/*------------------*/
+
+/**
+ * Computes the index of the tile containing a corner index
+ *
+ * Rounds towards negative infinity, so that each tile covers
+ * the same number of corner indices.
+ *
+ * @param v   The corner index
+ * @param w   The width of each tile
+ *
+ * @return    Returns the index of the tile
+ */
+static int tile_floor(int v, int w)
+{
+	return (v >= 0) ? (v / w) : -((w - 1 - v) / w);
+}
+
+/**
+ * Removes the .ply suffix from a file name
+ *
+ * @param filename   The file name to analyze
+ *
+ * @return    Returns the file name without its suffix
+ */
+static string get_stem(const string& filename)
+{
+	return filename.substr(0, filename.size()
+				- string(PLY_SUFFIX).size());
+}
@@ -0,0 +1,253 @@
+#ifndef TILED_FACE_MESHER_H
+#define TILED_FACE_MESHER_H
+
+/**
+ * @file    tiled_face_mesher.h
+ * @author  Eric Turner <elturner@eecs.berkeley.edu>
+ * @brief   Converts octree geometry to a dense mesh one tile at a time
+ *
+ * @section DESCRIPTION
+ *
+ * This file contains the tiled_face_mesher_t class, which generates
+ * the same dense mesh as the face_mesher_t class, but without storing
+ * all boundary faces or the whole mesh in memory at once.
+ *
+ * The domain of the octree is partitioned into cubic tiles, which are
+ * meshed independently on multiple threads and streamed to disk.  Each
+ * corner of the octree, and so each polygon of the mesh, belongs to
+ * exactly one tile.  The vertices of the mesh are the boundary faces,
+ * which are indexed globally by a node_boundary_stream_t, so vertices
+ * along the seams of tiles are shared without any communication
+ * between tiles.
+ */
+
+#include <io/mesh/mesh_io.h>
+#include <geometry/octree/octree.h>
+#include <geometry/octree/octtopo.h>
+#include <mesh/surface/node_boundary.h>
+#include <mesh/surface/node_boundary_stream.h>
+#include <mesh/surface/node_corner.h>
+#include <string>
+#include <vector>
+
+/**
+ * The tiled_face_mesher_t class meshes an octree in spatial tiles
+ *
+ * The output is either a single binary PLY file, or one PLY file
+ * per tile along with an index file that describes the tiles.
+ */
+class tiled_face_mesher_t
+{
+	/* parameters */
+	private:
+
+		/**
+		 * The width of each tile
+		 *
+		 * If zero, the mesh should not be tiled.
+		 *
+		 * units:  meters
+		 */
+		double tile_size;
+
+		/**
+		 * Whether to write each tile to its own file
+		 *
+		 * If true, each tile is written to its own PLY file,
+		 * and an index file is written that lists the tiles.
+		 * If false, all tiles are merged into one PLY file.
+		 */
+		bool tile_files;
+
+		/**
+		 * The number of threads to use when meshing tiles
+		 *
+		 * If zero, will use the number of cores.  The output
+		 * does not depend on this value.
+		 */
+		unsigned int num_threads;
+
+		/* the following values are only valid while
+		 * a mesh is being written */
+
+		/**
+		 * The octree being meshed
+		 */
+		const octree_t* tree;
+
+		/**
+		 * The index of all boundary faces
+		 *
+		 * The i'th face in this index is the i'th vertex
+		 * of the merged mesh.
+		 */
+		node_boundary_stream_t faces;
+
+		/**
+		 * The width of each tile, in units of corner indices
+		 */
+		int tile_width;
+
+	/* functions */
+	public:
+
+		/*--------------*/
+		/* constructors */
+		/*--------------*/
+
+		/**
+		 * Constructs a mesher with default settings
+		 */
+		tiled_face_mesher_t();
+
+		/*----------------*/
+		/* initialization */
+		/*----------------*/
+
+		/**
+		 * Imports the settings specified in the given .xml file
+		 *
+		 * If the file is empty, the default settings are used,
+		 * which disable tiling.
+		 *
+		 * @param xml_settings   The xml settings file to read
+		 *
+		 * @return     Returns zero on success, non-zero on failure.
+		 */
+		int import(const std::string& xml_settings);
+
+		/*-----------*/
+		/* accessors */
+		/*-----------*/
+
+		/**
+		 * Retrieves the width of each tile, in meters.
+		 */
+		inline double get_tile_size() const
+		{ return this->tile_size; };
+
+		/**
+		 * Retrieves whether tiles are written to their own files.
+		 */
+		inline bool get_tile_files() const
+		{ return this->tile_files; };
+
+		/*-----*/
+		/* i/o */
+		/*-----*/
+
+		/**
+		 * Meshes the given octree and writes it to disk
+		 *
+		 * If tiles are merged, the mesh is written to the
+		 * given file as a binary PLY file.  Otherwise, the
+		 * tile with indices (i,j,k) is written to
+		 * <stem>_<i>_<j>_<k>.ply, and the index file is
+		 * written to <stem>.tiles, where <stem> is the given
+		 * file name without its .ply suffix.
+		 *
+		 * Fails if the tree is too large for its resolution
+		 * for its corners to be indexed.
+		 *
+		 * @param filename   The .ply file to write
+		 * @param tree       The octree to mesh
+		 * @param topo       The topology of the octree
+		 * @param scheme     The segmentation scheme to use
+		 *
+		 * @return     Returns zero on success, non-zero on failure.
+		 */
+		int write(const std::string& filename, const octree_t& tree,
+				const octtopo::octtopo_t& topo,
+				node_boundary_t::SEG_SCHEME scheme);
+
+	/* helper functions */
+	private:
+
+		/**
+		 * Finds the tiles that may contain boundary faces
+		 *
+		 * Each tile is represented by its minimum corner.
+		 * The tiles are listed in sorted order.
+		 *
+		 * @param tiles   Where to store the tiles
+		 */
+		void find_tiles(std::vector<node_corner::corner_t>& tiles)
+				const;
+
+		/**
+		 * Checks if the given bounds touch the given tile
+		 *
+		 * Bounds that only touch the boundary of the tile
+		 * are counted as touching it.
+		 *
+		 * @param min_c   The minimum corner of the bounds
+		 * @param max_c   The maximum corner of the bounds
+		 * @param tile    The minimum corner of the tile
+		 *
+		 * @return    Returns true iff the bounds touch the tile
+		 */
+		bool touches(const node_corner::corner_t& min_c,
+				const node_corner::corner_t& max_c,
+				const node_corner::corner_t& tile) const;
+
+		/**
+		 * Finds the boundary faces that touch the given tile
+		 *
+		 * These are all faces that could have a corner in the
+		 * tile.  Faces are appended to the given vector.
+		 *
+		 * @param node    The subtree to search
+		 * @param tile    The minimum corner of the tile
+		 * @param found   Where to append the faces
+		 */
+		void gather_faces(octnode_t* node,
+				const node_corner::corner_t& tile,
+				std::vector<node_face_t>& found) const;
+
+		/**
+		 * Generates the triangles of a tile
+		 *
+		 * A polygon is generated for each corner in the tile,
+		 * in the same way as face_mesher_t, and split into
+		 * triangles.  The vertices of the triangles are
+		 * appended to the given buffer, three per triangle,
+		 * as indices of faces in the boundary index.
+		 *
+		 * @param tile   The minimum corner of the tile
+		 * @param tris   Where to store the triangles
+		 * @param ret    Where to store the return code
+		 */
+		void process_tile(const node_corner::corner_t* tile,
+				std::vector<size_t>* tris, int* ret) const;
+
+		/**
+		 * Meshes the given tiles into a single PLY file
+		 *
+		 * @param filename   The file to write
+		 * @param tiles      The tiles to mesh
+		 * @param nt         The number of threads to use
+		 *
+		 * @return     Returns zero on success, non-zero on failure.
+		 */
+		int write_merged(const std::string& filename,
+				const std::vector<node_corner::corner_t>&
+					tiles,
+				size_t nt) const;
+
+		/**
+		 * Meshes the given tiles into a PLY file per tile
+		 *
+		 * @param filename   The output file name, used to name
+		 *                   the tile and index files
+		 * @param tiles      The tiles to mesh
+		 * @param nt         The number of threads to use
+		 *
+		 * @return     Returns zero on success, non-zero on failure.
+		 */
+		int write_tiles(const std::string& filename,
+				const std::vector<node_corner::corner_t>&
+					tiles,
+				size_t nt) const;
+};
+
+#endif
@@ -695,7 +695,7 @@ size_t region_isostuffer_t::add_vertex(const Eigen::Vector2d& p2d,
 	vert.blue  = color.get_blue_int();
 
 	/* add to mesh */
-	v_ind      = mesh.num_verts();
+	v_ind      = this->index_offset + mesh.num_verts();
 	mesh.add(vert);
 
 	/* return its index */
@@ -94,6 +94,16 @@ class region_isostuffer_t
 		 */
 		std::map<node_corner::corner_t, size_t> vert2d_ind; 
 
+		/**
+		 * The index offset for new vertices
+		 *
+		 * A vertex added to a mesh is given the index
+		 * (index_offset + mesh.num_verts()).  This allows
+		 * the vertices of a region to be generated in a
+		 * separate mesh, and merged later.
+		 */
+		size_t index_offset;
+
 	/* functions */
 	public:
 
@@ -105,11 +115,27 @@ class region_isostuffer_t
 		 * need to properly align memory */
 		EIGEN_MAKE_ALIGNED_OPERATOR_NEW
 
+		/**
+		 * Constructs an empty structure
+		 */
+		region_isostuffer_t() : index_offset(0) {};
+
 		/**
 		 * Clears all information from this structure
 		 */
 		void clear();
 
+		/**
+		 * Sets the index offset for new vertices
+		 *
+		 * By default, the offset is zero, so new vertices
+		 * are indexed by their position in the given mesh.
+		 *
+		 * @param offset   The offset to add to new indices
+		 */
+		inline void set_index_offset(size_t offset)
+		{ this->index_offset = offset; };
+
 		/*------------*/
 		/* processing */
 		/*------------*/
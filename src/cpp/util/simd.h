@@ -0,0 +1,507 @@
+#ifndef SIMD_H
+#define SIMD_H
+
+/**
+ * @file simd.h
+ * @author Eric Turner <elturner@eecs.berkeley.edu>
+ *
+ * @section DESCRIPTION
+ *
+ * This file defines the simd::vec4d class, which is a four-wide
+ * vector of doubles.  It maps onto a single AVX register when the
+ * code is compiled with -mavx (or -mavx2), onto a pair of SSE2
+ * registers on any other x86_64 build, and onto a plain array
+ * everywhere else.
+ *
+ * It also defines the simd::vec4f class, a four-wide vector of
+ * floats, which maps onto a single SSE register (or a plain array).
+ * Each lane of a vec4f operation rounds exactly as the same scalar
+ * float operation does, so vectorized float code can reproduce the
+ * results of its scalar counterpart bit for bit.
+ *
+ * Only the small set of operations needed by the vectorized geometry
+ * code is provided here.  Each operation is a thin inline wrapper
+ * around the corresponding intrinsic, so code written in terms of
+ * vec4d compiles to straight-line vector instructions.
+ */
+
+#if defined(__AVX__)
+	#include <immintrin.h>
+	#define SIMD_USE_AVX
+#elif defined(__SSE2__)
+	#include <emmintrin.h>
+	#define SIMD_USE_SSE2
+#endif
+
+#if defined(__SSE__)
+	#include <xmmintrin.h>
+	#define SIMD_USE_SSE
+#endif
+
+#include <cmath>
+
+/* the number of lanes in each simd vector */
+#define SIMD_VEC4D_WIDTH 4
+#define SIMD_VEC4F_WIDTH 4
+
+/**
+ * The simd namespace holds the vector types and their operations
+ */
+namespace simd
+{
+	/**
+	 * A four-wide vector of double-precision values
+	 */
+	class vec4d
+	{
+		/* parameters */
+		public:
+
+#if defined(SIMD_USE_AVX)
+			__m256d v;
+#elif defined(SIMD_USE_SSE2)
+			__m128d lo; /* lanes 0,1 */
+			__m128d hi; /* lanes 2,3 */
+#else
+			double v[SIMD_VEC4D_WIDTH];
+#endif
+
+		/* functions */
+		public:
+
+			/**
+			 * Constructs an uninitialized vector
+			 */
+			inline vec4d() {};
+
+			/**
+			 * Constructs vector with all lanes set to x
+			 */
+			inline vec4d(double x)
+			{
+#if defined(SIMD_USE_AVX)
+				this->v = _mm256_set1_pd(x);
+#elif defined(SIMD_USE_SSE2)
+				this->lo = this->hi = _mm_set1_pd(x);
+#else
+				this->v[0] = this->v[1]
+					= this->v[2] = this->v[3] = x;
+#endif
+			};
+
+			/**
+			 * Loads four values from (unaligned) memory
+			 *
+			 * @param p   Pointer to four consecutive doubles
+			 */
+			static inline vec4d load(const double* p)
+			{
+				vec4d r;
+#if defined(SIMD_USE_AVX)
+				r.v = _mm256_loadu_pd(p);
+#elif defined(SIMD_USE_SSE2)
+				r.lo = _mm_loadu_pd(p);
+				r.hi = _mm_loadu_pd(p+2);
+#else
+				r.v[0] = p[0]; r.v[1] = p[1];
+				r.v[2] = p[2]; r.v[3] = p[3];
+#endif
+				return r;
+			};
+
+			/**
+			 * Stores the four lanes to (unaligned) memory
+			 *
+			 * @param p   Where to write four doubles
+			 */
+			inline void store(double* p) const
+			{
+#if defined(SIMD_USE_AVX)
+				_mm256_storeu_pd(p, this->v);
+#elif defined(SIMD_USE_SSE2)
+				_mm_storeu_pd(p, this->lo);
+				_mm_storeu_pd(p+2, this->hi);
+#else
+				p[0] = this->v[0]; p[1] = this->v[1];
+				p[2] = this->v[2]; p[3] = this->v[3];
+#endif
+			};
+	};
+
+	/*------------*/
+	/* arithmetic */
+	/*------------*/
+
+/* the following macro defines a lane-wise binary operator in terms
+ * of the avx, sse2, and scalar implementations */
+#if defined(SIMD_USE_AVX)
+	#define SIMD_VEC4D_BINOP(name, avx, sse, op) \
+		inline vec4d name(const vec4d& a, const vec4d& b) \
+		{ vec4d r; r.v = avx(a.v, b.v); return r; }
+#elif defined(SIMD_USE_SSE2)
+	#define SIMD_VEC4D_BINOP(name, avx, sse, op) \
+		inline vec4d name(const vec4d& a, const vec4d& b) \
+		{ vec4d r; r.lo = sse(a.lo, b.lo); \
+		  r.hi = sse(a.hi, b.hi); return r; }
+#else
+	#define SIMD_VEC4D_BINOP(name, avx, sse, op) \
+		inline vec4d name(const vec4d& a, const vec4d& b) \
+		{ vec4d r; for(int i = 0; i < SIMD_VEC4D_WIDTH; i++) \
+		  r.v[i] = op(a.v[i], b.v[i]); return r; }
+#endif
+
+	/* scalar fallbacks for the operators below */
+	inline double add_(double a, double b) { return a + b; };
+	inline double sub_(double a, double b) { return a - b; };
+	inline double mul_(double a, double b) { return a * b; };
+	inline double div_(double a, double b) { return a / b; };
+	inline double min_(double a, double b) { return (b < a) ? b : a; };
+	inline double max_(double a, double b) { return (a < b) ? b : a; };
+	inline double lt_(double a, double b)  { return (a < b) ? 1 : 0; };
+
+	SIMD_VEC4D_BINOP(operator+, _mm256_add_pd, _mm_add_pd, add_)
+	SIMD_VEC4D_BINOP(operator-, _mm256_sub_pd, _mm_sub_pd, sub_)
+	SIMD_VEC4D_BINOP(operator*, _mm256_mul_pd, _mm_mul_pd, mul_)
+	SIMD_VEC4D_BINOP(operator/, _mm256_div_pd, _mm_div_pd, div_)
+	SIMD_VEC4D_BINOP(min,       _mm256_min_pd, _mm_min_pd, min_)
+	SIMD_VEC4D_BINOP(max,       _mm256_max_pd, _mm_max_pd, max_)
+
+#undef SIMD_VEC4D_BINOP
+
+	/**
+	 * Lane-wise square-root
+	 */
+	inline vec4d sqrt(const vec4d& a)
+	{
+		vec4d r;
+#if defined(SIMD_USE_AVX)
+		r.v = _mm256_sqrt_pd(a.v);
+#elif defined(SIMD_USE_SSE2)
+		r.lo = _mm_sqrt_pd(a.lo);
+		r.hi = _mm_sqrt_pd(a.hi);
+#else
+		for(int i = 0; i < SIMD_VEC4D_WIDTH; i++)
+			r.v[i] = std::sqrt(a.v[i]);
+#endif
+		return r;
+	};
+
+	/**
+	 * Lane-wise absolute value
+	 */
+	inline vec4d abs(const vec4d& a)
+	{
+		vec4d r;
+#if defined(SIMD_USE_AVX)
+		r.v = _mm256_andnot_pd(_mm256_set1_pd(-0.0), a.v);
+#elif defined(SIMD_USE_SSE2)
+		r.lo = _mm_andnot_pd(_mm_set1_pd(-0.0), a.lo);
+		r.hi = _mm_andnot_pd(_mm_set1_pd(-0.0), a.hi);
+#else
+		for(int i = 0; i < SIMD_VEC4D_WIDTH; i++)
+			r.v[i] = std::fabs(a.v[i]);
+#endif
+		return r;
+	};
+
+	/**
+	 * Rounds each lane to the nearest integer
+	 *
+	 * The input is expected to be within the range of
+	 * a 32-bit signed integer.
+	 */
+	inline vec4d round(const vec4d& a)
+	{
+		vec4d r;
+#if defined(SIMD_USE_AVX)
+		r.v = _mm256_round_pd(a.v,
+			_MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+#elif defined(SIMD_USE_SSE2)
+		r.lo = _mm_cvtepi32_pd(_mm_cvtpd_epi32(a.lo));
+		r.hi = _mm_cvtepi32_pd(_mm_cvtpd_epi32(a.hi));
+#else
+		for(int i = 0; i < SIMD_VEC4D_WIDTH; i++)
+			r.v[i] = std::floor(a.v[i] + 0.5);
+#endif
+		return r;
+	};
+
+#if defined(SIMD_USE_AVX) || defined(SIMD_USE_SSE2)
+	/**
+	 * Computes 2^k for two integral lanes, k in [-1022, 1023]
+	 */
+	inline __m128d pow2_sse(__m128d k)
+	{
+		__m128i e;
+
+		/* build the ieee exponent field directly: the biased
+		 * exponent is positive, so unpacking against zero
+		 * widens it to 64 bits */
+		e = _mm_add_epi32(_mm_cvtpd_epi32(k), _mm_set1_epi32(1023));
+		e = _mm_unpacklo_epi32(e, _mm_setzero_si128());
+		return _mm_castsi128_pd(_mm_slli_epi64(e, 52));
+	};
+#endif
+
+	/**
+	 * Computes 2^k for each lane, where k is integral
+	 *
+	 * Each lane of k must be in the range [-1022, 1023].
+	 */
+	inline vec4d pow2(const vec4d& k)
+	{
+		vec4d r;
+#if defined(SIMD_USE_AVX)
+		r.v = _mm256_castpd128_pd256(
+				pow2_sse(_mm256_castpd256_pd128(k.v)));
+		r.v = _mm256_insertf128_pd(r.v,
+				pow2_sse(_mm256_extractf128_pd(k.v, 1)), 1);
+#elif defined(SIMD_USE_SSE2)
+		r.lo = pow2_sse(k.lo);
+		r.hi = pow2_sse(k.hi);
+#else
+		for(int i = 0; i < SIMD_VEC4D_WIDTH; i++)
+			r.v[i] = std::ldexp(1.0, (int) k.v[i]);
+#endif
+		return r;
+	};
+
+	/*------------*/
+	/* comparison */
+	/*------------*/
+
+	/**
+	 * Lane-wise (a < b), returned as a mask for select()
+	 */
+	inline vec4d lt(const vec4d& a, const vec4d& b)
+	{
+		vec4d r;
+#if defined(SIMD_USE_AVX)
+		r.v = _mm256_cmp_pd(a.v, b.v, _CMP_LT_OQ);
+#elif defined(SIMD_USE_SSE2)
+		r.lo = _mm_cmplt_pd(a.lo, b.lo);
+		r.hi = _mm_cmplt_pd(a.hi, b.hi);
+#else
+		for(int i = 0; i < SIMD_VEC4D_WIDTH; i++)
+			r.v[i] = lt_(a.v[i], b.v[i]);
+#endif
+		return r;
+	};
+
+	/**
+	 * Lane-wise (m ? a : b), where m was produced by lt()
+	 */
+	inline vec4d select(const vec4d& m, const vec4d& a, const vec4d& b)
+	{
+		vec4d r;
+#if defined(SIMD_USE_AVX)
+		r.v = _mm256_blendv_pd(b.v, a.v, m.v);
+#elif defined(SIMD_USE_SSE2)
+		r.lo = _mm_or_pd(_mm_and_pd(m.lo, a.lo),
+		                 _mm_andnot_pd(m.lo, b.lo));
+		r.hi = _mm_or_pd(_mm_and_pd(m.hi, a.hi),
+		                 _mm_andnot_pd(m.hi, b.hi));
+#else
+		for(int i = 0; i < SIMD_VEC4D_WIDTH; i++)
+			r.v[i] = (m.v[i] != 0) ? a.v[i] : b.v[i];
+#endif
+		return r;
+	};
+
+	/**
+	 * Lane-wise (a || b) of two masks produced by lt()
+	 */
+	inline vec4d mask_or(const vec4d& a, const vec4d& b)
+	{
+		vec4d r;
+#if defined(SIMD_USE_AVX)
+		r.v = _mm256_or_pd(a.v, b.v);
+#elif defined(SIMD_USE_SSE2)
+		r.lo = _mm_or_pd(a.lo, b.lo);
+		r.hi = _mm_or_pd(a.hi, b.hi);
+#else
+		for(int i = 0; i < SIMD_VEC4D_WIDTH; i++)
+			r.v[i] = (a.v[i] != 0 || b.v[i] != 0) ? 1 : 0;
+#endif
+		return r;
+	};
+
+	/**
+	 * Packs a mask produced by lt() into the low bits of an int
+	 *
+	 * Bit i of the result is set iff lane i of the mask is set.
+	 */
+	inline int movemask(const vec4d& m)
+	{
+#if defined(SIMD_USE_AVX)
+		return _mm256_movemask_pd(m.v);
+#elif defined(SIMD_USE_SSE2)
+		return _mm_movemask_pd(m.lo) | (_mm_movemask_pd(m.hi) << 2);
+#else
+		int i, r;
+
+		r = 0;
+		for(i = 0; i < SIMD_VEC4D_WIDTH; i++)
+			if(m.v[i] != 0)
+				r |= (1 << i);
+		return r;
+#endif
+	};
+
+	/*-------------------------*/
+	/* single-precision vector */
+	/*-------------------------*/
+
+	/**
+	 * A four-wide vector of single-precision values
+	 */
+	class vec4f
+	{
+		/* parameters */
+		public:
+
+#if defined(SIMD_USE_SSE)
+			__m128 v;
+#else
+			float v[SIMD_VEC4F_WIDTH];
+#endif
+
+		/* functions */
+		public:
+
+			/**
+			 * Constructs an uninitialized vector
+			 */
+			inline vec4f() {};
+
+			/**
+			 * Constructs vector with all lanes set to x
+			 */
+			inline vec4f(float x)
+			{
+#if defined(SIMD_USE_SSE)
+				this->v = _mm_set1_ps(x);
+#else
+				this->v[0] = this->v[1]
+					= this->v[2] = this->v[3] = x;
+#endif
+			};
+
+			/**
+			 * Loads four values from (unaligned) memory
+			 *
+			 * @param p   Pointer to four consecutive floats
+			 */
+			static inline vec4f load(const float* p)
+			{
+				vec4f r;
+#if defined(SIMD_USE_SSE)
+				r.v = _mm_loadu_ps(p);
+#else
+				r.v[0] = p[0]; r.v[1] = p[1];
+				r.v[2] = p[2]; r.v[3] = p[3];
+#endif
+				return r;
+			};
+
+			/**
+			 * Stores the four lanes to (unaligned) memory
+			 *
+			 * @param p   Where to write four floats
+			 */
+			inline void store(float* p) const
+			{
+#if defined(SIMD_USE_SSE)
+				_mm_storeu_ps(p, this->v);
+#else
+				p[0] = this->v[0]; p[1] = this->v[1];
+				p[2] = this->v[2]; p[3] = this->v[3];
+#endif
+			};
+	};
+
+/* the following macro defines a lane-wise binary operator in terms
+ * of the sse and scalar implementations */
+#if defined(SIMD_USE_SSE)
+	#define SIMD_VEC4F_BINOP(name, sse, op) \
+		inline vec4f name(const vec4f& a, const vec4f& b) \
+		{ vec4f r; r.v = sse(a.v, b.v); return r; }
+#else
+	#define SIMD_VEC4F_BINOP(name, sse, op) \
+		inline vec4f name(const vec4f& a, const vec4f& b) \
+		{ vec4f r; for(int i = 0; i < SIMD_VEC4F_WIDTH; i++) \
+		  r.v[i] = op(a.v[i], b.v[i]); return r; }
+#endif
+
+	/* scalar fallbacks for the operators below, where masks
+	 * are represented as one (true) or zero (false) */
+	inline float add_(float a, float b) { return a + b; };
+	inline float sub_(float a, float b) { return a - b; };
+	inline float mul_(float a, float b) { return a * b; };
+	inline float div_(float a, float b) { return a / b; };
+	inline float lt_(float a, float b)  { return (a < b) ? 1 : 0; };
+	inline float le_(float a, float b)  { return (a <= b) ? 1 : 0; };
+	inline float eq_(float a, float b)  { return (a == b) ? 1 : 0; };
+	inline float and_(float a, float b)
+		{ return (a != 0 && b != 0) ? 1 : 0; };
+	inline float or_(float a, float b)
+		{ return (a != 0 || b != 0) ? 1 : 0; };
+	inline float andnot_(float a, float b)
+		{ return (a == 0 && b != 0) ? 1 : 0; };
+
+	SIMD_VEC4F_BINOP(operator+,   _mm_add_ps,    add_)
+	SIMD_VEC4F_BINOP(operator-,   _mm_sub_ps,    sub_)
+	SIMD_VEC4F_BINOP(operator*,   _mm_mul_ps,    mul_)
+	SIMD_VEC4F_BINOP(operator/,   _mm_div_ps,    div_)
+
+	/* comparisons, which return masks for select().  A comparison
+	 * with a NaN lane is false, as it is for scalars. */
+	SIMD_VEC4F_BINOP(lt,          _mm_cmplt_ps,  lt_)
+	SIMD_VEC4F_BINOP(le,          _mm_cmple_ps,  le_)
+	SIMD_VEC4F_BINOP(eq,          _mm_cmpeq_ps,  eq_)
+
+	/* logical operations on masks, where mask_andnot(a, b)
+	 * is (!a && b) */
+	SIMD_VEC4F_BINOP(mask_and,    _mm_and_ps,    and_)
+	SIMD_VEC4F_BINOP(mask_or,     _mm_or_ps,     or_)
+	SIMD_VEC4F_BINOP(mask_andnot, _mm_andnot_ps, andnot_)
+
+#undef SIMD_VEC4F_BINOP
+
+	/**
+	 * Lane-wise (m ? a : b), where m is a comparison mask
+	 */
+	inline vec4f select(const vec4f& m, const vec4f& a, const vec4f& b)
+	{
+		vec4f r;
+#if defined(SIMD_USE_SSE)
+		r.v = _mm_or_ps(_mm_and_ps(m.v, a.v), _mm_andnot_ps(m.v, b.v));
+#else
+		for(int i = 0; i < SIMD_VEC4F_WIDTH; i++)
+			r.v[i] = (m.v[i] != 0) ? a.v[i] : b.v[i];
+#endif
+		return r;
+	};
+
+	/**
+	 * Packs a comparison mask into the low bits of an int
+	 *
+	 * Bit i of the result is set iff lane i of the mask is set.
+	 */
+	inline int movemask(const vec4f& m)
+	{
+#if defined(SIMD_USE_SSE)
+		return _mm_movemask_ps(m.v);
+#else
+		int i, r;
+
+		r = 0;
+		for(i = 0; i < SIMD_VEC4F_WIDTH; i++)
+			if(m.v[i] != 0)
+				r |= (1 << i);
+		return r;
+#endif
+	};
+}
+
+#endif
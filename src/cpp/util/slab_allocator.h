@@ -0,0 +1,456 @@
+#ifndef SLAB_ALLOCATOR_H
+#define SLAB_ALLOCATOR_H
+
+/**
+ * @file   slab_allocator.h
+ * @author Eric Turner <elturner@eecs.berkeley.edu>
+ * @brief  Allocates many small objects of one type in large slabs
+ *
+ * @section DESCRIPTION
+ *
+ * This file defines the slab_allocator_t class, which is used to
+ * allocate objects of a single type out of large slabs of memory,
+ * rather than calling malloc() for each object.  This is meant for
+ * types like octree nodes, where a program may have hundreds of
+ * millions of small objects alive at once, and spends much of its
+ * time and memory on per-object allocator overhead.
+ *
+ * Each thread keeps its own list of freed objects and its own
+ * partially-used slab, so allocating and freeing objects takes no
+ * locks in the common case.  Objects may be freed by any thread.
+ * A thread that frees many more objects than it allocates, such as
+ * the consumer of objects made by another thread, gives its extra
+ * freed objects back to the pool, and a thread that runs out of
+ * memory takes those before making a new slab.
+ *
+ * Slabs are only returned to the system in bulk, by calling
+ * release_if_unused() once no objects of the type are alive (such
+ * as after the last tree that uses them has been cleared).
+ *
+ * A class uses this allocator by defining its operator new and
+ * operator delete to call allocate() and deallocate().
+ */
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <utility>
+#include <new>
+#include <cstddef>
+#include <stdlib.h>
+
+/**
+ * The slab_allocator_t class provides fast allocation of one type
+ *
+ * All functions are static, so there is one pool of memory per type.
+ *
+ * @tparam T   The type of object to allocate
+ */
+template<class T> class slab_allocator_t
+{
+	/* parameters */
+	public:
+
+		/* the number of bytes in each slab */
+		static const size_t SLAB_SIZE = (1 << 20);
+
+		/* the number of bytes used by each object, which is
+		 * rounded up to keep every object aligned, and large
+		 * enough to hold a free-list pointer */
+		static const size_t SLOT_SIZE =
+			(((sizeof(T) > sizeof(void*)) ? sizeof(T)
+				: sizeof(void*)) + alignof(T) - 1)
+			/ alignof(T) * alignof(T);
+
+		/* the number of objects in each slab */
+		static const size_t SLOTS_PER_SLAB = (SLAB_SIZE / SLOT_SIZE);
+
+		/* once a thread has this many freed objects, it gives
+		 * a slab's worth of them back to the pool */
+		static const size_t MAX_FREE_PER_THREAD = (2*SLOTS_PER_SLAB);
+
+	/* helper classes */
+	private:
+
+		/**
+		 * The cache_t class holds the per-thread allocator state
+		 */
+		class cache_t
+		{
+			public:
+
+				/* the list of freed objects, each of
+				 * which points to the next */
+				void* free_list;
+				size_t num_free;
+
+				/* the unused portion of this thread's
+				 * current slab */
+				char* next;
+				char* end;
+
+				/* the number of objects allocated minus the
+				 * number freed by this thread.  This is only
+				 * written by the owning thread. */
+				std::atomic<long> live;
+
+				/* the generation of the pool when this
+				 * cache was last reset */
+				unsigned long generation;
+
+				/* constructs an empty cache, and registers
+				 * it with the pool */
+				cache_t();
+
+				/* returns this cache's objects to the
+				 * pool when its thread exits */
+				~cache_t();
+		};
+
+		/**
+		 * The registry_t class holds the state shared by all threads
+		 */
+		class registry_t
+		{
+			public:
+
+				/* locks all members of this class, except
+				 * for generation, which is atomic */
+				std::mutex mtx;
+
+				/* every slab allocated so far */
+				std::vector<char*> slabs;
+
+				/* the caches of all running threads */
+				std::vector<cache_t*> caches;
+
+				/* the free lists given up by threads that
+				 * had too many freed objects or that have
+				 * exited, with the length of each list */
+				std::vector<std::pair<void*, size_t> > spares;
+
+				/* the live count of threads that have
+				 * exited */
+				long orphan_live;
+
+				/* the generation is incremented whenever a
+				 * release is attempted, and released marks
+				 * the last generation at which slabs were
+				 * actually returned to the system */
+				std::atomic<unsigned long> generation;
+				unsigned long released;
+
+				registry_t()
+				{
+					this->orphan_live = 0;
+					this->generation  = 0;
+					this->released    = 0;
+				};
+		};
+
+	/* functions */
+	public:
+
+		/**
+		 * Allocates memory for one object
+		 *
+		 * Requests for any size other than sizeof(T), such as from
+		 * a derived class, are passed on to the global allocator.
+		 *
+		 * @param n   The number of bytes requested
+		 *
+		 * @return    Returns a pointer to the allocated memory.
+		 */
+		static void* allocate(size_t n)
+		{
+			cache_t& c = slab_allocator_t<T>::cache();
+			void* p;
+
+			/* check for sizes we don't manage */
+			if(n != sizeof(T))
+				return ::operator new(n);
+
+			/* count this object before touching the cache, so
+			 * that a concurrent release will either see it or
+			 * be seen by the generation check below */
+			c.live.store(c.live.load(std::memory_order_relaxed)
+					+ 1, std::memory_order_seq_cst);
+			if(registry().generation.load(std::memory_order_seq_cst)
+					!= c.generation)
+				slab_allocator_t<T>::sync(c);
+
+			/* get more memory if this thread is out */
+			if(c.free_list == NULL && c.next == c.end)
+				slab_allocator_t<T>::refill(c);
+
+			/* reuse a freed object if one is available */
+			if(c.free_list != NULL)
+			{
+				p = c.free_list;
+				c.free_list = *((void**) p);
+				c.num_free--;
+				return p;
+			}
+
+			/* otherwise take the next slot of the slab */
+			p = c.next;
+			c.next += SLOT_SIZE;
+			return p;
+		};
+
+		/**
+		 * Frees memory for one object
+		 *
+		 * The memory must have been returned by allocate() with
+		 * the same size, but may be freed by any thread.
+		 *
+		 * @param p   The memory to free
+		 * @param n   The size of the object
+		 */
+		static void deallocate(void* p, size_t n)
+		{
+			cache_t& c = slab_allocator_t<T>::cache();
+
+			/* check for sizes we don't manage */
+			if(p == NULL)
+				return;
+			if(n != sizeof(T))
+			{
+				::operator delete(p);
+				return;
+			}
+
+			/* add to this thread's free list.  The object is
+			 * still counted as live until it is on the list,
+			 * so a release cannot happen in between */
+			if(registry().generation.load(std::memory_order_seq_cst)
+					!= c.generation)
+				slab_allocator_t<T>::sync(c);
+			*((void**) p) = c.free_list;
+			c.free_list = p;
+			c.num_free++;
+
+			/* don't let objects that other threads allocated
+			 * pile up here */
+			if(c.num_free >= MAX_FREE_PER_THREAD)
+				slab_allocator_t<T>::donate(c);
+			c.live.store(c.live.load(std::memory_order_relaxed)
+					- 1, std::memory_order_seq_cst);
+		};
+
+		/**
+		 * Returns all slabs to the system if no objects are alive
+		 *
+		 * If any object allocated by this class is still alive,
+		 * then this call does nothing.  This is safe to call while
+		 * other threads allocate and free objects.
+		 *
+		 * @return   Returns true iff the slabs were released.
+		 */
+		static bool release_if_unused()
+		{
+			registry_t& r = registry();
+			long live;
+			size_t i;
+
+			/* announce the release before counting, so any
+			 * thread that allocates after the count will wait
+			 * on the lock in sync() */
+			std::lock_guard<std::mutex> lock(r.mtx);
+			r.generation.fetch_add(1, std::memory_order_seq_cst);
+
+			/* count the live objects across all threads */
+			live = r.orphan_live;
+			for(i = 0; i < r.caches.size(); i++)
+				live += r.caches[i]->live.load(
+						std::memory_order_seq_cst);
+			if(live != 0)
+				return false;
+
+			/* free everything.  Each thread's cache will be
+			 * reset when it next sees the new generation. */
+			for(i = 0; i < r.slabs.size(); i++)
+				free(r.slabs[i]);
+			std::vector<char*>().swap(r.slabs);
+			r.spares.clear();
+			r.released = r.generation.load();
+			return true;
+		};
+
+		/**
+		 * Retrieves the number of bytes of slabs allocated
+		 *
+		 * @return   Returns the total size of all current slabs.
+		 */
+		static size_t num_bytes()
+		{
+			registry_t& r = registry();
+			std::lock_guard<std::mutex> lock(r.mtx);
+			return (r.slabs.size() * SLAB_SIZE);
+		};
+
+	/* helper functions */
+	private:
+
+		/**
+		 * Retrieves the shared state of this allocator
+		 *
+		 * The registry is never destroyed, so that objects freed
+		 * during static destruction are still valid.
+		 */
+		static registry_t& registry()
+		{
+			static registry_t* r = new registry_t();
+			return *r;
+		};
+
+		/**
+		 * Retrieves the cache of the calling thread
+		 */
+		static cache_t& cache()
+		{
+			static thread_local cache_t c;
+			return c;
+		};
+
+		/**
+		 * Updates a cache after the pool's generation changes
+		 *
+		 * If the pool has released its slabs since this cache
+		 * was last reset, then all of the cache's memory is gone,
+		 * so it is emptied.
+		 *
+		 * @param c   The cache to update
+		 */
+		static void sync(cache_t& c)
+		{
+			registry_t& r = registry();
+			std::lock_guard<std::mutex> lock(r.mtx);
+
+			/* check if our memory was released */
+			if(c.generation < r.released)
+			{
+				c.free_list = NULL;
+				c.num_free = 0;
+				c.next = c.end = NULL;
+			}
+			c.generation = r.generation.load();
+		};
+
+		/**
+		 * Gives a cache more memory once it runs out
+		 *
+		 * Will take a free list given up by another thread
+		 * if one exists, or allocate a new slab.
+		 *
+		 * @param c   The cache to refill
+		 */
+		static void refill(cache_t& c)
+		{
+			registry_t& r = registry();
+			std::lock_guard<std::mutex> lock(r.mtx);
+			char* slab;
+
+			/* reuse memory from other threads first */
+			if(!(r.spares.empty()))
+			{
+				c.free_list = r.spares.back().first;
+				c.num_free  = r.spares.back().second;
+				r.spares.pop_back();
+				return;
+			}
+
+			/* make a new slab */
+			slab = (char*) malloc(SLAB_SIZE);
+			if(slab == NULL)
+				throw std::bad_alloc();
+			r.slabs.push_back(slab);
+			c.next = slab;
+			c.end  = slab + SLOTS_PER_SLAB*SLOT_SIZE;
+		};
+
+		/**
+		 * Gives part of a cache's free list to the pool
+		 *
+		 * Moves a slab's worth of objects from the front of
+		 * the free list to the pool, keeping the rest, so that
+		 * alternating frees and allocations don't move the same
+		 * objects back and forth.
+		 *
+		 * @param c   The cache to take objects from
+		 */
+		static void donate(cache_t& c)
+		{
+			registry_t& r = registry();
+			void* head;
+			void** tail;
+			size_t i;
+
+			/* split the list after the first slab's worth */
+			head = c.free_list;
+			tail = (void**) head;
+			for(i = 1; i < SLOTS_PER_SLAB; i++)
+				tail = (void**) (*tail);
+			c.free_list = *tail;
+			c.num_free -= SLOTS_PER_SLAB;
+			*tail = NULL;
+
+			/* add to the pool */
+			std::lock_guard<std::mutex> lock(r.mtx);
+			r.spares.push_back(std::make_pair(head,
+			                   (size_t) SLOTS_PER_SLAB));
+		};
+};
+
+/* cache_t functions */
+
+template<class T> slab_allocator_t<T>::cache_t::cache_t()
+{
+	registry_t& r = slab_allocator_t<T>::registry();
+	std::lock_guard<std::mutex> lock(r.mtx);
+
+	/* start empty, and register with the pool */
+	this->free_list  = NULL;
+	this->num_free   = 0;
+	this->next       = NULL;
+	this->end        = NULL;
+	this->live       = 0;
+	this->generation = r.generation.load();
+	r.caches.push_back(this);
+}
+
+template<class T> slab_allocator_t<T>::cache_t::~cache_t()
+{
+	registry_t& r = slab_allocator_t<T>::registry();
+	std::lock_guard<std::mutex> lock(r.mtx);
+	size_t i;
+
+	/* unregister from the pool */
+	for(i = 0; i < r.caches.size(); i++)
+		if(r.caches[i] == this)
+		{
+			r.caches[i] = r.caches.back();
+			r.caches.pop_back();
+			break;
+		}
+	r.orphan_live += this->live.load();
+
+	/* if the memory of this cache was already released,
+	 * there is nothing to give back */
+	if(this->generation < r.released)
+		return;
+
+	/* give the rest of the slab and the free list to the
+	 * pool, so that other threads can use them */
+	for(; this->next != this->end; this->next += SLOT_SIZE)
+	{
+		*((void**) this->next) = this->free_list;
+		this->free_list = this->next;
+		this->num_free++;
+	}
+	if(this->free_list != NULL)
+		r.spares.push_back(std::make_pair(this->free_list,
+		                                  this->num_free));
+}
+
+#endif
@@ -1,5 +1,6 @@
 #include "union_find.h"
 #include <cstddef>
+#include <atomic>
 #include <vector>
 #include <map>
 
@@ -16,6 +17,9 @@
  *
  * This library is used by specifying the number of nodes in a graph,
  * and the edge connections between each node.
+ *
+ * The concurrent_union_find_t class performs the same algorithm, but
+ * allows edges to be added from multiple threads at once.
  */
 
 using namespace std;
@@ -111,3 +115,90 @@ int union_find_t::get_root(size_t i)
 	forest[i] = r;
 	return r;
 }
+
+/*------------------------------------------------*/
+/* concurrent union-find function implementations */
+/*------------------------------------------------*/
+
+void concurrent_union_find_t::init(size_t N)
+{
+	size_t i;
+
+	/* atomics can't be copied, so replace the forest */
+	vector<atomic<size_t> >(N).swap(this->forest);
+	for(i = 0; i < N; i++)
+		this->forest[i].store(i); /* make everything a root */
+}
+
+int concurrent_union_find_t::add_edge(size_t a, size_t b)
+{
+	size_t ra, rb, expected, N;
+
+	/* verify input represent valid nodes */
+	N = this->forest.size();
+	if(a >= N || b >= N)
+		return -1; /* error, invalid indices */
+
+	/* link the larger root to the smaller root.  If another
+	 * thread links the larger root first, then try again
+	 * with the new roots */
+	while(true)
+	{
+		ra = this->get_root(a);
+		rb = this->get_root(b);
+		if(ra == rb)
+			return 0; /* already connected */
+		if(ra < rb)
+		{
+			/* make ra the larger root */
+			expected = ra;
+			ra = rb;
+			rb = expected;
+		}
+		expected = ra;
+		if(this->forest[ra].compare_exchange_strong(expected, rb))
+			return 0;
+	}
+}
+
+size_t concurrent_union_find_t::get_root(size_t i)
+{
+	size_t p, gp;
+
+	/* walk up the tree, halving the path as we go so the
+	 * next call is faster.  A failed update just means another
+	 * thread has already shortened the path */
+	while(true)
+	{
+		p = this->forest[i].load();
+		if(p == i)
+			return i;
+		gp = this->forest[p].load();
+		if(gp != p)
+			this->forest[i].compare_exchange_weak(p, gp);
+		i = gp;
+	}
+}
+
+void concurrent_union_find_t::get_unions(vector<vector<size_t> >& unions)
+{
+	vector<size_t> union_of;
+	size_t i, n, r;
+
+	/* since each root is the least index of its union,
+	 * the roots are found in sorted order */
+	n = this->forest.size();
+	union_of.resize(n);
+	unions.clear();
+	for(i = 0; i < n; i++)
+	{
+		r = this->get_root(i);
+		if(r == i)
+		{
+			/* i starts a new union */
+			union_of[i] = unions.size();
+			unions.resize(unions.size() + 1);
+		}
+		unions[union_of[r]].push_back(i);
+	}
+}
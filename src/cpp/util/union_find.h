@@ -14,9 +14,13 @@
  *
  * This library is used by specifying the number of nodes in a graph,
  * and the edge connections between each node.
+ *
+ * The concurrent_union_find_t class performs the same algorithm, but
+ * allows edges to be added from multiple threads at once.
  */
 
 #include <cstddef>
+#include <atomic>
 #include <vector>
 
 /**
@@ -99,4 +103,79 @@ class union_find_t
 		int get_root(size_t i);
 };
 
+/**
+ * The concurrent_union_find_t class performs union-find from many threads
+ *
+ * Edges can be added to this structure from multiple threads at once,
+ * without locks.  Each root is always linked to the root with the
+ * smaller index, so the root of each union is its least index and
+ * the resulting unions do not depend on the order that edges are
+ * added in.
+ */
+class concurrent_union_find_t
+{
+	/* parameters */
+	private:
+
+		/**
+		 * This represents the connectivity of the graph so far
+		 *
+		 * Each element stores the index of its parent, which
+		 * is never greater than its own index.
+		 */
+		std::vector<std::atomic<size_t> > forest;
+
+	/* functions */
+	public:
+
+		/**
+		 * Initialize the union-find object
+		 *
+		 * This call will remove any existing data, and should
+		 * not be made while other threads are adding edges.
+		 *
+		 * @param N   The number of nodes in the desired graph
+		 */
+		void init(size_t N);
+
+		/**
+		 * Will incorporate edge (a,b) into the represented graph
+		 *
+		 * This function may be called from multiple threads
+		 * at once.
+		 *
+		 * @param a   The first node index of represented edge
+		 * @param b   The second node index of represented edge
+		 *
+		 * @return    Returns zero on success, non-zero on failure.
+		 */
+		int add_edge(size_t a, size_t b);
+
+		/**
+		 * Gets the root of the union that contains the given node
+		 *
+		 * This function may be called from multiple threads
+		 * at once.  Once all edges have been added, the root
+		 * is the least index in the union.
+		 *
+		 * @param i   The index of the node, which must be valid
+		 *
+		 * @return    Returns the root index of i
+		 */
+		size_t get_root(size_t i);
+
+		/**
+		 * Retrieves a list of all unions in the graph
+		 *
+		 * After all edges have been added, calling this function
+		 * will populate the specified vector with all unions
+		 * in the represented graph.  The unions are sorted by
+		 * their least index, and the indices within each union
+		 * are sorted.
+		 *
+		 * @param unions   Where to store the lists of union indices
+		 */
+		void get_unions(std::vector<std::vector<size_t> >& unions);
+};
+
 #endif